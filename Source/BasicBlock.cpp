@@ -1,8 +1,10 @@
 #include "BasicBlock.h"
 #include "MemStream.h"
+#include "MIPSInstructionFactory.h"
 #include "offsetof_def.h"
 #include "MipsJitter.h"
 #include "Jitter_CodeGenFactory.h"
+#include "JitBlockCache.h"
 
 #if defined(AOT_BUILD_CACHE) || defined(AOT_USE_CACHE)
 #define AOT_ENABLED
@@ -79,15 +81,12 @@ void CBasicBlock::Compile()
 
 	Framework::CMemStream stream;
 	{
-		static
-#ifdef AOT_BUILD_CACHE
-		    __declspec(thread)
-#endif
-		        CMipsJitter* jitter = nullptr;
-		if(jitter == nullptr)
+		//Blocks can be compiled from background threads, each thread needs its own jitter
+		static thread_local std::unique_ptr<CMipsJitter> jitter;
+		if(!jitter)
 		{
 			Jitter::CCodeGen* codeGen = Jitter::CreateCodeGen();
-			jitter = new CMipsJitter(codeGen);
+			jitter = std::make_unique<CMipsJitter>(codeGen);
 
 			for(unsigned int i = 0; i < 4; i++)
 			{
@@ -100,7 +99,12 @@ void CBasicBlock::Compile()
 		jitter->GetCodeGen()->SetExternalSymbolReferencedHandler([&](auto symbol, auto offset, auto refType) { this->HandleExternalFunctionReference(symbol, offset, refType); });
 		jitter->SetStream(&stream);
 		jitter->Begin();
-		CompileRange(jitter);
+		if(!m_instructionSnapshot.empty())
+		{
+			CMIPSInstructionFactory::SetInstructionSnapshot(m_begin, m_instructionSnapshot.data(), static_cast<uint32>(m_instructionSnapshot.size()));
+		}
+		CompileRange(jitter.get());
+		CMIPSInstructionFactory::SetInstructionSnapshot(0, nullptr, 0);
 		jitter->End();
 	}
 
@@ -136,7 +140,7 @@ void CBasicBlock::Compile()
 	{
 		for(uint32 i = 0; i < blockSize; i++)
 		{
-			blockData[i] = m_context.m_pMemoryMap->GetWord(m_begin + (i * 4));
+			blockData[i] = m_instructionSnapshot.empty() ? m_context.m_pMemoryMap->GetWord(m_begin + (i * 4)) : m_instructionSnapshot[i];
 		}
 	}
 	else
@@ -188,6 +192,61 @@ void CBasicBlock::Compile()
 		m_aotBlockOutputStream->Write(blockData, blockSize * 4);
 	}
 #endif
+
+	m_instructionSnapshot = std::vector<uint32>();
+}
+
+void CBasicBlock::SetInstructionSnapshot(std::vector<uint32> instructions)
+{
+	assert(instructions.size() == ((m_end - m_begin) / 4) + 1);
+	m_instructionSnapshot = std::move(instructions);
+}
+
+bool CBasicBlock::CompileWithCache(CJitBlockCache& blockCache, uint32 checksum)
+{
+#ifdef AOT_ENABLED
+	Compile();
+	return false;
+#else
+	AOT_BLOCK_KEY blockKey = {checksum, m_begin, m_end};
+
+	CJitBlockCache::BLOCK cachedBlock;
+	if(blockCache.FindBlock(blockKey, cachedBlock))
+	{
+		m_function = CMemoryFunction(cachedBlock.code.data(), cachedBlock.code.size());
+		auto code = reinterpret_cast<uint8*>(m_function.GetCode());
+		m_function.BeginModify();
+		for(const auto& relocation : cachedBlock.relocations)
+		{
+			auto symbol = CJitBlockCache::GetSymbolFromDelta(relocation.symbolDelta);
+			*reinterpret_cast<uintptr_t*>(code + relocation.offset) = symbol;
+			HandleExternalFunctionReference(symbol, relocation.offset, Jitter::CCodeGen::SYMBOL_REF_TYPE::NATIVE_POINTER);
+		}
+		m_function.EndModify();
+		m_instructionSnapshot = std::vector<uint32>();
+		return true;
+	}
+
+	SymbolReferenceArray symbolReferences;
+	m_symbolReferences = &symbolReferences;
+	m_hasUnrelocatableSymbol = false;
+	Compile();
+	m_symbolReferences = nullptr;
+
+	if(m_hasUnrelocatableSymbol) return false;
+
+	CJitBlockCache::RelocationArray relocations;
+	relocations.reserve(symbolReferences.size());
+	for(const auto& symbolReference : symbolReferences)
+	{
+		CJitBlockCache::RELOCATION relocation = {};
+		relocation.offset = symbolReference.offset;
+		relocation.symbolDelta = CJitBlockCache::GetSymbolDelta(symbolReference.symbol);
+		relocations.push_back(relocation);
+	}
+	blockCache.AddBlock(blockKey, m_function.GetCode(), static_cast<uint32>(m_function.GetSize()), relocations);
+	return false;
+#endif
 }
 
 void CBasicBlock::CompileRange(CMipsJitter* jitter)
@@ -331,6 +390,15 @@ bool CBasicBlock::IsEmpty() const
 	       (m_end == MIPS_INVALID_PC);
 }
 
+size_t CBasicBlock::GetCodeSize() const
+{
+#ifndef AOT_USE_CACHE
+	return m_function.GetSize();
+#else
+	return 0;
+#endif
+}
+
 uint32 CBasicBlock::GetRecycleCount() const
 {
 	return m_recycleCount;
@@ -392,6 +460,17 @@ void CBasicBlock::UnlinkBlock(LINK_SLOT linkSlot)
 
 void CBasicBlock::HandleExternalFunctionReference(uintptr_t symbol, uint32 offset, Jitter::CCodeGen::SYMBOL_REF_TYPE refType)
 {
+	if(m_symbolReferences)
+	{
+		if((refType == Jitter::CCodeGen::SYMBOL_REF_TYPE::NATIVE_POINTER) && CJitBlockCache::CanRelocateSymbol(symbol))
+		{
+			m_symbolReferences->push_back(SYMBOL_REFERENCE{symbol, offset});
+		}
+		else
+		{
+			m_hasUnrelocatableSymbol = true;
+		}
+	}
 	if(symbol == reinterpret_cast<uintptr_t>(&NextBlockTrampoline))
 	{
 		assert(refType == Jitter::CCodeGen::SYMBOL_REF_TYPE::NATIVE_POINTER);
@@ -410,6 +489,8 @@ void CBasicBlock::HandleExternalFunctionReference(uintptr_t symbol, uint32 offse
 
 bool CBasicBlock::HasBreakpoint() const
 {
+	//Snapshots are only taken from code without breakpoints
+	if(!m_instructionSnapshot.empty()) return false;
 	return m_context.HasBreakpointInRange(GetBeginAddress(), GetEndAddress());
 }
 
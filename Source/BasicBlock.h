@@ -1,5 +1,6 @@
 #pragma once
 
+#include <vector>
 #include "MIPS.h"
 #include "MemoryFunction.h"
 #ifdef AOT_BUILD_CACHE
@@ -40,6 +41,8 @@ namespace Jitter
 	class CJitter;
 };
 
+class CJitBlockCache;
+
 extern "C"
 {
 	void EmptyBlockHandler(CMIPS*);
@@ -60,12 +63,18 @@ public:
 	virtual ~CBasicBlock() = default;
 	void Execute();
 	void Compile();
+	//Returns true if the block was found in the cache and didn't need to be compiled
+	bool CompileWithCache(CJitBlockCache&, uint32);
 	virtual void CompileRange(CMipsJitter*);
+	//Block will be compiled from these instructions instead of memory contents, without looking
+	//at breakpoints. Used to compile blocks outside of the emulation thread.
+	void SetInstructionSnapshot(std::vector<uint32>);
 
 	uint32 GetBeginAddress() const;
 	uint32 GetEndAddress() const;
 	bool IsCompiled() const;
 	bool IsEmpty() const;
+	size_t GetCodeSize() const;
 
 	uint32 GetRecycleCount() const;
 	void SetRecycleCount(uint32);
@@ -88,6 +97,13 @@ protected:
 	void CompileEpilog(CMipsJitter*);
 
 private:
+	struct SYMBOL_REFERENCE
+	{
+		uintptr_t symbol;
+		uint32 offset;
+	};
+	typedef std::vector<SYMBOL_REFERENCE> SymbolReferenceArray;
+
 	void HandleExternalFunctionReference(uintptr_t, uint32, Jitter::CCodeGen::SYMBOL_REF_TYPE);
 
 #ifdef DEBUGGER_INCLUDED
@@ -107,6 +123,10 @@ private:
 	void (*m_function)(void*);
 #endif
 	uint32 m_recycleCount = 0;
+	//Only set while compiling a block that will be saved in a block cache
+	SymbolReferenceArray* m_symbolReferences = nullptr;
+	bool m_hasUnrelocatableSymbol = false;
+	std::vector<uint32> m_instructionSnapshot;
 	uint32 m_linkTargetAddress[LINK_SLOT_MAX];
 	uint32 m_linkBlockTrampolineOffset[LINK_SLOT_MAX];
 #ifdef _DEBUG
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+#include "Types.h"
+
+//Keeps a write generation counter for every page of a code memory area.
+//Writers bump the counters of the pages they touch and executors compare the
+//generations they recorded when compiling code to find out if it might have changed.
+class CCodePageTracker
+{
+public:
+	CCodePageTracker(uint32 memorySize, uint32 pageShift)
+	    : m_pageShift(pageShift)
+	    , m_generations((memorySize >> pageShift) + 1, 0)
+	    , m_dirty((memorySize >> pageShift) + 1, false)
+	{
+	}
+
+	void Reset()
+	{
+		std::fill(m_generations.begin(), m_generations.end(), 0);
+		std::fill(m_dirty.begin(), m_dirty.end(), false);
+		m_dirtyPages.clear();
+	}
+
+	uint32 GetPageShift() const
+	{
+		return m_pageShift;
+	}
+
+	//End is exclusive
+	void NotifyWrite(uint32 start, uint32 end)
+	{
+		assert(end > start);
+		uint32 firstPage = start >> m_pageShift;
+		uint32 lastPage = std::min<uint32>((end - 1) >> m_pageShift, static_cast<uint32>(m_generations.size() - 1));
+		for(uint32 page = firstPage; page <= lastPage; page++)
+		{
+			m_generations[page]++;
+			if(!m_dirty[page])
+			{
+				m_dirty[page] = true;
+				m_dirtyPages.push_back(page);
+			}
+		}
+	}
+
+	//Generations only go up, so the sum changes if any page in the range was written to (end is inclusive)
+	uint32 GetRangeGeneration(uint32 start, uint32 end) const
+	{
+		uint32 result = 0;
+		uint32 firstPage = start >> m_pageShift;
+		uint32 lastPage = std::min<uint32>(end >> m_pageShift, static_cast<uint32>(m_generations.size() - 1));
+		for(uint32 page = firstPage; page <= lastPage; page++)
+		{
+			result += m_generations[page];
+		}
+		return result;
+	}
+
+	bool HasDirtyPages() const
+	{
+		return !m_dirtyPages.empty();
+	}
+
+	std::vector<uint32> TakeDirtyPages()
+	{
+		auto result = std::move(m_dirtyPages);
+		m_dirtyPages.clear();
+		for(const auto& page : result)
+		{
+			m_dirty[page] = false;
+		}
+		return result;
+	}
+
+private:
+	uint32 m_pageShift = 0;
+	std::vector<uint32> m_generations;
+	std::vector<bool> m_dirty;
+	std::vector<uint32> m_dirtyPages;
+};
@@ -0,0 +1,370 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+#include "CompressedImageStream.h"
+
+CCompressedImageStream::CCompressedImageStream(Framework::CStream* baseStream)
+    : m_baseStream(baseStream)
+{
+	if(baseStream == nullptr)
+	{
+		throw std::runtime_error("Null base stream supplied.");
+	}
+}
+
+CCompressedImageStream::~CCompressedImageStream()
+{
+	StopWorkers();
+}
+
+void CCompressedImageStream::InitializeBlocks(uint64 totalSize, uint32 blockSize, uint32 blockCount)
+{
+	assert(m_workerThreads.empty());
+	if(blockSize == 0)
+	{
+		throw std::runtime_error("Invalid image block size.");
+	}
+
+	m_totalSize = totalSize;
+	m_blockSize = blockSize;
+	m_blockCount = blockCount;
+	m_batchBlocks = std::max<uint32>(MAX_BATCH_SIZE / blockSize, 1);
+	m_readAheadBlocks = std::max<uint32>(READAHEAD_SIZE / blockSize, 1);
+	m_jobBlocks = std::max<uint32>(JOB_SIZE / blockSize, 1);
+
+	//Make sure blocks that are being loaded never need all the slots
+	m_slotCount = std::max<uint32>(CACHE_SIZE / blockSize, (m_batchBlocks + m_readAheadBlocks) * 2);
+	m_slots = std::make_unique<uint8[]>(static_cast<size_t>(m_slotCount) * blockSize);
+	m_freeSlots.reserve(m_slotCount);
+	for(uint32 slotIndex = m_slotCount; slotIndex != 0; slotIndex--)
+	{
+		m_freeSlots.push_back(slotIndex - 1);
+	}
+
+	uint32 workerCount = std::min<uint32>(std::max<uint32>(std::thread::hardware_concurrency(), 1), MAX_WORKER_COUNT);
+	for(uint32 i = 0; i < workerCount; i++)
+	{
+		m_workerThreads.emplace_back([this]() { WorkerThreadProc(); });
+	}
+}
+
+void CCompressedImageStream::StopWorkers()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_workersEnd = true;
+	}
+	m_jobCondition.notify_all();
+	for(auto& workerThread : m_workerThreads)
+	{
+		workerThread.join();
+	}
+	m_workerThreads.clear();
+}
+
+void CCompressedImageStream::Seek(int64 position, Framework::STREAM_SEEK_DIRECTION origin)
+{
+	switch(origin)
+	{
+	case Framework::STREAM_SEEK_CUR:
+		m_position += position;
+		break;
+	case Framework::STREAM_SEEK_SET:
+		m_position = position;
+		break;
+	case Framework::STREAM_SEEK_END:
+		m_position = m_totalSize + position;
+		break;
+	}
+}
+
+uint64 CCompressedImageStream::Tell()
+{
+	return m_position;
+}
+
+bool CCompressedImageStream::IsEOF()
+{
+	return (m_position >= m_totalSize);
+}
+
+uint64 CCompressedImageStream::Read(void* buffer, uint64 size)
+{
+	uint64 bytesRead = 0;
+	uint8* output = reinterpret_cast<uint8*>(buffer);
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while((size != 0) && !IsEOF())
+	{
+		uint32 block = static_cast<uint32>(m_position / m_blockSize);
+		if(block >= m_blockCount)
+		{
+			throw std::runtime_error("Trying to read past eof.");
+		}
+
+		bool sequential = (block == m_lastBlock) || (block == (m_lastBlock + 1));
+		if(!sequential)
+		{
+			m_readAheadEnd = block;
+		}
+		if(!sequential || (m_blocks.find(block) == std::end(m_blocks)))
+		{
+			//Request everything this read needs at once, workers will decompress it in parallel
+			uint64 endPosition = std::min(m_position + size, m_totalSize);
+			uint32 lastBlock = static_cast<uint32>((endPosition - 1) / m_blockSize);
+			lastBlock = std::min(lastBlock, block + m_batchBlocks - 1);
+			LoadBlocks(block, std::min(lastBlock, m_blockCount - 1), lock);
+		}
+
+		const auto& blockInfo = WaitForBlock(block, lock);
+		uint64 blockPosition = m_position - (static_cast<uint64>(block) * m_blockSize);
+		uint64 sizeToRead = std::min<uint64>(size, m_blockSize - blockPosition);
+		memcpy(output, GetSlot(blockInfo.slotIndex) + blockPosition, static_cast<size_t>(sizeToRead));
+		m_lruBlocks.splice(std::end(m_lruBlocks), m_lruBlocks, blockInfo.lruIterator);
+
+		//Keep blocks ahead of sequential reads in flight, topped up by half windows to batch base stream reads
+		if(sequential && (block != m_lastBlock) && (m_readAheadEnd <= (block + (m_readAheadBlocks / 2))))
+		{
+			uint32 readAheadFirstBlock = std::max(block + 1, m_readAheadEnd);
+			uint32 readAheadLastBlock = std::min(block + m_readAheadBlocks, m_blockCount - 1);
+			if(readAheadFirstBlock <= readAheadLastBlock)
+			{
+				LoadBlocks(readAheadFirstBlock, readAheadLastBlock, lock);
+			}
+			m_readAheadEnd = readAheadLastBlock + 1;
+		}
+		m_lastBlock = block;
+
+		m_position += sizeToRead;
+		size -= sizeToRead;
+		output += sizeToRead;
+		bytesRead += sizeToRead;
+	}
+	return bytesRead;
+}
+
+uint64 CCompressedImageStream::Write(const void* buffer, uint64 size)
+{
+	throw std::runtime_error("Unable to write to compressed image, read only.");
+}
+
+//Loads blocks that aren't already cached or being loaded. Contiguous blocks are read from
+//the base stream at once. Must be called with the mutex locked.
+void CCompressedImageStream::LoadBlocks(uint32 firstBlock, uint32 lastBlock, std::unique_lock<std::mutex>& lock)
+{
+	assert(lastBlock >= firstBlock);
+	uint32 runFirstBlock = firstBlock;
+	std::vector<uint32> runSlotIndices;
+	for(uint32 block = firstBlock; block <= lastBlock; block++)
+	{
+		bool missing = (m_blocks.find(block) == std::end(m_blocks));
+		uint32 slotIndex = 0;
+		if(missing && AllocateSlot(slotIndex))
+		{
+			if(runSlotIndices.empty())
+			{
+				runFirstBlock = block;
+			}
+			auto& blockInfo = m_blocks[block];
+			blockInfo.state = BLOCK_STATE_LOADING;
+			blockInfo.slotIndex = slotIndex;
+			runSlotIndices.push_back(slotIndex);
+			continue;
+		}
+		if(!runSlotIndices.empty())
+		{
+			LoadBlockRun(runFirstBlock, runSlotIndices, lock);
+			runSlotIndices.clear();
+		}
+		//Out of slots, blocks that are being loaded will free some up later
+		if(missing) break;
+	}
+	if(!runSlotIndices.empty())
+	{
+		LoadBlockRun(runFirstBlock, runSlotIndices, lock);
+	}
+}
+
+//Reads the raw data of a run of blocks marked as loading and queues their decompression.
+//Must be called with the mutex locked, it will be released while reading.
+void CCompressedImageStream::LoadBlockRun(uint32 firstBlock, const std::vector<uint32>& slotIndices, std::unique_lock<std::mutex>& lock)
+{
+	uint32 blockCount = static_cast<uint32>(slotIndices.size());
+	auto rawData = std::make_shared<std::vector<uint8>>();
+	uint64 rawStart = ~0ULL;
+	uint64 rawEnd = 0;
+
+	lock.unlock();
+	std::exception_ptr error;
+	try
+	{
+		for(uint32 i = 0; i < blockCount; i++)
+		{
+			auto rawBlock = GetRawBlock(firstBlock + i);
+			if(rawBlock.size == 0) continue;
+			rawStart = std::min(rawStart, rawBlock.position);
+			rawEnd = std::max(rawEnd, rawBlock.position + rawBlock.size);
+		}
+		if(rawEnd > rawStart)
+		{
+			//Last block might be padded past the end of the base stream, leave zeroes there
+			rawData->resize(static_cast<size_t>(rawEnd - rawStart));
+			m_baseStream->Seek(rawStart, Framework::STREAM_SEEK_SET);
+			m_baseStream->Read(rawData->data(), rawData->size());
+		}
+	}
+	catch(...)
+	{
+		error = std::current_exception();
+	}
+	lock.lock();
+
+	if(error)
+	{
+		for(uint32 i = 0; i < blockCount; i++)
+		{
+			auto& blockInfo = m_blocks[firstBlock + i];
+			blockInfo.state = BLOCK_STATE_FAILED;
+			blockInfo.error = error;
+			m_freeSlots.push_back(blockInfo.slotIndex);
+		}
+		m_blockCondition.notify_all();
+		return;
+	}
+
+	for(uint32 jobFirstIndex = 0; jobFirstIndex < blockCount; jobFirstIndex += m_jobBlocks)
+	{
+		uint32 jobBlockCount = std::min(m_jobBlocks, blockCount - jobFirstIndex);
+		JOB job;
+		job.firstBlock = firstBlock + jobFirstIndex;
+		job.slotIndices.assign(slotIndices.begin() + jobFirstIndex, slotIndices.begin() + jobFirstIndex + jobBlockCount);
+		job.rawData = rawData;
+		job.rawDataPosition = rawStart;
+		m_jobs.push_back(std::move(job));
+	}
+	m_jobCondition.notify_all();
+}
+
+//Must be called with the mutex locked
+const CCompressedImageStream::BLOCK& CCompressedImageStream::WaitForBlock(uint32 block, std::unique_lock<std::mutex>& lock)
+{
+	while(1)
+	{
+		auto blockIterator = m_blocks.find(block);
+		if(blockIterator == std::end(m_blocks))
+		{
+			//Evicted before we got to it or no slot was available when it was requested
+			LoadBlocks(block, block, lock);
+			blockIterator = m_blocks.find(block);
+		}
+		if(blockIterator != std::end(m_blocks))
+		{
+			const auto& blockInfo = blockIterator->second;
+			if(blockInfo.state == BLOCK_STATE_READY)
+			{
+				return blockInfo;
+			}
+			if(blockInfo.state == BLOCK_STATE_FAILED)
+			{
+				//Forget about the block, next read will try again
+				auto error = blockInfo.error;
+				m_blocks.erase(blockIterator);
+				std::rethrow_exception(error);
+			}
+		}
+		//Help workers instead of sleeping
+		if(!m_jobs.empty())
+		{
+			auto job = std::move(m_jobs.front());
+			m_jobs.pop_front();
+			lock.unlock();
+			ExecuteJob(job);
+			lock.lock();
+			continue;
+		}
+		m_blockCondition.wait(lock);
+	}
+}
+
+//Must be called with the mutex locked
+bool CCompressedImageStream::AllocateSlot(uint32& slotIndex)
+{
+	if(m_freeSlots.empty())
+	{
+		if(m_lruBlocks.empty()) return false;
+		auto evictedBlockIterator = m_blocks.find(m_lruBlocks.front());
+		assert(evictedBlockIterator != std::end(m_blocks));
+		m_freeSlots.push_back(evictedBlockIterator->second.slotIndex);
+		m_blocks.erase(evictedBlockIterator);
+		m_lruBlocks.pop_front();
+	}
+	slotIndex = m_freeSlots.back();
+	m_freeSlots.pop_back();
+	return true;
+}
+
+uint8* CCompressedImageStream::GetSlot(uint32 slotIndex)
+{
+	assert(slotIndex < m_slotCount);
+	return m_slots.get() + (static_cast<size_t>(slotIndex) * m_blockSize);
+}
+
+//Slots of blocks that are being loaded are only used by the job that loads them
+void CCompressedImageStream::ExecuteJob(const JOB& job)
+{
+	uint32 blockCount = static_cast<uint32>(job.slotIndices.size());
+	std::vector<std::exception_ptr> errors(blockCount);
+	for(uint32 i = 0; i < blockCount; i++)
+	{
+		try
+		{
+			auto rawBlock = GetRawBlock(job.firstBlock + i);
+			uint8* rawData = (rawBlock.size != 0) ? job.rawData->data() + (rawBlock.position - job.rawDataPosition) : nullptr;
+			DecompressBlock(job.firstBlock + i, rawData, rawBlock.size, GetSlot(job.slotIndices[i]));
+		}
+		catch(...)
+		{
+			errors[i] = std::current_exception();
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for(uint32 i = 0; i < blockCount; i++)
+		{
+			auto blockIterator = m_blocks.find(job.firstBlock + i);
+			assert(blockIterator != std::end(m_blocks));
+			auto& blockInfo = blockIterator->second;
+			assert(blockInfo.state == BLOCK_STATE_LOADING);
+			if(errors[i])
+			{
+				blockInfo.state = BLOCK_STATE_FAILED;
+				blockInfo.error = errors[i];
+				m_freeSlots.push_back(blockInfo.slotIndex);
+			}
+			else
+			{
+				blockInfo.state = BLOCK_STATE_READY;
+				blockInfo.lruIterator = m_lruBlocks.insert(std::end(m_lruBlocks), job.firstBlock + i);
+			}
+		}
+	}
+	m_blockCondition.notify_all();
+}
+
+void CCompressedImageStream::WorkerThreadProc()
+{
+	while(1)
+	{
+		JOB job;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_jobCondition.wait(lock, [this]() { return m_workersEnd || !m_jobs.empty(); });
+			if(m_workersEnd) break;
+			job = std::move(m_jobs.front());
+			m_jobs.pop_front();
+		}
+		ExecuteJob(job);
+	}
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "Types.h"
+#include "Stream.h"
+
+//Base for read only disc images made of independently compressed blocks (CSO, ISZ).
+//Decompressed blocks are kept in a LRU cache. Missing blocks are fetched from the base
+//stream in batches of contiguous raw data and decompressed in parallel by a pool of workers.
+//Blocks that follow sequential reads are decompressed ahead of time.
+//The base stream is only used by the thread calling Read.
+class CCompressedImageStream : public Framework::CStream
+{
+public:
+	enum
+	{
+		CACHE_SIZE = 0x1000000,
+		MAX_BATCH_SIZE = 0x100000,
+		READAHEAD_SIZE = 0x80000,
+		JOB_SIZE = 0x10000,
+		MAX_WORKER_COUNT = 4,
+	};
+
+	CCompressedImageStream(Framework::CStream*);
+	virtual ~CCompressedImageStream();
+
+	void Seek(int64, Framework::STREAM_SEEK_DIRECTION) override;
+	uint64 Tell() override;
+	uint64 Read(void*, uint64) override;
+	uint64 Write(const void*, uint64) override;
+	bool IsEOF() override;
+
+protected:
+	struct RAW_BLOCK
+	{
+		uint64 position = 0;
+		uint32 size = 0;
+	};
+
+	//Must be called once derived classes are able to describe their blocks
+	void InitializeBlocks(uint64, uint32, uint32);
+
+	//Must be called by destructors of derived classes, workers use DecompressBlock
+	void StopWorkers();
+
+	virtual RAW_BLOCK GetRawBlock(uint32) const = 0;
+
+	//Called from worker threads, raw data can be modified
+	virtual void DecompressBlock(uint32, uint8*, uint32, uint8*) const = 0;
+
+	Framework::CStream* m_baseStream = nullptr;
+
+private:
+	enum BLOCK_STATE
+	{
+		BLOCK_STATE_LOADING,
+		BLOCK_STATE_READY,
+		BLOCK_STATE_FAILED,
+	};
+
+	typedef std::list<uint32> BlockList;
+	typedef std::shared_ptr<std::vector<uint8>> RawDataPtr;
+
+	struct BLOCK
+	{
+		BLOCK_STATE state = BLOCK_STATE_LOADING;
+		uint32 slotIndex = 0;
+		BlockList::iterator lruIterator;
+		std::exception_ptr error;
+	};
+
+	struct JOB
+	{
+		uint32 firstBlock = 0;
+		std::vector<uint32> slotIndices;
+		RawDataPtr rawData;
+		uint64 rawDataPosition = 0;
+	};
+
+	typedef std::unordered_map<uint32, BLOCK> BlockMap;
+
+	void LoadBlocks(uint32, uint32, std::unique_lock<std::mutex>&);
+	void LoadBlockRun(uint32, const std::vector<uint32>&, std::unique_lock<std::mutex>&);
+	const BLOCK& WaitForBlock(uint32, std::unique_lock<std::mutex>&);
+	bool AllocateSlot(uint32&);
+	uint8* GetSlot(uint32);
+
+	void ExecuteJob(const JOB&);
+	void WorkerThreadProc();
+
+	uint64 m_position = 0;
+	uint64 m_totalSize = 0;
+	uint32 m_blockSize = 0;
+	uint32 m_blockCount = 0;
+	uint32 m_batchBlocks = 0;
+	uint32 m_readAheadBlocks = 0;
+	uint32 m_jobBlocks = 0;
+	uint32 m_lastBlock = ~0U;
+	uint32 m_readAheadEnd = 0;
+
+	std::mutex m_mutex;
+	std::condition_variable m_jobCondition;
+	std::condition_variable m_blockCondition;
+	std::vector<std::thread> m_workerThreads;
+	bool m_workersEnd = false;
+	std::deque<JOB> m_jobs;
+
+	BlockMap m_blocks;
+	BlockList m_lruBlocks;
+	std::unique_ptr<uint8[]> m_slots;
+	std::vector<uint32> m_freeSlots;
+	uint32 m_slotCount = 0;
+};
@@ -8,8 +8,6 @@
 typedef uint32 uint32_le;
 typedef uint64 uint64_le;
 
-static const uint32 CSO_READ_BUFFER_SIZE = 256 * 1024;
-
 struct CsoHeader
 {
 	uint8 magic[4];
@@ -22,25 +20,17 @@ struct CsoHeader
 };
 
 CCsoImageStream::CCsoImageStream(CStream* baseStream)
-    : m_baseStream(baseStream)
-    , m_readBuffer(nullptr)
-    , m_zlibBuffer(nullptr)
+    : CCompressedImageStream(baseStream)
     , m_index(nullptr)
-    , m_position(0)
 {
-	if(baseStream == nullptr)
-	{
-		throw std::runtime_error("Null base stream supplied.");
-	}
-
 	ReadFileHeader();
-	InitializeBuffers();
+	ReadIndex();
+	InitializeBlocks(m_totalSize, m_frameSize, m_frameCount);
 }
 
 CCsoImageStream::~CCsoImageStream()
 {
-	delete[] m_readBuffer;
-	delete[] m_zlibBuffer;
+	StopWorkers();
 	delete[] m_index;
 }
 
@@ -73,34 +63,15 @@ void CCsoImageStream::ReadFileHeader()
 		throw std::runtime_error("CSO frame size must be at least one sector.");
 	}
 
-	// Determine the translation from bytes to frame.
-	m_frameShift = 0;
-	for(uint32 i = m_frameSize; i > 1; i >>= 1)
-	{
-		++m_frameShift;
-	}
-
 	m_indexShift = hdr.align;
 	m_totalSize = hdr.total_bytes;
 }
 
-void CCsoImageStream::InitializeBuffers()
+void CCsoImageStream::ReadIndex()
 {
-	uint32 numFrames = static_cast<uint32>((m_totalSize + m_frameSize - 1) / m_frameSize);
+	m_frameCount = static_cast<uint32>((m_totalSize + m_frameSize - 1) / m_frameSize);
 
-	// We might read a bit of alignment too, so be prepared.
-	if(m_frameSize + (1 << m_indexShift) < CSO_READ_BUFFER_SIZE)
-	{
-		m_readBuffer = new uint8[CSO_READ_BUFFER_SIZE];
-	}
-	else
-	{
-		m_readBuffer = new uint8[m_frameSize + (1 << m_indexShift)];
-	}
-	m_zlibBuffer = new uint8[m_frameSize + (1 << m_indexShift)];
-	m_zlibBufferFrame = numFrames;
-
-	const uint32 indexSize = numFrames + 1;
+	const uint32 indexSize = m_frameCount + 1;
 	m_index = new uint32[indexSize];
 	if(m_baseStream->Read(m_index, sizeof(uint32) * indexSize) != sizeof(uint32) * indexSize)
 	{
@@ -108,105 +79,30 @@ void CCsoImageStream::InitializeBuffers()
 	}
 }
 
-void CCsoImageStream::Seek(int64 position, Framework::STREAM_SEEK_DIRECTION origin)
+CCompressedImageStream::RAW_BLOCK CCsoImageStream::GetRawBlock(uint32 frame) const
 {
-	switch(origin)
-	{
-	case Framework::STREAM_SEEK_CUR:
-		m_position += position;
-		break;
-	case Framework::STREAM_SEEK_SET:
-		m_position = position;
-		break;
-	case Framework::STREAM_SEEK_END:
-		m_position = GetTotalSize() + position;
-		break;
-	}
-}
-
-uint64 CCsoImageStream::Tell()
-{
-	return m_position;
-}
-
-bool CCsoImageStream::IsEOF()
-{
-	return m_position >= GetTotalSize();
-}
-
-uint64 CCsoImageStream::Read(void* buffer, uint64 size)
-{
-	uint64 remaining = size;
-	uint8* dest = reinterpret_cast<uint8*>(buffer);
-
-	// We read only one frame at a time for now.
-	while(remaining > 0 && !IsEOF())
-	{
-		uint32 bytes = ReadFromNextFrame(dest, remaining);
-		remaining -= bytes;
-		m_position += bytes;
-		dest += bytes;
-	}
-
-	return size - remaining;
-}
-
-uint64 CCsoImageStream::Write(const void* buffer, uint64 size)
-{
-	throw std::runtime_error("Unable to write to CSO, read only.");
-}
+	const uint32 index0 = m_index[frame + 0] & 0x7FFFFFFF;
+	const uint32 index1 = m_index[frame + 1] & 0x7FFFFFFF;
 
-uint64 CCsoImageStream::GetTotalSize() const
-{
-	return m_totalSize;
+	// Payload might be followed by alignment padding, we'll read it too.
+	RAW_BLOCK rawBlock;
+	rawBlock.position = static_cast<uint64>(index0) << m_indexShift;
+	rawBlock.size = static_cast<uint32>(static_cast<uint64>(index1 - index0) << m_indexShift);
+	return rawBlock;
 }
 
-uint32 CCsoImageStream::ReadFromNextFrame(uint8* dest, uint64 maxBytes)
+void CCsoImageStream::DecompressBlock(uint32 frame, uint8* rawData, uint32 rawSize, uint8* output) const
 {
-	assert(!IsEOF());
-
-	const uint32 frame = static_cast<uint32>(m_position >> m_frameShift);
-	const uint32 offset = static_cast<uint32>(m_position - (frame << m_frameShift));
-	// This is how many bytes we will actually be reading from this frame.
-	const uint32 bytes = static_cast<uint32>(std::min(maxBytes, static_cast<uint64>(m_frameSize - offset)));
-
-	// Grab the index data for the frame we're about to read.
 	const bool compressed = (m_index[frame + 0] & 0x80000000) == 0;
-	const uint32 index0 = m_index[frame + 0] & 0x7FFFFFFF;
-	const uint32 index1 = m_index[frame + 1] & 0x7FFFFFFF;
-
-	// Calculate where the compressed payload is (if compressed.)
-	const uint64 frameRawPos = static_cast<uint64>(index0) << m_indexShift;
-	const uint64 frameRawSize = (index1 - index0) << m_indexShift;
-
 	if(!compressed)
 	{
-		// Just read directly, easy.
-		if(ReadBaseAt(frameRawPos + offset, dest, bytes) != bytes)
-		{
-			throw std::runtime_error("Unable to read uncompressed bytes from CSO.");
-		}
+		// Just copy directly, easy. Last frame might be shorter.
+		uint32 copySize = std::min(rawSize, m_frameSize);
+		memcpy(output, rawData, copySize);
+		memset(output + copySize, 0, m_frameSize - copySize);
+		return;
 	}
-	else
-	{
-		// We don't need to decompress if we already did this same frame last time.
-		if(m_zlibBufferFrame != frame)
-		{
-			// This might be less bytes than frameRawSize in case of padding on the last frame.
-			// This is because the index positions must be aligned.
-			const uint64 readRawBytes = ReadBaseAt(frameRawPos, m_readBuffer, frameRawSize);
-			DecompressFrame(frame, readRawBytes);
-		}
-
-		// Now we just copy the offset data from the cache.
-		memcpy(dest, m_zlibBuffer + offset, bytes);
-	}
-
-	return bytes;
-}
 
-void CCsoImageStream::DecompressFrame(uint32 frame, uint64 readBufferSize)
-{
 	z_stream z;
 	z.zalloc = Z_NULL;
 	z.zfree = Z_NULL;
@@ -216,9 +112,9 @@ void CCsoImageStream::DecompressFrame(uint32 frame, uint64 readBufferSize)
 		throw std::runtime_error("Unable to initialize zlib for CSO decompression.");
 	}
 
-	z.next_in = m_readBuffer;
-	z.avail_in = static_cast<uint32>(readBufferSize);
-	z.next_out = m_zlibBuffer;
+	z.next_in = rawData;
+	z.avail_in = rawSize;
+	z.next_out = output;
 	z.avail_out = m_frameSize;
 
 	int status = inflate(&z, Z_FINISH);
@@ -228,13 +124,4 @@ void CCsoImageStream::DecompressFrame(uint32 frame, uint64 readBufferSize)
 		throw std::runtime_error("Unable to decompress CSO frame using zlib.");
 	}
 	inflateEnd(&z);
-
-	// Our buffer now contains this frame.
-	m_zlibBufferFrame = frame;
-}
-
-uint64 CCsoImageStream::ReadBaseAt(uint64 pos, uint8* dest, uint64 bytes)
-{
-	m_baseStream->Seek(pos, Framework::STREAM_SEEK_SET);
-	return m_baseStream->Read(dest, bytes);
 }
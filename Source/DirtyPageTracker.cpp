@@ -0,0 +1,54 @@
+#include <cassert>
+#include "DirtyPageTracker.h"
+
+CDirtyPageTracker::CDirtyPageTracker(uint32 size, uint32 pageSize)
+    : m_size(size)
+    , m_pageSize(pageSize)
+    , m_pageCount(size / pageSize)
+    , m_dirtyPages(new std::atomic<bool>[size / pageSize])
+{
+	assert((size & (size - 1)) == 0);
+	assert((size % pageSize) == 0);
+	MarkAllDirty();
+}
+
+uint32 CDirtyPageTracker::GetPageSize() const
+{
+	return m_pageSize;
+}
+
+void CDirtyPageTracker::MarkDirty(uint32 address, uint32 size)
+{
+	if(size == 0) return;
+	if(size >= m_size)
+	{
+		MarkAllDirty();
+		return;
+	}
+	address &= (m_size - 1);
+	uint32 firstPage = address / m_pageSize;
+	uint32 lastPage = (address + size - 1) / m_pageSize;
+	for(uint32 page = firstPage; page <= lastPage; page++)
+	{
+		m_dirtyPages[page % m_pageCount].store(true, std::memory_order_relaxed);
+	}
+}
+
+void CDirtyPageTracker::MarkAllDirty()
+{
+	for(uint32 page = 0; page < m_pageCount; page++)
+	{
+		m_dirtyPages[page].store(true, std::memory_order_relaxed);
+	}
+}
+
+void CDirtyPageTracker::CollectDirtyPages(std::vector<uint32>& pages)
+{
+	for(uint32 page = 0; page < m_pageCount; page++)
+	{
+		if(m_dirtyPages[page].exchange(false, std::memory_order_relaxed))
+		{
+			pages.push_back(page);
+		}
+	}
+}
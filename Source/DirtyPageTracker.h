@@ -0,0 +1,30 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "Types.h"
+
+//Remembers which pages of a memory block were written to, for memory that is only
+//modified by a few known paths (DMA, transfers, etc.) that can mark what they touch.
+//Writers and the collector can live on different threads.
+class CDirtyPageTracker
+{
+public:
+	CDirtyPageTracker(uint32, uint32);
+
+	uint32 GetPageSize() const;
+
+	//Address wraps around the end of the block
+	void MarkDirty(uint32, uint32);
+	void MarkAllDirty();
+
+	//Appends indices of pages written to since the previous call and clears them
+	void CollectDirtyPages(std::vector<uint32>&);
+
+private:
+	uint32 m_size = 0;
+	uint32 m_pageSize = 0;
+	uint32 m_pageCount = 0;
+	std::unique_ptr<std::atomic<bool>[]> m_dirtyPages;
+};
@@ -1,8 +1,21 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <list>
+#include <map>
+#include <set>
+#include <vector>
+#include <unordered_map>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <zlib.h>
 #include "MIPS.h"
 #include "BasicBlock.h"
+#include "CodePageTracker.h"
+#include "JitBlockCache.h"
 
 #include "BlockLookupOneWay.h"
 #include "BlockLookupTwoWay.h"
@@ -31,12 +44,24 @@ public:
 		RECYCLE_NOLINK_THRESHOLD = 16,
 	};
 
+	enum
+	{
+		MAX_BACKGROUND_COMPILE_QUEUE_SIZE = 64,
+	};
+
+	//Granularity of the block index used to find blocks affected by invalidation
+	enum
+	{
+		BLOCK_PAGE_SHIFT = 12,
+	};
+
 	CGenericMipsExecutor(CMIPS& context, uint32 maxAddress)
 	    : m_emptyBlock(std::make_shared<CBasicBlock>(context, MIPS_INVALID_PC, MIPS_INVALID_PC))
 	    , m_context(context)
 	    , m_maxAddress(maxAddress)
 	    , m_addressMask(maxAddress - 1)
 	    , m_blockLookup(m_emptyBlock.get(), maxAddress)
+	    , m_codePageTracker(maxAddress, BLOCK_PAGE_SHIFT)
 	{
 		m_emptyBlock->Compile();
 		assert(!context.m_emptyBlockHandler);
@@ -50,7 +75,10 @@ public:
 		    };
 	}
 
-	virtual ~CGenericMipsExecutor() = default;
+	virtual ~CGenericMipsExecutor()
+	{
+		StopBackgroundCompilation();
+	}
 
 	int Execute(int cycles) override
 	{
@@ -59,6 +87,10 @@ public:
 		m_mustBreak = false;
 		m_initQuota = cycles;
 #endif
+		if(m_codePageTracker.HasDirtyPages())
+		{
+			ValidateDirtyPages();
+		}
 		while(m_context.m_State.nHasException == 0)
 		{
 			uint32 address = m_context.m_State.nPC & m_addressMask;
@@ -84,10 +116,15 @@ public:
 
 	void Reset() override
 	{
+		DiscardBackgroundCompilation();
 		m_blockLookup.Clear();
 		m_blocks.clear();
+		m_blockPages.clear();
+		m_codePageTracker.Reset();
 		m_blockLinks.clear();
 		m_pendingBlockLinks.clear();
+		m_compiledBlockCount = 0;
+		m_cachedBlockCount = 0;
 	}
 
 	void ClearActiveBlocksInRange(uint32 start, uint32 end, bool executing) override
@@ -101,6 +138,47 @@ public:
 		ClearActiveBlocksInRangeInternal(start, end, currentBlock);
 	}
 
+	void NotifyCodeWrite(uint32 start, uint32 end) override
+	{
+		m_codePageTracker.NotifyWrite(start, end);
+	}
+
+	void SetBlockCache(CJitBlockCache* blockCache) override
+	{
+		std::lock_guard<std::mutex> compileLock(m_compileMutex);
+		m_blockCache = blockCache;
+	}
+
+	//When enabled, blocks reachable from newly created blocks are compiled ahead of time
+	//on a worker thread. Only one worker is used per executor since instruction compilers
+	//keep per instruction state and can't compile two blocks at the same time.
+	void SetBackgroundCompilationEnabled(bool enabled) override
+	{
+		if(enabled == m_backgroundCompileThread.joinable()) return;
+		if(enabled)
+		{
+			m_backgroundCompileRunning = true;
+			m_backgroundCompileThread = std::thread([this]() { BackgroundCompileThreadProc(); });
+		}
+		else
+		{
+			StopBackgroundCompilation();
+		}
+	}
+
+	STATS GetStats() const override
+	{
+		STATS stats;
+		stats.compiledBlockCount = m_compiledBlockCount;
+		stats.cachedBlockCount = m_cachedBlockCount;
+		stats.activeBlockCount = static_cast<uint32>(m_blocks.size());
+		for(const auto& blockPair : m_blocks)
+		{
+			stats.activeCodeSize += blockPair.second.block->GetCodeSize();
+		}
+		return stats;
+	}
+
 #ifdef DEBUGGER_INCLUDED
 	bool MustBreak() const override
 	{
@@ -126,8 +204,36 @@ protected:
 		uint32 address;
 	};
 
-	typedef std::list<BasicBlockPtr> BlockList;
-	typedef std::multimap<uint32, BLOCK_LINK> BlockLinkMap;
+	struct PRECOMPILED_BLOCK
+	{
+		BasicBlockPtr block;
+		uint32 checksum = 0;
+	};
+
+	//Guest memory and breakpoints belong to the emulation thread, the background compile
+	//thread only works from instructions captured when the request was queued.
+	struct BACKGROUND_COMPILE_REQUEST
+	{
+		uint32 address = 0;
+		uint32 endAddress = 0;
+		uint32 checksum = 0;
+		std::vector<uint32> instructions;
+	};
+
+	struct BLOCK_INFO
+	{
+		BasicBlockPtr block;
+		uint32 checksum = 0;
+		uint32 codeGeneration = 0;
+	};
+
+	typedef std::unordered_map<CBasicBlock*, BLOCK_INFO> BlockMap;
+	typedef std::unordered_map<uint32, std::vector<CBasicBlock*>> BlockPageMap;
+
+	//Links are indexed by target address, each block's outgoing links are found
+	//through its link slots' target addresses.
+	typedef std::vector<BLOCK_LINK> BlockLinkArray;
+	typedef std::unordered_map<uint32, BlockLinkArray> BlockLinkMap;
 
 	bool HasBlockAt(uint32 address) const
 	{
@@ -139,17 +245,143 @@ protected:
 	{
 		assert(!HasBlockAt(start));
 		auto block = BlockFactory(m_context, start, end);
-		m_blockLookup.AddBlock(block.get());
-		m_blocks.push_back(std::move(block));
+		RegisterBlock(std::move(block));
+	}
+
+	void RegisterBlock(BasicBlockPtr block)
+	{
+		auto blockPtr = block.get();
+		m_blockLookup.AddBlock(blockPtr);
+		uint32 firstPage = blockPtr->GetBeginAddress() >> BLOCK_PAGE_SHIFT;
+		uint32 lastPage = blockPtr->GetEndAddress() >> BLOCK_PAGE_SHIFT;
+		for(uint32 page = firstPage; page <= lastPage; page++)
+		{
+			m_blockPages[page].push_back(blockPtr);
+		}
+		BLOCK_INFO blockInfo;
+		blockInfo.checksum = ComputeBlockChecksum(blockPtr->GetBeginAddress(), blockPtr->GetEndAddress());
+		blockInfo.codeGeneration = m_codePageTracker.GetRangeGeneration(blockPtr->GetBeginAddress(), blockPtr->GetEndAddress());
+		blockInfo.block = std::move(block);
+		m_blocks.emplace(blockPtr, std::move(blockInfo));
+	}
+
+	//Check blocks living in pages that were written to since last execution and
+	//only clear the ones whose code really changed
+	void ValidateDirtyPages()
+	{
+		auto dirtyPages = m_codePageTracker.TakeDirtyPages();
+		std::vector<CBasicBlock*> staleBlocks;
+		for(const auto& page : dirtyPages)
+		{
+			auto pageIterator = m_blockPages.find(page);
+			if(pageIterator == std::end(m_blockPages)) continue;
+			for(const auto& block : pageIterator->second)
+			{
+				auto& blockInfo = m_blocks[block];
+				uint32 codeGeneration = m_codePageTracker.GetRangeGeneration(block->GetBeginAddress(), block->GetEndAddress());
+				if(blockInfo.codeGeneration == codeGeneration) continue;
+				blockInfo.codeGeneration = codeGeneration;
+				if(ComputeBlockChecksum(block->GetBeginAddress(), block->GetEndAddress()) != blockInfo.checksum)
+				{
+					staleBlocks.push_back(block);
+				}
+			}
+		}
+		for(const auto& block : staleBlocks)
+		{
+			//Block might have been removed with a previous one if they overlap
+			if(m_blocks.find(block) == std::end(m_blocks)) continue;
+			ClearActiveBlocksInRangeInternal(block->GetBeginAddress(), block->GetEndAddress(), nullptr);
+		}
+	}
+
+	void RemoveBlock(CBasicBlock* block)
+	{
+		uint32 firstPage = block->GetBeginAddress() >> BLOCK_PAGE_SHIFT;
+		uint32 lastPage = block->GetEndAddress() >> BLOCK_PAGE_SHIFT;
+		for(uint32 page = firstPage; page <= lastPage; page++)
+		{
+			auto pageIterator = m_blockPages.find(page);
+			assert(pageIterator != std::end(m_blockPages));
+			auto& pageBlocks = pageIterator->second;
+			auto blockIterator = std::find(pageBlocks.begin(), pageBlocks.end(), block);
+			assert(blockIterator != std::end(pageBlocks));
+			*blockIterator = pageBlocks.back();
+			pageBlocks.pop_back();
+			if(pageBlocks.empty())
+			{
+				m_blockPages.erase(pageIterator);
+			}
+		}
+		auto blockIterator = m_blocks.find(block);
+		assert(blockIterator != std::end(m_blocks));
+		m_blocks.erase(blockIterator);
+	}
+
+	static bool RemoveBlockLink(BlockLinkMap& blockLinks, uint32 targetAddress, uint32 address, CBasicBlock::LINK_SLOT slot)
+	{
+		auto linksIterator = blockLinks.find(targetAddress);
+		if(linksIterator == std::end(blockLinks)) return false;
+		auto& links = linksIterator->second;
+		auto linkIterator = std::find_if(links.begin(), links.end(),
+		                                 [&](const BLOCK_LINK& link) { return (link.address == address) && (link.slot == slot); });
+		if(linkIterator == std::end(links)) return false;
+		*linkIterator = links.back();
+		links.pop_back();
+		if(links.empty())
+		{
+			blockLinks.erase(linksIterator);
+		}
+		return true;
 	}
 
 	virtual BasicBlockPtr BlockFactory(CMIPS& context, uint32 start, uint32 end)
 	{
+		bool hasBreakpoint = context.HasBreakpointInRange(start, end);
+		if(!hasBreakpoint)
+		{
+			if(auto precompiledBlock = TakePrecompiledBlock(start, end))
+			{
+				return precompiledBlock;
+			}
+		}
 		auto result = std::make_shared<CBasicBlock>(context, start, end);
-		result->Compile();
+		if(m_blockCache && !hasBreakpoint)
+		{
+			CountBlockCompilation(result->CompileWithCache(*m_blockCache, ComputeBlockChecksum(start, end)));
+		}
+		else
+		{
+			result->Compile();
+			CountBlockCompilation(false);
+		}
 		return result;
 	}
 
+	//Blocks can be compiled from the background compile thread, counters are atomic
+	void CountBlockCompilation(bool loadedFromCache)
+	{
+		if(loadedFromCache)
+		{
+			m_cachedBlockCount++;
+		}
+		else
+		{
+			m_compiledBlockCount++;
+		}
+	}
+
+	uint32 ComputeBlockChecksum(uint32 start, uint32 end) const
+	{
+		uint32 checksum = crc32(0, Z_NULL, 0);
+		for(uint32 address = start; address <= end; address += 4)
+		{
+			uint32 opcode = m_context.m_pMemoryMap->GetInstruction(address);
+			checksum = crc32(checksum, reinterpret_cast<const Bytef*>(&opcode), 4);
+		}
+		return checksum;
+	}
+
 	void SetupBlockLinks(uint32 startAddress, uint32 endAddress, uint32 branchAddress)
 	{
 		auto block = m_blockLookup.FindBlockAt(startAddress);
@@ -157,16 +389,16 @@ protected:
 		{
 			uint32 nextBlockAddress = (endAddress + 4) & m_addressMask;
 			block->SetLinkTargetAddress(CBasicBlock::LINK_SLOT_NEXT, nextBlockAddress);
-			auto link = std::make_pair(nextBlockAddress, BLOCK_LINK{CBasicBlock::LINK_SLOT_NEXT, startAddress});
+			auto link = BLOCK_LINK{CBasicBlock::LINK_SLOT_NEXT, startAddress};
 			auto nextBlock = m_blockLookup.FindBlockAt(nextBlockAddress);
 			if(!nextBlock->IsEmpty())
 			{
 				block->LinkBlock(CBasicBlock::LINK_SLOT_NEXT, nextBlock);
-				m_blockLinks.insert(link);
+				m_blockLinks[nextBlockAddress].push_back(link);
 			}
 			else
 			{
-				m_pendingBlockLinks.insert(link);
+				m_pendingBlockLinks[nextBlockAddress].push_back(link);
 			}
 		}
 
@@ -174,39 +406,42 @@ protected:
 		{
 			branchAddress &= m_addressMask;
 			block->SetLinkTargetAddress(CBasicBlock::LINK_SLOT_BRANCH, branchAddress);
-			auto link = std::make_pair(branchAddress, BLOCK_LINK{CBasicBlock::LINK_SLOT_BRANCH, startAddress});
+			auto link = BLOCK_LINK{CBasicBlock::LINK_SLOT_BRANCH, startAddress};
 			auto branchBlock = m_blockLookup.FindBlockAt(branchAddress);
 			if(!branchBlock->IsEmpty())
 			{
 				block->LinkBlock(CBasicBlock::LINK_SLOT_BRANCH, branchBlock);
-				m_blockLinks.insert(link);
+				m_blockLinks[branchAddress].push_back(link);
 			}
 			else
 			{
-				m_pendingBlockLinks.insert(link);
+				m_pendingBlockLinks[branchAddress].push_back(link);
 			}
 		}
 
-		//Resolve any block links that could be valid now that block has been created
+		ResolvePendingBlockLinks(block);
+	}
+
+	//Resolve any block links that could be valid now that block has been created
+	void ResolvePendingBlockLinks(CBasicBlock* block)
+	{
+		uint32 startAddress = block->GetBeginAddress();
+		auto pendingLinksIterator = m_pendingBlockLinks.find(startAddress);
+		if(pendingLinksIterator == std::end(m_pendingBlockLinks)) return;
+		for(const auto& blockLink : pendingLinksIterator->second)
 		{
-			auto lowerBound = m_pendingBlockLinks.lower_bound(startAddress);
-			auto upperBound = m_pendingBlockLinks.upper_bound(startAddress);
-			for(auto blockLinkIterator = lowerBound; blockLinkIterator != upperBound; blockLinkIterator++)
-			{
-				const auto& blockLink = blockLinkIterator->second;
-				auto referringBlock = m_blockLookup.FindBlockAt(blockLink.address);
-				if(referringBlock->IsEmpty()) continue;
-				referringBlock->LinkBlock(blockLink.slot, block);
-				m_blockLinks.insert(*blockLinkIterator);
-			}
-			m_pendingBlockLinks.erase(lowerBound, upperBound);
+			auto referringBlock = m_blockLookup.FindBlockAt(blockLink.address);
+			if(referringBlock->IsEmpty()) continue;
+			referringBlock->LinkBlock(blockLink.slot, block);
+			m_blockLinks[startAddress].push_back(blockLink);
 		}
+		m_pendingBlockLinks.erase(pendingLinksIterator);
 	}
 
-	virtual void PartitionFunction(uint32 startAddress)
+	void FindBlockBounds(uint32 startAddress, uint32& endAddress, uint32& branchAddress) const
 	{
-		uint32 endAddress = startAddress + MAX_BLOCK_SIZE;
-		uint32 branchAddress = 0;
+		endAddress = startAddress + MAX_BLOCK_SIZE;
+		branchAddress = 0;
 		for(uint32 address = startAddress; address < endAddress; address += 4)
 		{
 			uint32 opcode = m_context.m_pMemoryMap->GetInstruction(address);
@@ -224,13 +459,144 @@ protected:
 			}
 		}
 		assert((endAddress - startAddress) <= MAX_BLOCK_SIZE);
-		assert(endAddress <= m_maxAddress);
-		CreateBlock(startAddress, endAddress);
+	}
+
+	virtual void PartitionFunction(uint32 startAddress)
+	{
+		uint32 endAddress = 0;
+		uint32 branchAddress = 0;
+		{
+			std::lock_guard<std::mutex> compileLock(m_compileMutex);
+			FindBlockBounds(startAddress, endAddress, branchAddress);
+			assert(endAddress <= m_maxAddress);
+			CreateBlock(startAddress, endAddress);
+		}
 		auto block = FindBlockStartingAt(startAddress);
 		if(block->GetRecycleCount() < RECYCLE_NOLINK_THRESHOLD)
 		{
 			SetupBlockLinks(startAddress, endAddress, branchAddress);
 		}
+		if(m_backgroundCompileThread.joinable())
+		{
+			QueueBackgroundCompile(endAddress + 4);
+			if(branchAddress != 0)
+			{
+				QueueBackgroundCompile(branchAddress);
+			}
+		}
+	}
+
+	void QueueBackgroundCompile(uint32 address)
+	{
+		address &= m_addressMask;
+		if(address >= m_maxAddress) return;
+		if(HasBlockAt(address)) return;
+		{
+			std::lock_guard<std::mutex> queueLock(m_backgroundQueueMutex);
+			if(m_backgroundQueue.size() >= MAX_BACKGROUND_COMPILE_QUEUE_SIZE) return;
+			if(m_backgroundPendingAddresses.find(address) != std::end(m_backgroundPendingAddresses)) return;
+			if(m_precompiledBlocks.find(address) != std::end(m_precompiledBlocks)) return;
+		}
+
+		BACKGROUND_COMPILE_REQUEST request;
+		request.address = address;
+		uint32 branchAddress = 0;
+		FindBlockBounds(address, request.endAddress, branchAddress);
+		if(request.endAddress > m_maxAddress) return;
+		//Blocks with breakpoints are never taken from the background compile thread
+		if(m_context.HasBreakpointInRange(address, request.endAddress)) return;
+		request.instructions.reserve(((request.endAddress - address) / 4) + 1);
+		for(uint32 instructionAddress = address; instructionAddress <= request.endAddress; instructionAddress += 4)
+		{
+			request.instructions.push_back(m_context.m_pMemoryMap->GetInstruction(instructionAddress));
+		}
+		request.checksum = crc32(0, reinterpret_cast<const Bytef*>(request.instructions.data()), static_cast<uInt>(request.instructions.size() * 4));
+
+		//Only this thread adds requests, address can't have been queued in the meantime
+		std::lock_guard<std::mutex> queueLock(m_backgroundQueueMutex);
+		m_backgroundPendingAddresses.insert(address);
+		m_backgroundQueue.push_back(std::move(request));
+		m_backgroundQueueCondition.notify_one();
+	}
+
+	//Returns a block compiled by the background thread if its code still matches memory contents
+	BasicBlockPtr TakePrecompiledBlock(uint32 start, uint32 end)
+	{
+		PRECOMPILED_BLOCK precompiledBlock;
+		{
+			std::lock_guard<std::mutex> queueLock(m_backgroundQueueMutex);
+			auto precompiledBlockIterator = m_precompiledBlocks.find(start);
+			if(precompiledBlockIterator == std::end(m_precompiledBlocks)) return BasicBlockPtr();
+			precompiledBlock = std::move(precompiledBlockIterator->second);
+			m_precompiledBlocks.erase(precompiledBlockIterator);
+		}
+		if(precompiledBlock.block->GetEndAddress() != end) return BasicBlockPtr();
+		if(ComputeBlockChecksum(start, end) != precompiledBlock.checksum) return BasicBlockPtr();
+		return precompiledBlock.block;
+	}
+
+	void DiscardBackgroundCompilation()
+	{
+		std::lock_guard<std::mutex> queueLock(m_backgroundQueueMutex);
+		m_backgroundQueue.clear();
+		m_backgroundPendingAddresses.clear();
+		m_precompiledBlocks.clear();
+		m_backgroundGeneration++;
+	}
+
+	void StopBackgroundCompilation()
+	{
+		if(!m_backgroundCompileThread.joinable()) return;
+		{
+			std::lock_guard<std::mutex> queueLock(m_backgroundQueueMutex);
+			m_backgroundCompileRunning = false;
+			m_backgroundQueueCondition.notify_one();
+		}
+		m_backgroundCompileThread.join();
+		DiscardBackgroundCompilation();
+	}
+
+	void BackgroundCompileThreadProc()
+	{
+		while(1)
+		{
+			BACKGROUND_COMPILE_REQUEST request;
+			uint32 generation = 0;
+			{
+				std::unique_lock<std::mutex> queueLock(m_backgroundQueueMutex);
+				m_backgroundQueueCondition.wait(queueLock, [this]() { return !m_backgroundCompileRunning || !m_backgroundQueue.empty(); });
+				if(!m_backgroundCompileRunning) break;
+				request = std::move(m_backgroundQueue.front());
+				m_backgroundQueue.pop_front();
+				generation = m_backgroundGeneration;
+			}
+
+			//Code might have been modified since the request was queued, TakePrecompiledBlock
+			//checks the checksum against memory contents before using the block.
+			PRECOMPILED_BLOCK precompiledBlock;
+			precompiledBlock.checksum = request.checksum;
+			precompiledBlock.block = std::make_shared<CBasicBlock>(m_context, request.address, request.endAddress);
+			precompiledBlock.block->SetInstructionSnapshot(std::move(request.instructions));
+			{
+				std::lock_guard<std::mutex> compileLock(m_compileMutex);
+				if(m_blockCache)
+				{
+					CountBlockCompilation(precompiledBlock.block->CompileWithCache(*m_blockCache, request.checksum));
+				}
+				else
+				{
+					precompiledBlock.block->Compile();
+					CountBlockCompilation(false);
+				}
+			}
+
+			{
+				std::lock_guard<std::mutex> queueLock(m_backgroundQueueMutex);
+				m_backgroundPendingAddresses.erase(request.address);
+				if(generation != m_backgroundGeneration) continue;
+				m_precompiledBlocks[request.address] = std::move(precompiledBlock);
+			}
+		}
 	}
 
 	//Unlink and removes block from all of our bookkeeping structures
@@ -238,27 +604,20 @@ protected:
 	{
 		auto orphanBlockLinkSlot =
 		    [&](CBasicBlock::LINK_SLOT linkSlot) {
-			    auto slotSearch =
-			        [&](const std::pair<uint32, BLOCK_LINK>& link) {
-				        return (link.second.address == block->GetBeginAddress()) &&
-				               (link.second.slot == linkSlot);
-			        };
 			    uint32 linkTargetAddress = block->GetLinkTargetAddress(linkSlot);
 			    //Check if block has this specific link slot
 			    if(linkTargetAddress != MIPS_INVALID_PC)
 			    {
 				    //If it has that link slot, it's either linked or pending to be linked
-				    auto slotIterator = std::find_if(m_blockLinks.begin(), m_blockLinks.end(), slotSearch);
-				    if(slotIterator != std::end(m_blockLinks))
+				    if(RemoveBlockLink(m_blockLinks, linkTargetAddress, block->GetBeginAddress(), linkSlot))
 				    {
 					    block->UnlinkBlock(linkSlot);
-					    m_blockLinks.erase(slotIterator);
 				    }
 				    else
 				    {
-					    slotIterator = std::find_if(m_pendingBlockLinks.begin(), m_pendingBlockLinks.end(), slotSearch);
-					    assert(slotIterator != std::end(m_pendingBlockLinks));
-					    m_pendingBlockLinks.erase(slotIterator);
+					    bool removed = RemoveBlockLink(m_pendingBlockLinks, linkTargetAddress, block->GetBeginAddress(), linkSlot);
+					    assert(removed);
+					    (void)removed;
 				    }
 			    }
 			    block->SetLinkTargetAddress(linkSlot, MIPS_INVALID_PC);
@@ -269,19 +628,26 @@ protected:
 
 	void ClearActiveBlocksInRangeInternal(uint32 start, uint32 end, CBasicBlock* protectedBlock)
 	{
-		//Widen scan range since blocks starting before the range can end in the range
-		uint32 scanStart = static_cast<uint32>(std::max<int64>(0, static_cast<uint64>(start) - MAX_BLOCK_SIZE));
-		uint32 scanEnd = end;
-		assert(scanEnd > scanStart);
+		assert(end > start);
 
+		//Blocks are indexed in every page they overlap, no need to widen the range
 		std::set<CBasicBlock*> clearedBlocks;
-		for(uint32 address = scanStart; address < scanEnd; address += instructionSize)
+		uint32 firstPage = start >> BLOCK_PAGE_SHIFT;
+		uint32 lastPage = end >> BLOCK_PAGE_SHIFT;
+		for(uint32 page = firstPage; page <= lastPage; page++)
+		{
+			auto pageIterator = m_blockPages.find(page);
+			if(pageIterator == std::end(m_blockPages)) continue;
+			for(const auto& block : pageIterator->second)
+			{
+				if(block == protectedBlock) continue;
+				if(!RangesOverlap(block->GetBeginAddress(), block->GetEndAddress(), start, end)) continue;
+				clearedBlocks.insert(block);
+			}
+		}
+
+		for(auto& block : clearedBlocks)
 		{
-			auto block = m_blockLookup.FindBlockAt(address);
-			if(block->IsEmpty()) continue;
-			if(block == protectedBlock) continue;
-			if(!RangesOverlap(block->GetBeginAddress(), block->GetEndAddress(), start, end)) continue;
-			clearedBlocks.insert(block);
 			m_blockLookup.DeleteBlock(block);
 		}
 
@@ -294,34 +660,51 @@ protected:
 		//Undo all stale links
 		for(auto& block : clearedBlocks)
 		{
-			auto lowerBound = m_blockLinks.lower_bound(block->GetBeginAddress());
-			auto upperBound = m_blockLinks.upper_bound(block->GetBeginAddress());
-			for(auto blockLinkIterator = lowerBound; blockLinkIterator != upperBound; blockLinkIterator++)
+			auto blockLinksIterator = m_blockLinks.find(block->GetBeginAddress());
+			if(blockLinksIterator == std::end(m_blockLinks)) continue;
+			for(const auto& blockLink : blockLinksIterator->second)
 			{
-				const auto& blockLink = blockLinkIterator->second;
 				auto referringBlock = m_blockLookup.FindBlockAt(blockLink.address);
 				if(referringBlock->IsEmpty()) continue;
 				referringBlock->UnlinkBlock(blockLink.slot);
-				m_pendingBlockLinks.insert(*blockLinkIterator);
+				m_pendingBlockLinks[blockLinksIterator->first].push_back(blockLink);
 			}
-			m_blockLinks.erase(lowerBound, upperBound);
+			m_blockLinks.erase(blockLinksIterator);
 		}
 
-		if(!clearedBlocks.empty())
+		for(auto& block : clearedBlocks)
 		{
-			m_blocks.remove_if([&](const BasicBlockPtr& block) { return clearedBlocks.find(block.get()) != std::end(clearedBlocks); });
+			RemoveBlock(block);
 		}
 	}
 
-	BlockList m_blocks;
+	BlockMap m_blocks;
+	BlockPageMap m_blockPages;
 	BasicBlockPtr m_emptyBlock;
 	BlockLinkMap m_blockLinks;
 	BlockLinkMap m_pendingBlockLinks;
 	CMIPS& m_context;
+	CJitBlockCache* m_blockCache = nullptr;
 	uint32 m_maxAddress = 0;
 	uint32 m_addressMask = 0;
 
 	BlockLookupType m_blockLookup;
+	CCodePageTracker m_codePageTracker;
+
+	//Guards instruction compilers and block cache, which are shared with the background compile thread
+	std::mutex m_compileMutex;
+
+	std::thread m_backgroundCompileThread;
+	std::mutex m_backgroundQueueMutex;
+	std::condition_variable m_backgroundQueueCondition;
+	std::deque<BACKGROUND_COMPILE_REQUEST> m_backgroundQueue;
+	std::set<uint32> m_backgroundPendingAddresses;
+	std::map<uint32, PRECOMPILED_BLOCK> m_precompiledBlocks;
+	uint32 m_backgroundGeneration = 0;
+	bool m_backgroundCompileRunning = false;
+
+	std::atomic<uint32> m_compiledBlockCount = {0};
+	std::atomic<uint32> m_cachedBlockCount = {0};
 
 #ifdef DEBUGGER_INCLUDED
 	bool m_mustBreak = false;
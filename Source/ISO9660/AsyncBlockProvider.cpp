@@ -0,0 +1,251 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include "AsyncBlockProvider.h"
+
+using namespace ISO9660;
+
+static const uint32 g_chunkSize = CAsyncBlockProvider::CHUNK_BLOCKS * static_cast<uint32>(CBlockProvider::BLOCKSIZE);
+
+CAsyncBlockProvider::CAsyncBlockProvider(const BlockProviderPtr& blockProvider, uint32 cacheChunkCount)
+    : m_blockProvider(blockProvider)
+    , m_slotCount(cacheChunkCount)
+{
+	assert(m_slotCount != 0);
+	m_slots = std::make_unique<uint8[]>(static_cast<size_t>(m_slotCount) * g_chunkSize);
+	m_freeSlots.reserve(m_slotCount);
+	for(uint32 slotIndex = m_slotCount; slotIndex != 0; slotIndex--)
+	{
+		m_freeSlots.push_back(slotIndex - 1);
+	}
+	m_workerThread = std::thread([this]() { WorkerThreadProc(); });
+}
+
+CAsyncBlockProvider::~CAsyncBlockProvider()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_workerEnd = true;
+	}
+	m_workerCondition.notify_one();
+	m_workerThread.join();
+}
+
+void CAsyncBlockProvider::ReadBlock(uint32 address, void* block)
+{
+	ReadBlocks(address, 1, block);
+}
+
+void CAsyncBlockProvider::ReadBlocks(uint32 address, uint32 count, void* blocks)
+{
+	if(count == 0) return;
+
+	auto output = reinterpret_cast<uint8*>(blocks);
+	uint32 endAddress = address + count;
+	uint32 firstChunk = address / CHUNK_BLOCKS;
+	uint32 lastChunk = (endAddress - 1) / CHUNK_BLOCKS;
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	RequestChunks(firstChunk, lastChunk, true);
+
+	//Reads that continue the previous one are likely to be followed by other ones, read ahead
+	//more and more blocks as long as this goes on
+	if(address == m_sequentialEnd)
+	{
+		m_readAheadBlocks = std::min<uint32>(std::max<uint32>(m_readAheadBlocks * 2, READAHEAD_MIN_BLOCKS), READAHEAD_MAX_BLOCKS);
+		uint32 readAheadLastChunk = (endAddress + m_readAheadBlocks - 1) / CHUNK_BLOCKS;
+		if(readAheadLastChunk > lastChunk)
+		{
+			RequestChunks(lastChunk + 1, readAheadLastChunk, false);
+		}
+	}
+	else
+	{
+		m_readAheadBlocks = 0;
+	}
+	m_sequentialEnd = endAddress;
+
+	for(uint32 chunkIndex = firstChunk; chunkIndex <= lastChunk; chunkIndex++)
+	{
+		uint32 chunkAddress = chunkIndex * CHUNK_BLOCKS;
+		uint32 copyBegin = std::max(address, chunkAddress);
+		uint32 copyEnd = std::min(endAddress, chunkAddress + CHUNK_BLOCKS);
+		while(1)
+		{
+			auto chunkIterator = m_chunks.find(chunkIndex);
+			if(chunkIterator == std::end(m_chunks))
+			{
+				//Chunk was evicted before we got to it (read is bigger than the cache)
+				RequestChunks(chunkIndex, chunkIndex, true);
+				continue;
+			}
+			auto& chunk = chunkIterator->second;
+			if(chunk.state == CHUNK_STATE_READY)
+			{
+				memcpy(output + ((copyBegin - address) * BLOCKSIZE),
+				       GetSlot(chunk.slotIndex) + ((copyBegin - chunkAddress) * BLOCKSIZE),
+				       (copyEnd - copyBegin) * BLOCKSIZE);
+				m_lruChunks.splice(std::end(m_lruChunks), m_lruChunks, chunk.lruIterator);
+				break;
+			}
+			if(chunk.state == CHUNK_STATE_FAILED)
+			{
+				//Forget about the chunk, next read will try again
+				auto error = chunk.error;
+				m_chunks.erase(chunkIterator);
+				std::rethrow_exception(error);
+			}
+			m_chunkCondition.wait(lock);
+		}
+	}
+}
+
+void CAsyncBlockProvider::PrefetchBlocks(uint32 address, uint32 count)
+{
+	if(count == 0) return;
+	std::lock_guard<std::mutex> lock(m_mutex);
+	RequestChunks(address / CHUNK_BLOCKS, (address + count - 1) / CHUNK_BLOCKS, false);
+}
+
+//Chunks that are needed right away are put at the front of the queue, in order, other
+//ones are put at the back. Must be called with the mutex locked.
+void CAsyncBlockProvider::RequestChunks(uint32 firstChunk, uint32 lastChunk, bool needed)
+{
+	assert(lastChunk >= firstChunk);
+	if(needed)
+	{
+		for(uint32 chunkIndex = lastChunk + 1; chunkIndex != firstChunk; chunkIndex--)
+		{
+			uint32 requestedChunk = chunkIndex - 1;
+			auto chunkIterator = m_chunks.find(requestedChunk);
+			if(chunkIterator == std::end(m_chunks))
+			{
+				m_chunks.emplace(requestedChunk, CHUNK());
+			}
+			else if(chunkIterator->second.state == CHUNK_STATE_QUEUED)
+			{
+				auto queueIterator = std::find(m_queue.begin(), m_queue.end(), requestedChunk);
+				assert(queueIterator != std::end(m_queue));
+				m_queue.erase(queueIterator);
+			}
+			else
+			{
+				continue;
+			}
+			m_queue.push_front(requestedChunk);
+		}
+	}
+	else
+	{
+		//Don't let prefetching evict more than half of the cache
+		lastChunk = std::min(lastChunk, firstChunk + (m_slotCount / 2));
+		for(uint32 chunkIndex = firstChunk; chunkIndex <= lastChunk; chunkIndex++)
+		{
+			if(m_chunks.find(chunkIndex) != std::end(m_chunks)) continue;
+			m_chunks.emplace(chunkIndex, CHUNK());
+			m_queue.push_back(chunkIndex);
+		}
+	}
+	m_workerCondition.notify_one();
+}
+
+//Must be called with the mutex locked
+void CAsyncBlockProvider::CompleteChunk(uint32 chunkIndex, const uint8* data)
+{
+	if(m_freeSlots.empty())
+	{
+		assert(!m_lruChunks.empty());
+		auto evictedChunkIterator = m_chunks.find(m_lruChunks.front());
+		assert(evictedChunkIterator != std::end(m_chunks));
+		m_freeSlots.push_back(evictedChunkIterator->second.slotIndex);
+		m_chunks.erase(evictedChunkIterator);
+		m_lruChunks.pop_front();
+	}
+
+	auto chunkIterator = m_chunks.find(chunkIndex);
+	assert(chunkIterator != std::end(m_chunks));
+	auto& chunk = chunkIterator->second;
+	assert(chunk.state == CHUNK_STATE_LOADING);
+	chunk.state = CHUNK_STATE_READY;
+	chunk.slotIndex = m_freeSlots.back();
+	chunk.lruIterator = m_lruChunks.insert(std::end(m_lruChunks), chunkIndex);
+	m_freeSlots.pop_back();
+	memcpy(GetSlot(chunk.slotIndex), data, g_chunkSize);
+}
+
+//Must be called with the mutex locked
+void CAsyncBlockProvider::FailChunk(uint32 chunkIndex, std::exception_ptr error)
+{
+	auto chunkIterator = m_chunks.find(chunkIndex);
+	assert(chunkIterator != std::end(m_chunks));
+	auto& chunk = chunkIterator->second;
+	assert(chunk.state == CHUNK_STATE_LOADING);
+	chunk.state = CHUNK_STATE_FAILED;
+	chunk.error = error;
+}
+
+uint8* CAsyncBlockProvider::GetSlot(uint32 slotIndex)
+{
+	assert(slotIndex < m_slotCount);
+	return m_slots.get() + (static_cast<size_t>(slotIndex) * g_chunkSize);
+}
+
+void CAsyncBlockProvider::WorkerThreadProc()
+{
+	std::vector<uint8> buffer(MAX_READ_CHUNKS * g_chunkSize);
+
+	auto readChunks =
+	    [&](uint32 firstChunk, uint32 chunkCount) {
+		    //Some providers leave blocks past the end of the image untouched
+		    memset(buffer.data(), 0, chunkCount * g_chunkSize);
+		    m_blockProvider->ReadBlocks(firstChunk * CHUNK_BLOCKS, chunkCount * CHUNK_BLOCKS, buffer.data());
+		    std::lock_guard<std::mutex> lock(m_mutex);
+		    for(uint32 i = 0; i < chunkCount; i++)
+		    {
+			    CompleteChunk(firstChunk + i, buffer.data() + (i * g_chunkSize));
+		    }
+	    };
+
+	while(1)
+	{
+		uint32 firstChunk = 0;
+		uint32 chunkCount = 0;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_workerCondition.wait(lock, [this]() { return m_workerEnd || !m_queue.empty(); });
+			if(m_workerEnd) break;
+
+			//Gather chunks that follow the first one to read them all at once
+			firstChunk = m_queue.front();
+			while(!m_queue.empty() && (chunkCount < MAX_READ_CHUNKS) && (m_queue.front() == (firstChunk + chunkCount)))
+			{
+				m_chunks[m_queue.front()].state = CHUNK_STATE_LOADING;
+				m_queue.pop_front();
+				chunkCount++;
+			}
+		}
+
+		try
+		{
+			readChunks(firstChunk, chunkCount);
+		}
+		catch(...)
+		{
+			//Try chunks one by one to only fail those that can't be read
+			for(uint32 i = 0; i < chunkCount; i++)
+			{
+				try
+				{
+					readChunks(firstChunk + i, 1);
+				}
+				catch(...)
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					FailChunk(firstChunk + i, std::current_exception());
+				}
+			}
+		}
+
+		m_chunkCondition.notify_all();
+	}
+}
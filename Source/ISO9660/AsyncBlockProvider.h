@@ -0,0 +1,87 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "BlockProvider.h"
+
+namespace ISO9660
+{
+	//Serves blocks from a LRU cache filled by a worker thread. The cache is made of chunks of
+	//several blocks, chunks that are contiguous are read with a single request to the underlying
+	//provider. Sequential reads are detected and the blocks that follow them are read ahead.
+	//The underlying provider is only used by the worker thread, this provider can be used from
+	//any thread. Blocks are always copied from the cache, never written by system calls.
+	class CAsyncBlockProvider : public CBlockProvider
+	{
+	public:
+		typedef std::shared_ptr<CBlockProvider> BlockProviderPtr;
+
+		enum
+		{
+			CHUNK_BLOCKS = 16,
+			DEFAULT_CACHE_CHUNKS = 512,
+			MAX_READ_CHUNKS = 32,
+			READAHEAD_MIN_BLOCKS = 64,
+			READAHEAD_MAX_BLOCKS = 1024,
+		};
+
+		CAsyncBlockProvider(const BlockProviderPtr&, uint32 = DEFAULT_CACHE_CHUNKS);
+		virtual ~CAsyncBlockProvider();
+
+		void ReadBlock(uint32, void*) override;
+		void ReadBlocks(uint32, uint32, void*) override;
+		void PrefetchBlocks(uint32, uint32) override;
+
+	private:
+		enum CHUNK_STATE
+		{
+			CHUNK_STATE_QUEUED,
+			CHUNK_STATE_LOADING,
+			CHUNK_STATE_READY,
+			CHUNK_STATE_FAILED,
+		};
+
+		typedef std::list<uint32> ChunkList;
+
+		struct CHUNK
+		{
+			CHUNK_STATE state = CHUNK_STATE_QUEUED;
+			uint32 slotIndex = 0;
+			ChunkList::iterator lruIterator;
+			std::exception_ptr error;
+		};
+
+		typedef std::unordered_map<uint32, CHUNK> ChunkMap;
+
+		void RequestChunks(uint32, uint32, bool);
+		void CompleteChunk(uint32, const uint8*);
+		void FailChunk(uint32, std::exception_ptr);
+		uint8* GetSlot(uint32);
+
+		void WorkerThreadProc();
+
+		BlockProviderPtr m_blockProvider;
+
+		std::mutex m_mutex;
+		std::condition_variable m_workerCondition;
+		std::condition_variable m_chunkCondition;
+		std::thread m_workerThread;
+		bool m_workerEnd = false;
+
+		ChunkMap m_chunks;
+		std::deque<uint32> m_queue;
+		ChunkList m_lruChunks;
+		std::unique_ptr<uint8[]> m_slots;
+		std::vector<uint32> m_freeSlots;
+		uint32 m_slotCount = 0;
+
+		uint32 m_sequentialEnd = 0;
+		uint32 m_readAheadBlocks = 0;
+	};
+}
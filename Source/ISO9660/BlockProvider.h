@@ -1,6 +1,8 @@
 #pragma once
 
+#include <cstring>
 #include <memory>
+#include <vector>
 #include "Types.h"
 #include "Stream.h"
 
@@ -16,6 +18,21 @@ namespace ISO9660
 
 		virtual ~CBlockProvider() = default;
 		virtual void ReadBlock(uint32, void*) = 0;
+
+		//Providers can override this to read contiguous blocks with a single request
+		virtual void ReadBlocks(uint32 address, uint32 count, void* blocks)
+		{
+			auto output = reinterpret_cast<uint8*>(blocks);
+			for(uint32 i = 0; i < count; i++)
+			{
+				ReadBlock(address + i, output + (i * BLOCKSIZE));
+			}
+		}
+
+		//Hint that blocks will be read soon
+		virtual void PrefetchBlocks(uint32, uint32)
+		{
+		}
 	};
 
 	class CBlockProvider2048 : public CBlockProvider
@@ -35,6 +52,18 @@ namespace ISO9660
 			m_stream->Read(block, BLOCKSIZE);
 		}
 
+		void ReadBlocks(uint32 address, uint32 count, void* blocks) override
+		{
+			uint64 size = static_cast<uint64>(count) * BLOCKSIZE;
+			m_stream->Seek(static_cast<uint64>(address + m_offset) * BLOCKSIZE, Framework::STREAM_SEEK_SET);
+			uint64 readSize = m_stream->Read(blocks, size);
+			//Blocks past the end of the image read as zeroes
+			if(readSize < size)
+			{
+				memset(reinterpret_cast<uint8*>(blocks) + readSize, 0, size - readSize);
+			}
+		}
+
 	private:
 		StreamPtr m_stream;
 		uint32 m_offset = 0;
@@ -56,6 +85,20 @@ namespace ISO9660
 			m_stream->Read(block, BLOCKSIZE);
 		}
 
+		void ReadBlocks(uint32 address, uint32 count, void* blocks) override
+		{
+			uint64 size = static_cast<uint64>(count) * INTERNAL_BLOCKSIZE;
+			m_buffer.resize(size);
+			m_stream->Seek(static_cast<uint64>(address) * INTERNAL_BLOCKSIZE, Framework::STREAM_SEEK_SET);
+			uint64 readSize = m_stream->Read(m_buffer.data(), size);
+			memset(m_buffer.data() + readSize, 0, size - readSize);
+			auto output = reinterpret_cast<uint8*>(blocks);
+			for(uint32 i = 0; i < count; i++)
+			{
+				memcpy(output + (i * BLOCKSIZE), m_buffer.data() + (i * INTERNAL_BLOCKSIZE) + BLOCKHEADER_SIZE, BLOCKSIZE);
+			}
+		}
+
 	private:
 		enum
 		{
@@ -64,5 +107,38 @@ namespace ISO9660
 		};
 
 		StreamPtr m_stream;
+		std::vector<uint8> m_buffer;
+	};
+
+	//Exposes the blocks of another provider starting at a given address (ie.: second layer of a DVD)
+	class CBlockProviderOffset : public CBlockProvider
+	{
+	public:
+		typedef std::shared_ptr<CBlockProvider> BlockProviderPtr;
+
+		CBlockProviderOffset(const BlockProviderPtr& blockProvider, uint32 offset)
+		    : m_blockProvider(blockProvider)
+		    , m_offset(offset)
+		{
+		}
+
+		void ReadBlock(uint32 address, void* block) override
+		{
+			m_blockProvider->ReadBlock(address + m_offset, block);
+		}
+
+		void ReadBlocks(uint32 address, uint32 count, void* blocks) override
+		{
+			m_blockProvider->ReadBlocks(address + m_offset, count, blocks);
+		}
+
+		void PrefetchBlocks(uint32 address, uint32 count) override
+		{
+			m_blockProvider->PrefetchBlocks(address + m_offset, count);
+		}
+
+	private:
+		BlockProviderPtr m_blockProvider;
+		uint32 m_offset = 0;
 	};
 }
@@ -1,5 +1,6 @@
 #include <string.h>
 #include <limits.h>
+#include <ctype.h>
 #include "ISO9660.h"
 #include "StdStream.h"
 #include "File.h"
@@ -19,14 +20,22 @@ CISO9660::~CISO9660()
 {
 }
 
+//Data can be read directly to emulated memory since block providers used for optical media
+//copy blocks from their cache. Some system calls (ie.: ReadFile) won't generate an exception
+//when trying to write to a write protected area.
 void CISO9660::ReadBlock(uint32 address, void* data)
 {
-	//The buffer is needed to make sure exception handlers
-	//are properly called as some system calls (ie.: ReadFile)
-	//won't generate an exception when trying to write to
-	//a write protected area
-	m_blockProvider->ReadBlock(address, m_blockBuffer);
-	memcpy(data, m_blockBuffer, CBlockProvider::BLOCKSIZE);
+	m_blockProvider->ReadBlock(address, data);
+}
+
+void CISO9660::ReadBlocks(uint32 address, uint32 count, void* data)
+{
+	m_blockProvider->ReadBlocks(address, count, data);
+}
+
+void CISO9660::PrefetchBlocks(uint32 address, uint32 count)
+{
+	m_blockProvider->PrefetchBlocks(address, count);
 }
 
 bool CISO9660::GetFileRecord(CDirectoryRecord* record, const char* filename)
@@ -34,6 +43,25 @@ bool CISO9660::GetFileRecord(CDirectoryRecord* record, const char* filename)
 	//Remove the first '/'
 	if(filename[0] == '/' || filename[0] == '\\') filename++;
 
+	//Disc is read only, results (even failed ones) stay valid for as long as we're mounted
+	auto pathKey = MakeLookupKey(filename);
+	std::lock_guard<std::mutex> lookupLock(m_lookupMutex);
+	auto pathIterator = m_pathCache.find(pathKey);
+	if(pathIterator == std::end(m_pathCache))
+	{
+		PATH_CACHE_ENTRY entry;
+		entry.found = FindFileRecord(&entry.record, filename);
+		pathIterator = m_pathCache.emplace(std::move(pathKey), entry).first;
+	}
+
+	const auto& entry = pathIterator->second;
+	if(!entry.found) return false;
+	(*record) = entry.record;
+	return true;
+}
+
+bool CISO9660::FindFileRecord(CDirectoryRecord* record, const char* filename)
+{
 	unsigned int recordIndex = m_pathTable.FindRoot();
 
 	while(1)
@@ -59,14 +87,20 @@ bool CISO9660::GetFileRecord(CDirectoryRecord* record, const char* filename)
 
 bool CISO9660::GetFileRecordFromDirectory(CDirectoryRecord* record, uint32 address, const char* filename)
 {
-	CFile directory(m_blockProvider.get(), address * CBlockProvider::BLOCKSIZE);
+	const auto& directoryIndex = GetDirectoryIndex(address);
 
-	while(1)
+	auto recordIndexIterator = directoryIndex.recordIndices.find(MakeLookupKey(filename));
+	if(recordIndexIterator != std::end(directoryIndex.recordIndices))
 	{
-		CDirectoryRecord entry(&directory);
+		(*record) = directoryIndex.records[recordIndexIterator->second];
+		return true;
+	}
 
-		if(entry.GetLength() == 0) break;
-		if(strnicmp(entry.GetName(), filename, strlen(filename))) continue;
+	//No exact match, names are allowed to be prefixes of the record's name
+	size_t filenameLength = strlen(filename);
+	for(const auto& entry : directoryIndex.records)
+	{
+		if(strnicmp(entry.GetName(), filename, filenameLength)) continue;
 
 		(*record) = entry;
 		return true;
@@ -75,6 +109,48 @@ bool CISO9660::GetFileRecordFromDirectory(CDirectoryRecord* record, uint32 addre
 	return false;
 }
 
+const CISO9660::DIRECTORY_INDEX& CISO9660::GetDirectoryIndex(uint32 address)
+{
+	auto directoryIndexIterator = m_directoryIndices.find(address);
+	if(directoryIndexIterator != std::end(m_directoryIndices))
+	{
+		return directoryIndexIterator->second;
+	}
+
+	DIRECTORY_INDEX directoryIndex;
+	CFile directory(m_blockProvider.get(), static_cast<uint64>(address) * CBlockProvider::BLOCKSIZE);
+
+	while(1)
+	{
+		CDirectoryRecord entry(&directory);
+
+		if(entry.GetLength() == 0) break;
+
+		//First record wins if more than one has the same key
+		size_t recordIndex = directoryIndex.records.size();
+		auto key = MakeLookupKey(entry.GetName());
+		auto versionPosition = key.find(';');
+		if(versionPosition != std::string::npos)
+		{
+			directoryIndex.recordIndices.emplace(key.substr(0, versionPosition), recordIndex);
+		}
+		directoryIndex.recordIndices.emplace(std::move(key), recordIndex);
+		directoryIndex.records.push_back(entry);
+	}
+
+	return m_directoryIndices.emplace(address, std::move(directoryIndex)).first->second;
+}
+
+std::string CISO9660::MakeLookupKey(const char* name)
+{
+	std::string result(name);
+	for(auto& character : result)
+	{
+		character = static_cast<char>(toupper(static_cast<unsigned char>(character)));
+	}
+	return result;
+}
+
 Framework::CStream* CISO9660::Open(const char* filename)
 {
 	CDirectoryRecord record;
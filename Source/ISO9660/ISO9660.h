@@ -1,6 +1,10 @@
 #pragma once
 
 #include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
 #include "BlockProvider.h"
 #include "VolumeDescriptor.h"
 #include "PathTable.h"
@@ -15,16 +19,41 @@ public:
 	~CISO9660();
 
 	void ReadBlock(uint32, void*);
+	void ReadBlocks(uint32, uint32, void*);
+	void PrefetchBlocks(uint32, uint32);
 
 	Framework::CStream* Open(const char*);
 	bool GetFileRecord(ISO9660::CDirectoryRecord*, const char*);
 
 private:
+	//Records of a directory, indexed by upper case name. Names are also indexed
+	//without their version suffix (ie.: ";1").
+	struct DIRECTORY_INDEX
+	{
+		std::vector<ISO9660::CDirectoryRecord> records;
+		std::unordered_map<std::string, size_t> recordIndices;
+	};
+
+	struct PATH_CACHE_ENTRY
+	{
+		bool found = false;
+		ISO9660::CDirectoryRecord record;
+	};
+
+	typedef std::unordered_map<uint32, DIRECTORY_INDEX> DirectoryIndexMap;
+	typedef std::unordered_map<std::string, PATH_CACHE_ENTRY> PathCacheMap;
+
+	bool FindFileRecord(ISO9660::CDirectoryRecord*, const char*);
 	bool GetFileRecordFromDirectory(ISO9660::CDirectoryRecord*, uint32, const char*);
+	const DIRECTORY_INDEX& GetDirectoryIndex(uint32);
+
+	static std::string MakeLookupKey(const char*);
 
 	BlockProviderPtr m_blockProvider;
 	ISO9660::CVolumeDescriptor m_volumeDescriptor;
 	ISO9660::CPathTable m_pathTable;
 
-	uint8 m_blockBuffer[ISO9660::CBlockProvider::BLOCKSIZE];
+	std::mutex m_lookupMutex;
+	DirectoryIndexMap m_directoryIndices;
+	PathCacheMap m_pathCache;
 };
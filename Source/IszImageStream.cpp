@@ -8,13 +8,8 @@
 #include "StdStream.h"
 
 CIszImageStream::CIszImageStream(CStream* baseStream)
-    : m_baseStream(baseStream)
+    : CCompressedImageStream(baseStream)
 {
-	if(baseStream == nullptr)
-	{
-		throw std::runtime_error("Null base stream supplied.");
-	}
-
 	baseStream->Read(&m_header, sizeof(HEADER));
 
 	assert(m_header.hasPassword == 0);
@@ -30,72 +25,16 @@ CIszImageStream::CIszImageStream(CStream* baseStream)
 	}
 
 	ReadBlockDescriptorTable();
-	m_cachedBlock = new uint8[m_header.blockSize];
-	m_readBuffer = new uint8[m_header.blockSize];
+	InitializeBlocks(GetTotalSize(), m_header.blockSize, m_header.blockNumber);
 }
 
 CIszImageStream::~CIszImageStream()
 {
-	delete[] m_cachedBlock;
-	delete[] m_readBuffer;
+	StopWorkers();
 	delete[] m_blockDescriptorTable;
 	delete m_baseStream;
 }
 
-void CIszImageStream::Seek(int64 position, Framework::STREAM_SEEK_DIRECTION origin)
-{
-	switch(origin)
-	{
-	case Framework::STREAM_SEEK_CUR:
-		m_position += position;
-		break;
-	case Framework::STREAM_SEEK_SET:
-		m_position = position;
-		break;
-	case Framework::STREAM_SEEK_END:
-		m_position = GetTotalSize();
-		break;
-	}
-}
-
-uint64 CIszImageStream::Tell()
-{
-	return m_position;
-}
-
-uint64 CIszImageStream::Read(void* buffer, uint64 size)
-{
-	uint64 bytesRead = 0;
-	uint8* inputBuffer = reinterpret_cast<uint8*>(buffer);
-	while(size != 0)
-	{
-		if(IsEOF())
-		{
-			break;
-		}
-		SyncCache();
-		uint64 blockPosition = (m_position % m_header.blockSize);
-		uint64 sizeLeft = m_header.blockSize - blockPosition;
-		uint64 sizeToRead = std::min<uint64>(size, sizeLeft);
-		memcpy(inputBuffer, m_cachedBlock + blockPosition, static_cast<size_t>(sizeToRead));
-		m_position += sizeToRead;
-		size -= sizeToRead;
-		inputBuffer += sizeToRead;
-		bytesRead += sizeToRead;
-	}
-	return bytesRead;
-}
-
-uint64 CIszImageStream::Write(const void* buffer, uint64 size)
-{
-	throw std::exception();
-}
-
-bool CIszImageStream::IsEOF()
-{
-	return (m_position >= GetTotalSize());
-}
-
 void CIszImageStream::ReadBlockDescriptorTable()
 {
 	const char* key = "IsZ!";
@@ -109,12 +48,21 @@ void CIszImageStream::ReadBlockDescriptorTable()
 	}
 
 	m_blockDescriptorTable = new BLOCKDESCRIPTOR[m_header.blockNumber];
+	m_blockPositions.resize(m_header.blockNumber);
+	uint64 blockPosition = m_header.dataOffset;
 	for(unsigned int i = 0; i < m_header.blockNumber; i++)
 	{
 		uint32 value = *reinterpret_cast<uint32*>(&cryptedTable[i * m_header.blockPtrLength]);
 		value &= 0xFFFFFF;
 		m_blockDescriptorTable[i].size = value & 0x3FFFFF;
 		m_blockDescriptorTable[i].storageType = static_cast<uint8>(value >> 22);
+
+		//Zero blocks don't take any space in the file
+		m_blockPositions[i] = blockPosition;
+		if(m_blockDescriptorTable[i].storageType != ADI_ZERO)
+		{
+			blockPosition += m_blockDescriptorTable[i].size;
+		}
 	}
 
 	delete[] cryptedTable;
@@ -125,59 +73,41 @@ uint64 CIszImageStream::GetTotalSize() const
 	return static_cast<uint64>(m_header.totalSectors) * static_cast<uint64>(m_header.sectorSize);
 }
 
-const CIszImageStream::BLOCKDESCRIPTOR& CIszImageStream::SeekToBlock(uint64 blockNumber)
+CCompressedImageStream::RAW_BLOCK CIszImageStream::GetRawBlock(uint32 blockNumber) const
 {
 	assert(blockNumber < m_header.blockNumber);
-	uint64 seekPosition = m_header.dataOffset;
-	for(unsigned int i = 0; i < blockNumber; i++)
-	{
-		const BLOCKDESCRIPTOR& blockDescriptor = m_blockDescriptorTable[i];
-		if(blockDescriptor.storageType != ADI_ZERO)
-		{
-			seekPosition += blockDescriptor.size;
-		}
-	}
-	m_baseStream->Seek(seekPosition, Framework::STREAM_SEEK_SET);
-	return m_blockDescriptorTable[blockNumber];
+	const BLOCKDESCRIPTOR& blockDescriptor = m_blockDescriptorTable[blockNumber];
+	RAW_BLOCK rawBlock;
+	rawBlock.position = m_blockPositions[blockNumber];
+	rawBlock.size = (blockDescriptor.storageType != ADI_ZERO) ? blockDescriptor.size : 0;
+	return rawBlock;
 }
 
-void CIszImageStream::SyncCache()
+void CIszImageStream::DecompressBlock(uint32 blockNumber, uint8* rawData, uint32 rawSize, uint8* output) const
 {
-	uint64 currentSector = (m_position / m_header.sectorSize);
-	uint64 neededBlock = (currentSector * m_header.sectorSize) / m_header.blockSize;
-	if(neededBlock == m_cachedBlockNumber)
-	{
-		return;
-	}
-	if(neededBlock >= m_header.blockNumber)
-	{
-		throw std::runtime_error("Trying to read past eof.");
-	}
-
-	const BLOCKDESCRIPTOR& blockDescriptor = SeekToBlock(neededBlock);
-	memset(m_cachedBlock, 0, m_header.blockSize);
+	const BLOCKDESCRIPTOR& blockDescriptor = m_blockDescriptorTable[blockNumber];
+	memset(output, 0, m_header.blockSize);
 	switch(blockDescriptor.storageType)
 	{
 	case ADI_ZERO:
-		ReadZeroBlock(blockDescriptor.size);
+		ReadZeroBlock(blockDescriptor.size, output);
 		break;
 	case ADI_DATA:
-		ReadDataBlock(blockDescriptor.size);
+		ReadDataBlock(rawData, rawSize, output);
 		break;
 	case ADI_ZLIB:
-		ReadGzipBlock(blockDescriptor.size);
+		ReadGzipBlock(rawData, rawSize, output);
 		break;
 	case ADI_BZ2:
-		ReadBz2Block(blockDescriptor.size);
+		ReadBz2Block(rawData, rawSize, output);
 		break;
 	default:
 		throw std::runtime_error("Unsupported block storage mode.");
 		break;
 	}
-	m_cachedBlockNumber = neededBlock;
 }
 
-void CIszImageStream::ReadZeroBlock(uint32 compressedBlockSize)
+void CIszImageStream::ReadZeroBlock(uint32 compressedBlockSize, uint8* output) const
 {
 	if(compressedBlockSize != m_header.blockSize)
 	{
@@ -185,38 +115,36 @@ void CIszImageStream::ReadZeroBlock(uint32 compressedBlockSize)
 	}
 }
 
-void CIszImageStream::ReadDataBlock(uint32 compressedBlockSize)
+void CIszImageStream::ReadDataBlock(uint8* rawData, uint32 compressedBlockSize, uint8* output) const
 {
 	if(compressedBlockSize != m_header.blockSize)
 	{
 		throw std::runtime_error("Invalid data block.");
 	}
-	m_baseStream->Read(m_cachedBlock, compressedBlockSize);
+	memcpy(output, rawData, compressedBlockSize);
 }
 
-void CIszImageStream::ReadGzipBlock(uint32 compressedBlockSize)
+void CIszImageStream::ReadGzipBlock(uint8* rawData, uint32 compressedBlockSize, uint8* output) const
 {
-	m_baseStream->Read(m_readBuffer, compressedBlockSize);
 	uLongf destLength = m_header.blockSize;
 	if(uncompress(
-	       reinterpret_cast<Bytef*>(m_cachedBlock), &destLength,
-	       reinterpret_cast<Bytef*>(m_readBuffer), compressedBlockSize) != Z_OK)
+	       reinterpret_cast<Bytef*>(output), &destLength,
+	       reinterpret_cast<Bytef*>(rawData), compressedBlockSize) != Z_OK)
 	{
 		throw std::runtime_error("Error decompressing zlib block.");
 	}
 }
 
-void CIszImageStream::ReadBz2Block(uint32 compressedBlockSize)
+void CIszImageStream::ReadBz2Block(uint8* rawData, uint32 compressedBlockSize, uint8* output) const
 {
-	m_baseStream->Read(m_readBuffer, compressedBlockSize);
 	//Force BZ2 header
-	m_readBuffer[0] = 'B';
-	m_readBuffer[1] = 'Z';
-	m_readBuffer[2] = 'h';
+	rawData[0] = 'B';
+	rawData[1] = 'Z';
+	rawData[2] = 'h';
 	unsigned int destLength = m_header.blockSize;
 	if(BZ2_bzBuffToBuffDecompress(
-	       reinterpret_cast<char*>(m_cachedBlock), &destLength,
-	       reinterpret_cast<char*>(m_readBuffer), compressedBlockSize, 0, 0) != BZ_OK)
+	       reinterpret_cast<char*>(output), &destLength,
+	       reinterpret_cast<char*>(rawData), compressedBlockSize, 0, 0) != BZ_OK)
 	{
 		throw std::runtime_error("Error decompressing bz2 block.");
 	}
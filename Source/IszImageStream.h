@@ -1,19 +1,18 @@
 #pragma once
 
+#include <vector>
 #include "Types.h"
-#include "Stream.h"
+#include "CompressedImageStream.h"
 
-class CIszImageStream : public Framework::CStream
+class CIszImageStream : public CCompressedImageStream
 {
 public:
 	CIszImageStream(Framework::CStream*);
 	virtual ~CIszImageStream();
 
-	virtual void Seek(int64, Framework::STREAM_SEEK_DIRECTION) override;
-	virtual uint64 Tell() override;
-	virtual uint64 Read(void*, uint64) override;
-	virtual uint64 Write(const void*, uint64) override;
-	virtual bool IsEOF() override;
+protected:
+	RAW_BLOCK GetRawBlock(uint32) const override;
+	void DecompressBlock(uint32, uint8*, uint32, uint8*) const override;
 
 private:
 #pragma pack(push, 1)
@@ -70,19 +69,13 @@ private:
 
 	void ReadBlockDescriptorTable();
 	uint64 GetTotalSize() const;
-	const BLOCKDESCRIPTOR& SeekToBlock(uint64);
-	void SyncCache();
 
-	void ReadZeroBlock(uint32);
-	void ReadDataBlock(uint32);
-	void ReadGzipBlock(uint32);
-	void ReadBz2Block(uint32);
+	void ReadZeroBlock(uint32, uint8*) const;
+	void ReadDataBlock(uint8*, uint32, uint8*) const;
+	void ReadGzipBlock(uint8*, uint32, uint8*) const;
+	void ReadBz2Block(uint8*, uint32, uint8*) const;
 
-	Framework::CStream* m_baseStream = nullptr;
 	HEADER m_header;
 	BLOCKDESCRIPTOR* m_blockDescriptorTable = nullptr;
-	int64 m_cachedBlockNumber = -1;
-	uint8* m_cachedBlock = nullptr;
-	uint8* m_readBuffer = nullptr;
-	uint64 m_position = 0;
+	std::vector<uint64> m_blockPositions;
 };
@@ -0,0 +1,386 @@
+#include <cstring>
+#include <algorithm>
+#include <zlib.h>
+#include "JitBlockCache.h"
+#include "MemoryUtils.h"
+#include "StdStreamUtils.h"
+#include "Log.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#elif defined(__unix__) || defined(__ANDROID__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#endif
+
+#define LOG_NAME ("jitblockcache")
+
+#ifndef PLAY_VERSION
+#define PLAY_VERSION "unknown"
+#endif
+
+CJitBlockCache::~CJitBlockCache()
+{
+	Close();
+}
+
+void CJitBlockCache::Open(const fs::path& path)
+{
+	Close();
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_path = path;
+	if(!MapFile())
+	{
+		CLog::GetInstance().Print(LOG_NAME, "Discarding invalid or stale block cache '%s'.\r\n", m_path.string().c_str());
+		UnmapFile();
+	}
+}
+
+void CJitBlockCache::Flush()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if(m_path.empty()) return;
+	if(m_pendingBlocks.empty()) return;
+
+	//Merge blocks from the current mapping with the new blocks
+	std::vector<AOT_BLOCK_KEY> keys;
+	keys.reserve(m_entryCount + m_pendingBlocks.size());
+	for(uint32 i = 0; i < m_entryCount; i++)
+	{
+		if(m_pendingBlocks.find(m_entries[i].key) != std::end(m_pendingBlocks)) continue;
+		keys.push_back(m_entries[i].key);
+	}
+	for(const auto& pendingBlockPair : m_pendingBlocks)
+	{
+		keys.push_back(pendingBlockPair.first);
+	}
+	std::sort(keys.begin(), keys.end());
+
+	auto tempPath = m_path;
+	tempPath += ".tmp";
+
+	try
+	{
+		auto stream = Framework::CreateOutputStdStream(tempPath.native());
+
+		HEADER header = {};
+		header.magic = CACHE_MAGIC;
+		header.version = CACHE_VERSION;
+		header.buildId = ComputeBuildId();
+		header.hostId = ComputeHostId();
+		header.blockCount = static_cast<uint32>(keys.size());
+		stream.Write(&header, sizeof(HEADER));
+
+		std::vector<BLOCK_VIEW> blocks;
+		blocks.reserve(keys.size());
+		for(const auto& key : keys)
+		{
+			auto pendingBlockIterator = m_pendingBlocks.find(key);
+			if(pendingBlockIterator != std::end(m_pendingBlocks))
+			{
+				const auto& pendingBlock = pendingBlockIterator->second;
+				BLOCK_VIEW block;
+				block.code = pendingBlock.code.data();
+				block.codeSize = static_cast<uint32>(pendingBlock.code.size());
+				block.relocations = pendingBlock.relocations.data();
+				block.relocationCount = static_cast<uint32>(pendingBlock.relocations.size());
+				blocks.push_back(block);
+			}
+			else
+			{
+				blocks.push_back(MakeBlockView(FindEntry(key)));
+			}
+		}
+
+		//Relocations are kept 8-byte aligned, code follows them
+		uint32 currentOffset = sizeof(HEADER) + (sizeof(BLOCK_ENTRY) * header.blockCount);
+		for(uint32 i = 0; i < header.blockCount; i++)
+		{
+			const auto& block = blocks[i];
+			BLOCK_ENTRY entry = {};
+			entry.key = keys[i];
+			entry.relocationOffset = currentOffset;
+			entry.relocationCount = block.relocationCount;
+			currentOffset += block.relocationCount * sizeof(RELOCATION);
+			entry.codeOffset = currentOffset;
+			entry.codeSize = block.codeSize;
+			entry.codeChecksum = crc32(0, block.code, block.codeSize);
+			currentOffset += (block.codeSize + 7) & ~7;
+			stream.Write(&entry, sizeof(BLOCK_ENTRY));
+		}
+
+		static const uint8 padding[8] = {};
+		for(const auto& block : blocks)
+		{
+			stream.Write(block.relocations, block.relocationCount * sizeof(RELOCATION));
+			stream.Write(block.code, block.codeSize);
+			stream.Write(padding, ((block.codeSize + 7) & ~7) - block.codeSize);
+		}
+	}
+	catch(...)
+	{
+		CLog::GetInstance().Warn(LOG_NAME, "Failed to write block cache '%s'.\r\n", tempPath.string().c_str());
+		return;
+	}
+
+	//Data from mapping has been copied to the new file, we can drop it now
+	UnmapFile();
+	m_pendingBlocks.clear();
+
+	std::error_code renameError;
+	fs::rename(tempPath, m_path, renameError);
+	if(renameError)
+	{
+		CLog::GetInstance().Warn(LOG_NAME, "Failed to replace block cache '%s'.\r\n", m_path.string().c_str());
+		return;
+	}
+
+	if(!MapFile())
+	{
+		UnmapFile();
+	}
+}
+
+void CJitBlockCache::Close()
+{
+	Flush();
+	std::lock_guard<std::mutex> lock(m_mutex);
+	UnmapFile();
+	m_pendingBlocks.clear();
+	m_path.clear();
+}
+
+bool CJitBlockCache::IsOpen() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return !m_path.empty();
+}
+
+bool CJitBlockCache::FindBlock(const AOT_BLOCK_KEY& key, BLOCK& block) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	auto pendingBlockIterator = m_pendingBlocks.find(key);
+	if(pendingBlockIterator != std::end(m_pendingBlocks))
+	{
+		block = pendingBlockIterator->second;
+		return true;
+	}
+
+	auto entry = FindEntry(key);
+	if(!entry) return false;
+
+	//Lazily validate code to catch partially written or corrupted files
+	if(crc32(0, m_mappedData + entry->codeOffset, entry->codeSize) != entry->codeChecksum)
+	{
+		CLog::GetInstance().Warn(LOG_NAME, "Checksum mismatch for block 0x%08X-0x%08X.\r\n", key.begin, key.end);
+		return false;
+	}
+
+	auto blockView = MakeBlockView(entry);
+	block.code.assign(blockView.code, blockView.code + blockView.codeSize);
+	block.relocations.assign(blockView.relocations, blockView.relocations + blockView.relocationCount);
+	return true;
+}
+
+void CJitBlockCache::AddBlock(const AOT_BLOCK_KEY& key, const void* code, uint32 codeSize, const RelocationArray& relocations)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if(m_path.empty()) return;
+	auto codeBytes = reinterpret_cast<const uint8*>(code);
+	auto& pendingBlock = m_pendingBlocks[key];
+	pendingBlock.code.assign(codeBytes, codeBytes + codeSize);
+	pendingBlock.relocations = relocations;
+}
+
+bool CJitBlockCache::CanRelocateSymbol(uintptr_t symbol)
+{
+	//Only symbols that live in the same image as the anchor can be expressed as a delta
+	auto anchor = reinterpret_cast<uintptr_t>(&EmptyBlockHandler);
+#if defined(_WIN32)
+	HMODULE anchorModule = NULL;
+	HMODULE symbolModule = NULL;
+	static const DWORD flags = GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT;
+	if(!GetModuleHandleExW(flags, reinterpret_cast<LPCWSTR>(anchor), &anchorModule)) return false;
+	if(!GetModuleHandleExW(flags, reinterpret_cast<LPCWSTR>(symbol), &symbolModule)) return false;
+	return anchorModule == symbolModule;
+#elif defined(__unix__) || defined(__ANDROID__) || defined(__APPLE__)
+	Dl_info anchorInfo = {};
+	Dl_info symbolInfo = {};
+	if(!dladdr(reinterpret_cast<void*>(anchor), &anchorInfo)) return false;
+	if(!dladdr(reinterpret_cast<void*>(symbol), &symbolInfo)) return false;
+	return anchorInfo.dli_fbase == symbolInfo.dli_fbase;
+#else
+	return false;
+#endif
+}
+
+int64 CJitBlockCache::GetSymbolDelta(uintptr_t symbol)
+{
+	auto anchor = reinterpret_cast<uintptr_t>(&EmptyBlockHandler);
+	return static_cast<int64>(symbol - anchor);
+}
+
+uintptr_t CJitBlockCache::GetSymbolFromDelta(int64 delta)
+{
+	auto anchor = reinterpret_cast<uintptr_t>(&EmptyBlockHandler);
+	return anchor + static_cast<uintptr_t>(delta);
+}
+
+uint32 CJitBlockCache::ComputeBuildId()
+{
+	//Version string changes between builds, function deltas catch local rebuilds with the same version
+	static const char* buildString = PLAY_VERSION " " __DATE__ " " __TIME__;
+	uint32 buildId = crc32(0, reinterpret_cast<const Bytef*>(buildString), static_cast<uInt>(strlen(buildString)));
+	const int64 deltas[] =
+	    {
+	        GetSymbolDelta(reinterpret_cast<uintptr_t>(&NextBlockTrampoline)),
+	        GetSymbolDelta(reinterpret_cast<uintptr_t>(&MemoryUtils_GetWordProxy)),
+	        GetSymbolDelta(reinterpret_cast<uintptr_t>(&MemoryUtils_SetWordProxy)),
+	        GetSymbolDelta(reinterpret_cast<uintptr_t>(&MemoryUtils_GetQuadProxy)),
+	    };
+	buildId = crc32(buildId, reinterpret_cast<const Bytef*>(deltas), sizeof(deltas));
+	return buildId;
+}
+
+uint32 CJitBlockCache::ComputeHostId()
+{
+	//Generated code depends on pointer size and the layout of the CPU state
+	uint32 hostId = static_cast<uint32>(sizeof(void*));
+	hostId |= static_cast<uint32>(sizeof(MIPSSTATE)) << 8;
+	return hostId;
+}
+
+bool CJitBlockCache::MapFile()
+{
+	std::error_code existsError;
+	if(!fs::exists(m_path, existsError)) return true;
+
+#if defined(_WIN32)
+	auto fileHandle = CreateFileW(m_path.native().c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(fileHandle == INVALID_HANDLE_VALUE) return false;
+	m_fileHandle = fileHandle;
+
+	LARGE_INTEGER fileSize = {};
+	if(!GetFileSizeEx(fileHandle, &fileSize)) return false;
+	if(fileSize.QuadPart < static_cast<LONGLONG>(sizeof(HEADER))) return false;
+	m_mappedSize = static_cast<size_t>(fileSize.QuadPart);
+
+	auto mappingHandle = CreateFileMappingW(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if(mappingHandle == NULL) return false;
+	m_mappingHandle = mappingHandle;
+
+	m_mappedData = reinterpret_cast<const uint8*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+	if(m_mappedData == nullptr) return false;
+#elif defined(__unix__) || defined(__ANDROID__) || defined(__APPLE__)
+	int fd = open(m_path.native().c_str(), O_RDONLY);
+	if(fd < 0) return false;
+
+	struct stat fileStat = {};
+	if((fstat(fd, &fileStat) < 0) || (fileStat.st_size < static_cast<off_t>(sizeof(HEADER))))
+	{
+		close(fd);
+		return false;
+	}
+
+	void* mappedData = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(mappedData == MAP_FAILED) return false;
+
+	m_mappedData = reinterpret_cast<const uint8*>(mappedData);
+	m_mappedSize = fileStat.st_size;
+#else
+	return false;
+#endif
+
+	if(!ValidateMapping()) return false;
+
+	auto header = reinterpret_cast<const HEADER*>(m_mappedData);
+	m_entries = reinterpret_cast<const BLOCK_ENTRY*>(m_mappedData + sizeof(HEADER));
+	m_entryCount = header->blockCount;
+	return true;
+}
+
+void CJitBlockCache::UnmapFile()
+{
+#if defined(_WIN32)
+	if(m_mappedData)
+	{
+		UnmapViewOfFile(m_mappedData);
+	}
+	if(m_mappingHandle)
+	{
+		CloseHandle(m_mappingHandle);
+		m_mappingHandle = nullptr;
+	}
+	if(m_fileHandle)
+	{
+		CloseHandle(m_fileHandle);
+		m_fileHandle = nullptr;
+	}
+#elif defined(__unix__) || defined(__ANDROID__) || defined(__APPLE__)
+	if(m_mappedData)
+	{
+		munmap(const_cast<uint8*>(m_mappedData), m_mappedSize);
+	}
+#endif
+	m_mappedData = nullptr;
+	m_mappedSize = 0;
+	m_entries = nullptr;
+	m_entryCount = 0;
+}
+
+bool CJitBlockCache::ValidateMapping() const
+{
+	auto header = reinterpret_cast<const HEADER*>(m_mappedData);
+	if(header->magic != CACHE_MAGIC) return false;
+	if(header->version != CACHE_VERSION) return false;
+	if(header->buildId != ComputeBuildId()) return false;
+	if(header->hostId != ComputeHostId()) return false;
+
+	uint64 indexEnd = sizeof(HEADER) + (static_cast<uint64>(header->blockCount) * sizeof(BLOCK_ENTRY));
+	if(indexEnd > m_mappedSize) return false;
+
+	auto entries = reinterpret_cast<const BLOCK_ENTRY*>(m_mappedData + sizeof(HEADER));
+	for(uint32 i = 0; i < header->blockCount; i++)
+	{
+		const auto& entry = entries[i];
+		if((i != 0) && !(entries[i - 1].key < entry.key)) return false;
+		if((entry.relocationOffset & 7) != 0) return false;
+		uint64 relocationEnd = static_cast<uint64>(entry.relocationOffset) + (static_cast<uint64>(entry.relocationCount) * sizeof(RELOCATION));
+		if((entry.relocationOffset < indexEnd) || (relocationEnd > m_mappedSize)) return false;
+		uint64 codeEnd = static_cast<uint64>(entry.codeOffset) + entry.codeSize;
+		if((entry.codeOffset < indexEnd) || (codeEnd > m_mappedSize)) return false;
+		for(uint32 j = 0; j < entry.relocationCount; j++)
+		{
+			auto relocation = reinterpret_cast<const RELOCATION*>(m_mappedData + entry.relocationOffset) + j;
+			if((static_cast<uint64>(relocation->offset) + sizeof(uintptr_t)) > entry.codeSize) return false;
+		}
+	}
+
+	return true;
+}
+
+const CJitBlockCache::BLOCK_ENTRY* CJitBlockCache::FindEntry(const AOT_BLOCK_KEY& key) const
+{
+	auto entriesEnd = m_entries + m_entryCount;
+	auto entryIterator = std::lower_bound(m_entries, entriesEnd, key,
+	                                      [](const BLOCK_ENTRY& entry, const AOT_BLOCK_KEY& key) { return entry.key < key; });
+	if(entryIterator == entriesEnd) return nullptr;
+	if(key < entryIterator->key) return nullptr;
+	return entryIterator;
+}
+
+CJitBlockCache::BLOCK_VIEW CJitBlockCache::MakeBlockView(const BLOCK_ENTRY* entry) const
+{
+	assert(entry);
+	BLOCK_VIEW block;
+	block.code = m_mappedData + entry->codeOffset;
+	block.codeSize = entry->codeSize;
+	block.relocations = reinterpret_cast<const RELOCATION*>(m_mappedData + entry->relocationOffset);
+	block.relocationCount = entry->relocationCount;
+	return block;
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <vector>
+#include "Types.h"
+#include "filesystem_def.h"
+#include "BasicBlock.h"
+
+//Persistent cache of compiled blocks, keyed by block checksum and range.
+//Code is stored with a list of relocations (external symbol references) that
+//are patched when a block is loaded back. Symbols are stored relative to an
+//anchor function so that the cache survives ASLR, as long as the binary didn't change.
+//All operations are thread safe, blocks are copied out of the cache when found.
+class CJitBlockCache
+{
+public:
+	struct RELOCATION
+	{
+		uint32 offset;
+		uint32 reserved;
+		int64 symbolDelta;
+	};
+	static_assert(sizeof(RELOCATION) == 0x10, "RELOCATION must be 16 bytes long.");
+
+	typedef std::vector<RELOCATION> RelocationArray;
+
+	struct BLOCK
+	{
+		std::vector<uint8> code;
+		RelocationArray relocations;
+	};
+
+	CJitBlockCache() = default;
+	CJitBlockCache(const CJitBlockCache&) = delete;
+	virtual ~CJitBlockCache();
+
+	CJitBlockCache& operator=(const CJitBlockCache&) = delete;
+
+	void Open(const fs::path&);
+	void Flush();
+	void Close();
+
+	bool IsOpen() const;
+
+	bool FindBlock(const AOT_BLOCK_KEY&, BLOCK&) const;
+	void AddBlock(const AOT_BLOCK_KEY&, const void*, uint32, const RelocationArray&);
+
+	static bool CanRelocateSymbol(uintptr_t);
+	static int64 GetSymbolDelta(uintptr_t);
+	static uintptr_t GetSymbolFromDelta(int64);
+
+private:
+	enum
+	{
+		CACHE_MAGIC = 0x43424A50, //'PJBC'
+		CACHE_VERSION = 1,
+	};
+
+#pragma pack(push, 1)
+	struct HEADER
+	{
+		uint32 magic;
+		uint32 version;
+		uint32 buildId;
+		uint32 hostId;
+		uint32 blockCount;
+		uint32 reserved;
+	};
+	static_assert(sizeof(HEADER) == 0x18, "HEADER must be 24 bytes long.");
+
+	struct BLOCK_ENTRY
+	{
+		AOT_BLOCK_KEY key;
+		uint32 codeOffset;
+		uint32 codeSize;
+		uint32 codeChecksum;
+		uint32 relocationOffset;
+		uint32 relocationCount;
+	};
+	static_assert(sizeof(BLOCK_ENTRY) == 0x20, "BLOCK_ENTRY must be 32 bytes long.");
+#pragma pack(pop)
+
+	struct BLOCK_VIEW
+	{
+		const uint8* code = nullptr;
+		uint32 codeSize = 0;
+		const RELOCATION* relocations = nullptr;
+		uint32 relocationCount = 0;
+	};
+
+	typedef std::map<AOT_BLOCK_KEY, BLOCK> PendingBlockMap;
+
+	static uint32 ComputeBuildId();
+	static uint32 ComputeHostId();
+
+	bool MapFile();
+	void UnmapFile();
+	bool ValidateMapping() const;
+	const BLOCK_ENTRY* FindEntry(const AOT_BLOCK_KEY&) const;
+	BLOCK_VIEW MakeBlockView(const BLOCK_ENTRY*) const;
+
+	mutable std::mutex m_mutex;
+	fs::path m_path;
+	PendingBlockMap m_pendingBlocks;
+
+	const uint8* m_mappedData = nullptr;
+	size_t m_mappedSize = 0;
+	const BLOCK_ENTRY* m_entries = nullptr;
+	uint32 m_entryCount = 0;
+
+#ifdef _WIN32
+	void* m_fileHandle = nullptr;
+	void* m_mappingHandle = nullptr;
+#endif
+};
@@ -11,6 +11,8 @@
 
 CLog::CLog()
 {
+	//Trace is available in all builds, make sure its preferences are registered
+	CTrace::GetInstance();
 #ifndef DISABLE_LOGGING
 	m_logBasePath = CAppConfig::GetBasePath() / LOG_PATH;
 	Framework::PathUtils::EnsurePathExists(m_logBasePath);
@@ -19,7 +21,7 @@ CLog::CLog()
 #endif
 }
 
-void CLog::Print(const char* logName, const char* format, ...)
+void CLog::PrintToLog(const char* logName, const char* format, ...)
 {
 #if defined(_DEBUG) && !defined(DISABLE_LOGGING)
 	if(!m_showPrints) return;
@@ -32,7 +34,7 @@ void CLog::Print(const char* logName, const char* format, ...)
 #endif
 }
 
-void CLog::Warn(const char* logName, const char* format, ...)
+void CLog::WarnToLog(const char* logName, const char* format, ...)
 {
 #if defined(_DEBUG) && !defined(DISABLE_LOGGING)
 	auto& logStream(GetLog(logName));
@@ -5,6 +5,7 @@
 #include "filesystem_def.h"
 #include "StdStream.h"
 #include "Singleton.h"
+#include "Trace.h"
 
 class CLog : public CSingleton<CLog>
 {
@@ -12,10 +13,34 @@ public:
 	CLog();
 	virtual ~CLog() = default;
 
-	void Print(const char*, const char*, ...);
-	void Warn(const char*, const char*, ...);
+	template <typename... Args>
+	void Print(const char* logName, const char* format, Args... args)
+	{
+		if(CTrace::IsEnabled())
+		{
+			CTrace::GetInstance().Record(logName, format, 0, args...);
+		}
+#if defined(_DEBUG) && !defined(DISABLE_LOGGING)
+		PrintToLog(logName, format, args...);
+#endif
+	}
+
+	template <typename... Args>
+	void Warn(const char* logName, const char* format, Args... args)
+	{
+		if(CTrace::IsEnabled())
+		{
+			CTrace::GetInstance().Record(logName, format, CTrace::FORMAT_FLAG_WARNING, args...);
+		}
+#if defined(_DEBUG) && !defined(DISABLE_LOGGING)
+		WarnToLog(logName, format, args...);
+#endif
+	}
 
 private:
+	void PrintToLog(const char*, const char*, ...);
+	void WarnToLog(const char*, const char*, ...);
+
 	typedef std::map<std::string, Framework::CStdStream> LogMapType;
 
 	Framework::CStdStream& GetLog(const char*);
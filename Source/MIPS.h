@@ -147,6 +147,8 @@ public:
 
 	void* m_vuMem = nullptr;
 	void** m_pageLookup = nullptr;
+	//When set, loads and stores are emitted as direct accesses relative to this (see CFastMemArena)
+	uint8* m_fastMemBase = nullptr;
 
 	std::function<void(CMIPS*)> m_emptyBlockHandler;
 
@@ -5,6 +5,15 @@
 #include "offsetof_def.h"
 #include "BitManip.h"
 
+struct INSTRUCTION_SNAPSHOT
+{
+	uint32 address = 0;
+	const uint32* instructions = nullptr;
+	uint32 count = 0;
+};
+
+static thread_local INSTRUCTION_SNAPSHOT g_instructionSnapshot;
+
 CMIPSInstructionFactory::CMIPSInstructionFactory(MIPS_REGSIZE nRegSize)
     : m_regSize(nRegSize)
 {
@@ -16,7 +25,23 @@ void CMIPSInstructionFactory::SetupQuickVariables(uint32 nAddress, CMipsJitter*
 	m_codeGen = codeGen;
 	m_nAddress = nAddress;
 
-	m_nOpcode = m_pCtx->m_pMemoryMap->GetInstruction(m_nAddress);
+	if(g_instructionSnapshot.instructions)
+	{
+		uint32 index = (m_nAddress - g_instructionSnapshot.address) / 4;
+		assert(index < g_instructionSnapshot.count);
+		m_nOpcode = g_instructionSnapshot.instructions[index];
+	}
+	else
+	{
+		m_nOpcode = m_pCtx->m_pMemoryMap->GetInstruction(m_nAddress);
+	}
+}
+
+void CMIPSInstructionFactory::SetInstructionSnapshot(uint32 address, const uint32* instructions, uint32 count)
+{
+	g_instructionSnapshot.address = address;
+	g_instructionSnapshot.instructions = instructions;
+	g_instructionSnapshot.count = count;
 }
 
 void CMIPSInstructionFactory::ComputeMemAccessAddr()
@@ -103,6 +128,19 @@ void CMIPSInstructionFactory::ComputeMemAccessPageRef()
 	m_codeGen->LoadRefFromRef();
 }
 
+void CMIPSInstructionFactory::ComputeMemAccessFastRef()
+{
+	auto rs = static_cast<uint8>((m_nOpcode >> 21) & 0x001F);
+	auto immediate = static_cast<uint16>((m_nOpcode >> 0) & 0xFFFF);
+
+	m_codeGen->PushRelRef(offsetof(CMIPS, m_fastMemBase));
+
+	m_codeGen->PushRel(offsetof(CMIPS, m_State.nGPR[rs].nV[0]));
+	m_codeGen->PushCst(static_cast<int16>(immediate));
+	m_codeGen->Add();
+	m_codeGen->AddRef();
+}
+
 void CMIPSInstructionFactory::Branch(Jitter::CONDITION condition)
 {
 	uint16 nImmediate = (uint16)(m_nOpcode & 0xFFFF);
@@ -26,11 +26,16 @@ public:
 	virtual void CompileInstruction(uint32, CMipsJitter*, CMIPS*) = 0;
 	void Illegal();
 
+	//Instructions compiled on the calling thread are taken from this array instead of memory
+	//while it is set. Used by threads that don't own guest memory.
+	static void SetInstructionSnapshot(uint32, const uint32*, uint32);
+
 protected:
 	void ComputeMemAccessAddr();
 	void ComputeMemAccessAddrNoXlat();
 	void ComputeMemAccessRef(uint32);
 	void ComputeMemAccessPageRef();
+	void ComputeMemAccessFastRef();
 
 	void Branch(Jitter::CONDITION);
 	void BranchLikely(Jitter::CONDITION);
@@ -3,25 +3,66 @@
 #include "win32/Win32Defs.h"
 #endif
 
+CMailBox::~CMailBox()
+{
+	if(!m_commandRing) return;
+	while(auto command = m_commandRing->Peek())
+	{
+		command->function(command->storage, false);
+		m_commandRing->Pop();
+	}
+}
+
+void CMailBox::SetProducerThread(std::thread::id producerThreadId)
+{
+	if(!m_commandRing)
+	{
+		m_commandRing = std::make_unique<CommandRing>();
+	}
+	m_producerThreadId = producerThreadId;
+}
+
+bool CMailBox::IsProducerThread() const
+{
+	return m_commandRing && (std::this_thread::get_id() == m_producerThreadId);
+}
+
 bool CMailBox::IsPending() const
 {
-	return m_calls.size() != 0;
+	if(m_pendingCallCount.load(std::memory_order_acquire) != 0) return true;
+	return m_commandRing && !m_commandRing->IsEmpty();
 }
 
 void CMailBox::WaitForCall()
 {
+	if(m_commandRing)
+	{
+		for(unsigned int i = 0; i < WAIT_SPIN_COUNT; i++)
+		{
+			if(IsPending()) return;
+			std::this_thread::yield();
+		}
+	}
 	std::unique_lock<std::mutex> callLock(m_callMutex);
+	m_consumerParked = true;
+	std::atomic_thread_fence(std::memory_order_seq_cst);
 	while(!IsPending())
 	{
 		m_waitCondition.wait(callLock);
 	}
+	m_consumerParked = false;
 }
 
 void CMailBox::WaitForCall(unsigned int timeOut)
 {
 	std::unique_lock<std::mutex> callLock(m_callMutex);
-	if(IsPending()) return;
-	m_waitCondition.wait_for(callLock, std::chrono::milliseconds(timeOut));
+	m_consumerParked = true;
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if(!IsPending())
+	{
+		m_waitCondition.wait_for(callLock, std::chrono::milliseconds(timeOut));
+	}
+	m_consumerParked = false;
 }
 
 void CMailBox::FlushCalls()
@@ -31,6 +72,12 @@ void CMailBox::FlushCalls()
 
 void CMailBox::SendCall(const FunctionType& function, bool waitForCompletion)
 {
+	if(IsProducerThread())
+	{
+		SendCommand(function, waitForCompletion);
+		return;
+	}
+
 	std::unique_lock<std::mutex> callLock(m_callMutex);
 
 	{
@@ -38,6 +85,7 @@ void CMailBox::SendCall(const FunctionType& function, bool waitForCompletion)
 		message.function = function;
 		message.sync = waitForCompletion;
 		m_calls.push_back(std::move(message));
+		m_pendingCallCount++;
 	}
 
 	m_waitCondition.notify_all();
@@ -54,6 +102,12 @@ void CMailBox::SendCall(const FunctionType& function, bool waitForCompletion)
 
 void CMailBox::SendCall(FunctionType&& function)
 {
+	if(IsProducerThread())
+	{
+		SendCommand(std::move(function), false);
+		return;
+	}
+
 	std::lock_guard<std::mutex> callLock(m_callMutex);
 
 	{
@@ -61,6 +115,7 @@ void CMailBox::SendCall(FunctionType&& function)
 		message.function = std::move(function);
 		message.sync = false;
 		m_calls.push_back(std::move(message));
+		m_pendingCallCount++;
 	}
 
 	m_waitCondition.notify_all();
@@ -68,12 +123,18 @@ void CMailBox::SendCall(FunctionType&& function)
 
 void CMailBox::ReceiveCall()
 {
+	if(m_pendingCallCount.load(std::memory_order_acquire) == 0)
+	{
+		ReceiveCommand();
+		return;
+	}
 	MESSAGE message;
 	{
 		std::lock_guard<std::mutex> waitLock(m_callMutex);
-		if(!IsPending()) return;
+		if(m_calls.empty()) return;
 		message = std::move(m_calls.front());
 		m_calls.pop_front();
+		m_pendingCallCount--;
 	}
 	message.function();
 	if(message.sync)
@@ -83,3 +144,61 @@ void CMailBox::ReceiveCall()
 		m_callFinished.notify_all();
 	}
 }
+
+CMailBox::COMMAND* CMailBox::BeginCommand()
+{
+	while(1)
+	{
+		auto command = m_commandRing->BeginPush();
+		if(command) return command;
+		//Ring is full, let the consumer catch up
+		std::this_thread::yield();
+	}
+}
+
+void CMailBox::EndCommand(bool waitForCompletion)
+{
+	uint32 commandIndex = ++m_commandsSent;
+	m_commandRing->EndPush();
+
+	//Wake up the consumer if it gave up spinning
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if(m_consumerParked.load(std::memory_order_relaxed))
+	{
+		std::lock_guard<std::mutex> callLock(m_callMutex);
+		m_waitCondition.notify_all();
+	}
+
+	if(waitForCompletion)
+	{
+		std::unique_lock<std::mutex> callLock(m_callMutex);
+		while(static_cast<int32>(m_commandsDone.load(std::memory_order_acquire) - commandIndex) < 0)
+		{
+			m_callFinished.wait(callLock);
+		}
+	}
+}
+
+void CMailBox::SendCommand(FunctionType function, bool waitForCompletion)
+{
+	auto command = BeginCommand();
+	EmplaceCommand<FunctionType>(*command, std::move(function), std::true_type());
+	command->sync = waitForCompletion;
+	EndCommand(waitForCompletion);
+}
+
+void CMailBox::ReceiveCommand()
+{
+	if(!m_commandRing) return;
+	auto command = m_commandRing->Peek();
+	if(!command) return;
+	bool sync = command->sync;
+	command->function(command->storage, true);
+	m_commandRing->Pop();
+	m_commandsDone.fetch_add(1, std::memory_order_release);
+	if(sync)
+	{
+		std::lock_guard<std::mutex> waitLock(m_callMutex);
+		m_callFinished.notify_all();
+	}
+}
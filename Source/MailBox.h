@@ -1,14 +1,22 @@
 #pragma once
 
+#include <atomic>
 #include <functional>
 #include <deque>
+#include <memory>
 #include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
 #include <condition_variable>
+#include "Types.h"
+#include "SpscRingBuffer.h"
 
 class CMailBox
 {
 public:
-	virtual ~CMailBox() = default;
+	virtual ~CMailBox();
 
 	typedef std::function<void()> FunctionType;
 
@@ -16,12 +24,40 @@ public:
 	void SendCall(FunctionType&&);
 	void FlushCalls();
 
+	//Same as SendCall(FunctionType&&), but avoids the std::function allocation
+	//when called from the producer thread and the callable fits in a command slot.
+	template <typename Function>
+	void PostCall(Function&& function)
+	{
+		typedef typename std::decay<Function>::type CallableType;
+		if(!IsProducerThread())
+		{
+			SendCall(FunctionType(std::forward<Function>(function)));
+			return;
+		}
+		auto command = BeginCommand();
+		EmplaceCommand<CallableType>(*command, std::forward<Function>(function), std::integral_constant<bool, FitsInCommand<CallableType>()>());
+		EndCommand(false);
+	}
+
+	//Calls sent from this thread go through a lock-free ring instead of the locked queue.
+	//Only one thread can be the producer and calls must be received on another thread.
+	void SetProducerThread(std::thread::id);
+
 	bool IsPending() const;
 	void ReceiveCall();
 	void WaitForCall();
 	void WaitForCall(unsigned int);
 
 private:
+	enum
+	{
+		COMMAND_RING_SIZE = 1024,
+		COMMAND_STORAGE_SIZE = 64,
+		COMMAND_STORAGE_ALIGN = 16,
+		WAIT_SPIN_COUNT = 2000,
+	};
+
 	struct MESSAGE
 	{
 		MESSAGE() = default;
@@ -36,11 +72,77 @@ private:
 		bool sync;
 	};
 
+	//Calls and then destroys (or only destroys) the callable held in storage
+	typedef void (*CommandFunction)(void*, bool);
+
+	struct COMMAND
+	{
+		CommandFunction function = nullptr;
+		bool sync = false;
+		alignas(COMMAND_STORAGE_ALIGN) uint8 storage[COMMAND_STORAGE_SIZE];
+	};
+
+	static_assert(sizeof(FunctionType) <= COMMAND_STORAGE_SIZE, "FunctionType must fit in command storage.");
+
 	typedef std::deque<MESSAGE> FunctionCallQueue;
+	typedef CSpscRingBuffer<COMMAND, COMMAND_RING_SIZE> CommandRing;
+
+	template <typename CallableType>
+	static constexpr bool FitsInCommand()
+	{
+		return (sizeof(CallableType) <= COMMAND_STORAGE_SIZE) && (alignof(CallableType) <= COMMAND_STORAGE_ALIGN);
+	}
+
+	template <typename CallableType>
+	static void RunCommand(void* storage, bool execute)
+	{
+		auto callable = reinterpret_cast<CallableType*>(storage);
+		struct DESTROYER
+		{
+			~DESTROYER()
+			{
+				callable->~CallableType();
+			}
+			CallableType* callable;
+		} destroyer = {callable};
+		if(execute)
+		{
+			(*callable)();
+		}
+	}
+
+	template <typename CallableType, typename Function>
+	static void EmplaceCommand(COMMAND& command, Function&& function, std::true_type)
+	{
+		new(command.storage) CallableType(std::forward<Function>(function));
+		command.function = &RunCommand<CallableType>;
+		command.sync = false;
+	}
+
+	template <typename CallableType, typename Function>
+	static void EmplaceCommand(COMMAND& command, Function&& function, std::false_type)
+	{
+		new(command.storage) FunctionType(std::forward<Function>(function));
+		command.function = &RunCommand<FunctionType>;
+		command.sync = false;
+	}
+
+	bool IsProducerThread() const;
+	COMMAND* BeginCommand();
+	void EndCommand(bool);
+	void SendCommand(FunctionType, bool);
+	void ReceiveCommand();
 
 	FunctionCallQueue m_calls;
 	std::mutex m_callMutex;
 	std::condition_variable m_callFinished;
 	std::condition_variable m_waitCondition;
 	bool m_callDone;
+	std::atomic<uint32> m_pendingCallCount = {0};
+
+	std::unique_ptr<CommandRing> m_commandRing;
+	std::thread::id m_producerThreadId;
+	uint32 m_commandsSent = 0;
+	std::atomic<uint32> m_commandsDone = {0};
+	std::atomic<bool> m_consumerParked = {false};
 };
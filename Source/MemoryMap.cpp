@@ -44,17 +44,17 @@ const CMemoryMap::MEMORYMAPELEMENT* CMemoryMap::GetWriteMap(uint32 address) cons
 	return GetMap(m_writeMap, address);
 }
 
-void CMemoryMap::InsertMap(MemoryMapListType& memoryMap, uint32 start, uint32 end, void* pointer, unsigned char key)
+void CMemoryMap::InsertMap(MEMORYMAP& memoryMap, uint32 start, uint32 end, void* pointer, unsigned char key)
 {
 	MEMORYMAPELEMENT element;
 	element.nStart = start;
 	element.nEnd = end;
 	element.pPointer = pointer;
 	element.nType = MEMORYMAP_TYPE_MEMORY;
-	memoryMap.push_back(element);
+	InsertElement(memoryMap, std::move(element));
 }
 
-void CMemoryMap::InsertMap(MemoryMapListType& memoryMap, uint32 start, uint32 end, const MemoryMapHandlerType& handler, unsigned char key)
+void CMemoryMap::InsertMap(MEMORYMAP& memoryMap, uint32 start, uint32 end, const MemoryMapHandlerType& handler, unsigned char key)
 {
 	MEMORYMAPELEMENT element;
 	element.nStart = start;
@@ -62,12 +62,46 @@ void CMemoryMap::InsertMap(MemoryMapListType& memoryMap, uint32 start, uint32 en
 	element.handler = handler;
 	element.pPointer = nullptr;
 	element.nType = MEMORYMAP_TYPE_FUNCTION;
-	memoryMap.push_back(element);
+	InsertElement(memoryMap, std::move(element));
 }
 
-const CMemoryMap::MEMORYMAPELEMENT* CMemoryMap::GetMap(const MemoryMapListType& memoryMap, uint32 nAddress)
+void CMemoryMap::InsertElement(MEMORYMAP& memoryMap, MEMORYMAPELEMENT element)
 {
-	for(const auto& mapElement : memoryMap)
+	assert(memoryMap.elements.size() < PAGE_ELEMENT_MAX);
+	assert(memoryMap.elements.empty() || (memoryMap.elements.back().nEnd < element.nStart));
+	uint8 elementIndex = static_cast<uint8>(memoryMap.elements.size());
+	uint32 startPage = element.nStart >> PAGE_BITS;
+	uint32 endPage = element.nEnd >> PAGE_BITS;
+	memoryMap.elements.push_back(std::move(element));
+	for(uint32 page = startPage; page <= endPage; page++)
+	{
+		auto& pageGroup = memoryMap.pageGroups[page >> PAGE_GROUP_BITS];
+		if(!pageGroup)
+		{
+			pageGroup = std::make_unique<PageGroup>();
+			pageGroup->fill(PAGE_ELEMENT_NONE);
+		}
+		auto& pageElement = (*pageGroup)[page & (PAGE_GROUP_SIZE - 1)];
+		pageElement = (pageElement == PAGE_ELEMENT_NONE) ? elementIndex : PAGE_ELEMENT_SHARED;
+	}
+}
+
+const CMemoryMap::MEMORYMAPELEMENT* CMemoryMap::GetMap(const MEMORYMAP& memoryMap, uint32 nAddress)
+{
+	uint32 page = nAddress >> PAGE_BITS;
+	const auto& pageGroup = memoryMap.pageGroups[page >> PAGE_GROUP_BITS];
+	if(!pageGroup) return nullptr;
+	uint8 elementIndex = (*pageGroup)[page & (PAGE_GROUP_SIZE - 1)];
+	if(elementIndex == PAGE_ELEMENT_NONE) return nullptr;
+	if(elementIndex == PAGE_ELEMENT_SHARED) return FindElement(memoryMap.elements, nAddress);
+	const auto& mapElement = memoryMap.elements[elementIndex];
+	if((nAddress < mapElement.nStart) || (nAddress > mapElement.nEnd)) return nullptr;
+	return &mapElement;
+}
+
+const CMemoryMap::MEMORYMAPELEMENT* CMemoryMap::FindElement(const MemoryMapListType& elements, uint32 nAddress)
+{
+	for(const auto& mapElement : elements)
 	{
 		if(nAddress <= mapElement.nEnd)
 		{
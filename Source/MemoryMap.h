@@ -2,7 +2,9 @@
 #define _MEMORYMAP_H_
 
 #include "Types.h"
+#include <array>
 #include <functional>
+#include <memory>
 #include <vector>
 
 enum MEMORYMAP_ENDIANESS
@@ -48,17 +50,44 @@ public:
 	const MEMORYMAPELEMENT* GetWriteMap(uint32) const;
 
 protected:
+	enum
+	{
+		PAGE_BITS = 12,
+		PAGE_GROUP_BITS = 10,
+		PAGE_GROUP_SIZE = (1 << PAGE_GROUP_BITS),
+		PAGE_GROUP_COUNT = (1 << (32 - PAGE_BITS - PAGE_GROUP_BITS)),
+	};
+
+	enum : uint8
+	{
+		PAGE_ELEMENT_NONE = 0xFF,
+		PAGE_ELEMENT_SHARED = 0xFE,
+		PAGE_ELEMENT_MAX = PAGE_ELEMENT_SHARED,
+	};
+
 	typedef std::vector<MEMORYMAPELEMENT> MemoryMapListType;
+	typedef std::array<uint8, PAGE_GROUP_SIZE> PageGroup;
+
+	//Elements are kept sorted by address. Each page holds the index of the only element
+	//covering it (or PAGE_ELEMENT_SHARED if many elements cover it) and page groups
+	//are only allocated for mapped areas.
+	struct MEMORYMAP
+	{
+		MemoryMapListType elements;
+		std::array<std::unique_ptr<PageGroup>, PAGE_GROUP_COUNT> pageGroups;
+	};
 
-	static const MEMORYMAPELEMENT* GetMap(const MemoryMapListType&, uint32);
+	static const MEMORYMAPELEMENT* GetMap(const MEMORYMAP&, uint32);
 
-	MemoryMapListType m_instructionMap;
-	MemoryMapListType m_readMap;
-	MemoryMapListType m_writeMap;
+	MEMORYMAP m_instructionMap;
+	MEMORYMAP m_readMap;
+	MEMORYMAP m_writeMap;
 
 private:
-	static void InsertMap(MemoryMapListType&, uint32, uint32, void*, unsigned char);
-	static void InsertMap(MemoryMapListType&, uint32, uint32, const MemoryMapHandlerType&, unsigned char);
+	static void InsertMap(MEMORYMAP&, uint32, uint32, void*, unsigned char);
+	static void InsertMap(MEMORYMAP&, uint32, uint32, const MemoryMapHandlerType&, unsigned char);
+	static void InsertElement(MEMORYMAP&, MEMORYMAPELEMENT);
+	static const MEMORYMAPELEMENT* FindElement(const MemoryMapListType&, uint32);
 };
 
 class CMemoryMap_LSBF : public CMemoryMap
@@ -4,26 +4,53 @@
 
 #define LOG_NAME "MemoryMap"
 
+//Same lookup the JIT emits inline, lets accesses done from C++ (LWL/SWL, 64/128-bit
+//and miscellaneous proxies) skip the memory map when the address is in a mapped page
+static inline uint8* GetPagePointer(CMIPS* context, uint32 vAddress)
+{
+	if(!context->m_pageLookup) return nullptr;
+	auto page = reinterpret_cast<uint8*>(context->m_pageLookup[vAddress / MIPS_PAGE_SIZE]);
+	if(!page) return nullptr;
+	return page + (vAddress & (MIPS_PAGE_SIZE - 1));
+}
+
 uint32 MemoryUtils_GetByteProxy(CMIPS* context, uint32 vAddress)
 {
+	if(auto memory = GetPagePointer(context, vAddress))
+	{
+		return *reinterpret_cast<uint8*>(memory);
+	}
 	uint32 address = context->m_pAddrTranslator(context, vAddress);
 	return static_cast<uint32>(context->m_pMemoryMap->GetByte(address));
 }
 
 uint32 MemoryUtils_GetHalfProxy(CMIPS* context, uint32 vAddress)
 {
+	if(auto memory = GetPagePointer(context, vAddress))
+	{
+		return *reinterpret_cast<uint16*>(memory);
+	}
 	uint32 address = context->m_pAddrTranslator(context, vAddress);
 	return static_cast<uint32>(context->m_pMemoryMap->GetHalf(address));
 }
 
 uint32 MemoryUtils_GetWordProxy(CMIPS* context, uint32 vAddress)
 {
+	if(auto memory = GetPagePointer(context, vAddress))
+	{
+		return *reinterpret_cast<uint32*>(memory);
+	}
 	uint32 address = context->m_pAddrTranslator(context, vAddress);
 	return context->m_pMemoryMap->GetWord(address);
 }
 
 uint64 MemoryUtils_GetDoubleProxy(CMIPS* context, uint32 vAddress)
 {
+	if(auto memory = GetPagePointer(context, vAddress))
+	{
+		assert((vAddress & 0x07) == 0);
+		return *reinterpret_cast<uint64*>(memory);
+	}
 	uint32 address = context->m_pAddrTranslator(context, vAddress);
 	assert((address & 0x07) == 0);
 	auto e = context->m_pMemoryMap->GetReadMap(address);
@@ -54,6 +81,10 @@ uint64 MemoryUtils_GetDoubleProxy(CMIPS* context, uint32 vAddress)
 
 uint128 MemoryUtils_GetQuadProxy(CMIPS* context, uint32 vAddress)
 {
+	if(auto memory = GetPagePointer(context, vAddress & ~0x0F))
+	{
+		return *reinterpret_cast<uint128*>(memory);
+	}
 	uint32 address = context->m_pAddrTranslator(context, vAddress);
 	address &= ~0x0F;
 	auto e = context->m_pMemoryMap->GetReadMap(address);
@@ -84,24 +115,45 @@ uint128 MemoryUtils_GetQuadProxy(CMIPS* context, uint32 vAddress)
 
 void MemoryUtils_SetByteProxy(CMIPS* context, uint32 value, uint32 vAddress)
 {
+	if(auto memory = GetPagePointer(context, vAddress))
+	{
+		*reinterpret_cast<uint8*>(memory) = static_cast<uint8>(value);
+		return;
+	}
 	uint32 address = context->m_pAddrTranslator(context, vAddress);
 	context->m_pMemoryMap->SetByte(address, static_cast<uint8>(value));
 }
 
 void MemoryUtils_SetHalfProxy(CMIPS* context, uint32 value, uint32 vAddress)
 {
+	if(auto memory = GetPagePointer(context, vAddress))
+	{
+		*reinterpret_cast<uint16*>(memory) = static_cast<uint16>(value);
+		return;
+	}
 	uint32 address = context->m_pAddrTranslator(context, vAddress);
 	context->m_pMemoryMap->SetHalf(address, static_cast<uint16>(value));
 }
 
 void MemoryUtils_SetWordProxy(CMIPS* context, uint32 value, uint32 vAddress)
 {
+	if(auto memory = GetPagePointer(context, vAddress))
+	{
+		*reinterpret_cast<uint32*>(memory) = static_cast<uint32>(value);
+		return;
+	}
 	uint32 address = context->m_pAddrTranslator(context, vAddress);
 	context->m_pMemoryMap->SetWord(address, value);
 }
 
 void MemoryUtils_SetDoubleProxy(CMIPS* context, uint64 value64, uint32 vAddress)
 {
+	if(auto memory = GetPagePointer(context, vAddress))
+	{
+		assert((vAddress & 0x07) == 0);
+		*reinterpret_cast<uint64*>(memory) = value64;
+		return;
+	}
 	uint32 address = context->m_pAddrTranslator(context, vAddress);
 	assert((address & 0x07) == 0);
 	INTEGER64 value;
@@ -132,6 +184,11 @@ void MemoryUtils_SetDoubleProxy(CMIPS* context, uint64 value64, uint32 vAddress)
 
 void MemoryUtils_SetQuadProxy(CMIPS* context, const uint128& value, uint32 vAddress)
 {
+	if(auto memory = GetPagePointer(context, vAddress & ~0x0F))
+	{
+		*reinterpret_cast<uint128*>(memory) = value;
+		return;
+	}
 	uint32 address = context->m_pAddrTranslator(context, vAddress);
 	address &= ~0x0F;
 	auto e = context->m_pMemoryMap->GetWriteMap(address);
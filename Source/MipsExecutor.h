@@ -2,13 +2,33 @@
 
 #include "Types.h"
 
+class CJitBlockCache;
+
 class CMipsExecutor
 {
 public:
+	struct STATS
+	{
+		//Blocks compiled since last reset, including background compilation
+		uint32 compiledBlockCount = 0;
+		//Blocks that were loaded from the block cache instead of being compiled
+		uint32 cachedBlockCount = 0;
+		uint32 activeBlockCount = 0;
+		//Size of the host code generated for active blocks
+		uint64 activeCodeSize = 0;
+	};
+
 	virtual ~CMipsExecutor() = default;
 	virtual void Reset() = 0;
 	virtual int Execute(int) = 0;
 	virtual void ClearActiveBlocksInRange(uint32 start, uint32 end, bool executing) = 0;
+	//Lazy alternative to ClearActiveBlocksInRange, blocks are revalidated before next execution
+	virtual void NotifyCodeWrite(uint32 start, uint32 end) = 0;
+	virtual void SetBlockCache(CJitBlockCache*) = 0;
+	virtual void SetBackgroundCompilationEnabled(bool) = 0;
+
+	//Must not be called while the executor is running
+	virtual STATS GetStats() const = 0;
 
 #ifdef DEBUGGER_INCLUDED
 	virtual bool MustBreak() const = 0;
@@ -1,37 +1,50 @@
 #include <cassert>
 #include <cstring>
 #include "OpticalMedia.h"
+#include "ISO9660/AsyncBlockProvider.h"
 
 #define DVD_LAYER_MAX_BLOCKS 2295104
 
 COpticalMedia* COpticalMedia::CreateAuto(StreamPtr& stream)
 {
 	auto result = new COpticalMedia();
+
+	//Stream can't be used directly once the block provider's worker has started reading from it
+	uint64 imageSize = 0;
+	try
+	{
+		imageSize = stream->GetLength();
+	}
+	catch(...)
+	{
+		//Couldn't get stream size (ex.: physical disc)
+	}
+
 	//Simulate a disk with only one data track
 	try
 	{
-		auto blockProvider = std::make_shared<ISO9660::CBlockProvider2048>(stream);
-		result->m_fileSystem = std::make_unique<CISO9660>(blockProvider);
+		result->m_blockProvider = std::make_shared<ISO9660::CAsyncBlockProvider>(std::make_shared<ISO9660::CBlockProvider2048>(stream));
+		result->m_fileSystem = std::make_unique<CISO9660>(result->m_blockProvider);
 		result->m_track0DataType = TRACK_DATA_TYPE_MODE1_2048;
 	}
 	catch(...)
 	{
 		//Failed with block size 2048, try with CD-ROM XA
-		auto blockProvider = std::make_shared<ISO9660::CBlockProviderCDROMXA>(stream);
-		result->m_fileSystem = std::make_unique<CISO9660>(blockProvider);
+		result->m_blockProvider = std::make_shared<ISO9660::CAsyncBlockProvider>(std::make_shared<ISO9660::CBlockProviderCDROMXA>(stream));
+		result->m_fileSystem = std::make_unique<CISO9660>(result->m_blockProvider);
 		result->m_track0DataType = TRACK_DATA_TYPE_MODE2_2352;
 	}
 
-	if(result->m_track0DataType == TRACK_DATA_TYPE_MODE1_2048)
+	if((result->m_track0DataType == TRACK_DATA_TYPE_MODE1_2048) && (imageSize != 0))
 	{
 		try
 		{
-			result->CheckDualLayerDvd(stream);
-			result->SetupSecondLayer(stream);
+			result->CheckDualLayerDvd(imageSize);
+			result->SetupSecondLayer();
 		}
 		catch(...)
 		{
-			//Failed to check if we got a dual layer DVD (ex.: Couldn't get stream size of physical disc)
+			//Failed to check if we got a dual layer DVD
 		}
 	}
 	return result;
@@ -40,12 +53,12 @@ COpticalMedia* COpticalMedia::CreateAuto(StreamPtr& stream)
 COpticalMedia* COpticalMedia::CreateDvd(StreamPtr& stream, bool isDualLayer, uint32 secondLayerStart)
 {
 	auto result = new COpticalMedia();
-	auto blockProvider = std::make_shared<ISO9660::CBlockProvider2048>(stream);
-	result->m_fileSystem = std::make_unique<CISO9660>(blockProvider);
+	result->m_blockProvider = std::make_shared<ISO9660::CAsyncBlockProvider>(std::make_shared<ISO9660::CBlockProvider2048>(stream));
+	result->m_fileSystem = std::make_unique<CISO9660>(result->m_blockProvider);
 	result->m_track0DataType = TRACK_DATA_TYPE_MODE1_2048;
 	result->m_dvdIsDualLayer = isDualLayer;
 	result->m_dvdSecondLayerStart = secondLayerStart;
-	result->SetupSecondLayer(stream);
+	result->SetupSecondLayer();
 	return result;
 }
 
@@ -77,12 +90,11 @@ uint32 COpticalMedia::GetDvdSecondLayerStart() const
 	return m_dvdSecondLayerStart - 0x10;
 }
 
-void COpticalMedia::CheckDualLayerDvd(const StreamPtr& stream)
+void COpticalMedia::CheckDualLayerDvd(uint64 imageSize)
 {
 	//Heuristic to detect dual layer DVD disc images
 
 	static const uint32 blockSize = 2048;
-	auto imageSize = stream->GetLength();
 	uint32 imageBlockCount = static_cast<uint32>(imageSize / blockSize);
 
 	//DL discs may be smaller than the capacity of a SL DVD, but we assume
@@ -100,33 +112,30 @@ void COpticalMedia::CheckDualLayerDvd(const StreamPtr& stream)
 	//larger than the first one? That's why we start looking at 15 / 32 of the image's size
 
 	auto searchBlockAddress = imageBlockCount * 15 / 32;
-	stream->Seek(static_cast<uint64>(searchBlockAddress) * blockSize, Framework::STREAM_SEEK_SET);
 
 	//Scan all blocks from the search point, looking for a valid ISO9660 descriptor
+	//Blocks are read sequentially, the block provider will read ahead
 	for(auto lba = searchBlockAddress; lba < imageBlockCount; lba++)
 	{
-		static const uint32 blockHeaderSize = 6;
-		static_assert(blockSize >= blockHeaderSize, "Block header size is too large");
-		char blockHeader[blockHeaderSize];
-		stream->Read(blockHeader, blockHeaderSize);
+		char block[blockSize];
+		m_blockProvider->ReadBlock(lba, block);
 		if(
-		    (blockHeader[0] == 0x01) &&
-		    (!strncmp(blockHeader + 1, "CD001", 5)))
+		    (block[0] == 0x01) &&
+		    (!strncmp(block + 1, "CD001", 5)))
 		{
 			//We've found a valid ISO9660 descriptor
 			m_dvdSecondLayerStart = lba;
 			break;
 		}
-		stream->Seek(blockSize - blockHeaderSize, Framework::STREAM_SEEK_CUR);
 	}
 
 	//If we haven't found it, something's wrong
 	assert(m_dvdSecondLayerStart != 0);
 }
 
-void COpticalMedia::SetupSecondLayer(const StreamPtr& stream)
+void COpticalMedia::SetupSecondLayer()
 {
 	if(!m_dvdIsDualLayer) return;
-	auto blockProvider = std::make_shared<ISO9660::CBlockProvider2048>(stream, GetDvdSecondLayerStart());
+	auto blockProvider = std::make_shared<ISO9660::CBlockProviderOffset>(m_blockProvider, GetDvdSecondLayerStart());
 	m_fileSystemL1 = std::make_unique<CISO9660>(blockProvider);
 }
@@ -30,13 +30,15 @@ private:
 	COpticalMedia() = default;
 
 	typedef std::unique_ptr<CISO9660> Iso9660Ptr;
+	typedef std::shared_ptr<ISO9660::CBlockProvider> BlockProviderPtr;
 
-	void CheckDualLayerDvd(const StreamPtr&);
-	void SetupSecondLayer(const StreamPtr&);
+	void CheckDualLayerDvd(uint64);
+	void SetupSecondLayer();
 
 	TRACK_DATA_TYPE m_track0DataType = TRACK_DATA_TYPE_MODE1_2048;
 	bool m_dvdIsDualLayer = false;
 	uint32 m_dvdSecondLayerStart = 0;
+	BlockProviderPtr m_blockProvider;
 	Iso9660Ptr m_fileSystem;
 	Iso9660Ptr m_fileSystemL1;
 };
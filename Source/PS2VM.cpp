@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <algorithm>
 #include <exception>
 #include <memory>
 #include <fenv.h>
@@ -11,8 +12,11 @@
 #include "ee/EeExecutor.h"
 #include "Ps2Const.h"
 #include "iop/Iop_SifManPs2.h"
+#include "iop/Iop_SpuKernels.h"
 #include "StdStream.h"
 #include "StdStreamUtils.h"
+#include "MemStream.h"
+#include "PtrStream.h"
 #include "GZipStream.h"
 #include "states/MemoryStateFile.h"
 #include "zip/ZipArchiveWriter.h"
@@ -26,6 +30,7 @@
 #include "iop/DirectoryDevice.h"
 #include "iop/OpticalMediaDevice.h"
 #include "Log.h"
+#include "Trace.h"
 #include "ISO9660/BlockProvider.h"
 #include "DiskUtils.h"
 
@@ -35,6 +40,8 @@
 #define PREF_PS2_MC0_DIRECTORY_DEFAULT ("vfs/mc0")
 #define PREF_PS2_MC1_DIRECTORY_DEFAULT ("vfs/mc1")
 
+#define JITCACHE_PATH ("jitcache/")
+
 #define FRAME_TICKS (PS2::EE_CLOCK_FREQ / 60)
 #define ONSCREEN_TICKS (FRAME_TICKS * 9 / 10)
 #define VBLANK_TICKS (FRAME_TICKS / 10)
@@ -88,11 +95,40 @@ CPS2VM::CPS2VM()
 	m_iop = std::make_unique<Iop::CSubSystem>(true);
 	auto iopOs = dynamic_cast<CIopBios*>(m_iop->m_bios.get());
 
-	m_ee = std::make_unique<Ee::CSubSystem>(m_iop->m_ram, *iopOs);
+	CAppConfig::GetInstance().RegisterPreferenceBoolean(PREF_PS2_EE_FASTMEM, false);
+	m_ee = std::make_unique<Ee::CSubSystem>(m_iop->m_ram, *iopOs, CAppConfig::GetInstance().GetPreferenceBoolean(PREF_PS2_EE_FASTMEM));
+	m_ee->m_sif.SetIopRamWriteHandler([this](uint32 start, uint32 end) { m_iop->m_cpu.m_executor->NotifyCodeWrite(start, end); });
+	m_ee->m_sif.SetIopSyncHandler([this]() { SyncIop(); });
 	m_OnRequestLoadExecutableConnection = m_ee->m_os->OnRequestLoadExecutable.Connect(std::bind(&CPS2VM::ReloadExecutable, this, std::placeholders::_1, std::placeholders::_2));
+	m_OnExecutableChangeConnection = m_ee->m_os->OnExecutableChange.Connect(std::bind(&CPS2VM::OpenBlockCaches, this));
+	m_OnExecutableUnloadingConnection = m_ee->m_os->OnExecutableUnloading.Connect(std::bind(&CPS2VM::CloseBlockCaches, this));
+
+	CAppConfig::GetInstance().RegisterPreferenceBoolean(PREF_PS2_JITCACHE_ENABLED, false);
+	CAppConfig::GetInstance().RegisterPreferenceBoolean(PREF_PS2_JIT_BACKGROUNDCOMPILE, false);
+	{
+		bool backgroundCompile = CAppConfig::GetInstance().GetPreferenceBoolean(PREF_PS2_JIT_BACKGROUNDCOMPILE);
+		m_ee->m_EE.m_executor->SetBackgroundCompilationEnabled(backgroundCompile);
+		m_iop->m_cpu.m_executor->SetBackgroundCompilationEnabled(backgroundCompile);
+	}
+
+	CAppConfig::GetInstance().RegisterPreferenceBoolean(PREF_PS2_VU1_THREADED, false);
+	m_ee->m_vpu1->SetExecutionThreadEnabled(CAppConfig::GetInstance().GetPreferenceBoolean(PREF_PS2_VU1_THREADED));
+
+	CAppConfig::GetInstance().RegisterPreferenceBoolean(PREF_PS2_IOP_THREADED, false);
+	CAppConfig::GetInstance().RegisterPreferenceInteger(PREF_PS2_IOP_MAXSKEWTICKS, IOP_MAXSKEWTICKS_DEFAULT);
+	m_iopThreadEnabled = CAppConfig::GetInstance().GetPreferenceBoolean(PREF_PS2_IOP_THREADED) && IsIopThreadSupported();
+	m_iopMaxSkewTicks = std::max<int>(0, CAppConfig::GetInstance().GetPreferenceInteger(PREF_PS2_IOP_MAXSKEWTICKS));
 
 	CAppConfig::GetInstance().RegisterPreferenceInteger(PREF_AUDIO_SPUBLOCKCOUNT, 100);
-	m_spuBlockCount = CAppConfig::GetInstance().GetPreferenceInteger(PREF_AUDIO_SPUBLOCKCOUNT);
+	CAppConfig::GetInstance().RegisterPreferenceBoolean(PREF_AUDIO_THREADED, true);
+	m_soundOutput.SetWriteBlockCount(CAppConfig::GetInstance().GetPreferenceInteger(PREF_AUDIO_SPUBLOCKCOUNT));
+
+	CAppConfig::GetInstance().RegisterPreferenceBoolean(PREF_PS2_REWIND_ENABLED, false);
+	CAppConfig::GetInstance().RegisterPreferenceInteger(PREF_PS2_REWIND_INTERVAL, REWIND_INTERVAL_DEFAULT);
+	CAppConfig::GetInstance().RegisterPreferenceInteger(PREF_PS2_REWIND_MEMORYLIMIT, REWIND_MEMORYLIMIT_DEFAULT);
+	m_rewindEnabled = CAppConfig::GetInstance().GetPreferenceBoolean(PREF_PS2_REWIND_ENABLED);
+	m_rewindInterval = std::max<int>(1, CAppConfig::GetInstance().GetPreferenceInteger(PREF_PS2_REWIND_INTERVAL));
+	m_rewindBuffer.SetMemoryLimit(static_cast<size_t>(std::max<int>(1, CAppConfig::GetInstance().GetPreferenceInteger(PREF_PS2_REWIND_MEMORYLIMIT))) * 0x100000);
 }
 
 //////////////////////////////////////////////////
@@ -142,10 +178,9 @@ void CPS2VM::ReloadSpuBlockCount()
 {
 	m_mailBox.SendCall(
 	    [this]() {
-		    m_currentSpuBlock = 0;
 		    auto spuBlockCount = CAppConfig::GetInstance().GetPreferenceInteger(PREF_AUDIO_SPUBLOCKCOUNT);
 		    assert(spuBlockCount <= BLOCK_COUNT);
-		    m_spuBlockCount = spuBlockCount;
+		    m_soundOutput.SetWriteBlockCount(spuBlockCount);
 	    });
 }
 
@@ -155,6 +190,11 @@ void CPS2VM::DestroySoundHandler()
 	m_mailBox.SendCall([this]() { DestroySoundHandlerImpl(); }, true);
 }
 
+void CPS2VM::SetDeterministicExecution(bool deterministicExecution)
+{
+	m_mailBox.SendCall([this, deterministicExecution]() { m_deterministicExecution = deterministicExecution; }, true);
+}
+
 CVirtualMachine::STATUS CPS2VM::GetStatus() const
 {
 	return m_nStatus;
@@ -242,6 +282,11 @@ fs::path CPS2VM::GetStateDirectoryPath()
 	return CAppConfig::GetBasePath() / fs::path("states/");
 }
 
+fs::path CPS2VM::GetJitCacheDirectoryPath()
+{
+	return CAppConfig::GetBasePath() / fs::path(JITCACHE_PATH);
+}
+
 fs::path CPS2VM::GenerateStatePath(unsigned int slot) const
 {
 	auto stateFileName = string_format("%s.st%d.zip", m_ee->m_os->GetExecutableName(), slot);
@@ -272,6 +317,18 @@ std::future<bool> CPS2VM::LoadState(const fs::path& statePath)
 	return future;
 }
 
+std::future<bool> CPS2VM::Rewind()
+{
+	auto promise = std::make_shared<std::promise<bool>>();
+	auto future = promise->get_future();
+	m_mailBox.SendCall(
+	    [this, promise]() {
+		    auto result = RewindImpl();
+		    promise->set_value(result);
+	    });
+	return future;
+}
+
 void CPS2VM::TriggerFrameDump(const FrameDumpCallback& frameDumpCallback)
 {
 	m_mailBox.SendCall(
@@ -375,6 +432,8 @@ void CPS2VM::CreateVM()
 
 void CPS2VM::ResetVM()
 {
+	SyncIop();
+
 	m_ee->Reset();
 	m_iop->Reset();
 
@@ -407,15 +466,18 @@ void CPS2VM::ResetVM()
 
 	m_eeExecutionTicks = 0;
 	m_iopExecutionTicks = 0;
+	m_eeCycleCount = 0;
+	m_iopCycleCount = 0;
 
 	m_spuUpdateTicks = SPU_UPDATE_TICKS;
-	m_currentSpuBlock = 0;
 
 	RegisterModulesInPadHandler();
+	ResetRewindBuffer();
 }
 
 void CPS2VM::DestroyVM()
 {
+	CloseBlockCaches();
 	CDROM0_Reset();
 }
 
@@ -477,6 +539,108 @@ bool CPS2VM::LoadVMState(const fs::path& statePath)
 		return false;
 	}
 
+	//Start over from the loaded state
+	ResetRewindBuffer();
+	OnMachineStateChange();
+
+	return true;
+}
+
+void CPS2VM::ResetRewindBuffer()
+{
+	m_rewindBuffer.Reset();
+	m_rewindFrameCount = 0;
+	if(!m_rewindEnabled) return;
+
+	//EE RAM is by far the largest region, only look at pages that were written to
+	auto eeExecutor = static_cast<CEeExecutor*>(m_ee->m_EE.m_executor.get());
+	if(eeExecutor->StartDirtyPageTracking())
+	{
+		m_rewindBuffer.AddRegion(m_ee->m_ram, PS2::EE_RAM_SIZE, eeExecutor->GetPageSize(),
+		                         [eeExecutor](std::vector<uint32>& pages) { eeExecutor->CollectDirtyPages(pages); });
+	}
+	else
+	{
+		m_rewindBuffer.AddRegion(m_ee->m_ram, PS2::EE_RAM_SIZE);
+	}
+	m_rewindBuffer.AddRegion(m_ee->m_spr, PS2::EE_SPR_SIZE);
+	m_rewindBuffer.AddRegion(m_ee->m_vuMem0, PS2::VUMEM0SIZE);
+	m_rewindBuffer.AddRegion(m_ee->m_microMem0, PS2::MICROMEM0SIZE);
+	m_rewindBuffer.AddRegion(m_ee->m_vuMem1, PS2::VUMEM1SIZE);
+	m_rewindBuffer.AddRegion(m_ee->m_microMem1, PS2::MICROMEM1SIZE);
+	//IOP RAM is written by too many paths (JIT, HLE modules, SIF, host file reads) to be tracked
+	m_rewindBuffer.AddRegion(m_iop->m_ram, PS2::IOP_RAM_SIZE);
+	m_rewindBuffer.AddRegion(m_iop->m_scratchPad, PS2::IOP_SCRATCH_SIZE);
+	auto spuRamTracker = &m_iop->m_spuRamTracker;
+	m_rewindBuffer.AddRegion(m_iop->m_spuRam, PS2::SPU_RAM_SIZE, spuRamTracker->GetPageSize(),
+	                         [spuRamTracker](std::vector<uint32>& pages) { spuRamTracker->CollectDirtyPages(pages); });
+	if(m_ee->m_gs != NULL)
+	{
+		if(auto gsRamTracker = m_ee->m_gs->GetRamTracker())
+		{
+			m_rewindBuffer.AddRegion(m_ee->m_gs->GetRam(), CGSHandler::RAMSIZE, gsRamTracker->GetPageSize(),
+			                         [gsRamTracker](std::vector<uint32>& pages) { gsRamTracker->CollectDirtyPages(pages); });
+		}
+		else
+		{
+			m_rewindBuffer.AddRegion(m_ee->m_gs->GetRam(), CGSHandler::RAMSIZE);
+		}
+	}
+}
+
+void CPS2VM::CaptureRewindSnapshot()
+{
+	if(m_ee->m_gs == NULL) return;
+
+	try
+	{
+		//Only registers and HLE state go through the stream, memory is handled by the rewind buffer
+		Framework::CMemStream stateStream;
+
+		m_ee->SaveDeviceState(stateStream);
+		m_iop->SaveDeviceState(stateStream);
+		m_ee->m_gs->SaveDeviceState(stateStream);
+
+		//Make sure the GS thread is done with its RAM before it gets copied
+		m_ee->m_gs->WaitForIdle();
+
+		CRewindBuffer::DeviceState deviceState(stateStream.GetBuffer(), stateStream.GetBuffer() + stateStream.GetSize());
+		m_rewindBuffer.Capture(std::move(deviceState));
+	}
+	catch(const std::exception& exception)
+	{
+		CLog::GetInstance().Warn(LOG_NAME, "Failed to capture rewind snapshot: %s\r\n", exception.what());
+	}
+}
+
+bool CPS2VM::RewindImpl()
+{
+	if(m_ee->m_gs == NULL) return false;
+	if(m_rewindBuffer.GetSnapshotCount() == 0) return false;
+
+	//Compiled code doesn't survive the RAM being replaced, this also unprotects RAM
+	m_ee->m_EE.m_executor->Reset();
+	m_ee->m_gs->WaitForIdle();
+
+	CRewindBuffer::DeviceState deviceState;
+	m_rewindBuffer.Rewind(deviceState);
+
+	try
+	{
+		Framework::CPtrStream stateStream(deviceState.data(), deviceState.size());
+
+		m_ee->LoadDeviceState(stateStream);
+		m_iop->LoadDeviceState(stateStream);
+		m_ee->m_gs->LoadDeviceState(stateStream);
+	}
+	catch(...)
+	{
+		//Memory was already restored, machine is in an inconsistent state
+		PauseImpl();
+		return false;
+	}
+
+	m_rewindFrameCount = 0;
 	OnMachineStateChange();
 
 	return true;
@@ -485,6 +649,9 @@ bool CPS2VM::LoadVMState(const fs::path& statePath)
 void CPS2VM::PauseImpl()
 {
 	m_nStatus = PAUSED;
+	//Good time to persist blocks compiled so far
+	m_eeBlockCache.Flush();
+	m_iopBlockCache.Flush();
 }
 
 void CPS2VM::ResumeImpl()
@@ -518,6 +685,7 @@ void CPS2VM::CreateGsHandlerImpl(const CGSHandler::FactoryFunction& factoryFunct
 		delete gs;
 	}
 	m_OnNewFrameConnection = m_ee->m_gs->OnNewFrame.Connect(std::bind(&CPS2VM::OnGsNewFrame, this));
+	ResetRewindBuffer();
 }
 
 void CPS2VM::DestroyGsHandlerImpl()
@@ -526,6 +694,7 @@ void CPS2VM::DestroyGsHandlerImpl()
 	m_ee->m_gs->Release();
 	delete m_ee->m_gs;
 	m_ee->m_gs = nullptr;
+	ResetRewindBuffer();
 }
 
 void CPS2VM::CreatePadHandlerImpl(const CPadHandler::FactoryFunction& factoryFunction)
@@ -544,6 +713,7 @@ void CPS2VM::DestroyPadHandlerImpl()
 void CPS2VM::CreateSoundHandlerImpl(const CSoundHandler::FactoryFunction& factoryFunction)
 {
 	m_soundHandler = factoryFunction();
+	m_soundOutput.SetSoundHandler(m_soundHandler, CAppConfig::GetInstance().GetPreferenceBoolean(PREF_AUDIO_THREADED));
 }
 
 CSoundHandler* CPS2VM::GetSoundHandler()
@@ -554,6 +724,7 @@ CSoundHandler* CPS2VM::GetSoundHandler()
 void CPS2VM::DestroySoundHandlerImpl()
 {
 	if(m_soundHandler == nullptr) return;
+	m_soundOutput.SetSoundHandler(nullptr, false);
 	delete m_soundHandler;
 	m_soundHandler = nullptr;
 }
@@ -605,6 +776,7 @@ void CPS2VM::UpdateEe()
 		m_ee->m_vpu1->Execute(m_singleStepVu1 ? 1 : executed);
 
 		m_eeExecutionTicks -= executed;
+		m_eeCycleCount += executed;
 		m_ee->CountTicks(executed);
 		m_vblankTicks -= executed;
 
@@ -636,6 +808,7 @@ void CPS2VM::UpdateIop()
 #endif
 
 		m_iopExecutionTicks -= executed;
+		m_iopCycleCount += executed;
 		m_spuUpdateTicks -= executed;
 		m_iop->CountTicks(executed);
 
@@ -652,40 +825,105 @@ void CPS2VM::UpdateSpu()
 	CProfilerZone profilerZone(m_spuProfilerZone);
 #endif
 
-	unsigned int blockOffset = (BLOCK_SIZE * m_currentSpuBlock);
-	int16* samplesSpu0 = m_samples + blockOffset;
-
+	//Rendering updates state the IOP can observe (IRQs, ENDX, voice addresses), so it stays
+	//in step with emulation. Only writing to the backend is handed off to another thread.
+	int16 samplesSpu0[BLOCK_SIZE];
 	m_iop->m_spuCore0.Render(samplesSpu0, BLOCK_SIZE, DST_SAMPLE_RATE);
 
 	if(m_iop->m_spuCore1.IsEnabled())
 	{
 		int16 samplesSpu1[BLOCK_SIZE];
 		m_iop->m_spuCore1.Render(samplesSpu1, BLOCK_SIZE, DST_SAMPLE_RATE);
+		SpuKernels::MixSaturate(samplesSpu0, samplesSpu1, BLOCK_SIZE);
+	}
 
-		for(unsigned int i = 0; i < BLOCK_SIZE; i++)
-		{
-			int32 resultSample = static_cast<int32>(samplesSpu0[i]) + static_cast<int32>(samplesSpu1[i]);
-			resultSample = std::max<int32>(resultSample, SHRT_MIN);
-			resultSample = std::min<int32>(resultSample, SHRT_MAX);
-			samplesSpu0[i] = static_cast<int16>(resultSample);
-		}
+	if(m_soundHandler)
+	{
+		m_soundOutput.Write(samplesSpu0, BLOCK_SIZE, DST_SAMPLE_RATE);
+	}
+}
+
+bool CPS2VM::IsIopThreadSupported()
+{
+#if defined(__APPLE__) || defined(PROFILE)
+	//EE memory protection faults are caught per thread on macOS and the profiler
+	//expects all zones to be entered from the emulation thread.
+	return false;
+#else
+	return true;
+#endif
+}
+
+bool CPS2VM::IsIopThreadActive() const
+{
+	return m_iopThread.joinable() && !m_deterministicExecution && !m_singleStepIop;
+}
+
+void CPS2VM::StartIopThread()
+{
+	assert(!m_iopThread.joinable());
+	m_iopThreadEnd = false;
+	m_iopGrantedTicks = 0;
+	m_iopThread = std::thread([this]() { IopThreadProc(); });
+	m_iopThreadId = m_iopThread.get_id();
+}
+
+void CPS2VM::StopIopThread()
+{
+	if(!m_iopThread.joinable()) return;
+	{
+		std::unique_lock<std::mutex> iopThreadLock(m_iopThreadMutex);
+		m_iopThreadEnd = true;
+		m_iopThreadCondition.notify_all();
 	}
+	m_iopThread.join();
+	m_iopThreadId = std::thread::id();
+}
 
-	m_currentSpuBlock++;
-	if(m_currentSpuBlock == m_spuBlockCount)
+void CPS2VM::IopThreadProc()
+{
+	fesetround(FE_TOWARDZERO);
+	FpUtils::SetDenormalHandlingMode();
+	CTrace::SetThreadName("iop");
+	CTrace::SetThreadCycleCounter(&m_iopCycleCount);
+	std::unique_lock<std::mutex> iopThreadLock(m_iopThreadMutex);
+	while(1)
 	{
-		if(m_soundHandler)
+		m_iopThreadCondition.wait(iopThreadLock, [this]() { return m_iopThreadEnd || (m_iopGrantedTicks != 0); });
+		if(m_iopThreadEnd) break;
+		int grantedTicks = m_iopGrantedTicks;
+		iopThreadLock.unlock();
+
+		m_iopExecutionTicks += grantedTicks;
+		UpdateIop();
+		while(m_spuUpdateTicks <= 0)
 		{
-			if(m_soundHandler->HasFreeBuffers())
-			{
-				m_soundHandler->RecycleBuffers();
-			}
-			m_soundHandler->Write(m_samples, BLOCK_SIZE * m_spuBlockCount, DST_SAMPLE_RATE);
+			UpdateSpu();
+			m_spuUpdateTicks += SPU_UPDATE_TICKS;
 		}
-		m_currentSpuBlock = 0;
+
+		iopThreadLock.lock();
+		m_iopGrantedTicks -= grantedTicks;
+		m_iopThreadCondition.notify_all();
 	}
 }
 
+void CPS2VM::GrantIopTicks(int ticks)
+{
+	std::unique_lock<std::mutex> iopThreadLock(m_iopThreadMutex);
+	m_iopGrantedTicks += ticks;
+	m_iopThreadCondition.notify_all();
+	m_iopThreadCondition.wait(iopThreadLock, [this]() { return m_iopGrantedTicks <= m_iopMaxSkewTicks; });
+}
+
+void CPS2VM::SyncIop()
+{
+	if(!m_iopThread.joinable()) return;
+	if(std::this_thread::get_id() == m_iopThreadId) return;
+	std::unique_lock<std::mutex> iopThreadLock(m_iopThreadMutex);
+	m_iopThreadCondition.wait(iopThreadLock, [this]() { return m_iopGrantedTicks == 0; });
+}
+
 void CPS2VM::CDROM0_SyncPath()
 {
 	//TODO: Check if there's an m_cdrom0 already
@@ -735,6 +973,35 @@ void CPS2VM::RegisterModulesInPadHandler()
 	m_pad->InsertListener(&m_iop->m_sio2);
 }
 
+void CPS2VM::OpenBlockCaches()
+{
+	CloseBlockCaches();
+
+	if(!CAppConfig::GetInstance().GetPreferenceBoolean(PREF_PS2_JITCACHE_ENABLED)) return;
+
+	auto cacheName = std::string(m_ee->m_os->GetExecutableName());
+	std::replace_if(
+	    cacheName.begin(), cacheName.end(), [](char c) { return (c == ';') || (c == '/') || (c == '\\') || (c == ':'); }, '_');
+	if(cacheName.empty()) return;
+
+	auto cachePath = GetJitCacheDirectoryPath();
+	Framework::PathUtils::EnsurePathExists(cachePath);
+
+	//Blocks compiled for fastmem can't be used without it (and vice versa)
+	m_eeBlockCache.Open(cachePath / (cacheName + (m_ee->m_fastMemArena ? ".ee.fastmem.jit" : ".ee.jit")));
+	m_iopBlockCache.Open(cachePath / (cacheName + ".iop.jit"));
+	m_ee->m_EE.m_executor->SetBlockCache(&m_eeBlockCache);
+	m_iop->m_cpu.m_executor->SetBlockCache(&m_iopBlockCache);
+}
+
+void CPS2VM::CloseBlockCaches()
+{
+	m_ee->m_EE.m_executor->SetBlockCache(nullptr);
+	m_iop->m_cpu.m_executor->SetBlockCache(nullptr);
+	m_eeBlockCache.Close();
+	m_iopBlockCache.Close();
+}
+
 void CPS2VM::ReloadExecutable(const char* executablePath, const CPS2OS::ArgumentList& arguments)
 {
 	ResetVM();
@@ -746,12 +1013,22 @@ void CPS2VM::EmuThread()
 	fesetround(FE_TOWARDZERO);
 	FpUtils::SetDenormalHandlingMode();
 	CProfiler::GetInstance().SetWorkThread();
+	CTrace::SetThreadName("ee");
+	CTrace::SetThreadCycleCounter(&m_eeCycleCount);
 #ifdef PROFILE
 	CProfilerZone profilerZone(m_otherProfilerZone);
 #endif
 	static_cast<CEeExecutor*>(m_ee->m_EE.m_executor.get())->AddExceptionHandler();
+	if(m_iopThreadEnabled)
+	{
+		StartIopThread();
+	}
 	while(1)
 	{
+		if(m_mailBox.IsPending())
+		{
+			SyncIop();
+		}
 		while(m_mailBox.IsPending())
 		{
 			m_mailBox.ReceiveCall();
@@ -763,7 +1040,9 @@ void CPS2VM::EmuThread()
 		}
 		if(m_nStatus == RUNNING)
 		{
-			if(m_spuUpdateTicks <= 0)
+			bool iopThreadActive = IsIopThreadActive();
+
+			if(!iopThreadActive && (m_spuUpdateTicks <= 0))
 			{
 				UpdateSpu();
 				m_spuUpdateTicks += SPU_UPDATE_TICKS;
@@ -774,6 +1053,7 @@ void CPS2VM::EmuThread()
 				//Check vblank stuff
 				if(m_vblankTicks <= 0)
 				{
+					SyncIop();
 					m_inVblank = !m_inVblank;
 					if(m_inVblank)
 					{
@@ -793,6 +1073,14 @@ void CPS2VM::EmuThread()
 						{
 							m_pad->Update(m_ee->m_ram);
 						}
+
+						if(m_rewindEnabled && (++m_rewindFrameCount >= m_rewindInterval))
+						{
+							m_rewindFrameCount = 0;
+							CaptureRewindSnapshot();
+						}
+
+						FrameDone();
 #ifdef PROFILE
 						{
 							CProfiler::GetInstance().CountCurrentZone();
@@ -819,12 +1107,24 @@ void CPS2VM::EmuThread()
 				//EE CPU is 8 times faster than the IOP CPU
 				static const int tickStep = 4800;
 				m_eeExecutionTicks += tickStep;
-				m_iopExecutionTicks += tickStep / 8;
 
-				UpdateEe();
-				UpdateIop();
+				if(iopThreadActive)
+				{
+					GrantIopTicks(tickStep / 8);
+					UpdateEe();
+				}
+				else
+				{
+					m_iopExecutionTicks += tickStep / 8;
+					UpdateEe();
+					UpdateIop();
+				}
 			}
 #ifdef DEBUGGER_INCLUDED
+			if(iopThreadActive)
+			{
+				SyncIop();
+			}
 			if(
 			    m_ee->m_EE.m_executor->MustBreak() ||
 			    m_iop->m_cpu.m_executor->MustBreak() ||
@@ -842,5 +1142,6 @@ void CPS2VM::EmuThread()
 #endif
 		}
 	}
+	StopIopThread();
 	static_cast<CEeExecutor*>(m_ee->m_EE.m_executor.get())->RemoveExceptionHandler();
 }
@@ -2,6 +2,8 @@
 
 #include <thread>
 #include <future>
+#include <mutex>
+#include <condition_variable>
 #include "filesystem_def.h"
 #include "AppDef.h"
 #include "Types.h"
@@ -13,8 +15,11 @@
 #include "ee/Ee_SubSystem.h"
 #include "iop/Iop_SubSystem.h"
 #include "../tools/PsfPlayer/Source/SoundHandler.h"
+#include "SoundOutput.h"
+#include "RewindBuffer.h"
 #include "FrameDump.h"
 #include "Profiler.h"
+#include "JitBlockCache.h"
 
 class CPS2VM : public CVirtualMachine
 {
@@ -32,6 +37,7 @@ public:
 	typedef std::unique_ptr<Iop::CSubSystem> IopSubSystemPtr;
 	typedef std::function<void(const CFrameDump&)> FrameDumpCallback;
 	typedef Framework::CSignal<void(const CProfiler::ZoneArray&)> ProfileFrameDoneSignal;
+	typedef Framework::CSignal<void()> FrameDoneSignal;
 
 	CPS2VM();
 	virtual ~CPS2VM() = default;
@@ -67,11 +73,18 @@ public:
 	void ReloadSpuBlockCount();
 
 	static fs::path GetStateDirectoryPath();
+	static fs::path GetJitCacheDirectoryPath();
 	fs::path GenerateStatePath(unsigned int) const;
 
 	std::future<bool> SaveState(const fs::path&);
 	std::future<bool> LoadState(const fs::path&);
 
+	//Goes back to the latest in-memory snapshot, snapshots are taken periodically if enabled
+	std::future<bool> Rewind();
+
+	//Forces lock-step EE/IOP execution even if the IOP thread is enabled (ie.: for replays)
+	void SetDeterministicExecution(bool);
+
 	void TriggerFrameDump(const FrameDumpCallback&);
 
 	CPU_UTILISATION_INFO GetCpuUtilisationInfo() const;
@@ -89,6 +102,9 @@ public:
 
 	ProfileFrameDoneSignal ProfileFrameDone;
 
+	//Emitted from the emulation thread at every vblank start
+	FrameDoneSignal FrameDone;
+
 private:
 	typedef std::unique_ptr<COpticalMedia> OpticalMediaPtr;
 
@@ -98,6 +114,10 @@ private:
 	bool SaveVMState(const fs::path&);
 	bool LoadVMState(const fs::path&);
 
+	void ResetRewindBuffer();
+	void CaptureRewindSnapshot();
+	bool RewindImpl();
+
 	void ReloadExecutable(const char*, const CPS2OS::ArgumentList&);
 
 	void ResumeImpl();
@@ -117,6 +137,14 @@ private:
 	void UpdateIop();
 	void UpdateSpu();
 
+	static bool IsIopThreadSupported();
+	bool IsIopThreadActive() const;
+	void StartIopThread();
+	void StopIopThread();
+	void IopThreadProc();
+	void GrantIopTicks(int);
+	void SyncIop();
+
 	void OnGsNewFrame();
 
 	void CDROM0_SyncPath();
@@ -125,6 +153,9 @@ private:
 
 	void RegisterModulesInPadHandler();
 
+	void OpenBlockCaches();
+	void CloseBlockCaches();
+
 	void EmuThread();
 
 	std::thread m_thread;
@@ -138,6 +169,23 @@ private:
 	int m_eeExecutionTicks = 0;
 	int m_iopExecutionTicks = 0;
 
+	//Total executed cycles, used to timestamp trace records
+	uint64 m_eeCycleCount = 0;
+	uint64 m_iopCycleCount = 0;
+
+	//IOP thread state. The EE thread grants IOP ticks and waits when the IOP
+	//falls behind by more than m_iopMaxSkewTicks. SyncIop waits until all granted
+	//ticks have been executed, which leaves the IOP idle until the next grant.
+	std::thread m_iopThread;
+	std::thread::id m_iopThreadId;
+	std::mutex m_iopThreadMutex;
+	std::condition_variable m_iopThreadCondition;
+	int m_iopGrantedTicks = 0;
+	int m_iopMaxSkewTicks = 0;
+	bool m_iopThreadEnabled = false;
+	bool m_iopThreadEnd = false;
+	bool m_deterministicExecution = false;
+
 	CPU_UTILISATION_INFO m_cpuUtilisation;
 
 	bool m_singleStepEe;
@@ -152,6 +200,25 @@ private:
 
 	OpticalMediaPtr m_cdrom0;
 
+	CJitBlockCache m_eeBlockCache;
+	CJitBlockCache m_iopBlockCache;
+
+	CRewindBuffer m_rewindBuffer;
+	bool m_rewindEnabled = false;
+	int m_rewindInterval = 0;
+	int m_rewindFrameCount = 0;
+
+	enum
+	{
+		IOP_MAXSKEWTICKS_DEFAULT = 2400,
+	};
+
+	enum
+	{
+		REWIND_INTERVAL_DEFAULT = 10, //In frames
+		REWIND_MEMORYLIMIT_DEFAULT = 256, //In megabytes
+	};
+
 	//SPU update parameters
 	enum
 	{
@@ -163,10 +230,8 @@ private:
 		BLOCK_COUNT = 400,
 	};
 
-	int16 m_samples[BLOCK_SIZE * BLOCK_COUNT];
-	int m_currentSpuBlock = 0;
-	int m_spuBlockCount;
 	CSoundHandler* m_soundHandler = nullptr;
+	CSoundOutput m_soundOutput;
 
 	CProfiler::ZoneHandle m_eeProfilerZone = 0;
 	CProfiler::ZoneHandle m_iopProfilerZone = 0;
@@ -175,5 +240,7 @@ private:
 	CProfiler::ZoneHandle m_otherProfilerZone = 0;
 
 	CPS2OS::RequestLoadExecutableEvent::Connection m_OnRequestLoadExecutableConnection;
+	Framework::CSignal<void()>::Connection m_OnExecutableChangeConnection;
+	Framework::CSignal<void()>::Connection m_OnExecutableUnloadingConnection;
 	Framework::CSignal<void(uint32)>::Connection m_OnNewFrameConnection;
 };
@@ -6,4 +6,16 @@
 #define PREF_PS2_MC0_DIRECTORY ("ps2.mc0.directory.v2")
 #define PREF_PS2_MC1_DIRECTORY ("ps2.mc1.directory.v2")
 
+#define PREF_PS2_JITCACHE_ENABLED ("ps2.jitcache.enabled")
+#define PREF_PS2_JIT_BACKGROUNDCOMPILE ("ps2.jit.backgroundcompile")
+#define PREF_PS2_EE_FASTMEM ("ps2.ee.fastmem")
+#define PREF_PS2_VU1_THREADED ("ps2.vu1.threaded")
+#define PREF_PS2_IOP_THREADED ("ps2.iop.threaded")
+#define PREF_PS2_IOP_MAXSKEWTICKS ("ps2.iop.maxskewticks")
+
+#define PREF_PS2_REWIND_ENABLED ("ps2.rewind.enabled")
+#define PREF_PS2_REWIND_INTERVAL ("ps2.rewind.interval")
+#define PREF_PS2_REWIND_MEMORYLIMIT ("ps2.rewind.memorylimit")
+
 #define PREF_AUDIO_SPUBLOCKCOUNT ("audio.spublockcount")
+#define PREF_AUDIO_THREADED ("audio.threaded")
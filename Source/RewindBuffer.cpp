@@ -0,0 +1,234 @@
+#include <cassert>
+#include <cstring>
+#include "RewindBuffer.h"
+
+void CRewindBuffer::Reset()
+{
+	m_regions.clear();
+	Clear();
+}
+
+void CRewindBuffer::AddRegion(uint8* memory, uint32 size, uint32 pageSize, const DirtyPagesFunction& dirtyPagesFunction)
+{
+	//Delta records count 64-bit words with 16-bit integers
+	assert((pageSize % 8) == 0);
+	assert((pageSize / 8) <= 0xFFFF);
+	assert((size % pageSize) == 0);
+
+	REGION region;
+	region.memory = memory;
+	region.size = size;
+	region.pageSize = pageSize;
+	region.dirtyPagesFunction = dirtyPagesFunction;
+	region.shadow.resize(size);
+	m_regions.push_back(std::move(region));
+
+	Clear();
+}
+
+void CRewindBuffer::Clear()
+{
+	m_snapshots.clear();
+	m_memoryUsage = 0;
+	m_fullCompare = true;
+}
+
+void CRewindBuffer::SetMemoryLimit(size_t memoryLimit)
+{
+	m_memoryLimit = memoryLimit;
+	DropOldSnapshots();
+}
+
+size_t CRewindBuffer::GetMemoryUsage() const
+{
+	return m_memoryUsage;
+}
+
+uint32 CRewindBuffer::GetSnapshotCount() const
+{
+	return static_cast<uint32>(m_snapshots.size());
+}
+
+void CRewindBuffer::Capture(DeviceState deviceState)
+{
+	SNAPSHOT snapshot;
+	snapshot.deviceState = std::move(deviceState);
+
+	//Without a previous snapshot, there is nothing to record, shadow copies are only initialized
+	bool recordDeltas = !m_snapshots.empty();
+	for(uint32 regionIndex = 0; regionIndex < m_regions.size(); regionIndex++)
+	{
+		CaptureRegion(snapshot, regionIndex, recordDeltas);
+	}
+	snapshot.deltaData.shrink_to_fit();
+	m_fullCompare = false;
+
+	m_memoryUsage += snapshot.GetMemoryUsage();
+	m_snapshots.push_back(std::move(snapshot));
+	DropOldSnapshots();
+}
+
+bool CRewindBuffer::Rewind(DeviceState& deviceState)
+{
+	if(m_snapshots.empty()) return false;
+
+	for(auto& region : m_regions)
+	{
+		for(uint32 offset = 0; offset < region.size; offset += region.pageSize)
+		{
+			if(memcmp(region.memory + offset, region.shadow.data() + offset, region.pageSize) != 0)
+			{
+				memcpy(region.memory + offset, region.shadow.data() + offset, region.pageSize);
+			}
+		}
+	}
+
+	auto& snapshot = m_snapshots.back();
+	m_memoryUsage -= snapshot.GetMemoryUsage();
+	for(const auto& pageDelta : snapshot.pageDeltas)
+	{
+		auto& region = m_regions[pageDelta.regionIndex];
+		uint8* shadowPage = region.shadow.data() + (pageDelta.pageIndex * region.pageSize);
+		ApplyDelta(shadowPage, snapshot.deltaData.data() + pageDelta.offset, region.pageSize);
+	}
+	deviceState = std::move(snapshot.deviceState);
+	m_snapshots.pop_back();
+
+	//Shadow copies now hold the previous snapshot, memory doesn't match them anymore
+	m_fullCompare = true;
+	return true;
+}
+
+void CRewindBuffer::CaptureRegion(SNAPSHOT& snapshot, uint32 regionIndex, bool recordDeltas)
+{
+	auto& region = m_regions[regionIndex];
+
+	//Always collect dirty pages, some trackers need this to start tracking again
+	m_dirtyPages.clear();
+	if(region.dirtyPagesFunction)
+	{
+		region.dirtyPagesFunction(m_dirtyPages);
+	}
+
+	if(!recordDeltas)
+	{
+		memcpy(region.shadow.data(), region.memory, region.size);
+		return;
+	}
+
+	auto capturePage =
+	    [&](uint32 pageIndex) {
+		    uint32 offset = pageIndex * region.pageSize;
+		    const uint8* page = region.memory + offset;
+		    uint8* shadowPage = region.shadow.data() + offset;
+		    if(memcmp(page, shadowPage, region.pageSize) == 0) return;
+
+		    PAGE_DELTA pageDelta;
+		    pageDelta.regionIndex = regionIndex;
+		    pageDelta.pageIndex = pageIndex;
+		    pageDelta.offset = static_cast<uint32>(snapshot.deltaData.size());
+		    snapshot.pageDeltas.push_back(pageDelta);
+
+		    EncodeDelta(snapshot.deltaData, page, shadowPage, region.pageSize);
+		    memcpy(shadowPage, page, region.pageSize);
+	    };
+
+	if(m_fullCompare || !region.dirtyPagesFunction)
+	{
+		uint32 pageCount = region.size / region.pageSize;
+		for(uint32 pageIndex = 0; pageIndex < pageCount; pageIndex++)
+		{
+			capturePage(pageIndex);
+		}
+	}
+	else
+	{
+		for(uint32 pageIndex : m_dirtyPages)
+		{
+			capturePage(pageIndex);
+		}
+	}
+}
+
+void CRewindBuffer::DropOldSnapshots()
+{
+	while((m_snapshots.size() > 1) && (m_memoryUsage > m_memoryLimit))
+	{
+		m_memoryUsage -= m_snapshots.front().GetMemoryUsage();
+		m_snapshots.pop_front();
+
+		//We can't go back past the oldest snapshot, changes that lead to the one before it aren't needed
+		auto& oldest = m_snapshots.front();
+		m_memoryUsage -= oldest.GetMemoryUsage();
+		oldest.pageDeltas = std::vector<PAGE_DELTA>();
+		oldest.deltaData = std::vector<uint8>();
+		m_memoryUsage += oldest.GetMemoryUsage();
+	}
+}
+
+//Deltas are sequences of records made of a count of unchanged 64-bit words, a count of changed
+//words (16 bits each) and the XOR of both versions of the changed words.
+void CRewindBuffer::EncodeDelta(std::vector<uint8>& output, const uint8* page, const uint8* previousPage, uint32 pageSize)
+{
+	auto words = reinterpret_cast<const uint64*>(page);
+	auto previousWords = reinterpret_cast<const uint64*>(previousPage);
+	uint32 wordCount = pageSize / 8;
+	uint32 wordIndex = 0;
+	while(wordIndex < wordCount)
+	{
+		uint32 sameStart = wordIndex;
+		while((wordIndex < wordCount) && (words[wordIndex] == previousWords[wordIndex]))
+		{
+			wordIndex++;
+		}
+		uint32 changedStart = wordIndex;
+		while((wordIndex < wordCount) && (words[wordIndex] != previousWords[wordIndex]))
+		{
+			wordIndex++;
+		}
+
+		uint16 header[2] =
+		    {
+		        static_cast<uint16>(changedStart - sameStart),
+		        static_cast<uint16>(wordIndex - changedStart),
+		    };
+		size_t outputOffset = output.size();
+		output.resize(outputOffset + sizeof(header) + (header[1] * 8));
+		uint8* outputPtr = output.data() + outputOffset;
+		memcpy(outputPtr, header, sizeof(header));
+		outputPtr += sizeof(header);
+		for(uint32 i = changedStart; i < wordIndex; i++)
+		{
+			uint64 delta = words[i] ^ previousWords[i];
+			memcpy(outputPtr, &delta, 8);
+			outputPtr += 8;
+		}
+	}
+}
+
+void CRewindBuffer::ApplyDelta(uint8* page, const uint8* delta, uint32 pageSize)
+{
+	auto words = reinterpret_cast<uint64*>(page);
+	uint32 wordCount = pageSize / 8;
+	uint32 wordIndex = 0;
+	while(wordIndex < wordCount)
+	{
+		uint16 header[2];
+		memcpy(header, delta, sizeof(header));
+		delta += sizeof(header);
+		wordIndex += header[0];
+		for(uint32 i = 0; i < header[1]; i++)
+		{
+			uint64 value = 0;
+			memcpy(&value, delta, 8);
+			words[wordIndex++] ^= value;
+			delta += 8;
+		}
+	}
+	assert(wordIndex == wordCount);
+}
+
+size_t CRewindBuffer::SNAPSHOT::GetMemoryUsage() const
+{
+	return deviceState.capacity() + deltaData.capacity() + (pageDeltas.capacity() * sizeof(PAGE_DELTA));
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <vector>
+#include "Types.h"
+
+//Keeps a bounded history of machine snapshots in memory. Memory regions are handled page by
+//page: a copy of every region as of the latest snapshot is kept, and each snapshot holds the
+//changes needed to go back to the snapshot before it (XOR of both versions of changed pages,
+//with runs of zeros removed). Whatever isn't in a region (registers, HLE state, etc.) is kept
+//as an opaque blob provided by the caller.
+class CRewindBuffer
+{
+public:
+	typedef std::vector<uint8> DeviceState;
+
+	//Appends the indices of pages that might have been written to since the previous call
+	typedef std::function<void(std::vector<uint32>&)> DirtyPagesFunction;
+
+	enum
+	{
+		DEFAULT_PAGE_SIZE = 0x1000,
+		DEFAULT_MEMORY_LIMIT = 0x10000000,
+	};
+
+	//Removes all regions and snapshots
+	void Reset();
+	void AddRegion(uint8*, uint32, uint32 pageSize = DEFAULT_PAGE_SIZE, const DirtyPagesFunction& = DirtyPagesFunction());
+
+	//Removes all snapshots but keeps regions
+	void Clear();
+
+	void SetMemoryLimit(size_t);
+	size_t GetMemoryUsage() const;
+	uint32 GetSnapshotCount() const;
+
+	void Capture(DeviceState);
+
+	//Copies the latest snapshot back into the regions and discards it
+	bool Rewind(DeviceState&);
+
+private:
+	struct REGION
+	{
+		uint8* memory = nullptr;
+		uint32 size = 0;
+		uint32 pageSize = 0;
+		DirtyPagesFunction dirtyPagesFunction;
+		std::vector<uint8> shadow;
+	};
+
+	struct PAGE_DELTA
+	{
+		uint32 regionIndex;
+		uint32 pageIndex;
+		uint32 offset;
+	};
+
+	struct SNAPSHOT
+	{
+		DeviceState deviceState;
+		std::vector<PAGE_DELTA> pageDeltas;
+		std::vector<uint8> deltaData;
+
+		size_t GetMemoryUsage() const;
+	};
+
+	static void EncodeDelta(std::vector<uint8>&, const uint8*, const uint8*, uint32);
+	static void ApplyDelta(uint8*, const uint8*, uint32);
+
+	void CaptureRegion(SNAPSHOT&, uint32, bool);
+	void DropOldSnapshots();
+
+	std::vector<REGION> m_regions;
+	std::deque<SNAPSHOT> m_snapshots;
+	size_t m_memoryLimit = DEFAULT_MEMORY_LIMIT;
+	size_t m_memoryUsage = 0;
+
+	//Set when region memory doesn't match the shadow copies anymore (ie.: after a rewind)
+	bool m_fullCompare = true;
+	std::vector<uint32> m_dirtyPages;
+};
@@ -0,0 +1,172 @@
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+#include "SoundOutput.h"
+
+#define THREAD_WAIT_TIMEOUT std::chrono::milliseconds(5)
+
+CSoundOutput::CSoundOutput()
+    : m_ring(std::make_unique<BlockRing>())
+    , m_writeBlockCount(1)
+    , m_droppedBlockCount(0)
+{
+}
+
+CSoundOutput::~CSoundOutput()
+{
+	StopThread();
+}
+
+void CSoundOutput::SetSoundHandler(CSoundHandler* handler, bool threaded)
+{
+	StopThread();
+
+	//Anything still queued belongs to the previous handler
+	while(m_ring->Peek())
+	{
+		m_ring->Pop();
+	}
+	m_pendingSamples.clear();
+	m_pendingBlockCount = 0;
+	m_pendingSampleRate = 0;
+	m_maxQueuedWrites = MIN_QUEUED_WRITES;
+	m_steadyBlockCount = 0;
+
+	m_handler = handler;
+	if(m_handler && threaded)
+	{
+		StartThread();
+	}
+}
+
+void CSoundOutput::SetWriteBlockCount(uint32 writeBlockCount)
+{
+	m_writeBlockCount = std::max<uint32>(writeBlockCount, 1);
+}
+
+void CSoundOutput::Write(const int16* samples, unsigned int sampleCount, unsigned int sampleRate)
+{
+	if(!m_handler) return;
+
+	while(sampleCount != 0)
+	{
+		uint32 blockSampleCount = std::min<uint32>(sampleCount, MAX_BLOCK_SAMPLES);
+		if(m_thread.joinable())
+		{
+			auto block = m_ring->BeginPush();
+			if(block)
+			{
+				memcpy(block->samples, samples, blockSampleCount * sizeof(int16));
+				block->sampleCount = blockSampleCount;
+				block->sampleRate = sampleRate;
+				m_ring->EndPush();
+				m_threadCondition.notify_one();
+			}
+			else
+			{
+				//Output thread is stalled, losing a block is better than stalling emulation
+				m_droppedBlockCount++;
+			}
+		}
+		else
+		{
+			QueueSamples(samples, blockSampleCount, sampleRate);
+		}
+		samples += blockSampleCount;
+		sampleCount -= blockSampleCount;
+	}
+}
+
+uint32 CSoundOutput::GetDroppedBlockCount() const
+{
+	return m_droppedBlockCount;
+}
+
+void CSoundOutput::StartThread()
+{
+	assert(!m_thread.joinable());
+	m_threadDone = false;
+	m_thread = std::thread([this]() { ThreadProc(); });
+}
+
+void CSoundOutput::StopThread()
+{
+	if(!m_thread.joinable()) return;
+	{
+		std::lock_guard<std::mutex> threadLock(m_threadMutex);
+		m_threadDone = true;
+	}
+	m_threadCondition.notify_one();
+	m_thread.join();
+}
+
+void CSoundOutput::ThreadProc()
+{
+	while(1)
+	{
+		bool hasBlocks = false;
+		{
+			std::unique_lock<std::mutex> threadLock(m_threadMutex);
+			hasBlocks = m_threadCondition.wait_for(threadLock, THREAD_WAIT_TIMEOUT,
+			                                       [this]() { return m_threadDone || !m_ring->IsEmpty(); });
+			if(m_threadDone) break;
+		}
+
+		if(!hasBlocks)
+		{
+			//Producer stalled, the burst it sends to catch up shouldn't be dropped
+			m_maxQueuedWrites = std::min<uint32>(m_maxQueuedWrites + 1, MAX_QUEUED_WRITES);
+			m_steadyBlockCount = 0;
+			continue;
+		}
+
+		//Don't let latency build up if the backend consumes slower than we produce
+		uint32 maxQueuedBlockCount = m_writeBlockCount * m_maxQueuedWrites;
+		while(m_ring->GetSize() > maxQueuedBlockCount)
+		{
+			m_ring->Pop();
+			m_droppedBlockCount++;
+		}
+
+		while(auto block = m_ring->Peek())
+		{
+			QueueSamples(block->samples, block->sampleCount, block->sampleRate);
+			m_ring->Pop();
+			m_steadyBlockCount++;
+		}
+
+		if(m_steadyBlockCount >= STEADY_BLOCKS_BEFORE_SHRINK)
+		{
+			m_maxQueuedWrites = std::max<uint32>(m_maxQueuedWrites - 1, MIN_QUEUED_WRITES);
+			m_steadyBlockCount = 0;
+		}
+	}
+}
+
+void CSoundOutput::QueueSamples(const int16* samples, uint32 sampleCount, uint32 sampleRate)
+{
+	if((m_pendingBlockCount != 0) && (m_pendingSampleRate != sampleRate))
+	{
+		SubmitPendingSamples();
+	}
+	m_pendingSamples.insert(m_pendingSamples.end(), samples, samples + sampleCount);
+	m_pendingSampleRate = sampleRate;
+	m_pendingBlockCount++;
+	if(m_pendingBlockCount >= m_writeBlockCount)
+	{
+		SubmitPendingSamples();
+	}
+}
+
+void CSoundOutput::SubmitPendingSamples()
+{
+	assert(m_handler);
+	if(m_handler->HasFreeBuffers())
+	{
+		m_handler->RecycleBuffers();
+	}
+	m_handler->Write(m_pendingSamples.data(), static_cast<unsigned int>(m_pendingSamples.size()), m_pendingSampleRate);
+	m_pendingSamples.clear();
+	m_pendingBlockCount = 0;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Types.h"
+#include "SpscRingBuffer.h"
+#include "../tools/PsfPlayer/Source/SoundHandler.h"
+
+//Feeds a sound handler with blocks of SPU samples. When threaded, blocks go through a
+//lock-free ring and are written to the handler by a dedicated thread, so the producer
+//never waits on the audio backend. Samples are still rendered by the producer, this only
+//moves the backend writes off the emulation thread.
+class CSoundOutput
+{
+public:
+	enum
+	{
+		MAX_BLOCK_SAMPLES = 256,
+	};
+
+	CSoundOutput();
+	virtual ~CSoundOutput();
+
+	//Must not be called while Write is running on another thread
+	void SetSoundHandler(CSoundHandler*, bool threaded);
+	void SetWriteBlockCount(uint32);
+
+	//Producer side, sampleCount is the number of interleaved stereo samples
+	void Write(const int16*, unsigned int sampleCount, unsigned int sampleRate);
+
+	uint32 GetDroppedBlockCount() const;
+
+private:
+	enum
+	{
+		RING_SIZE = 512,
+		MIN_QUEUED_WRITES = 2,
+		MAX_QUEUED_WRITES = 8,
+		STEADY_BLOCKS_BEFORE_SHRINK = 2048,
+	};
+
+	struct BLOCK
+	{
+		int16 samples[MAX_BLOCK_SAMPLES];
+		uint32 sampleCount = 0;
+		uint32 sampleRate = 0;
+	};
+
+	typedef CSpscRingBuffer<BLOCK, RING_SIZE> BlockRing;
+
+	void StartThread();
+	void StopThread();
+	void ThreadProc();
+
+	void QueueSamples(const int16*, uint32, uint32);
+	void SubmitPendingSamples();
+
+	CSoundHandler* m_handler = nullptr;
+	std::unique_ptr<BlockRing> m_ring;
+	std::atomic<uint32> m_writeBlockCount;
+	std::atomic<uint32> m_droppedBlockCount;
+
+	//Only touched by the thread that writes to the handler
+	std::vector<int16> m_pendingSamples;
+	uint32 m_pendingBlockCount = 0;
+	uint32 m_pendingSampleRate = 0;
+
+	//Latency allowed before dropping blocks, grows when the producer stalls and shrinks back
+	//once it has been steady for a while. Only touched by the output thread.
+	uint32 m_maxQueuedWrites = MIN_QUEUED_WRITES;
+	uint32 m_steadyBlockCount = 0;
+
+	std::thread m_thread;
+	std::mutex m_threadMutex;
+	std::condition_variable m_threadCondition;
+	bool m_threadDone = false;
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <array>
+#include <utility>
+#include "Types.h"
+
+//Bounded lock-free queue for exactly one producer thread and one consumer thread.
+//Capacity must be a power of two.
+template <typename ItemType, uint32 capacity>
+class CSpscRingBuffer
+{
+public:
+	static_assert((capacity != 0) && ((capacity & (capacity - 1)) == 0), "Capacity must be a power of two.");
+
+	CSpscRingBuffer() = default;
+	CSpscRingBuffer(const CSpscRingBuffer&) = delete;
+	CSpscRingBuffer& operator=(const CSpscRingBuffer&) = delete;
+
+	//Producer side
+	bool TryPush(ItemType&& item)
+	{
+		uint32 writeIndex = m_writeIndex.load(std::memory_order_relaxed);
+		if((writeIndex - m_readIndex.load(std::memory_order_acquire)) == capacity) return false;
+		m_items[writeIndex & (capacity - 1)] = std::move(item);
+		m_writeIndex.store(writeIndex + 1, std::memory_order_release);
+		return true;
+	}
+
+	//Producer side, returns the slot to fill in place, item is published by EndPush
+	ItemType* BeginPush()
+	{
+		uint32 writeIndex = m_writeIndex.load(std::memory_order_relaxed);
+		if((writeIndex - m_readIndex.load(std::memory_order_acquire)) == capacity) return nullptr;
+		return &m_items[writeIndex & (capacity - 1)];
+	}
+
+	void EndPush()
+	{
+		uint32 writeIndex = m_writeIndex.load(std::memory_order_relaxed);
+		m_writeIndex.store(writeIndex + 1, std::memory_order_release);
+	}
+
+	//Consumer side
+	bool TryPop(ItemType& item)
+	{
+		uint32 readIndex = m_readIndex.load(std::memory_order_relaxed);
+		if(readIndex == m_writeIndex.load(std::memory_order_acquire)) return false;
+		item = std::move(m_items[readIndex & (capacity - 1)]);
+		m_readIndex.store(readIndex + 1, std::memory_order_release);
+		return true;
+	}
+
+	//Consumer side, item stays valid until Pop is called
+	ItemType* Peek()
+	{
+		uint32 readIndex = m_readIndex.load(std::memory_order_relaxed);
+		if(readIndex == m_writeIndex.load(std::memory_order_acquire)) return nullptr;
+		return &m_items[readIndex & (capacity - 1)];
+	}
+
+	void Pop()
+	{
+		uint32 readIndex = m_readIndex.load(std::memory_order_relaxed);
+		m_items[readIndex & (capacity - 1)] = ItemType();
+		m_readIndex.store(readIndex + 1, std::memory_order_release);
+	}
+
+	bool IsEmpty() const
+	{
+		return m_readIndex.load(std::memory_order_acquire) == m_writeIndex.load(std::memory_order_acquire);
+	}
+
+	//Number of queued items, the other thread may change it at any time
+	uint32 GetSize() const
+	{
+		uint32 readIndex = m_readIndex.load(std::memory_order_acquire);
+		return m_writeIndex.load(std::memory_order_acquire) - readIndex;
+	}
+
+private:
+	enum
+	{
+		CACHE_LINE_SIZE = 64,
+	};
+
+	std::array<ItemType, capacity> m_items;
+	alignas(CACHE_LINE_SIZE) std::atomic<uint32> m_writeIndex = {0};
+	alignas(CACHE_LINE_SIZE) std::atomic<uint32> m_readIndex = {0};
+};
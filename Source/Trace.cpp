@@ -0,0 +1,444 @@
+#include <algorithm>
+#include <cassert>
+#include <unordered_map>
+#include "Trace.h"
+#include "AppConfig.h"
+#include "PathUtils.h"
+#include "StdStreamUtils.h"
+
+#define LOG_PATH "logs"
+#define TRACE_FILENAME "trace.bin"
+
+#define PREF_LOG_TRACE_ENABLED "log.trace.enabled"
+#define PREF_LOG_TRACE_CATEGORIES "log.trace.categories"
+
+//Categories past the limit all end up in the last one
+#define OVERFLOW_CATEGORY_NAME "others"
+
+#define WRITER_PERIOD_MS 10
+
+std::atomic<bool> CTrace::m_enabled(false);
+
+struct TRACE_THREAD_STATE
+{
+	std::string name;
+	const uint64* cycleCounter = nullptr;
+	std::shared_ptr<void> buffer;
+
+	~TRACE_THREAD_STATE();
+};
+
+static thread_local TRACE_THREAD_STATE g_threadState;
+
+CTrace::CTrace()
+    : m_startTime(std::chrono::steady_clock::now())
+{
+	for(auto& categoryEnabled : m_categoryEnabled)
+	{
+		categoryEnabled = false;
+	}
+
+	CAppConfig::GetInstance().RegisterPreferenceBoolean(PREF_LOG_TRACE_ENABLED, false);
+	CAppConfig::GetInstance().RegisterPreferenceString(PREF_LOG_TRACE_CATEGORIES, "*");
+	ParseCategoryRules(CAppConfig::GetInstance().GetPreferenceString(PREF_LOG_TRACE_CATEGORIES));
+	SetEnabled(CAppConfig::GetInstance().GetPreferenceBoolean(PREF_LOG_TRACE_ENABLED));
+}
+
+CTrace::~CTrace()
+{
+	m_enabled = false;
+	if(m_writerThread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_writerEnd = true;
+		}
+		m_writerCondition.notify_one();
+		m_writerThread.join();
+	}
+}
+
+void CTrace::SetEnabled(bool enabled)
+{
+	if(enabled && !m_writerThread.joinable())
+	{
+		try
+		{
+			auto logPath = CAppConfig::GetBasePath() / LOG_PATH;
+			Framework::PathUtils::EnsurePathExists(logPath);
+			m_stream = Framework::CreateOutputStdStream((logPath / TRACE_FILENAME).native());
+
+			FILE_HEADER header = {};
+			header.magic = TRACE_MAGIC;
+			header.version = TRACE_VERSION;
+			header.recordSize = sizeof(RECORD);
+			m_stream.Write(&header, sizeof(FILE_HEADER));
+		}
+		catch(...)
+		{
+			//Not much we can do without a place to write to
+			return;
+		}
+		m_writerThread = std::thread([this]() { WriterThreadProc(); });
+	}
+	m_enabled = enabled;
+}
+
+void CTrace::SetCategoryEnabled(const std::string& name, bool enabled)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	CATEGORY_RULE rule;
+	rule.name = name;
+	rule.enabled = enabled;
+	m_categoryRules.push_back(rule);
+	for(uint32 categoryIndex = 0; categoryIndex < m_categories.size(); categoryIndex++)
+	{
+		m_categoryEnabled[categoryIndex] = IsCategoryEnabledByRules(m_categories[categoryIndex]);
+	}
+}
+
+void CTrace::SetThreadName(const char* name)
+{
+	g_threadState.name = name;
+	if(auto buffer = std::static_pointer_cast<THREAD_BUFFER>(g_threadState.buffer))
+	{
+		auto& trace = GetInstance();
+		std::lock_guard<std::mutex> lock(trace.m_mutex);
+		buffer->name = name;
+		buffer->nameChanged = true;
+	}
+}
+
+void CTrace::SetThreadCycleCounter(const uint64* cycleCounter)
+{
+	g_threadState.cycleCounter = cycleCounter;
+}
+
+TRACE_THREAD_STATE::~TRACE_THREAD_STATE()
+{
+	//Writer thread will get rid of the buffer once it's empty
+	if(buffer)
+	{
+		static_cast<CTrace::THREAD_BUFFER*>(buffer.get())->finished = true;
+	}
+}
+
+bool CTrace::ReserveArgument(ARG_WRITER& writer, uint32 size)
+{
+	if((writer.size != RECORD_ARGS_SIZE) && (writer.args[writer.size] == (ARG_TYPE_TRUNCATED << 4)))
+	{
+		return false;
+	}
+	if((writer.size + size) > RECORD_ARGS_SIZE)
+	{
+		//Leave a mark for the decoder and ignore remaining arguments
+		if(writer.size != RECORD_ARGS_SIZE)
+		{
+			writer.args[writer.size] = (ARG_TYPE_TRUNCATED << 4);
+		}
+		return false;
+	}
+	return true;
+}
+
+void CTrace::EncodeInteger(ARG_WRITER& writer, ARG_TYPE type, uint64 value)
+{
+	uint32 byteCount = 0;
+	for(uint64 remain = value; remain != 0; remain >>= 8)
+	{
+		byteCount++;
+	}
+	if(!ReserveArgument(writer, byteCount + 1)) return;
+	writer.args[writer.size++] = static_cast<uint8>((type << 4) | byteCount);
+	for(uint32 i = 0; i < byteCount; i++)
+	{
+		writer.args[writer.size++] = static_cast<uint8>(value >> (i * 8));
+	}
+}
+
+void CTrace::EncodeDouble(ARG_WRITER& writer, double value)
+{
+	if(!ReserveArgument(writer, sizeof(double) + 1)) return;
+	writer.args[writer.size++] = static_cast<uint8>((ARG_TYPE_DOUBLE << 4) | sizeof(double));
+	memcpy(writer.args + writer.size, &value, sizeof(double));
+	writer.size += sizeof(double);
+}
+
+void CTrace::EncodeString(ARG_WRITER& writer, const char* value)
+{
+	if(!value) value = "(null)";
+	if(!ReserveArgument(writer, (value[0] != 0) ? 3 : 2)) return;
+	//Long strings are cut to fit in the record
+	uint32 length = std::min<uint32>(strlen(value), RECORD_ARGS_SIZE - writer.size - 2);
+	writer.args[writer.size++] = static_cast<uint8>(ARG_TYPE_STRING << 4);
+	writer.args[writer.size++] = static_cast<uint8>(length);
+	memcpy(writer.args + writer.size, value, length);
+	writer.size += length;
+}
+
+CTrace::FORMAT_INFO CTrace::GetFormatInfo(const char* categoryName, const char* format, uint32 formatFlags)
+{
+	//Format strings are literals, their address is enough to find them. Some log names
+	//are built at runtime though, make sure the cached entry is for the same category.
+	struct CACHED_FORMAT_INFO
+	{
+		FORMAT_INFO info;
+		std::string categoryName;
+	};
+	struct FormatKeyHasher
+	{
+		size_t operator()(const FormatKey& key) const
+		{
+			return std::hash<const void*>()(std::get<0>(key)) ^ (std::hash<const void*>()(std::get<1>(key)) << 1) ^ std::get<2>(key);
+		}
+	};
+	static thread_local std::unordered_map<FormatKey, CACHED_FORMAT_INFO, FormatKeyHasher> formatCache;
+
+	auto& cachedFormatInfo = formatCache[FormatKey(categoryName, format, formatFlags)];
+	if(cachedFormatInfo.categoryName.empty() || strcmp(cachedFormatInfo.categoryName.c_str(), categoryName))
+	{
+		cachedFormatInfo.info = RegisterFormat(categoryName, format, formatFlags);
+		cachedFormatInfo.categoryName = categoryName;
+	}
+	return cachedFormatInfo.info;
+}
+
+CTrace::FORMAT_INFO CTrace::RegisterFormat(const char* categoryName, const char* format, uint32 formatFlags)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto key = FormatIndexKey(categoryName, format, formatFlags);
+	auto formatIterator = m_formatIndices.find(key);
+	if(formatIterator != std::end(m_formatIndices))
+	{
+		return formatIterator->second;
+	}
+
+	FORMAT_INFO formatInfo;
+	formatInfo.formatId = static_cast<uint32>(m_formats.size());
+	formatInfo.categoryIndex = RegisterCategory(categoryName);
+
+	FORMAT newFormat;
+	newFormat.format = format;
+	newFormat.categoryIndex = formatInfo.categoryIndex;
+	newFormat.flags = formatFlags;
+	m_formats.push_back(std::move(newFormat));
+	m_formatIndices.emplace(key, formatInfo);
+	return formatInfo;
+}
+
+//Must be called with the mutex locked
+uint32 CTrace::RegisterCategory(const char* name)
+{
+	auto categoryIterator = m_categoryIndices.find(name);
+	if(categoryIterator != std::end(m_categoryIndices))
+	{
+		return categoryIterator->second;
+	}
+
+	uint32 categoryIndex = static_cast<uint32>(m_categories.size());
+	if(categoryIndex == (MAX_CATEGORIES - 1))
+	{
+		m_categories.push_back(OVERFLOW_CATEGORY_NAME);
+		m_categoryEnabled[categoryIndex] = IsCategoryEnabledByRules(OVERFLOW_CATEGORY_NAME);
+	}
+	else if(categoryIndex == MAX_CATEGORIES)
+	{
+		categoryIndex = MAX_CATEGORIES - 1;
+	}
+	else
+	{
+		m_categories.push_back(name);
+		m_categoryEnabled[categoryIndex] = IsCategoryEnabledByRules(name);
+	}
+	m_categoryIndices.emplace(name, categoryIndex);
+	return categoryIndex;
+}
+
+//Last matching rule wins
+bool CTrace::IsCategoryEnabledByRules(const std::string& name) const
+{
+	bool enabled = false;
+	for(const auto& rule : m_categoryRules)
+	{
+		if((rule.name == "*") || (rule.name == name))
+		{
+			enabled = rule.enabled;
+		}
+	}
+	return enabled;
+}
+
+//Comma separated list of category names, '*' matches all categories and a '-' prefix
+//disables matching categories (ie.: "*,-spu2,-iop_intc")
+void CTrace::ParseCategoryRules(const std::string& rules)
+{
+	size_t ruleBegin = 0;
+	while(ruleBegin <= rules.size())
+	{
+		size_t ruleEnd = rules.find(',', ruleBegin);
+		if(ruleEnd == std::string::npos) ruleEnd = rules.size();
+		auto ruleName = rules.substr(ruleBegin, ruleEnd - ruleBegin);
+		ruleBegin = ruleEnd + 1;
+
+		ruleName.erase(0, ruleName.find_first_not_of(' '));
+		ruleName.erase(ruleName.find_last_not_of(' ') + 1);
+		bool enabled = true;
+		if(!ruleName.empty() && (ruleName[0] == '-'))
+		{
+			enabled = false;
+			ruleName.erase(0, 1);
+		}
+		if(ruleName.empty()) continue;
+		SetCategoryEnabled(ruleName, enabled);
+	}
+}
+
+CTrace::THREAD_BUFFER* CTrace::GetThreadBuffer()
+{
+	if(g_threadState.buffer)
+	{
+		return static_cast<THREAD_BUFFER*>(g_threadState.buffer.get());
+	}
+
+	auto buffer = std::make_shared<THREAD_BUFFER>();
+	buffer->finished = false;
+	buffer->head = 0;
+	buffer->tail = 0;
+	buffer->dropped = 0;
+	buffer->slots = std::make_unique<RECORD[]>(RING_SLOT_COUNT);
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		buffer->index = m_nextThreadIndex++;
+		buffer->name = g_threadState.name;
+		m_threadBuffers.push_back(buffer);
+	}
+	g_threadState.buffer = buffer;
+	return buffer.get();
+}
+
+//Only the owner thread pushes records in its buffer and only the writer thread pops them
+void CTrace::CommitRecord(RECORD& record)
+{
+	auto buffer = GetThreadBuffer();
+
+	uint32 head = buffer->head.load(std::memory_order_relaxed);
+	uint32 tail = buffer->tail.load(std::memory_order_acquire);
+	if((head - tail) == RING_SLOT_COUNT)
+	{
+		buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	record.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_startTime).count();
+	record.cycle = g_threadState.cycleCounter ? *g_threadState.cycleCounter : 0;
+	buffer->slots[head % RING_SLOT_COUNT] = record;
+	buffer->head.store(head + 1, std::memory_order_release);
+}
+
+void CTrace::WriteBlock(BLOCK_TYPE type, const void* data, uint32 size, const void* extraData, uint32 extraSize)
+{
+	BLOCK_HEADER header = {};
+	header.type = type;
+	header.size = size + extraSize;
+	m_stream.Write(&header, sizeof(BLOCK_HEADER));
+	m_stream.Write(data, size);
+	if(extraSize != 0)
+	{
+		m_stream.Write(extraData, extraSize);
+	}
+}
+
+//Must be called with the mutex locked. Metadata is written before the records using it.
+void CTrace::WriteNewMetadata()
+{
+	for(; m_writtenCategoryCount < m_categories.size(); m_writtenCategoryCount++)
+	{
+		const auto& name = m_categories[m_writtenCategoryCount];
+		WriteBlock(BLOCK_TYPE_CATEGORY, &m_writtenCategoryCount, sizeof(uint32), name.c_str(), static_cast<uint32>(name.size()));
+	}
+	for(; m_writtenFormatCount < m_formats.size(); m_writtenFormatCount++)
+	{
+		const auto& format = m_formats[m_writtenFormatCount];
+		uint32 formatHeader[3] = {m_writtenFormatCount, format.categoryIndex, format.flags};
+		WriteBlock(BLOCK_TYPE_FORMAT, formatHeader, sizeof(formatHeader), format.format.c_str(), static_cast<uint32>(format.format.size()));
+	}
+	for(const auto& buffer : m_threadBuffers)
+	{
+		if(!buffer->nameChanged) continue;
+		WriteBlock(BLOCK_TYPE_THREAD, &buffer->index, sizeof(uint32), buffer->name.c_str(), static_cast<uint32>(buffer->name.size()));
+		buffer->nameChanged = false;
+	}
+}
+
+void CTrace::Flush()
+{
+	std::vector<ThreadBufferPtr> threadBuffers;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		threadBuffers = m_threadBuffers;
+	}
+
+	std::vector<RECORD> records;
+	std::vector<std::pair<ThreadBufferPtr, std::vector<RECORD>>> threadRecords;
+	for(const auto& buffer : threadBuffers)
+	{
+		uint32 tail = buffer->tail.load(std::memory_order_relaxed);
+		uint32 head = buffer->head.load(std::memory_order_acquire);
+		if(head == tail) continue;
+		records.resize(head - tail);
+		for(uint32 i = 0; i < records.size(); i++)
+		{
+			records[i] = buffer->slots[(tail + i) % RING_SLOT_COUNT];
+		}
+		buffer->tail.store(head, std::memory_order_release);
+		threadRecords.emplace_back(buffer, std::move(records));
+		records = std::vector<RECORD>();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		WriteNewMetadata();
+		m_threadBuffers.erase(
+		    std::remove_if(m_threadBuffers.begin(), m_threadBuffers.end(),
+		                   [](const ThreadBufferPtr& buffer) { return buffer->finished && (buffer->head == buffer->tail); }),
+		    m_threadBuffers.end());
+	}
+
+	for(const auto& threadRecord : threadRecords)
+	{
+		const auto& buffer = threadRecord.first;
+		const auto& bufferRecords = threadRecord.second;
+		WriteBlock(BLOCK_TYPE_RECORDS, &buffer->index, sizeof(uint32), bufferRecords.data(), static_cast<uint32>(bufferRecords.size() * sizeof(RECORD)));
+	}
+	for(const auto& buffer : threadBuffers)
+	{
+		uint32 dropped = buffer->dropped.exchange(0, std::memory_order_relaxed);
+		if(dropped == 0) continue;
+		WriteBlock(BLOCK_TYPE_DROPPED, &buffer->index, sizeof(uint32), &dropped, sizeof(uint32));
+	}
+	m_stream.Flush();
+}
+
+void CTrace::WriterThreadProc()
+{
+	while(1)
+	{
+		bool end = false;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_writerCondition.wait_for(lock, std::chrono::milliseconds(WRITER_PERIOD_MS), [this]() { return m_writerEnd; });
+			end = m_writerEnd;
+		}
+		try
+		{
+			Flush();
+		}
+		catch(...)
+		{
+			//Stop writing if the file can't be written to anymore
+			m_enabled = false;
+			break;
+		}
+		if(end) break;
+	}
+}
@@ -0,0 +1,254 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+#include "StdStream.h"
+#include "Singleton.h"
+#include "Types.h"
+
+//Binary trace of log messages, cheap enough to be left enabled in release builds.
+//Threads write fixed size records (timestamp, emulated cycle, format id and arguments) in
+//their own ring buffer without locking. A writer thread periodically moves records to a
+//file, records are dropped if a ring buffer is full. Messages are only formatted when the
+//file is decoded (see tools/TraceDecoder). Categories are created from log names and can
+//be enabled or disabled at runtime.
+class CTrace : public CSingleton<CTrace>
+{
+public:
+	enum
+	{
+		TRACE_MAGIC = 0x43525450, //'PTRC'
+		TRACE_VERSION = 1,
+		MAX_CATEGORIES = 256,
+		RING_SLOT_COUNT = 0x1000,
+		RECORD_ARGS_SIZE = 44,
+	};
+
+	enum BLOCK_TYPE
+	{
+		BLOCK_TYPE_CATEGORY = 1,
+		BLOCK_TYPE_FORMAT,
+		BLOCK_TYPE_THREAD,
+		BLOCK_TYPE_RECORDS,
+		BLOCK_TYPE_DROPPED,
+	};
+
+	//Arguments are stored as a tag byte (type in upper nibble, size in lower nibble)
+	//followed by their value. Integers only use as many bytes as needed.
+	enum ARG_TYPE
+	{
+		ARG_TYPE_END,
+		ARG_TYPE_UNSIGNED,
+		ARG_TYPE_SIGNED,
+		ARG_TYPE_DOUBLE,
+		ARG_TYPE_STRING,
+		ARG_TYPE_TRUNCATED,
+	};
+
+	enum FORMAT_FLAG
+	{
+		FORMAT_FLAG_WARNING = 1,
+	};
+
+#pragma pack(push, 1)
+	struct FILE_HEADER
+	{
+		uint32 magic;
+		uint32 version;
+		uint32 recordSize;
+		uint32 reserved;
+	};
+
+	struct BLOCK_HEADER
+	{
+		uint32 type;
+		uint32 size;
+	};
+
+	struct RECORD
+	{
+		uint64 timestamp;
+		uint64 cycle;
+		uint32 formatId;
+		uint8 args[RECORD_ARGS_SIZE];
+	};
+	static_assert(sizeof(RECORD) == 0x40, "RECORD must be 64 bytes long.");
+#pragma pack(pop)
+
+	CTrace();
+	virtual ~CTrace();
+
+	static bool IsEnabled()
+	{
+		return m_enabled.load(std::memory_order_relaxed);
+	}
+
+	void SetEnabled(bool);
+	void SetCategoryEnabled(const std::string&, bool);
+
+	//Used by records made from the calling thread
+	static void SetThreadName(const char*);
+	static void SetThreadCycleCounter(const uint64*);
+
+	template <typename... Args>
+	void Record(const char* categoryName, const char* format, uint32 formatFlags, Args... args)
+	{
+		auto formatInfo = GetFormatInfo(categoryName, format, formatFlags);
+		if(!m_categoryEnabled[formatInfo.categoryIndex].load(std::memory_order_relaxed)) return;
+
+		RECORD record;
+		memset(&record, 0, sizeof(RECORD));
+		record.formatId = formatInfo.formatId;
+
+		ARG_WRITER writer = {record.args, 0};
+		int dummy[] = {0, (EncodeArgument(writer, args), 0)...};
+		static_cast<void>(dummy);
+
+		CommitRecord(record);
+	}
+
+private:
+	friend struct TRACE_THREAD_STATE;
+
+	struct FORMAT_INFO
+	{
+		uint32 formatId = 0;
+		uint32 categoryIndex = 0;
+	};
+
+	struct FORMAT
+	{
+		std::string format;
+		uint32 categoryIndex = 0;
+		uint32 flags = 0;
+	};
+
+	struct CATEGORY_RULE
+	{
+		std::string name;
+		bool enabled = false;
+	};
+
+	struct ARG_WRITER
+	{
+		uint8* args;
+		uint32 size;
+	};
+
+	struct THREAD_BUFFER
+	{
+		uint32 index = 0;
+		std::string name;
+		bool nameChanged = true;
+		std::atomic<bool> finished;
+		std::atomic<uint32> head;
+		std::atomic<uint32> tail;
+		std::atomic<uint32> dropped;
+		std::unique_ptr<RECORD[]> slots;
+	};
+
+	typedef std::shared_ptr<THREAD_BUFFER> ThreadBufferPtr;
+	typedef std::tuple<const char*, const char*, uint32> FormatKey;
+	typedef std::tuple<std::string, const char*, uint32> FormatIndexKey;
+
+	template <typename T>
+	static typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type EncodeArgument(ARG_WRITER& writer, T value)
+	{
+		//Zigzag encoding keeps small negative values small
+		auto signedValue = static_cast<int64>(value);
+		EncodeInteger(writer, ARG_TYPE_SIGNED, (static_cast<uint64>(signedValue) << 1) ^ static_cast<uint64>(signedValue >> 63));
+	}
+
+	template <typename T>
+	static typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type EncodeArgument(ARG_WRITER& writer, T value)
+	{
+		EncodeInteger(writer, ARG_TYPE_UNSIGNED, static_cast<uint64>(value));
+	}
+
+	template <typename T>
+	static typename std::enable_if<std::is_enum<T>::value>::type EncodeArgument(ARG_WRITER& writer, T value)
+	{
+		EncodeArgument(writer, static_cast<typename std::underlying_type<T>::type>(value));
+	}
+
+	template <typename T>
+	static typename std::enable_if<std::is_floating_point<T>::value>::type EncodeArgument(ARG_WRITER& writer, T value)
+	{
+		EncodeDouble(writer, static_cast<double>(value));
+	}
+
+	template <typename T>
+	static typename std::enable_if<std::is_pointer<T>::value && !std::is_same<typename std::remove_cv<typename std::remove_pointer<T>::type>::type, char>::value>::type EncodeArgument(ARG_WRITER& writer, T value)
+	{
+		EncodeInteger(writer, ARG_TYPE_UNSIGNED, reinterpret_cast<uintptr_t>(value));
+	}
+
+	static void EncodeArgument(ARG_WRITER& writer, const char* value)
+	{
+		EncodeString(writer, value);
+	}
+
+	static void EncodeArgument(ARG_WRITER& writer, std::nullptr_t)
+	{
+		EncodeInteger(writer, ARG_TYPE_UNSIGNED, 0);
+	}
+
+	//Objects can't be printed, keep the argument count right
+	template <typename T>
+	static typename std::enable_if<std::is_class<T>::value>::type EncodeArgument(ARG_WRITER& writer, const T&)
+	{
+		EncodeString(writer, "?");
+	}
+
+	static void EncodeInteger(ARG_WRITER&, ARG_TYPE, uint64);
+	static void EncodeDouble(ARG_WRITER&, double);
+	static void EncodeString(ARG_WRITER&, const char*);
+	static bool ReserveArgument(ARG_WRITER&, uint32);
+
+	FORMAT_INFO GetFormatInfo(const char*, const char*, uint32);
+	FORMAT_INFO RegisterFormat(const char*, const char*, uint32);
+	uint32 RegisterCategory(const char*);
+	bool IsCategoryEnabledByRules(const std::string&) const;
+	void ParseCategoryRules(const std::string&);
+
+	THREAD_BUFFER* GetThreadBuffer();
+	void CommitRecord(RECORD&);
+
+	void WriteBlock(BLOCK_TYPE, const void*, uint32, const void* = nullptr, uint32 = 0);
+	void WriteNewMetadata();
+	void Flush();
+	void WriterThreadProc();
+
+	static std::atomic<bool> m_enabled;
+
+	std::chrono::steady_clock::time_point m_startTime;
+
+	std::mutex m_mutex;
+	std::map<std::string, uint32> m_categoryIndices;
+	std::vector<std::string> m_categories;
+	std::atomic<bool> m_categoryEnabled[MAX_CATEGORIES];
+	std::vector<CATEGORY_RULE> m_categoryRules;
+	std::map<FormatIndexKey, FORMAT_INFO> m_formatIndices;
+	std::vector<FORMAT> m_formats;
+	std::vector<ThreadBufferPtr> m_threadBuffers;
+	uint32 m_nextThreadIndex = 0;
+
+	//Only used by the writer thread (or with it stopped)
+	Framework::CStdStream m_stream;
+	uint32 m_writtenCategoryCount = 0;
+	uint32 m_writtenFormatCount = 0;
+
+	std::thread m_writerThread;
+	std::condition_variable m_writerCondition;
+	bool m_writerEnd = false;
+};
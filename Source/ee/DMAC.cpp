@@ -4,6 +4,7 @@
 #include "../Ps2Const.h"
 #include "../Log.h"
 #include "../states/RegisterStateFile.h"
+#include "../states/RawState.h"
 #include "../MIPS.h"
 #include "../COP_SCU.h"
 #include "placeholder_def.h"
@@ -931,6 +932,48 @@ void CDMAC::SaveState(Framework::CZipArchiveWriter& archive)
 	m_D9.SaveState(archive);
 }
 
+void CDMAC::LoadRawState(Framework::CStream& stream)
+{
+	RawState::Read(stream, m_D_CTRL);
+	RawState::Read(stream, m_D_STAT);
+	RawState::Read(stream, m_D_ENABLE);
+	RawState::Read(stream, m_D_PCR);
+	RawState::Read(stream, m_D_SQWC);
+	RawState::Read(stream, m_D_RBSR);
+	RawState::Read(stream, m_D_RBOR);
+	RawState::Read(stream, m_D_STADR);
+	RawState::Read(stream, m_D8_SADR);
+	RawState::Read(stream, m_D9_SADR);
+
+	m_D0.LoadRawState(stream);
+	m_D1.LoadRawState(stream);
+	m_D2.LoadRawState(stream);
+	m_D4.LoadRawState(stream);
+	m_D8.LoadRawState(stream);
+	m_D9.LoadRawState(stream);
+}
+
+void CDMAC::SaveRawState(Framework::CStream& stream)
+{
+	RawState::Write(stream, m_D_CTRL);
+	RawState::Write(stream, m_D_STAT);
+	RawState::Write(stream, m_D_ENABLE);
+	RawState::Write(stream, m_D_PCR);
+	RawState::Write(stream, m_D_SQWC);
+	RawState::Write(stream, m_D_RBSR);
+	RawState::Write(stream, m_D_RBOR);
+	RawState::Write(stream, m_D_STADR);
+	RawState::Write(stream, m_D8_SADR);
+	RawState::Write(stream, m_D9_SADR);
+
+	m_D0.SaveRawState(stream);
+	m_D1.SaveRawState(stream);
+	m_D2.SaveRawState(stream);
+	m_D4.SaveRawState(stream);
+	m_D8.SaveRawState(stream);
+	m_D9.SaveRawState(stream);
+}
+
 void CDMAC::UpdateCpCond()
 {
 	bool condValue = true;
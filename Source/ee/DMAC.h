@@ -106,6 +106,8 @@ public:
 
 	void LoadState(Framework::CZipArchiveReader&);
 	void SaveState(Framework::CZipArchiveWriter&);
+	void LoadRawState(Framework::CStream&);
+	void SaveRawState(Framework::CStream&);
 
 	void DisassembleGet(uint32);
 	void DisassembleSet(uint32, uint32);
@@ -2,6 +2,7 @@
 #include <assert.h>
 #include "string_format.h"
 #include "../states/RegisterStateFile.h"
+#include "../states/RawState.h"
 #include "../Log.h"
 #include "Dmac_Channel.h"
 #include "DMAC.h"
@@ -66,6 +67,26 @@ void CChannel::LoadState(Framework::CZipArchiveReader& archive)
 	m_nASR[1] = registerFile.GetRegister32(STATE_REGS_ASR1);
 }
 
+void CChannel::SaveRawState(Framework::CStream& stream)
+{
+	RawState::Write(stream, m_CHCR);
+	RawState::Write(stream, m_nMADR);
+	RawState::Write(stream, m_nQWC);
+	RawState::Write(stream, m_nTADR);
+	RawState::Write(stream, m_nSCCTRL);
+	RawState::Write(stream, m_nASR);
+}
+
+void CChannel::LoadRawState(Framework::CStream& stream)
+{
+	RawState::Read(stream, m_CHCR);
+	RawState::Read(stream, m_nMADR);
+	RawState::Read(stream, m_nQWC);
+	RawState::Read(stream, m_nTADR);
+	RawState::Read(stream, m_nSCCTRL);
+	RawState::Read(stream, m_nASR);
+}
+
 uint32 CChannel::ReadCHCR()
 {
 	return m_CHCR;
@@ -69,6 +69,8 @@ namespace Dmac
 
 		void SaveState(Framework::CZipArchiveWriter&);
 		void LoadState(Framework::CZipArchiveReader&);
+		void SaveRawState(Framework::CStream&);
+		void LoadRawState(Framework::CStream&);
 
 		void Reset();
 		uint32 ReadCHCR();
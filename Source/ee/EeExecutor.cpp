@@ -1,6 +1,8 @@
 #include "EeExecutor.h"
 #include "../Ps2Const.h"
+#include "../MemoryUtils.h"
 #include "AlignedAlloc.h"
+#include "make_unique.h"
 #include <zlib.h>
 
 #if defined(__unix__) || defined(__ANDROID__) || defined(__APPLE__)
@@ -30,19 +32,125 @@
 
 #endif
 
+//Kernel area isn't protected (see BlockFactory), pages in there are always reported as dirty
+#define DIRTY_TRACKING_START (0x100000)
+
 static CEeExecutor* g_eeExecutor = nullptr;
 
+#ifdef EEEXECUTOR_FASTMEM_FAULTS
+//Maps x86-64 register numbers (as encoded in instructions) to their mcontext slots
+static const int g_hostRegisterIndices[16] =
+    {
+        REG_RAX, REG_RCX, REG_RDX, REG_RBX, REG_RSP, REG_RBP, REG_RSI, REG_RDI,
+        REG_R8, REG_R9, REG_R10, REG_R11, REG_R12, REG_R13, REG_R14, REG_R15,
+    };
+
+//Jitted code faulting on a fast memory access is redirected here by the signal handler.
+//Saves the whole host state (registers are stored in instruction encoding order so
+//that the slow path can address them by index), runs the access through the memory map
+//and resumes after the faulting instruction. The red zone below the stack pointer is
+//left untouched.
+extern "C" void EeExecutor_FastMemFaultThunk();
+
+asm(
+    ".text\n"
+    ".p2align 4\n"
+    "EeExecutor_FastMemFaultThunk:\n"
+    ".intel_syntax noprefix\n"
+    "	lea rsp, [rsp - 136]\n"
+    "	pushfq\n"
+    "	push r15\n"
+    "	push r14\n"
+    "	push r13\n"
+    "	push r12\n"
+    "	push r11\n"
+    "	push r10\n"
+    "	push r9\n"
+    "	push r8\n"
+    "	push rdi\n"
+    "	push rsi\n"
+    "	push rbp\n"
+    "	push rsp\n"
+    "	push rbx\n"
+    "	push rdx\n"
+    "	push rcx\n"
+    "	push rax\n"
+    "	mov rbp, rsp\n"
+    "	and rsp, -16\n"
+    "	sub rsp, 256\n"
+    "	movdqu [rsp + 0x00], xmm0\n"
+    "	movdqu [rsp + 0x10], xmm1\n"
+    "	movdqu [rsp + 0x20], xmm2\n"
+    "	movdqu [rsp + 0x30], xmm3\n"
+    "	movdqu [rsp + 0x40], xmm4\n"
+    "	movdqu [rsp + 0x50], xmm5\n"
+    "	movdqu [rsp + 0x60], xmm6\n"
+    "	movdqu [rsp + 0x70], xmm7\n"
+    "	movdqu [rsp + 0x80], xmm8\n"
+    "	movdqu [rsp + 0x90], xmm9\n"
+    "	movdqu [rsp + 0xA0], xmm10\n"
+    "	movdqu [rsp + 0xB0], xmm11\n"
+    "	movdqu [rsp + 0xC0], xmm12\n"
+    "	movdqu [rsp + 0xD0], xmm13\n"
+    "	movdqu [rsp + 0xE0], xmm14\n"
+    "	movdqu [rsp + 0xF0], xmm15\n"
+    "	cld\n"
+    "	mov rdi, rbp\n"
+    "	call EeExecutor_ExecuteFastMemFault\n"
+    "	mov [rbp + 136], rax\n"
+    "	movdqu xmm0, [rsp + 0x00]\n"
+    "	movdqu xmm1, [rsp + 0x10]\n"
+    "	movdqu xmm2, [rsp + 0x20]\n"
+    "	movdqu xmm3, [rsp + 0x30]\n"
+    "	movdqu xmm4, [rsp + 0x40]\n"
+    "	movdqu xmm5, [rsp + 0x50]\n"
+    "	movdqu xmm6, [rsp + 0x60]\n"
+    "	movdqu xmm7, [rsp + 0x70]\n"
+    "	movdqu xmm8, [rsp + 0x80]\n"
+    "	movdqu xmm9, [rsp + 0x90]\n"
+    "	movdqu xmm10, [rsp + 0xA0]\n"
+    "	movdqu xmm11, [rsp + 0xB0]\n"
+    "	movdqu xmm12, [rsp + 0xC0]\n"
+    "	movdqu xmm13, [rsp + 0xD0]\n"
+    "	movdqu xmm14, [rsp + 0xE0]\n"
+    "	movdqu xmm15, [rsp + 0xF0]\n"
+    "	mov rsp, rbp\n"
+    "	pop rax\n"
+    "	pop rcx\n"
+    "	pop rdx\n"
+    "	pop rbx\n"
+    "	lea rsp, [rsp + 8]\n"
+    "	pop rbp\n"
+    "	pop rsi\n"
+    "	pop rdi\n"
+    "	pop r8\n"
+    "	pop r9\n"
+    "	pop r10\n"
+    "	pop r11\n"
+    "	pop r12\n"
+    "	pop r13\n"
+    "	pop r14\n"
+    "	pop r15\n"
+    "	popfq\n"
+    "	ret 128\n"
+    ".att_syntax prefix\n");
+#endif
+
 CEeExecutor::CEeExecutor(CMIPS& context, uint8* ram)
     : CGenericMipsExecutor(context, 0x20000000)
     , m_ram(ram)
 {
 	m_pageSize = framework_getpagesize();
+	size_t pageCount = PS2::EE_RAM_SIZE / m_pageSize;
+	m_foreignFaultPages = std::make_unique<std::atomic<uint64>[]>((pageCount + 63) / 64);
+	m_dirtyPages = std::make_unique<std::atomic<uint64>[]>((pageCount + 63) / 64);
 }
 
 void CEeExecutor::AddExceptionHandler()
 {
 	assert(g_eeExecutor == nullptr);
 	g_eeExecutor = this;
+	m_ownerThreadId = std::this_thread::get_id();
 
 #ifdef DISABLE_PROTECTION
 	return;
@@ -93,17 +201,147 @@ void CEeExecutor::RemoveExceptionHandler()
 	g_eeExecutor = nullptr;
 }
 
+void CEeExecutor::SetFastMemArena(CFastMemArena* fastMemArena)
+{
+	m_fastMemArena = fastMemArena;
+}
+
+bool CEeExecutor::StartDirtyPageTracking()
+{
+#ifdef DISABLE_PROTECTION
+	return false;
+#else
+	//Everything is considered dirty until the first collection protects it
+	m_dirtyPageTracking = true;
+	MarkPagesDirty(0, PS2::EE_RAM_SIZE);
+	return true;
+#endif
+}
+
+void CEeExecutor::StopDirtyPageTracking()
+{
+	//Pages that are still protected will be unprotected as they get written to
+	m_dirtyPageTracking = false;
+}
+
+void CEeExecutor::CollectDirtyPages(std::vector<uint32>& pages)
+{
+	assert(m_dirtyPageTracking);
+	size_t pageCount = PS2::EE_RAM_SIZE / m_pageSize;
+	uint32 protectStart = 0;
+	uint32 protectEnd = 0;
+	for(size_t wordIndex = 0; wordIndex < (pageCount + 63) / 64; wordIndex++)
+	{
+		uint64 pageBits = m_dirtyPages[wordIndex].exchange(0);
+		while(pageBits != 0)
+		{
+			unsigned int bitIndex = 0;
+			while((pageBits & (1ULL << bitIndex)) == 0)
+			{
+				bitIndex++;
+			}
+			pageBits &= ~(1ULL << bitIndex);
+			uint32 pageIndex = static_cast<uint32>((wordIndex * 64) + bitIndex);
+			pages.push_back(pageIndex);
+
+			uint32 address = static_cast<uint32>(pageIndex * m_pageSize);
+			if(address < DIRTY_TRACKING_START)
+			{
+				//Stays dirty
+				m_dirtyPages[wordIndex] |= (1ULL << bitIndex);
+				continue;
+			}
+			//Protect contiguous pages with a single call
+			if(address != protectEnd)
+			{
+				if(protectStart != protectEnd)
+				{
+					SetMemoryProtected(m_ram + protectStart, protectEnd - protectStart, true);
+				}
+				protectStart = address;
+			}
+			protectEnd = address + static_cast<uint32>(m_pageSize);
+		}
+	}
+	if(protectStart != protectEnd)
+	{
+		SetMemoryProtected(m_ram + protectStart, protectEnd - protectStart, true);
+	}
+}
+
+uint32 CEeExecutor::GetPageSize() const
+{
+	return static_cast<uint32>(m_pageSize);
+}
+
+void CEeExecutor::MarkPagesDirty(uint32 start, uint32 end)
+{
+	if(!m_dirtyPageTracking) return;
+	end = std::min<uint32>(end, PS2::EE_RAM_SIZE);
+	for(size_t pageIndex = start / m_pageSize; pageIndex < (end + m_pageSize - 1) / m_pageSize; pageIndex++)
+	{
+		m_dirtyPages[pageIndex / 64] |= (1ULL << (pageIndex % 64));
+	}
+}
+
 void CEeExecutor::Reset()
 {
 	SetMemoryProtected(m_ram, PS2::EE_RAM_SIZE, false);
+	MarkPagesDirty(0, PS2::EE_RAM_SIZE);
+	ClearForeignFaultPages();
 	m_cachedBlocks.clear();
+	m_slowMemoryBlocks.clear();
+	m_pendingSlowMemoryRanges.clear();
 	CGenericMipsExecutor::Reset();
 }
 
+int CEeExecutor::Execute(int cycles)
+{
+	if(m_hasForeignFaults.exchange(false))
+	{
+		size_t pageCount = PS2::EE_RAM_SIZE / m_pageSize;
+		for(size_t wordIndex = 0; wordIndex < (pageCount + 63) / 64; wordIndex++)
+		{
+			uint64 pageBits = m_foreignFaultPages[wordIndex].exchange(0);
+			while(pageBits != 0)
+			{
+				unsigned int bitIndex = 0;
+				while((pageBits & (1ULL << bitIndex)) == 0)
+				{
+					bitIndex++;
+				}
+				pageBits &= ~(1ULL << bitIndex);
+				uint32 address = static_cast<uint32>(((wordIndex * 64) + bitIndex) * m_pageSize);
+				ClearActiveBlocksInRange(address, address + static_cast<uint32>(m_pageSize), false);
+			}
+		}
+	}
+	if(!m_pendingSlowMemoryRanges.empty())
+	{
+		for(const auto& range : m_pendingSlowMemoryRanges)
+		{
+			CGenericMipsExecutor::ClearActiveBlocksInRange(range.first, range.second, false);
+		}
+		m_pendingSlowMemoryRanges.clear();
+	}
+	return CGenericMipsExecutor::Execute(cycles);
+}
+
+void CEeExecutor::ClearForeignFaultPages()
+{
+	size_t pageCount = PS2::EE_RAM_SIZE / m_pageSize;
+	for(size_t wordIndex = 0; wordIndex < (pageCount + 63) / 64; wordIndex++)
+	{
+		m_foreignFaultPages[wordIndex] = 0;
+	}
+	m_hasForeignFaults = false;
+}
+
 void CEeExecutor::ClearActiveBlocksInRange(uint32 start, uint32 end, bool executing)
 {
 	uint32 rangeSize = end - start;
 	SetMemoryProtected(m_ram + start, rangeSize, false);
+	MarkPagesDirty(start, end);
 	CGenericMipsExecutor::ClearActiveBlocksInRange(start, end, executing);
 }
 
@@ -119,6 +357,19 @@ BasicBlockPtr CEeExecutor::BlockFactory(CMIPS& context, uint32 start, uint32 end
 		SetMemoryProtected(m_ram + start, blockSize, true);
 	}
 
+	//Blocks that faulted on fast memory accesses can't be shared with the caches, which
+	//only hold blocks compiled with fastmem
+	if(IsSlowMemoryRange(start, end))
+	{
+		auto result = std::make_shared<CBasicBlock>(context, start, end);
+		auto fastMemBase = context.m_fastMemBase;
+		context.m_fastMemBase = nullptr;
+		result->Compile();
+		context.m_fastMemBase = fastMemBase;
+		CountBlockCompilation(false);
+		return result;
+	}
+
 	auto blockMemory = reinterpret_cast<uint32*>(alloca(blockSize));
 	for(uint32 address = start; address <= end; address += 4)
 	{
@@ -148,8 +399,20 @@ BasicBlockPtr CEeExecutor::BlockFactory(CMIPS& context, uint32 start, uint32 end
 		}
 	}
 
-	auto result = std::make_shared<CBasicBlock>(context, start, end);
-	result->Compile();
+	auto result = hasBreakpoint ? BasicBlockPtr() : TakePrecompiledBlock(start, end);
+	if(!result)
+	{
+		result = std::make_shared<CBasicBlock>(context, start, end);
+		if(m_blockCache && !hasBreakpoint)
+		{
+			CountBlockCompilation(result->CompileWithCache(*m_blockCache, checksum));
+		}
+		else
+		{
+			result->Compile();
+			CountBlockCompilation(false);
+		}
+	}
 	if(!hasBreakpoint)
 	{
 		m_cachedBlocks.insert(std::make_pair(checksum, result));
@@ -157,12 +420,36 @@ BasicBlockPtr CEeExecutor::BlockFactory(CMIPS& context, uint32 start, uint32 end
 	return result;
 }
 
+bool CEeExecutor::IsSlowMemoryRange(uint32 start, uint32 end) const
+{
+	if(!m_fastMemArena) return false;
+	auto blockIterator = m_slowMemoryBlocks.lower_bound(start);
+	return (blockIterator != m_slowMemoryBlocks.end()) && (*blockIterator <= end);
+}
+
 bool CEeExecutor::HandleAccessFault(intptr_t ptr)
 {
 	ptrdiff_t addr = reinterpret_cast<uint8*>(ptr) - m_ram;
+	if(m_fastMemArena && m_fastMemArena->Contains(reinterpret_cast<void*>(ptr)))
+	{
+		//Fastmem views of RAM are protected along with RAM, anything else isn't a code write
+		uint32 ramOffset = 0;
+		uint32 address = m_fastMemArena->GetAddress(reinterpret_cast<void*>(ptr));
+		if(!m_fastMemArena->GetRamOffset(address, ramOffset)) return false;
+		addr = ramOffset;
+	}
 	if(addr >= 0 && addr < PS2::EE_RAM_SIZE)
 	{
 		addr &= ~(m_pageSize - 1);
+		if(std::this_thread::get_id() != m_ownerThreadId)
+		{
+			size_t pageIndex = addr / m_pageSize;
+			SetMemoryProtected(m_ram + addr, m_pageSize, false);
+			MarkPagesDirty(static_cast<uint32>(addr), static_cast<uint32>(addr + m_pageSize));
+			m_foreignFaultPages[pageIndex / 64] |= (1ULL << (pageIndex % 64));
+			m_hasForeignFaults = true;
+			return true;
+		}
 		ClearActiveBlocksInRange(addr, addr + m_pageSize, true);
 		return true;
 	}
@@ -175,6 +462,15 @@ void CEeExecutor::SetMemoryProtected(void* addr, size_t size, bool protect)
 	return;
 #endif
 
+	if(m_fastMemArena)
+	{
+		ptrdiff_t offset = reinterpret_cast<uint8*>(addr) - m_ram;
+		if((offset >= 0) && (offset < PS2::EE_RAM_SIZE))
+		{
+			m_fastMemArena->SetRamProtected(static_cast<uint32>(offset), static_cast<uint32>(size), protect);
+		}
+	}
+
 #if defined(_WIN32)
 	DWORD oldProtect = 0;
 	BOOL result = VirtualProtect(addr, size, protect ? PAGE_READONLY : PAGE_READWRITE, &oldProtect);
@@ -224,9 +520,139 @@ void CEeExecutor::HandleExceptionInternal(int sigId, siginfo_t* sigInfo, void* b
 	{
 		return;
 	}
+#ifdef EEEXECUTOR_FASTMEM_FAULTS
+	if(HandleFastMemFault(reinterpret_cast<intptr_t>(sigInfo->si_addr), reinterpret_cast<ucontext_t*>(baseContext)))
+	{
+		return;
+	}
+#endif
 	signal(SIGSEGV, SIG_DFL);
 }
 
+#ifdef EEEXECUTOR_FASTMEM_FAULTS
+
+//Jitted load or store that hit an arena address which isn't backed by memory (I/O registers,
+//unmapped areas). Nothing that isn't async-signal-safe can be done here, the fault is recorded
+//and execution continues in the slow path thunk which emulates the access through the memory map.
+bool CEeExecutor::HandleFastMemFault(intptr_t ptr, ucontext_t* context)
+{
+	auto faultPtr = reinterpret_cast<void*>(ptr);
+	if(!m_fastMemArena || !m_fastMemArena->Contains(faultPtr)) return false;
+	if(std::this_thread::get_id() != m_ownerThreadId) return false;
+
+	auto& registers = context->uc_mcontext.gregs;
+	auto code = reinterpret_cast<const uint8*>(registers[REG_RIP]);
+	CFastMemArena::HOST_ACCESS access;
+	if(!CFastMemArena::DecodeHostAccess(code, access)) return false;
+	//Stack pointer isn't restored by the thunk
+	if(!access.hasImmediate && (access.registerIndex == 4)) return false;
+
+	m_fastMemFault.access = access;
+	m_fastMemFault.address = m_fastMemArena->GetAddress(faultPtr);
+	m_fastMemFault.resumeAddress = static_cast<uintptr_t>(registers[REG_RIP]) + access.length;
+	registers[REG_RIP] = reinterpret_cast<greg_t>(&EeExecutor_FastMemFaultThunk);
+	return true;
+}
+
+uintptr_t CEeExecutor::ExecuteFastMemFault(uint64* registers)
+{
+	return g_eeExecutor->ExecuteFastMemFaultInternal(registers);
+}
+
+uintptr_t CEeExecutor::ExecuteFastMemFaultInternal(uint64* registers)
+{
+	auto fault = m_fastMemFault;
+	const auto& access = fault.access;
+	uint32 address = fault.address;
+	auto& hostRegister = registers[access.registerIndex];
+	if(access.isStore)
+	{
+		uint64 value = access.hasImmediate ? access.immediate : hostRegister;
+		if(access.isHighByteRegister)
+		{
+			value >>= 8;
+		}
+		switch(access.size)
+		{
+		case 1:
+			MemoryUtils_SetByteProxy(&m_context, static_cast<uint8>(value), address);
+			break;
+		case 2:
+			MemoryUtils_SetHalfProxy(&m_context, static_cast<uint16>(value), address);
+			break;
+		case 4:
+			MemoryUtils_SetWordProxy(&m_context, static_cast<uint32>(value), address);
+			break;
+		case 8:
+			MemoryUtils_SetDoubleProxy(&m_context, value, address);
+			break;
+		}
+	}
+	else
+	{
+		uint64 value = 0;
+		switch(access.size)
+		{
+		case 1:
+			value = MemoryUtils_GetByteProxy(&m_context, address);
+			if(access.isSignExtended) value = static_cast<int8>(value);
+			break;
+		case 2:
+			value = MemoryUtils_GetHalfProxy(&m_context, address);
+			if(access.isSignExtended) value = static_cast<int16>(value);
+			break;
+		case 4:
+			value = MemoryUtils_GetWordProxy(&m_context, address);
+			if(access.isSignExtended) value = static_cast<int32>(value);
+			break;
+		case 8:
+			value = MemoryUtils_GetDoubleProxy(&m_context, address);
+			break;
+		}
+		uint64 registerValue = hostRegister;
+		switch(access.registerSize)
+		{
+		case 1:
+			if(access.isHighByteRegister)
+			{
+				registerValue = (registerValue & ~0xFF00ULL) | ((value & 0xFF) << 8);
+			}
+			else
+			{
+				registerValue = (registerValue & ~0xFFULL) | (value & 0xFF);
+			}
+			break;
+		case 2:
+			registerValue = (registerValue & ~0xFFFFULL) | (value & 0xFFFF);
+			break;
+		case 4:
+			//32-bit writes clear the upper half of the register
+			registerValue = static_cast<uint32>(value);
+			break;
+		case 8:
+			registerValue = value;
+			break;
+		}
+		hostRegister = registerValue;
+	}
+
+	//Have the running block recompiled without fastmem so that it doesn't keep faulting.
+	//The block is still running, it gets cleared on the next call to Execute.
+	auto block = FindBlockStartingAt(m_context.m_State.nPC);
+	if(!block->IsEmpty())
+	{
+		auto range = std::make_pair(block->GetBeginAddress(), block->GetEndAddress() + 4);
+		m_slowMemoryBlocks.insert(range.first);
+		if(m_pendingSlowMemoryRanges.empty() || (m_pendingSlowMemoryRanges.back() != range))
+		{
+			m_pendingSlowMemoryRanges.push_back(range);
+		}
+	}
+	return fault.resumeAddress;
+}
+
+#endif
+
 #elif defined(__APPLE__)
 
 void CEeExecutor::HandlerThreadProc()
@@ -4,12 +4,22 @@
 #include <Windows.h>
 #elif defined(__APPLE__)
 #include <mach/mach.h>
-#include <thread>
 #elif defined(__unix__)
 #include <signal.h>
 #endif
 
+#include <atomic>
+#include <memory>
+#include <set>
+#include <thread>
+#include <vector>
 #include "../GenericMipsExecutor.h"
+#include "FastMemArena.h"
+
+#if defined(__linux__) && !defined(__ANDROID__) && defined(__x86_64__)
+#define EEEXECUTOR_FASTMEM_FAULTS
+#include <ucontext.h>
+#endif
 
 class CEeExecutor : public CGenericMipsExecutor<BlockLookupTwoWay>
 {
@@ -20,7 +30,17 @@ public:
 	void AddExceptionHandler();
 	void RemoveExceptionHandler();
 
+	void SetFastMemArena(CFastMemArena*);
+
+	//Keeps track of RAM pages written to using the same write protection as code invalidation.
+	//CollectDirtyPages returns pages written to since the previous call and protects them again.
+	bool StartDirtyPageTracking();
+	void StopDirtyPageTracking();
+	void CollectDirtyPages(std::vector<uint32>&);
+	uint32 GetPageSize() const;
+
 	void Reset() override;
+	int Execute(int) override;
 	void ClearActiveBlocksInRange(uint32, uint32, bool) override;
 
 	BasicBlockPtr BlockFactory(CMIPS&, uint32, uint32) override;
@@ -32,7 +52,26 @@ private:
 	uint8* m_ram = nullptr;
 	size_t m_pageSize = 0;
 
+	//Blocks that faulted on a fast memory access, these are compiled without fastmem
+	CFastMemArena* m_fastMemArena = nullptr;
+	std::set<uint32> m_slowMemoryBlocks;
+
+	//Blocks that faulted while running are cleared on the next Execute call
+	std::vector<std::pair<uint32, uint32>> m_pendingSlowMemoryRanges;
+
+	//Faults raised by other threads (ie.: IOP thread writing to EE RAM) can't clear blocks
+	//right away, pages are unprotected and blocks are cleared on the next Execute call.
+	std::thread::id m_ownerThreadId;
+	std::unique_ptr<std::atomic<uint64>[]> m_foreignFaultPages;
+	std::atomic<bool> m_hasForeignFaults = {false};
+
+	std::unique_ptr<std::atomic<uint64>[]> m_dirtyPages;
+	std::atomic<bool> m_dirtyPageTracking = {false};
+
 	bool HandleAccessFault(intptr_t);
+	void MarkPagesDirty(uint32, uint32);
+	bool IsSlowMemoryRange(uint32, uint32) const;
+	void ClearForeignFaultPages();
 	void SetMemoryProtected(void*, size_t, bool);
 
 #if defined(_WIN32)
@@ -43,6 +82,22 @@ private:
 #elif defined(__unix__) || defined(__ANDROID__)
 	static void HandleException(int, siginfo_t*, void*);
 	void HandleExceptionInternal(int, siginfo_t*, void*);
+#ifdef EEEXECUTOR_FASTMEM_FAULTS
+	//Filled by the signal handler, the access itself is done by the slow path thunk
+	//outside of signal context.
+	struct FASTMEM_FAULT
+	{
+		CFastMemArena::HOST_ACCESS access;
+		uint32 address = 0;
+		uintptr_t resumeAddress = 0;
+	};
+
+	bool HandleFastMemFault(intptr_t, ucontext_t*);
+	static uintptr_t ExecuteFastMemFault(uint64*) __asm__("EeExecutor_ExecuteFastMemFault") __attribute__((visibility("hidden")));
+	uintptr_t ExecuteFastMemFaultInternal(uint64*);
+
+	FASTMEM_FAULT m_fastMemFault;
+#endif
 #elif defined(__APPLE__)
 	void HandlerThreadProc();
 
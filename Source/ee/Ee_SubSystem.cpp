@@ -4,6 +4,7 @@
 #include "../Ps2Const.h"
 #include "../Log.h"
 #include "../states/MemoryStateFile.h"
+#include "../states/RawState.h"
 #include "../iop/IopBios.h"
 #include "Vif.h"
 #include "placeholder_def.h"
@@ -24,10 +25,11 @@ using namespace Ee;
 
 #define FAKE_IOP_RAM_SIZE (0x1000)
 
-CSubSystem::CSubSystem(uint8* iopRam, CIopBios& iopBios)
-    : m_ram(reinterpret_cast<uint8*>(framework_aligned_alloc(PS2::EE_RAM_SIZE, framework_getpagesize())))
-    , m_bios(new uint8[PS2::EE_BIOS_SIZE])
-    , m_spr(reinterpret_cast<uint8*>(framework_aligned_alloc(PS2::EE_SPR_SIZE, 0x10)))
+CSubSystem::CSubSystem(uint8* iopRam, CIopBios& iopBios, bool fastMem)
+    : m_fastMemArena(CreateFastMemArena(fastMem))
+    , m_ram(m_fastMemArena ? m_fastMemArena->GetRam() : reinterpret_cast<uint8*>(framework_aligned_alloc(PS2::EE_RAM_SIZE, framework_getpagesize())))
+    , m_bios(m_fastMemArena ? m_fastMemArena->GetBios() : new uint8[PS2::EE_BIOS_SIZE])
+    , m_spr(m_fastMemArena ? m_fastMemArena->GetSpr() : reinterpret_cast<uint8*>(framework_aligned_alloc(PS2::EE_SPR_SIZE, 0x10)))
     , m_fakeIopRam(new uint8[FAKE_IOP_RAM_SIZE])
     , m_vuMem0(reinterpret_cast<uint8*>(framework_aligned_alloc(PS2::VUMEM0SIZE, 0x10)))
     , m_microMem0(new uint8[PS2::MICROMEM0SIZE])
@@ -66,6 +68,11 @@ CSubSystem::CSubSystem(uint8* iopRam, CIopBios& iopBios)
 	//EmotionEngine context setup
 	{
 		m_EE.m_executor = std::make_unique<CEeExecutor>(m_EE, m_ram);
+		if(m_fastMemArena)
+		{
+			static_cast<CEeExecutor*>(m_EE.m_executor.get())->SetFastMemArena(m_fastMemArena.get());
+			m_EE.m_fastMemBase = m_fastMemArena->GetBase();
+		}
 
 		//Read map
 		m_EE.m_pMemoryMap->InsertReadMap(0x00000000, 0x01FFFFFF, m_ram, 0x00);
@@ -73,8 +80,8 @@ CSubSystem::CSubSystem(uint8* iopRam, CIopBios& iopBios)
 		m_EE.m_pMemoryMap->InsertReadMap(0x10000000, 0x10FFFFFF, std::bind(&CSubSystem::IOPortReadHandler, this, PLACEHOLDER_1), 0x02);
 		m_EE.m_pMemoryMap->InsertReadMap(PS2::MICROMEM0ADDR, PS2::MICROMEM0ADDR + PS2::MICROMEM0SIZE - 1, m_microMem0, 0x03);
 		m_EE.m_pMemoryMap->InsertReadMap(PS2::VUMEM0ADDR, PS2::VUMEM0ADDR + PS2::VUMEM0SIZE - 1, m_vuMem0, 0x04);
-		m_EE.m_pMemoryMap->InsertReadMap(PS2::MICROMEM1ADDR, PS2::MICROMEM1ADDR + PS2::MICROMEM1SIZE - 1, m_microMem1, 0x05);
-		m_EE.m_pMemoryMap->InsertReadMap(PS2::VUMEM1ADDR, PS2::VUMEM1ADDR + PS2::VUMEM1SIZE - 1, m_vuMem1, 0x06);
+		m_EE.m_pMemoryMap->InsertReadMap(PS2::MICROMEM1ADDR, PS2::MICROMEM1ADDR + PS2::MICROMEM1SIZE - 1, std::bind(&CSubSystem::Vu1MicroMemReadHandler, this, PLACEHOLDER_1), 0x05);
+		m_EE.m_pMemoryMap->InsertReadMap(PS2::VUMEM1ADDR, PS2::VUMEM1ADDR + PS2::VUMEM1SIZE - 1, std::bind(&CSubSystem::Vu1MemReadHandler, this, PLACEHOLDER_1), 0x06);
 		m_EE.m_pMemoryMap->InsertReadMap(0x12000000, 0x12FFFFFF, std::bind(&CSubSystem::IOPortReadHandler, this, PLACEHOLDER_1), 0x07);
 		m_EE.m_pMemoryMap->InsertReadMap(0x1C000000, 0x1C001000, m_fakeIopRam, 0x08);
 		m_EE.m_pMemoryMap->InsertReadMap(0x1FC00000, 0x1FFFFFFF, m_bios, 0x09);
@@ -86,7 +93,7 @@ CSubSystem::CSubSystem(uint8* iopRam, CIopBios& iopBios)
 		m_EE.m_pMemoryMap->InsertWriteMap(PS2::MICROMEM0ADDR, PS2::MICROMEM0ADDR + PS2::MICROMEM0SIZE - 1, std::bind(&CSubSystem::Vu0MicroMemWriteHandler, this, PLACEHOLDER_1, PLACEHOLDER_2), 0x03);
 		m_EE.m_pMemoryMap->InsertWriteMap(PS2::VUMEM0ADDR, PS2::VUMEM0ADDR + PS2::VUMEM0SIZE - 1, m_vuMem0, 0x04);
 		m_EE.m_pMemoryMap->InsertWriteMap(PS2::MICROMEM1ADDR, PS2::MICROMEM1ADDR + PS2::MICROMEM1SIZE - 1, std::bind(&CSubSystem::Vu1MicroMemWriteHandler, this, PLACEHOLDER_1, PLACEHOLDER_2), 0x05);
-		m_EE.m_pMemoryMap->InsertWriteMap(PS2::VUMEM1ADDR, PS2::VUMEM1ADDR + PS2::VUMEM1SIZE - 1, m_vuMem1, 0x06);
+		m_EE.m_pMemoryMap->InsertWriteMap(PS2::VUMEM1ADDR, PS2::VUMEM1ADDR + PS2::VUMEM1SIZE - 1, std::bind(&CSubSystem::Vu1MemWriteHandler, this, PLACEHOLDER_1, PLACEHOLDER_2), 0x06);
 		m_EE.m_pMemoryMap->InsertWriteMap(0x12000000, 0x12FFFFFF, std::bind(&CSubSystem::IOPortWriteHandler, this, PLACEHOLDER_1, PLACEHOLDER_2), 0x07);
 
 		//Instruction map
@@ -156,15 +163,19 @@ CSubSystem::CSubSystem(uint8* iopRam, CIopBios& iopBios)
 	m_OnRequestInstructionCacheFlushConnection = m_os->OnRequestInstructionCacheFlush.Connect(std::bind(&CSubSystem::FlushInstructionCache, this));
 
 	SetupEePageTable();
+	SetupIoPortHandlers();
 }
 
 CSubSystem::~CSubSystem()
 {
 	m_EE.m_executor->Reset();
 	delete m_os;
-	framework_aligned_free(m_ram);
-	delete[] m_bios;
-	framework_aligned_free(m_spr);
+	if(!m_fastMemArena)
+	{
+		framework_aligned_free(m_ram);
+		delete[] m_bios;
+		framework_aligned_free(m_spr);
+	}
 	delete[] m_fakeIopRam;
 	framework_aligned_free(m_vuMem0);
 	delete[] m_microMem0;
@@ -184,6 +195,7 @@ void CSubSystem::SetVpu1(std::shared_ptr<CVpu> newVpu1)
 
 void CSubSystem::Reset()
 {
+	m_vpu1->WaitForIdle();
 	m_os->Release();
 	m_EE.m_executor->Reset();
 
@@ -352,6 +364,7 @@ void CSubSystem::NotifyVBlankEnd()
 
 void CSubSystem::SaveState(Framework::CZipArchiveWriter& archive)
 {
+	m_vpu1->WaitForIdle();
 	archive.InsertFile(new CMemoryStateFile(STATE_EE, &m_EE.m_State, sizeof(MIPSSTATE)));
 	archive.InsertFile(new CMemoryStateFile(STATE_VU0, &m_VU0.m_State, sizeof(MIPSSTATE)));
 	archive.InsertFile(new CMemoryStateFile(STATE_VU1, &m_VU1.m_State, sizeof(MIPSSTATE)));
@@ -373,6 +386,7 @@ void CSubSystem::SaveState(Framework::CZipArchiveWriter& archive)
 
 void CSubSystem::LoadState(Framework::CZipArchiveReader& archive)
 {
+	m_vpu1->WaitForIdle();
 	m_EE.m_executor->Reset();
 
 	archive.BeginReadFile(STATE_EE)->Read(&m_EE.m_State, sizeof(MIPSSTATE));
@@ -394,6 +408,52 @@ void CSubSystem::LoadState(Framework::CZipArchiveReader& archive)
 	m_gif.LoadState(archive);
 }
 
+void CSubSystem::SaveDeviceState(Framework::CStream& stream)
+{
+	m_vpu1->WaitForIdle();
+	RawState::Write(stream, m_EE.m_State);
+	RawState::Write(stream, m_VU0.m_State);
+	RawState::Write(stream, m_VU1.m_State);
+
+	m_dmac.SaveRawState(stream);
+	m_intc.SaveRawState(stream);
+	m_sif.SaveRawState(stream);
+	m_vpu0->SaveRawState(stream);
+	m_vpu1->SaveRawState(stream);
+	m_timer.SaveRawState(stream);
+	m_gif.SaveRawState(stream);
+}
+
+void CSubSystem::LoadDeviceState(Framework::CStream& stream)
+{
+	m_vpu1->WaitForIdle();
+	m_EE.m_executor->Reset();
+
+	RawState::Read(stream, m_EE.m_State);
+	RawState::Read(stream, m_VU0.m_State);
+	RawState::Read(stream, m_VU1.m_State);
+
+	m_dmac.LoadRawState(stream);
+	m_intc.LoadRawState(stream);
+	m_sif.LoadRawState(stream);
+	m_vpu0->LoadRawState(stream);
+	m_vpu1->LoadRawState(stream);
+	m_timer.LoadRawState(stream);
+	m_gif.LoadRawState(stream);
+}
+
+std::unique_ptr<CFastMemArena> CSubSystem::CreateFastMemArena(bool fastMem)
+{
+	if(!fastMem || !CFastMemArena::IsSupported()) return std::unique_ptr<CFastMemArena>();
+	auto arena = std::make_unique<CFastMemArena>();
+	if(!arena->Create())
+	{
+		CLog::GetInstance().Warn(LOG_NAME, "Failed to create fastmem arena, falling back to regular memory accesses.\r\n");
+		return std::unique_ptr<CFastMemArena>();
+	}
+	return arena;
+}
+
 void CSubSystem::SetupEePageTable()
 {
 	m_EE.MapPages(0x00000000, PS2::EE_RAM_SIZE, m_ram);
@@ -402,40 +462,110 @@ void CSubSystem::SetupEePageTable()
 	m_EE.MapPages(0x80000000, PS2::EE_RAM_SIZE, m_ram);
 }
 
+void CSubSystem::SetupIoPortHandlers()
+{
+	m_ioPortReadHandlerIndices.fill(IOPORT_HANDLER_NONE);
+	m_ioPortWriteHandlerIndices.fill(IOPORT_HANDLER_NONE);
+
+	//Read handlers
+	InsertIoPortReadHandler(0x10000000, 0x1000183F, [this](uint32 address) { return m_timer.GetRegister(address); });
+	InsertIoPortReadHandler(0x10002000, 0x1000203F, [this](uint32 address) { return m_ipu.GetRegister(address); });
+	InsertIoPortReadHandler(CGIF::REGS_START, CGIF::REGS_END - 1, [this](uint32 address) { return m_gif.GetRegister(address); });
+	InsertIoPortReadHandler(CVif::REGS0_START, CVif::REGS0_END - 1, [this](uint32 address) { return m_vpu0->GetVif().GetRegister(address); });
+	InsertIoPortReadHandler(CVif::REGS1_START, CVif::REGS1_END - 1,
+	                        [this](uint32 address) {
+		                        m_vpu1->WaitForIdle();
+		                        return m_vpu1->GetVif().GetRegister(address);
+	                        });
+	InsertIoPortReadHandler(0x10008000, 0x1000EFFC, [this](uint32 address) { return m_dmac.GetRegister(address); });
+	InsertIoPortReadHandler(0x1000F000, 0x1000F01C, [this](uint32 address) { return m_intc.GetRegister(address); });
+	InsertIoPortReadHandler(0x1000F520, 0x1000F59C, [this](uint32 address) { return m_dmac.GetRegister(address); });
+
+	//Write handlers
+	InsertIoPortWriteHandler(0x10000000, 0x1000183F, [this](uint32 address, uint32 value) { m_timer.SetRegister(address, value); });
+	InsertIoPortWriteHandler(0x10002000, 0x1000203F,
+	                         [this](uint32 address, uint32 value) {
+		                         m_ipu.SetRegister(address, value);
+		                         ExecuteIpu();
+	                         });
+	InsertIoPortWriteHandler(CGIF::REGS_START, CGIF::REGS_END - 1, [this](uint32 address, uint32 value) { m_gif.SetRegister(address, value); });
+	InsertIoPortWriteHandler(CVif::REGS0_START, CVif::REGS0_END - 1, [this](uint32 address, uint32 value) { m_vpu0->GetVif().SetRegister(address, value); });
+	InsertIoPortWriteHandler(CVif::REGS1_START, CVif::REGS1_END - 1, [this](uint32 address, uint32 value) { m_vpu1->GetVif().SetRegister(address, value); });
+	InsertIoPortWriteHandler(CVif::VIF0_FIFO_START, CVif::VIF0_FIFO_END - 1, [this](uint32 address, uint32 value) { m_vpu0->GetVif().SetRegister(address, value); });
+	InsertIoPortWriteHandler(CVif::VIF1_FIFO_START, CVif::VIF1_FIFO_END - 1, [this](uint32 address, uint32 value) { m_vpu1->GetVif().SetRegister(address, value); });
+	InsertIoPortWriteHandler(0x10007000, 0x1000702F,
+	                         [this](uint32 address, uint32 value) {
+		                         m_ipu.SetRegister(address, value);
+		                         ExecuteIpu();
+	                         });
+	InsertIoPortWriteHandler(0x10008000, 0x1000EFFC,
+	                         [this](uint32 address, uint32 value) {
+		                         m_dmac.SetRegister(address, value);
+		                         ExecuteIpu();
+	                         });
+	InsertIoPortWriteHandler(0x1000F000, 0x1000F01C, [this](uint32 address, uint32 value) { m_intc.SetRegister(address, value); });
+	InsertIoPortWriteHandler(0x1000F180, 0x1000F180,
+	                         [this](uint32 address, uint32 value) {
+		                         //stdout data
+		                         m_sif.SyncIop();
+		                         m_iopBios.GetIoman()->Write(Iop::CIoman::FID_STDOUT, 1, &value);
+	                         });
+	InsertIoPortWriteHandler(0x1000F520, 0x1000F59C, [this](uint32 address, uint32 value) { m_dmac.SetRegister(address, value); });
+	InsertIoPortWriteHandler(CVpu::VU_CMSAR1, CVpu::VU_CMSAR1,
+	                         [this](uint32 address, uint32 value) {
+		                         bool validAddress = (value & 0x7) == 0;
+		                         m_vpu1->WaitForIdle();
+		                         if(!m_vpu1->IsVuRunning() && validAddress)
+		                         {
+			                         m_vpu1->ExecuteMicroProgram(value);
+		                         }
+	                         });
+}
+
+void CSubSystem::InsertIoPortReadHandler(uint32 start, uint32 end, IoPortReadHandler handler)
+{
+	InsertIoPortHandler(m_ioPortReadHandlers, m_ioPortReadHandlerIndices, start, end, std::move(handler));
+}
+
+void CSubSystem::InsertIoPortWriteHandler(uint32 start, uint32 end, IoPortWriteHandler handler)
+{
+	InsertIoPortHandler(m_ioPortWriteHandlers, m_ioPortWriteHandlerIndices, start, end, std::move(handler));
+}
+
+template <typename HandlerType>
+void CSubSystem::InsertIoPortHandler(std::vector<IOPORTHANDLER<HandlerType>>& handlers, IoPortHandlerIndexTable& indices, uint32 start, uint32 end, HandlerType handler)
+{
+	assert(start >= IOPORT_TABLE_START);
+	assert(end <= IOPORT_TABLE_END);
+	assert(start <= end);
+	assert(handlers.size() < IOPORT_HANDLER_NONE);
+	uint8 handlerIndex = static_cast<uint8>(handlers.size());
+	handlers.push_back({start, end, std::move(handler)});
+	for(uint32 slot = ((start - IOPORT_TABLE_START) >> IOPORT_SLOT_BITS); slot <= ((end - IOPORT_TABLE_START) >> IOPORT_SLOT_BITS); slot++)
+	{
+		//Handler ranges can't share a slot
+		assert(indices[slot] == IOPORT_HANDLER_NONE);
+		indices[slot] = handlerIndex;
+	}
+}
+
+template <typename HandlerType>
+const HandlerType* CSubSystem::FindIoPortHandler(const std::vector<IOPORTHANDLER<HandlerType>>& handlers, const IoPortHandlerIndexTable& indices, uint32 address)
+{
+	if((address < IOPORT_TABLE_START) || (address > IOPORT_TABLE_END)) return nullptr;
+	uint8 handlerIndex = indices[(address - IOPORT_TABLE_START) >> IOPORT_SLOT_BITS];
+	if(handlerIndex == IOPORT_HANDLER_NONE) return nullptr;
+	const auto& handler = handlers[handlerIndex];
+	if((address < handler.start) || (address > handler.end)) return nullptr;
+	return &handler.handler;
+}
+
 uint32 CSubSystem::IOPortReadHandler(uint32 nAddress)
 {
 	uint32 nReturn = 0;
-	if(nAddress >= 0x10000000 && nAddress <= 0x1000183F)
-	{
-		nReturn = m_timer.GetRegister(nAddress);
-	}
-	else if(nAddress >= 0x10002000 && nAddress <= 0x1000203F)
-	{
-		nReturn = m_ipu.GetRegister(nAddress);
-	}
-	else if(nAddress >= CGIF::REGS_START && nAddress < CGIF::REGS_END)
-	{
-		nReturn = m_gif.GetRegister(nAddress);
-	}
-	else if(nAddress >= CVif::REGS0_START && nAddress < CVif::REGS0_END)
-	{
-		nReturn = m_vpu0->GetVif().GetRegister(nAddress);
-	}
-	else if(nAddress >= CVif::REGS1_START && nAddress < CVif::REGS1_END)
-	{
-		nReturn = m_vpu1->GetVif().GetRegister(nAddress);
-	}
-	else if(nAddress >= 0x10008000 && nAddress <= 0x1000EFFC)
-	{
-		nReturn = m_dmac.GetRegister(nAddress);
-	}
-	else if(nAddress >= 0x1000F000 && nAddress <= 0x1000F01C)
+	if(auto handler = FindIoPortHandler(m_ioPortReadHandlers, m_ioPortReadHandlerIndices, nAddress))
 	{
-		nReturn = m_intc.GetRegister(nAddress);
-	}
-	else if(nAddress >= 0x1000F520 && nAddress <= 0x1000F59C)
-	{
-		nReturn = m_dmac.GetRegister(nAddress);
+		nReturn = (*handler)(nAddress);
 	}
 	else if(nAddress >= 0x12000000 && nAddress <= 0x1200108C)
 	{
@@ -466,65 +596,9 @@ uint32 CSubSystem::IOPortReadHandler(uint32 nAddress)
 
 uint32 CSubSystem::IOPortWriteHandler(uint32 nAddress, uint32 nData)
 {
-	if(nAddress >= 0x10000000 && nAddress <= 0x1000183F)
-	{
-		m_timer.SetRegister(nAddress, nData);
-	}
-	else if(nAddress >= 0x10002000 && nAddress <= 0x1000203F)
-	{
-		m_ipu.SetRegister(nAddress, nData);
-		ExecuteIpu();
-	}
-	else if(nAddress >= CGIF::REGS_START && nAddress < CGIF::REGS_END)
-	{
-		m_gif.SetRegister(nAddress, nData);
-	}
-	else if(nAddress >= CVif::REGS0_START && nAddress < CVif::REGS0_END)
-	{
-		m_vpu0->GetVif().SetRegister(nAddress, nData);
-	}
-	else if(nAddress >= CVif::REGS1_START && nAddress < CVif::REGS1_END)
-	{
-		m_vpu1->GetVif().SetRegister(nAddress, nData);
-	}
-	else if(nAddress >= CVif::VIF0_FIFO_START && nAddress < CVif::VIF0_FIFO_END)
-	{
-		m_vpu0->GetVif().SetRegister(nAddress, nData);
-	}
-	else if(nAddress >= CVif::VIF1_FIFO_START && nAddress < CVif::VIF1_FIFO_END)
-	{
-		m_vpu1->GetVif().SetRegister(nAddress, nData);
-	}
-	else if(nAddress >= 0x10007000 && nAddress <= 0x1000702F)
-	{
-		m_ipu.SetRegister(nAddress, nData);
-		ExecuteIpu();
-	}
-	else if(nAddress >= 0x10008000 && nAddress <= 0x1000EFFC)
+	if(auto handler = FindIoPortHandler(m_ioPortWriteHandlers, m_ioPortWriteHandlerIndices, nAddress))
 	{
-		m_dmac.SetRegister(nAddress, nData);
-		ExecuteIpu();
-	}
-	else if(nAddress >= 0x1000F000 && nAddress <= 0x1000F01C)
-	{
-		m_intc.SetRegister(nAddress, nData);
-	}
-	else if(nAddress == 0x1000F180)
-	{
-		//stdout data
-		m_iopBios.GetIoman()->Write(Iop::CIoman::FID_STDOUT, 1, &nData);
-	}
-	else if(nAddress >= 0x1000F520 && nAddress <= 0x1000F59C)
-	{
-		m_dmac.SetRegister(nAddress, nData);
-	}
-	else if(nAddress == CVpu::VU_CMSAR1)
-	{
-		bool validAddress = (nData & 0x7) == 0;
-		if(!m_vpu1->IsVuRunning() && validAddress)
-		{
-			m_vpu1->ExecuteMicroProgram(nData);
-		}
+		(*handler)(nAddress, nData);
 	}
 	else if(nAddress >= 0x12000000 && nAddress <= 0x1200108C)
 	{
@@ -597,16 +671,44 @@ void CSubSystem::Vu0StateChanged(bool running)
 	}
 }
 
+//VU1 might be running on its own thread, make sure it's not in the middle of
+//something before reading its memory
+uint32 CSubSystem::Vu1MicroMemReadHandler(uint32 address)
+{
+	m_vpu1->WaitForIdle();
+	uint32 baseAddress = address - PS2::MICROMEM1ADDR;
+	uint32 shift = (baseAddress & 0x03) * 8;
+	return *reinterpret_cast<uint32*>(m_microMem1 + (baseAddress & ~0x03)) >> shift;
+}
+
+uint32 CSubSystem::Vu1MemReadHandler(uint32 address)
+{
+	m_vpu1->WaitForIdle();
+	uint32 baseAddress = address - PS2::VUMEM1ADDR;
+	uint32 shift = (baseAddress & 0x03) * 8;
+	return *reinterpret_cast<uint32*>(m_vuMem1 + (baseAddress & ~0x03)) >> shift;
+}
+
 uint32 CSubSystem::Vu1MicroMemWriteHandler(uint32 address, uint32 value)
 {
+	m_vpu1->WaitForIdle();
 	uint32 baseAddress = address - PS2::MICROMEM1ADDR;
 	*reinterpret_cast<uint32*>(m_microMem1 + baseAddress) = value;
 	m_vpu1->InvalidateMicroProgram(baseAddress, baseAddress + 4);
 	return 0;
 }
 
+uint32 CSubSystem::Vu1MemWriteHandler(uint32 address, uint32 value)
+{
+	m_vpu1->WaitForIdle();
+	uint32 baseAddress = address - PS2::VUMEM1ADDR;
+	*reinterpret_cast<uint32*>(m_vuMem1 + baseAddress) = value;
+	return 0;
+}
+
 uint32 CSubSystem::Vu1IoPortReadHandler(uint32 address)
 {
+	m_vpu1->WaitForIdle();
 	uint32 result = 0xCCCCCCCC;
 	switch(address)
 	{
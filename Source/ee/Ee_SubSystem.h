@@ -1,5 +1,8 @@
 #pragma once
 
+#include <array>
+#include <functional>
+#include <vector>
 #include "AlignedAlloc.h"
 #include "../COP_SCU.h"
 #include "../COP_FPU.h"
@@ -15,6 +18,7 @@
 #include "MA_EE.h"
 #include "COP_VU.h"
 #include "PS2OS.h"
+#include "FastMemArena.h"
 #include "../gs/GSHandler.h"
 
 #include "signal/Signal.h"
@@ -24,7 +28,7 @@ namespace Ee
 	class CSubSystem
 	{
 	public:
-		CSubSystem(uint8*, CIopBios&);
+		CSubSystem(uint8*, CIopBios&, bool fastMem = false);
 		virtual ~CSubSystem();
 
 		void Reset();
@@ -38,9 +42,16 @@ namespace Ee
 		void SaveState(Framework::CZipArchiveWriter&);
 		void LoadState(Framework::CZipArchiveReader&);
 
+		//Raw binary state of everything but RAM, SPR and VU memories, used for rewind
+		void SaveDeviceState(Framework::CStream&);
+		void LoadDeviceState(Framework::CStream&);
+
 		void SetVpu0(std::shared_ptr<CVpu>);
 		void SetVpu1(std::shared_ptr<CVpu>);
 
+		//Must come before memory pointers, RAM, BIOS and SPR are allocated from it when fastmem is enabled
+		std::unique_ptr<CFastMemArena> m_fastMemArena;
+
 		uint8* m_ram = nullptr;
 		uint8* m_bios = nullptr;
 		uint8* m_spr = nullptr;
@@ -81,7 +92,44 @@ namespace Ee
 	private:
 		typedef std::map<uint32, uint32> StatusRegisterCheckerMap;
 
+		typedef std::function<uint32(uint32)> IoPortReadHandler;
+		typedef std::function<void(uint32, uint32)> IoPortWriteHandler;
+
+		template <typename HandlerType>
+		struct IOPORTHANDLER
+		{
+			uint32 start;
+			uint32 end;
+			HandlerType handler;
+		};
+
+		//Registers in 0x10000000-0x1000FFFF are dispatched through a table indexed by
+		//address slots (one per 16 bytes) which holds indices into the handler lists.
+		enum
+		{
+			IOPORT_TABLE_START = 0x10000000,
+			IOPORT_TABLE_END = 0x1000FFFF,
+			IOPORT_SLOT_BITS = 4,
+			IOPORT_SLOT_COUNT = (IOPORT_TABLE_END - IOPORT_TABLE_START + 1) >> IOPORT_SLOT_BITS,
+		};
+
+		enum : uint8
+		{
+			IOPORT_HANDLER_NONE = 0xFF,
+		};
+
+		typedef std::array<uint8, IOPORT_SLOT_COUNT> IoPortHandlerIndexTable;
+
+		static std::unique_ptr<CFastMemArena> CreateFastMemArena(bool);
+
 		void SetupEePageTable();
+		void SetupIoPortHandlers();
+		void InsertIoPortReadHandler(uint32, uint32, IoPortReadHandler);
+		void InsertIoPortWriteHandler(uint32, uint32, IoPortWriteHandler);
+		template <typename HandlerType>
+		static void InsertIoPortHandler(std::vector<IOPORTHANDLER<HandlerType>>&, IoPortHandlerIndexTable&, uint32, uint32, HandlerType);
+		template <typename HandlerType>
+		static const HandlerType* FindIoPortHandler(const std::vector<IOPORTHANDLER<HandlerType>>&, const IoPortHandlerIndexTable&, uint32);
 
 		uint32 IOPortReadHandler(uint32);
 		uint32 IOPortWriteHandler(uint32, uint32);
@@ -92,7 +140,10 @@ namespace Ee
 		uint32 Vu0IoPortWriteHandler(uint32, uint32);
 		void Vu0StateChanged(bool);
 
+		uint32 Vu1MicroMemReadHandler(uint32);
+		uint32 Vu1MemReadHandler(uint32);
 		uint32 Vu1MicroMemWriteHandler(uint32, uint32);
+		uint32 Vu1MemWriteHandler(uint32, uint32);
 
 		uint32 Vu1IoPortReadHandler(uint32);
 		uint32 Vu1IoPortWriteHandler(uint32, uint32);
@@ -109,6 +160,11 @@ namespace Ee
 		void FillFakeIopRam();
 
 		StatusRegisterCheckerMap m_statusRegisterCheckers;
+
+		std::vector<IOPORTHANDLER<IoPortReadHandler>> m_ioPortReadHandlers;
+		std::vector<IOPORTHANDLER<IoPortWriteHandler>> m_ioPortWriteHandlers;
+		IoPortHandlerIndexTable m_ioPortReadHandlerIndices;
+		IoPortHandlerIndexTable m_ioPortWriteHandlerIndices;
 		bool m_isIdle = false;
 
 		CMA_VU m_MAVU0;
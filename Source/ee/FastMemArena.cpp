@@ -0,0 +1,346 @@
+#include <algorithm>
+#include <cassert>
+#include "FastMemArena.h"
+#include "../Ps2Const.h"
+
+#if defined(__linux__) && !defined(__ANDROID__) && defined(__x86_64__)
+#define FASTMEM_SUPPORTED
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#define ARENA_SIZE (0x100000000ULL)
+
+static_assert(PS2::EE_RAM_SIZE == 0x02000000, "SPR_OFFSET depends on RAM size.");
+static_assert(PS2::EE_SPR_SIZE == 0x00004000, "BIOS_OFFSET depends on SPR size.");
+static_assert(PS2::EE_BIOS_SIZE == 0x00400000, "MEMORY_SIZE depends on BIOS size.");
+
+CFastMemArena::~CFastMemArena()
+{
+	Destroy();
+}
+
+bool CFastMemArena::IsSupported()
+{
+#ifdef FASTMEM_SUPPORTED
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool CFastMemArena::Create()
+{
+#ifdef FASTMEM_SUPPORTED
+	assert(m_base == nullptr);
+
+	m_memoryFd = memfd_create("PlayEeMemory", 0);
+	if(m_memoryFd < 0) return false;
+	if(ftruncate(m_memoryFd, MEMORY_SIZE) < 0)
+	{
+		Destroy();
+		return false;
+	}
+
+	void* memory = mmap(nullptr, MEMORY_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, m_memoryFd, 0);
+	if(memory == MAP_FAILED)
+	{
+		Destroy();
+		return false;
+	}
+	m_memory = reinterpret_cast<uint8*>(memory);
+
+	void* base = mmap(nullptr, ARENA_SIZE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if(base == MAP_FAILED)
+	{
+		Destroy();
+		return false;
+	}
+	m_base = reinterpret_cast<uint8*>(base);
+
+	//0x30000000-0x300FFFFF translates to I/O registers, only the rest of the range is RAM
+	m_ramViews = {
+	    {0x00000000, RAM_OFFSET, PS2::EE_RAM_SIZE, false},
+	    {0x20000000, RAM_OFFSET, PS2::EE_RAM_SIZE, false},
+	    {0x30100000, RAM_OFFSET + 0x100000, PS2::EE_RAM_SIZE - 0x100000, false},
+	    {0x80000000, RAM_OFFSET, PS2::EE_RAM_SIZE, false},
+	    {0xA0000000, RAM_OFFSET, PS2::EE_RAM_SIZE, false},
+	};
+
+	//BIOS isn't writable, writes to it fault and go through the memory map like before
+	const VIEW otherViews[] =
+	    {
+	        {0x70000000, SPR_OFFSET, PS2::EE_SPR_SIZE, false},
+	        {0x1FC00000, BIOS_OFFSET, PS2::EE_BIOS_SIZE, true},
+	        {0x9FC00000, BIOS_OFFSET, PS2::EE_BIOS_SIZE, true},
+	        {0xBFC00000, BIOS_OFFSET, PS2::EE_BIOS_SIZE, true},
+	    };
+
+	for(const auto& view : m_ramViews)
+	{
+		if(!MapView(view))
+		{
+			Destroy();
+			return false;
+		}
+	}
+	for(const auto& view : otherViews)
+	{
+		if(!MapView(view))
+		{
+			Destroy();
+			return false;
+		}
+	}
+
+	return true;
+#else
+	return false;
+#endif
+}
+
+void CFastMemArena::Destroy()
+{
+#ifdef FASTMEM_SUPPORTED
+	if(m_base)
+	{
+		munmap(m_base, ARENA_SIZE);
+		m_base = nullptr;
+	}
+	if(m_memory)
+	{
+		munmap(m_memory, MEMORY_SIZE);
+		m_memory = nullptr;
+	}
+	if(m_memoryFd >= 0)
+	{
+		close(m_memoryFd);
+		m_memoryFd = -1;
+	}
+	m_ramViews.clear();
+#endif
+}
+
+uint8* CFastMemArena::GetBase() const
+{
+	return m_base;
+}
+
+uint8* CFastMemArena::GetRam() const
+{
+	return m_memory + RAM_OFFSET;
+}
+
+uint8* CFastMemArena::GetSpr() const
+{
+	return m_memory + SPR_OFFSET;
+}
+
+uint8* CFastMemArena::GetBios() const
+{
+	return m_memory + BIOS_OFFSET;
+}
+
+bool CFastMemArena::Contains(const void* ptr) const
+{
+	auto bytePtr = reinterpret_cast<const uint8*>(ptr);
+	return (m_base != nullptr) && (bytePtr >= m_base) && (bytePtr < (m_base + ARENA_SIZE));
+}
+
+uint32 CFastMemArena::GetAddress(const void* ptr) const
+{
+	assert(Contains(ptr));
+	return static_cast<uint32>(reinterpret_cast<const uint8*>(ptr) - m_base);
+}
+
+bool CFastMemArena::GetRamOffset(uint32 address, uint32& ramOffset) const
+{
+	for(const auto& view : m_ramViews)
+	{
+		if((address >= view.address) && ((address - view.address) < view.size))
+		{
+			ramOffset = (address - view.address) + view.memoryOffset - RAM_OFFSET;
+			return true;
+		}
+	}
+	return false;
+}
+
+void CFastMemArena::SetRamProtected(uint32 offset, uint32 size, bool protect)
+{
+#ifdef FASTMEM_SUPPORTED
+	//Protection is changed on whole host pages
+	uint32 pageSize = static_cast<uint32>(sysconf(_SC_PAGESIZE));
+	uint32 end = (offset + size + pageSize - 1) & ~(pageSize - 1);
+	offset &= ~(pageSize - 1);
+	for(const auto& view : m_ramViews)
+	{
+		uint32 viewBegin = view.memoryOffset - RAM_OFFSET;
+		uint32 viewEnd = viewBegin + view.size;
+		uint32 rangeBegin = std::max(offset, viewBegin);
+		uint32 rangeEnd = std::min(end, viewEnd);
+		if(rangeBegin >= rangeEnd) continue;
+		uint8* address = m_base + view.address + (rangeBegin - viewBegin);
+		int result = mprotect(address, rangeEnd - rangeBegin, protect ? PROT_READ : PROT_READ | PROT_WRITE);
+		assert(result >= 0);
+	}
+#endif
+}
+
+bool CFastMemArena::MapView(const VIEW& view)
+{
+#ifdef FASTMEM_SUPPORTED
+	int protection = view.readOnly ? PROT_READ : PROT_READ | PROT_WRITE;
+	void* result = mmap(m_base + view.address, view.size, protection, MAP_SHARED | MAP_FIXED, m_memoryFd, view.memoryOffset);
+	return (result != MAP_FAILED);
+#else
+	return false;
+#endif
+}
+
+//Decodes the x86-64 instructions the jitter emits for loads and stores (MOV, MOVZX, MOVSX
+//with a memory operand). Returns false for anything else.
+bool CFastMemArena::DecodeHostAccess(const uint8* code, HOST_ACCESS& access)
+{
+	const uint8* current = code;
+	bool operandSize16 = false;
+	uint8 rex = 0;
+
+	if(*current == 0x66)
+	{
+		operandSize16 = true;
+		current++;
+	}
+	if((*current & 0xF0) == 0x40)
+	{
+		rex = *current;
+		current++;
+	}
+
+	bool rexW = (rex & 0x08) != 0;
+	uint32 defaultSize = rexW ? 8 : (operandSize16 ? 2 : 4);
+
+	access = HOST_ACCESS();
+	uint32 immediateSize = 0;
+
+	uint8 opcode = *current++;
+	if(opcode == 0x0F)
+	{
+		uint8 opcode2 = *current++;
+		switch(opcode2)
+		{
+		case 0xB6:
+		case 0xB7:
+		case 0xBE:
+		case 0xBF:
+			access.size = (opcode2 & 1) ? 2 : 1;
+			access.registerSize = defaultSize;
+			access.isSignExtended = (opcode2 >= 0xBE);
+			break;
+		default:
+			return false;
+		}
+	}
+	else
+	{
+		switch(opcode)
+		{
+		case 0x88:
+		case 0x8A:
+			access.isStore = (opcode == 0x88);
+			access.size = 1;
+			access.registerSize = 1;
+			break;
+		case 0x89:
+		case 0x8B:
+			access.isStore = (opcode == 0x89);
+			access.size = defaultSize;
+			access.registerSize = defaultSize;
+			break;
+		case 0x63:
+			if(!rexW) return false;
+			access.size = 4;
+			access.registerSize = 8;
+			access.isSignExtended = true;
+			break;
+		case 0xC6:
+			access.isStore = true;
+			access.hasImmediate = true;
+			access.size = 1;
+			immediateSize = 1;
+			break;
+		case 0xC7:
+			access.isStore = true;
+			access.hasImmediate = true;
+			access.size = defaultSize;
+			immediateSize = (defaultSize == 2) ? 2 : 4;
+			break;
+		default:
+			return false;
+		}
+	}
+
+	uint8 modRm = *current++;
+	uint8 mod = (modRm >> 6) & 3;
+	uint8 reg = (modRm >> 3) & 7;
+	uint8 rm = modRm & 7;
+	if(mod == 3) return false;
+
+	if(access.hasImmediate)
+	{
+		if(reg != 0) return false;
+	}
+	else
+	{
+		access.registerIndex = reg | ((rex & 0x04) ? 8 : 0);
+		//Without REX, byte registers 4-7 are AH, CH, DH and BH
+		if((access.registerSize == 1) && (rex == 0) && (reg >= 4))
+		{
+			access.isHighByteRegister = true;
+			access.registerIndex = reg - 4;
+		}
+	}
+
+	if(rm == 4)
+	{
+		uint8 sib = *current++;
+		if(((sib & 7) == 5) && (mod == 0))
+		{
+			current += 4;
+		}
+	}
+	else if((rm == 5) && (mod == 0))
+	{
+		current += 4;
+	}
+	if(mod == 1)
+	{
+		current += 1;
+	}
+	else if(mod == 2)
+	{
+		current += 4;
+	}
+
+	if(immediateSize != 0)
+	{
+		int64 immediate = 0;
+		switch(immediateSize)
+		{
+		case 1:
+			immediate = *reinterpret_cast<const int8*>(current);
+			break;
+		case 2:
+			immediate = *reinterpret_cast<const int16*>(current);
+			break;
+		case 4:
+			immediate = *reinterpret_cast<const int32*>(current);
+			break;
+		}
+		access.immediate = static_cast<uint64>(immediate);
+		current += immediateSize;
+	}
+
+	access.length = static_cast<uint32>(current - code);
+	return true;
+}
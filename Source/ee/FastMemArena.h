@@ -0,0 +1,75 @@
+#pragma once
+
+#include <vector>
+#include "Types.h"
+
+//Host address space region that mirrors the EE's 4GB virtual address space. RAM, scratchpad
+//and BIOS live in a shared memory object which is mapped at every virtual address they appear
+//at (as translated by CPS2OS::TranslateAddress). Everything else stays inaccessible, accesses
+//to I/O or unmapped addresses fault and are emulated by the executor.
+class CFastMemArena
+{
+public:
+	//Describes a host instruction that accessed the arena, see DecodeHostAccess
+	struct HOST_ACCESS
+	{
+		uint32 length = 0;
+		uint32 size = 0;
+		uint32 registerSize = 0;
+		uint32 registerIndex = 0;
+		bool isStore = false;
+		bool isSignExtended = false;
+		bool isHighByteRegister = false;
+		bool hasImmediate = false;
+		uint64 immediate = 0;
+	};
+
+	CFastMemArena() = default;
+	CFastMemArena(const CFastMemArena&) = delete;
+	virtual ~CFastMemArena();
+
+	CFastMemArena& operator=(const CFastMemArena&) = delete;
+
+	static bool IsSupported();
+
+	bool Create();
+	void Destroy();
+
+	uint8* GetBase() const;
+	uint8* GetRam() const;
+	uint8* GetSpr() const;
+	uint8* GetBios() const;
+
+	bool Contains(const void*) const;
+	uint32 GetAddress(const void*) const;
+	bool GetRamOffset(uint32, uint32&) const;
+
+	//Applies to every view of the RAM, but not to the RAM returned by GetRam
+	void SetRamProtected(uint32, uint32, bool);
+
+	static bool DecodeHostAccess(const uint8*, HOST_ACCESS&);
+
+private:
+	enum
+	{
+		RAM_OFFSET = 0,
+		SPR_OFFSET = 0x02000000,
+		BIOS_OFFSET = 0x02004000,
+		MEMORY_SIZE = 0x02404000,
+	};
+
+	struct VIEW
+	{
+		uint32 address;
+		uint32 memoryOffset;
+		uint32 size;
+		bool readOnly;
+	};
+
+	bool MapView(const VIEW&);
+
+	int m_memoryFd = -1;
+	uint8* m_memory = nullptr;
+	uint8* m_base = nullptr;
+	std::vector<VIEW> m_ramViews;
+};
@@ -5,6 +5,7 @@
 #include "../Log.h"
 #include "../FrameDump.h"
 #include "../states/RegisterStateFile.h"
+#include "../states/RawState.h"
 #include "GIF.h"
 
 #define QTEMP_INIT (0x3F800000)
@@ -74,6 +75,32 @@ void CGIF::SaveState(Framework::CZipArchiveWriter& archive)
 	archive.InsertFile(registerFile);
 }
 
+void CGIF::LoadRawState(Framework::CStream& stream)
+{
+	RawState::Read(stream, m_path3Masked);
+	RawState::Read(stream, m_activePath);
+	RawState::Read(stream, m_loops);
+	RawState::Read(stream, m_cmd);
+	RawState::Read(stream, m_regs);
+	RawState::Read(stream, m_regsTemp);
+	RawState::Read(stream, m_regList);
+	RawState::Read(stream, m_eop);
+	RawState::Read(stream, m_qtemp);
+}
+
+void CGIF::SaveRawState(Framework::CStream& stream)
+{
+	RawState::Write(stream, m_path3Masked);
+	RawState::Write(stream, m_activePath);
+	RawState::Write(stream, m_loops);
+	RawState::Write(stream, m_cmd);
+	RawState::Write(stream, m_regs);
+	RawState::Write(stream, m_regsTemp);
+	RawState::Write(stream, m_regList);
+	RawState::Write(stream, m_eop);
+	RawState::Write(stream, m_qtemp);
+}
+
 uint32 CGIF::ProcessPacked(CGSHandler::RegisterWriteList& writeList, const uint8* memory, uint32 address, uint32 end)
 {
 	uint32 start = address;
@@ -58,6 +58,8 @@ public:
 
 	void LoadState(Framework::CZipArchiveReader&);
 	void SaveState(Framework::CZipArchiveWriter&);
+	void LoadRawState(Framework::CStream&);
+	void SaveRawState(Framework::CStream&);
 
 private:
 	enum SIGNAL_STATE
@@ -1,6 +1,7 @@
 #include "INTC.h"
 #include "../Log.h"
 #include "../states/RegisterStateFile.h"
+#include "../states/RawState.h"
 
 #define LOG_NAME ("ee_intc")
 
@@ -89,3 +90,15 @@ void CINTC::SaveState(Framework::CZipArchiveWriter& archive)
 	registerFile->SetRegister32("INTC_MASK", m_INTC_MASK);
 	archive.InsertFile(registerFile);
 }
+
+void CINTC::LoadRawState(Framework::CStream& stream)
+{
+	RawState::Read(stream, m_INTC_STAT);
+	RawState::Read(stream, m_INTC_MASK);
+}
+
+void CINTC::SaveRawState(Framework::CStream& stream)
+{
+	RawState::Write(stream, m_INTC_STAT);
+	RawState::Write(stream, m_INTC_MASK);
+}
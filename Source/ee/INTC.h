@@ -42,6 +42,8 @@ public:
 
 	void LoadState(Framework::CZipArchiveReader&);
 	void SaveState(Framework::CZipArchiveWriter&);
+	void LoadRawState(Framework::CStream&);
+	void SaveRawState(Framework::CStream&);
 
 private:
 	uint32 GetStat() const;
@@ -10,6 +10,7 @@
 #include "IPU_MacroblockTypeBTable.h"
 #include "IPU_MotionCodeTable.h"
 #include "IPU_DmVectorTable.h"
+#include "IPU_Kernels.h"
 #include "mpeg2/DcSizeLuminanceTable.h"
 #include "mpeg2/DcSizeChrominanceTable.h"
 #include "mpeg2/DctCoefficientTable0.h"
@@ -18,7 +19,6 @@
 #include "mpeg2/QuantiserScaleTable.h"
 #include "mpeg2/InverseScanTable.h"
 #include "idct/TrivialC.h"
-#include "idct/IEEE1180.h"
 #include "../Log.h"
 #include "DMAC.h"
 #include "INTC.h"
@@ -501,77 +501,11 @@ void CIPU::DequantiseBlock(int16* pBlock, uint8 nMBI, uint8 nQSC, bool isLinearQ
 			break;
 		}
 
-		pBlock[0] = nIntraDcMult * pBlock[0];
-
-		for(unsigned int i = 1; i < 64; i++)
-		{
-			int16 nSign = 0;
-
-			if(pBlock[i] == 0)
-			{
-				nSign = 0;
-			}
-			else
-			{
-				nSign = (pBlock[i] > 0) ? 0x0001 : 0xFFFF;
-			}
-
-			pBlock[i] = (pBlock[i] * static_cast<int16>(intraIq[i]) * nQuantScale * 2) / 32;
-
-			if(nSign != 0)
-			{
-				if((pBlock[i] & 1) == 0)
-				{
-					pBlock[i] = (pBlock[i] - nSign) | 1;
-				}
-			}
-		}
+		IpuKernels::DequantiseBlock(pBlock, true, nQuantScale, nIntraDcMult, intraIq);
 	}
 	else
 	{
-		for(unsigned int i = 0; i < 64; i++)
-		{
-			int16 nSign = 0;
-
-			if(pBlock[i] == 0)
-			{
-				nSign = 0;
-			}
-			else
-			{
-				nSign = (pBlock[i] > 0) ? 0x0001 : 0xFFFF;
-			}
-
-			pBlock[i] = (((pBlock[i] * 2) + nSign) * static_cast<int16>(nonIntraIq[i]) * nQuantScale) / 32;
-
-			if(nSign != 0)
-			{
-				if((pBlock[i] & 1) == 0)
-				{
-					pBlock[i] = (pBlock[i] - nSign) | 1;
-				}
-			}
-		}
-	}
-
-	//Saturate
-	int16 nSum = 0;
-
-	for(unsigned int i = 0; i < 64; i++)
-	{
-		if(pBlock[i] > 2047)
-		{
-			pBlock[i] = 2047;
-		}
-		if(pBlock[i] < -2048)
-		{
-			pBlock[i] = -2048;
-		}
-		nSum += pBlock[i];
-	}
-
-	if(nSum & 1)
-	{
+		IpuKernels::DequantiseBlock(pBlock, false, nQuantScale, 0, nonIntraIq);
 	}
 }
 
@@ -895,6 +829,31 @@ void CIPU::CINFIFO::Advance(uint8 bits)
 	}
 }
 
+unsigned int CIPU::CINFIFO::ReadBytes(void* data, unsigned int size)
+{
+	assert((m_bitPosition & 7) == 0);
+
+	unsigned int position = m_bitPosition / 8;
+	unsigned int availableSize = (m_size > position) ? (m_size - position) : 0;
+	size = std::min(size, availableSize);
+	if(size == 0) return 0;
+
+	memcpy(data, m_buffer + position, size);
+	m_bitPosition += size * 8;
+
+	//Discard the read bytes, 16 bytes at a time like Advance does
+	unsigned int discardSize = (m_bitPosition / 128) * 16;
+	if(discardSize != 0)
+	{
+		memmove(m_buffer, m_buffer + discardSize, m_size - discardSize);
+		m_size -= discardSize;
+		m_bitPosition -= discardSize * 8;
+	}
+	m_lookupBitsDirty = true;
+
+	return size;
+}
+
 uint8 CIPU::CINFIFO::GetBitIndex() const
 {
 	return m_bitPosition;
@@ -1182,13 +1141,9 @@ void CIPU::CIDECCommand::ConvertRawBlock()
 	m_blockStream.Seek(0, Framework::STREAM_SEEK_SET);
 	m_blockStream.Read(blockData, CCSCCommand::BLOCK_SIZE * sizeof(int16));
 	m_blockStream.ResetBuffer();
-	for(uint32 i = 0; i < CCSCCommand::BLOCK_SIZE; i++)
-	{
-		int16 blockValue = blockData[i];
-		blockValue = std::max<int16>(blockValue, 0);
-		blockValue = std::min<int16>(blockValue, 255);
-		m_blockStream.Write8(static_cast<uint8>(blockValue));
-	}
+	uint8 convertedData[CCSCCommand::BLOCK_SIZE];
+	IpuKernels::ConvertRaw16ToRaw8(blockData, convertedData, CCSCCommand::BLOCK_SIZE);
+	m_blockStream.Write(convertedData, CCSCCommand::BLOCK_SIZE);
 }
 
 /////////////////////////////////////////////
@@ -1325,7 +1280,7 @@ bool CIPU::CBDECCommand::Execute()
 
 			memcpy(blockTemp, blockInfo.block, sizeof(int16) * 0x40);
 
-			IDCT::CIEEE1180::GetInstance()->Transform(blockTemp, blockInfo.block);
+			IpuKernels::Idct(blockTemp, blockInfo.block);
 
 			m_state = STATE_DECODEBLOCK_GOTONEXT;
 		}
@@ -1836,7 +1791,6 @@ bool CIPU::CSETVQCommand::Execute()
 
 CIPU::CCSCCommand::CCSCCommand()
 {
-	GenerateCbCrMap();
 }
 
 void CIPU::CCSCCommand::Initialize(CINFIFO* input, COUTFIFO* output, uint32 commandCode, uint16 TH0, uint16 TH1)
@@ -1880,6 +1834,15 @@ bool CIPU::CCSCCommand::Execute()
 			{
 				m_state = STATE_CONVERTBLOCK;
 			}
+			else if((m_IN_FIFO->GetBitIndex() & 7) == 0)
+			{
+				uint32 readSize = m_IN_FIFO->ReadBytes(m_block + m_currentIndex, BLOCK_SIZE - m_currentIndex);
+				if(readSize == 0)
+				{
+					return false;
+				}
+				m_currentIndex += readSize;
+			}
 			else
 			{
 				uint32 blockValue = 0;
@@ -1896,75 +1859,7 @@ bool CIPU::CCSCCommand::Execute()
 		{
 			uint32 nPixel[0x100];
 
-			uint8* pY = m_block;
-			uint8* nBlockCb = m_block + 0x100;
-			uint8* nBlockCr = m_block + 0x140;
-
-			uint32* pPixel = nPixel;
-			unsigned int* pCbCrMap = m_nCbCrMap;
-
-			uint32 alphaTh0 = (m_TH0 & 0xFF) | ((m_TH0 & 0xFF) << 8) | ((m_TH0 & 0xFF) << 16);
-			uint32 alphaTh1 = (m_TH1 & 0xFF) | ((m_TH1 & 0xFF) << 8) | ((m_TH1 & 0xFF) << 16);
-
-			for(unsigned int i = 0; i < 16; i++)
-			{
-				for(unsigned int j = 0; j < 16; j++)
-				{
-					float nY = pY[j];
-					float nCb = nBlockCb[pCbCrMap[j]];
-					float nCr = nBlockCr[pCbCrMap[j]];
-
-					float nR = nY + 1.402f * (nCr - 128);
-					float nG = nY - 0.34414f * (nCb - 128) - 0.71414f * (nCr - 128);
-					float nB = nY + 1.772f * (nCb - 128);
-
-					if(nR < 0)
-					{
-						nR = 0;
-					}
-					if(nR > 255)
-					{
-						nR = 255;
-					}
-					if(nG < 0)
-					{
-						nG = 0;
-					}
-					if(nG > 255)
-					{
-						nG = 255;
-					}
-					if(nB < 0)
-					{
-						nB = 0;
-					}
-					if(nB > 255)
-					{
-						nB = 255;
-					}
-
-					uint8 a = 0;
-					uint32 rgb = (static_cast<uint8>(nB) << 16) | (static_cast<uint8>(nG) << 8) | (static_cast<uint8>(nR) << 0);
-					if(rgb < alphaTh0)
-					{
-						a = 0;
-					}
-					else if(rgb < alphaTh1)
-					{
-						a = 0x40;
-					}
-					else
-					{
-						a = 0x80;
-					}
-
-					pPixel[j] = (a << 24) | rgb;
-				}
-
-				pY += 0x10;
-				pCbCrMap += 0x10;
-				pPixel += 0x10;
-			}
+			IpuKernels::ConvertMacroblockToRgb32(m_block, nPixel, m_TH0, m_TH1);
 
 			m_OUT_FIFO->Write(nPixel, sizeof(uint32) * 0x100);
 
@@ -1989,24 +1884,6 @@ bool CIPU::CCSCCommand::Execute()
 	}
 }
 
-void CIPU::CCSCCommand::GenerateCbCrMap()
-{
-	unsigned int* pCbCrMap = m_nCbCrMap;
-	for(unsigned int i = 0; i < 0x40; i += 0x8)
-	{
-		for(unsigned int j = 0; j < 0x10; j += 2)
-		{
-			pCbCrMap[j + 0x00] = (j / 2) + i;
-			pCbCrMap[j + 0x01] = (j / 2) + i;
-
-			pCbCrMap[j + 0x10] = (j / 2) + i;
-			pCbCrMap[j + 0x11] = (j / 2) + i;
-		}
-
-		pCbCrMap += 0x20;
-	}
-}
-
 /////////////////////////////////////////////
 //SETTH command implementation
 /////////////////////////////////////////////
@@ -158,6 +158,9 @@ private:
 		void Advance(uint8) override;
 		uint8 GetBitIndex() const override;
 
+		//Reads whole bytes, bit position must be byte aligned. Returns the amount of bytes read.
+		unsigned int ReadBytes(void*, unsigned int);
+
 		bool TryPeekBits_LSBF(uint8, uint32&) override;
 		bool TryPeekBits_MSBF(uint8, uint32&) override;
 
@@ -477,8 +480,6 @@ private:
 			STATE_DONE,
 		};
 
-		void GenerateCbCrMap();
-
 		STATE m_state = STATE_DONE;
 		CMD_CSC m_command = make_convertible<CMD_CSC>(0);
 
@@ -490,8 +491,6 @@ private:
 		unsigned int m_currentIndex = 0;
 		unsigned int m_mbCount = 0;
 
-		unsigned int m_nCbCrMap[0x100];
-
 		uint8 m_block[BLOCK_SIZE];
 	};
 
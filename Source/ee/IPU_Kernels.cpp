@@ -0,0 +1,492 @@
+#include <algorithm>
+#include <cmath>
+#include "IPU_Kernels.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define IPUKERNELS_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define IPUKERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+using namespace IpuKernels;
+
+//M[u][x] = (C(u) / 2) * cos((2x + 1) * u * pi / 16), computed in double precision
+struct IDCTMATRIX
+{
+	IDCTMATRIX()
+	{
+		const double pi = 3.14159265358979323846;
+		for(unsigned int u = 0; u < 8; u++)
+		{
+			double scale = (u == 0) ? (1.0 / std::sqrt(2.0)) : 1.0;
+			for(unsigned int x = 0; x < 8; x++)
+			{
+				values[u][x] = static_cast<float>(scale * 0.5 * std::cos(((2 * x + 1) * u * pi) / 16.0));
+			}
+		}
+	}
+
+	alignas(16) float values[8][8];
+};
+
+static const IDCTMATRIX g_idctMatrix;
+
+static uint32 MakeAlphaThreshold(uint16 th)
+{
+	return (th & 0xFF) | ((th & 0xFF) << 8) | ((th & 0xFF) << 16);
+}
+
+#if defined(IPUKERNELS_SSE2)
+
+static __m128i FloorToInt(__m128 value)
+{
+	__m128i truncated = _mm_cvttps_epi32(value);
+	__m128 adjust = _mm_cmpgt_ps(_mm_cvtepi32_ps(truncated), value);
+	return _mm_add_epi32(truncated, _mm_castps_si128(adjust));
+}
+
+void IpuKernels::DequantiseBlock(int16* block, bool isIntra, int16 quantScale, int16 intraDcMult, const uint8* iq)
+{
+	int16 dcValue = block[0];
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i one = _mm_set1_epi16(1);
+	const __m128i quantScaleVector = _mm_set1_epi16(quantScale);
+	for(unsigned int i = 0; i < BLOCK_SIZE; i += 8)
+	{
+		__m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i));
+		__m128i weight = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(iq + i)), zero);
+		weight = _mm_mullo_epi16(weight, quantScaleVector);
+
+		__m128i positive = _mm_cmpgt_epi16(value, zero);
+		__m128i negative = _mm_cmplt_epi16(value, zero);
+		__m128i sign = _mm_sub_epi16(negative, positive);
+
+		//32-bit value * weight products
+		__m128i productLo16 = _mm_mullo_epi16(value, weight);
+		__m128i productHi16 = _mm_mulhi_epi16(value, weight);
+		__m128i product0 = _mm_slli_epi32(_mm_unpacklo_epi16(productLo16, productHi16), 1);
+		__m128i product1 = _mm_slli_epi32(_mm_unpackhi_epi16(productLo16, productHi16), 1);
+		if(!isIntra)
+		{
+			//((value * 2) + sign) * weight
+			__m128i signWeight = _mm_mullo_epi16(sign, weight);
+			product0 = _mm_add_epi32(product0, _mm_srai_epi32(_mm_unpacklo_epi16(zero, signWeight), 16));
+			product1 = _mm_add_epi32(product1, _mm_srai_epi32(_mm_unpackhi_epi16(zero, signWeight), 16));
+		}
+
+		//Divide by 32, rounding towards zero, and truncate to 16 bits
+		product0 = _mm_srai_epi32(_mm_add_epi32(product0, _mm_and_si128(_mm_srai_epi32(product0, 31), _mm_set1_epi32(31))), 5);
+		product1 = _mm_srai_epi32(_mm_add_epi32(product1, _mm_and_si128(_mm_srai_epi32(product1, 31), _mm_set1_epi32(31))), 5);
+		product0 = _mm_srai_epi32(_mm_slli_epi32(product0, 16), 16);
+		product1 = _mm_srai_epi32(_mm_slli_epi32(product1, 16), 16);
+		__m128i result = _mm_packs_epi32(product0, product1);
+
+		//Mismatch control, make even non-zero values odd
+		__m128i isEven = _mm_cmpeq_epi16(_mm_and_si128(result, one), zero);
+		__m128i mustAdjust = _mm_and_si128(_mm_or_si128(positive, negative), isEven);
+		__m128i adjusted = _mm_or_si128(_mm_sub_epi16(result, sign), one);
+		result = _mm_or_si128(_mm_and_si128(mustAdjust, adjusted), _mm_andnot_si128(mustAdjust, result));
+
+		result = _mm_max_epi16(_mm_min_epi16(result, _mm_set1_epi16(2047)), _mm_set1_epi16(-2048));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(block + i), result);
+	}
+	if(isIntra)
+	{
+		int16 dcResult = static_cast<int16>(intraDcMult * dcValue);
+		block[0] = std::max<int16>(std::min<int16>(dcResult, 2047), -2048);
+	}
+}
+
+void IpuKernels::Idct(const int16* input, int16* output)
+{
+	__m128 rows[8][2];
+	for(unsigned int v = 0; v < 8; v++)
+	{
+		__m128 accumulator0 = _mm_setzero_ps();
+		__m128 accumulator1 = _mm_setzero_ps();
+		for(unsigned int u = 0; u < 8; u++)
+		{
+			__m128 coefficient = _mm_set1_ps(static_cast<float>(input[(v * 8) + u]));
+			accumulator0 = _mm_add_ps(accumulator0, _mm_mul_ps(coefficient, _mm_load_ps(&g_idctMatrix.values[u][0])));
+			accumulator1 = _mm_add_ps(accumulator1, _mm_mul_ps(coefficient, _mm_load_ps(&g_idctMatrix.values[u][4])));
+		}
+		rows[v][0] = accumulator0;
+		rows[v][1] = accumulator1;
+	}
+	const __m128 half = _mm_set1_ps(0.5f);
+	for(unsigned int y = 0; y < 8; y++)
+	{
+		__m128 accumulator0 = _mm_setzero_ps();
+		__m128 accumulator1 = _mm_setzero_ps();
+		for(unsigned int v = 0; v < 8; v++)
+		{
+			__m128 coefficient = _mm_set1_ps(g_idctMatrix.values[v][y]);
+			accumulator0 = _mm_add_ps(accumulator0, _mm_mul_ps(coefficient, rows[v][0]));
+			accumulator1 = _mm_add_ps(accumulator1, _mm_mul_ps(coefficient, rows[v][1]));
+		}
+		__m128i result0 = FloorToInt(_mm_add_ps(accumulator0, half));
+		__m128i result1 = FloorToInt(_mm_add_ps(accumulator1, half));
+		__m128i result = _mm_packs_epi32(result0, result1);
+		result = _mm_max_epi16(_mm_min_epi16(result, _mm_set1_epi16(255)), _mm_set1_epi16(-256));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(output + (y * 8)), result);
+	}
+}
+
+void IpuKernels::ConvertRaw16ToRaw8(const int16* input, uint8* output, uint32 count)
+{
+	uint32 i = 0;
+	for(; (i + 16) <= count; i += 16)
+	{
+		__m128i value0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i + 0));
+		__m128i value1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i + 8));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), _mm_packus_epi16(value0, value1));
+	}
+	for(; i < count; i++)
+	{
+		output[i] = static_cast<uint8>(std::min<int16>(std::max<int16>(input[i], 0), 255));
+	}
+}
+
+static __m128i ConvertPixels(__m128 y, __m128 cb, __m128 cr, __m128i alphaTh0, __m128i alphaTh1)
+{
+	const __m128 offset = _mm_set1_ps(128);
+	const __m128 minValue = _mm_setzero_ps();
+	const __m128 maxValue = _mm_set1_ps(255);
+	cb = _mm_sub_ps(cb, offset);
+	cr = _mm_sub_ps(cr, offset);
+
+	__m128 r = _mm_add_ps(y, _mm_mul_ps(_mm_set1_ps(1.402f), cr));
+	__m128 g = _mm_sub_ps(_mm_sub_ps(y, _mm_mul_ps(_mm_set1_ps(0.34414f), cb)), _mm_mul_ps(_mm_set1_ps(0.71414f), cr));
+	__m128 b = _mm_add_ps(y, _mm_mul_ps(_mm_set1_ps(1.772f), cb));
+
+	__m128i ri = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(r, minValue), maxValue));
+	__m128i gi = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(g, minValue), maxValue));
+	__m128i bi = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(b, minValue), maxValue));
+	__m128i rgb = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(bi, 16), _mm_slli_epi32(gi, 8)), ri);
+
+	__m128i belowTh0 = _mm_cmplt_epi32(rgb, alphaTh0);
+	__m128i belowTh1 = _mm_cmplt_epi32(rgb, alphaTh1);
+	__m128i alpha = _mm_or_si128(_mm_and_si128(belowTh1, _mm_set1_epi32(0x40)), _mm_andnot_si128(belowTh1, _mm_set1_epi32(0x80)));
+	alpha = _mm_andnot_si128(belowTh0, alpha);
+
+	return _mm_or_si128(_mm_slli_epi32(alpha, 24), rgb);
+}
+
+void IpuKernels::ConvertMacroblockToRgb32(const uint8* block, uint32* output, uint16 th0, uint16 th1)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i alphaTh0 = _mm_set1_epi32(MakeAlphaThreshold(th0));
+	const __m128i alphaTh1 = _mm_set1_epi32(MakeAlphaThreshold(th1));
+	for(unsigned int i = 0; i < 16; i++)
+	{
+		const uint8* rowY = block + (i * 0x10);
+		const uint8* rowCb = block + 0x100 + ((i / 2) * 8);
+		const uint8* rowCr = block + 0x140 + ((i / 2) * 8);
+
+		__m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rowY));
+		__m128i cb = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(rowCb));
+		__m128i cr = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(rowCr));
+
+		//Each chroma value covers 2 horizontal pixels
+		cb = _mm_unpacklo_epi8(cb, cb);
+		cr = _mm_unpacklo_epi8(cr, cr);
+
+		__m128i y16[2] = {_mm_unpacklo_epi8(y, zero), _mm_unpackhi_epi8(y, zero)};
+		__m128i cb16[2] = {_mm_unpacklo_epi8(cb, zero), _mm_unpackhi_epi8(cb, zero)};
+		__m128i cr16[2] = {_mm_unpacklo_epi8(cr, zero), _mm_unpackhi_epi8(cr, zero)};
+
+		for(unsigned int j = 0; j < 2; j++)
+		{
+			__m128 y0 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(y16[j], zero));
+			__m128 y1 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(y16[j], zero));
+			__m128 cb0 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(cb16[j], zero));
+			__m128 cb1 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(cb16[j], zero));
+			__m128 cr0 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(cr16[j], zero));
+			__m128 cr1 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(cr16[j], zero));
+			uint32* pixels = output + (i * 0x10) + (j * 8);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + 0), ConvertPixels(y0, cb0, cr0, alphaTh0, alphaTh1));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + 4), ConvertPixels(y1, cb1, cr1, alphaTh0, alphaTh1));
+		}
+	}
+}
+
+#elif defined(IPUKERNELS_NEON)
+
+static int32x4_t FloorToInt(float32x4_t value)
+{
+	int32x4_t truncated = vcvtq_s32_f32(value);
+	uint32x4_t adjust = vcgtq_f32(vcvtq_f32_s32(truncated), value);
+	return vaddq_s32(truncated, vreinterpretq_s32_u32(adjust));
+}
+
+void IpuKernels::DequantiseBlock(int16* block, bool isIntra, int16 quantScale, int16 intraDcMult, const uint8* iq)
+{
+	int16 dcValue = block[0];
+	const int16x8_t zero = vdupq_n_s16(0);
+	const int16x8_t one = vdupq_n_s16(1);
+	for(unsigned int i = 0; i < BLOCK_SIZE; i += 8)
+	{
+		int16x8_t value = vld1q_s16(block + i);
+		int16x8_t weight = vmulq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(iq + i))), vdupq_n_s16(quantScale));
+
+		uint16x8_t positive = vcgtq_s16(value, zero);
+		uint16x8_t negative = vcltq_s16(value, zero);
+		int16x8_t sign = vsubq_s16(vreinterpretq_s16_u16(negative), vreinterpretq_s16_u16(positive));
+
+		//32-bit value * weight products
+		int32x4_t product0 = vshlq_n_s32(vmull_s16(vget_low_s16(value), vget_low_s16(weight)), 1);
+		int32x4_t product1 = vshlq_n_s32(vmull_s16(vget_high_s16(value), vget_high_s16(weight)), 1);
+		if(!isIntra)
+		{
+			//((value * 2) + sign) * weight
+			int16x8_t signWeight = vmulq_s16(sign, weight);
+			product0 = vaddq_s32(product0, vmovl_s16(vget_low_s16(signWeight)));
+			product1 = vaddq_s32(product1, vmovl_s16(vget_high_s16(signWeight)));
+		}
+
+		//Divide by 32, rounding towards zero, and truncate to 16 bits
+		product0 = vshrq_n_s32(vaddq_s32(product0, vandq_s32(vshrq_n_s32(product0, 31), vdupq_n_s32(31))), 5);
+		product1 = vshrq_n_s32(vaddq_s32(product1, vandq_s32(vshrq_n_s32(product1, 31), vdupq_n_s32(31))), 5);
+		int16x8_t result = vcombine_s16(vmovn_s32(product0), vmovn_s32(product1));
+
+		//Mismatch control, make even non-zero values odd
+		uint16x8_t isEven = vceqq_s16(vandq_s16(result, one), zero);
+		uint16x8_t mustAdjust = vandq_u16(vorrq_u16(positive, negative), isEven);
+		int16x8_t adjusted = vorrq_s16(vsubq_s16(result, sign), one);
+		result = vbslq_s16(mustAdjust, adjusted, result);
+
+		result = vmaxq_s16(vminq_s16(result, vdupq_n_s16(2047)), vdupq_n_s16(-2048));
+		vst1q_s16(block + i, result);
+	}
+	if(isIntra)
+	{
+		int16 dcResult = static_cast<int16>(intraDcMult * dcValue);
+		block[0] = std::max<int16>(std::min<int16>(dcResult, 2047), -2048);
+	}
+}
+
+void IpuKernels::Idct(const int16* input, int16* output)
+{
+	float32x4_t rows[8][2];
+	for(unsigned int v = 0; v < 8; v++)
+	{
+		float32x4_t accumulator0 = vdupq_n_f32(0);
+		float32x4_t accumulator1 = vdupq_n_f32(0);
+		for(unsigned int u = 0; u < 8; u++)
+		{
+			float32x4_t coefficient = vdupq_n_f32(static_cast<float>(input[(v * 8) + u]));
+			accumulator0 = vaddq_f32(accumulator0, vmulq_f32(coefficient, vld1q_f32(&g_idctMatrix.values[u][0])));
+			accumulator1 = vaddq_f32(accumulator1, vmulq_f32(coefficient, vld1q_f32(&g_idctMatrix.values[u][4])));
+		}
+		rows[v][0] = accumulator0;
+		rows[v][1] = accumulator1;
+	}
+	const float32x4_t half = vdupq_n_f32(0.5f);
+	for(unsigned int y = 0; y < 8; y++)
+	{
+		float32x4_t accumulator0 = vdupq_n_f32(0);
+		float32x4_t accumulator1 = vdupq_n_f32(0);
+		for(unsigned int v = 0; v < 8; v++)
+		{
+			float32x4_t coefficient = vdupq_n_f32(g_idctMatrix.values[v][y]);
+			accumulator0 = vaddq_f32(accumulator0, vmulq_f32(coefficient, rows[v][0]));
+			accumulator1 = vaddq_f32(accumulator1, vmulq_f32(coefficient, rows[v][1]));
+		}
+		int32x4_t result0 = FloorToInt(vaddq_f32(accumulator0, half));
+		int32x4_t result1 = FloorToInt(vaddq_f32(accumulator1, half));
+		int16x8_t result = vcombine_s16(vqmovn_s32(result0), vqmovn_s32(result1));
+		result = vmaxq_s16(vminq_s16(result, vdupq_n_s16(255)), vdupq_n_s16(-256));
+		vst1q_s16(output + (y * 8), result);
+	}
+}
+
+void IpuKernels::ConvertRaw16ToRaw8(const int16* input, uint8* output, uint32 count)
+{
+	uint32 i = 0;
+	for(; (i + 8) <= count; i += 8)
+	{
+		vst1_u8(output + i, vqmovun_s16(vld1q_s16(input + i)));
+	}
+	for(; i < count; i++)
+	{
+		output[i] = static_cast<uint8>(std::min<int16>(std::max<int16>(input[i], 0), 255));
+	}
+}
+
+static uint32x4_t ConvertPixels(float32x4_t y, float32x4_t cb, float32x4_t cr, uint32x4_t alphaTh0, uint32x4_t alphaTh1)
+{
+	const float32x4_t offset = vdupq_n_f32(128);
+	const float32x4_t minValue = vdupq_n_f32(0);
+	const float32x4_t maxValue = vdupq_n_f32(255);
+	cb = vsubq_f32(cb, offset);
+	cr = vsubq_f32(cr, offset);
+
+	float32x4_t r = vaddq_f32(y, vmulq_f32(vdupq_n_f32(1.402f), cr));
+	float32x4_t g = vsubq_f32(vsubq_f32(y, vmulq_f32(vdupq_n_f32(0.34414f), cb)), vmulq_f32(vdupq_n_f32(0.71414f), cr));
+	float32x4_t b = vaddq_f32(y, vmulq_f32(vdupq_n_f32(1.772f), cb));
+
+	uint32x4_t ri = vcvtq_u32_f32(vminq_f32(vmaxq_f32(r, minValue), maxValue));
+	uint32x4_t gi = vcvtq_u32_f32(vminq_f32(vmaxq_f32(g, minValue), maxValue));
+	uint32x4_t bi = vcvtq_u32_f32(vminq_f32(vmaxq_f32(b, minValue), maxValue));
+	uint32x4_t rgb = vorrq_u32(vorrq_u32(vshlq_n_u32(bi, 16), vshlq_n_u32(gi, 8)), ri);
+
+	uint32x4_t belowTh0 = vcltq_u32(rgb, alphaTh0);
+	uint32x4_t belowTh1 = vcltq_u32(rgb, alphaTh1);
+	uint32x4_t alpha = vbslq_u32(belowTh1, vdupq_n_u32(0x40), vdupq_n_u32(0x80));
+	alpha = vbicq_u32(alpha, belowTh0);
+
+	return vorrq_u32(vshlq_n_u32(alpha, 24), rgb);
+}
+
+void IpuKernels::ConvertMacroblockToRgb32(const uint8* block, uint32* output, uint16 th0, uint16 th1)
+{
+	const uint32x4_t alphaTh0 = vdupq_n_u32(MakeAlphaThreshold(th0));
+	const uint32x4_t alphaTh1 = vdupq_n_u32(MakeAlphaThreshold(th1));
+	for(unsigned int i = 0; i < 16; i++)
+	{
+		const uint8* rowY = block + (i * 0x10);
+		const uint8* rowCb = block + 0x100 + ((i / 2) * 8);
+		const uint8* rowCr = block + 0x140 + ((i / 2) * 8);
+
+		uint8x16_t y = vld1q_u8(rowY);
+		//Each chroma value covers 2 horizontal pixels
+		uint8x8x2_t cb = vzip_u8(vld1_u8(rowCb), vld1_u8(rowCb));
+		uint8x8x2_t cr = vzip_u8(vld1_u8(rowCr), vld1_u8(rowCr));
+
+		uint16x8_t y16[2] = {vmovl_u8(vget_low_u8(y)), vmovl_u8(vget_high_u8(y))};
+		uint16x8_t cb16[2] = {vmovl_u8(cb.val[0]), vmovl_u8(cb.val[1])};
+		uint16x8_t cr16[2] = {vmovl_u8(cr.val[0]), vmovl_u8(cr.val[1])};
+
+		for(unsigned int j = 0; j < 2; j++)
+		{
+			float32x4_t y0 = vcvtq_f32_u32(vmovl_u16(vget_low_u16(y16[j])));
+			float32x4_t y1 = vcvtq_f32_u32(vmovl_u16(vget_high_u16(y16[j])));
+			float32x4_t cb0 = vcvtq_f32_u32(vmovl_u16(vget_low_u16(cb16[j])));
+			float32x4_t cb1 = vcvtq_f32_u32(vmovl_u16(vget_high_u16(cb16[j])));
+			float32x4_t cr0 = vcvtq_f32_u32(vmovl_u16(vget_low_u16(cr16[j])));
+			float32x4_t cr1 = vcvtq_f32_u32(vmovl_u16(vget_high_u16(cr16[j])));
+			uint32* pixels = output + (i * 0x10) + (j * 8);
+			vst1q_u32(pixels + 0, ConvertPixels(y0, cb0, cr0, alphaTh0, alphaTh1));
+			vst1q_u32(pixels + 4, ConvertPixels(y1, cb1, cr1, alphaTh0, alphaTh1));
+		}
+	}
+}
+
+#else
+
+void IpuKernels::DequantiseBlock(int16* block, bool isIntra, int16 quantScale, int16 intraDcMult, const uint8* iq)
+{
+	unsigned int start = 0;
+	if(isIntra)
+	{
+		block[0] = intraDcMult * block[0];
+		start = 1;
+	}
+
+	for(unsigned int i = start; i < BLOCK_SIZE; i++)
+	{
+		int16 sign = (block[i] == 0) ? 0 : ((block[i] > 0) ? 1 : -1);
+
+		if(isIntra)
+		{
+			block[i] = (block[i] * static_cast<int16>(iq[i]) * quantScale * 2) / 32;
+		}
+		else
+		{
+			block[i] = (((block[i] * 2) + sign) * static_cast<int16>(iq[i]) * quantScale) / 32;
+		}
+
+		if((sign != 0) && ((block[i] & 1) == 0))
+		{
+			block[i] = (block[i] - sign) | 1;
+		}
+	}
+
+	for(unsigned int i = 0; i < BLOCK_SIZE; i++)
+	{
+		block[i] = std::max<int16>(std::min<int16>(block[i], 2047), -2048);
+	}
+}
+
+void IpuKernels::Idct(const int16* input, int16* output)
+{
+	float rows[8][8];
+	for(unsigned int v = 0; v < 8; v++)
+	{
+		for(unsigned int x = 0; x < 8; x++)
+		{
+			float accumulator = 0;
+			for(unsigned int u = 0; u < 8; u++)
+			{
+				accumulator += static_cast<float>(input[(v * 8) + u]) * g_idctMatrix.values[u][x];
+			}
+			rows[v][x] = accumulator;
+		}
+	}
+	for(unsigned int y = 0; y < 8; y++)
+	{
+		for(unsigned int x = 0; x < 8; x++)
+		{
+			float accumulator = 0;
+			for(unsigned int v = 0; v < 8; v++)
+			{
+				accumulator += g_idctMatrix.values[v][y] * rows[v][x];
+			}
+			float result = std::floor(accumulator + 0.5f);
+			output[(y * 8) + x] = static_cast<int16>(std::max<float>(std::min<float>(result, 255), -256));
+		}
+	}
+}
+
+void IpuKernels::ConvertRaw16ToRaw8(const int16* input, uint8* output, uint32 count)
+{
+	for(uint32 i = 0; i < count; i++)
+	{
+		output[i] = static_cast<uint8>(std::min<int16>(std::max<int16>(input[i], 0), 255));
+	}
+}
+
+void IpuKernels::ConvertMacroblockToRgb32(const uint8* block, uint32* output, uint16 th0, uint16 th1)
+{
+	uint32 alphaTh0 = MakeAlphaThreshold(th0);
+	uint32 alphaTh1 = MakeAlphaThreshold(th1);
+	for(unsigned int i = 0; i < 16; i++)
+	{
+		for(unsigned int j = 0; j < 16; j++)
+		{
+			unsigned int chromaIndex = ((i / 2) * 8) + (j / 2);
+			float nY = block[(i * 0x10) + j];
+			float nCb = block[0x100 + chromaIndex];
+			float nCr = block[0x140 + chromaIndex];
+
+			float nR = nY + 1.402f * (nCr - 128);
+			float nG = nY - 0.34414f * (nCb - 128) - 0.71414f * (nCr - 128);
+			float nB = nY + 1.772f * (nCb - 128);
+
+			nR = std::min<float>(std::max<float>(nR, 0), 255);
+			nG = std::min<float>(std::max<float>(nG, 0), 255);
+			nB = std::min<float>(std::max<float>(nB, 0), 255);
+
+			uint8 a = 0;
+			uint32 rgb = (static_cast<uint8>(nB) << 16) | (static_cast<uint8>(nG) << 8) | (static_cast<uint8>(nR) << 0);
+			if(rgb < alphaTh0)
+			{
+				a = 0;
+			}
+			else if(rgb < alphaTh1)
+			{
+				a = 0x40;
+			}
+			else
+			{
+				a = 0x80;
+			}
+
+			output[(i * 0x10) + j] = (a << 24) | rgb;
+		}
+	}
+}
+
+#endif
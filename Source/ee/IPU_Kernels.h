@@ -0,0 +1,28 @@
+#pragma once
+
+#include "Types.h"
+
+//Block and macroblock level operations used by the IPU decoding commands.
+//SSE2 and NEON versions are used when available.
+namespace IpuKernels
+{
+	enum
+	{
+		BLOCK_SIZE = 0x40,
+		MACROBLOCK_SIZE = 0x180,
+		MACROBLOCK_PIXELS = 0x100,
+	};
+
+	//Dequantises a block that is already in natural (inverse scanned) order and saturates it to [-2048, 2047]
+	void DequantiseBlock(int16* block, bool isIntra, int16 quantScale, int16 intraDcMult, const uint8* iq);
+
+	//Separable 8x8 inverse DCT computed in single precision, output is rounded and
+	//saturated to [-256, 255]. Accuracy meets the IEEE-1180 requirements (checked by IpuTest).
+	void Idct(const int16* input, int16* output);
+
+	//Saturates RAW16 values to [0, 255]
+	void ConvertRaw16ToRaw8(const int16* input, uint8* output, uint32 count);
+
+	//Converts a YCbCr 4:2:0 macroblock (256 Y, 64 Cb and 64 Cr values) to RGB32
+	void ConvertMacroblockToRgb32(const uint8* block, uint32* output, uint16 th0, uint16 th1);
+}
@@ -551,6 +551,7 @@ void CPS2OS::UnloadExecutable()
 
 uint32 CPS2OS::LoadExecutable(const char* path, const char* section)
 {
+	m_sif.SyncIop();
 	auto ioman = m_iopBios.GetIoman();
 
 	uint32 handle = ioman->Open(Iop::Ioman::CDevice::OPEN_FLAG_RDONLY, path);
@@ -2833,6 +2834,7 @@ void CPS2OS::sc_Deci2Call()
 				uint32 length = m_ram[stringAddr + 0x00] - 0x0C;
 				uint8* string = &m_ram[stringAddr + 0x0C];
 
+				m_sif.SyncIop();
 				m_iopBios.GetIoman()->Write(Iop::CIoman::FID_STDOUT, length, string);
 			}
 
@@ -2860,6 +2862,7 @@ void CPS2OS::sc_Deci2Call()
 		{
 			uint32 stringAddr = *reinterpret_cast<uint32*>(GetStructPtr(param));
 			uint8* string = &m_ram[stringAddr];
+			m_sif.SyncIop();
 			m_iopBios.GetIoman()->Write(1, static_cast<uint32>(strlen(reinterpret_cast<char*>(string))), string);
 		}
 		break;
@@ -2923,6 +2926,8 @@ void CPS2OS::HandleSyscall()
 	}
 	else if((func >= Ee::CLibMc2::SYSCALL_RANGE_START) && (func < Ee::CLibMc2::SYSCALL_RANGE_END))
 	{
+		//LibMc2 calls directly into IOP modules
+		m_sif.SyncIop();
 		m_libMc2.HandleSyscall(m_ee);
 	}
 	else
@@ -4,6 +4,7 @@
 #include "../Ps2Const.h"
 #include "../states/StructCollectionStateFile.h"
 #include "../states/MemoryStateFile.h"
+#include "../states/RawState.h"
 #include "../iop/IopBios.h"
 #include "SIF.h"
 #include "lexical_cast_ex.h"
@@ -75,7 +76,8 @@ void CSIF::Reset()
 	m_cmdBufferAddress = 0;
 	m_cmdBufferSize = 0;
 
-	m_packetQueue.clear();
+	m_packetQueue.Clear();
+	m_packetQueuePending = false;
 	m_packetProcessed = true;
 
 	m_callReplies.clear();
@@ -126,6 +128,7 @@ void CSIF::DeleteModules()
 
 uint32 CSIF::ReceiveDMA5(uint32 srcAddress, uint32 size, uint32 unused, bool isTagIncluded)
 {
+	SyncIop();
 	if(size > m_dmaBufferSize)
 	{
 		throw std::runtime_error("Packet too big.");
@@ -138,6 +141,8 @@ uint32 CSIF::ReceiveDMA6(uint32 nSrcAddr, uint32 nSize, uint32 nDstAddr, bool is
 {
 	assert(!isTagIncluded);
 
+	SyncIop();
+
 	//Humm, this is kinda odd, but it ors the address with 0x20000000
 	nSrcAddr &= (PS2::EE_RAM_SIZE - 1);
 
@@ -209,6 +214,10 @@ uint32 CSIF::ReceiveDMA6(uint32 nSrcAddr, uint32 nSize, uint32 nDstAddr, bool is
 		else
 		{
 			memcpy(m_iopRam + nDstAddr, m_eeRam + nSrcAddr, nSize);
+			if(m_iopRamWriteHandler && (nSize != 0))
+			{
+				m_iopRamWriteHandler(nDstAddr, nDstAddr + nSize);
+			}
 		}
 		return nSize;
 	}
@@ -216,33 +225,32 @@ uint32 CSIF::ReceiveDMA6(uint32 nSrcAddr, uint32 nSize, uint32 nDstAddr, bool is
 
 void CSIF::SendPacket(void* packet, uint32 size)
 {
-	m_packetQueue.insert(m_packetQueue.begin(),
-	                     reinterpret_cast<uint8*>(packet),
-	                     reinterpret_cast<uint8*>(packet) + size);
-	m_packetQueue.insert(m_packetQueue.begin(),
-	                     reinterpret_cast<uint8*>(&size),
-	                     reinterpret_cast<uint8*>(&size) + 4);
+	m_packetQueue.Push(packet, size);
+	m_packetQueuePending = true;
 }
 
 void CSIF::ProcessPackets()
 {
-	if(m_packetProcessed && !m_packetQueue.empty())
+	if(!m_packetProcessed || !m_packetQueuePending) return;
+	SyncIop();
+	if(m_packetProcessed && !m_packetQueue.IsEmpty())
 	{
-		assert(m_packetQueue.size() > 4);
-		uint32 size = *reinterpret_cast<uint32*>(&m_packetQueue[0]);
-		SendDMA(&m_packetQueue[4], size);
-		m_packetQueue.erase(m_packetQueue.begin(), m_packetQueue.begin() + 4 + size);
+		//Only one packet is sent at a time, the EE expects a SIF0 interrupt for each of them
+		SendDMA(m_packetQueue.GetFrontData(), m_packetQueue.GetFrontSize());
+		m_packetQueue.Pop();
+		m_packetQueuePending = !m_packetQueue.IsEmpty();
 		m_packetProcessed = false;
 	}
 }
 
 void CSIF::MarkPacketProcessed()
 {
+	SyncIop();
 	assert(m_packetProcessed == false);
 	m_packetProcessed = true;
 }
 
-void CSIF::SendDMA(void* pData, uint32 nSize)
+void CSIF::SendDMA(const void* pData, uint32 nSize)
 {
 	//Humm, the DMAC doesn't know about our addresses on this side...
 
@@ -272,7 +280,8 @@ void CSIF::LoadState(Framework::CZipArchiveReader& archive)
 		m_packetProcessed = registerFile.GetRegister32(STATE_REG_PACKETPROCESSED) != 0;
 	}
 
-	m_packetQueue = LoadPacketQueue(archive);
+	LoadPacketQueue(archive);
+	m_packetQueuePending = !m_packetQueue.IsEmpty();
 
 	m_callReplies = LoadCallReplies(archive);
 	m_bindReplies = LoadBindReplies(archive);
@@ -292,12 +301,87 @@ void CSIF::SaveState(Framework::CZipArchiveWriter& archive)
 		archive.InsertFile(registerFile);
 	}
 
-	archive.InsertFile(new CMemoryStateFile(STATE_PACKETQUEUE, m_packetQueue.data(), m_packetQueue.size()));
+	//State files are only written out later on, the serialized queue must stay alive until then
+	m_savedPacketQueue = m_packetQueue.Save();
+	archive.InsertFile(new CMemoryStateFile(STATE_PACKETQUEUE, m_savedPacketQueue.data(), m_savedPacketQueue.size()));
 
 	SaveCallReplies(archive);
 	SaveBindReplies(archive);
 }
 
+void CSIF::LoadRawState(Framework::CStream& stream)
+{
+	RawState::Read(stream, m_nMAINADDR);
+	RawState::Read(stream, m_nSUBADDR);
+	RawState::Read(stream, m_nMSFLAG);
+	RawState::Read(stream, m_nSMFLAG);
+	RawState::Read(stream, m_nEERecvAddr);
+	RawState::Read(stream, m_nDataAddr);
+	RawState::Read(stream, m_packetProcessed);
+
+	{
+		std::vector<uint8> packetQueue;
+		RawState::ReadBytes(stream, packetQueue);
+		m_packetQueue.Load(packetQueue.data(), packetQueue.size());
+		m_packetQueuePending = !m_packetQueue.IsEmpty();
+	}
+
+	{
+		uint32 replyCount = 0;
+		RawState::Read(stream, replyCount);
+		m_callReplies.clear();
+		for(uint32 i = 0; i < replyCount; i++)
+		{
+			uint32 replyId = 0;
+			CALLREQUESTINFO callReply;
+			RawState::Read(stream, replyId);
+			RawState::Read(stream, callReply);
+			m_callReplies[replyId] = callReply;
+		}
+	}
+
+	{
+		uint32 replyCount = 0;
+		RawState::Read(stream, replyCount);
+		m_bindReplies.clear();
+		for(uint32 i = 0; i < replyCount; i++)
+		{
+			uint32 replyId = 0;
+			SIFRPCREQUESTEND bindReply;
+			RawState::Read(stream, replyId);
+			RawState::Read(stream, bindReply);
+			m_bindReplies[replyId] = bindReply;
+		}
+	}
+}
+
+void CSIF::SaveRawState(Framework::CStream& stream)
+{
+	RawState::Write(stream, m_nMAINADDR);
+	RawState::Write(stream, m_nSUBADDR);
+	RawState::Write(stream, m_nMSFLAG);
+	RawState::Write(stream, m_nSMFLAG);
+	RawState::Write(stream, m_nEERecvAddr);
+	RawState::Write(stream, m_nDataAddr);
+	RawState::Write(stream, m_packetProcessed);
+
+	RawState::WriteBytes(stream, m_packetQueue.Save());
+
+	RawState::Write(stream, static_cast<uint32>(m_callReplies.size()));
+	for(const auto& callReplyPair : m_callReplies)
+	{
+		RawState::Write(stream, callReplyPair.first);
+		RawState::Write(stream, callReplyPair.second);
+	}
+
+	RawState::Write(stream, static_cast<uint32>(m_bindReplies.size()));
+	for(const auto& bindReplyPair : m_bindReplies)
+	{
+		RawState::Write(stream, bindReplyPair.first);
+		RawState::Write(stream, bindReplyPair.second);
+	}
+}
+
 void CSIF::SaveCallReplies(Framework::CZipArchiveWriter& archive)
 {
 	auto callRepliesFile = new CStructCollectionStateFile(STATE_CALL_REPLIES_XML);
@@ -331,9 +415,9 @@ void CSIF::SaveBindReplies(Framework::CZipArchiveWriter& archive)
 	archive.InsertFile(bindRepliesFile);
 }
 
-CSIF::PacketQueue CSIF::LoadPacketQueue(Framework::CZipArchiveReader& archive)
+void CSIF::LoadPacketQueue(Framework::CZipArchiveReader& archive)
 {
-	PacketQueue packetQueue;
+	std::vector<uint8> packetQueue;
 	auto file = archive.BeginReadFile(STATE_PACKETQUEUE);
 	while(1)
 	{
@@ -343,7 +427,7 @@ CSIF::PacketQueue CSIF::LoadPacketQueue(Framework::CZipArchiveReader& archive)
 		if(readSize == 0) break;
 		packetQueue.insert(std::end(packetQueue), buffer, buffer + readSize);
 	}
-	return packetQueue;
+	m_packetQueue.Load(packetQueue.data(), packetQueue.size());
 }
 
 CSIF::CallReplyMap CSIF::LoadCallReplies(Framework::CZipArchiveReader& archive)
@@ -641,12 +725,31 @@ void CSIF::SetCustomCommandHandler(const CustomCommandHandler& customCommandHand
 	m_customCommandHandler = customCommandHandler;
 }
 
+void CSIF::SetIopRamWriteHandler(const IopRamWriteHandler& iopRamWriteHandler)
+{
+	m_iopRamWriteHandler = iopRamWriteHandler;
+}
+
+void CSIF::SetIopSyncHandler(const IopSyncHandler& iopSyncHandler)
+{
+	m_iopSyncHandler = iopSyncHandler;
+}
+
+void CSIF::SyncIop()
+{
+	if(m_iopSyncHandler)
+	{
+		m_iopSyncHandler();
+	}
+}
+
 /////////////////////////////////////////////////////////
 //Get/Set Register
 /////////////////////////////////////////////////////////
 
 uint32 CSIF::GetRegister(uint32 nRegister)
 {
+	SyncIop();
 	switch(nRegister)
 	{
 	case 0x00000001:
@@ -676,6 +779,7 @@ uint32 CSIF::GetRegister(uint32 nRegister)
 
 void CSIF::SetRegister(uint32 nRegister, uint32 nValue)
 {
+	SyncIop();
 	switch(nRegister)
 	{
 	case 0x00000001:
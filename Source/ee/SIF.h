@@ -1,10 +1,12 @@
 #pragma once
 
+#include <atomic>
 #include <map>
 #include <vector>
 #include "../SifDefs.h"
 #include "../SifModule.h"
 #include "DMAC.h"
+#include "SifPacketQueue.h"
 #include "zip/ZipArchiveWriter.h"
 #include "zip/ZipArchiveReader.h"
 #include "../states/RegisterStateFile.h"
@@ -15,6 +17,8 @@ class CSIF
 public:
 	typedef std::function<void(const std::string&)> ModuleResetHandler;
 	typedef std::function<void(uint32)> CustomCommandHandler;
+	typedef std::function<void(uint32, uint32)> IopRamWriteHandler;
+	typedef std::function<void()> IopSyncHandler;
 
 	CSIF(CDMAC&, uint8*, uint8*);
 	virtual ~CSIF() = default;
@@ -32,19 +36,26 @@ public:
 	void SendCallReply(uint32, const void*);
 	void SetModuleResetHandler(const ModuleResetHandler&);
 	void SetCustomCommandHandler(const CustomCommandHandler&);
+	void SetIopRamWriteHandler(const IopRamWriteHandler&);
+	void SetIopSyncHandler(const IopSyncHandler&);
+
+	//Called before the EE side touches state shared with the IOP
+	void SyncIop();
 
 	uint32 ReceiveDMA5(uint32, uint32, uint32, bool);
 	uint32 ReceiveDMA6(uint32, uint32, uint32, bool);
 
 	void SendPacket(void*, uint32);
 
-	void SendDMA(void*, uint32);
+	void SendDMA(const void*, uint32);
 
 	uint32 GetRegister(uint32);
 	void SetRegister(uint32, uint32);
 
 	void LoadState(Framework::CZipArchiveReader&);
 	void SaveState(Framework::CZipArchiveWriter&);
+	void LoadRawState(Framework::CStream&);
+	void SaveRawState(Framework::CStream&);
 
 private:
 	struct CALLREQUESTINFO
@@ -54,7 +65,6 @@ private:
 	};
 
 	typedef std::map<uint32, CSifModule*> ModuleMap;
-	typedef std::vector<uint8> PacketQueue;
 	typedef std::map<uint32, CALLREQUESTINFO> CallReplyMap;
 	typedef std::map<uint32, SIFRPCREQUESTEND> BindReplyMap;
 
@@ -63,7 +73,7 @@ private:
 	void SaveCallReplies(Framework::CZipArchiveWriter&);
 	void SaveBindReplies(Framework::CZipArchiveWriter&);
 
-	static PacketQueue LoadPacketQueue(Framework::CZipArchiveReader&);
+	void LoadPacketQueue(Framework::CZipArchiveReader&);
 	static CallReplyMap LoadCallReplies(Framework::CZipArchiveReader&);
 	static BindReplyMap LoadBindReplies(Framework::CZipArchiveReader&);
 
@@ -99,7 +109,9 @@ private:
 
 	ModuleMap m_modules;
 
-	PacketQueue m_packetQueue;
+	CSifPacketQueue m_packetQueue;
+	std::vector<uint8> m_savedPacketQueue;
+	std::atomic<bool> m_packetQueuePending = {false};
 	bool m_packetProcessed;
 
 	CallReplyMap m_callReplies;
@@ -107,4 +119,6 @@ private:
 
 	ModuleResetHandler m_moduleResetHandler;
 	CustomCommandHandler m_customCommandHandler;
+	IopRamWriteHandler m_iopRamWriteHandler;
+	IopSyncHandler m_iopSyncHandler;
 };
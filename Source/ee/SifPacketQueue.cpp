@@ -0,0 +1,119 @@
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+#include "SifPacketQueue.h"
+
+CSifPacketQueue::CSifPacketQueue()
+    : m_packets(DEFAULT_CAPACITY)
+{
+}
+
+void CSifPacketQueue::Clear()
+{
+	m_front = 0;
+	m_count = 0;
+}
+
+bool CSifPacketQueue::IsEmpty() const
+{
+	return (m_count == 0);
+}
+
+uint32 CSifPacketQueue::GetCount() const
+{
+	return m_count;
+}
+
+uint32 CSifPacketQueue::GetCapacity() const
+{
+	return static_cast<uint32>(m_packets.size());
+}
+
+void CSifPacketQueue::Push(const void* data, uint32 size)
+{
+	if(size > MAX_PACKET_SIZE)
+	{
+		throw std::runtime_error("SIF packet too big.");
+	}
+	if(m_count == m_packets.size())
+	{
+		Grow();
+	}
+	m_front = (m_front - 1) & GetIndexMask();
+	auto& packet = m_packets[m_front];
+	packet.size = size;
+	memcpy(packet.data, data, size);
+	m_count++;
+}
+
+const uint8* CSifPacketQueue::GetFrontData() const
+{
+	assert(!IsEmpty());
+	return m_packets[m_front].data;
+}
+
+uint32 CSifPacketQueue::GetFrontSize() const
+{
+	assert(!IsEmpty());
+	return m_packets[m_front].size;
+}
+
+void CSifPacketQueue::Pop()
+{
+	assert(!IsEmpty());
+	m_front = (m_front + 1) & GetIndexMask();
+	m_count--;
+}
+
+std::vector<uint8> CSifPacketQueue::Save() const
+{
+	std::vector<uint8> result;
+	for(uint32 i = 0; i < m_count; i++)
+	{
+		const auto& packet = m_packets[(m_front + i) & GetIndexMask()];
+		auto sizePtr = reinterpret_cast<const uint8*>(&packet.size);
+		result.insert(std::end(result), sizePtr, sizePtr + 4);
+		result.insert(std::end(result), packet.data, packet.data + packet.size);
+	}
+	return result;
+}
+
+void CSifPacketQueue::Load(const uint8* data, size_t size)
+{
+	Clear();
+	//Records are front first, push them back to front to keep the same order
+	std::vector<std::pair<const uint8*, uint32>> records;
+	size_t offset = 0;
+	while((offset + 4) <= size)
+	{
+		uint32 packetSize = 0;
+		memcpy(&packetSize, data + offset, 4);
+		offset += 4;
+		if((offset + packetSize) > size)
+		{
+			throw std::runtime_error("Invalid SIF packet queue.");
+		}
+		records.push_back(std::make_pair(data + offset, packetSize));
+		offset += packetSize;
+	}
+	for(auto recordIterator = records.rbegin(); recordIterator != records.rend(); recordIterator++)
+	{
+		Push(recordIterator->first, recordIterator->second);
+	}
+}
+
+uint32 CSifPacketQueue::GetIndexMask() const
+{
+	return static_cast<uint32>(m_packets.size()) - 1;
+}
+
+void CSifPacketQueue::Grow()
+{
+	std::vector<PACKET> packets(m_packets.size() * 2);
+	for(uint32 i = 0; i < m_count; i++)
+	{
+		packets[i] = m_packets[(m_front + i) & GetIndexMask()];
+	}
+	m_packets = std::move(packets);
+	m_front = 0;
+}
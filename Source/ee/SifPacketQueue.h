@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+#include "Types.h"
+
+//Queue of SIF command packets waiting to be sent to the EE. Packets are stored in fixed size
+//slots of a ring, pushing and popping never moves other packets around. The ring only grows
+//(doubling its capacity) if more packets than it can hold are pending, packets are never dropped.
+//Packets are delivered newest first, like the queue this replaces.
+class CSifPacketQueue
+{
+public:
+	enum
+	{
+		//SIFCMDHEADER::packetSize is 8 bits wide
+		MAX_PACKET_SIZE = 0x100,
+		//Must be a power of 2
+		DEFAULT_CAPACITY = 64,
+	};
+
+	CSifPacketQueue();
+
+	void Clear();
+	bool IsEmpty() const;
+	uint32 GetCount() const;
+	uint32 GetCapacity() const;
+
+	void Push(const void*, uint32);
+	const uint8* GetFrontData() const;
+	uint32 GetFrontSize() const;
+	void Pop();
+
+	//Serialized as a sequence of [size (32 bits)][data] records, front first
+	std::vector<uint8> Save() const;
+	void Load(const uint8*, size_t);
+
+private:
+	struct PACKET
+	{
+		uint32 size;
+		uint8 data[MAX_PACKET_SIZE];
+	};
+
+	uint32 GetIndexMask() const;
+	void Grow();
+
+	std::vector<PACKET> m_packets;
+	uint32 m_front = 0;
+	uint32 m_count = 0;
+};
@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include "../Log.h"
 #include "../states/RegisterStateFile.h"
+#include "../states/RawState.h"
 #include "Timer.h"
 
 #define LOG_NAME ("ee_timer")
@@ -266,6 +267,16 @@ void CTimer::SaveState(Framework::CZipArchiveWriter& archive)
 	archive.InsertFile(registerFile);
 }
 
+void CTimer::LoadRawState(Framework::CStream& stream)
+{
+	RawState::Read(stream, m_timer);
+}
+
+void CTimer::SaveRawState(Framework::CStream& stream)
+{
+	RawState::Write(stream, m_timer);
+}
+
 void CTimer::NotifyVBlankStart()
 {
 	ProcessGateEdgeChange(MODE_GATE_SELECT_VBLANK, MODE_GATE_MODE_HIGHEDGE);
@@ -52,6 +52,8 @@ public:
 
 	void LoadState(Framework::CZipArchiveReader&);
 	void SaveState(Framework::CZipArchiveWriter&);
+	void LoadRawState(Framework::CStream&);
+	void SaveRawState(Framework::CStream&);
 
 	void NotifyVBlankStart();
 	void NotifyVBlankEnd();
@@ -7,8 +7,10 @@
 #include "../Ps2Const.h"
 #include "../states/RegisterStateFile.h"
 #include "../states/MemoryStateFile.h"
+#include "../states/RawState.h"
 #include "Vpu.h"
 #include "Vif.h"
+#include "VifUnpack.h"
 #include "INTC.h"
 
 #define LOG_NAME ("ee_vif")
@@ -243,6 +245,44 @@ void CVif::LoadState(Framework::CZipArchiveReader& archive)
 	}
 }
 
+void CVif::SaveRawState(Framework::CStream& stream)
+{
+	RawState::Write(stream, m_STAT);
+	RawState::Write(stream, m_CODE);
+	RawState::Write(stream, m_CYCLE);
+	RawState::Write(stream, m_NUM);
+	RawState::Write(stream, m_MODE);
+	RawState::Write(stream, m_MASK);
+	RawState::Write(stream, m_MARK);
+	RawState::Write(stream, m_R);
+	RawState::Write(stream, m_C);
+	RawState::Write(stream, m_ITOP);
+	RawState::Write(stream, m_ITOPS);
+	RawState::Write(stream, m_readTick);
+	RawState::Write(stream, m_writeTick);
+	RawState::Write(stream, m_fifoIndex);
+	RawState::Write(stream, m_fifoBuffer);
+}
+
+void CVif::LoadRawState(Framework::CStream& stream)
+{
+	RawState::Read(stream, m_STAT);
+	RawState::Read(stream, m_CODE);
+	RawState::Read(stream, m_CYCLE);
+	RawState::Read(stream, m_NUM);
+	RawState::Read(stream, m_MODE);
+	RawState::Read(stream, m_MASK);
+	RawState::Read(stream, m_MARK);
+	RawState::Read(stream, m_R);
+	RawState::Read(stream, m_C);
+	RawState::Read(stream, m_ITOP);
+	RawState::Read(stream, m_ITOPS);
+	RawState::Read(stream, m_readTick);
+	RawState::Read(stream, m_writeTick);
+	RawState::Read(stream, m_fifoIndex);
+	RawState::Read(stream, m_fifoBuffer);
+}
+
 uint32 CVif::GetTOP() const
 {
 	throw std::exception();
@@ -601,7 +641,8 @@ void CVif::Cmd_UNPACK(StreamType& stream, CODE nCommand, uint32 nDstAddr)
 {
 	assert((nCommand.nCMD & 0x60) == 0x60);
 
-	const auto vuMem = m_vpu.GetVuMemory();
+	static const auto unpackFunctions = MakeUnpackFunctionTable(std::make_index_sequence<UNPACK_FUNCTION_COUNT>());
+
 	const auto vuMemSize = m_vpu.GetVuMemorySize();
 	bool usn = (m_CODE.nIMM & 0x4000) != 0;
 	bool useMask = (nCommand.nCMD & 0x10) != 0;
@@ -636,17 +677,66 @@ void CVif::Cmd_UNPACK(StreamType& stream, CODE nCommand, uint32 nDstAddr)
 	assert(nDstAddr < vuMemSize);
 	nDstAddr &= (vuMemSize - 1);
 
+	//Mode 3 is undefined and behaves like the normal mode
+	uint32 mode = (m_MODE == MODE_OFFSET || m_MODE == MODE_DIFFERENCE) ? m_MODE : MODE_NORMAL;
+	uint32 cycle = (cl == wl) ? UNPACK_CYCLE_CONTIGUOUS : ((cl > wl) ? UNPACK_CYCLE_SKIPPING : UNPACK_CYCLE_FILLING);
+	uint32 functionIndex = (nCommand.nCMD & 0x0F);
+	functionIndex = (functionIndex * 2) + (usn ? 1 : 0);
+	functionIndex = (functionIndex * 2) + (useMask ? 1 : 0);
+	functionIndex = (functionIndex * 3) + mode;
+	functionIndex = (functionIndex * UNPACK_CYCLE_COUNT) + cycle;
+	assert(functionIndex < UNPACK_FUNCTION_COUNT);
+
+	currentNum = (this->*unpackFunctions[functionIndex])(stream, nDstAddr, currentNum, cl, wl);
+
+	if(currentNum != 0)
+	{
+		m_STAT.nVPS = 1;
+	}
+	else
+	{
+		stream.Align32();
+		m_STAT.nVPS = 0;
+	}
+
+	m_NUM = static_cast<uint8>(currentNum);
+}
+
+template <size_t... Indices>
+CVif::UnpackFunctionTable CVif::MakeUnpackFunctionTable(std::index_sequence<Indices...>)
+{
+	//Index is ((((dataType * 2 + usn) * 2 + useMask) * 3 + mode) * UNPACK_CYCLE_COUNT + cycle)
+	return UnpackFunctionTable{{&CVif::Unpack<
+	    static_cast<uint32>(Indices / (UNPACK_CYCLE_COUNT * 3 * 2 * 2)),
+	    ((Indices / (UNPACK_CYCLE_COUNT * 3 * 2)) % 2) != 0,
+	    ((Indices / (UNPACK_CYCLE_COUNT * 3)) % 2) != 0,
+	    static_cast<uint32>((Indices / UNPACK_CYCLE_COUNT) % 3),
+	    static_cast<uint32>(Indices % UNPACK_CYCLE_COUNT)>...}};
+}
+
+//Returns the number of elements left to unpack
+template <uint32 dataType, bool usn, bool useMask, uint32 mode, uint32 cycle>
+uint32 CVif::Unpack(StreamType& stream, uint32 nDstAddr, uint32 currentNum, uint32 cl, uint32 wl)
+{
+	const auto vuMem = m_vpu.GetVuMemory();
+	const auto vuMemSize = m_vpu.GetVuMemorySize();
+
+	if((cycle == UNPACK_CYCLE_CONTIGUOUS) && !useMask && (mode == MODE_NORMAL))
+	{
+		currentNum -= Unpack_Direct<dataType, usn>(stream, nDstAddr, currentNum, cl);
+	}
+
 	while(currentNum != 0)
 	{
 		bool mustWrite = false;
 		uint128 writeValue;
 		memset(&writeValue, 0, sizeof(writeValue));
 
-		if(cl >= wl)
+		if(cycle != UNPACK_CYCLE_FILLING)
 		{
 			if(m_readTick < wl)
 			{
-				bool success = Unpack_ReadValue(nCommand, stream, writeValue, usn);
+				bool success = Unpack_ReadValue<dataType, usn>(stream, writeValue);
 				if(!success) break;
 				mustWrite = true;
 			}
@@ -655,7 +745,7 @@ void CVif::Cmd_UNPACK(StreamType& stream, CODE nCommand, uint32 nDstAddr)
 		{
 			if(m_writeTick < cl)
 			{
-				bool success = Unpack_ReadValue(nCommand, stream, writeValue, usn);
+				bool success = Unpack_ReadValue<dataType, usn>(stream, writeValue);
 				if(!success) break;
 			}
 
@@ -672,11 +762,11 @@ void CVif::Cmd_UNPACK(StreamType& stream, CODE nCommand, uint32 nDstAddr)
 
 				if(maskOp == MASK_DATA)
 				{
-					if(m_MODE == MODE_OFFSET)
+					if(mode == MODE_OFFSET)
 					{
 						writeValue.nV[i] += m_R[i];
 					}
-					else if(m_MODE == MODE_DIFFERENCE)
+					else if(mode == MODE_DIFFERENCE)
 					{
 						writeValue.nV[i] += m_R[i];
 						m_R[i] = writeValue.nV[i];
@@ -706,7 +796,7 @@ void CVif::Cmd_UNPACK(StreamType& stream, CODE nCommand, uint32 nDstAddr)
 			currentNum--;
 		}
 
-		if(cl >= wl)
+		if(cycle != UNPACK_CYCLE_FILLING)
 		{
 			m_writeTick = std::min<uint32>(m_writeTick + 1, wl);
 			m_readTick = std::min<uint32>(m_readTick + 1, cl);
@@ -733,23 +823,50 @@ void CVif::Cmd_UNPACK(StreamType& stream, CODE nCommand, uint32 nDstAddr)
 		nDstAddr &= (vuMemSize - 1);
 	}
 
-	if(currentNum != 0)
-	{
-		m_STAT.nVPS = 1;
-	}
-	else
+	return currentNum;
+}
+
+//Unpacks as many whole elements as possible straight from the stream's memory.
+//Only valid when CL == WL, no mask is used and addition mode is normal.
+template <uint32 dataType, bool usn>
+uint32 CVif::Unpack_Direct(StreamType& stream, uint32& nDstAddr, uint32 currentNum, uint32 cl)
+{
+	const uint32 elementSize = VifUnpack::GetElementSize(dataType);
+	if(elementSize == 0) return 0;
+	if(!stream.CanReadDirect()) return 0;
+
+	uint32 count = std::min<uint32>(currentNum, stream.GetAvailableReadBytes() / elementSize);
+	if(count == 0) return 0;
+
+	const auto vuMem = m_vpu.GetVuMemory();
+	const auto vuMemSize = m_vpu.GetVuMemorySize();
+	const uint8* src = stream.GetDirectPointer();
+
+	uint32 remaining = count;
+	while(remaining != 0)
 	{
-		stream.Align32();
-		m_STAT.nVPS = 0;
+		//Split where the destination wraps around VU memory
+		uint32 run = std::min<uint32>(remaining, (vuMemSize - nDstAddr) / 0x10);
+		VifUnpack::CKernel<dataType, usn>::Unpack(reinterpret_cast<uint128*>(vuMem + nDstAddr), src, run);
+		src += run * elementSize;
+		remaining -= run;
+		nDstAddr = (nDstAddr + (run * 0x10)) & (vuMemSize - 1);
 	}
 
-	m_NUM = static_cast<uint8>(currentNum);
+	stream.Skip(count * elementSize);
+
+	assert(m_readTick == m_writeTick);
+	m_writeTick = (m_writeTick + count) % cl;
+	m_readTick = m_writeTick;
+
+	return count;
 }
 
-bool CVif::Unpack_ReadValue(const CODE& nCommand, StreamType& stream, uint128& writeValue, bool usn)
+template <uint32 dataType, bool usn>
+bool CVif::Unpack_ReadValue(StreamType& stream, uint128& writeValue)
 {
 	bool success = false;
-	switch(nCommand.nCMD & 0x0F)
+	switch(dataType)
 	{
 	case 0x00:
 		//S-32
@@ -1255,6 +1372,13 @@ void CVif::CFifoStream::Align32()
 	assert((m_bufferPosition & 0x03) == 0);
 }
 
+bool CVif::CFifoStream::CanReadDirect() const
+{
+	if(m_tagIncluded) return false;
+	//Buffered bytes must come from the current transfer to be contiguous with it
+	return (m_bufferPosition == BUFFERSIZE) || ((m_nextAddress - m_startAddress) >= 0x10);
+}
+
 uint8* CVif::CFifoStream::GetDirectPointer() const
 {
 	assert(!m_tagIncluded);
@@ -1290,6 +1414,28 @@ void CVif::CFifoStream::Advance(uint32 size)
 	}
 }
 
+void CVif::CFifoStream::Skip(uint32 size)
+{
+	assert(!m_tagIncluded);
+	assert(size <= GetAvailableReadBytes());
+	uint32 bufferRemain = BUFFERSIZE - m_bufferPosition;
+	if(size <= bufferRemain)
+	{
+		m_bufferPosition += size;
+		return;
+	}
+	size -= bufferRemain;
+	m_bufferPosition = BUFFERSIZE;
+	uint32 skipQwords = size & ~0x0F;
+	m_nextAddress += skipQwords;
+	size -= skipQwords;
+	if(size != 0)
+	{
+		SyncBuffer();
+		m_bufferPosition += size;
+	}
+}
+
 void CVif::CFifoStream::SyncBuffer()
 {
 	assert(m_bufferPosition <= BUFFERSIZE);
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <array>
+#include <utility>
 #include "Types.h"
 #include "Convertible.h"
 #include "../uint128.h"
@@ -61,6 +63,8 @@ public:
 	void SetRegister(uint32, uint32);
 	virtual void SaveState(Framework::CZipArchiveWriter&);
 	virtual void LoadState(Framework::CZipArchiveReader&);
+	virtual void SaveRawState(Framework::CStream&);
+	virtual void LoadRawState(Framework::CStream&);
 
 	virtual uint32 GetTOP() const;
 	virtual uint32 GetITOP() const;
@@ -107,8 +111,10 @@ protected:
 		void SetDmaParams(uint32, uint32, bool);
 		void SetFifoParams(uint8*, uint32);
 
+		bool CanReadDirect() const;
 		uint8* GetDirectPointer() const;
 		void Advance(uint32);
+		void Skip(uint32);
 
 	private:
 		void SyncBuffer();
@@ -184,6 +190,22 @@ protected:
 		MASK_MASK = 3
 	};
 
+	enum UNPACK_CYCLE
+	{
+		UNPACK_CYCLE_CONTIGUOUS = 0, //CL == WL
+		UNPACK_CYCLE_SKIPPING = 1,   //CL > WL
+		UNPACK_CYCLE_FILLING = 2,    //CL < WL
+		UNPACK_CYCLE_COUNT = 3,
+	};
+
+	enum
+	{
+		UNPACK_FUNCTION_COUNT = 0x10 * 2 * 2 * 3 * UNPACK_CYCLE_COUNT,
+	};
+
+	typedef uint32 (CVif::*UnpackFunction)(StreamType&, uint32, uint32, uint32, uint32);
+	typedef std::array<UnpackFunction, UNPACK_FUNCTION_COUNT> UnpackFunctionTable;
+
 	void ProcessFifoWrite(uint32, uint32);
 
 	void ProcessPacket(StreamType&);
@@ -195,7 +217,15 @@ protected:
 	void Cmd_STCOL(StreamType&, CODE);
 	void Cmd_STMASK(StreamType&, CODE);
 
-	bool Unpack_ReadValue(const CODE&, StreamType&, uint128&, bool);
+	template <uint32, bool, bool, uint32, uint32>
+	uint32 Unpack(StreamType&, uint32, uint32, uint32, uint32);
+	template <uint32, bool>
+	uint32 Unpack_Direct(StreamType&, uint32&, uint32, uint32);
+	template <size_t... Indices>
+	static UnpackFunctionTable MakeUnpackFunctionTable(std::index_sequence<Indices...>);
+
+	template <uint32, bool>
+	bool Unpack_ReadValue(StreamType&, uint128&);
 	bool Unpack_S32(StreamType&, uint128&);
 	bool Unpack_S16(StreamType&, uint128&, bool);
 	bool Unpack_S8(StreamType&, uint128&, bool);
@@ -2,6 +2,7 @@
 #include <algorithm>
 #include "string_format.h"
 #include "../states/RegisterStateFile.h"
+#include "../states/RawState.h"
 #include "../FrameDump.h"
 #include "GIF.h"
 #include "Dmac_Channel.h"
@@ -58,6 +59,26 @@ void CVif1::LoadState(Framework::CZipArchiveReader& archive)
 	m_OFST = registerFile.GetRegister32(STATE_REGS_OFST);
 }
 
+void CVif1::SaveRawState(Framework::CStream& stream)
+{
+	CVif::SaveRawState(stream);
+
+	RawState::Write(stream, m_BASE);
+	RawState::Write(stream, m_TOP);
+	RawState::Write(stream, m_TOPS);
+	RawState::Write(stream, m_OFST);
+}
+
+void CVif1::LoadRawState(Framework::CStream& stream)
+{
+	CVif::LoadRawState(stream);
+
+	RawState::Read(stream, m_BASE);
+	RawState::Read(stream, m_TOP);
+	RawState::Read(stream, m_TOPS);
+	RawState::Read(stream, m_OFST);
+}
+
 uint32 CVif1::GetTOP() const
 {
 	return m_TOP;
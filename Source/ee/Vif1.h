@@ -14,6 +14,8 @@ public:
 	void Reset() override;
 	void SaveState(Framework::CZipArchiveWriter&) override;
 	void LoadState(Framework::CZipArchiveReader&) override;
+	void SaveRawState(Framework::CStream&) override;
+	void LoadRawState(Framework::CStream&) override;
 
 	uint32 GetTOP() const override;
 
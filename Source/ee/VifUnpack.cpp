@@ -0,0 +1,214 @@
+#include "VifUnpack.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define VIFUNPACK_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define VIFUNPACK_NEON
+#include <arm_neon.h>
+#endif
+
+using namespace VifUnpack;
+
+#if defined(VIFUNPACK_SSE2)
+
+void VifUnpack::UnpackV4_32(uint128* dst, const uint8* src, uint32 count)
+{
+	for(uint32 i = 0; i < count; i++)
+	{
+		__m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + (i * 0x10)));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), value);
+	}
+}
+
+void VifUnpack::UnpackV3_32(uint128* dst, const uint8* src, uint32 count)
+{
+	if(count == 0) return;
+	//16 bytes are loaded for every element, the last one is done separately to avoid reading past the source
+	const __m128i xyzMask = _mm_set_epi32(0, -1, -1, -1);
+	for(uint32 i = 0; i < (count - 1); i++)
+	{
+		__m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + (i * 12)));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_and_si128(value, xyzMask));
+	}
+	DecodeElement<FORMAT_V3_32, false>(dst[count - 1], src + ((count - 1) * 12));
+}
+
+void VifUnpack::UnpackV2_16(uint128* dst, const uint8* src, uint32 count, bool zeroExtend)
+{
+	//4 elements per iteration
+	const __m128i zero = _mm_setzero_si128();
+	uint32 i = 0;
+	for(; (i + 4) <= count; i += 4)
+	{
+		__m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + (i * 4)));
+		__m128i lo = zeroExtend ? _mm_unpacklo_epi16(value, zero) : _mm_srai_epi32(_mm_unpacklo_epi16(zero, value), 16);
+		__m128i hi = zeroExtend ? _mm_unpackhi_epi16(value, zero) : _mm_srai_epi32(_mm_unpackhi_epi16(zero, value), 16);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 0), _mm_unpacklo_epi64(lo, zero));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 1), _mm_unpackhi_epi64(lo, zero));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 2), _mm_unpacklo_epi64(hi, zero));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 3), _mm_unpackhi_epi64(hi, zero));
+	}
+	for(; i < count; i++)
+	{
+		if(zeroExtend)
+			DecodeElement<FORMAT_V2_16, true>(dst[i], src + (i * 4));
+		else
+			DecodeElement<FORMAT_V2_16, false>(dst[i], src + (i * 4));
+	}
+}
+
+void VifUnpack::UnpackV4_8(uint128* dst, const uint8* src, uint32 count, bool zeroExtend)
+{
+	//4 elements per iteration
+	const __m128i zero = _mm_setzero_si128();
+	uint32 i = 0;
+	for(; (i + 4) <= count; i += 4)
+	{
+		__m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + (i * 4)));
+		__m128i lo16 = zeroExtend ? _mm_unpacklo_epi8(value, zero) : _mm_srai_epi16(_mm_unpacklo_epi8(zero, value), 8);
+		__m128i hi16 = zeroExtend ? _mm_unpackhi_epi8(value, zero) : _mm_srai_epi16(_mm_unpackhi_epi8(zero, value), 8);
+		__m128i element0 = zeroExtend ? _mm_unpacklo_epi16(lo16, zero) : _mm_srai_epi32(_mm_unpacklo_epi16(zero, lo16), 16);
+		__m128i element1 = zeroExtend ? _mm_unpackhi_epi16(lo16, zero) : _mm_srai_epi32(_mm_unpackhi_epi16(zero, lo16), 16);
+		__m128i element2 = zeroExtend ? _mm_unpacklo_epi16(hi16, zero) : _mm_srai_epi32(_mm_unpacklo_epi16(zero, hi16), 16);
+		__m128i element3 = zeroExtend ? _mm_unpackhi_epi16(hi16, zero) : _mm_srai_epi32(_mm_unpackhi_epi16(zero, hi16), 16);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 0), element0);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 1), element1);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 2), element2);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 3), element3);
+	}
+	for(; i < count; i++)
+	{
+		if(zeroExtend)
+			DecodeElement<FORMAT_V4_8, true>(dst[i], src + (i * 4));
+		else
+			DecodeElement<FORMAT_V4_8, false>(dst[i], src + (i * 4));
+	}
+}
+
+#elif defined(VIFUNPACK_NEON)
+
+void VifUnpack::UnpackV4_32(uint128* dst, const uint8* src, uint32 count)
+{
+	for(uint32 i = 0; i < count; i++)
+	{
+		vst1q_u8(reinterpret_cast<uint8*>(dst + i), vld1q_u8(src + (i * 0x10)));
+	}
+}
+
+void VifUnpack::UnpackV3_32(uint128* dst, const uint8* src, uint32 count)
+{
+	if(count == 0) return;
+	//16 bytes are loaded for every element, the last one is done separately to avoid reading past the source
+	const uint32 xyzMaskValues[4] = {~0U, ~0U, ~0U, 0};
+	const uint32x4_t xyzMask = vld1q_u32(xyzMaskValues);
+	for(uint32 i = 0; i < (count - 1); i++)
+	{
+		uint32x4_t value = vreinterpretq_u32_u8(vld1q_u8(src + (i * 12)));
+		vst1q_u32(reinterpret_cast<uint32*>(dst + i), vandq_u32(value, xyzMask));
+	}
+	DecodeElement<FORMAT_V3_32, false>(dst[count - 1], src + ((count - 1) * 12));
+}
+
+void VifUnpack::UnpackV2_16(uint128* dst, const uint8* src, uint32 count, bool zeroExtend)
+{
+	//4 elements per iteration
+	const uint32x2_t zero = vdup_n_u32(0);
+	uint32 i = 0;
+	for(; (i + 4) <= count; i += 4)
+	{
+		uint16x8_t value = vreinterpretq_u16_u8(vld1q_u8(src + (i * 4)));
+		uint32x4_t lo = zeroExtend ? vmovl_u16(vget_low_u16(value)) : vreinterpretq_u32_s32(vmovl_s16(vreinterpret_s16_u16(vget_low_u16(value))));
+		uint32x4_t hi = zeroExtend ? vmovl_u16(vget_high_u16(value)) : vreinterpretq_u32_s32(vmovl_s16(vreinterpret_s16_u16(vget_high_u16(value))));
+		vst1q_u32(reinterpret_cast<uint32*>(dst + i + 0), vcombine_u32(vget_low_u32(lo), zero));
+		vst1q_u32(reinterpret_cast<uint32*>(dst + i + 1), vcombine_u32(vget_high_u32(lo), zero));
+		vst1q_u32(reinterpret_cast<uint32*>(dst + i + 2), vcombine_u32(vget_low_u32(hi), zero));
+		vst1q_u32(reinterpret_cast<uint32*>(dst + i + 3), vcombine_u32(vget_high_u32(hi), zero));
+	}
+	for(; i < count; i++)
+	{
+		if(zeroExtend)
+			DecodeElement<FORMAT_V2_16, true>(dst[i], src + (i * 4));
+		else
+			DecodeElement<FORMAT_V2_16, false>(dst[i], src + (i * 4));
+	}
+}
+
+void VifUnpack::UnpackV4_8(uint128* dst, const uint8* src, uint32 count, bool zeroExtend)
+{
+	//4 elements per iteration
+	uint32 i = 0;
+	for(; (i + 4) <= count; i += 4)
+	{
+		uint8x16_t value = vld1q_u8(src + (i * 4));
+		uint32x4_t elements[4];
+		if(zeroExtend)
+		{
+			uint16x8_t lo16 = vmovl_u8(vget_low_u8(value));
+			uint16x8_t hi16 = vmovl_u8(vget_high_u8(value));
+			elements[0] = vmovl_u16(vget_low_u16(lo16));
+			elements[1] = vmovl_u16(vget_high_u16(lo16));
+			elements[2] = vmovl_u16(vget_low_u16(hi16));
+			elements[3] = vmovl_u16(vget_high_u16(hi16));
+		}
+		else
+		{
+			int16x8_t lo16 = vmovl_s8(vget_low_s8(vreinterpretq_s8_u8(value)));
+			int16x8_t hi16 = vmovl_s8(vget_high_s8(vreinterpretq_s8_u8(value)));
+			elements[0] = vreinterpretq_u32_s32(vmovl_s16(vget_low_s16(lo16)));
+			elements[1] = vreinterpretq_u32_s32(vmovl_s16(vget_high_s16(lo16)));
+			elements[2] = vreinterpretq_u32_s32(vmovl_s16(vget_low_s16(hi16)));
+			elements[3] = vreinterpretq_u32_s32(vmovl_s16(vget_high_s16(hi16)));
+		}
+		for(unsigned int j = 0; j < 4; j++)
+		{
+			vst1q_u32(reinterpret_cast<uint32*>(dst + i + j), elements[j]);
+		}
+	}
+	for(; i < count; i++)
+	{
+		if(zeroExtend)
+			DecodeElement<FORMAT_V4_8, true>(dst[i], src + (i * 4));
+		else
+			DecodeElement<FORMAT_V4_8, false>(dst[i], src + (i * 4));
+	}
+}
+
+#else
+
+void VifUnpack::UnpackV4_32(uint128* dst, const uint8* src, uint32 count)
+{
+	memcpy(dst, src, count * 0x10);
+}
+
+void VifUnpack::UnpackV3_32(uint128* dst, const uint8* src, uint32 count)
+{
+	for(uint32 i = 0; i < count; i++)
+	{
+		DecodeElement<FORMAT_V3_32, false>(dst[i], src + (i * 12));
+	}
+}
+
+void VifUnpack::UnpackV2_16(uint128* dst, const uint8* src, uint32 count, bool zeroExtend)
+{
+	for(uint32 i = 0; i < count; i++)
+	{
+		if(zeroExtend)
+			DecodeElement<FORMAT_V2_16, true>(dst[i], src + (i * 4));
+		else
+			DecodeElement<FORMAT_V2_16, false>(dst[i], src + (i * 4));
+	}
+}
+
+void VifUnpack::UnpackV4_8(uint128* dst, const uint8* src, uint32 count, bool zeroExtend)
+{
+	for(uint32 i = 0; i < count; i++)
+	{
+		if(zeroExtend)
+			DecodeElement<FORMAT_V4_8, true>(dst[i], src + (i * 4));
+		else
+			DecodeElement<FORMAT_V4_8, false>(dst[i], src + (i * 4));
+	}
+}
+
+#endif
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstring>
+#include "Types.h"
+#include "../uint128.h"
+
+//Direct (memory to memory) UNPACK kernels, used by CVif when no mask is set,
+//addition mode is normal and CL == WL, which means elements are written contiguously.
+namespace VifUnpack
+{
+	enum FORMAT
+	{
+		FORMAT_S32 = 0x00,
+		FORMAT_S16 = 0x01,
+		FORMAT_S8 = 0x02,
+		FORMAT_V2_32 = 0x04,
+		FORMAT_V2_16 = 0x05,
+		FORMAT_V2_8 = 0x06,
+		FORMAT_V3_32 = 0x08,
+		FORMAT_V3_16 = 0x09,
+		FORMAT_V3_8 = 0x0A,
+		FORMAT_V4_32 = 0x0C,
+		FORMAT_V4_16 = 0x0D,
+		FORMAT_V4_8 = 0x0E,
+		FORMAT_V4_5 = 0x0F,
+	};
+
+	//Size of one source element in bytes, 0 if format is invalid
+	constexpr uint32 GetElementSize(uint32 format)
+	{
+		return (format == FORMAT_V4_5) ? 2 : (((format & 3) == 3) ? 0 : ((format >> 2) + 1) * (4 >> (format & 3)));
+	}
+
+	void UnpackV4_32(uint128*, const uint8*, uint32);
+	void UnpackV3_32(uint128*, const uint8*, uint32);
+	void UnpackV2_16(uint128*, const uint8*, uint32, bool);
+	void UnpackV4_8(uint128*, const uint8*, uint32, bool);
+
+	template <uint32 format, bool zeroExtend>
+	uint32 ReadComponent(const uint8* src, unsigned int index)
+	{
+		if((format & 3) == 0)
+		{
+			uint32 value = 0;
+			memcpy(&value, src + (index * 4), 4);
+			return value;
+		}
+		else if((format & 3) == 1)
+		{
+			uint16 value = 0;
+			memcpy(&value, src + (index * 2), 2);
+			return zeroExtend ? value : static_cast<int16>(value);
+		}
+		else
+		{
+			uint8 value = src[index];
+			return zeroExtend ? value : static_cast<int8>(value);
+		}
+	}
+
+	//Same results as the stream based readers in CVif
+	template <uint32 format, bool zeroExtend>
+	void DecodeElement(uint128& result, const uint8* src)
+	{
+		if(format == FORMAT_V4_5)
+		{
+			uint16 color = 0;
+			memcpy(&color, src, 2);
+			result.nV0 = ((color >> 0) & 0x1F) << 3;
+			result.nV1 = ((color >> 5) & 0x1F) << 3;
+			result.nV2 = ((color >> 10) & 0x1F) << 3;
+			result.nV3 = ((color >> 15) & 0x01) << 7;
+		}
+		else if((format >> 2) == 0)
+		{
+			uint32 value = ReadComponent<format, zeroExtend>(src, 0);
+			result.nV0 = result.nV1 = result.nV2 = result.nV3 = value;
+		}
+		else
+		{
+			unsigned int fieldCount = (format >> 2) + 1;
+			for(unsigned int i = 0; i < 4; i++)
+			{
+				result.nV[i] = (i < fieldCount) ? ReadComponent<format, zeroExtend>(src, i) : 0;
+			}
+		}
+	}
+
+	template <uint32 format, bool zeroExtend>
+	struct CKernel
+	{
+		static void Unpack(uint128* dst, const uint8* src, uint32 count)
+		{
+			for(uint32 i = 0; i < count; i++)
+			{
+				DecodeElement<format, zeroExtend>(dst[i], src + (i * GetElementSize(format)));
+			}
+		}
+	};
+
+	template <bool zeroExtend>
+	struct CKernel<FORMAT_V4_32, zeroExtend>
+	{
+		static void Unpack(uint128* dst, const uint8* src, uint32 count)
+		{
+			UnpackV4_32(dst, src, count);
+		}
+	};
+
+	template <bool zeroExtend>
+	struct CKernel<FORMAT_V3_32, zeroExtend>
+	{
+		static void Unpack(uint128* dst, const uint8* src, uint32 count)
+		{
+			UnpackV3_32(dst, src, count);
+		}
+	};
+
+	template <bool zeroExtend>
+	struct CKernel<FORMAT_V2_16, zeroExtend>
+	{
+		static void Unpack(uint128* dst, const uint8* src, uint32 count)
+		{
+			UnpackV2_16(dst, src, count, zeroExtend);
+		}
+	};
+
+	template <bool zeroExtend>
+	struct CKernel<FORMAT_V4_8, zeroExtend>
+	{
+		static void Unpack(uint128* dst, const uint8* src, uint32 count)
+		{
+			UnpackV4_8(dst, src, count, zeroExtend);
+		}
+	};
+}
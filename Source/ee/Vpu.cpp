@@ -1,4 +1,6 @@
+#include <fenv.h>
 #include "make_unique.h"
+#include "../FpUtils.h"
 #include "../Log.h"
 #include "../states/RegisterStateFile.h"
 #include "../Ps2Const.h"
@@ -30,6 +32,7 @@ CVpu::CVpu(unsigned int number, const VPUINIT& vpuInit, CGIF& gif, CINTC& intc,
 
 CVpu::~CVpu()
 {
+	StopExecutionThread();
 #ifdef DEBUGGER_INCLUDED
 	delete[] m_microMemMiniState;
 	delete[] m_vuMemMiniState;
@@ -40,6 +43,23 @@ void CVpu::Execute(int32 quota)
 {
 	if(!m_running) return;
 
+	if(m_executionThread.joinable())
+	{
+		FlushXgKickPackets();
+		{
+			std::unique_lock<std::mutex> executionLock(m_executionMutex);
+			if(m_executionActive)
+			{
+				m_executionGrantedCycles += quota;
+				m_executionCondition.notify_one();
+				WaitForExecutionThread(executionLock, [this]() { return !m_executionActive || (m_executionGrantedCycles <= MAX_EXECUTION_SKEW_CYCLES); });
+				if(m_executionActive) return;
+			}
+		}
+		CompleteThreadedExecution();
+		return;
+	}
+
 #ifdef PROFILE
 	CProfilerZone profilerZone(m_vuProfilerZone);
 #endif
@@ -93,6 +113,14 @@ uint32 CVpu::GetVuItopMiniState() const
 
 void CVpu::Reset()
 {
+	WaitForIdle();
+	if(m_executionThread.joinable())
+	{
+		//Drop whatever is left of the current microprogram
+		std::lock_guard<std::mutex> executionLock(m_executionMutex);
+		m_executionActive = false;
+		m_executionGrantedCycles = 0;
+	}
 	m_running = false;
 	m_ctx->m_executor->Reset();
 	m_vif->Reset();
@@ -100,14 +128,28 @@ void CVpu::Reset()
 
 void CVpu::SaveState(Framework::CZipArchiveWriter& archive)
 {
+	WaitForIdle();
 	m_vif->SaveState(archive);
 }
 
 void CVpu::LoadState(Framework::CZipArchiveReader& archive)
 {
+	WaitForIdle();
 	m_vif->LoadState(archive);
 }
 
+void CVpu::SaveRawState(Framework::CStream& stream)
+{
+	WaitForIdle();
+	m_vif->SaveRawState(stream);
+}
+
+void CVpu::LoadRawState(Framework::CStream& stream)
+{
+	WaitForIdle();
+	m_vif->LoadRawState(stream);
+}
+
 CMIPS& CVpu::GetContext() const
 {
 	return *m_ctx;
@@ -153,21 +195,33 @@ void CVpu::ExecuteMicroProgram(uint32 nAddress)
 	assert(!m_running);
 	m_running = true;
 	VuStateChanged(m_running);
-	for(unsigned int i = 0; i < 100; i++)
+	if(m_executionThread.joinable())
+	{
+		std::lock_guard<std::mutex> executionLock(m_executionMutex);
+		m_executionActive = true;
+		m_executionGrantedCycles = EXECUTION_START_CYCLES;
+		m_executionCondition.notify_one();
+		return;
+	}
+	for(unsigned int i = 0; i < (EXECUTION_START_CYCLES / EXECUTION_SLICE_CYCLES); i++)
 	{
-		Execute(5000);
+		Execute(EXECUTION_SLICE_CYCLES);
 		if(!m_running) break;
 	}
 }
 
 void CVpu::InvalidateMicroProgram()
 {
+	WaitForIdle();
 	m_ctx->m_executor->ClearActiveBlocksInRange(0, (m_number == 0) ? PS2::MICROMEM0SIZE : PS2::MICROMEM1SIZE, false);
 }
 
 void CVpu::InvalidateMicroProgram(uint32 start, uint32 end)
 {
-	m_ctx->m_executor->ClearActiveBlocksInRange(start, end, false);
+	WaitForIdle();
+	//Blocks are checked before the next microprogram execution, so that
+	//blocks whose code didn't change are kept
+	m_ctx->m_executor->NotifyCodeWrite(start, end);
 }
 
 void CVpu::ProcessXgKick(uint32 address)
@@ -188,9 +242,218 @@ void CVpu::ProcessXgKick(uint32 address)
 	memcpy(metadata.microMem1, GetMicroMemoryMiniState(), PS2::MICROMEM1SIZE);
 #endif
 
-	m_gif.ProcessSinglePacket(GetVuMemory(), PS2::VUMEM1SIZE, address, PS2::VUMEM1SIZE, metadata);
+	uint32 packetSize = GetXgKickPacketSize(GetVuMemory(), address);
+	if(std::this_thread::get_id() == m_executionThread.get_id())
+	{
+		//GIF and GS are owned by the emulation thread, send a copy of the packet there
+		auto packet = std::make_unique<XGKICK_PACKET>();
+		CopyXgKickPacket(GetVuMemory(), address, packetSize, packet->data);
+		packet->metadata = std::make_unique<CGsPacketMetadata>(metadata);
+		while(!m_xgKickPackets.TryPush(std::move(packet)))
+		{
+			//Queue is full, wait for the emulation thread to empty it
+			std::unique_lock<std::mutex> executionLock(m_executionMutex);
+			if(!m_executionThreadRunning) return;
+			m_xgKickProducerWaiting = true;
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if(m_xgKickPackets.TryPush(std::move(packet)))
+			{
+				m_xgKickProducerWaiting = false;
+				break;
+			}
+			m_executionIdleCondition.notify_all();
+			m_executionCondition.wait(executionLock, [this]() { return !m_xgKickProducerWaiting || !m_executionThreadRunning; });
+		}
+	}
+	else if((address + packetSize) > PS2::VUMEM1SIZE)
+	{
+		std::vector<uint8> data;
+		CopyXgKickPacket(GetVuMemory(), address, packetSize, data);
+		m_gif.ProcessSinglePacket(data.data(), packetSize, 0, packetSize, metadata);
+	}
+	else
+	{
+		m_gif.ProcessSinglePacket(GetVuMemory(), PS2::VUMEM1SIZE, address, PS2::VUMEM1SIZE, metadata);
+	}
 
 #ifdef DEBUGGER_INCLUDED
 	SaveMiniState();
 #endif
 }
+
+void CVpu::SetExecutionThreadEnabled(bool enabled)
+{
+	if(enabled == m_executionThread.joinable()) return;
+	if(enabled)
+	{
+		StartExecutionThread();
+	}
+	else
+	{
+		WaitForIdle();
+		StopExecutionThread();
+	}
+}
+
+bool CVpu::IsExecutionThreadEnabled() const
+{
+	return m_executionThread.joinable();
+}
+
+void CVpu::WaitForIdle()
+{
+	if(!m_running) return;
+	if(!m_executionThread.joinable()) return;
+	//Microprogram is accessing its own state (ie.: through VU1 I/O ports)
+	if(std::this_thread::get_id() == m_executionThread.get_id()) return;
+	{
+		std::unique_lock<std::mutex> executionLock(m_executionMutex);
+		WaitForExecutionThread(executionLock, [this]() { return !m_executionActive || (m_executionGrantedCycles <= 0); });
+		if(m_executionActive)
+		{
+			executionLock.unlock();
+			FlushXgKickPackets();
+			return;
+		}
+	}
+	CompleteThreadedExecution();
+}
+
+void CVpu::StartExecutionThread()
+{
+	assert(!m_running);
+	m_executionThreadRunning = true;
+	m_executionActive = false;
+	m_executionGrantedCycles = 0;
+	m_executionThread = std::thread([this]() { ExecutionThreadProc(); });
+}
+
+void CVpu::StopExecutionThread()
+{
+	if(!m_executionThread.joinable()) return;
+	{
+		std::lock_guard<std::mutex> executionLock(m_executionMutex);
+		m_executionThreadRunning = false;
+		m_executionCondition.notify_one();
+	}
+	m_executionThread.join();
+	m_executionThread = std::thread();
+	XgKickPacketPtr packet;
+	while(m_xgKickPackets.TryPop(packet))
+	{
+	}
+	//A microprogram that didn't reach its end keeps running inline
+	m_executionActive = false;
+	m_executionGrantedCycles = 0;
+	m_xgKickProducerWaiting = false;
+}
+
+void CVpu::ExecutionThreadProc()
+{
+	//VU arithmetic relies on the same rounding and denormal modes as the emulation thread
+	fesetround(FE_TOWARDZERO);
+	FpUtils::SetDenormalHandlingMode();
+	std::unique_lock<std::mutex> executionLock(m_executionMutex);
+	while(1)
+	{
+		m_executionCondition.wait(executionLock, [this]() { return !m_executionThreadRunning || (m_executionActive && (m_executionGrantedCycles > 0)); });
+		if(!m_executionThreadRunning) break;
+		int32 quota = std::min<int32>(m_executionGrantedCycles, EXECUTION_SLICE_CYCLES);
+		executionLock.unlock();
+
+		int32 executed = quota - m_ctx->m_executor->Execute(quota);
+		//E bit encountered
+		bool ended = (m_ctx->m_State.nHasException != 0);
+
+		executionLock.lock();
+		m_executionGrantedCycles -= executed;
+		if(ended)
+		{
+			m_executionActive = false;
+		}
+		m_executionIdleCondition.notify_all();
+	}
+}
+
+//Waits on the execution thread while forwarding packets it sends, it might not be able to
+//make progress otherwise
+template <typename Predicate>
+void CVpu::WaitForExecutionThread(std::unique_lock<std::mutex>& executionLock, Predicate predicate)
+{
+	while(!predicate())
+	{
+		if(m_xgKickProducerWaiting)
+		{
+			executionLock.unlock();
+			FlushXgKickPackets();
+			executionLock.lock();
+			continue;
+		}
+		m_executionIdleCondition.wait(executionLock, [&]() { return predicate() || m_xgKickProducerWaiting; });
+	}
+}
+
+void CVpu::FlushXgKickPackets()
+{
+	while(auto packet = m_xgKickPackets.Peek())
+	{
+		const auto& data = (*packet)->data;
+		uint32 packetSize = static_cast<uint32>(data.size());
+		m_gif.ProcessSinglePacket(data.data(), packetSize, 0, packetSize, *(*packet)->metadata);
+		m_xgKickPackets.Pop();
+	}
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if(m_xgKickProducerWaiting)
+	{
+		std::lock_guard<std::mutex> executionLock(m_executionMutex);
+		m_xgKickProducerWaiting = false;
+		m_executionCondition.notify_one();
+	}
+}
+
+void CVpu::CompleteThreadedExecution()
+{
+	FlushXgKickPackets();
+	m_running = false;
+	VuStateChanged(m_running);
+}
+
+uint32 CVpu::GetXgKickPacketSize(const uint8* vuMem, uint32 address)
+{
+	assert((address & 0x0F) == 0);
+	//Stop after going through the whole memory once if no tag ends the packet
+	uint32 current = 0;
+	while(current < PS2::VUMEM1SIZE)
+	{
+		auto tag = *reinterpret_cast<const CGIF::TAG*>(vuMem + ((address + current) & (PS2::VUMEM1SIZE - 1)));
+		current += 0x10;
+		uint32 regCount = (tag.nreg == 0) ? 0x10 : tag.nreg;
+		switch(tag.cmd)
+		{
+		case 0x00:
+			//PACKED
+			current += tag.loops * regCount * 0x10;
+			break;
+		case 0x01:
+			//REGLIST
+			current += ((tag.loops * regCount * 0x08) + 0x0F) & ~0x0F;
+			break;
+		default:
+			//IMAGE
+			current += tag.loops * 0x10;
+			break;
+		}
+		if(tag.eop) break;
+	}
+	return std::min<uint32>(current, PS2::VUMEM1SIZE);
+}
+
+void CVpu::CopyXgKickPacket(const uint8* vuMem, uint32 address, uint32 size, std::vector<uint8>& data)
+{
+	assert(address < PS2::VUMEM1SIZE);
+	assert(size <= PS2::VUMEM1SIZE);
+	uint32 firstPartSize = std::min<uint32>(size, PS2::VUMEM1SIZE - address);
+	data.resize(size);
+	memcpy(data.data(), vuMem + address, firstPartSize);
+	memcpy(data.data() + firstPartSize, vuMem, size - firstPartSize);
+}
@@ -1,8 +1,14 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
 #include "Types.h"
 #include "../MIPS.h"
 #include "../Profiler.h"
+#include "../SpscRingBuffer.h"
 #include "Convertible.h"
 #include "zip/ZipArchiveWriter.h"
 #include "zip/ZipArchiveReader.h"
@@ -10,6 +16,7 @@
 class CVif;
 class CGIF;
 class CINTC;
+class CGsPacketMetadata;
 
 class CVpu
 {
@@ -45,6 +52,8 @@ public:
 	void Reset();
 	void SaveState(Framework::CZipArchiveWriter&);
 	void LoadState(Framework::CZipArchiveReader&);
+	void SaveRawState(Framework::CStream&);
+	void LoadRawState(Framework::CStream&);
 
 	CMIPS& GetContext() const;
 	uint8* GetMicroMemory() const;
@@ -60,6 +69,21 @@ public:
 
 	void ProcessXgKick(uint32);
 
+	//XGKICK packets wrap around the end of VU1 memory
+	static uint32 GetXgKickPacketSize(const uint8*, uint32);
+	static void CopyXgKickPacket(const uint8*, uint32, uint32, std::vector<uint8>&);
+
+	//When enabled, microprograms run on their own thread and XGKICK packets are
+	//forwarded to the GIF from the thread calling Execute. The thread only runs the
+	//cycles it was given by ExecuteMicroProgram and Execute.
+	void SetExecutionThreadEnabled(bool);
+	bool IsExecutionThreadEnabled() const;
+
+	//Waits until the execution thread has run all the cycles it was given. VU state
+	//and memory can be accessed safely until Execute is called again. Does nothing when
+	//called from the execution thread itself.
+	void WaitForIdle();
+
 #ifdef DEBUGGER_INCLUDED
 	void SaveMiniState();
 	const MIPSSTATE& GetVuMiniState() const;
@@ -74,6 +98,31 @@ public:
 protected:
 	typedef std::unique_ptr<CVif> VifPtr;
 
+	enum
+	{
+		MAX_PENDING_XGKICK_PACKETS = 256,
+		EXECUTION_SLICE_CYCLES = 5000,
+		//Same amount of cycles is run right away when a microprogram is started inline
+		EXECUTION_START_CYCLES = EXECUTION_SLICE_CYCLES * 100,
+		//Execute blocks when the execution thread is this far behind
+		MAX_EXECUTION_SKEW_CYCLES = EXECUTION_START_CYCLES,
+	};
+
+	struct XGKICK_PACKET
+	{
+		std::vector<uint8> data;
+		std::unique_ptr<CGsPacketMetadata> metadata;
+	};
+	typedef std::unique_ptr<XGKICK_PACKET> XgKickPacketPtr;
+
+	void StartExecutionThread();
+	void StopExecutionThread();
+	void ExecutionThreadProc();
+	template <typename Predicate>
+	void WaitForExecutionThread(std::unique_lock<std::mutex>&, Predicate);
+	void FlushXgKickPackets();
+	void CompleteThreadedExecution();
+
 	uint8* m_microMem = nullptr;
 	uint8* m_vuMem = nullptr;
 	uint32 m_vuMemSize = 0;
@@ -92,5 +141,17 @@ protected:
 	unsigned int m_number = 0;
 	bool m_running = false;
 
+	//m_executionCondition wakes the execution thread, m_executionIdleCondition wakes threads
+	//waiting on it. The microprogram is active until the execution thread reaches its end.
+	std::thread m_executionThread;
+	std::mutex m_executionMutex;
+	std::condition_variable m_executionCondition;
+	std::condition_variable m_executionIdleCondition;
+	bool m_executionThreadRunning = false;
+	bool m_executionActive = false;
+	int32 m_executionGrantedCycles = 0;
+	std::atomic<bool> m_xgKickProducerWaiting = {false};
+	CSpscRingBuffer<XgKickPacketPtr, MAX_PENDING_XGKICK_PACKETS> m_xgKickPackets;
+
 	CProfiler::ZoneHandle m_vuProfilerZone = 0;
 };
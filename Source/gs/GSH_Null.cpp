@@ -36,6 +36,11 @@ void CGSH_Null::ReadFramebuffer(uint32, uint32, void*)
 {
 }
 
+CDirtyPageTracker* CGSH_Null::GetRamTracker()
+{
+	return &m_ramTracker;
+}
+
 CGSHandler::FactoryFunction CGSH_Null::GetFactoryFunction()
 {
 	return std::bind(&CGSH_Null::GSHandlerFactory);
@@ -14,6 +14,8 @@ public:
 	virtual void ProcessClutTransfer(uint32, uint32) override;
 	virtual void ReadFramebuffer(uint32, uint32, void*) override;
 
+	virtual CDirtyPageTracker* GetRamTracker() override;
+
 	static FactoryFunction GetFactoryFunction();
 
 private:
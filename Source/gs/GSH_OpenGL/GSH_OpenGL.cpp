@@ -246,6 +246,16 @@ void CGSH_OpenGL::LoadState(Framework::CZipArchiveReader& archive)
 	    });
 }
 
+void CGSH_OpenGL::LoadDeviceState(Framework::CStream& stream)
+{
+	//RAM was restored separately
+	CGSHandler::LoadDeviceState(stream);
+	SendGSCall(
+	    [this]() {
+		    m_textureCache.InvalidateRange(0, RAMSIZE);
+	    });
+}
+
 void CGSH_OpenGL::RegisterPreferences()
 {
 	CGSHandler::RegisterPreferences();
@@ -2038,6 +2048,7 @@ void CGSH_OpenGL::ProcessLocalToHostTransfer()
 
 	//Write back to RAM
 	{
+		MarkRamDirty(bltBuf.GetSrcPtr(), bltBuf.nSrcWidth, PSMCT32, trxPos.nSSAX, trxPos.nSSAY, trxReg.nRRW, trxReg.nRRH);
 		CGsPixelFormats::CPixelIndexorPSMCT32 indexor(m_pRAM, bltBuf.GetSrcPtr(), bltBuf.nSrcWidth);
 		for(uint32 y = trxPos.nSSAY; y < (trxPos.nSSAY + trxReg.nRRH); y++)
 		{
@@ -2110,6 +2121,7 @@ void CGSH_OpenGL::ProcessLocalToLocalTransfer()
 
 		//Write back to RAM
 		{
+			MarkRamDirty(bltBuf.GetDstPtr(), bltBuf.nDstWidth, PSMCT32, trxPos.nDSAX, trxPos.nDSAY, trxReg.nRRW, trxReg.nRRH);
 			CGsPixelFormats::CPixelIndexorPSMCT32 indexor(m_pRAM, bltBuf.GetDstPtr(), bltBuf.nDstWidth);
 			for(uint32 y = 0; y < trxReg.nRRH; y++)
 			{
@@ -2146,6 +2158,11 @@ void CGSH_OpenGL::ReadFramebuffer(uint32 width, uint32 height, void* buffer)
 #endif
 }
 
+CDirtyPageTracker* CGSH_OpenGL::GetRamTracker()
+{
+	return &m_ramTracker;
+}
+
 Framework::CBitmap CGSH_OpenGL::GetScreenshot()
 {
 	auto dispInfo = GetCurrentDisplayInfo();
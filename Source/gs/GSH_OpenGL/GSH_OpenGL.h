@@ -28,6 +28,7 @@ public:
 	static void RegisterPreferences();
 
 	void LoadState(Framework::CZipArchiveReader&) override;
+	void LoadDeviceState(Framework::CStream&) override;
 
 	void ProcessHostToLocalTransfer() override;
 	void ProcessLocalToHostTransfer() override;
@@ -35,6 +36,9 @@ public:
 	void ProcessClutTransfer(uint32, uint32) override;
 	void ReadFramebuffer(uint32, uint32, void*) override;
 
+	//Rendering stays on the host GPU, RAM only changes through transfers
+	CDirtyPageTracker* GetRamTracker() override;
+
 	Framework::CBitmap GetScreenshot() override;
 
 protected:
@@ -0,0 +1,724 @@
+#include <algorithm>
+#include <cstring>
+#include "GSH_Software.h"
+#include "../GsPixelFormats.h"
+
+using namespace GSH_Software;
+
+CGSH_Software::CGSH_Software()
+    : m_nextTileIndex(0)
+{
+	memset(&m_vtxBuffer, 0, sizeof(m_vtxBuffer));
+}
+
+CGSHandler::FactoryFunction CGSH_Software::GetFactoryFunction()
+{
+	return std::bind(&CGSH_Software::GSHandlerFactory);
+}
+
+CGSHandler* CGSH_Software::GSHandlerFactory()
+{
+	return new CGSH_Software();
+}
+
+void CGSH_Software::InitializeImpl()
+{
+	CRasterizer::InitializeTables();
+
+	m_tileBins.resize(TILE_GRID_SIZE * TILE_GRID_SIZE);
+
+	//The GS thread also processes tiles while waiting for the workers
+	uint32 threadCount = std::max<uint32>(std::thread::hardware_concurrency(), 1);
+	uint32 workerCount = std::min<uint32>(threadCount - 1, MAX_WORKER_COUNT);
+	m_workersDone = false;
+	for(uint32 i = 0; i < workerCount; i++)
+	{
+		m_workers.emplace_back(&CGSH_Software::WorkerThreadProc, this);
+	}
+}
+
+void CGSH_Software::ReleaseImpl()
+{
+	DiscardPrimitives();
+	{
+		std::lock_guard<std::mutex> workerLock(m_workerMutex);
+		m_workersDone = true;
+	}
+	m_workerCondition.notify_all();
+	for(auto& worker : m_workers)
+	{
+		worker.join();
+	}
+	m_workers.clear();
+}
+
+void CGSH_Software::ResetImpl()
+{
+	DiscardPrimitives();
+	m_vtxCount = 0;
+	m_primitiveType = PRIM_INVALID;
+}
+
+void CGSH_Software::SaveState(Framework::CZipArchiveWriter& archive)
+{
+	SendGSCall([this]() { FlushPrimitives(); }, true, true);
+	CGSHandler::SaveState(archive);
+}
+
+void CGSH_Software::LoadState(Framework::CZipArchiveReader& archive)
+{
+	SendGSCall([this]() { DiscardPrimitives(); }, true, true);
+	CGSHandler::LoadState(archive);
+}
+
+void CGSH_Software::SaveDeviceState(Framework::CStream& stream)
+{
+	SendGSCall([this]() { FlushPrimitives(); }, true, true);
+	CGSHandler::SaveDeviceState(stream);
+}
+
+void CGSH_Software::LoadDeviceState(Framework::CStream& stream)
+{
+	SendGSCall([this]() { DiscardPrimitives(); }, true, true);
+	CGSHandler::LoadDeviceState(stream);
+}
+
+void CGSH_Software::MarkNewFrame()
+{
+	FlushPrimitives();
+	CGSHandler::MarkNewFrame();
+}
+
+void CGSH_Software::FlipImpl()
+{
+	FlushPrimitives();
+	CGSHandler::FlipImpl();
+}
+
+void CGSH_Software::WriteRegisterImpl(uint8 registerId, uint64 data)
+{
+	CGSHandler::WriteRegisterImpl(registerId, data);
+
+	switch(registerId)
+	{
+	case GS_REG_PRIM:
+		m_primitiveType = static_cast<unsigned int>(data & 0x07);
+		switch(m_primitiveType)
+		{
+		case PRIM_POINT:
+			m_vtxCount = 1;
+			break;
+		case PRIM_LINE:
+		case PRIM_LINESTRIP:
+			m_vtxCount = 2;
+			break;
+		case PRIM_TRIANGLE:
+		case PRIM_TRIANGLESTRIP:
+		case PRIM_TRIANGLEFAN:
+			m_vtxCount = 3;
+			break;
+		case PRIM_SPRITE:
+			m_vtxCount = 2;
+			break;
+		}
+		break;
+
+	case GS_REG_XYZ2:
+	case GS_REG_XYZ3:
+	case GS_REG_XYZF2:
+	case GS_REG_XYZF3:
+		VertexKick(registerId, data);
+		break;
+
+	case GS_REG_RGBAQ:
+	case GS_REG_ST:
+	case GS_REG_UV:
+	case GS_REG_FOG:
+	case GS_REG_PRMODECONT:
+	case GS_REG_PRMODE:
+		break;
+
+	default:
+		//Anything else might affect the pixel pipeline
+		m_renderStateDirty = true;
+		break;
+	}
+}
+
+void CGSH_Software::VertexKick(uint8 registerId, uint64 data)
+{
+	if(m_vtxCount == 0) return;
+
+	bool drawingKick = (registerId == GS_REG_XYZ2) || (registerId == GS_REG_XYZF2);
+	bool fog = (registerId == GS_REG_XYZF2) || (registerId == GS_REG_XYZF3);
+
+	if(!m_drawEnabled) drawingKick = false;
+
+	if(fog)
+	{
+		m_vtxBuffer[m_vtxCount - 1].position = data & 0x00FFFFFFFFFFFFFFULL;
+		m_vtxBuffer[m_vtxCount - 1].rgbaq = m_nReg[GS_REG_RGBAQ];
+		m_vtxBuffer[m_vtxCount - 1].uv = m_nReg[GS_REG_UV];
+		m_vtxBuffer[m_vtxCount - 1].st = m_nReg[GS_REG_ST];
+		m_vtxBuffer[m_vtxCount - 1].fog = static_cast<uint8>(data >> 56);
+	}
+	else
+	{
+		m_vtxBuffer[m_vtxCount - 1].position = data;
+		m_vtxBuffer[m_vtxCount - 1].rgbaq = m_nReg[GS_REG_RGBAQ];
+		m_vtxBuffer[m_vtxCount - 1].uv = m_nReg[GS_REG_UV];
+		m_vtxBuffer[m_vtxCount - 1].st = m_nReg[GS_REG_ST];
+		m_vtxBuffer[m_vtxCount - 1].fog = static_cast<uint8>(m_nReg[GS_REG_FOG] >> 56);
+	}
+
+	m_vtxCount--;
+
+	if(m_vtxCount == 0)
+	{
+		if((m_nReg[GS_REG_PRMODECONT] & 1) != 0)
+		{
+			m_primitiveMode <<= m_nReg[GS_REG_PRIM];
+		}
+		else
+		{
+			m_primitiveMode <<= m_nReg[GS_REG_PRMODE];
+		}
+
+		if(drawingKick)
+		{
+			SetRenderingContext(m_primitiveMode);
+		}
+
+		switch(m_primitiveType)
+		{
+		case PRIM_POINT:
+			if(drawingKick) Prim_Point();
+			m_vtxCount = 1;
+			break;
+		case PRIM_LINE:
+			if(drawingKick) Prim_Line();
+			m_vtxCount = 2;
+			break;
+		case PRIM_LINESTRIP:
+			if(drawingKick) Prim_Line();
+			memcpy(&m_vtxBuffer[1], &m_vtxBuffer[0], sizeof(VERTEX));
+			m_vtxCount = 1;
+			break;
+		case PRIM_TRIANGLE:
+			if(drawingKick) Prim_Triangle();
+			m_vtxCount = 3;
+			break;
+		case PRIM_TRIANGLESTRIP:
+			if(drawingKick) Prim_Triangle();
+			memcpy(&m_vtxBuffer[2], &m_vtxBuffer[1], sizeof(VERTEX));
+			memcpy(&m_vtxBuffer[1], &m_vtxBuffer[0], sizeof(VERTEX));
+			m_vtxCount = 1;
+			break;
+		case PRIM_TRIANGLEFAN:
+			if(drawingKick) Prim_Triangle();
+			memcpy(&m_vtxBuffer[1], &m_vtxBuffer[0], sizeof(VERTEX));
+			m_vtxCount = 1;
+			break;
+		case PRIM_SPRITE:
+			if(drawingKick) Prim_Sprite();
+			m_vtxCount = 2;
+			break;
+		}
+	}
+}
+
+void CGSH_Software::SetRenderingContext(uint64 primReg)
+{
+	auto prim = make_convertible<PRMODE>(primReg);
+
+	unsigned int context = prim.nContext;
+
+	auto offset = make_convertible<XYOFFSET>(m_nReg[GS_REG_XYOFFSET_1 + context]);
+	auto tex0 = make_convertible<TEX0>(m_nReg[GS_REG_TEX0_1 + context]);
+
+	m_primOfsX = offset.nOffsetX;
+	m_primOfsY = offset.nOffsetY;
+	m_texWidth = static_cast<float>(tex0.GetWidth());
+	m_texHeight = static_cast<float>(tex0.GetHeight());
+
+	if(!m_renderStateDirty && (m_renderStateContext == context) && !m_renderStates.empty()) return;
+
+	auto tex1 = make_convertible<TEX1>(m_nReg[GS_REG_TEX1_1 + context]);
+	auto scissor = make_convertible<SCISSOR>(m_nReg[GS_REG_SCISSOR_1 + context]);
+
+	RENDERSTATE state;
+	state.frame = make_convertible<FRAME>(m_nReg[GS_REG_FRAME_1 + context]);
+	state.zbuf = make_convertible<ZBUF>(m_nReg[GS_REG_ZBUF_1 + context]);
+	state.tex0 = tex0;
+	state.clamp = make_convertible<CLAMP>(m_nReg[GS_REG_CLAMP_1 + context]);
+	state.alpha = make_convertible<ALPHA>(m_nReg[GS_REG_ALPHA_1 + context]);
+	state.test = make_convertible<TEST>(m_nReg[GS_REG_TEST_1 + context]);
+	state.texA = make_convertible<TEXA>(m_nReg[GS_REG_TEXA]);
+	state.fogCol = make_convertible<FOGCOL>(m_nReg[GS_REG_FOGCOL]);
+	state.scissor.left = scissor.scax0;
+	state.scissor.top = scissor.scay0;
+	state.scissor.right = scissor.scax1 + 1;
+	state.scissor.bottom = scissor.scay1 + 1;
+	state.colClamp = (m_nReg[GS_REG_COLCLAMP] & 1) != 0;
+	state.pabe = (m_nReg[GS_REG_PABE] & 1) != 0;
+	state.fba = (m_nReg[GS_REG_FBA_1 + context] & 1) != 0;
+
+	{
+		bool minLinear = false;
+		bool magLinear = (tex1.nMagFilter == MAG_FILTER_LINEAR);
+
+		switch(tex1.nMinFilter)
+		{
+		case MIN_FILTER_LINEAR:
+		case MIN_FILTER_LINEAR_MIP_NEAREST:
+		case MIN_FILTER_LINEAR_MIP_LINEAR:
+			minLinear = true;
+			break;
+		}
+
+		state.textureUseLinearFiltering = (minLinear && magLinear);
+	}
+
+	if(CGsPixelFormats::IsPsmIDTEX(tex0.nPsm))
+	{
+		MakeLinearCLUT(tex0, state.clut);
+		if((tex0.nCPSM == PSMCT16) || (tex0.nCPSM == PSMCT16S))
+		{
+			//16-bit CLUT entries get their alpha from TEXA
+			for(auto& color : state.clut)
+			{
+				uint32 rgb = color & 0x00FFFFFF;
+				uint32 alpha = 0;
+				if(color & 0x80000000)
+				{
+					alpha = state.texA.nTA1;
+				}
+				else if(!state.texA.nAEM || (rgb != 0))
+				{
+					alpha = state.texA.nTA0;
+				}
+				color = rgb | (alpha << 24);
+			}
+		}
+	}
+
+	if(!m_primitives.empty())
+	{
+		const auto& batchState = m_renderStates.back();
+		bool sameTarget =
+		    (batchState.frame.nPtr == state.frame.nPtr) &&
+		    (batchState.frame.nWidth == state.frame.nWidth) &&
+		    (batchState.frame.nPsm == state.frame.nPsm) &&
+		    (batchState.zbuf.nPtr == state.zbuf.nPtr) &&
+		    (batchState.zbuf.nPsm == state.zbuf.nPsm);
+		if(!sameTarget)
+		{
+			FlushPrimitives();
+		}
+	}
+
+	m_renderStates.push_back(state);
+	m_renderStateDirty = false;
+	m_renderStateContext = context;
+}
+
+GSH_Software::VERTEX CGSH_Software::ConvertVertex(const VERTEX& vertex) const
+{
+	auto xyz = make_convertible<XYZ>(vertex.position);
+	auto rgbaq = make_convertible<RGBAQ>(vertex.rgbaq);
+
+	GSH_Software::VERTEX result;
+	result.x = static_cast<int32>(xyz.nX) - m_primOfsX;
+	result.y = static_cast<int32>(xyz.nY) - m_primOfsY;
+	result.z = xyz.nZ;
+	result.r = rgbaq.nR;
+	result.g = rgbaq.nG;
+	result.b = rgbaq.nB;
+	result.a = rgbaq.nA;
+	result.fog = vertex.fog;
+
+	if(m_primitiveMode.nUseUV)
+	{
+		auto uv = make_convertible<UV>(vertex.uv);
+		result.s = uv.GetU();
+		result.t = uv.GetV();
+		result.q = 1;
+	}
+	else
+	{
+		auto st = make_convertible<ST>(vertex.st);
+		result.s = st.nS * m_texWidth;
+		result.t = st.nT * m_texHeight;
+		result.q = rgbaq.nQ;
+	}
+
+	return result;
+}
+
+void CGSH_Software::Prim_Point()
+{
+	PRIMITIVE primitive;
+	primitive.type = PRIM_POINT;
+	primitive.vertices[0] = ConvertVertex(m_vtxBuffer[0]);
+	QueuePrimitive(primitive);
+}
+
+void CGSH_Software::Prim_Line()
+{
+	PRIMITIVE primitive;
+	primitive.type = PRIM_LINE;
+	primitive.vertices[0] = ConvertVertex(m_vtxBuffer[1]);
+	primitive.vertices[1] = ConvertVertex(m_vtxBuffer[0]);
+	QueuePrimitive(primitive);
+}
+
+void CGSH_Software::Prim_Triangle()
+{
+	PRIMITIVE primitive;
+	primitive.type = PRIM_TRIANGLE;
+	primitive.vertices[0] = ConvertVertex(m_vtxBuffer[2]);
+	primitive.vertices[1] = ConvertVertex(m_vtxBuffer[1]);
+	primitive.vertices[2] = ConvertVertex(m_vtxBuffer[0]);
+	QueuePrimitive(primitive);
+}
+
+void CGSH_Software::Prim_Sprite()
+{
+	PRIMITIVE primitive;
+	primitive.type = PRIM_SPRITE;
+	primitive.vertices[0] = ConvertVertex(m_vtxBuffer[1]);
+	primitive.vertices[1] = ConvertVertex(m_vtxBuffer[0]);
+	QueuePrimitive(primitive);
+}
+
+void CGSH_Software::QueuePrimitive(PRIMITIVE& primitive)
+{
+	primitive.hasTexture = m_primitiveMode.nTexture;
+	primitive.hasFog = m_primitiveMode.nFog;
+	primitive.hasAlphaBlending = m_primitiveMode.nAlpha;
+	primitive.hasGouraudShading = m_primitiveMode.nShading;
+
+	const auto& state = m_renderStates.back();
+
+	auto bounds = CRasterizer::GetPrimitiveBounds(state, primitive);
+	if((bounds.left >= bounds.right) || (bounds.top >= bounds.bottom)) return;
+
+	//Sampling from a texture that is being rendered to would be sensitive to the order
+	//in which tiles are processed. Such primitives are drawn on their own, on this thread.
+	bool textureInTarget = false;
+	if(primitive.hasTexture)
+	{
+		const auto& tex0 = state.tex0;
+		auto textureRange = GetBufferRange(tex0.GetBufPtr(), tex0.GetBufWidth(), tex0.nPsm, tex0.GetHeight());
+		textureRange.end += CGsPixelFormats::PAGESIZE;
+		auto targetRange = GetTargetRange(state, std::max(m_batchHeight, bounds.bottom));
+		textureInTarget = RangesOverlap(textureRange, targetRange);
+	}
+
+	if(textureInTarget || (m_primitives.size() >= MAX_BATCH_PRIMITIVES))
+	{
+		FlushPrimitives();
+	}
+
+	primitive.stateIndex = static_cast<uint32>(m_renderStates.size() - 1);
+	uint32 primitiveIndex = static_cast<uint32>(m_primitives.size());
+	m_primitives.push_back(primitive);
+	m_batchHeight = std::max(m_batchHeight, bounds.bottom);
+
+	uint32 tileLeft = bounds.left / TILE_SIZE;
+	uint32 tileTop = bounds.top / TILE_SIZE;
+	uint32 tileRight = (bounds.right - 1) / TILE_SIZE;
+	uint32 tileBottom = (bounds.bottom - 1) / TILE_SIZE;
+	for(uint32 tileY = tileTop; tileY <= tileBottom; tileY++)
+	{
+		for(uint32 tileX = tileLeft; tileX <= tileRight; tileX++)
+		{
+			uint32 tileIndex = tileX + (tileY * TILE_GRID_SIZE);
+			auto& tileBin = m_tileBins[tileIndex];
+			if(tileBin.empty())
+			{
+				m_activeTiles.push_back(tileIndex);
+			}
+			tileBin.push_back(primitiveIndex);
+		}
+	}
+
+	if(textureInTarget)
+	{
+		FlushPrimitives(false);
+	}
+}
+
+void CGSH_Software::FlushPrimitives(bool useWorkers)
+{
+	if(m_primitives.empty()) return;
+
+	m_nextTileIndex = 0;
+	if(useWorkers && !m_workers.empty() && (m_activeTiles.size() > 1))
+	{
+		{
+			std::lock_guard<std::mutex> workerLock(m_workerMutex);
+			m_pendingWorkerCount = static_cast<uint32>(m_workers.size());
+			m_workerGeneration++;
+		}
+		m_workerCondition.notify_all();
+
+		ProcessTiles();
+
+		std::unique_lock<std::mutex> workerLock(m_workerMutex);
+		m_workerDoneCondition.wait(workerLock, [this]() { return m_pendingWorkerCount == 0; });
+	}
+	else
+	{
+		ProcessTiles();
+	}
+
+	DiscardPrimitives();
+	m_drawCallCount++;
+}
+
+void CGSH_Software::DiscardPrimitives()
+{
+	for(auto tileIndex : m_activeTiles)
+	{
+		m_tileBins[tileIndex].clear();
+	}
+	m_activeTiles.clear();
+	m_primitives.clear();
+	m_batchHeight = 0;
+
+	//Keep the current state around, it might still be used by upcoming primitives
+	if(!m_renderStates.empty())
+	{
+		m_renderStates.erase(m_renderStates.begin(), m_renderStates.end() - 1);
+	}
+}
+
+void CGSH_Software::ProcessTiles()
+{
+	CRasterizer rasterizer(m_pRAM);
+	while(1)
+	{
+		uint32 index = m_nextTileIndex++;
+		if(index >= m_activeTiles.size()) break;
+
+		uint32 tileIndex = m_activeTiles[index];
+
+		GSH_Software::RECT tileRect;
+		tileRect.left = (tileIndex % TILE_GRID_SIZE) * TILE_SIZE;
+		tileRect.top = (tileIndex / TILE_GRID_SIZE) * TILE_SIZE;
+		tileRect.right = tileRect.left + TILE_SIZE;
+		tileRect.bottom = tileRect.top + TILE_SIZE;
+
+		for(auto primitiveIndex : m_tileBins[tileIndex])
+		{
+			const auto& primitive = m_primitives[primitiveIndex];
+			rasterizer.DrawPrimitive(m_renderStates[primitive.stateIndex], primitive, tileRect);
+		}
+	}
+}
+
+void CGSH_Software::WorkerThreadProc()
+{
+	uint32 generation = 0;
+	while(1)
+	{
+		{
+			std::unique_lock<std::mutex> workerLock(m_workerMutex);
+			m_workerCondition.wait(workerLock, [&]() { return m_workersDone || (m_workerGeneration != generation); });
+			if(m_workersDone) break;
+			generation = m_workerGeneration;
+		}
+
+		ProcessTiles();
+
+		{
+			std::lock_guard<std::mutex> workerLock(m_workerMutex);
+			m_pendingWorkerCount--;
+		}
+		m_workerDoneCondition.notify_one();
+	}
+}
+
+CGSH_Software::MEMORYRANGE CGSH_Software::GetTargetRange(const RENDERSTATE& state, uint32 height) const
+{
+	auto range = GetBufferRange(state.frame.GetBasePtr(), state.frame.GetWidth(), state.frame.nPsm, height);
+	if(state.test.nDepthEnabled || (state.zbuf.nMask == 0))
+	{
+		auto depthRange = GetBufferRange(state.zbuf.GetBasePtr(), state.frame.GetWidth(), state.zbuf.nPsm | 0x30, height);
+		range.start = std::min(range.start, depthRange.start);
+		range.end = std::max(range.end, depthRange.end);
+	}
+	return range;
+}
+
+CGSH_Software::MEMORYRANGE CGSH_Software::GetBufferRange(uint32 bufPtr, uint32 bufWidth, uint32 psm, uint32 height)
+{
+	auto pageSize = CGsPixelFormats::GetPsmPageSize(psm);
+	uint32 pageCountX = std::max<uint32>((bufWidth + pageSize.first - 1) / pageSize.first, 1);
+	uint32 pageCountY = (height + pageSize.second - 1) / pageSize.second;
+
+	MEMORYRANGE range;
+	range.start = bufPtr;
+	range.end = bufPtr + (pageCountX * pageCountY * CGsPixelFormats::PAGESIZE);
+	return range;
+}
+
+bool CGSH_Software::RangesOverlap(const MEMORYRANGE& range1, const MEMORYRANGE& range2)
+{
+	return (range1.start < range2.end) && (range2.start < range1.end);
+}
+
+void CGSH_Software::BeginTransferWrite()
+{
+	FlushPrimitives();
+	CGSHandler::BeginTransferWrite();
+}
+
+void CGSH_Software::SyncCLUT(const TEX0& tex0)
+{
+	//CLUT loads read from memory right away, make sure they see pending draws
+	if(CGsPixelFormats::IsPsmIDTEX(tex0.nPsm) && (tex0.nCLD != 0) && !m_primitives.empty())
+	{
+		MEMORYRANGE clutRange;
+		clutRange.start = tex0.GetCLUTPtr();
+		clutRange.end = clutRange.start + CGsPixelFormats::PAGESIZE;
+		if(RangesOverlap(clutRange, GetTargetRange(m_renderStates.back(), m_batchHeight)))
+		{
+			FlushPrimitives();
+		}
+	}
+	CGSHandler::SyncCLUT(tex0);
+}
+
+void CGSH_Software::ProcessHostToLocalTransfer()
+{
+	//Data was already written to memory by the transfer handlers
+}
+
+void CGSH_Software::ProcessLocalToHostTransfer()
+{
+	FlushPrimitives();
+}
+
+void CGSH_Software::ProcessLocalToLocalTransfer()
+{
+	FlushPrimitives();
+
+	auto bltBuf = make_convertible<BITBLTBUF>(m_nReg[GS_REG_BITBLTBUF]);
+	auto trxReg = make_convertible<TRXREG>(m_nReg[GS_REG_TRXREG]);
+	auto trxPos = make_convertible<TRXPOS>(m_nReg[GS_REG_TRXPOS]);
+
+	//Go through a temporary buffer to handle overlapping areas
+	std::vector<uint32> pixels(trxReg.nRRW * trxReg.nRRH);
+	auto pixel = pixels.begin();
+	for(uint32 y = 0; y < trxReg.nRRH; y++)
+	{
+		for(uint32 x = 0; x < trxReg.nRRW; x++)
+		{
+			uint32 srcX = (trxPos.nSSAX + x) % 2048;
+			uint32 srcY = (trxPos.nSSAY + y) % 2048;
+			*(pixel++) = CRasterizer::ReadPixel(m_pRAM, bltBuf.nSrcPsm, bltBuf.GetSrcPtr(), bltBuf.nSrcWidth, srcX, srcY);
+		}
+	}
+
+	pixel = pixels.begin();
+	for(uint32 y = 0; y < trxReg.nRRH; y++)
+	{
+		for(uint32 x = 0; x < trxReg.nRRW; x++)
+		{
+			uint32 dstX = (trxPos.nDSAX + x) % 2048;
+			uint32 dstY = (trxPos.nDSAY + y) % 2048;
+			CRasterizer::WritePixel(m_pRAM, bltBuf.nDstPsm, bltBuf.GetDstPtr(), bltBuf.nDstWidth, dstX, dstY, *(pixel++));
+		}
+	}
+}
+
+void CGSH_Software::ProcessClutTransfer(uint32, uint32)
+{
+}
+
+CGSH_Software::DISPLAYSOURCE CGSH_Software::GetDisplaySource()
+{
+	auto dispInfo = GetCurrentDisplayInfo();
+	auto fb = make_convertible<DISPFB>(dispInfo.first);
+	auto d = make_convertible<DISPLAY>(dispInfo.second);
+
+	DISPLAYSOURCE source;
+	if(fb.nBufWidth != 0)
+	{
+		source.bufPtr = fb.GetBufPtr();
+		source.bufWidth = fb.nBufWidth;
+		source.psm = fb.nPSM;
+		source.x = fb.nX;
+		source.y = fb.nY;
+		source.width = (d.nW + 1) / (d.nMagX + 1);
+		source.height = (d.nH + 1);
+		bool halfHeight = GetCrtIsInterlaced() && GetCrtIsFrameMode();
+		if(halfHeight) source.height /= 2;
+	}
+	else
+	{
+		//No display set up (ex.: frame dump replays don't record privileged registers),
+		//use the first context's framebuffer instead
+		auto frame = make_convertible<FRAME>(m_nReg[GS_REG_FRAME_1]);
+		auto scissor = make_convertible<SCISSOR>(m_nReg[GS_REG_SCISSOR_1]);
+		source.bufPtr = frame.GetBasePtr();
+		source.bufWidth = frame.nWidth;
+		source.psm = frame.nPsm;
+		source.width = frame.GetWidth();
+		source.height = scissor.scay1 + 1;
+	}
+	return source;
+}
+
+void CGSH_Software::ReadFramebuffer(uint32 width, uint32 height, void* buffer)
+{
+	FlushPrimitives();
+
+	auto source = GetDisplaySource();
+	auto output = reinterpret_cast<uint8*>(buffer);
+	uint32 pitch = ((width * 3) + 3) & ~3;
+
+	for(uint32 y = 0; y < height; y++)
+	{
+		uint32 srcY = ((height - y - 1) * source.height) / height;
+		auto row = output + (y * pitch);
+		for(uint32 x = 0; x < width; x++)
+		{
+			uint32 srcX = (x * source.width) / width;
+			uint32 color = CRasterizer::ReadColor(m_pRAM, source.psm, source.bufPtr, source.bufWidth,
+			                                      (source.x + srcX) % 2048, (source.y + srcY) % 2048);
+			row[(x * 3) + 0] = static_cast<uint8>(color >> 16);
+			row[(x * 3) + 1] = static_cast<uint8>(color >> 8);
+			row[(x * 3) + 2] = static_cast<uint8>(color >> 0);
+		}
+	}
+}
+
+Framework::CBitmap CGSH_Software::GetScreenshot()
+{
+	FlushPrimitives();
+
+	auto source = GetDisplaySource();
+	if((source.width == 0) || (source.height == 0)) return Framework::CBitmap();
+
+	auto bitmap = Framework::CBitmap(source.width, source.height, 32);
+	auto pixels = reinterpret_cast<uint32*>(bitmap.GetPixels());
+	for(uint32 y = 0; y < source.height; y++)
+	{
+		for(uint32 x = 0; x < source.width; x++)
+		{
+			uint32 color = CRasterizer::ReadColor(m_pRAM, source.psm, source.bufPtr, source.bufWidth,
+			                                      (source.x + x) % 2048, (source.y + y) % 2048);
+			pixels[x + (y * source.width)] = color | 0xFF000000;
+		}
+	}
+
+	bool halfHeight = GetCrtIsInterlaced() && GetCrtIsFrameMode();
+	if(halfHeight)
+	{
+		return bitmap.Resize(source.width, source.height * 2);
+	}
+	return bitmap;
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "../GSHandler.h"
+#include "GSH_SoftwareRasterizer.h"
+
+//Renders directly into GS memory on the CPU. Primitives are batched and binned into
+//screen tiles, tiles are then rasterized in parallel by a pool of worker threads.
+class CGSH_Software : public CGSHandler
+{
+public:
+	CGSH_Software();
+	virtual ~CGSH_Software() = default;
+
+	void SaveState(Framework::CZipArchiveWriter&) override;
+	void LoadState(Framework::CZipArchiveReader&) override;
+	void SaveDeviceState(Framework::CStream&) override;
+	void LoadDeviceState(Framework::CStream&) override;
+
+	void ProcessHostToLocalTransfer() override;
+	void ProcessLocalToHostTransfer() override;
+	void ProcessLocalToLocalTransfer() override;
+	void ProcessClutTransfer(uint32, uint32) override;
+
+	//Writes the displayed framebuffer as 24-bit BGR, rows are bottom to top and aligned
+	//on 4 bytes (same layout as glReadPixels). Must not be called while the GS thread is busy.
+	void ReadFramebuffer(uint32, uint32, void*) override;
+
+	Framework::CBitmap GetScreenshot() override;
+
+	static FactoryFunction GetFactoryFunction();
+
+protected:
+	void WriteRegisterImpl(uint8, uint64) override;
+	void InitializeImpl() override;
+	void ReleaseImpl() override;
+	void ResetImpl() override;
+	void MarkNewFrame() override;
+	void FlipImpl() override;
+	void BeginTransferWrite() override;
+	void SyncCLUT(const TEX0&) override;
+
+private:
+	struct VERTEX
+	{
+		uint64 position;
+		uint64 rgbaq;
+		uint64 uv;
+		uint64 st;
+		uint8 fog;
+	};
+
+	struct MEMORYRANGE
+	{
+		uint32 start = 0;
+		uint32 end = 0;
+	};
+
+	struct DISPLAYSOURCE
+	{
+		uint32 bufPtr = 0;
+		uint32 bufWidth = 0;
+		uint32 psm = 0;
+		uint32 x = 0;
+		uint32 y = 0;
+		uint32 width = 0;
+		uint32 height = 0;
+	};
+
+	enum
+	{
+		TILE_SIZE = 32,
+		TILE_GRID_SIZE = 2048 / TILE_SIZE,
+		MAX_WORKER_COUNT = 15,
+		MAX_BATCH_PRIMITIVES = 0x10000,
+	};
+
+	static CGSHandler* GSHandlerFactory();
+
+	void VertexKick(uint8, uint64);
+	void SetRenderingContext(uint64);
+	GSH_Software::VERTEX ConvertVertex(const VERTEX&) const;
+
+	void Prim_Point();
+	void Prim_Line();
+	void Prim_Triangle();
+	void Prim_Sprite();
+
+	void QueuePrimitive(GSH_Software::PRIMITIVE&);
+	void FlushPrimitives(bool = true);
+	void DiscardPrimitives();
+	void ProcessTiles();
+	void WorkerThreadProc();
+
+	MEMORYRANGE GetTargetRange(const GSH_Software::RENDERSTATE&, uint32) const;
+	static MEMORYRANGE GetBufferRange(uint32, uint32, uint32, uint32);
+	static bool RangesOverlap(const MEMORYRANGE&, const MEMORYRANGE&);
+
+	DISPLAYSOURCE GetDisplaySource();
+
+	//Draw context
+	VERTEX m_vtxBuffer[3];
+	uint32 m_vtxCount = 0;
+	uint32 m_primitiveType = PRIM_INVALID;
+	PRMODE m_primitiveMode;
+	int32 m_primOfsX = 0;
+	int32 m_primOfsY = 0;
+	float m_texWidth = 0;
+	float m_texHeight = 0;
+	bool m_renderStateDirty = true;
+	uint32 m_renderStateContext = 0;
+
+	//Pending batch, all primitives of a batch render to the same frame and depth buffers
+	std::vector<GSH_Software::RENDERSTATE> m_renderStates;
+	std::vector<GSH_Software::PRIMITIVE> m_primitives;
+	std::vector<std::vector<uint32>> m_tileBins;
+	std::vector<uint32> m_activeTiles;
+	int32 m_batchHeight = 0;
+
+	//Worker pool
+	std::vector<std::thread> m_workers;
+	std::mutex m_workerMutex;
+	std::condition_variable m_workerCondition;
+	std::condition_variable m_workerDoneCondition;
+	std::atomic<uint32> m_nextTileIndex;
+	uint32 m_workerGeneration = 0;
+	uint32 m_pendingWorkerCount = 0;
+	bool m_workersDone = false;
+};
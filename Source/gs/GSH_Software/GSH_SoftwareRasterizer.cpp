@@ -0,0 +1,868 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include "GSH_SoftwareRasterizer.h"
+#include "../GsPixelFormats.h"
+
+using namespace GSH_Software;
+
+static const uint32* g_pageOffsetsPSMCT32 = nullptr;
+static const uint32* g_pageOffsetsPSMCT16 = nullptr;
+static const uint32* g_pageOffsetsPSMCT16S = nullptr;
+static const uint32* g_pageOffsetsPSMT8 = nullptr;
+static const uint32* g_pageOffsetsPSMT4 = nullptr;
+static const uint32* g_pageOffsetsPSMZ32 = nullptr;
+static const uint32* g_pageOffsetsPSMZ16 = nullptr;
+static const uint32* g_pageOffsetsPSMZ16S = nullptr;
+
+//Same addressing as CPixelIndexor, but using the prebuilt page offset tables.
+//Buffer width is in units of 64 pixels.
+template <typename Storage>
+static uint32 GetPixelOffset(const uint32* pageOffsets, uint32 bufPtr, uint32 bufWidth, uint32 x, uint32 y)
+{
+	uint32 pageNum = (x / Storage::PAGEWIDTH) + (y / Storage::PAGEHEIGHT) * (bufWidth * 64) / Storage::PAGEWIDTH;
+	x %= Storage::PAGEWIDTH;
+	y %= Storage::PAGEHEIGHT;
+	return bufPtr + (pageNum * CGsPixelFormats::PAGESIZE) + pageOffsets[(y * Storage::PAGEWIDTH) + x];
+}
+
+//PSMT4 page offsets are expressed in nibbles
+static uint32 GetPixelNibbleOffset(uint32 bufPtr, uint32 bufWidth, uint32 x, uint32 y)
+{
+	typedef CGsPixelFormats::STORAGEPSMT4 Storage;
+	uint32 pageNum = (x / Storage::PAGEWIDTH) + (y / Storage::PAGEHEIGHT) * (bufWidth * 64) / Storage::PAGEWIDTH;
+	x %= Storage::PAGEWIDTH;
+	y %= Storage::PAGEHEIGHT;
+	return ((bufPtr + (pageNum * CGsPixelFormats::PAGESIZE)) * 2) + g_pageOffsetsPSMT4[(y * Storage::PAGEWIDTH) + x];
+}
+
+template <typename Type>
+static Type& GetRamValue(uint8* ram, uint32 offset)
+{
+	return *reinterpret_cast<Type*>(ram + (offset & (CGSHandler::RAMSIZE - 1)));
+}
+
+template <typename Type>
+static Type GetRamValue(const uint8* ram, uint32 offset)
+{
+	return *reinterpret_cast<const Type*>(ram + (offset & (CGSHandler::RAMSIZE - 1)));
+}
+
+static uint32 ConvertColor16To32(uint32 color)
+{
+	return ((color & 0x001F) << 3) | ((color & 0x03E0) << 6) | ((color & 0x7C00) << 9) | ((color & 0x8000) ? 0x80000000 : 0);
+}
+
+static int32 WrapTexCoord(int32 coord, uint32 mode, uint32 size, int32 minCoord, int32 maxCoord)
+{
+	switch(mode)
+	{
+	default:
+	case CGSHandler::CLAMP_MODE_REPEAT:
+		return coord & (size - 1);
+	case CGSHandler::CLAMP_MODE_CLAMP:
+		return std::min<int32>(std::max<int32>(coord, 0), size - 1);
+	case CGSHandler::CLAMP_MODE_REGION_CLAMP:
+		return std::min<int32>(std::max<int32>(coord, minCoord), maxCoord);
+	case CGSHandler::CLAMP_MODE_REGION_REPEAT:
+		return (coord & minCoord) | maxCoord;
+	}
+}
+
+static int32 SelectBlendColor(uint32 select, int32 source, int32 dest)
+{
+	switch(select)
+	{
+	case CGSHandler::ALPHABLEND_ABD_CS:
+		return source;
+	case CGSHandler::ALPHABLEND_ABD_CD:
+		return dest;
+	default:
+		return 0;
+	}
+}
+
+static uint32 ClampDepth(double z)
+{
+	if(!(z > 0)) return 0;
+	if(z >= 4294967295.0) return 0xFFFFFFFF;
+	return static_cast<uint32>(z);
+}
+
+static float ClampTexCoord(float coord)
+{
+	//Also takes care of NaNs produced by a zero Q
+	if(!(coord > -65536.f)) return -65536.f;
+	if(!(coord < 65536.f)) return 65536.f;
+	return coord;
+}
+
+CRasterizer::CRasterizer(uint8* ram)
+    : m_ram(ram)
+{
+}
+
+void CRasterizer::InitializeTables()
+{
+	g_pageOffsetsPSMCT32 = CGsPixelFormats::CPixelIndexor<CGsPixelFormats::STORAGEPSMCT32>::GetPageOffsets();
+	g_pageOffsetsPSMCT16 = CGsPixelFormats::CPixelIndexor<CGsPixelFormats::STORAGEPSMCT16>::GetPageOffsets();
+	g_pageOffsetsPSMCT16S = CGsPixelFormats::CPixelIndexor<CGsPixelFormats::STORAGEPSMCT16S>::GetPageOffsets();
+	g_pageOffsetsPSMT8 = CGsPixelFormats::CPixelIndexor<CGsPixelFormats::STORAGEPSMT8>::GetPageOffsets();
+	g_pageOffsetsPSMT4 = CGsPixelFormats::CPixelIndexor<CGsPixelFormats::STORAGEPSMT4>::GetPageOffsets();
+	g_pageOffsetsPSMZ32 = CGsPixelFormats::CPixelIndexor<CGsPixelFormats::STORAGEPSMZ32>::GetPageOffsets();
+	g_pageOffsetsPSMZ16 = CGsPixelFormats::CPixelIndexor<CGsPixelFormats::STORAGEPSMZ16>::GetPageOffsets();
+	g_pageOffsetsPSMZ16S = CGsPixelFormats::CPixelIndexor<CGsPixelFormats::STORAGEPSMZ16S>::GetPageOffsets();
+}
+
+uint32 CRasterizer::ReadPixel(const uint8* ram, uint32 psm, uint32 bufPtr, uint32 bufWidth, uint32 x, uint32 y)
+{
+	switch(psm)
+	{
+	case CGSHandler::PSMCT32:
+		return GetRamValue<uint32>(ram, GetPixelOffset<CGsPixelFormats::STORAGEPSMCT32>(g_pageOffsetsPSMCT32, bufPtr, bufWidth, x, y));
+	case CGSHandler::PSMCT24:
+		return GetRamValue<uint32>(ram, GetPixelOffset<CGsPixelFormats::STORAGEPSMCT32>(g_pageOffsetsPSMCT32, bufPtr, bufWidth, x, y)) & 0x00FFFFFF;
+	case CGSHandler::PSMCT16:
+		return GetRamValue<uint16>(ram, GetPixelOffset<CGsPixelFormats::STORAGEPSMCT16>(g_pageOffsetsPSMCT16, bufPtr, bufWidth, x, y));
+	case CGSHandler::PSMCT16S:
+		return GetRamValue<uint16>(ram, GetPixelOffset<CGsPixelFormats::STORAGEPSMCT16S>(g_pageOffsetsPSMCT16S, bufPtr, bufWidth, x, y));
+	case CGSHandler::PSMT8:
+		return GetRamValue<uint8>(ram, GetPixelOffset<CGsPixelFormats::STORAGEPSMT8>(g_pageOffsetsPSMT8, bufPtr, bufWidth, x, y));
+	case CGSHandler::PSMT4:
+	{
+		uint32 nibbleOffset = GetPixelNibbleOffset(bufPtr, bufWidth, x, y);
+		return (GetRamValue<uint8>(ram, nibbleOffset / 2) >> ((nibbleOffset & 1) * 4)) & 0x0F;
+	}
+	case CGSHandler::PSMT8H:
+		return GetRamValue<uint32>(ram, GetPixelOffset<CGsPixelFormats::STORAGEPSMCT32>(g_pageOffsetsPSMCT32, bufPtr, bufWidth, x, y)) >> 24;
+	case CGSHandler::PSMT4HL:
+		return (GetRamValue<uint32>(ram, GetPixelOffset<CGsPixelFormats::STORAGEPSMCT32>(g_pageOffsetsPSMCT32, bufPtr, bufWidth, x, y)) >> 24) & 0x0F;
+	case CGSHandler::PSMT4HH:
+		return GetRamValue<uint32>(ram, GetPixelOffset<CGsPixelFormats::STORAGEPSMCT32>(g_pageOffsetsPSMCT32, bufPtr, bufWidth, x, y)) >> 28;
+	case CGSHandler::PSMZ32:
+		return GetRamValue<uint32>(ram, GetPixelOffset<CGsPixelFormats::STORAGEPSMZ32>(g_pageOffsetsPSMZ32, bufPtr, bufWidth, x, y));
+	case CGSHandler::PSMZ24:
+		return GetRamValue<uint32>(ram, GetPixelOffset<CGsPixelFormats::STORAGEPSMZ32>(g_pageOffsetsPSMZ32, bufPtr, bufWidth, x, y)) & 0x00FFFFFF;
+	case CGSHandler::PSMZ16:
+		return GetRamValue<uint16>(ram, GetPixelOffset<CGsPixelFormats::STORAGEPSMZ16>(g_pageOffsetsPSMZ16, bufPtr, bufWidth, x, y));
+	case CGSHandler::PSMZ16S:
+		return GetRamValue<uint16>(ram, GetPixelOffset<CGsPixelFormats::STORAGEPSMZ16S>(g_pageOffsetsPSMZ16S, bufPtr, bufWidth, x, y));
+	default:
+		return 0;
+	}
+}
+
+void CRasterizer::WritePixel(uint8* ram, uint32 psm, uint32 bufPtr, uint32 bufWidth, uint32 x, uint32 y, uint32 value)
+{
+	switch(psm)
+	{
+	case CGSHandler::PSMCT32:
+		GetRamValue<uint32>(ram, GetPixelOffset<CGsPixelFormats::STORAGEPSMCT32>(g_pageOffsetsPSMCT32, bufPtr, bufWidth, x, y)) = value;
+		break;
+	case CGSHandler::PSMCT24:
+	{
+		auto& pixel = GetRamValue<uint32>(ram, GetPixelOffset<CGsPixelFormats::STORAGEPSMCT32>(g_pageOffsetsPSMCT32, bufPtr, bufWidth, x, y));
+		pixel = (pixel & 0xFF000000) | (value & 0x00FFFFFF);
+	}
+	break;
+	case CGSHandler::PSMCT16:
+		GetRamValue<uint16>(ram, GetPixelOffset<CGsPixelFormats::STORAGEPSMCT16>(g_pageOffsetsPSMCT16, bufPtr, bufWidth, x, y)) = static_cast<uint16>(value);
+		break;
+	case CGSHandler::PSMCT16S:
+		GetRamValue<uint16>(ram, GetPixelOffset<CGsPixelFormats::STORAGEPSMCT16S>(g_pageOffsetsPSMCT16S, bufPtr, bufWidth, x, y)) = static_cast<uint16>(value);
+		break;
+	case CGSHandler::PSMT8:
+		GetRamValue<uint8>(ram, GetPixelOffset<CGsPixelFormats::STORAGEPSMT8>(g_pageOffsetsPSMT8, bufPtr, bufWidth, x, y)) = static_cast<uint8>(value);
+		break;
+	case CGSHandler::PSMT4:
+	{
+		uint32 nibbleOffset = GetPixelNibbleOffset(bufPtr, bufWidth, x, y);
+		uint32 shiftAmount = (nibbleOffset & 1) * 4;
+		auto& pixel = GetRamValue<uint8>(ram, nibbleOffset / 2);
+		pixel = static_cast<uint8>((pixel & ~(0x0F << shiftAmount)) | ((value & 0x0F) << shiftAmount));
+	}
+	break;
+	case CGSHandler::PSMT8H:
+	{
+		auto& pixel = GetRamValue<uint32>(ram, GetPixelOffset<CGsPixelFormats::STORAGEPSMCT32>(g_pageOffsetsPSMCT32, bufPtr, bufWidth, x, y));
+		pixel = (pixel & 0x00FFFFFF) | (value << 24);
+	}
+	break;
+	case CGSHandler::PSMT4HL:
+	{
+		auto& pixel = GetRamValue<uint32>(ram, GetPixelOffset<CGsPixelFormats::STORAGEPSMCT32>(g_pageOffsetsPSMCT32, bufPtr, bufWidth, x, y));
+		pixel = (pixel & 0xF0FFFFFF) | ((value & 0x0F) << 24);
+	}
+	break;
+	case CGSHandler::PSMT4HH:
+	{
+		auto& pixel = GetRamValue<uint32>(ram, GetPixelOffset<CGsPixelFormats::STORAGEPSMCT32>(g_pageOffsetsPSMCT32, bufPtr, bufWidth, x, y));
+		pixel = (pixel & 0x0FFFFFFF) | ((value & 0x0F) << 28);
+	}
+	break;
+	case CGSHandler::PSMZ32:
+		GetRamValue<uint32>(ram, GetPixelOffset<CGsPixelFormats::STORAGEPSMZ32>(g_pageOffsetsPSMZ32, bufPtr, bufWidth, x, y)) = value;
+		break;
+	case CGSHandler::PSMZ24:
+	{
+		auto& pixel = GetRamValue<uint32>(ram, GetPixelOffset<CGsPixelFormats::STORAGEPSMZ32>(g_pageOffsetsPSMZ32, bufPtr, bufWidth, x, y));
+		pixel = (pixel & 0xFF000000) | (value & 0x00FFFFFF);
+	}
+	break;
+	case CGSHandler::PSMZ16:
+		GetRamValue<uint16>(ram, GetPixelOffset<CGsPixelFormats::STORAGEPSMZ16>(g_pageOffsetsPSMZ16, bufPtr, bufWidth, x, y)) = static_cast<uint16>(value);
+		break;
+	case CGSHandler::PSMZ16S:
+		GetRamValue<uint16>(ram, GetPixelOffset<CGsPixelFormats::STORAGEPSMZ16S>(g_pageOffsetsPSMZ16S, bufPtr, bufWidth, x, y)) = static_cast<uint16>(value);
+		break;
+	default:
+		assert(false);
+		break;
+	}
+}
+
+uint32 CRasterizer::ReadColor(const uint8* ram, uint32 psm, uint32 bufPtr, uint32 bufWidth, uint32 x, uint32 y)
+{
+	uint32 pixel = ReadPixel(ram, psm, bufPtr, bufWidth, x, y);
+	switch(psm)
+	{
+	case CGSHandler::PSMCT32:
+	case CGSHandler::PSMZ32:
+		return pixel;
+	case CGSHandler::PSMCT24:
+	case CGSHandler::PSMZ24:
+		//No alpha channel, behaves as if alpha was 1.0
+		return pixel | 0x80000000;
+	case CGSHandler::PSMCT16:
+	case CGSHandler::PSMCT16S:
+	case CGSHandler::PSMZ16:
+	case CGSHandler::PSMZ16S:
+		return ConvertColor16To32(pixel);
+	default:
+		return 0;
+	}
+}
+
+RECT CRasterizer::GetPrimitiveBounds(const RENDERSTATE& state, const PRIMITIVE& primitive)
+{
+	unsigned int vertexCount = 0;
+	switch(primitive.type)
+	{
+	case CGSHandler::PRIM_POINT:
+		vertexCount = 1;
+		break;
+	case CGSHandler::PRIM_LINE:
+	case CGSHandler::PRIM_SPRITE:
+		vertexCount = 2;
+		break;
+	case CGSHandler::PRIM_TRIANGLE:
+		vertexCount = 3;
+		break;
+	}
+
+	RECT bounds;
+	if(vertexCount == 0) return bounds;
+
+	int32 minX = primitive.vertices[0].x;
+	int32 minY = primitive.vertices[0].y;
+	int32 maxX = minX;
+	int32 maxY = minY;
+	for(unsigned int i = 1; i < vertexCount; i++)
+	{
+		const auto& vertex = primitive.vertices[i];
+		minX = std::min(minX, vertex.x);
+		minY = std::min(minY, vertex.y);
+		maxX = std::max(maxX, vertex.x);
+		maxY = std::max(maxY, vertex.y);
+	}
+
+	//Conservative, the rasterizers do the exact coverage tests
+	bounds.left = std::max(state.scissor.left, minX >> 4);
+	bounds.top = std::max(state.scissor.top, minY >> 4);
+	bounds.right = std::min(state.scissor.right, ((maxX + 15) >> 4) + 1);
+	bounds.bottom = std::min(state.scissor.bottom, ((maxY + 15) >> 4) + 1);
+	return bounds;
+}
+
+void CRasterizer::DrawPrimitive(const RENDERSTATE& state, const PRIMITIVE& primitive, const RECT& clipRect)
+{
+	m_state = &state;
+	m_primitive = &primitive;
+	m_texWidth = state.tex0.GetWidth();
+	m_texHeight = state.tex0.GetHeight();
+
+	switch(state.zbuf.nPsm | 0x30)
+	{
+	case CGSHandler::PSMZ32:
+		m_zMax = 0xFFFFFFFF;
+		break;
+	case CGSHandler::PSMZ24:
+		m_zMax = 0x00FFFFFF;
+		break;
+	default:
+		m_zMax = 0x0000FFFF;
+		break;
+	}
+
+	RECT clip;
+	clip.left = std::max(clipRect.left, state.scissor.left);
+	clip.top = std::max(clipRect.top, state.scissor.top);
+	clip.right = std::min(clipRect.right, state.scissor.right);
+	clip.bottom = std::min(clipRect.bottom, state.scissor.bottom);
+	if((clip.left >= clip.right) || (clip.top >= clip.bottom)) return;
+
+	switch(primitive.type)
+	{
+	case CGSHandler::PRIM_POINT:
+		DrawPoint(clip);
+		break;
+	case CGSHandler::PRIM_LINE:
+		DrawLine(clip);
+		break;
+	case CGSHandler::PRIM_TRIANGLE:
+		DrawTriangle(clip);
+		break;
+	case CGSHandler::PRIM_SPRITE:
+		DrawSprite(clip);
+		break;
+	}
+}
+
+void CRasterizer::DrawPoint(const RECT& clip)
+{
+	const auto& vertex = m_primitive->vertices[0];
+
+	int32 x = (vertex.x + 8) >> 4;
+	int32 y = (vertex.y + 8) >> 4;
+	if((x < clip.left) || (x >= clip.right) || (y < clip.top) || (y >= clip.bottom)) return;
+
+	PIXEL pixel;
+	pixel.z = vertex.z;
+	pixel.r = static_cast<int32>(vertex.r);
+	pixel.g = static_cast<int32>(vertex.g);
+	pixel.b = static_cast<int32>(vertex.b);
+	pixel.a = static_cast<int32>(vertex.a);
+	pixel.s = vertex.s;
+	pixel.t = vertex.t;
+	pixel.q = vertex.q;
+	pixel.fog = static_cast<int32>(vertex.fog);
+	ShadePixel(x, y, pixel);
+}
+
+void CRasterizer::DrawLine(const RECT& clip)
+{
+	const auto& v0 = m_primitive->vertices[0];
+	const auto& v1 = m_primitive->vertices[1];
+
+	int32 dx = v1.x - v0.x;
+	int32 dy = v1.y - v0.y;
+	if((dx == 0) && (dy == 0)) return;
+
+	bool xMajor = std::abs(dx) >= std::abs(dy);
+
+	//One pixel per step along the major axis, the last pixel is left out
+	int32 majorStart = xMajor ? v0.x : v0.y;
+	int32 majorDelta = xMajor ? dx : dy;
+	int32 minorStart = xMajor ? v0.y : v0.x;
+	int32 minorDelta = xMajor ? dy : dx;
+	int32 startPixel = (std::min(majorStart, majorStart + majorDelta) + 15) >> 4;
+	int32 endPixel = (std::max(majorStart, majorStart + majorDelta) + 15) >> 4;
+	startPixel = std::max(startPixel, xMajor ? clip.left : clip.top);
+	endPixel = std::min(endPixel, xMajor ? clip.right : clip.bottom);
+
+	PIXEL pixel;
+	for(int32 major = startPixel; major < endPixel; major++)
+	{
+		int64 majorDistance = (static_cast<int64>(major) << 4) - majorStart;
+		int64 minorFixed = minorStart + (majorDistance * minorDelta) / majorDelta;
+		int32 minor = static_cast<int32>((minorFixed + 8) >> 4);
+
+		int32 x = xMajor ? major : minor;
+		int32 y = xMajor ? minor : major;
+		if((x < clip.left) || (x >= clip.right) || (y < clip.top) || (y >= clip.bottom)) continue;
+
+		float t = static_cast<float>(majorDistance) / static_cast<float>(majorDelta);
+		double z = static_cast<double>(v0.z) + (static_cast<double>(v1.z) - static_cast<double>(v0.z)) * t;
+
+		pixel.z = ClampDepth(z);
+		if(m_primitive->hasGouraudShading)
+		{
+			pixel.r = static_cast<int32>(v0.r + (v1.r - v0.r) * t);
+			pixel.g = static_cast<int32>(v0.g + (v1.g - v0.g) * t);
+			pixel.b = static_cast<int32>(v0.b + (v1.b - v0.b) * t);
+			pixel.a = static_cast<int32>(v0.a + (v1.a - v0.a) * t);
+		}
+		else
+		{
+			pixel.r = static_cast<int32>(v1.r);
+			pixel.g = static_cast<int32>(v1.g);
+			pixel.b = static_cast<int32>(v1.b);
+			pixel.a = static_cast<int32>(v1.a);
+		}
+		pixel.s = v0.s + (v1.s - v0.s) * t;
+		pixel.t = v0.t + (v1.t - v0.t) * t;
+		pixel.q = v0.q + (v1.q - v0.q) * t;
+		pixel.fog = static_cast<int32>(v0.fog + (v1.fog - v0.fog) * t);
+		ShadePixel(x, y, pixel);
+	}
+}
+
+void CRasterizer::DrawTriangle(const RECT& clip)
+{
+	const VERTEX* v0 = &m_primitive->vertices[0];
+	const VERTEX* v1 = &m_primitive->vertices[1];
+	const VERTEX* v2 = &m_primitive->vertices[2];
+	const auto& lastVertex = m_primitive->vertices[2];
+
+	int64 area = static_cast<int64>(v1->x - v0->x) * (v2->y - v0->y) - static_cast<int64>(v1->y - v0->y) * (v2->x - v0->x);
+	if(area == 0) return;
+	if(area < 0)
+	{
+		std::swap(v1, v2);
+		area = -area;
+	}
+
+	int32 minX = std::min(std::min(v0->x, v1->x), v2->x);
+	int32 minY = std::min(std::min(v0->y, v1->y), v2->y);
+	int32 maxX = std::max(std::max(v0->x, v1->x), v2->x);
+	int32 maxY = std::max(std::max(v0->y, v1->y), v2->y);
+
+	//Pixels are sampled at integer coordinates
+	int32 left = std::max(clip.left, (minX + 15) >> 4);
+	int32 top = std::max(clip.top, (minY + 15) >> 4);
+	int32 right = std::min(clip.right, (maxX >> 4) + 1);
+	int32 bottom = std::min(clip.bottom, (maxY >> 4) + 1);
+	if((left >= right) || (top >= bottom)) return;
+
+	struct EDGE
+	{
+		int64 value;
+		int64 stepX;
+		int64 stepY;
+		int64 bias;
+	};
+
+	//Edge function is positive on the inside, samples that fall exactly on an edge
+	//are only drawn for top and left edges
+	auto setupEdge =
+	    [left, top](const VERTEX& a, const VERTEX& b) {
+		    int64 dx = b.x - a.x;
+		    int64 dy = b.y - a.y;
+		    bool isTopLeft = (dy < 0) || ((dy == 0) && (dx > 0));
+		    EDGE edge;
+		    edge.value = dx * ((static_cast<int64>(top) << 4) - a.y) - dy * ((static_cast<int64>(left) << 4) - a.x);
+		    edge.stepX = -dy * 16;
+		    edge.stepY = dx * 16;
+		    edge.bias = isTopLeft ? 0 : -1;
+		    return edge;
+	    };
+
+	//Each edge function gives the weight of the vertex opposite to it
+	auto edge0 = setupEdge(*v1, *v2);
+	auto edge1 = setupEdge(*v2, *v0);
+	auto edge2 = setupEdge(*v0, *v1);
+
+	double invArea = 1.0 / static_cast<double>(area);
+	bool gouraud = m_primitive->hasGouraudShading;
+
+	PIXEL pixel;
+	if(!gouraud)
+	{
+		pixel.r = static_cast<int32>(lastVertex.r);
+		pixel.g = static_cast<int32>(lastVertex.g);
+		pixel.b = static_cast<int32>(lastVertex.b);
+		pixel.a = static_cast<int32>(lastVertex.a);
+	}
+
+	for(int32 y = top; y < bottom; y++)
+	{
+		int64 e0 = edge0.value;
+		int64 e1 = edge1.value;
+		int64 e2 = edge2.value;
+		for(int32 x = left; x < right; x++)
+		{
+			if(((e0 + edge0.bias) | (e1 + edge1.bias) | (e2 + edge2.bias)) >= 0)
+			{
+				double w0 = static_cast<double>(e0) * invArea;
+				double w1 = static_cast<double>(e1) * invArea;
+				double w2 = 1.0 - w0 - w1;
+				float fw0 = static_cast<float>(w0);
+				float fw1 = static_cast<float>(w1);
+				float fw2 = static_cast<float>(w2);
+
+				pixel.z = ClampDepth((w0 * v0->z) + (w1 * v1->z) + (w2 * v2->z));
+				if(gouraud)
+				{
+					pixel.r = static_cast<int32>((fw0 * v0->r) + (fw1 * v1->r) + (fw2 * v2->r));
+					pixel.g = static_cast<int32>((fw0 * v0->g) + (fw1 * v1->g) + (fw2 * v2->g));
+					pixel.b = static_cast<int32>((fw0 * v0->b) + (fw1 * v1->b) + (fw2 * v2->b));
+					pixel.a = static_cast<int32>((fw0 * v0->a) + (fw1 * v1->a) + (fw2 * v2->a));
+				}
+				pixel.s = (fw0 * v0->s) + (fw1 * v1->s) + (fw2 * v2->s);
+				pixel.t = (fw0 * v0->t) + (fw1 * v1->t) + (fw2 * v2->t);
+				pixel.q = (fw0 * v0->q) + (fw1 * v1->q) + (fw2 * v2->q);
+				pixel.fog = static_cast<int32>((fw0 * v0->fog) + (fw1 * v1->fog) + (fw2 * v2->fog));
+				ShadePixel(x, y, pixel);
+			}
+			e0 += edge0.stepX;
+			e1 += edge1.stepX;
+			e2 += edge2.stepX;
+		}
+		edge0.value += edge0.stepY;
+		edge1.value += edge1.stepY;
+		edge2.value += edge2.stepY;
+	}
+}
+
+void CRasterizer::DrawSprite(const RECT& clip)
+{
+	const auto& v0 = m_primitive->vertices[0];
+	const auto& v1 = m_primitive->vertices[1];
+
+	int32 left = std::max(clip.left, (std::min(v0.x, v1.x) + 15) >> 4);
+	int32 top = std::max(clip.top, (std::min(v0.y, v1.y) + 15) >> 4);
+	int32 right = std::min(clip.right, (std::max(v0.x, v1.x) + 15) >> 4);
+	int32 bottom = std::min(clip.bottom, (std::max(v0.y, v1.y) + 15) >> 4);
+	if((left >= right) || (top >= bottom)) return;
+
+	//Sprites use the color, depth and fog of the second vertex and texture coordinates
+	//are interpolated along each axis.
+	float u0 = ClampTexCoord(v0.s / v0.q);
+	float u1 = ClampTexCoord(v1.s / v1.q);
+	float t0 = ClampTexCoord(v0.t / v0.q);
+	float t1 = ClampTexCoord(v1.t / v1.q);
+	float dudx = (v1.x != v0.x) ? (u1 - u0) / static_cast<float>(v1.x - v0.x) : 0;
+	float dtdy = (v1.y != v0.y) ? (t1 - t0) / static_cast<float>(v1.y - v0.y) : 0;
+
+	PIXEL pixel;
+	pixel.z = v1.z;
+	pixel.r = static_cast<int32>(v1.r);
+	pixel.g = static_cast<int32>(v1.g);
+	pixel.b = static_cast<int32>(v1.b);
+	pixel.a = static_cast<int32>(v1.a);
+	pixel.q = 1;
+	pixel.fog = static_cast<int32>(v1.fog);
+
+	for(int32 y = top; y < bottom; y++)
+	{
+		pixel.t = t0 + static_cast<float>((y << 4) - v0.y) * dtdy;
+		for(int32 x = left; x < right; x++)
+		{
+			pixel.s = u0 + static_cast<float>((x << 4) - v0.x) * dudx;
+			ShadePixel(x, y, pixel);
+		}
+	}
+}
+
+void CRasterizer::ShadePixel(int32 x, int32 y, const PIXEL& pixel)
+{
+	const auto& state = *m_state;
+	uint32 framePsm = state.frame.nPsm;
+	uint32 frameBufPtr = state.frame.GetBasePtr();
+	uint32 frameBufWidth = state.frame.nWidth;
+	bool frameIs16Bits = (framePsm == CGSHandler::PSMCT16) || (framePsm == CGSHandler::PSMCT16S) ||
+	                     (framePsm == CGSHandler::PSMZ16) || (framePsm == CGSHandler::PSMZ16S);
+	bool frameIs24Bits = (framePsm == CGSHandler::PSMCT24) || (framePsm == CGSHandler::PSMZ24);
+	bool alphaBlending = m_primitive->hasAlphaBlending;
+
+	uint32 dstColor = 0;
+	if(state.test.nDestAlphaEnabled || alphaBlending)
+	{
+		dstColor = ReadColor(m_ram, framePsm, frameBufPtr, frameBufWidth, x, y);
+	}
+
+	if(state.test.nDestAlphaEnabled && !frameIs24Bits)
+	{
+		if((dstColor >> 31) != state.test.nDestAlphaMode) return;
+	}
+
+	int32 r = pixel.r;
+	int32 g = pixel.g;
+	int32 b = pixel.b;
+	int32 a = pixel.a;
+
+	if(m_primitive->hasTexture)
+	{
+		float q = pixel.q;
+		uint32 texel = SampleTexture(ClampTexCoord(pixel.s / q), ClampTexCoord(pixel.t / q));
+		int32 tr = (texel >> 0) & 0xFF;
+		int32 tg = (texel >> 8) & 0xFF;
+		int32 tb = (texel >> 16) & 0xFF;
+		int32 ta = (texel >> 24) & 0xFF;
+		bool useTextureAlpha = state.tex0.nColorComp != 0;
+
+		switch(state.tex0.nFunction)
+		{
+		case CGSHandler::TEX0_FUNCTION_MODULATE:
+			r = std::min((tr * r) >> 7, 0xFF);
+			g = std::min((tg * g) >> 7, 0xFF);
+			b = std::min((tb * b) >> 7, 0xFF);
+			if(useTextureAlpha) a = std::min((ta * a) >> 7, 0xFF);
+			break;
+		case CGSHandler::TEX0_FUNCTION_DECAL:
+			r = tr;
+			g = tg;
+			b = tb;
+			if(useTextureAlpha) a = ta;
+			break;
+		case CGSHandler::TEX0_FUNCTION_HIGHLIGHT:
+			r = std::min(((tr * r) >> 7) + a, 0xFF);
+			g = std::min(((tg * g) >> 7) + a, 0xFF);
+			b = std::min(((tb * b) >> 7) + a, 0xFF);
+			if(useTextureAlpha) a = std::min(ta + a, 0xFF);
+			break;
+		case CGSHandler::TEX0_FUNCTION_HIGHLIGHT2:
+			r = std::min(((tr * r) >> 7) + a, 0xFF);
+			g = std::min(((tg * g) >> 7) + a, 0xFF);
+			b = std::min(((tb * b) >> 7) + a, 0xFF);
+			if(useTextureAlpha) a = ta;
+			break;
+		}
+	}
+
+	if(m_primitive->hasFog)
+	{
+		int32 fog = pixel.fog;
+		r = ((fog * r) + ((0xFF - fog) * static_cast<int32>(state.fogCol.nFCR))) >> 8;
+		g = ((fog * g) + ((0xFF - fog) * static_cast<int32>(state.fogCol.nFCG))) >> 8;
+		b = ((fog * b) + ((0xFF - fog) * static_cast<int32>(state.fogCol.nFCB))) >> 8;
+	}
+
+	bool writeFrame = true;
+	bool writeAlpha = true;
+	bool writeDepth = (state.zbuf.nMask == 0);
+
+	if(state.test.nAlphaEnabled && !TestAlpha(a))
+	{
+		switch(state.test.nAlphaFail)
+		{
+		case CGSHandler::ALPHA_TEST_FAIL_KEEP:
+			return;
+		case CGSHandler::ALPHA_TEST_FAIL_FBONLY:
+			writeDepth = false;
+			break;
+		case CGSHandler::ALPHA_TEST_FAIL_ZBONLY:
+			writeFrame = false;
+			break;
+		case CGSHandler::ALPHA_TEST_FAIL_RGBONLY:
+			writeDepth = false;
+			writeAlpha = false;
+			break;
+		}
+	}
+
+	uint32 zbufPsm = state.zbuf.nPsm | 0x30;
+	uint32 zbufBufPtr = state.zbuf.GetBasePtr();
+	uint32 z = std::min(pixel.z, m_zMax);
+	if(state.test.nDepthEnabled)
+	{
+		switch(state.test.nDepthMethod)
+		{
+		case CGSHandler::DEPTH_TEST_NEVER:
+			return;
+		case CGSHandler::DEPTH_TEST_ALWAYS:
+			break;
+		case CGSHandler::DEPTH_TEST_GEQUAL:
+			if(z < ReadPixel(m_ram, zbufPsm, zbufBufPtr, frameBufWidth, x, y)) return;
+			break;
+		case CGSHandler::DEPTH_TEST_GREATER:
+			if(z <= ReadPixel(m_ram, zbufPsm, zbufBufPtr, frameBufWidth, x, y)) return;
+			break;
+		}
+	}
+
+	if(writeFrame)
+	{
+		if(alphaBlending && !(state.pabe && (a < 0x80)))
+		{
+			int32 dr = (dstColor >> 0) & 0xFF;
+			int32 dg = (dstColor >> 8) & 0xFF;
+			int32 db = (dstColor >> 16) & 0xFF;
+			int32 da = (dstColor >> 24) & 0xFF;
+			const auto& alpha = state.alpha;
+
+			int32 factor = 0;
+			switch(alpha.nC)
+			{
+			case CGSHandler::ALPHABLEND_C_AS:
+				factor = a;
+				break;
+			case CGSHandler::ALPHABLEND_C_AD:
+				factor = da;
+				break;
+			default:
+				factor = alpha.nFix;
+				break;
+			}
+
+			r = (((SelectBlendColor(alpha.nA, r, dr) - SelectBlendColor(alpha.nB, r, dr)) * factor) >> 7) + SelectBlendColor(alpha.nD, r, dr);
+			g = (((SelectBlendColor(alpha.nA, g, dg) - SelectBlendColor(alpha.nB, g, dg)) * factor) >> 7) + SelectBlendColor(alpha.nD, g, dg);
+			b = (((SelectBlendColor(alpha.nA, b, db) - SelectBlendColor(alpha.nB, b, db)) * factor) >> 7) + SelectBlendColor(alpha.nD, b, db);
+
+			if(state.colClamp)
+			{
+				r = std::min(std::max(r, 0), 0xFF);
+				g = std::min(std::max(g, 0), 0xFF);
+				b = std::min(std::max(b, 0), 0xFF);
+			}
+			else
+			{
+				r &= 0xFF;
+				g &= 0xFF;
+				b &= 0xFF;
+			}
+		}
+
+		if(state.fba) a |= 0x80;
+
+		uint32 mask = state.frame.nMask;
+		if(!writeAlpha) mask |= 0xFF000000;
+
+		uint32 color = 0;
+		if(frameIs16Bits)
+		{
+			color = ((r >> 3) << 0) | ((g >> 3) << 5) | ((b >> 3) << 10) | ((a & 0x80) << 8);
+			mask = ((mask >> 3) & 0x001F) | ((mask >> 6) & 0x03E0) | ((mask >> 9) & 0x7C00) | ((mask >> 16) & 0x8000);
+		}
+		else
+		{
+			color = r | (g << 8) | (b << 16) | (a << 24);
+			if(frameIs24Bits) mask |= 0xFF000000;
+		}
+
+		if(mask != 0)
+		{
+			uint32 dstPixel = ReadPixel(m_ram, framePsm, frameBufPtr, frameBufWidth, x, y);
+			color = (color & ~mask) | (dstPixel & mask);
+		}
+		WritePixel(m_ram, framePsm, frameBufPtr, frameBufWidth, x, y, color);
+	}
+
+	if(writeDepth)
+	{
+		WritePixel(m_ram, zbufPsm, zbufBufPtr, frameBufWidth, x, y, z);
+	}
+}
+
+bool CRasterizer::TestAlpha(int32 alpha) const
+{
+	int32 alphaRef = m_state->test.nAlphaRef;
+	switch(m_state->test.nAlphaMethod)
+	{
+	case CGSHandler::ALPHA_TEST_NEVER:
+		return false;
+	case CGSHandler::ALPHA_TEST_ALWAYS:
+		return true;
+	case CGSHandler::ALPHA_TEST_LESS:
+		return alpha < alphaRef;
+	case CGSHandler::ALPHA_TEST_LEQUAL:
+		return alpha <= alphaRef;
+	case CGSHandler::ALPHA_TEST_EQUAL:
+		return alpha == alphaRef;
+	case CGSHandler::ALPHA_TEST_GEQUAL:
+		return alpha >= alphaRef;
+	case CGSHandler::ALPHA_TEST_GREATER:
+		return alpha > alphaRef;
+	case CGSHandler::ALPHA_TEST_NOTEQUAL:
+		return alpha != alphaRef;
+	default:
+		return true;
+	}
+}
+
+uint32 CRasterizer::SampleTexture(float u, float v) const
+{
+	if(!m_state->textureUseLinearFiltering)
+	{
+		return FetchTexel(static_cast<int32>(std::floor(u)), static_cast<int32>(std::floor(v)));
+	}
+
+	//Texel centers are at half coordinates
+	u -= 0.5f;
+	v -= 0.5f;
+	float baseU = std::floor(u);
+	float baseV = std::floor(v);
+	int32 texU = static_cast<int32>(baseU);
+	int32 texV = static_cast<int32>(baseV);
+	uint32 weightU = static_cast<uint32>((u - baseU) * 256.f);
+	uint32 weightV = static_cast<uint32>((v - baseV) * 256.f);
+
+	uint32 texel00 = FetchTexel(texU + 0, texV + 0);
+	uint32 texel10 = FetchTexel(texU + 1, texV + 0);
+	uint32 texel01 = FetchTexel(texU + 0, texV + 1);
+	uint32 texel11 = FetchTexel(texU + 1, texV + 1);
+
+	uint32 result = 0;
+	for(uint32 shift = 0; shift < 32; shift += 8)
+	{
+		uint32 c00 = (texel00 >> shift) & 0xFF;
+		uint32 c10 = (texel10 >> shift) & 0xFF;
+		uint32 c01 = (texel01 >> shift) & 0xFF;
+		uint32 c11 = (texel11 >> shift) & 0xFF;
+		uint32 top = (c00 * (256 - weightU)) + (c10 * weightU);
+		uint32 bottom = (c01 * (256 - weightU)) + (c11 * weightU);
+		uint32 value = ((top * (256 - weightV)) + (bottom * weightV)) >> 16;
+		result |= value << shift;
+	}
+	return result;
+}
+
+uint32 CRasterizer::FetchTexel(int32 u, int32 v) const
+{
+	const auto& state = *m_state;
+	const auto& tex0 = state.tex0;
+	auto clamp = state.clamp;
+
+	u = WrapTexCoord(u, clamp.nWMS, m_texWidth, clamp.GetMinU(), clamp.GetMaxU());
+	v = WrapTexCoord(v, clamp.nWMT, m_texHeight, clamp.GetMinV(), clamp.GetMaxV());
+
+	uint32 bufPtr = tex0.GetBufPtr();
+	uint32 bufWidth = tex0.nBufWidth;
+	uint32 texel = ReadPixel(m_ram, tex0.nPsm, bufPtr, bufWidth, u & 0x7FF, v & 0x7FF);
+
+	switch(tex0.nPsm)
+	{
+	case CGSHandler::PSMCT32:
+	case CGSHandler::PSMZ32:
+		return texel;
+	case CGSHandler::PSMCT24:
+	case CGSHandler::PSMZ24:
+		return ExpandTexel24(texel);
+	case CGSHandler::PSMCT16:
+	case CGSHandler::PSMCT16S:
+	case CGSHandler::PSMZ16:
+	case CGSHandler::PSMZ16S:
+		return ExpandTexel16(texel);
+	case CGSHandler::PSMT8:
+	case CGSHandler::PSMT4:
+	case CGSHandler::PSMT8H:
+	case CGSHandler::PSMT4HL:
+	case CGSHandler::PSMT4HH:
+		return state.clut[texel];
+	default:
+		return 0;
+	}
+}
+
+uint32 CRasterizer::ExpandTexel16(uint32 texel) const
+{
+	const auto& texA = m_state->texA;
+	uint32 color = ConvertColor16To32(texel) & 0x00FFFFFF;
+	uint32 alpha = 0;
+	if(texel & 0x8000)
+	{
+		alpha = texA.nTA1;
+	}
+	else if(!texA.nAEM || (color != 0))
+	{
+		alpha = texA.nTA0;
+	}
+	return color | (alpha << 24);
+}
+
+uint32 CRasterizer::ExpandTexel24(uint32 texel) const
+{
+	const auto& texA = m_state->texA;
+	uint32 alpha = (texA.nAEM && (texel == 0)) ? 0 : texA.nTA0;
+	return texel | (alpha << 24);
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <array>
+#include "../GSHandler.h"
+
+namespace GSH_Software
+{
+	//Pixel rectangle, right and bottom are exclusive
+	struct RECT
+	{
+		int32 left = 0;
+		int32 top = 0;
+		int32 right = 0;
+		int32 bottom = 0;
+	};
+
+	//Snapshot of the registers used by the pixel pipeline
+	struct RENDERSTATE
+	{
+		CGSHandler::FRAME frame;
+		CGSHandler::ZBUF zbuf;
+		CGSHandler::TEX0 tex0;
+		CGSHandler::CLAMP clamp;
+		CGSHandler::ALPHA alpha;
+		CGSHandler::TEST test;
+		CGSHandler::TEXA texA;
+		CGSHandler::FOGCOL fogCol;
+		RECT scissor;
+		bool textureUseLinearFiltering = false;
+		bool colClamp = true;
+		bool pabe = false;
+		bool fba = false;
+		//RGBA32 colors, alpha of 16-bit entries is already expanded using TEXA
+		std::array<uint32, 256> clut;
+	};
+
+	struct VERTEX
+	{
+		//12.4 fixed point, relative to the primitive offset
+		int32 x = 0;
+		int32 y = 0;
+		uint32 z = 0;
+		float r = 0;
+		float g = 0;
+		float b = 0;
+		float a = 0;
+		//Homogeneous texture coordinates, s and t are in texels
+		float s = 0;
+		float t = 0;
+		float q = 1;
+		float fog = 0;
+	};
+
+	struct PRIMITIVE
+	{
+		//One of PRIM_POINT, PRIM_LINE, PRIM_TRIANGLE or PRIM_SPRITE
+		uint32 type = CGSHandler::PRIM_INVALID;
+		uint32 stateIndex = 0;
+		bool hasTexture = false;
+		bool hasFog = false;
+		bool hasAlphaBlending = false;
+		bool hasGouraudShading = false;
+		//In submission order, the last one provides the color of flat shaded primitives
+		VERTEX vertices[3];
+	};
+
+	class CRasterizer
+	{
+	public:
+		CRasterizer(uint8*);
+
+		//Rasterizes the part of the primitive that lies inside the clipping rectangle
+		void DrawPrimitive(const RENDERSTATE&, const PRIMITIVE&, const RECT&);
+
+		//Pixel rectangle covered by the primitive, clipped to the scissor area
+		static RECT GetPrimitiveBounds(const RENDERSTATE&, const PRIMITIVE&);
+
+		//Raw memory accessors, values are the stored bits of the pixel in the specified format
+		static uint32 ReadPixel(const uint8*, uint32 psm, uint32 bufPtr, uint32 bufWidth, uint32 x, uint32 y);
+		static void WritePixel(uint8*, uint32 psm, uint32 bufPtr, uint32 bufWidth, uint32 x, uint32 y, uint32 value);
+
+		//Converts a framebuffer pixel to RGBA32
+		static uint32 ReadColor(const uint8*, uint32 psm, uint32 bufPtr, uint32 bufWidth, uint32 x, uint32 y);
+
+		//Builds the page offset tables used by the memory accessors, must be called before any draw
+		static void InitializeTables();
+
+	private:
+		struct PIXEL
+		{
+			uint32 z;
+			int32 r;
+			int32 g;
+			int32 b;
+			int32 a;
+			float s;
+			float t;
+			float q;
+			int32 fog;
+		};
+
+		void DrawPoint(const RECT&);
+		void DrawLine(const RECT&);
+		void DrawTriangle(const RECT&);
+		void DrawSprite(const RECT&);
+
+		void ShadePixel(int32, int32, const PIXEL&);
+
+		uint32 SampleTexture(float, float) const;
+		uint32 FetchTexel(int32, int32) const;
+		uint32 ExpandTexel16(uint32) const;
+		uint32 ExpandTexel24(uint32) const;
+		bool TestAlpha(int32) const;
+
+		uint8* m_ram = nullptr;
+		const RENDERSTATE* m_state = nullptr;
+		const PRIMITIVE* m_primitive = nullptr;
+		uint32 m_texWidth = 0;
+		uint32 m_texHeight = 0;
+		uint32 m_zMax = 0;
+	};
+}
@@ -5,10 +5,12 @@
 #include "../Log.h"
 #include "../states/MemoryStateFile.h"
 #include "../states/RegisterStateFile.h"
+#include "../states/RawState.h"
 #include "../FrameDump.h"
 #include "../ee/INTC.h"
 #include "GSHandler.h"
 #include "GsPixelFormats.h"
+#include "GsSwizzle.h"
 #include "string_format.h"
 
 //Shadow Hearts 2 looks for this specific value
@@ -70,6 +72,7 @@ CGSHandler::CGSHandler(bool gsThreaded)
     , m_drawCallCount(0)
     , m_pCLUT(nullptr)
     , m_pRAM(nullptr)
+    , m_ramTracker(RAMSIZE, CGsPixelFormats::PAGESIZE)
     , m_frameDump(nullptr)
     , m_loggingEnabled(true)
     , m_gsThreaded(gsThreaded)
@@ -106,6 +109,9 @@ CGSHandler::CGSHandler(bool gsThreaded)
 
 	ResetBase();
 
+	//GS handlers are created on the emulation thread, which issues most of the GS calls
+	m_mailBox.SetProducerThread(std::this_thread::get_id());
+
 	if(m_gsThreaded)
 	{
 		m_thread = std::thread([&]() { ThreadProc(); });
@@ -149,6 +155,7 @@ void CGSHandler::ResetBase()
 	memset(m_nReg, 0, sizeof(uint64) * 0x80);
 	m_nReg[GS_REG_PRMODECONT] = 1;
 	memset(m_pRAM, 0, RAMSIZE);
+	m_ramTracker.MarkAllDirty();
 	memset(m_pCLUT, 0, CLUTSIZE);
 	m_nPMODE = 0;
 	m_nSMODE2 = 0;
@@ -268,6 +275,7 @@ void CGSHandler::SaveState(Framework::CZipArchiveWriter& archive)
 void CGSHandler::LoadState(Framework::CZipArchiveReader& archive)
 {
 	archive.BeginReadFile(STATE_RAM)->Read(GetRam(), RAMSIZE);
+	m_ramTracker.MarkAllDirty();
 	archive.BeginReadFile(STATE_REGS)->Read(m_nReg, sizeof(uint64) * CGSHandler::REGISTER_MAX);
 	archive.BeginReadFile(STATE_TRXCTX)->Read(&m_trxCtx, sizeof(TRXCONTEXT));
 
@@ -288,9 +296,46 @@ void CGSHandler::LoadState(Framework::CZipArchiveReader& archive)
 	}
 }
 
+void CGSHandler::SaveDeviceState(Framework::CStream& stream)
+{
+	RawState::Write(stream, m_nReg);
+	RawState::Write(stream, m_trxCtx);
+	RawState::Write(stream, m_nPMODE);
+	RawState::Write(stream, m_nSMODE2);
+	RawState::Write(stream, m_nDISPFB1.value.q);
+	RawState::Write(stream, m_nDISPLAY1.value.q);
+	RawState::Write(stream, m_nDISPFB2.value.q);
+	RawState::Write(stream, m_nDISPLAY2.value.q);
+	RawState::Write(stream, m_nCSR);
+	RawState::Write(stream, m_nIMR);
+	RawState::Write(stream, m_nSIGLBLID);
+	RawState::Write(stream, m_nCrtMode);
+	RawState::Write(stream, m_nCBP0);
+	RawState::Write(stream, m_nCBP1);
+}
+
+void CGSHandler::LoadDeviceState(Framework::CStream& stream)
+{
+	RawState::Read(stream, m_nReg);
+	RawState::Read(stream, m_trxCtx);
+	RawState::Read(stream, m_nPMODE);
+	RawState::Read(stream, m_nSMODE2);
+	RawState::Read(stream, m_nDISPFB1.value.q);
+	RawState::Read(stream, m_nDISPLAY1.value.q);
+	RawState::Read(stream, m_nDISPFB2.value.q);
+	RawState::Read(stream, m_nDISPLAY2.value.q);
+	RawState::Read(stream, m_nCSR);
+	RawState::Read(stream, m_nIMR);
+	RawState::Read(stream, m_nSIGLBLID);
+	RawState::Read(stream, m_nCrtMode);
+	RawState::Read(stream, m_nCBP0);
+	RawState::Read(stream, m_nCBP1);
+}
+
 void CGSHandler::Copy(const CGSHandler* gs)
 {
 	memcpy(GetRam(), gs->GetRam(), RAMSIZE);
+	m_ramTracker.MarkAllDirty();
 	memcpy(m_nReg, gs->m_nReg, sizeof(uint64) * CGSHandler::REGISTER_MAX);
 	m_trxCtx = gs->m_trxCtx;
 
@@ -489,6 +534,11 @@ void CGSHandler::Flip(bool showOnly)
 	SendGSCall(std::bind(&CGSHandler::FlipImpl, this), true, true);
 }
 
+void CGSHandler::WaitForIdle()
+{
+	SendGSCall([]() {}, true);
+}
+
 void CGSHandler::FlipImpl()
 {
 	OnFlipComplete();
@@ -509,6 +559,11 @@ uint8* CGSHandler::GetRam() const
 	return m_pRAM;
 }
 
+CDirtyPageTracker* CGSHandler::GetRamTracker()
+{
+	return nullptr;
+}
+
 uint64* CGSHandler::GetRegisters()
 {
 	return m_nReg;
@@ -827,6 +882,37 @@ void CGSHandler::TransferWrite(const uint8* imageData, uint32 length)
 {
 	auto bltBuf = make_convertible<BITBLTBUF>(m_nReg[GS_REG_BITBLTBUF]);
 	m_trxCtx.nDirty |= ((this)->*(m_transferWriteHandlers[bltBuf.nDstPsm]))(imageData, length);
+
+	auto trxReg = make_convertible<TRXREG>(m_nReg[GS_REG_TRXREG]);
+	auto trxPos = make_convertible<TRXPOS>(m_nReg[GS_REG_TRXPOS]);
+	MarkRamDirty(bltBuf.GetDstPtr(), bltBuf.nDstWidth, bltBuf.nDstPsm, trxPos.nDSAX, trxPos.nDSAY, trxReg.nRRW, trxReg.nRRH);
+}
+
+//Marks the pages covered by a rectangle of a buffer, using the same page numbering as the pixel indexors
+void CGSHandler::MarkRamDirty(uint32 bufPtr, uint32 bufWidth, uint32 psm, uint32 x, uint32 y, uint32 width, uint32 height)
+{
+	if((width == 0) || (height == 0)) return;
+
+	auto pageSize = CGsPixelFormats::GetPsmPageSize(psm);
+	auto getPageNum =
+	    [&](uint32 pageX, uint32 pageY) {
+		    return (pageX / pageSize.first) + (pageY / pageSize.second) * (bufWidth * 64) / pageSize.first;
+	    };
+
+	uint32 firstPage = getPageNum(x, y);
+	uint32 lastPage = getPageNum(x + width - 1, y + height - 1);
+	m_ramTracker.MarkDirty(bufPtr + (firstPage * CGsPixelFormats::PAGESIZE), (lastPage - firstPage + 1) * CGsPixelFormats::PAGESIZE);
+}
+
+//Checks if the next BLOCKHEIGHT rows of a transfer can be moved as whole blocks
+template <typename Storage>
+static bool IsBlockRowTransfer(uint32 posX, uint32 posY, uint32 rrx, uint32 rrw, uint32 remainingPixels)
+{
+	return (rrx == 0) && (rrw != 0) &&
+	       ((posX % Storage::BLOCKWIDTH) == 0) && ((posY % Storage::BLOCKHEIGHT) == 0) &&
+	       ((rrw % Storage::BLOCKWIDTH) == 0) &&
+	       ((posX + rrw) <= 2048) && ((posY + Storage::BLOCKHEIGHT) <= 2048) &&
+	       (remainingPixels >= (rrw * Storage::BLOCKHEIGHT));
 }
 
 bool CGSHandler::TransferWriteHandlerInvalid(const void* pData, uint32 nLength)
@@ -849,8 +935,18 @@ bool CGSHandler::TransferWriteHandlerGeneric(const void* pData, uint32 nLength)
 
 	auto pSrc = reinterpret_cast<const typename Storage::Unit*>(pData);
 
-	for(unsigned int i = 0; i < nLength; i++)
+	for(unsigned int i = 0; i < nLength;)
 	{
+		if(IsBlockRowTransfer<Storage>(trxPos.nDSAX, m_trxCtx.nRRY + trxPos.nDSAY, m_trxCtx.nRRX, trxReg.nRRW, nLength - i))
+		{
+			uint32 pitch = trxReg.nRRW * sizeof(typename Storage::Unit);
+			nDirty |= GsSwizzle::WriteBlockRow(Indexor, trxPos.nDSAX, m_trxCtx.nRRY + trxPos.nDSAY, trxReg.nRRW,
+			                                   reinterpret_cast<const uint8*>(pSrc + i), pitch, Storage::BLOCKWIDTH * sizeof(typename Storage::Unit));
+			i += trxReg.nRRW * Storage::BLOCKHEIGHT;
+			m_trxCtx.nRRY += Storage::BLOCKHEIGHT;
+			continue;
+		}
+
 		uint32 nX = (m_trxCtx.nRRX + trxPos.nDSAX) % 2048;
 		uint32 nY = (m_trxCtx.nRRY + trxPos.nDSAY) % 2048;
 
@@ -861,6 +957,7 @@ bool CGSHandler::TransferWriteHandlerGeneric(const void* pData, uint32 nLength)
 			(*pPixel) = pSrc[i];
 			nDirty = true;
 		}
+		i++;
 
 		m_trxCtx.nRRX++;
 		if(m_trxCtx.nRRX == trxReg.nRRW)
@@ -915,8 +1012,18 @@ bool CGSHandler::TransferWriteHandlerPSMT4(const void* pData, uint32 nLength)
 
 	auto pSrc = reinterpret_cast<const uint8*>(pData);
 
-	for(unsigned int i = 0; i < nLength; i++)
+	for(unsigned int i = 0; i < nLength;)
 	{
+		typedef CGsPixelFormats::STORAGEPSMT4 Storage;
+		if(IsBlockRowTransfer<Storage>(trxPos.nDSAX, m_trxCtx.nRRY + trxPos.nDSAY, m_trxCtx.nRRX, trxReg.nRRW, (nLength - i) * 2))
+		{
+			dirty |= GsSwizzle::WriteBlockRow(Indexor, trxPos.nDSAX, m_trxCtx.nRRY + trxPos.nDSAY, trxReg.nRRW,
+			                                  pSrc + i, trxReg.nRRW / 2, Storage::BLOCKWIDTH / 2);
+			i += (trxReg.nRRW * Storage::BLOCKHEIGHT) / 2;
+			m_trxCtx.nRRY += Storage::BLOCKHEIGHT;
+			continue;
+		}
+
 		uint8 nPixel[2];
 
 		nPixel[0] = (pSrc[i] >> 0) & 0x0F;
@@ -941,6 +1048,7 @@ bool CGSHandler::TransferWriteHandlerPSMT4(const void* pData, uint32 nLength)
 				m_trxCtx.nRRY++;
 			}
 		}
+		i++;
 	}
 
 	return dirty;
@@ -1045,12 +1153,23 @@ void CGSHandler::TransferReadHandlerGeneric(void* buffer, uint32 length)
 	auto typedBuffer = reinterpret_cast<typename Storage::Unit*>(buffer);
 
 	CGsPixelFormats::CPixelIndexor<Storage> indexor(GetRam(), trxBuf.GetSrcPtr(), trxBuf.nSrcWidth);
-	for(uint32 i = 0; i < typedLength; i++)
+	for(uint32 i = 0; i < typedLength;)
 	{
+		if(IsBlockRowTransfer<Storage>(trxPos.nSSAX, m_trxCtx.nRRY + trxPos.nSSAY, m_trxCtx.nRRX, trxReg.nRRW, typedLength - i))
+		{
+			uint32 pitch = trxReg.nRRW * sizeof(typename Storage::Unit);
+			GsSwizzle::ReadBlockRow(indexor, trxPos.nSSAX, m_trxCtx.nRRY + trxPos.nSSAY, trxReg.nRRW,
+			                        reinterpret_cast<uint8*>(typedBuffer + i), pitch, Storage::BLOCKWIDTH * sizeof(typename Storage::Unit));
+			i += trxReg.nRRW * Storage::BLOCKHEIGHT;
+			m_trxCtx.nRRY += Storage::BLOCKHEIGHT;
+			continue;
+		}
+
 		uint32 x = (m_trxCtx.nRRX + trxPos.nSSAX) % 2048;
 		uint32 y = (m_trxCtx.nRRY + trxPos.nSSAY) % 2048;
 		auto pixel = indexor.GetPixel(x, y);
 		typedBuffer[i] = pixel;
+		i++;
 		m_trxCtx.nRRX++;
 		if(m_trxCtx.nRRX == trxReg.nRRW)
 		{
@@ -1905,11 +2024,6 @@ void CGSHandler::SendGSCall(const CMailBox::FunctionType& function, bool waitFor
 	m_mailBox.SendCall(function, waitForCompletion);
 }
 
-void CGSHandler::SendGSCall(CMailBox::FunctionType&& function)
-{
-	m_mailBox.SendCall(std::move(function));
-}
-
 void CGSHandler::ProcessSingleFrame()
 {
 	assert(!m_gsThreaded);
@@ -12,6 +12,7 @@
 #include "Convertible.h"
 #include "../MailBox.h"
 #include "../Integer64.h"
+#include "../DirtyPageTracker.h"
 #include "zip/ZipArchiveWriter.h"
 #include "zip/ZipArchiveReader.h"
 
@@ -772,6 +773,11 @@ public:
 
 	virtual void SaveState(Framework::CZipArchiveWriter&);
 	virtual void LoadState(Framework::CZipArchiveReader&);
+
+	//Raw binary state of everything but RAM, used for rewind
+	virtual void SaveDeviceState(Framework::CStream&);
+	virtual void LoadDeviceState(Framework::CStream&);
+
 	void Copy(const CGSHandler*);
 
 	void SetFrameDump(CFrameDump*);
@@ -801,11 +807,14 @@ public:
 	virtual void ProcessLocalToLocalTransfer() = 0;
 	virtual void ProcessClutTransfer(uint32, uint32) = 0;
 	void Flip(bool showOnly = false);
+	void WaitForIdle();
 	virtual void ReadFramebuffer(uint32, uint32, void*) = 0;
 
 	void MakeLinearCLUT(const TEX0&, std::array<uint32, 256>&) const;
 
 	virtual uint8* GetRam() const;
+	//Null if RAM is written by paths that can't be tracked (ie.: rasterization)
+	virtual CDirtyPageTracker* GetRamTracker();
 	uint64* GetRegisters();
 
 	uint64 GetSMODE2() const;
@@ -945,6 +954,8 @@ protected:
 	virtual void BeginTransferWrite();
 	virtual void TransferWrite(const uint8*, uint32);
 
+	void MarkRamDirty(uint32, uint32, uint32, uint32, uint32, uint32, uint32);
+
 	TRANSFERWRITEHANDLER m_transferWriteHandlers[PSM_MAX];
 	TRANSFERREADHANDLER m_transferReadHandlers[PSM_MAX];
 
@@ -974,7 +985,12 @@ protected:
 	static bool IsCompatibleFramebufferPSM(unsigned int, unsigned int);
 
 	void SendGSCall(const CMailBox::FunctionType&, bool = false, bool = false);
-	void SendGSCall(CMailBox::FunctionType&&);
+
+	template <typename Function>
+	void SendGSCall(Function&& function)
+	{
+		m_mailBox.PostCall(std::forward<Function>(function));
+	}
 
 	PRESENTATION_VIEWPORT GetPresentationViewport() const;
 
@@ -997,6 +1013,7 @@ protected:
 	uint64 m_nReg[REGISTER_MAX];
 
 	uint8* m_pRAM;
+	CDirtyPageTracker m_ramTracker;
 
 	uint16* m_pCLUT;
 	uint32 m_nCBP0;
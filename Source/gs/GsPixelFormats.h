@@ -191,6 +191,39 @@ public:
 		typedef uint16 Unit;
 	};
 
+	struct STORAGEPSMZ16S
+	{
+		enum PAGEWIDTH
+		{
+			PAGEWIDTH = 64
+		};
+		enum PAGEHEIGHT
+		{
+			PAGEHEIGHT = 64
+		};
+		enum BLOCKWIDTH
+		{
+			BLOCKWIDTH = 16
+		};
+		enum BLOCKHEIGHT
+		{
+			BLOCKHEIGHT = 8
+		};
+		enum COLUMNWIDTH
+		{
+			COLUMNWIDTH = 16
+		};
+		enum COLUMNHEIGHT
+		{
+			COLUMNHEIGHT = 2
+		};
+
+		static const int m_nBlockSwizzleTable[8][4];
+		static const int m_nColumnSwizzleTable[2][16];
+
+		typedef uint16 Unit;
+	};
+
 	struct STORAGEPSMT8
 	{
 		enum PAGEWIDTH
@@ -297,6 +330,18 @@ public:
 			return reinterpret_cast<typename Storage::Unit*>(pixelAddr);
 		}
 
+		//Address of the block containing (nX, nY)
+		uint8* GetBlockAddress(unsigned int nX, unsigned int nY)
+		{
+			uint32 pageNum = (nX / Storage::PAGEWIDTH) + (nY / Storage::PAGEHEIGHT) * (m_nWidth * 64) / Storage::PAGEWIDTH;
+
+			nX %= Storage::PAGEWIDTH;
+			nY %= Storage::PAGEHEIGHT;
+
+			uint32 blockNum = Storage::m_nBlockSwizzleTable[nY / Storage::BLOCKHEIGHT][nX / Storage::BLOCKWIDTH];
+			return m_pMemory + ((m_nPointer + (pageNum * PAGESIZE) + (blockNum * BLOCKSIZE)) & (CGSHandler::RAMSIZE - 1));
+		}
+
 		static uint32* GetPageOffsets()
 		{
 			BuildPageOffsetTable();
@@ -0,0 +1,511 @@
+#include <cstring>
+#include <type_traits>
+#include "GsSwizzle.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define GSSWIZZLE_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define GSSWIZZLE_NEON
+#include <arm_neon.h>
+#endif
+
+using namespace GsSwizzle;
+
+typedef CGsPixelFormats::STORAGEPSMCT32 STORAGEPSMCT32;
+typedef CGsPixelFormats::STORAGEPSMCT16 STORAGEPSMCT16;
+typedef CGsPixelFormats::STORAGEPSMCT16S STORAGEPSMCT16S;
+typedef CGsPixelFormats::STORAGEPSMT8 STORAGEPSMT8;
+typedef CGsPixelFormats::STORAGEPSMT4 STORAGEPSMT4;
+
+static bool UpdateColumn(uint8* column, const uint8* values)
+{
+	if(memcmp(column, values, CGsPixelFormats::COLUMNSIZE) == 0)
+	{
+		return false;
+	}
+	memcpy(column, values, CGsPixelFormats::COLUMNSIZE);
+	return true;
+}
+
+#if defined(GSSWIZZLE_SSE2) || defined(GSSWIZZLE_NEON)
+
+//Columns are made of 16 words, the words of even rows (W) and odd rows (V) are interleaved 2 by 2:
+//W0 W1 V0 V1 W2 W3 V2 V3 W4 W5 V4 V5 W6 W7 V6 V7
+//PSMT8 and PSMT4 words are made of pixels from rows 0 and 2 (or 1 and 3), with every other column
+//having the pixels of one of the rows rotated by 4 inside each group of 8.
+
+#if defined(GSSWIZZLE_SSE2)
+
+typedef __m128i Vector;
+
+static Vector Load(const uint8* src)
+{
+	return _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+}
+
+static void Store(uint8* dst, Vector value)
+{
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), value);
+}
+
+static Vector InterleaveLo64(Vector a, Vector b)
+{
+	return _mm_unpacklo_epi64(a, b);
+}
+
+static Vector InterleaveHi64(Vector a, Vector b)
+{
+	return _mm_unpackhi_epi64(a, b);
+}
+
+static Vector InterleaveLo16(Vector a, Vector b)
+{
+	return _mm_unpacklo_epi16(a, b);
+}
+
+static Vector InterleaveHi16(Vector a, Vector b)
+{
+	return _mm_unpackhi_epi16(a, b);
+}
+
+static Vector InterleaveLo8(Vector a, Vector b)
+{
+	return _mm_unpacklo_epi8(a, b);
+}
+
+static Vector InterleaveHi8(Vector a, Vector b)
+{
+	return _mm_unpackhi_epi8(a, b);
+}
+
+static Vector EvenElements16(Vector a, Vector b)
+{
+	a = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+	b = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+	return _mm_packs_epi32(a, b);
+}
+
+static Vector OddElements16(Vector a, Vector b)
+{
+	return _mm_packs_epi32(_mm_srai_epi32(a, 16), _mm_srai_epi32(b, 16));
+}
+
+static Vector EvenElements8(Vector a, Vector b)
+{
+	const __m128i mask = _mm_set1_epi16(0x00FF);
+	return _mm_packus_epi16(_mm_and_si128(a, mask), _mm_and_si128(b, mask));
+}
+
+static Vector OddElements8(Vector a, Vector b)
+{
+	return _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8));
+}
+
+//Swaps every group of 4 bytes with its neighbour
+static Vector RotateGroups(Vector a)
+{
+	return _mm_shuffle_epi32(a, _MM_SHUFFLE(2, 3, 0, 1));
+}
+
+static Vector LowNibbles(Vector a)
+{
+	return _mm_and_si128(a, _mm_set1_epi8(0x0F));
+}
+
+static Vector HighNibbles(Vector a)
+{
+	return _mm_and_si128(_mm_srli_epi16(a, 4), _mm_set1_epi8(0x0F));
+}
+
+static Vector CombineNibbles(Vector lo, Vector hi)
+{
+	return _mm_or_si128(lo, _mm_slli_epi16(hi, 4));
+}
+
+#else
+
+typedef uint8x16_t Vector;
+
+static Vector Load(const uint8* src)
+{
+	return vld1q_u8(src);
+}
+
+static void Store(uint8* dst, Vector value)
+{
+	vst1q_u8(dst, value);
+}
+
+static Vector InterleaveLo64(Vector a, Vector b)
+{
+	return vcombine_u8(vget_low_u8(a), vget_low_u8(b));
+}
+
+static Vector InterleaveHi64(Vector a, Vector b)
+{
+	return vcombine_u8(vget_high_u8(a), vget_high_u8(b));
+}
+
+static Vector InterleaveLo16(Vector a, Vector b)
+{
+	return vreinterpretq_u8_u16(vzipq_u16(vreinterpretq_u16_u8(a), vreinterpretq_u16_u8(b)).val[0]);
+}
+
+static Vector InterleaveHi16(Vector a, Vector b)
+{
+	return vreinterpretq_u8_u16(vzipq_u16(vreinterpretq_u16_u8(a), vreinterpretq_u16_u8(b)).val[1]);
+}
+
+static Vector InterleaveLo8(Vector a, Vector b)
+{
+	return vzipq_u8(a, b).val[0];
+}
+
+static Vector InterleaveHi8(Vector a, Vector b)
+{
+	return vzipq_u8(a, b).val[1];
+}
+
+static Vector EvenElements16(Vector a, Vector b)
+{
+	return vreinterpretq_u8_u16(vuzpq_u16(vreinterpretq_u16_u8(a), vreinterpretq_u16_u8(b)).val[0]);
+}
+
+static Vector OddElements16(Vector a, Vector b)
+{
+	return vreinterpretq_u8_u16(vuzpq_u16(vreinterpretq_u16_u8(a), vreinterpretq_u16_u8(b)).val[1]);
+}
+
+static Vector EvenElements8(Vector a, Vector b)
+{
+	return vuzpq_u8(a, b).val[0];
+}
+
+static Vector OddElements8(Vector a, Vector b)
+{
+	return vuzpq_u8(a, b).val[1];
+}
+
+//Swaps every group of 4 bytes with its neighbour
+static Vector RotateGroups(Vector a)
+{
+	return vreinterpretq_u8_u32(vrev64q_u32(vreinterpretq_u32_u8(a)));
+}
+
+static Vector LowNibbles(Vector a)
+{
+	return vandq_u8(a, vdupq_n_u8(0x0F));
+}
+
+static Vector HighNibbles(Vector a)
+{
+	return vshrq_n_u8(a, 4);
+}
+
+static Vector CombineNibbles(Vector lo, Vector hi)
+{
+	return vorrq_u8(lo, vshlq_n_u8(hi, 4));
+}
+
+#endif
+
+static bool WriteWords(uint8* column, Vector evenLo, Vector evenHi, Vector oddLo, Vector oddHi)
+{
+	alignas(16) uint8 values[CGsPixelFormats::COLUMNSIZE];
+	Store(values + 0x00, InterleaveLo64(evenLo, oddLo));
+	Store(values + 0x10, InterleaveHi64(evenLo, oddLo));
+	Store(values + 0x20, InterleaveLo64(evenHi, oddHi));
+	Store(values + 0x30, InterleaveHi64(evenHi, oddHi));
+	return UpdateColumn(column, values);
+}
+
+static void ReadWords(const uint8* column, Vector& evenLo, Vector& evenHi, Vector& oddLo, Vector& oddHi)
+{
+	Vector value0 = Load(column + 0x00);
+	Vector value1 = Load(column + 0x10);
+	Vector value2 = Load(column + 0x20);
+	Vector value3 = Load(column + 0x30);
+	evenLo = InterleaveLo64(value0, value1);
+	oddLo = InterleaveHi64(value0, value1);
+	evenHi = InterleaveLo64(value2, value3);
+	oddHi = InterleaveHi64(value2, value3);
+}
+
+static bool WriteColumn16(uint8* column, const uint8* image, uint32 pitch)
+{
+	Vector row0Lo = Load(image + 0x00);
+	Vector row0Hi = Load(image + 0x10);
+	Vector row1Lo = Load(image + pitch + 0x00);
+	Vector row1Hi = Load(image + pitch + 0x10);
+	//Words are made of pixels x and x + 8
+	return WriteWords(column,
+	                  InterleaveLo16(row0Lo, row0Hi), InterleaveHi16(row0Lo, row0Hi),
+	                  InterleaveLo16(row1Lo, row1Hi), InterleaveHi16(row1Lo, row1Hi));
+}
+
+static void ReadColumn16(const uint8* column, uint8* image, uint32 pitch)
+{
+	Vector evenLo, evenHi, oddLo, oddHi;
+	ReadWords(column, evenLo, evenHi, oddLo, oddHi);
+	Store(image + 0x00, EvenElements16(evenLo, evenHi));
+	Store(image + 0x10, OddElements16(evenLo, evenHi));
+	Store(image + pitch + 0x00, EvenElements16(oddLo, oddHi));
+	Store(image + pitch + 0x10, OddElements16(oddLo, oddHi));
+}
+
+template <>
+bool GsSwizzle::WriteColumn<STORAGEPSMCT32>(uint8* column, const uint8* image, uint32 pitch, uint32)
+{
+	return WriteWords(column,
+	                  Load(image + 0x00), Load(image + 0x10),
+	                  Load(image + pitch + 0x00), Load(image + pitch + 0x10));
+}
+
+template <>
+void GsSwizzle::ReadColumn<STORAGEPSMCT32>(const uint8* column, uint8* image, uint32 pitch, uint32)
+{
+	Vector evenLo, evenHi, oddLo, oddHi;
+	ReadWords(column, evenLo, evenHi, oddLo, oddHi);
+	Store(image + 0x00, evenLo);
+	Store(image + 0x10, evenHi);
+	Store(image + pitch + 0x00, oddLo);
+	Store(image + pitch + 0x10, oddHi);
+}
+
+template <>
+bool GsSwizzle::WriteColumn<STORAGEPSMCT16>(uint8* column, const uint8* image, uint32 pitch, uint32)
+{
+	return WriteColumn16(column, image, pitch);
+}
+
+template <>
+void GsSwizzle::ReadColumn<STORAGEPSMCT16>(const uint8* column, uint8* image, uint32 pitch, uint32)
+{
+	ReadColumn16(column, image, pitch);
+}
+
+template <>
+bool GsSwizzle::WriteColumn<STORAGEPSMCT16S>(uint8* column, const uint8* image, uint32 pitch, uint32)
+{
+	return WriteColumn16(column, image, pitch);
+}
+
+template <>
+void GsSwizzle::ReadColumn<STORAGEPSMCT16S>(const uint8* column, uint8* image, uint32 pitch, uint32)
+{
+	ReadColumn16(column, image, pitch);
+}
+
+template <>
+bool GsSwizzle::WriteColumn<STORAGEPSMT8>(uint8* column, const uint8* image, uint32 pitch, uint32 columnIndex)
+{
+	Vector rows[4];
+	for(uint32 i = 0; i < 4; i++)
+	{
+		rows[i] = Load(image + (i * pitch));
+	}
+	uint32 rotatedRow = (columnIndex & 1) ? 0 : 2;
+	rows[rotatedRow + 0] = RotateGroups(rows[rotatedRow + 0]);
+	rows[rotatedRow + 1] = RotateGroups(rows[rotatedRow + 1]);
+
+	//Words are made of pixels x and x + 8 from rows y and y + 2
+	Vector even0 = InterleaveLo8(rows[0], rows[2]);
+	Vector even1 = InterleaveHi8(rows[0], rows[2]);
+	Vector odd0 = InterleaveLo8(rows[1], rows[3]);
+	Vector odd1 = InterleaveHi8(rows[1], rows[3]);
+	return WriteWords(column,
+	                  InterleaveLo16(even0, even1), InterleaveHi16(even0, even1),
+	                  InterleaveLo16(odd0, odd1), InterleaveHi16(odd0, odd1));
+}
+
+template <>
+void GsSwizzle::ReadColumn<STORAGEPSMT8>(const uint8* column, uint8* image, uint32 pitch, uint32 columnIndex)
+{
+	Vector evenLo, evenHi, oddLo, oddHi;
+	ReadWords(column, evenLo, evenHi, oddLo, oddHi);
+
+	Vector even0 = EvenElements16(evenLo, evenHi);
+	Vector even1 = OddElements16(evenLo, evenHi);
+	Vector odd0 = EvenElements16(oddLo, oddHi);
+	Vector odd1 = OddElements16(oddLo, oddHi);
+
+	Vector rows[4];
+	rows[0] = EvenElements8(even0, even1);
+	rows[2] = OddElements8(even0, even1);
+	rows[1] = EvenElements8(odd0, odd1);
+	rows[3] = OddElements8(odd0, odd1);
+
+	uint32 rotatedRow = (columnIndex & 1) ? 0 : 2;
+	rows[rotatedRow + 0] = RotateGroups(rows[rotatedRow + 0]);
+	rows[rotatedRow + 1] = RotateGroups(rows[rotatedRow + 1]);
+
+	for(uint32 i = 0; i < 4; i++)
+	{
+		Store(image + (i * pitch), rows[i]);
+	}
+}
+
+template <>
+bool GsSwizzle::WriteColumn<STORAGEPSMT4>(uint8* column, const uint8* image, uint32 pitch, uint32 columnIndex)
+{
+	//Expand every row to one pixel per byte
+	Vector rows[4][2];
+	for(uint32 i = 0; i < 4; i++)
+	{
+		Vector packed = Load(image + (i * pitch));
+		Vector lo = LowNibbles(packed);
+		Vector hi = HighNibbles(packed);
+		rows[i][0] = InterleaveLo8(lo, hi);
+		rows[i][1] = InterleaveHi8(lo, hi);
+	}
+	uint32 rotatedRow = (columnIndex & 1) ? 0 : 2;
+	for(uint32 i = 0; i < 2; i++)
+	{
+		rows[rotatedRow + 0][i] = RotateGroups(rows[rotatedRow + 0][i]);
+		rows[rotatedRow + 1][i] = RotateGroups(rows[rotatedRow + 1][i]);
+	}
+
+	//Bytes are made of pixels from rows y and y + 2, words of pixels x, x + 8, x + 16 and x + 24
+	Vector words[2][2];
+	for(uint32 i = 0; i < 2; i++)
+	{
+		Vector bytes0 = CombineNibbles(rows[i][0], rows[i + 2][0]);
+		Vector bytes1 = CombineNibbles(rows[i][1], rows[i + 2][1]);
+		Vector pairs0 = InterleaveLo8(bytes0, InterleaveHi64(bytes0, bytes0));
+		Vector pairs1 = InterleaveLo8(bytes1, InterleaveHi64(bytes1, bytes1));
+		words[i][0] = InterleaveLo16(pairs0, pairs1);
+		words[i][1] = InterleaveHi16(pairs0, pairs1);
+	}
+	return WriteWords(column, words[0][0], words[0][1], words[1][0], words[1][1]);
+}
+
+#else
+
+//Generic versions, using offsets from the first columns of the page offset tables.
+//Offsets are in bytes, except for PSMT4 where they are in nibbles.
+template <typename Storage>
+struct COLUMNOFFSETS
+{
+	COLUMNOFFSETS()
+	{
+		auto pageOffsets = CGsPixelFormats::CPixelIndexor<Storage>::GetPageOffsets();
+		uint32 columnScale = std::is_same<Storage, STORAGEPSMT4>::value ? 2 : 1;
+		for(uint32 parity = 0; parity < 2; parity++)
+		{
+			for(uint32 y = 0; y < Storage::COLUMNHEIGHT; y++)
+			{
+				for(uint32 x = 0; x < Storage::COLUMNWIDTH; x++)
+				{
+					uint32 pageY = (parity * Storage::COLUMNHEIGHT) + y;
+					offsets[parity][y][x] = pageOffsets[(pageY * Storage::PAGEWIDTH) + x] - (parity * CGsPixelFormats::COLUMNSIZE * columnScale);
+				}
+			}
+		}
+	}
+
+	uint32 offsets[2][Storage::COLUMNHEIGHT][Storage::COLUMNWIDTH];
+};
+
+template <typename Storage>
+static bool WriteColumnGeneric(uint8* column, const uint8* image, uint32 pitch, uint32 columnIndex)
+{
+	typedef typename Storage::Unit Unit;
+	static const COLUMNOFFSETS<Storage> columnOffsets;
+	const auto& offsets = columnOffsets.offsets[columnIndex & 1];
+	alignas(16) uint8 values[CGsPixelFormats::COLUMNSIZE];
+	for(uint32 y = 0; y < Storage::COLUMNHEIGHT; y++)
+	{
+		auto row = reinterpret_cast<const Unit*>(image + (y * pitch));
+		for(uint32 x = 0; x < Storage::COLUMNWIDTH; x++)
+		{
+			*reinterpret_cast<Unit*>(values + offsets[y][x]) = row[x];
+		}
+	}
+	return UpdateColumn(column, values);
+}
+
+template <typename Storage>
+static void ReadColumnGeneric(const uint8* column, uint8* image, uint32 pitch, uint32 columnIndex)
+{
+	typedef typename Storage::Unit Unit;
+	static const COLUMNOFFSETS<Storage> columnOffsets;
+	const auto& offsets = columnOffsets.offsets[columnIndex & 1];
+	for(uint32 y = 0; y < Storage::COLUMNHEIGHT; y++)
+	{
+		auto row = reinterpret_cast<Unit*>(image + (y * pitch));
+		for(uint32 x = 0; x < Storage::COLUMNWIDTH; x++)
+		{
+			row[x] = *reinterpret_cast<const Unit*>(column + offsets[y][x]);
+		}
+	}
+}
+
+template <>
+bool GsSwizzle::WriteColumn<STORAGEPSMCT32>(uint8* column, const uint8* image, uint32 pitch, uint32 columnIndex)
+{
+	return WriteColumnGeneric<STORAGEPSMCT32>(column, image, pitch, columnIndex);
+}
+
+template <>
+void GsSwizzle::ReadColumn<STORAGEPSMCT32>(const uint8* column, uint8* image, uint32 pitch, uint32 columnIndex)
+{
+	ReadColumnGeneric<STORAGEPSMCT32>(column, image, pitch, columnIndex);
+}
+
+template <>
+bool GsSwizzle::WriteColumn<STORAGEPSMCT16>(uint8* column, const uint8* image, uint32 pitch, uint32 columnIndex)
+{
+	return WriteColumnGeneric<STORAGEPSMCT16>(column, image, pitch, columnIndex);
+}
+
+template <>
+void GsSwizzle::ReadColumn<STORAGEPSMCT16>(const uint8* column, uint8* image, uint32 pitch, uint32 columnIndex)
+{
+	ReadColumnGeneric<STORAGEPSMCT16>(column, image, pitch, columnIndex);
+}
+
+template <>
+bool GsSwizzle::WriteColumn<STORAGEPSMCT16S>(uint8* column, const uint8* image, uint32 pitch, uint32 columnIndex)
+{
+	return WriteColumnGeneric<STORAGEPSMCT16S>(column, image, pitch, columnIndex);
+}
+
+template <>
+void GsSwizzle::ReadColumn<STORAGEPSMCT16S>(const uint8* column, uint8* image, uint32 pitch, uint32 columnIndex)
+{
+	ReadColumnGeneric<STORAGEPSMCT16S>(column, image, pitch, columnIndex);
+}
+
+template <>
+bool GsSwizzle::WriteColumn<STORAGEPSMT8>(uint8* column, const uint8* image, uint32 pitch, uint32 columnIndex)
+{
+	return WriteColumnGeneric<STORAGEPSMT8>(column, image, pitch, columnIndex);
+}
+
+template <>
+void GsSwizzle::ReadColumn<STORAGEPSMT8>(const uint8* column, uint8* image, uint32 pitch, uint32 columnIndex)
+{
+	ReadColumnGeneric<STORAGEPSMT8>(column, image, pitch, columnIndex);
+}
+
+template <>
+bool GsSwizzle::WriteColumn<STORAGEPSMT4>(uint8* column, const uint8* image, uint32 pitch, uint32 columnIndex)
+{
+	static const COLUMNOFFSETS<STORAGEPSMT4> columnOffsets;
+	const auto& offsets = columnOffsets.offsets[columnIndex & 1];
+	alignas(16) uint8 values[CGsPixelFormats::COLUMNSIZE] = {};
+	for(uint32 y = 0; y < STORAGEPSMT4::COLUMNHEIGHT; y++)
+	{
+		const uint8* row = image + (y * pitch);
+		for(uint32 x = 0; x < STORAGEPSMT4::COLUMNWIDTH; x++)
+		{
+			uint8 pixel = (row[x / 2] >> ((x & 1) * 4)) & 0x0F;
+			uint32 nibble = offsets[y][x];
+			values[nibble / 2] |= pixel << ((nibble & 1) * 4);
+		}
+	}
+	return UpdateColumn(column, values);
+}
+
+#endif
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "Types.h"
+#include "GsPixelFormats.h"
+
+//Moves whole columns (64 bytes, 2 or 4 rows of a block) between GS memory and a linear image.
+//Used by transfers that cover complete blocks, other transfers go through CPixelIndexor.
+namespace GsSwizzle
+{
+	enum
+	{
+		COLUMNCOUNT = CGsPixelFormats::BLOCKSIZE / CGsPixelFormats::COLUMNSIZE,
+	};
+
+	//'pitch' is the distance in bytes between two image rows, 'columnIndex' is the column's index in its block.
+	//Returns true if the column's contents were modified.
+	template <typename Storage>
+	bool WriteColumn(uint8* column, const uint8* image, uint32 pitch, uint32 columnIndex);
+
+	template <typename Storage>
+	void ReadColumn(const uint8* column, uint8* image, uint32 pitch, uint32 columnIndex);
+
+	template <>
+	bool WriteColumn<CGsPixelFormats::STORAGEPSMCT32>(uint8*, const uint8*, uint32, uint32);
+	template <>
+	bool WriteColumn<CGsPixelFormats::STORAGEPSMCT16>(uint8*, const uint8*, uint32, uint32);
+	template <>
+	bool WriteColumn<CGsPixelFormats::STORAGEPSMCT16S>(uint8*, const uint8*, uint32, uint32);
+	template <>
+	bool WriteColumn<CGsPixelFormats::STORAGEPSMT8>(uint8*, const uint8*, uint32, uint32);
+	template <>
+	bool WriteColumn<CGsPixelFormats::STORAGEPSMT4>(uint8*, const uint8*, uint32, uint32);
+
+	template <>
+	void ReadColumn<CGsPixelFormats::STORAGEPSMCT32>(const uint8*, uint8*, uint32, uint32);
+	template <>
+	void ReadColumn<CGsPixelFormats::STORAGEPSMCT16>(const uint8*, uint8*, uint32, uint32);
+	template <>
+	void ReadColumn<CGsPixelFormats::STORAGEPSMCT16S>(const uint8*, uint8*, uint32, uint32);
+	template <>
+	void ReadColumn<CGsPixelFormats::STORAGEPSMT8>(const uint8*, uint8*, uint32, uint32);
+
+	//Transfers BLOCKHEIGHT rows starting at block aligned coordinates (x, y), 'width' must be a multiple of BLOCKWIDTH.
+	//'blockStride' is the size in bytes of a block row in the image.
+	template <typename Storage>
+	bool WriteBlockRow(CGsPixelFormats::CPixelIndexor<Storage>& indexor, uint32 x, uint32 y, uint32 width,
+	                   const uint8* image, uint32 pitch, uint32 blockStride)
+	{
+		bool dirty = false;
+		for(uint32 blockX = 0; blockX < width; blockX += Storage::BLOCKWIDTH)
+		{
+			uint8* block = indexor.GetBlockAddress(x + blockX, y);
+			for(uint32 column = 0; column < COLUMNCOUNT; column++)
+			{
+				const uint8* columnImage = image + (column * Storage::COLUMNHEIGHT * pitch);
+				dirty |= WriteColumn<Storage>(block + (column * CGsPixelFormats::COLUMNSIZE), columnImage, pitch, column);
+			}
+			image += blockStride;
+		}
+		return dirty;
+	}
+
+	template <typename Storage>
+	void ReadBlockRow(CGsPixelFormats::CPixelIndexor<Storage>& indexor, uint32 x, uint32 y, uint32 width,
+	                  uint8* image, uint32 pitch, uint32 blockStride)
+	{
+		for(uint32 blockX = 0; blockX < width; blockX += Storage::BLOCKWIDTH)
+		{
+			const uint8* block = indexor.GetBlockAddress(x + blockX, y);
+			for(uint32 column = 0; column < COLUMNCOUNT; column++)
+			{
+				uint8* columnImage = image + (column * Storage::COLUMNHEIGHT * pitch);
+				ReadColumn<Storage>(block + (column * CGsPixelFormats::COLUMNSIZE), columnImage, pitch, column);
+			}
+			image += blockStride;
+		}
+	}
+}
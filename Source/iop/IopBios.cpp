@@ -13,6 +13,7 @@
 #include "../MipsExecutor.h"
 #include "Iop_Intc.h"
 #include "../states/StructCollectionStateFile.h"
+#include "../states/RawState.h"
 
 #ifdef _IOP_EMULATE_MODULES
 #include "Iop_Cdvdfsv.h"
@@ -342,19 +343,7 @@ void CIopBios::SaveState(Framework::CZipArchiveWriter& archive)
 
 void CIopBios::LoadState(Framework::CZipArchiveReader& archive)
 {
-	//Remove all dynamic modules
-	for(auto modulePairIterator = m_modules.begin();
-	    modulePairIterator != m_modules.end();)
-	{
-		if(dynamic_cast<Iop::CDynamic*>(modulePairIterator->second.get()) != nullptr)
-		{
-			modulePairIterator = m_modules.erase(modulePairIterator);
-		}
-		else
-		{
-			modulePairIterator++;
-		}
-	}
+	RemoveDynamicModules();
 
 	CStructCollectionStateFile modulesFile(*archive.BeginReadFile(STATE_MODULES));
 	{
@@ -363,9 +352,7 @@ void CIopBios::LoadState(Framework::CZipArchiveReader& archive)
 		{
 			const CStructFile& structFile(structIterator->second);
 			uint32 importTableAddress = structFile.GetRegister32(STATE_MODULE_IMPORT_TABLE_ADDRESS);
-			auto module = std::make_shared<Iop::CDynamic>(reinterpret_cast<uint32*>(m_ram + importTableAddress));
-			bool result = RegisterModule(module);
-			assert(result);
+			RegisterDynamicModule(importTableAddress);
 		}
 	}
 
@@ -377,7 +364,90 @@ void CIopBios::LoadState(Framework::CZipArchiveReader& archive)
 	m_fileIo->LoadState(archive);
 	m_padman->LoadState(archive);
 	m_cdvdfsv->LoadState(archive);
+#endif
+
+	FinishLoadState();
+}
+
+void CIopBios::SaveRawState(Framework::CStream& stream)
+{
+	std::vector<uint32> importTableAddresses;
+	for(const auto& modulePair : m_modules)
+	{
+		if(auto dynamicModule = std::dynamic_pointer_cast<Iop::CDynamic>(modulePair.second))
+		{
+			importTableAddresses.push_back(reinterpret_cast<uint8*>(dynamicModule->GetExportTable()) - m_ram);
+		}
+	}
+	RawState::Write(stream, static_cast<uint32>(importTableAddresses.size()));
+	for(uint32 importTableAddress : importTableAddresses)
+	{
+		RawState::Write(stream, importTableAddress);
+	}
+
+	m_sifCmd->SaveRawState(stream);
+	m_cdvdman->SaveRawState(stream);
+	m_loadcore->SaveRawState(stream);
+	m_ioman->SaveRawState(stream);
+#ifdef _IOP_EMULATE_MODULES
+	m_fileIo->SaveRawState(stream);
+	m_padman->SaveRawState(stream);
+	m_cdvdfsv->SaveRawState(stream);
+#endif
+}
+
+void CIopBios::LoadRawState(Framework::CStream& stream)
+{
+	RemoveDynamicModules();
 
+	uint32 moduleCount = 0;
+	RawState::Read(stream, moduleCount);
+	for(uint32 i = 0; i < moduleCount; i++)
+	{
+		uint32 importTableAddress = 0;
+		RawState::Read(stream, importTableAddress);
+		RegisterDynamicModule(importTableAddress);
+	}
+
+	m_sifCmd->LoadRawState(stream);
+	m_cdvdman->LoadRawState(stream);
+	m_loadcore->LoadRawState(stream);
+	m_ioman->LoadRawState(stream);
+#ifdef _IOP_EMULATE_MODULES
+	m_fileIo->LoadRawState(stream);
+	m_padman->LoadRawState(stream);
+	m_cdvdfsv->LoadRawState(stream);
+#endif
+
+	FinishLoadState();
+}
+
+void CIopBios::RemoveDynamicModules()
+{
+	for(auto modulePairIterator = m_modules.begin();
+	    modulePairIterator != m_modules.end();)
+	{
+		if(dynamic_cast<Iop::CDynamic*>(modulePairIterator->second.get()) != nullptr)
+		{
+			modulePairIterator = m_modules.erase(modulePairIterator);
+		}
+		else
+		{
+			modulePairIterator++;
+		}
+	}
+}
+
+void CIopBios::RegisterDynamicModule(uint32 importTableAddress)
+{
+	auto module = std::make_shared<Iop::CDynamic>(reinterpret_cast<uint32*>(m_ram + importTableAddress));
+	bool result = RegisterModule(module);
+	assert(result);
+}
+
+void CIopBios::FinishLoadState()
+{
+#ifdef _IOP_EMULATE_MODULES
 	//Make sure HLE modules are properly registered
 	for(const auto& loadedModule : m_loadedModules)
 	{
@@ -171,6 +171,8 @@ public:
 
 	void SaveState(Framework::CZipArchiveWriter&) override;
 	void LoadState(Framework::CZipArchiveReader&) override;
+	void SaveRawState(Framework::CStream&) override;
+	void LoadRawState(Framework::CStream&) override;
 
 	bool IsIdle() override;
 
@@ -569,6 +571,9 @@ private:
 
 	int32 LoadHleModule(const Iop::ModulePtr&);
 	void RegisterHleModule(const Iop::ModulePtr&);
+	void RemoveDynamicModules();
+	void RegisterDynamicModule(uint32);
+	void FinishLoadState();
 
 	uint32 AssembleThreadFinish(CMIPSAssembler&);
 	uint32 AssembleReturnFromException(CMIPSAssembler&);
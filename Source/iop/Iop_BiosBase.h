@@ -26,6 +26,8 @@ namespace Iop
 
 		virtual void SaveState(Framework::CZipArchiveWriter&) = 0;
 		virtual void LoadState(Framework::CZipArchiveReader&) = 0;
+		virtual void SaveRawState(Framework::CStream&) = 0;
+		virtual void LoadRawState(Framework::CStream&) = 0;
 
 #ifdef DEBUGGER_INCLUDED
 		virtual void SaveDebugTags(Framework::Xml::CNode*) = 0;
@@ -4,6 +4,7 @@
 #include "Iop_Cdvdfsv.h"
 #include "Iop_Cdvdman.h"
 #include "Iop_SifManPs2.h"
+#include "../states/RawState.h"
 
 using namespace Iop;
 
@@ -62,8 +63,6 @@ void CCdvdfsv::ProcessCommands(CSifMan* sifMan)
 {
 	if(m_pendingCommand != COMMAND_NONE)
 	{
-		static const uint32 sectorSize = 0x800;
-
 		uint8* eeRam = nullptr;
 		if(auto sifManPs2 = dynamic_cast<CSifManPs2*>(sifMan))
 		{
@@ -75,10 +74,7 @@ void CCdvdfsv::ProcessCommands(CSifMan* sifMan)
 			if(m_opticalMedia != nullptr)
 			{
 				auto fileSystem = m_opticalMedia->GetFileSystem();
-				for(unsigned int i = 0; i < m_pendingReadCount; i++)
-				{
-					fileSystem->ReadBlock(m_pendingReadSector + i, eeRam + (m_pendingReadAddr + (i * sectorSize)));
-				}
+				fileSystem->ReadBlocks(m_pendingReadSector, m_pendingReadCount, eeRam + m_pendingReadAddr);
 			}
 		}
 		else if(m_pendingCommand == COMMAND_READIOP)
@@ -86,10 +82,7 @@ void CCdvdfsv::ProcessCommands(CSifMan* sifMan)
 			if(m_opticalMedia != nullptr)
 			{
 				auto fileSystem = m_opticalMedia->GetFileSystem();
-				for(unsigned int i = 0; i < m_pendingReadCount; i++)
-				{
-					fileSystem->ReadBlock(m_pendingReadSector + i, m_iopRam + (m_pendingReadAddr + (i * sectorSize)));
-				}
+				fileSystem->ReadBlocks(m_pendingReadSector, m_pendingReadCount, m_iopRam + m_pendingReadAddr);
 			}
 		}
 		else if(m_pendingCommand == COMMAND_STREAM_READ)
@@ -97,11 +90,8 @@ void CCdvdfsv::ProcessCommands(CSifMan* sifMan)
 			if(m_opticalMedia != nullptr)
 			{
 				auto fileSystem = m_opticalMedia->GetFileSystem();
-				for(unsigned int i = 0; i < m_pendingReadCount; i++)
-				{
-					fileSystem->ReadBlock(m_streamPos, eeRam + (m_pendingReadAddr + (i * sectorSize)));
-					m_streamPos++;
-				}
+				fileSystem->ReadBlocks(m_streamPos, m_pendingReadCount, eeRam + m_pendingReadAddr);
+				m_streamPos += m_pendingReadCount;
 			}
 		}
 		else if(m_pendingCommand == COMMAND_NDISKREADY)
@@ -119,6 +109,14 @@ void CCdvdfsv::SetOpticalMedia(COpticalMedia* opticalMedia)
 	m_opticalMedia = opticalMedia;
 }
 
+//Blocks are only written to memory when the pending command completes, but
+//we can start fetching them from the disc image right away
+void CCdvdfsv::PrefetchBlocks(uint32 sector, uint32 count)
+{
+	if(m_opticalMedia == nullptr) return;
+	m_opticalMedia->GetFileSystem()->PrefetchBlocks(sector, count);
+}
+
 void CCdvdfsv::LoadState(Framework::CZipArchiveReader& archive)
 {
 	auto registerFile = CRegisterStateFile(*archive.BeginReadFile(STATE_FILENAME));
@@ -149,6 +147,30 @@ void CCdvdfsv::SaveState(Framework::CZipArchiveWriter& archive)
 	archive.InsertFile(registerFile);
 }
 
+void CCdvdfsv::LoadRawState(Framework::CStream& stream)
+{
+	RawState::Read(stream, m_pendingCommand);
+	RawState::Read(stream, m_pendingReadSector);
+	RawState::Read(stream, m_pendingReadCount);
+	RawState::Read(stream, m_pendingReadAddr);
+
+	RawState::Read(stream, m_streaming);
+	RawState::Read(stream, m_streamPos);
+	RawState::Read(stream, m_streamBufferSize);
+}
+
+void CCdvdfsv::SaveRawState(Framework::CStream& stream)
+{
+	RawState::Write(stream, m_pendingCommand);
+	RawState::Write(stream, m_pendingReadSector);
+	RawState::Write(stream, m_pendingReadCount);
+	RawState::Write(stream, m_pendingReadAddr);
+
+	RawState::Write(stream, m_streaming);
+	RawState::Write(stream, m_streamPos);
+	RawState::Write(stream, m_streamBufferSize);
+}
+
 void CCdvdfsv::Invoke(CMIPS& context, unsigned int functionId)
 {
 	throw std::runtime_error("Not implemented.");
@@ -380,6 +402,7 @@ void CCdvdfsv::Read(uint32* args, uint32 argsSize, uint32* ret, uint32 retSize,
 	m_pendingReadSector = sector;
 	m_pendingReadCount = count;
 	m_pendingReadAddr = dstAddr & 0x1FFFFFFF;
+	PrefetchBlocks(sector, count);
 }
 
 void CCdvdfsv::ReadIopMem(uint32* args, uint32 argsSize, uint32* ret, uint32 retSize, uint8* ram)
@@ -402,6 +425,7 @@ void CCdvdfsv::ReadIopMem(uint32* args, uint32 argsSize, uint32* ret, uint32 ret
 	m_pendingReadSector = sector;
 	m_pendingReadCount = count;
 	m_pendingReadAddr = dstAddr & 0x1FFFFFFF;
+	PrefetchBlocks(sector, count);
 }
 
 bool CCdvdfsv::StreamCmd(uint32* args, uint32 argsSize, uint32* ret, uint32 retSize, uint8* ram)
@@ -427,6 +451,7 @@ bool CCdvdfsv::StreamCmd(uint32* args, uint32 argsSize, uint32* ret, uint32 retS
 		ret[0] = 1;
 		CLog::GetInstance().Print(LOG_NAME, "StreamStart(pos = 0x%08X);\r\n", sector);
 		m_streaming = true;
+		PrefetchBlocks(m_streamPos, m_streamBufferSize);
 		break;
 	case 2:
 		//Read
@@ -434,6 +459,7 @@ bool CCdvdfsv::StreamCmd(uint32* args, uint32 argsSize, uint32* ret, uint32 retS
 		m_pendingReadSector = 0;
 		m_pendingReadCount = count;
 		m_pendingReadAddr = dstAddr & (PS2::EE_RAM_SIZE - 1);
+		PrefetchBlocks(m_streamPos, count);
 		ret[0] = count;
 		immediateReply = false;
 		CLog::GetInstance().Print(LOG_NAME, "StreamRead(count = 0x%08X, dest = 0x%08X);\r\n",
@@ -463,6 +489,7 @@ bool CCdvdfsv::StreamCmd(uint32* args, uint32 argsSize, uint32* ret, uint32 retS
 		m_streamPos = sector;
 		ret[0] = 1;
 		CLog::GetInstance().Print(LOG_NAME, "StreamSeek(pos = 0x%08X);\r\n", sector);
+		PrefetchBlocks(m_streamPos, m_streamBufferSize);
 		break;
 	default:
 		CLog::GetInstance().Warn(LOG_NAME, "Unknown stream command used.\r\n");
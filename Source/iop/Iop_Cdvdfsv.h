@@ -26,6 +26,8 @@ namespace Iop
 
 		void LoadState(Framework::CZipArchiveReader&);
 		void SaveState(Framework::CZipArchiveWriter&);
+		void LoadRawState(Framework::CStream&);
+		void SaveRawState(Framework::CStream&);
 
 		enum MODULE_ID
 		{
@@ -64,6 +66,8 @@ namespace Iop
 		bool NDiskReady(uint32*, uint32, uint32*, uint32, uint8*);
 		void SearchFile(uint32*, uint32, uint32*, uint32, uint8*);
 
+		void PrefetchBlocks(uint32, uint32);
+
 		CCdvdman& m_cdvdman;
 		uint8* m_iopRam = nullptr;
 		COpticalMedia* m_opticalMedia = nullptr;
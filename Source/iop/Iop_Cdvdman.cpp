@@ -1,6 +1,7 @@
 #include <cstring>
 #include "../Log.h"
 #include "../states/RegisterStateFile.h"
+#include "../states/RawState.h"
 #include "IopBios.h"
 #include "Iop_Cdvdman.h"
 
@@ -10,6 +11,9 @@
 #define STATE_CALLBACK_ADDRESS ("CallbackAddress")
 #define STATE_STATUS ("Status")
 #define STATE_PENDING_COMMAND ("PendingCommand")
+#define STATE_PENDING_READ_SECTOR ("PendingReadSector")
+#define STATE_PENDING_READ_COUNT ("PendingReadCount")
+#define STATE_PENDING_READ_BUFFER ("PendingReadBuffer")
 
 #define FUNCTION_CDINIT "CdInit"
 #define FUNCTION_CDREAD "CdRead"
@@ -48,6 +52,9 @@ void CCdvdman::LoadState(Framework::CZipArchiveReader& archive)
 	m_callbackPtr = registerFile.GetRegister32(STATE_CALLBACK_ADDRESS);
 	m_status = registerFile.GetRegister32(STATE_STATUS);
 	m_pendingCommand = static_cast<COMMAND>(registerFile.GetRegister32(STATE_PENDING_COMMAND));
+	m_pendingReadSector = registerFile.GetRegister32(STATE_PENDING_READ_SECTOR);
+	m_pendingReadCount = registerFile.GetRegister32(STATE_PENDING_READ_COUNT);
+	m_pendingReadBufferPtr = registerFile.GetRegister32(STATE_PENDING_READ_BUFFER);
 }
 
 void CCdvdman::SaveState(Framework::CZipArchiveWriter& archive)
@@ -56,9 +63,32 @@ void CCdvdman::SaveState(Framework::CZipArchiveWriter& archive)
 	registerFile->SetRegister32(STATE_CALLBACK_ADDRESS, m_callbackPtr);
 	registerFile->SetRegister32(STATE_STATUS, m_status);
 	registerFile->SetRegister32(STATE_PENDING_COMMAND, m_pendingCommand);
+	registerFile->SetRegister32(STATE_PENDING_READ_SECTOR, m_pendingReadSector);
+	registerFile->SetRegister32(STATE_PENDING_READ_COUNT, m_pendingReadCount);
+	registerFile->SetRegister32(STATE_PENDING_READ_BUFFER, m_pendingReadBufferPtr);
 	archive.InsertFile(registerFile);
 }
 
+void CCdvdman::LoadRawState(Framework::CStream& stream)
+{
+	RawState::Read(stream, m_callbackPtr);
+	RawState::Read(stream, m_status);
+	RawState::Read(stream, m_pendingCommand);
+	RawState::Read(stream, m_pendingReadSector);
+	RawState::Read(stream, m_pendingReadCount);
+	RawState::Read(stream, m_pendingReadBufferPtr);
+}
+
+void CCdvdman::SaveRawState(Framework::CStream& stream)
+{
+	RawState::Write(stream, m_callbackPtr);
+	RawState::Write(stream, m_status);
+	RawState::Write(stream, m_pendingCommand);
+	RawState::Write(stream, m_pendingReadSector);
+	RawState::Write(stream, m_pendingReadCount);
+	RawState::Write(stream, m_pendingReadBufferPtr);
+}
+
 static uint8 Uint8ToBcd(uint8 input)
 {
 	uint8 digit0 = input % 10;
@@ -288,6 +318,14 @@ void CCdvdman::ProcessCommands()
 		switch(m_pendingCommand)
 		{
 		case COMMAND_READ:
+			//Data only lands in memory once the command completes, the blocks were
+			//requested when the read was issued and are most likely cached by now
+			if(m_opticalMedia && (m_pendingReadCount != 0))
+			{
+				auto fileSystem = m_opticalMedia->GetFileSystem();
+				fileSystem->ReadBlocks(m_pendingReadSector, m_pendingReadCount, m_ram + m_pendingReadBufferPtr);
+			}
+			m_pendingReadCount = 0;
 			if(m_callbackPtr != 0)
 			{
 				m_bios.TriggerCallback(m_callbackPtr, CDVD_FUNCTION_READ);
@@ -338,16 +376,14 @@ uint32 CCdvdman::CdRead(uint32 startSector, uint32 sectorCount, uint32 bufferPtr
 		//Does that make sure it's 2048 byte mode?
 		assert(mode[2] == 0);
 	}
+	m_pendingReadCount = 0;
 	if(m_opticalMedia && (bufferPtr != 0))
 	{
-		uint8* buffer = &m_ram[bufferPtr];
-		static const uint32 sectorSize = 2048;
 		auto fileSystem = m_opticalMedia->GetFileSystem();
-		for(unsigned int i = 0; i < sectorCount; i++)
-		{
-			fileSystem->ReadBlock(startSector + i, buffer);
-			buffer += sectorSize;
-		}
+		fileSystem->PrefetchBlocks(startSector, sectorCount);
+		m_pendingReadSector = startSector;
+		m_pendingReadCount = sectorCount;
+		m_pendingReadBufferPtr = bufferPtr;
 	}
 	m_pendingCommand = COMMAND_READ;
 	m_status = CDVD_STATUS_READING;
@@ -518,11 +554,8 @@ uint32 CCdvdman::CdStRead(uint32 sectors, uint32 bufPtr, uint32 mode, uint32 err
 	CLog::GetInstance().Print(LOG_NAME, FUNCTION_CDSTREAD "(sectors = %d, bufPtr = 0x%08X, mode = %d, errPtr = 0x%08X);\r\n",
 	                          sectors, bufPtr, mode, errPtr);
 	auto fileSystem = m_opticalMedia->GetFileSystem();
-	for(unsigned int i = 0; i < sectors; i++)
-	{
-		fileSystem->ReadBlock(m_streamPos, m_ram + (bufPtr + (i * 0x800)));
-		m_streamPos++;
-	}
+	fileSystem->ReadBlocks(m_streamPos, sectors, m_ram + bufPtr);
+	m_streamPos += sectors;
 	if(errPtr != 0)
 	{
 		auto err = reinterpret_cast<uint32*>(m_ram + errPtr);
@@ -536,6 +569,11 @@ uint32 CCdvdman::CdStStart(uint32 sector, uint32 modePtr)
 	CLog::GetInstance().Print(LOG_NAME, FUNCTION_CDSTSTART "(sector = %d, modePtr = 0x%08X);\r\n",
 	                          sector, modePtr);
 	m_streamPos = sector;
+	if(m_opticalMedia)
+	{
+		//Get the first blocks ready, subsequent reads will be read ahead
+		m_opticalMedia->GetFileSystem()->PrefetchBlocks(sector, m_streamBufferSize);
+	}
 	return 1;
 }
 
@@ -39,6 +39,8 @@ namespace Iop
 
 		void LoadState(Framework::CZipArchiveReader&);
 		void SaveState(Framework::CZipArchiveWriter&);
+		void LoadRawState(Framework::CStream&);
+		void SaveRawState(Framework::CStream&);
 
 		uint32 CdReadClockDirect(uint8*);
 		uint32 CdGetDiskTypeDirect(COpticalMedia*);
@@ -89,6 +91,9 @@ namespace Iop
 		uint32 m_streamPos = 0;
 		uint32 m_streamBufferSize = 0;
 		COMMAND m_pendingCommand = COMMAND_NONE;
+		uint32 m_pendingReadSector = 0;
+		uint32 m_pendingReadCount = 0;
+		uint32 m_pendingReadBufferPtr = 0;
 	};
 
 	typedef std::shared_ptr<CCdvdman> CdvdmanPtr;
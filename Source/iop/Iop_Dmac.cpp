@@ -3,6 +3,7 @@
 #include "Iop_Dmac.h"
 #include "Iop_Intc.h"
 #include "../states/RegisterStateFile.h"
+#include "../states/RawState.h"
 #include "../Log.h"
 
 #define LOG_NAME ("iop_dmac")
@@ -188,6 +189,32 @@ void CDmac::SaveState(Framework::CZipArchiveWriter& archive)
 	}
 }
 
+void CDmac::LoadRawState(Framework::CStream& stream)
+{
+	RawState::Read(stream, m_DPCR);
+	RawState::Read(stream, m_DICR);
+
+	for(unsigned int i = 0; i < MAX_CHANNEL; i++)
+	{
+		auto channel = m_channel[i];
+		if(!channel) continue;
+		channel->LoadRawState(stream);
+	}
+}
+
+void CDmac::SaveRawState(Framework::CStream& stream)
+{
+	RawState::Write(stream, m_DPCR);
+	RawState::Write(stream, m_DICR);
+
+	for(unsigned int i = 0; i < MAX_CHANNEL; i++)
+	{
+		auto channel = m_channel[i];
+		if(!channel) continue;
+		channel->SaveRawState(stream);
+	}
+}
+
 void CDmac::LogRead(uint32 address)
 {
 	switch(address)
@@ -53,6 +53,8 @@ namespace Iop
 
 		void LoadState(Framework::CZipArchiveReader&);
 		void SaveState(Framework::CZipArchiveWriter&);
+		void LoadRawState(Framework::CStream&);
+		void SaveRawState(Framework::CStream&);
 
 		void ResumeDma(unsigned int);
 
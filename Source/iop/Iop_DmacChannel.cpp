@@ -3,6 +3,7 @@
 #include "Iop_DmacChannel.h"
 #include "Iop_Dmac.h"
 #include "../states/RegisterStateFile.h"
+#include "../states/RawState.h"
 
 using namespace Iop;
 using namespace Iop::Dmac;
@@ -46,6 +47,20 @@ void CChannel::SaveState(Framework::CZipArchiveWriter& archive)
 	archive.InsertFile(registerFile);
 }
 
+void CChannel::LoadRawState(Framework::CStream& stream)
+{
+	RawState::Read(stream, m_CHCR);
+	RawState::Read(stream, m_BCR);
+	RawState::Read(stream, m_MADR);
+}
+
+void CChannel::SaveRawState(Framework::CStream& stream)
+{
+	RawState::Write(stream, m_CHCR);
+	RawState::Write(stream, m_BCR);
+	RawState::Write(stream, m_MADR);
+}
+
 void CChannel::SetReceiveFunction(const ReceiveFunctionType& receiveFunction)
 {
 	m_receiveFunction = receiveFunction;
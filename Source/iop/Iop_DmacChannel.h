@@ -48,6 +48,8 @@ namespace Iop
 
 			void SaveState(Framework::CZipArchiveWriter&);
 			void LoadState(Framework::CZipArchiveReader&);
+			void SaveRawState(Framework::CStream&);
+			void LoadRawState(Framework::CStream&);
 
 			void Reset();
 			void SetReceiveFunction(const ReceiveFunctionType&);
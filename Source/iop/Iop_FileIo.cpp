@@ -4,6 +4,7 @@
 #include "Iop_FileIoHandler2100.h"
 #include "Iop_FileIoHandler2240.h"
 #include "../states/RegisterStateFile.h"
+#include "../states/RawState.h"
 
 #define LOG_NAME ("iop_fileio")
 
@@ -80,6 +81,19 @@ void CFileIo::SaveState(Framework::CZipArchiveWriter& archive) const
 	m_handler->SaveState(archive);
 }
 
+void CFileIo::LoadRawState(Framework::CStream& stream)
+{
+	RawState::Read(stream, m_moduleVersion);
+	SetModuleVersion(m_moduleVersion);
+	m_handler->LoadRawState(stream);
+}
+
+void CFileIo::SaveRawState(Framework::CStream& stream) const
+{
+	RawState::Write(stream, m_moduleVersion);
+	m_handler->SaveRawState(stream);
+}
+
 void CFileIo::ProcessCommands(Iop::CSifMan* sifMan)
 {
 	m_handler->ProcessCommands(sifMan);
@@ -25,6 +25,8 @@ namespace Iop
 
 			virtual void LoadState(Framework::CZipArchiveReader&){};
 			virtual void SaveState(Framework::CZipArchiveWriter&) const {};
+			virtual void LoadRawState(Framework::CStream&){};
+			virtual void SaveRawState(Framework::CStream&) const {};
 
 			virtual void ProcessCommands(CSifMan*){};
 
@@ -48,6 +50,8 @@ namespace Iop
 
 		void LoadState(Framework::CZipArchiveReader&);
 		void SaveState(Framework::CZipArchiveWriter&) const;
+		void LoadRawState(Framework::CStream&);
+		void SaveRawState(Framework::CStream&) const;
 
 		void ProcessCommands(Iop::CSifMan*);
 
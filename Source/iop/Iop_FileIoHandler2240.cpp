@@ -5,6 +5,7 @@
 #include "Iop_SifManPs2.h"
 #include "../states/RegisterStateFile.h"
 #include "../states/MemoryStateFile.h"
+#include "../states/RawState.h"
 #include "../Log.h"
 #include "../Ps2Const.h"
 
@@ -112,6 +113,18 @@ void CFileIoHandler2240::SaveState(Framework::CZipArchiveWriter& archive) const
 	}
 }
 
+void CFileIoHandler2240::LoadRawState(Framework::CStream& stream)
+{
+	RawState::Read(stream, m_resultPtr);
+	RawState::Read(stream, m_pendingReply);
+}
+
+void CFileIoHandler2240::SaveRawState(Framework::CStream& stream) const
+{
+	RawState::Write(stream, m_resultPtr);
+	RawState::Write(stream, m_pendingReply);
+}
+
 void CFileIoHandler2240::ProcessCommands(CSifMan* sifMan)
 {
 	if(m_pendingReply.valid)
@@ -16,6 +16,8 @@ namespace Iop
 
 		void LoadState(Framework::CZipArchiveReader&) override;
 		void SaveState(Framework::CZipArchiveWriter&) const override;
+		void LoadRawState(Framework::CStream&) override;
+		void SaveRawState(Framework::CStream&) const override;
 
 		void ProcessCommands(CSifMan*) override;
 
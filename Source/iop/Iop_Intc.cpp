@@ -1,5 +1,6 @@
 #include "Iop_Intc.h"
 #include "../states/RegisterStateFile.h"
+#include "../states/RawState.h"
 
 #define STATE_REGS_XML ("iop_intc/regs.xml")
 #define STATE_REGS_STATUS ("STATUS")
@@ -38,6 +39,18 @@ void CIntc::SaveState(Framework::CZipArchiveWriter& archive)
 	archive.InsertFile(registerFile);
 }
 
+void CIntc::LoadRawState(Framework::CStream& stream)
+{
+	RawState::Read(stream, m_status.f);
+	RawState::Read(stream, m_mask.f);
+}
+
+void CIntc::SaveRawState(Framework::CStream& stream)
+{
+	RawState::Write(stream, m_status.f);
+	RawState::Write(stream, m_mask.f);
+}
+
 uint32 CIntc::ReadRegister(uint32 address)
 {
 	switch(address)
@@ -60,6 +60,8 @@ namespace Iop
 
 		void LoadState(Framework::CZipArchiveReader&);
 		void SaveState(Framework::CZipArchiveWriter&);
+		void LoadRawState(Framework::CStream&);
+		void SaveRawState(Framework::CStream&);
 
 		uint32 ReadRegister(uint32);
 		uint32 WriteRegister(uint32, uint32);
@@ -11,6 +11,7 @@
 #include "../AppConfig.h"
 #include "../Log.h"
 #include "../states/XmlStateFile.h"
+#include "../states/RawState.h"
 
 using namespace Iop;
 
@@ -770,6 +771,79 @@ void CIoman::LoadState(Framework::CZipArchiveReader& archive)
 	LoadUserDevicesState(archive);
 }
 
+void CIoman::SaveRawState(Framework::CStream& stream)
+{
+	RawState::Write(stream, static_cast<uint32>(m_files.size()));
+	for(const auto& filePair : m_files)
+	{
+		const auto& file = filePair.second;
+		//Position is kept to resume host file reads where they were when the state was taken
+		uint64 position = file.stream ? file.stream->Tell() : 0;
+		RawState::Write(stream, filePair.first);
+		RawState::Write(stream, file.flags);
+		RawState::Write(stream, file.descPtr);
+		RawState::Write(stream, position);
+		RawState::WriteString(stream, file.path);
+	}
+
+	RawState::Write(stream, static_cast<uint32>(m_userDevices.size()));
+	for(const auto& devicePair : m_userDevices)
+	{
+		RawState::WriteString(stream, devicePair.first);
+		RawState::Write(stream, devicePair.second);
+	}
+}
+
+void CIoman::LoadRawState(Framework::CStream& stream)
+{
+	std::experimental::erase_if(m_files,
+	                            [](const FileMapType::value_type& filePair) {
+		                            return (filePair.first != FID_STDOUT) && (filePair.first != FID_STDERR);
+	                            });
+
+	int32 maxFileId = FID_STDERR;
+	uint32 fileCount = 0;
+	RawState::Read(stream, fileCount);
+	for(uint32 i = 0; i < fileCount; i++)
+	{
+		int32 id = 0;
+		uint32 flags = 0, descPtr = 0;
+		uint64 position = 0;
+		RawState::Read(stream, id);
+		RawState::Read(stream, flags);
+		RawState::Read(stream, descPtr);
+		RawState::Read(stream, position);
+		auto path = RawState::ReadString(stream);
+
+		if((id == FID_STDOUT) || (id == FID_STDERR)) continue;
+
+		FileInfo fileInfo;
+		fileInfo.flags = flags;
+		fileInfo.path = path;
+		fileInfo.descPtr = descPtr;
+		fileInfo.stream = (descPtr == 0) ? OpenInternal(flags, path.c_str()) : nullptr;
+		if(fileInfo.stream)
+		{
+			fileInfo.stream->Seek(position, Framework::STREAM_SEEK_SET);
+		}
+		m_files[id] = std::move(fileInfo);
+
+		maxFileId = std::max(maxFileId, id);
+	}
+	m_nextFileHandle = maxFileId + 1;
+
+	m_userDevices.clear();
+	uint32 deviceCount = 0;
+	RawState::Read(stream, deviceCount);
+	for(uint32 i = 0; i < deviceCount; i++)
+	{
+		auto name = RawState::ReadString(stream);
+		uint32 descPtr = 0;
+		RawState::Read(stream, descPtr);
+		m_userDevices[name] = descPtr;
+	}
+}
+
 void CIoman::SaveFilesState(Framework::CZipArchiveWriter& archive)
 {
 	auto fileStateFile = new CXmlStateFile(STATE_FILES_FILENAME, STATE_FILES_FILESNODE);
@@ -40,6 +40,8 @@ namespace Iop
 
 		void SaveState(Framework::CZipArchiveWriter&);
 		void LoadState(Framework::CZipArchiveReader&);
+		void SaveRawState(Framework::CStream&);
+		void LoadRawState(Framework::CStream&);
 
 		void RegisterDevice(const char*, const DevicePtr&);
 
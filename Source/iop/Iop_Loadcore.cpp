@@ -4,6 +4,7 @@
 #include "IopBios.h"
 #include "../Log.h"
 #include "../states/RegisterStateFile.h"
+#include "../states/RawState.h"
 
 using namespace Iop;
 
@@ -140,6 +141,16 @@ void CLoadcore::SaveState(Framework::CZipArchiveWriter& archive)
 	archive.InsertFile(registerFile);
 }
 
+void CLoadcore::LoadRawState(Framework::CStream& stream)
+{
+	RawState::Read(stream, m_moduleVersion);
+}
+
+void CLoadcore::SaveRawState(Framework::CStream& stream)
+{
+	RawState::Write(stream, m_moduleVersion);
+}
+
 void CLoadcore::SetLoadExecutableHandler(const LoadExecutableHandler& loadExecutableHandler)
 {
 	m_loadExecutableHandler = loadExecutableHandler;
@@ -32,6 +32,8 @@ namespace Iop
 
 		void LoadState(Framework::CZipArchiveReader&);
 		void SaveState(Framework::CZipArchiveWriter&);
+		void LoadRawState(Framework::CStream&);
+		void SaveRawState(Framework::CStream&);
 
 		void SetLoadExecutableHandler(const LoadExecutableHandler&);
 
@@ -3,6 +3,7 @@
 #include "Iop_PadMan.h"
 #include "../Log.h"
 #include "../states/RegisterStateFile.h"
+#include "../states/RawState.h"
 #include "placeholder_def.h"
 
 using namespace Iop;
@@ -92,6 +93,18 @@ void CPadMan::LoadState(Framework::CZipArchiveReader& archive)
 	m_nPadDataType = static_cast<PAD_DATA_TYPE>(registerFile.GetRegister32(STATE_PADDATA_TYPE));
 }
 
+void CPadMan::SaveRawState(Framework::CStream& stream)
+{
+	RawState::Write(stream, m_nPadDataAddress);
+	RawState::Write(stream, m_nPadDataType);
+}
+
+void CPadMan::LoadRawState(Framework::CStream& stream)
+{
+	RawState::Read(stream, m_nPadDataAddress);
+	RawState::Read(stream, m_nPadDataType);
+}
+
 void CPadMan::SetButtonState(unsigned int nPadNumber, CControllerInfo::BUTTON nButton, bool nPressed, uint8* ram)
 {
 	if(m_nPadDataAddress == 0) return;
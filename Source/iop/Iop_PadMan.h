@@ -26,6 +26,8 @@ namespace Iop
 		bool Invoke(uint32, uint32*, uint32, uint32*, uint32, uint8*) override;
 		void SaveState(Framework::CZipArchiveWriter&);
 		void LoadState(Framework::CZipArchiveReader&);
+		void SaveRawState(Framework::CStream&);
+		void LoadRawState(Framework::CStream&);
 		void SetButtonState(unsigned int, PS2::CControllerInfo::BUTTON, bool, uint8*) override;
 		void SetAxisState(unsigned int, PS2::CControllerInfo::BUTTON, uint8, uint8*) override;
 
@@ -5,6 +5,7 @@
 #include "string_format.h"
 #include "../Log.h"
 #include "../states/RegisterStateFile.h"
+#include "../states/RawState.h"
 
 #define LOG_NAME ("iop_counters")
 
@@ -108,6 +109,16 @@ void CRootCounters::SaveState(Framework::CZipArchiveWriter& archive)
 	archive.InsertFile(registerFile);
 }
 
+void CRootCounters::LoadRawState(Framework::CStream& stream)
+{
+	RawState::Read(stream, m_counter);
+}
+
+void CRootCounters::SaveRawState(Framework::CStream& stream)
+{
+	RawState::Write(stream, m_counter);
+}
+
 void CRootCounters::Update(unsigned int ticks)
 {
 	for(unsigned int i = 0; i < MAX_COUNTERS; i++)
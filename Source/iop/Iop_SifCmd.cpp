@@ -4,6 +4,7 @@
 #include "../ee/SIF.h"
 #include "../Log.h"
 #include "../states/StructCollectionStateFile.h"
+#include "../states/RawState.h"
 
 using namespace Iop;
 
@@ -104,6 +105,32 @@ void CSifCmd::SaveState(Framework::CZipArchiveWriter& archive)
 	archive.InsertFile(modulesFile);
 }
 
+void CSifCmd::LoadRawState(Framework::CStream& stream)
+{
+	ClearServers();
+
+	uint32 serverCount = 0;
+	RawState::Read(stream, serverCount);
+	for(uint32 i = 0; i < serverCount; i++)
+	{
+		uint32 serverDataAddress = 0;
+		RawState::Read(stream, serverDataAddress);
+		auto serverData = reinterpret_cast<SIFRPCSERVERDATA*>(m_ram + serverDataAddress);
+		auto module = new CSifDynamic(*this, serverDataAddress);
+		m_servers.push_back(module);
+		m_sifMan.RegisterModule(serverData->serverId, module);
+	}
+}
+
+void CSifCmd::SaveRawState(Framework::CStream& stream)
+{
+	RawState::Write(stream, static_cast<uint32>(m_servers.size()));
+	for(const auto& module : m_servers)
+	{
+		RawState::Write(stream, module->GetServerDataAddress());
+	}
+}
+
 std::string CSifCmd::GetId() const
 {
 	return MODULE_NAME;
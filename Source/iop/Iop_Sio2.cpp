@@ -5,6 +5,7 @@
 #include "../Log.h"
 #include "../states/RegisterStateFile.h"
 #include "../states/MemoryStateFile.h"
+#include "../states/RawState.h"
 
 #define LOG_NAME ("iop_sio2")
 
@@ -115,6 +116,32 @@ void CSio2::SaveState(Framework::CZipArchiveWriter& archive)
 	archive.InsertFile(new CMemoryStateFile(STATE_OUTPUT, outputBuffer.data(), outputBuffer.size()));
 }
 
+void CSio2::LoadRawState(Framework::CStream& stream)
+{
+	RawState::Read(stream, m_currentRegIndex);
+	RawState::Read(stream, m_regs);
+	RawState::Read(stream, m_ctrl1);
+	RawState::Read(stream, m_ctrl2);
+	RawState::Read(stream, m_padState);
+
+	std::vector<uint8> buffer;
+	RawState::ReadBytes(stream, buffer);
+	m_inputBuffer.assign(buffer.begin(), buffer.end());
+	RawState::ReadBytes(stream, buffer);
+	m_outputBuffer.assign(buffer.begin(), buffer.end());
+}
+
+void CSio2::SaveRawState(Framework::CStream& stream)
+{
+	RawState::Write(stream, m_currentRegIndex);
+	RawState::Write(stream, m_regs);
+	RawState::Write(stream, m_ctrl1);
+	RawState::Write(stream, m_ctrl2);
+	RawState::Write(stream, m_padState);
+	RawState::WriteBytes(stream, std::vector<uint8>(m_inputBuffer.begin(), m_inputBuffer.end()));
+	RawState::WriteBytes(stream, std::vector<uint8>(m_outputBuffer.begin(), m_outputBuffer.end()));
+}
+
 void CSio2::SetButtonState(unsigned int padNumber, PS2::CControllerInfo::BUTTON button, bool pressed, uint8* ram)
 {
 	assert(padNumber < MAX_PADS);
@@ -5,7 +5,10 @@
 #include "string_format.h"
 #include "../Log.h"
 #include "../states/RegisterStateFile.h"
+#include "../states/RawState.h"
+#include "../DirtyPageTracker.h"
 #include "Iop_SpuBase.h"
+#include "Iop_SpuKernels.h"
 
 using namespace Iop;
 
@@ -130,9 +133,10 @@ const uint32 CSpuBase::g_linearDecreaseSweepDeltas[0x80] =
         0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000,
         0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000};
 
-CSpuBase::CSpuBase(uint8* ram, uint32 ramSize, unsigned int spuNumber)
+CSpuBase::CSpuBase(uint8* ram, uint32 ramSize, unsigned int spuNumber, CDirtyPageTracker* ramTracker)
     : m_ram(ram)
     , m_ramSize(ramSize)
+    , m_ramTracker(ramTracker)
     , m_spuNumber(spuNumber)
     , m_reverbEnabled(true)
 {
@@ -290,6 +294,46 @@ void CSpuBase::SaveState(Framework::CZipArchiveWriter& archive)
 	archive.InsertFile(registerFile);
 }
 
+void CSpuBase::LoadRawState(Framework::CStream& stream)
+{
+	RawState::Read(stream, m_ctrl);
+	RawState::Read(stream, m_irqAddr);
+	RawState::Read(stream, m_transferMode);
+	RawState::Read(stream, m_transferAddr);
+	RawState::Read(stream, m_core0OutputOffset);
+	RawState::Read(stream, m_channelOn);
+	RawState::Read(stream, m_channelReverb);
+	RawState::Read(stream, m_reverbWorkAddrStart);
+	RawState::Read(stream, m_reverbWorkAddrEnd);
+	RawState::Read(stream, m_reverbCurrAddr);
+	RawState::Read(stream, m_reverb);
+	RawState::Read(stream, m_channel);
+	for(auto& reader : m_reader)
+	{
+		reader.LoadRawState(stream);
+	}
+}
+
+void CSpuBase::SaveRawState(Framework::CStream& stream)
+{
+	RawState::Write(stream, m_ctrl);
+	RawState::Write(stream, m_irqAddr);
+	RawState::Write(stream, m_transferMode);
+	RawState::Write(stream, m_transferAddr);
+	RawState::Write(stream, m_core0OutputOffset);
+	RawState::Write(stream, m_channelOn);
+	RawState::Write(stream, m_channelReverb);
+	RawState::Write(stream, m_reverbWorkAddrStart);
+	RawState::Write(stream, m_reverbWorkAddrEnd);
+	RawState::Write(stream, m_reverbCurrAddr);
+	RawState::Write(stream, m_reverb);
+	RawState::Write(stream, m_channel);
+	for(const auto& reader : m_reader)
+	{
+		reader.SaveRawState(stream);
+	}
+}
+
 bool CSpuBase::IsEnabled() const
 {
 	return (m_ctrl & 0x8000) != 0;
@@ -519,6 +563,7 @@ uint32 CSpuBase::ReceiveDma(uint8* buffer, uint32 blockSize, uint32 blockAmount)
 		{
 			uint32 copySize = std::min<uint32>(m_ramSize - m_transferAddr, blockSize);
 			memcpy(m_ram + m_transferAddr, buffer, copySize);
+			if(m_ramTracker) m_ramTracker->MarkDirty(m_transferAddr, copySize);
 			m_transferAddr += blockSize;
 			m_transferAddr &= m_ramSize - 1;
 			buffer += blockSize;
@@ -541,6 +586,7 @@ uint32 CSpuBase::ReceiveDma(uint8* buffer, uint32 blockSize, uint32 blockAmount)
 
 		uint32 dstAddr = m_soundInputDataAddr + m_blockWritePtr;
 		memcpy(m_ram + dstAddr, buffer, blockAmount * blockSize);
+		if(m_ramTracker) m_ramTracker->MarkDirty(dstAddr, blockAmount * blockSize);
 		m_blockWritePtr += blockAmount * blockSize;
 
 		return blockAmount;
@@ -555,6 +601,7 @@ void CSpuBase::WriteWord(uint16 value)
 {
 	assert((m_transferAddr + 1) < m_ramSize);
 	*reinterpret_cast<uint16*>(&m_ram[m_transferAddr]) = value;
+	if(m_ramTracker) m_ramTracker->MarkDirty(m_transferAddr, 2);
 	m_transferAddr += 2;
 }
 
@@ -607,241 +654,323 @@ void CSpuBase::Render(int16* samples, unsigned int sampleCount, unsigned int sam
 	bool updateReverb = m_reverbEnabled && (m_ctrl & CONTROL_REVERB) && (m_reverbWorkAddrStart < m_reverbWorkAddrEnd);
 	bool checkIrqs = (m_ctrl & CONTROL_IRQ) && (m_irqAddr != INVALID_ADDRESS);
 
+	if(updateReverb && m_ramTracker)
+	{
+		//Reverb writes anywhere in its work area
+		m_ramTracker->MarkDirty(m_reverbWorkAddrStart, m_reverbWorkAddrEnd - m_reverbWorkAddrStart);
+	}
+
 	assert((sampleCount & 0x01) == 0);
 	//ticks are 44100Hz ticks
 	unsigned int ticks = sampleCount / 2;
 	memset(samples, 0, sizeof(int16) * sampleCount);
 
-	for(unsigned int j = 0; j < ticks; j++)
+	for(unsigned int blockTick = 0; blockTick < ticks; blockTick += RENDER_BLOCK_TICKS)
 	{
-		int16 reverbSample[2] = {0, 0};
+		unsigned int blockTicks = std::min<unsigned int>(ticks - blockTick, RENDER_BLOCK_TICKS);
+
+		int16 reverbSamples[RENDER_BLOCK_TICKS * 2];
+		memset(reverbSamples, 0, sizeof(reverbSamples));
+
 		//Update channels
-		for(unsigned int i = 0; i < 24; i++)
+		for(unsigned int i = 0; i < MAX_CHANNEL; i++)
 		{
-			auto& channel(m_channel[i]);
-			if((channel.status == STOPPED) && !checkIrqs) continue;
-			auto& reader(m_reader[i]);
-			if(channel.status == KEY_ON)
+			bool channelReverb = updateReverb && (m_channelReverb.f & (1 << i));
+			RenderChannel(i, samples, channelReverb ? reverbSamples : nullptr, blockTicks, sampleRate, checkIrqs);
+		}
+
+		for(unsigned int j = 0; j < blockTicks; j++)
+		{
+			int16* reverbSample = reverbSamples + (j * 2);
+
+			if(!m_blockReader.CanReadSamples() && (m_blockWritePtr == SOUND_INPUT_DATA_SIZE))
 			{
-				reader.SetParams(channel.address, channel.repeat);
-				reader.ClearEndFlag();
-				channel.status = ATTACK;
-				channel.adsrVolume = 0;
+				//We're ready to consume some data
+				m_blockReader.FillBlock(m_ram + m_soundInputDataAddr);
+				m_blockWritePtr = 0;
 			}
-			else
+
+			if(m_blockReader.CanReadSamples())
 			{
-				if(reader.IsDone())
+				int16 sampleL = 0;
+				int16 sampleR = 0;
+				m_blockReader.GetSamples(sampleL, sampleR, sampleRate);
+
+				MixSamples(sampleL, 0x3FFF, samples + 0);
+				MixSamples(sampleR, 0x3FFF, samples + 1);
+			}
+
+			//Simulate SPU CORE0 writing its output in RAM and check for potential interrupts
+			if(m_spuNumber == 0)
+			{
+				if(m_irqAddr == (CORE0_OUTPUT_LEFT + m_core0OutputOffset))
 				{
-					channel.status = STOPPED;
-					channel.adsrVolume = 0;
-					reader.ClearIsDone();
-					//No point in continuing if we don't need to check interrupts
-					if(!checkIrqs) continue;
+					m_irqPending = true;
 				}
-				if(reader.DidChangeRepeat())
+				else if(m_irqAddr == (CORE0_OUTPUT_RIGHT + m_core0OutputOffset))
 				{
-					channel.repeat = reader.GetRepeat();
-					reader.ClearDidChangeRepeat();
+					m_irqPending = true;
 				}
-				//Update repeat in case it has been changed externally (needed for FFX)
-				reader.SetRepeat(channel.repeat);
+				m_core0OutputOffset += 2;
+				m_core0OutputOffset &= (CORE0_OUTPUT_SIZE - 1);
 			}
 
-			reader.SetIrqAddress(m_irqAddr);
+			//Update reverb
+			if(updateReverb)
+			{
+				//Feed samples to FIR filter
+				if(m_reverbTicks & 1)
+				{
+					//IIR_INPUT_A0 = buffer[IIR_SRC_A0] * IIR_COEF + INPUT_SAMPLE_L * IN_COEF_L;
+					//IIR_INPUT_A1 = buffer[IIR_SRC_A1] * IIR_COEF + INPUT_SAMPLE_R * IN_COEF_R;
+					//IIR_INPUT_B0 = buffer[IIR_SRC_B0] * IIR_COEF + INPUT_SAMPLE_L * IN_COEF_L;
+					//IIR_INPUT_B1 = buffer[IIR_SRC_B1] * IIR_COEF + INPUT_SAMPLE_R * IN_COEF_R;
+
+					float input_sample_l = static_cast<float>(reverbSample[0]) * 0.5f;
+					float input_sample_r = static_cast<float>(reverbSample[1]) * 0.5f;
+
+					float irr_coef = GetReverbCoef(IIR_COEF);
+					float in_coef_l = GetReverbCoef(IN_COEF_L);
+					float in_coef_r = GetReverbCoef(IN_COEF_R);
+
+					float iir_input_a0 = GetReverbSample(GetReverbOffset(ACC_SRC_A0)) * irr_coef + input_sample_l * in_coef_l;
+					float iir_input_a1 = GetReverbSample(GetReverbOffset(ACC_SRC_A1)) * irr_coef + input_sample_r * in_coef_r;
+					float iir_input_b0 = GetReverbSample(GetReverbOffset(ACC_SRC_B0)) * irr_coef + input_sample_l * in_coef_l;
+					float iir_input_b1 = GetReverbSample(GetReverbOffset(ACC_SRC_B1)) * irr_coef + input_sample_r * in_coef_r;
+
+					//IIR_A0 = IIR_INPUT_A0 * IIR_ALPHA + buffer[IIR_DEST_A0] * (1.0 - IIR_ALPHA);
+					//IIR_A1 = IIR_INPUT_A1 * IIR_ALPHA + buffer[IIR_DEST_A1] * (1.0 - IIR_ALPHA);
+					//IIR_B0 = IIR_INPUT_B0 * IIR_ALPHA + buffer[IIR_DEST_B0] * (1.0 - IIR_ALPHA);
+					//IIR_B1 = IIR_INPUT_B1 * IIR_ALPHA + buffer[IIR_DEST_B1] * (1.0 - IIR_ALPHA);
+
+					float iir_alpha = GetReverbCoef(IIR_ALPHA);
+
+					float iir_a0 = iir_input_a0 * iir_alpha + GetReverbSample(GetReverbOffset(IIR_DEST_A0)) * (1.0f - iir_alpha);
+					float iir_a1 = iir_input_a1 * iir_alpha + GetReverbSample(GetReverbOffset(IIR_DEST_A1)) * (1.0f - iir_alpha);
+					float iir_b0 = iir_input_b0 * iir_alpha + GetReverbSample(GetReverbOffset(IIR_DEST_B0)) * (1.0f - iir_alpha);
+					float iir_b1 = iir_input_b1 * iir_alpha + GetReverbSample(GetReverbOffset(IIR_DEST_B1)) * (1.0f - iir_alpha);
+
+					//buffer[IIR_DEST_A0 + 1sample] = IIR_A0;
+					//buffer[IIR_DEST_A1 + 1sample] = IIR_A1;
+					//buffer[IIR_DEST_B0 + 1sample] = IIR_B0;
+					//buffer[IIR_DEST_B1 + 1sample] = IIR_B1;
+
+					SetReverbSample(GetReverbOffset(IIR_DEST_A0) + 2, iir_a0);
+					SetReverbSample(GetReverbOffset(IIR_DEST_A1) + 2, iir_a1);
+					SetReverbSample(GetReverbOffset(IIR_DEST_B0) + 2, iir_b0);
+					SetReverbSample(GetReverbOffset(IIR_DEST_B1) + 2, iir_b1);
+
+					//ACC0 = buffer[ACC_SRC_A0] * ACC_COEF_A +
+					//	   buffer[ACC_SRC_B0] * ACC_COEF_B +
+					//	   buffer[ACC_SRC_C0] * ACC_COEF_C +
+					//	   buffer[ACC_SRC_D0] * ACC_COEF_D;
+					//ACC1 = buffer[ACC_SRC_A1] * ACC_COEF_A +
+					//	   buffer[ACC_SRC_B1] * ACC_COEF_B +
+					//	   buffer[ACC_SRC_C1] * ACC_COEF_C +
+					//	   buffer[ACC_SRC_D1] * ACC_COEF_D;
+
+					float acc_coef_a = GetReverbCoef(ACC_COEF_A);
+					float acc_coef_b = GetReverbCoef(ACC_COEF_B);
+					float acc_coef_c = GetReverbCoef(ACC_COEF_C);
+					float acc_coef_d = GetReverbCoef(ACC_COEF_D);
+
+					float acc0 =
+					    GetReverbSample(GetReverbOffset(ACC_SRC_A0)) * acc_coef_a +
+					    GetReverbSample(GetReverbOffset(ACC_SRC_B0)) * acc_coef_b +
+					    GetReverbSample(GetReverbOffset(ACC_SRC_C0)) * acc_coef_c +
+					    GetReverbSample(GetReverbOffset(ACC_SRC_D0)) * acc_coef_d;
+
+					float acc1 =
+					    GetReverbSample(GetReverbOffset(ACC_SRC_A1)) * acc_coef_a +
+					    GetReverbSample(GetReverbOffset(ACC_SRC_B1)) * acc_coef_b +
+					    GetReverbSample(GetReverbOffset(ACC_SRC_C1)) * acc_coef_c +
+					    GetReverbSample(GetReverbOffset(ACC_SRC_D1)) * acc_coef_d;
+
+					//FB_A0 = buffer[MIX_DEST_A0 - FB_SRC_A];
+					//FB_A1 = buffer[MIX_DEST_A1 - FB_SRC_A];
+					//FB_B0 = buffer[MIX_DEST_B0 - FB_SRC_B];
+					//FB_B1 = buffer[MIX_DEST_B1 - FB_SRC_B];
+
+					float fb_a0 = GetReverbSample(GetReverbOffset(MIX_DEST_A0) - GetReverbOffset(FB_SRC_A));
+					float fb_a1 = GetReverbSample(GetReverbOffset(MIX_DEST_A1) - GetReverbOffset(FB_SRC_A));
+					float fb_b0 = GetReverbSample(GetReverbOffset(MIX_DEST_B0) - GetReverbOffset(FB_SRC_B));
+					float fb_b1 = GetReverbSample(GetReverbOffset(MIX_DEST_B1) - GetReverbOffset(FB_SRC_B));
+
+					//buffer[MIX_DEST_A0] = ACC0 - FB_A0 * FB_ALPHA;
+					//buffer[MIX_DEST_A1] = ACC1 - FB_A1 * FB_ALPHA;
+					//buffer[MIX_DEST_B0] = (FB_ALPHA * ACC0) - FB_A0 * (FB_ALPHA^0x8000) - FB_B0 * FB_X;
+					//buffer[MIX_DEST_B1] = (FB_ALPHA * ACC1) - FB_A1 * (FB_ALPHA^0x8000) - FB_B1 * FB_X;
+
+					float fb_alpha = GetReverbCoef(FB_ALPHA);
+					float fb_x = GetReverbCoef(FB_X);
+
+					SetReverbSample(GetReverbOffset(MIX_DEST_A0), acc0 - fb_a0 * fb_alpha);
+					SetReverbSample(GetReverbOffset(MIX_DEST_A1), acc1 - fb_a1 * fb_alpha);
+					SetReverbSample(GetReverbOffset(MIX_DEST_B0), (fb_alpha * acc0) - fb_a0 * -fb_alpha - fb_b0 * fb_x);
+					SetReverbSample(GetReverbOffset(MIX_DEST_B1), (fb_alpha * acc1) - fb_a1 * -fb_alpha - fb_b1 * fb_x);
+
+					m_reverbCurrAddr += 2;
+					if(m_reverbCurrAddr >= m_reverbWorkAddrEnd)
+					{
+						m_reverbCurrAddr = m_reverbWorkAddrStart;
+					}
+				}
 
-			int16 readSample = 0;
-			reader.SetPitch(m_baseSamplingRate, channel.pitch);
-			reader.GetSamples(&readSample, 1, sampleRate);
-			channel.current = reader.GetCurrent();
+				if(m_reverbWorkAddrStart != 0)
+				{
+					float sampleL = 0.333f * (GetReverbSample(GetReverbOffset(MIX_DEST_A0)) + GetReverbSample(GetReverbOffset(MIX_DEST_B0)));
+					float sampleR = 0.333f * (GetReverbSample(GetReverbOffset(MIX_DEST_A1)) + GetReverbSample(GetReverbOffset(MIX_DEST_B1)));
+
+					{
+						int16* output = samples + 0;
+						int32 resultSample = static_cast<int32>(sampleL) + static_cast<int32>(*output);
+						resultSample = std::max<int32>(resultSample, SHRT_MIN);
+						resultSample = std::min<int32>(resultSample, SHRT_MAX);
+						*output = static_cast<int16>(resultSample);
+					}
+
+					{
+						int16* output = samples + 1;
+						int32 resultSample = static_cast<int32>(sampleR) + static_cast<int32>(*output);
+						resultSample = std::max<int32>(resultSample, SHRT_MIN);
+						resultSample = std::min<int32>(resultSample, SHRT_MAX);
+						*output = static_cast<int16>(resultSample);
+					}
+				}
 
-			if(checkIrqs && reader.GetIrqPending())
-			{
-				m_irqPending = true;
+				m_reverbTicks++;
 			}
+			samples += 2;
+		}
+	}
+}
 
-			reader.ClearIrqPending();
+void CSpuBase::RenderChannel(unsigned int channelIndex, int16* samples, int16* reverbSamples, unsigned int ticks, unsigned int sampleRate, bool checkIrqs)
+{
+	auto& channel(m_channel[channelIndex]);
+	auto& reader(m_reader[channelIndex]);
 
-			//Mix samples
-			UpdateAdsr(channel);
-			int32 inputSample = static_cast<int32>(readSample);
-			//Mix adsrVolume
+	int16 voiceSamples[RENDER_BLOCK_TICKS];
+	int16 envelope[RENDER_BLOCK_TICKS];
+	int16 volumeLeft[RENDER_BLOCK_TICKS];
+	int16 volumeRight[RENDER_BLOCK_TICKS];
+	uint32 adsrVolumes[RENDER_BLOCK_TICKS];
+	uint16 statuses[RENDER_BLOCK_TICKS];
+	int32 volumeLeftAbs[RENDER_BLOCK_TICKS];
+	int32 volumeRightAbs[RENDER_BLOCK_TICKS];
+
+	unsigned int tick = 0;
+	while(tick < ticks)
+	{
+		if((channel.status == STOPPED) && !checkIrqs) break;
+		if(channel.status == KEY_ON)
+		{
+			reader.SetParams(channel.address, channel.repeat);
+			reader.ClearEndFlag();
+			channel.status = ATTACK;
+			channel.adsrVolume = 0;
+		}
+		else
+		{
+			if(reader.IsDone())
 			{
-				inputSample = (inputSample * static_cast<int32>(channel.adsrVolume >> 16)) / static_cast<int32>(MAX_ADSR_VOLUME >> 16);
+				channel.status = STOPPED;
+				channel.adsrVolume = 0;
+				reader.ClearIsDone();
+				//No point in continuing if we don't need to check interrupts
+				if(!checkIrqs) break;
 			}
-
-			channel.volumeLeftAbs = ComputeChannelVolume(channel.volumeLeft, channel.volumeLeftAbs);
-			channel.volumeRightAbs = ComputeChannelVolume(channel.volumeRight, channel.volumeRightAbs);
-
-			int32 adjustedLeftVolume = std::min<int32>(0x7FFF, static_cast<int32>(static_cast<float>(channel.volumeLeftAbs >> 16) * m_volumeAdjust));
-			int32 adjustedRightVolume = std::min<int32>(0x7FFF, static_cast<int32>(static_cast<float>(channel.volumeRightAbs >> 16) * m_volumeAdjust));
-			MixSamples(inputSample, adjustedLeftVolume, samples + 0);
-			MixSamples(inputSample, adjustedRightVolume, samples + 1);
-			//Mix in reverb if enabled for this channel
-			if(updateReverb && (m_channelReverb.f & (1 << i)))
+			if(reader.DidChangeRepeat())
 			{
-				MixSamples(inputSample, adjustedLeftVolume, reverbSample + 0);
-				MixSamples(inputSample, adjustedRightVolume, reverbSample + 1);
+				channel.repeat = reader.GetRepeat();
+				reader.ClearDidChangeRepeat();
 			}
+			//Update repeat in case it has been changed externally (needed for FFX)
+			reader.SetRepeat(channel.repeat);
 		}
 
-		if(!m_blockReader.CanReadSamples() && (m_blockWritePtr == SOUND_INPUT_DATA_SIZE))
-		{
-			//We're ready to consume some data
-			m_blockReader.FillBlock(m_ram + m_soundInputDataAddr);
-			m_blockWritePtr = 0;
-		}
+		reader.SetIrqAddress(m_irqAddr);
+		reader.SetPitch(m_baseSamplingRate, channel.pitch);
 
-		if(m_blockReader.CanReadSamples())
-		{
-			int16 sampleL = 0;
-			int16 sampleR = 0;
-			m_blockReader.GetSamples(sampleL, sampleR, sampleRate);
+		//Envelope and volumes don't depend on the voice's samples. Compute them first to know
+		//for how many ticks the voice will be playing.
+		const auto adjustVolume =
+		    [this](int32 volume) {
+			    return static_cast<int16>(std::min<int32>(0x7FFF, static_cast<int32>(static_cast<float>(volume >> 16) * m_volumeAdjust)));
+		    };
 
-			MixSamples(sampleL, 0x3FFF, samples + 0);
-			MixSamples(sampleR, 0x3FFF, samples + 1);
+		//Volumes only change from tick to tick when sweeping
+		bool volumeSweep = channel.volumeLeft.mode.mode || channel.volumeRight.mode.mode;
+		int16 fixedVolumeLeft = 0;
+		int16 fixedVolumeRight = 0;
+		if(!volumeSweep)
+		{
+			channel.volumeLeftAbs = ComputeChannelVolume(channel.volumeLeft, channel.volumeLeftAbs);
+			channel.volumeRightAbs = ComputeChannelVolume(channel.volumeRight, channel.volumeRightAbs);
+			fixedVolumeLeft = adjustVolume(channel.volumeLeftAbs);
+			fixedVolumeRight = adjustVolume(channel.volumeRightAbs);
 		}
 
-		//Simulate SPU CORE0 writing its output in RAM and check for potential interrupts
-		if(m_spuNumber == 0)
+		unsigned int count = ticks - tick;
+		bool silent = true;
+		for(unsigned int i = 0; i < count; i++)
 		{
-			if(m_irqAddr == (CORE0_OUTPUT_LEFT + m_core0OutputOffset))
+			UpdateAdsr(channel);
+			if(volumeSweep)
 			{
-				m_irqPending = true;
+				channel.volumeLeftAbs = ComputeChannelVolume(channel.volumeLeft, channel.volumeLeftAbs);
+				channel.volumeRightAbs = ComputeChannelVolume(channel.volumeRight, channel.volumeRightAbs);
+				volumeLeft[i] = adjustVolume(channel.volumeLeftAbs);
+				volumeRight[i] = adjustVolume(channel.volumeRightAbs);
 			}
-			else if(m_irqAddr == (CORE0_OUTPUT_RIGHT + m_core0OutputOffset))
+			else
 			{
-				m_irqPending = true;
+				volumeLeft[i] = fixedVolumeLeft;
+				volumeRight[i] = fixedVolumeRight;
 			}
-			m_core0OutputOffset += 2;
-			m_core0OutputOffset &= (CORE0_OUTPUT_SIZE - 1);
-		}
 
-		//Update reverb
-		if(updateReverb)
-		{
-			//Feed samples to FIR filter
-			if(m_reverbTicks & 1)
+			adsrVolumes[i] = channel.adsrVolume;
+			statuses[i] = channel.status;
+			volumeLeftAbs[i] = channel.volumeLeftAbs;
+			volumeRightAbs[i] = channel.volumeRightAbs;
+
+			envelope[i] = static_cast<int16>(channel.adsrVolume >> 16);
+			silent &= (envelope[i] == 0);
+
+			if((channel.status == STOPPED) && !checkIrqs)
 			{
-				//IIR_INPUT_A0 = buffer[IIR_SRC_A0] * IIR_COEF + INPUT_SAMPLE_L * IN_COEF_L;
-				//IIR_INPUT_A1 = buffer[IIR_SRC_A1] * IIR_COEF + INPUT_SAMPLE_R * IN_COEF_R;
-				//IIR_INPUT_B0 = buffer[IIR_SRC_B0] * IIR_COEF + INPUT_SAMPLE_L * IN_COEF_L;
-				//IIR_INPUT_B1 = buffer[IIR_SRC_B1] * IIR_COEF + INPUT_SAMPLE_R * IN_COEF_R;
-
-				float input_sample_l = static_cast<float>(reverbSample[0]) * 0.5f;
-				float input_sample_r = static_cast<float>(reverbSample[1]) * 0.5f;
-
-				float irr_coef = GetReverbCoef(IIR_COEF);
-				float in_coef_l = GetReverbCoef(IN_COEF_L);
-				float in_coef_r = GetReverbCoef(IN_COEF_R);
-
-				float iir_input_a0 = GetReverbSample(GetReverbOffset(ACC_SRC_A0)) * irr_coef + input_sample_l * in_coef_l;
-				float iir_input_a1 = GetReverbSample(GetReverbOffset(ACC_SRC_A1)) * irr_coef + input_sample_r * in_coef_r;
-				float iir_input_b0 = GetReverbSample(GetReverbOffset(ACC_SRC_B0)) * irr_coef + input_sample_l * in_coef_l;
-				float iir_input_b1 = GetReverbSample(GetReverbOffset(ACC_SRC_B1)) * irr_coef + input_sample_r * in_coef_r;
-
-				//IIR_A0 = IIR_INPUT_A0 * IIR_ALPHA + buffer[IIR_DEST_A0] * (1.0 - IIR_ALPHA);
-				//IIR_A1 = IIR_INPUT_A1 * IIR_ALPHA + buffer[IIR_DEST_A1] * (1.0 - IIR_ALPHA);
-				//IIR_B0 = IIR_INPUT_B0 * IIR_ALPHA + buffer[IIR_DEST_B0] * (1.0 - IIR_ALPHA);
-				//IIR_B1 = IIR_INPUT_B1 * IIR_ALPHA + buffer[IIR_DEST_B1] * (1.0 - IIR_ALPHA);
-
-				float iir_alpha = GetReverbCoef(IIR_ALPHA);
-
-				float iir_a0 = iir_input_a0 * iir_alpha + GetReverbSample(GetReverbOffset(IIR_DEST_A0)) * (1.0f - iir_alpha);
-				float iir_a1 = iir_input_a1 * iir_alpha + GetReverbSample(GetReverbOffset(IIR_DEST_A1)) * (1.0f - iir_alpha);
-				float iir_b0 = iir_input_b0 * iir_alpha + GetReverbSample(GetReverbOffset(IIR_DEST_B0)) * (1.0f - iir_alpha);
-				float iir_b1 = iir_input_b1 * iir_alpha + GetReverbSample(GetReverbOffset(IIR_DEST_B1)) * (1.0f - iir_alpha);
-
-				//buffer[IIR_DEST_A0 + 1sample] = IIR_A0;
-				//buffer[IIR_DEST_A1 + 1sample] = IIR_A1;
-				//buffer[IIR_DEST_B0 + 1sample] = IIR_B0;
-				//buffer[IIR_DEST_B1 + 1sample] = IIR_B1;
-
-				SetReverbSample(GetReverbOffset(IIR_DEST_A0) + 2, iir_a0);
-				SetReverbSample(GetReverbOffset(IIR_DEST_A1) + 2, iir_a1);
-				SetReverbSample(GetReverbOffset(IIR_DEST_B0) + 2, iir_b0);
-				SetReverbSample(GetReverbOffset(IIR_DEST_B1) + 2, iir_b1);
-
-				//ACC0 = buffer[ACC_SRC_A0] * ACC_COEF_A +
-				//	   buffer[ACC_SRC_B0] * ACC_COEF_B +
-				//	   buffer[ACC_SRC_C0] * ACC_COEF_C +
-				//	   buffer[ACC_SRC_D0] * ACC_COEF_D;
-				//ACC1 = buffer[ACC_SRC_A1] * ACC_COEF_A +
-				//	   buffer[ACC_SRC_B1] * ACC_COEF_B +
-				//	   buffer[ACC_SRC_C1] * ACC_COEF_C +
-				//	   buffer[ACC_SRC_D1] * ACC_COEF_D;
-
-				float acc_coef_a = GetReverbCoef(ACC_COEF_A);
-				float acc_coef_b = GetReverbCoef(ACC_COEF_B);
-				float acc_coef_c = GetReverbCoef(ACC_COEF_C);
-				float acc_coef_d = GetReverbCoef(ACC_COEF_D);
-
-				float acc0 =
-				    GetReverbSample(GetReverbOffset(ACC_SRC_A0)) * acc_coef_a +
-				    GetReverbSample(GetReverbOffset(ACC_SRC_B0)) * acc_coef_b +
-				    GetReverbSample(GetReverbOffset(ACC_SRC_C0)) * acc_coef_c +
-				    GetReverbSample(GetReverbOffset(ACC_SRC_D0)) * acc_coef_d;
-
-				float acc1 =
-				    GetReverbSample(GetReverbOffset(ACC_SRC_A1)) * acc_coef_a +
-				    GetReverbSample(GetReverbOffset(ACC_SRC_B1)) * acc_coef_b +
-				    GetReverbSample(GetReverbOffset(ACC_SRC_C1)) * acc_coef_c +
-				    GetReverbSample(GetReverbOffset(ACC_SRC_D1)) * acc_coef_d;
-
-				//FB_A0 = buffer[MIX_DEST_A0 - FB_SRC_A];
-				//FB_A1 = buffer[MIX_DEST_A1 - FB_SRC_A];
-				//FB_B0 = buffer[MIX_DEST_B0 - FB_SRC_B];
-				//FB_B1 = buffer[MIX_DEST_B1 - FB_SRC_B];
-
-				float fb_a0 = GetReverbSample(GetReverbOffset(MIX_DEST_A0) - GetReverbOffset(FB_SRC_A));
-				float fb_a1 = GetReverbSample(GetReverbOffset(MIX_DEST_A1) - GetReverbOffset(FB_SRC_A));
-				float fb_b0 = GetReverbSample(GetReverbOffset(MIX_DEST_B0) - GetReverbOffset(FB_SRC_B));
-				float fb_b1 = GetReverbSample(GetReverbOffset(MIX_DEST_B1) - GetReverbOffset(FB_SRC_B));
-
-				//buffer[MIX_DEST_A0] = ACC0 - FB_A0 * FB_ALPHA;
-				//buffer[MIX_DEST_A1] = ACC1 - FB_A1 * FB_ALPHA;
-				//buffer[MIX_DEST_B0] = (FB_ALPHA * ACC0) - FB_A0 * (FB_ALPHA^0x8000) - FB_B0 * FB_X;
-				//buffer[MIX_DEST_B1] = (FB_ALPHA * ACC1) - FB_A1 * (FB_ALPHA^0x8000) - FB_B1 * FB_X;
-
-				float fb_alpha = GetReverbCoef(FB_ALPHA);
-				float fb_x = GetReverbCoef(FB_X);
-
-				SetReverbSample(GetReverbOffset(MIX_DEST_A0), acc0 - fb_a0 * fb_alpha);
-				SetReverbSample(GetReverbOffset(MIX_DEST_A1), acc1 - fb_a1 * fb_alpha);
-				SetReverbSample(GetReverbOffset(MIX_DEST_B0), (fb_alpha * acc0) - fb_a0 * -fb_alpha - fb_b0 * fb_x);
-				SetReverbSample(GetReverbOffset(MIX_DEST_B1), (fb_alpha * acc1) - fb_a1 * -fb_alpha - fb_b1 * fb_x);
-
-				m_reverbCurrAddr += 2;
-				if(m_reverbCurrAddr >= m_reverbWorkAddrEnd)
-				{
-					m_reverbCurrAddr = m_reverbWorkAddrStart;
-				}
+				count = i + 1;
+				break;
 			}
+		}
 
-			if(m_reverbWorkAddrStart != 0)
-			{
-				float sampleL = 0.333f * (GetReverbSample(GetReverbOffset(MIX_DEST_A0)) + GetReverbSample(GetReverbOffset(MIX_DEST_B0)));
-				float sampleR = 0.333f * (GetReverbSample(GetReverbOffset(MIX_DEST_A1)) + GetReverbSample(GetReverbOffset(MIX_DEST_B1)));
+		unsigned int readCount = reader.GetSamples(voiceSamples, count, sampleRate);
+		channel.current = reader.GetCurrent();
 
-				{
-					int16* output = samples + 0;
-					int32 resultSample = static_cast<int32>(sampleL) + static_cast<int32>(*output);
-					resultSample = std::max<int32>(resultSample, SHRT_MIN);
-					resultSample = std::min<int32>(resultSample, SHRT_MAX);
-					*output = static_cast<int16>(resultSample);
-				}
+		if(checkIrqs && reader.GetIrqPending())
+		{
+			m_irqPending = true;
+		}
 
-				{
-					int16* output = samples + 1;
-					int32 resultSample = static_cast<int32>(sampleR) + static_cast<int32>(*output);
-					resultSample = std::max<int32>(resultSample, SHRT_MIN);
-					resultSample = std::min<int32>(resultSample, SHRT_MAX);
-					*output = static_cast<int16>(resultSample);
-				}
-			}
+		reader.ClearIrqPending();
 
-			m_reverbTicks++;
+		if(readCount != count)
+		{
+			//Voice ended before the end of the block, rewind envelope and volumes to where it stopped
+			count = readCount;
+			channel.adsrVolume = adsrVolumes[count - 1];
+			channel.status = statuses[count - 1];
+			channel.volumeLeftAbs = volumeLeftAbs[count - 1];
+			channel.volumeRightAbs = volumeRightAbs[count - 1];
 		}
-		samples += 2;
+
+		if(!silent)
+		{
+			SpuKernels::MixVoice(samples + (tick * 2), reverbSamples ? (reverbSamples + (tick * 2)) : nullptr,
+			                     voiceSamples, envelope, volumeLeft, volumeRight, count);
+		}
+
+		tick += count;
 	}
 }
 
@@ -1075,6 +1204,42 @@ void CSpuBase::CSampleReader::SaveState(CRegisterStateFile* registerFile, const
 	}
 }
 
+void CSpuBase::CSampleReader::LoadRawState(Framework::CStream& stream)
+{
+	RawState::Read(stream, m_srcSampleIdx);
+	RawState::Read(stream, m_srcSamplingRate);
+	RawState::Read(stream, m_nextSampleAddr);
+	RawState::Read(stream, m_repeatAddr);
+	RawState::Read(stream, m_irqAddr);
+	RawState::Read(stream, m_buffer);
+	RawState::Read(stream, m_pitch);
+	RawState::Read(stream, m_s1);
+	RawState::Read(stream, m_s2);
+	RawState::Read(stream, m_done);
+	RawState::Read(stream, m_nextValid);
+	RawState::Read(stream, m_endFlag);
+	RawState::Read(stream, m_irqPending);
+	RawState::Read(stream, m_didChangeRepeat);
+}
+
+void CSpuBase::CSampleReader::SaveRawState(Framework::CStream& stream) const
+{
+	RawState::Write(stream, m_srcSampleIdx);
+	RawState::Write(stream, m_srcSamplingRate);
+	RawState::Write(stream, m_nextSampleAddr);
+	RawState::Write(stream, m_repeatAddr);
+	RawState::Write(stream, m_irqAddr);
+	RawState::Write(stream, m_buffer);
+	RawState::Write(stream, m_pitch);
+	RawState::Write(stream, m_s1);
+	RawState::Write(stream, m_s2);
+	RawState::Write(stream, m_done);
+	RawState::Write(stream, m_nextValid);
+	RawState::Write(stream, m_endFlag);
+	RawState::Write(stream, m_irqPending);
+	RawState::Write(stream, m_didChangeRepeat);
+}
+
 void CSpuBase::CSampleReader::SetParams(uint32 address, uint32 repeat)
 {
 	m_srcSampleIdx = 0;
@@ -1093,15 +1258,21 @@ void CSpuBase::CSampleReader::SetPitch(uint32 baseSamplingRate, uint16 pitch)
 	m_srcSamplingRate = baseSamplingRate * pitch / 4096;
 }
 
-void CSpuBase::CSampleReader::GetSamples(int16* samples, unsigned int sampleCount, unsigned int dstSamplingRate)
+unsigned int CSpuBase::CSampleReader::GetSamples(int16* samples, unsigned int sampleCount, unsigned int dstSamplingRate)
 {
+	uint32 sampleStep = (m_srcSamplingRate * TIME_SCALE) / dstSamplingRate;
 	for(unsigned int i = 0; i < sampleCount; i++)
 	{
-		samples[i] = GetSample(dstSamplingRate);
+		samples[i] = GetSample(sampleStep);
+		if(m_done)
+		{
+			return i + 1;
+		}
 	}
+	return sampleCount;
 }
 
-int16 CSpuBase::CSampleReader::GetSample(unsigned int dstSamplingRate)
+int16 CSpuBase::CSampleReader::GetSample(uint32 sampleStep)
 {
 	uint32 srcSampleIdx = m_srcSampleIdx / TIME_SCALE;
 	int32 srcSampleAlpha = m_srcSampleIdx % TIME_SCALE;
@@ -1109,7 +1280,7 @@ int16 CSpuBase::CSampleReader::GetSample(unsigned int dstSamplingRate)
 	int32 nextSample = m_buffer[srcSampleIdx + 1];
 	int32 resultSample = (currentSample * (TIME_SCALE - srcSampleAlpha) / TIME_SCALE) +
 	                     (nextSample * srcSampleAlpha / TIME_SCALE);
-	m_srcSampleIdx += (m_srcSamplingRate * TIME_SCALE) / dstSamplingRate;
+	m_srcSampleIdx += sampleStep;
 	if(srcSampleIdx >= BUFFER_SAMPLES)
 	{
 		m_srcSampleIdx -= BUFFER_SAMPLES * TIME_SCALE;
@@ -1135,7 +1306,7 @@ void CSpuBase::CSampleReader::AdvanceBuffer()
 
 void CSpuBase::CSampleReader::UnpackSamples(int16* dst)
 {
-	int32 workBuffer[BUFFER_SAMPLES];
+	int16 workBuffer[BUFFER_SAMPLES];
 
 	uint8* nextSample = m_ram + m_nextSampleAddr;
 
@@ -1151,19 +1322,8 @@ void CSpuBase::CSampleReader::UnpackSamples(int16* dst)
 	assert(predictNumber < 5);
 
 	//Get intermediate values
-	{
-		unsigned int workBufferPtr = 0;
-		for(unsigned int i = 2; i < 16; i++)
-		{
-			uint8 sampleByte = nextSample[i];
-			int16 firstSample = ((sampleByte & 0x0F) << 12);
-			int16 secondSample = ((sampleByte & 0xF0) << 8);
-			firstSample >>= shiftFactor;
-			secondSample >>= shiftFactor;
-			workBuffer[workBufferPtr++] = firstSample;
-			workBuffer[workBufferPtr++] = secondSample;
-		}
-	}
+	static_assert(static_cast<unsigned int>(BUFFER_SAMPLES) == SpuKernels::ADPCM_BLOCK_SAMPLES, "Buffer must hold exactly one ADPCM block.");
+	SpuKernels::ExpandAdpcmNibbles(nextSample, shiftFactor, workBuffer);
 
 	//Generate PCM samples
 	{
@@ -1178,7 +1338,7 @@ void CSpuBase::CSampleReader::UnpackSamples(int16* dst)
 
 		for(unsigned int i = 0; i < BUFFER_SAMPLES; i++)
 		{
-			int32 currentValue = workBuffer[i] * 64;
+			int32 currentValue = static_cast<int32>(workBuffer[i]) * 64;
 			currentValue += (m_s1 * predictorTable[predictNumber][0]) / 64;
 			currentValue += (m_s2 * predictorTable[predictNumber][1]) / 64;
 			m_s2 = m_s1;
@@ -7,6 +7,7 @@
 #include "zip/ZipArchiveReader.h"
 
 class CRegisterStateFile;
+class CDirtyPageTracker;
 
 namespace Iop
 {
@@ -153,13 +154,15 @@ namespace Iop
 			uint32 current;
 		};
 
-		CSpuBase(uint8*, uint32, unsigned int);
+		CSpuBase(uint8*, uint32, unsigned int, CDirtyPageTracker* = nullptr);
 		virtual ~CSpuBase() = default;
 
 		void Reset();
 
 		void LoadState(Framework::CZipArchiveReader&);
 		void SaveState(Framework::CZipArchiveWriter&);
+		void LoadRawState(Framework::CStream&);
+		void SaveRawState(Framework::CStream&);
 
 		bool IsEnabled() const;
 
@@ -242,10 +245,13 @@ namespace Iop
 
 			void LoadState(const CRegisterStateFile&, const std::string&);
 			void SaveState(CRegisterStateFile*, const std::string&) const;
+			void LoadRawState(Framework::CStream&);
+			void SaveRawState(Framework::CStream&) const;
 
 			void SetParams(uint32, uint32);
 			void SetPitch(uint32, uint16);
-			void GetSamples(int16*, unsigned int, unsigned int);
+			//Returns the number of samples read, stops early after the sample that ends the voice
+			unsigned int GetSamples(int16*, unsigned int, unsigned int);
 			uint32 GetRepeat() const;
 			void SetRepeat(uint32);
 			uint32 GetCurrent() const;
@@ -268,7 +274,7 @@ namespace Iop
 
 			void UnpackSamples(int16*);
 			void AdvanceBuffer();
-			int16 GetSample(unsigned int);
+			int16 GetSample(uint32);
 
 			uint8* m_ram = nullptr;
 			uint32 m_ramSize = 0;
@@ -315,6 +321,13 @@ namespace Iop
 			MAX_ADSR_VOLUME = 0x7FFFFFFF,
 		};
 
+		enum
+		{
+			//Voices are rendered in blocks of at most this many ticks
+			RENDER_BLOCK_TICKS = 64,
+		};
+
+		void RenderChannel(unsigned int, int16*, int16*, unsigned int, unsigned int, bool);
 		void UpdateAdsr(CHANNEL&);
 		uint32 GetAdsrDelta(unsigned int) const;
 		float GetReverbSample(uint32) const;
@@ -330,6 +343,7 @@ namespace Iop
 
 		uint8* m_ram;
 		uint32 m_ramSize;
+		CDirtyPageTracker* m_ramTracker = nullptr;
 		unsigned int m_spuNumber;
 		uint32 m_baseSamplingRate;
 
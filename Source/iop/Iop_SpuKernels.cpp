@@ -0,0 +1,210 @@
+#include <algorithm>
+#include <climits>
+#include "Iop_SpuKernels.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define SPUKERNELS_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define SPUKERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+using namespace SpuKernels;
+
+static int16 Saturate(int32 value)
+{
+	value = std::max<int32>(value, SHRT_MIN);
+	value = std::min<int32>(value, SHRT_MAX);
+	return static_cast<int16>(value);
+}
+
+static void MixVoiceScalar(int16* output, int16* reverbOutput, const int16* samples, const int16* envelope,
+                           const int16* volumeLeft, const int16* volumeRight, unsigned int count)
+{
+	for(unsigned int i = 0; i < count; i++)
+	{
+		int32 sample = (static_cast<int32>(samples[i]) * static_cast<int32>(envelope[i])) >> 15;
+		int32 sampleLeft = (sample * static_cast<int32>(volumeLeft[i])) >> 15;
+		int32 sampleRight = (sample * static_cast<int32>(volumeRight[i])) >> 15;
+		output[(i * 2) + 0] = Saturate(output[(i * 2) + 0] + sampleLeft);
+		output[(i * 2) + 1] = Saturate(output[(i * 2) + 1] + sampleRight);
+		if(reverbOutput)
+		{
+			reverbOutput[(i * 2) + 0] = Saturate(reverbOutput[(i * 2) + 0] + sampleLeft);
+			reverbOutput[(i * 2) + 1] = Saturate(reverbOutput[(i * 2) + 1] + sampleRight);
+		}
+	}
+}
+
+static void MixSaturateScalar(int16* output, const int16* input, unsigned int count)
+{
+	for(unsigned int i = 0; i < count; i++)
+	{
+		output[i] = Saturate(static_cast<int32>(output[i]) + static_cast<int32>(input[i]));
+	}
+}
+
+#if defined(SPUKERNELS_SSE2)
+
+//(a * b) >> 15, result must fit in 16 bits
+static __m128i MultiplyShift15(__m128i a, __m128i b)
+{
+	__m128i productLo = _mm_mullo_epi16(a, b);
+	__m128i productHi = _mm_mulhi_epi16(a, b);
+	return _mm_or_si128(_mm_slli_epi16(productHi, 1), _mm_srli_epi16(productLo, 15));
+}
+
+void SpuKernels::ExpandAdpcmNibbles(const uint8* block, unsigned int shiftFactor, int16* output)
+{
+	//Each nibble ends up in the top 4 bits of a 16-bit lane, low nibble first
+	const __m128i lowNibbleMask = _mm_set_epi16(0, -1, 0, -1, 0, -1, 0, -1);
+	const __m128i highNibbleMask = _mm_set1_epi16(static_cast<int16>(0xF000));
+	const __m128i shift = _mm_cvtsi32_si128(shiftFactor);
+
+	__m128i data = _mm_srli_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block)), 2);
+	__m128i bytesLo = _mm_unpacklo_epi8(data, data);
+	__m128i bytesHi = _mm_unpackhi_epi8(data, data);
+	__m128i pairs[4] =
+	    {
+	        _mm_unpacklo_epi16(bytesLo, bytesLo),
+	        _mm_unpackhi_epi16(bytesLo, bytesLo),
+	        _mm_unpacklo_epi16(bytesHi, bytesHi),
+	        _mm_unpackhi_epi16(bytesHi, bytesHi),
+	    };
+
+	for(unsigned int i = 0; i < 4; i++)
+	{
+		__m128i lowNibbles = _mm_and_si128(lowNibbleMask, _mm_slli_epi16(pairs[i], 12));
+		__m128i highNibbles = _mm_andnot_si128(lowNibbleMask, _mm_and_si128(pairs[i], highNibbleMask));
+		pairs[i] = _mm_sra_epi16(_mm_or_si128(lowNibbles, highNibbles), shift);
+	}
+
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(output + 0x00), pairs[0]);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(output + 0x08), pairs[1]);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(output + 0x10), pairs[2]);
+	_mm_storel_epi64(reinterpret_cast<__m128i*>(output + 0x18), pairs[3]);
+}
+
+void SpuKernels::MixVoice(int16* output, int16* reverbOutput, const int16* samples, const int16* envelope,
+                          const int16* volumeLeft, const int16* volumeRight, unsigned int count)
+{
+	unsigned int i = 0;
+	for(; (i + 8) <= count; i += 8)
+	{
+		__m128i sample = MultiplyShift15(
+		    _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i)),
+		    _mm_loadu_si128(reinterpret_cast<const __m128i*>(envelope + i)));
+		__m128i sampleLeft = MultiplyShift15(sample, _mm_loadu_si128(reinterpret_cast<const __m128i*>(volumeLeft + i)));
+		__m128i sampleRight = MultiplyShift15(sample, _mm_loadu_si128(reinterpret_cast<const __m128i*>(volumeRight + i)));
+		__m128i stereo0 = _mm_unpacklo_epi16(sampleLeft, sampleRight);
+		__m128i stereo1 = _mm_unpackhi_epi16(sampleLeft, sampleRight);
+
+		auto dst = reinterpret_cast<__m128i*>(output + (i * 2));
+		_mm_storeu_si128(dst + 0, _mm_adds_epi16(_mm_loadu_si128(dst + 0), stereo0));
+		_mm_storeu_si128(dst + 1, _mm_adds_epi16(_mm_loadu_si128(dst + 1), stereo1));
+		if(reverbOutput)
+		{
+			auto reverbDst = reinterpret_cast<__m128i*>(reverbOutput + (i * 2));
+			_mm_storeu_si128(reverbDst + 0, _mm_adds_epi16(_mm_loadu_si128(reverbDst + 0), stereo0));
+			_mm_storeu_si128(reverbDst + 1, _mm_adds_epi16(_mm_loadu_si128(reverbDst + 1), stereo1));
+		}
+	}
+	MixVoiceScalar(output + (i * 2), reverbOutput ? (reverbOutput + (i * 2)) : nullptr,
+	               samples + i, envelope + i, volumeLeft + i, volumeRight + i, count - i);
+}
+
+void SpuKernels::MixSaturate(int16* output, const int16* input, unsigned int count)
+{
+	unsigned int i = 0;
+	for(; (i + 8) <= count; i += 8)
+	{
+		auto dst = reinterpret_cast<__m128i*>(output + i);
+		__m128i src = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+		_mm_storeu_si128(dst, _mm_adds_epi16(_mm_loadu_si128(dst), src));
+	}
+	MixSaturateScalar(output + i, input + i, count - i);
+}
+
+#elif defined(SPUKERNELS_NEON)
+
+void SpuKernels::ExpandAdpcmNibbles(const uint8* block, unsigned int shiftFactor, int16* output)
+{
+	uint8x16_t data = vextq_u8(vld1q_u8(block), vdupq_n_u8(0), 2);
+	uint8x16x2_t nibbles = vzipq_u8(vandq_u8(data, vdupq_n_u8(0x0F)), vshrq_n_u8(data, 4));
+	int16x8_t shift = vdupq_n_s16(-static_cast<int16>(shiftFactor));
+
+	int16x8_t result0 = vshlq_s16(vreinterpretq_s16_u16(vshlq_n_u16(vmovl_u8(vget_low_u8(nibbles.val[0])), 12)), shift);
+	int16x8_t result1 = vshlq_s16(vreinterpretq_s16_u16(vshlq_n_u16(vmovl_u8(vget_high_u8(nibbles.val[0])), 12)), shift);
+	int16x8_t result2 = vshlq_s16(vreinterpretq_s16_u16(vshlq_n_u16(vmovl_u8(vget_low_u8(nibbles.val[1])), 12)), shift);
+	int16x8_t result3 = vshlq_s16(vreinterpretq_s16_u16(vshlq_n_u16(vmovl_u8(vget_high_u8(nibbles.val[1])), 12)), shift);
+
+	vst1q_s16(output + 0x00, result0);
+	vst1q_s16(output + 0x08, result1);
+	vst1q_s16(output + 0x10, result2);
+	vst1_s16(output + 0x18, vget_low_s16(result3));
+}
+
+void SpuKernels::MixVoice(int16* output, int16* reverbOutput, const int16* samples, const int16* envelope,
+                          const int16* volumeLeft, const int16* volumeRight, unsigned int count)
+{
+	unsigned int i = 0;
+	for(; (i + 8) <= count; i += 8)
+	{
+		//Operands are never both -0x8000, vqdmulh is (a * b) >> 15 here
+		int16x8_t sample = vqdmulhq_s16(vld1q_s16(samples + i), vld1q_s16(envelope + i));
+		int16x8x2_t stereo;
+		stereo.val[0] = vqdmulhq_s16(sample, vld1q_s16(volumeLeft + i));
+		stereo.val[1] = vqdmulhq_s16(sample, vld1q_s16(volumeRight + i));
+		stereo = vzipq_s16(stereo.val[0], stereo.val[1]);
+
+		int16* dst = output + (i * 2);
+		vst1q_s16(dst + 0, vqaddq_s16(vld1q_s16(dst + 0), stereo.val[0]));
+		vst1q_s16(dst + 8, vqaddq_s16(vld1q_s16(dst + 8), stereo.val[1]));
+		if(reverbOutput)
+		{
+			int16* reverbDst = reverbOutput + (i * 2);
+			vst1q_s16(reverbDst + 0, vqaddq_s16(vld1q_s16(reverbDst + 0), stereo.val[0]));
+			vst1q_s16(reverbDst + 8, vqaddq_s16(vld1q_s16(reverbDst + 8), stereo.val[1]));
+		}
+	}
+	MixVoiceScalar(output + (i * 2), reverbOutput ? (reverbOutput + (i * 2)) : nullptr,
+	               samples + i, envelope + i, volumeLeft + i, volumeRight + i, count - i);
+}
+
+void SpuKernels::MixSaturate(int16* output, const int16* input, unsigned int count)
+{
+	unsigned int i = 0;
+	for(; (i + 8) <= count; i += 8)
+	{
+		vst1q_s16(output + i, vqaddq_s16(vld1q_s16(output + i), vld1q_s16(input + i)));
+	}
+	MixSaturateScalar(output + i, input + i, count - i);
+}
+
+#else
+
+void SpuKernels::ExpandAdpcmNibbles(const uint8* block, unsigned int shiftFactor, int16* output)
+{
+	for(unsigned int i = 2; i < ADPCM_BLOCK_SIZE; i++)
+	{
+		uint8 sampleByte = block[i];
+		int16 firstSample = ((sampleByte & 0x0F) << 12);
+		int16 secondSample = ((sampleByte & 0xF0) << 8);
+		*(output++) = firstSample >> shiftFactor;
+		*(output++) = secondSample >> shiftFactor;
+	}
+}
+
+void SpuKernels::MixVoice(int16* output, int16* reverbOutput, const int16* samples, const int16* envelope,
+                          const int16* volumeLeft, const int16* volumeRight, unsigned int count)
+{
+	MixVoiceScalar(output, reverbOutput, samples, envelope, volumeLeft, volumeRight, count);
+}
+
+void SpuKernels::MixSaturate(int16* output, const int16* input, unsigned int count)
+{
+	MixSaturateScalar(output, input, count);
+}
+
+#endif
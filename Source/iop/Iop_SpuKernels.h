@@ -0,0 +1,26 @@
+#pragma once
+
+#include "Types.h"
+
+//Sample level operations used by the SPU voice renderer.
+//SSE2 and NEON versions are used when available.
+namespace SpuKernels
+{
+	enum
+	{
+		ADPCM_BLOCK_SIZE = 0x10,
+		ADPCM_BLOCK_SAMPLES = 28,
+	};
+
+	//Expands the 28 nibbles of an ADPCM block (header included) to 16-bit values shifted right by shiftFactor.
+	//Prediction is not applied.
+	void ExpandAdpcmNibbles(const uint8* block, unsigned int shiftFactor, int16* output);
+
+	//Applies envelope and left/right volumes (all in [0, 0x7FFF]) to a voice's samples and adds the
+	//result to an interleaved stereo buffer with saturation. reverbOutput can be null.
+	void MixVoice(int16* output, int16* reverbOutput, const int16* samples, const int16* envelope,
+	              const int16* volumeLeft, const int16* volumeRight, unsigned int count);
+
+	//output[i] = saturate(output[i] + input[i])
+	void MixSaturate(int16* output, const int16* input, unsigned int count);
+}
@@ -3,6 +3,7 @@
 #include "GenericMipsExecutor.h"
 #include "../psx/PsxBios.h"
 #include "../states/MemoryStateFile.h"
+#include "../states/RawState.h"
 #include "../Ps2Const.h"
 #include "../Log.h"
 #include "placeholder_def.h"
@@ -22,10 +23,11 @@ CSubSystem::CSubSystem(bool ps2Mode)
     , m_ram(new uint8[IOP_RAM_SIZE])
     , m_scratchPad(new uint8[IOP_SCRATCH_SIZE])
     , m_spuRam(new uint8[SPU_RAM_SIZE])
+    , m_spuRamTracker(SPU_RAM_SIZE, SPU_RAM_TRACKER_PAGE_SIZE)
     , m_dmac(m_ram, m_intc)
     , m_counters(ps2Mode ? IOP_CLOCK_OVER_FREQ : IOP_CLOCK_BASE_FREQ, m_intc)
-    , m_spuCore0(m_spuRam, SPU_RAM_SIZE, 0)
-    , m_spuCore1(m_spuRam, SPU_RAM_SIZE, 1)
+    , m_spuCore0(m_spuRam, SPU_RAM_SIZE, 0, &m_spuRamTracker)
+    , m_spuCore1(m_spuRam, SPU_RAM_SIZE, 1, &m_spuRamTracker)
     , m_spu(m_spuCore0)
     , m_spu2(m_spuCore0, m_spuCore1)
 #ifdef _IOP_EMULATE_MODULES
@@ -123,6 +125,7 @@ void CSubSystem::LoadState(Framework::CZipArchiveReader& archive)
 	archive.BeginReadFile(STATE_RAM)->Read(m_ram, IOP_RAM_SIZE);
 	archive.BeginReadFile(STATE_SCRATCH)->Read(m_scratchPad, IOP_SCRATCH_SIZE);
 	archive.BeginReadFile(STATE_SPURAM)->Read(m_spuRam, SPU_RAM_SIZE);
+	m_spuRamTracker.MarkAllDirty();
 	m_intc.LoadState(archive);
 	m_dmac.LoadState(archive);
 	m_counters.LoadState(archive);
@@ -134,11 +137,40 @@ void CSubSystem::LoadState(Framework::CZipArchiveReader& archive)
 	m_bios->LoadState(archive);
 }
 
+void CSubSystem::SaveDeviceState(Framework::CStream& stream)
+{
+	RawState::Write(stream, m_cpu.m_State);
+	m_intc.SaveRawState(stream);
+	m_dmac.SaveRawState(stream);
+	m_counters.SaveRawState(stream);
+	m_spuCore0.SaveRawState(stream);
+	m_spuCore1.SaveRawState(stream);
+#ifdef _IOP_EMULATE_MODULES
+	m_sio2.SaveRawState(stream);
+#endif
+	m_bios->SaveRawState(stream);
+}
+
+void CSubSystem::LoadDeviceState(Framework::CStream& stream)
+{
+	RawState::Read(stream, m_cpu.m_State);
+	m_intc.LoadRawState(stream);
+	m_dmac.LoadRawState(stream);
+	m_counters.LoadRawState(stream);
+	m_spuCore0.LoadRawState(stream);
+	m_spuCore1.LoadRawState(stream);
+#ifdef _IOP_EMULATE_MODULES
+	m_sio2.LoadRawState(stream);
+#endif
+	m_bios->LoadRawState(stream);
+}
+
 void CSubSystem::Reset()
 {
 	memset(m_ram, 0, IOP_RAM_SIZE);
 	memset(m_scratchPad, 0, IOP_SCRATCH_SIZE);
 	memset(m_spuRam, 0, SPU_RAM_SIZE);
+	m_spuRamTracker.MarkAllDirty();
 	m_cpu.Reset();
 	m_cpu.m_executor->Reset();
 	m_cpu.m_analysis->Clear();
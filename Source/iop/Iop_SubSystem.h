@@ -11,6 +11,7 @@
 #include "Iop_Intc.h"
 #include "Iop_RootCounters.h"
 #include "Iop_BiosBase.h"
+#include "../DirtyPageTracker.h"
 #include "zip/ZipArchiveWriter.h"
 #include "zip/ZipArchiveReader.h"
 
@@ -33,9 +34,15 @@ namespace Iop
 		void SaveState(Framework::CZipArchiveWriter&);
 		void LoadState(Framework::CZipArchiveReader&);
 
+		//Raw binary state of everything but RAM, scratchpad and SPU RAM, used for rewind
+		void SaveDeviceState(Framework::CStream&);
+		void LoadDeviceState(Framework::CStream&);
+
 		uint8* m_ram;
 		uint8* m_scratchPad;
 		uint8* m_spuRam;
+		//Only SPU DMA, transfers and reverb write to SPU RAM
+		CDirtyPageTracker m_spuRamTracker;
 		CIntc m_intc;
 		CRootCounters m_counters;
 		CDmac m_dmac;
@@ -58,6 +65,11 @@ namespace Iop
 			HW_REG_END = 0x1F9FFFFF
 		};
 
+		enum
+		{
+			SPU_RAM_TRACKER_PAGE_SIZE = 0x1000,
+		};
+
 		void SetupPageTable();
 
 		uint32 ReadIoRegister(uint32);
@@ -161,6 +161,14 @@ void CPsxBios::LoadState(Framework::CZipArchiveReader& archive)
 {
 }
 
+void CPsxBios::SaveRawState(Framework::CStream& stream)
+{
+}
+
+void CPsxBios::LoadRawState(Framework::CStream& stream)
+{
+}
+
 void CPsxBios::NotifyVBlankStart()
 {
 }
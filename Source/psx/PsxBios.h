@@ -42,6 +42,8 @@ public:
 
 	void SaveState(Framework::CZipArchiveWriter&) override;
 	void LoadState(Framework::CZipArchiveReader&) override;
+	void SaveRawState(Framework::CStream&) override;
+	void LoadRawState(Framework::CStream&) override;
 
 	void NotifyVBlankStart() override;
 	void NotifyVBlankEnd() override;
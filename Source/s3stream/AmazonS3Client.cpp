@@ -133,21 +133,42 @@ std::string timeToString(const tm* timeInfo)
 	return std::string(output);
 }
 
-CAmazonS3Client::CAmazonS3Client(std::string accessKeyId, std::string secretAccessKey, std::string region)
+CAmazonS3Client::CAmazonS3Client(std::string accessKeyId, std::string secretAccessKey, std::string region, std::string endpoint)
     : m_accessKeyId(std::move(accessKeyId))
     , m_secretAccessKey(std::move(secretAccessKey))
     , m_region(std::move(region))
 {
+	if(!endpoint.empty())
+	{
+		auto schemePosition = endpoint.find("://");
+		if(schemePosition != std::string::npos)
+		{
+			m_endpointScheme = endpoint.substr(0, schemePosition);
+			endpoint = endpoint.substr(schemePosition + 3);
+		}
+		while(!endpoint.empty() && (endpoint.back() == '/'))
+		{
+			endpoint.pop_back();
+		}
+		m_endpointHost = std::move(endpoint);
+	}
 }
 
 GetBucketLocationResult CAmazonS3Client::GetBucketLocation(const GetBucketLocationRequest& request)
 {
 	Request rq;
 	rq.method = Framework::Http::HTTP_VERB::GET;
-	rq.host = string_format("%s." S3_HOSTNAME, request.bucket.c_str());
-	rq.urlHost = S3_HOSTNAME;
 	rq.uri = "/";
 	rq.query = "location=";
+	if(m_endpointHost.empty())
+	{
+		rq.host = string_format("%s." S3_HOSTNAME, request.bucket.c_str());
+		rq.urlHost = S3_HOSTNAME;
+	}
+	else
+	{
+		SetRequestBucket(rq, request.bucket);
+	}
 
 	auto response = ExecuteRequest(rq);
 	if(response.statusCode != Framework::Http::HTTP_STATUS_CODE::OK)
@@ -173,8 +194,7 @@ GetObjectResult CAmazonS3Client::GetObject(const GetObjectRequest& request)
 	Request rq;
 	rq.method = Framework::Http::HTTP_VERB::GET;
 	rq.uri = "/" + Framework::Http::CHttpClient::UrlEncode(request.object);
-	rq.host = string_format("%s.s3-%s.amazonaws.com", request.bucket.c_str(), m_region.c_str());
-	rq.urlHost = rq.host;
+	SetRequestBucket(rq, request.bucket);
 
 	if(request.range.first != request.range.second)
 	{
@@ -202,8 +222,7 @@ HeadObjectResult CAmazonS3Client::HeadObject(const HeadObjectRequest& request)
 	Request rq;
 	rq.method = Framework::Http::HTTP_VERB::HEAD;
 	rq.uri = "/" + Framework::Http::CHttpClient::UrlEncode(request.object);
-	rq.host = string_format("%s.s3-%s.amazonaws.com", request.bucket.c_str(), m_region.c_str());
-	rq.urlHost = rq.host;
+	SetRequestBucket(rq, request.bucket);
 
 	auto response = ExecuteRequest(rq);
 	if(response.statusCode != Framework::Http::HTTP_STATUS_CODE::OK)
@@ -234,8 +253,7 @@ ListObjectsResult CAmazonS3Client::ListObjects(std::string bucket)
 	Request rq;
 	rq.method = Framework::Http::HTTP_VERB::GET;
 	rq.uri = "/";
-	rq.host = string_format("%s.s3-%s.amazonaws.com", bucket.c_str(), m_region.c_str());
-	rq.urlHost = rq.host;
+	SetRequestBucket(rq, bucket);
 
 	auto response = ExecuteRequest(rq);
 	if(response.statusCode != Framework::Http::HTTP_STATUS_CODE::OK)
@@ -260,6 +278,20 @@ ListObjectsResult CAmazonS3Client::ListObjects(std::string bucket)
 	return result;
 }
 
+void CAmazonS3Client::SetRequestBucket(Request& request, const std::string& bucket) const
+{
+	if(m_endpointHost.empty())
+	{
+		request.host = string_format("%s.s3-%s.amazonaws.com", bucket.c_str(), m_region.c_str());
+	}
+	else
+	{
+		request.host = m_endpointHost;
+		request.uri = "/" + bucket + request.uri;
+	}
+	request.urlHost = request.host;
+}
+
 Framework::Http::RequestResult CAmazonS3Client::ExecuteRequest(const Request& request)
 {
 	assert(!m_accessKeyId.empty());
@@ -267,9 +299,16 @@ Framework::Http::RequestResult CAmazonS3Client::ExecuteRequest(const Request& re
 	assert(!request.host.empty());
 	assert(!request.urlHost.empty());
 
+	//Requests can be executed from multiple threads, can't use gmtime's shared result
 	time_t rawTime;
 	time(&rawTime);
-	auto timeInfo = gmtime(&rawTime);
+	tm timeInfoStorage = {};
+#ifdef _WIN32
+	gmtime_s(&timeInfoStorage, &rawTime);
+#else
+	gmtime_r(&rawTime, &timeInfoStorage);
+#endif
+	auto timeInfo = &timeInfoStorage;
 
 	auto date = string_format("%04d%02d%02d", timeInfo->tm_year + 1900, timeInfo->tm_mon + 1, timeInfo->tm_mday);
 	auto service = std::string("s3");
@@ -304,7 +343,7 @@ Framework::Http::RequestResult CAmazonS3Client::ExecuteRequest(const Request& re
 	headers.insert(std::make_pair("Authorization", authorizationString));
 	headers.insert(request.headers.begin(), request.headers.end());
 
-	auto url = string_format("https://%s%s", request.urlHost.c_str(), request.uri.c_str());
+	auto url = string_format("%s://%s%s", m_endpointScheme.c_str(), request.urlHost.c_str(), request.uri.c_str());
 	if(!request.query.empty())
 	{
 		url += "?";
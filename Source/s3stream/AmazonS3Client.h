@@ -51,7 +51,9 @@ struct ListObjectsResult
 class CAmazonS3Client
 {
 public:
-	CAmazonS3Client(std::string, std::string, std::string = "us-east-1");
+	//Endpoint (ex.: "http://localhost:9000") is optional and allows using S3 compatible
+	//servers. Buckets are then addressed using path-style requests.
+	CAmazonS3Client(std::string, std::string, std::string = "us-east-1", std::string = "");
 
 	GetBucketLocationResult GetBucketLocation(const GetBucketLocationRequest&);
 	GetObjectResult GetObject(const GetObjectRequest&);
@@ -69,9 +71,12 @@ private:
 		Framework::Http::HeaderMap headers;
 	};
 
+	void SetRequestBucket(Request&, const std::string&) const;
 	Framework::Http::RequestResult ExecuteRequest(const Request&);
 
 	std::string m_accessKeyId;
 	std::string m_secretAccessKey;
 	std::string m_region;
+	std::string m_endpointScheme = "https";
+	std::string m_endpointHost;
 };
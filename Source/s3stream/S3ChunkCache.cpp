@@ -0,0 +1,273 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <zlib.h>
+#include "S3ChunkCache.h"
+#include "Log.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define LOG_NAME "s3chunkcache"
+
+CS3ChunkCache::CS3ChunkCache(const fs::path& path, uint32 chunkSize, uint64 cacheSize)
+    : m_path(path)
+    , m_chunkSize(chunkSize)
+    , m_slotCount(static_cast<uint32>(cacheSize / chunkSize))
+{
+	assert(m_chunkSize != 0);
+	if(m_slotCount == 0) return;
+
+	uint64 slotTableSize = static_cast<uint64>(m_slotCount) * sizeof(SLOT_ENTRY);
+	slotTableSize = (slotTableSize + HEADER_AREA_SIZE - 1) & ~static_cast<uint64>(HEADER_AREA_SIZE - 1);
+	uint64 fileSize = HEADER_AREA_SIZE + slotTableSize + (static_cast<uint64>(m_slotCount) * m_chunkSize);
+
+	if(!MapFile(fileSize))
+	{
+		CLog::GetInstance().Warn(LOG_NAME, "Failed to map cache file, caching disabled.\r\n");
+		UnmapFile();
+		return;
+	}
+
+	auto header = reinterpret_cast<HEADER*>(m_mappedData);
+	bool valid =
+	    (header->magic == CACHE_MAGIC) &&
+	    (header->version == CACHE_VERSION) &&
+	    (header->chunkSize == m_chunkSize) &&
+	    (header->slotCount == m_slotCount);
+	if(!valid)
+	{
+		//New file or different layout, start from scratch
+		memset(m_mappedData, 0, HEADER_AREA_SIZE + static_cast<size_t>(slotTableSize));
+		header->magic = CACHE_MAGIC;
+		header->version = CACHE_VERSION;
+		header->chunkSize = m_chunkSize;
+		header->slotCount = m_slotCount;
+		header->useCounter = 0;
+	}
+
+	LoadSlots();
+}
+
+CS3ChunkCache::~CS3ChunkCache()
+{
+	UnmapFile();
+}
+
+bool CS3ChunkCache::IsOpen() const
+{
+	return (m_mappedData != nullptr);
+}
+
+bool CS3ChunkCache::Read(const std::string& objectKey, uint64 chunkIndex, void* data, uint32 size)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if(!IsOpen()) return false;
+
+	CHUNK_KEY key = {HashObjectKey(objectKey), chunkIndex};
+	auto chunkIterator = m_chunks.find(key);
+	if(chunkIterator == std::end(m_chunks)) return false;
+
+	uint32 slotIndex = chunkIterator->second;
+	auto slotEntry = GetSlotEntry(slotIndex);
+	auto slotData = GetSlotData(slotIndex);
+	if(slotEntry->size != size) return false;
+
+	uint32 crc = crc32(0, slotData, size);
+	if(crc != slotEntry->crc)
+	{
+		CLog::GetInstance().Warn(LOG_NAME, "Discarding damaged chunk %llu.\r\n", chunkIndex);
+		FreeSlot(slotIndex);
+		return false;
+	}
+
+	memcpy(data, slotData, size);
+	TouchSlot(slotIndex);
+	return true;
+}
+
+void CS3ChunkCache::Write(const std::string& objectKey, uint64 chunkIndex, const void* data, uint32 size)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if(!IsOpen()) return;
+	if((size == 0) || (size > m_chunkSize)) return;
+
+	CHUNK_KEY key = {HashObjectKey(objectKey), chunkIndex};
+	uint32 slotIndex = 0;
+	auto chunkIterator = m_chunks.find(key);
+	if(chunkIterator != std::end(m_chunks))
+	{
+		slotIndex = chunkIterator->second;
+		FreeSlot(slotIndex);
+	}
+	if(m_freeSlots.empty())
+	{
+		assert(!m_lruSlots.empty());
+		FreeSlot(m_lruSlots.front());
+	}
+	slotIndex = m_freeSlots.back();
+	m_freeSlots.pop_back();
+
+	//Entry is only marked as used once the data is in place
+	auto slotEntry = GetSlotEntry(slotIndex);
+	memcpy(GetSlotData(slotIndex), data, size);
+	slotEntry->objectHash = key.objectHash;
+	slotEntry->chunkIndex = key.chunkIndex;
+	slotEntry->crc = crc32(0, reinterpret_cast<const Bytef*>(data), size);
+	slotEntry->size = size;
+
+	m_chunks[key] = slotIndex;
+	m_slots[slotIndex].lruIterator = m_lruSlots.insert(std::end(m_lruSlots), slotIndex);
+	TouchSlot(slotIndex);
+}
+
+//Must be stable across runs, std::hash isn't guaranteed to be
+uint64 CS3ChunkCache::HashObjectKey(const std::string& objectKey)
+{
+	uint64 hash = 0xCBF29CE484222325ULL;
+	for(auto character : objectKey)
+	{
+		hash ^= static_cast<uint8>(character);
+		hash *= 0x100000001B3ULL;
+	}
+	return hash;
+}
+
+bool CS3ChunkCache::MapFile(uint64 fileSize)
+{
+#if defined(_WIN32)
+	auto fileHandle = CreateFileW(m_path.native().c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(fileHandle == INVALID_HANDLE_VALUE) return false;
+	m_fileHandle = fileHandle;
+
+	LARGE_INTEGER mappingSize = {};
+	mappingSize.QuadPart = fileSize;
+	auto mappingHandle = CreateFileMappingW(fileHandle, NULL, PAGE_READWRITE, mappingSize.HighPart, mappingSize.LowPart, NULL);
+	if(mappingHandle == NULL) return false;
+	m_mappingHandle = mappingHandle;
+
+	m_mappedData = reinterpret_cast<uint8*>(MapViewOfFile(mappingHandle, FILE_MAP_ALL_ACCESS, 0, 0, 0));
+	if(m_mappedData == nullptr) return false;
+	m_mappedSize = static_cast<size_t>(fileSize);
+#elif defined(__unix__) || defined(__ANDROID__) || defined(__APPLE__)
+	int fd = open(m_path.native().c_str(), O_RDWR | O_CREAT, 0644);
+	if(fd < 0) return false;
+
+	//File is sparse, slots only take space once they're written to
+	struct stat fileStat = {};
+	if((fstat(fd, &fileStat) < 0) ||
+	   ((static_cast<uint64>(fileStat.st_size) != fileSize) && (ftruncate(fd, fileSize) < 0)))
+	{
+		close(fd);
+		return false;
+	}
+
+	void* mappedData = mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if(mappedData == MAP_FAILED) return false;
+
+	m_mappedData = reinterpret_cast<uint8*>(mappedData);
+	m_mappedSize = static_cast<size_t>(fileSize);
+#else
+	return false;
+#endif
+	return true;
+}
+
+void CS3ChunkCache::UnmapFile()
+{
+#if defined(_WIN32)
+	if(m_mappedData)
+	{
+		UnmapViewOfFile(m_mappedData);
+	}
+	if(m_mappingHandle)
+	{
+		CloseHandle(m_mappingHandle);
+		m_mappingHandle = nullptr;
+	}
+	if(m_fileHandle)
+	{
+		CloseHandle(m_fileHandle);
+		m_fileHandle = nullptr;
+	}
+#elif defined(__unix__) || defined(__ANDROID__) || defined(__APPLE__)
+	if(m_mappedData)
+	{
+		munmap(m_mappedData, m_mappedSize);
+	}
+#endif
+	m_mappedData = nullptr;
+	m_mappedSize = 0;
+}
+
+void CS3ChunkCache::LoadSlots()
+{
+	m_slots.resize(m_slotCount);
+
+	std::vector<uint32> usedSlots;
+	for(uint32 slotIndex = 0; slotIndex < m_slotCount; slotIndex++)
+	{
+		auto slotEntry = GetSlotEntry(slotIndex);
+		bool used = (slotEntry->size != 0) && (slotEntry->size <= m_chunkSize);
+		if(used)
+		{
+			CHUNK_KEY key = {slotEntry->objectHash, slotEntry->chunkIndex};
+			used = m_chunks.emplace(key, slotIndex).second;
+		}
+		if(used)
+		{
+			usedSlots.push_back(slotIndex);
+		}
+		else
+		{
+			slotEntry->size = 0;
+			m_freeSlots.push_back(slotIndex);
+		}
+	}
+
+	//Rebuild the LRU order from the last use counters saved in the file
+	std::sort(usedSlots.begin(), usedSlots.end(),
+	          [this](uint32 lhs, uint32 rhs) { return GetSlotEntry(lhs)->lastUse < GetSlotEntry(rhs)->lastUse; });
+	for(auto slotIndex : usedSlots)
+	{
+		m_slots[slotIndex].lruIterator = m_lruSlots.insert(std::end(m_lruSlots), slotIndex);
+	}
+}
+
+void CS3ChunkCache::FreeSlot(uint32 slotIndex)
+{
+	auto slotEntry = GetSlotEntry(slotIndex);
+	assert(slotEntry->size != 0);
+	m_chunks.erase(CHUNK_KEY{slotEntry->objectHash, slotEntry->chunkIndex});
+	m_lruSlots.erase(m_slots[slotIndex].lruIterator);
+	slotEntry->size = 0;
+	m_freeSlots.push_back(slotIndex);
+}
+
+void CS3ChunkCache::TouchSlot(uint32 slotIndex)
+{
+	auto header = reinterpret_cast<HEADER*>(m_mappedData);
+	GetSlotEntry(slotIndex)->lastUse = ++header->useCounter;
+	m_lruSlots.splice(std::end(m_lruSlots), m_lruSlots, m_slots[slotIndex].lruIterator);
+}
+
+CS3ChunkCache::SLOT_ENTRY* CS3ChunkCache::GetSlotEntry(uint32 slotIndex) const
+{
+	assert(slotIndex < m_slotCount);
+	return reinterpret_cast<SLOT_ENTRY*>(m_mappedData + HEADER_AREA_SIZE) + slotIndex;
+}
+
+uint8* CS3ChunkCache::GetSlotData(uint32 slotIndex) const
+{
+	assert(slotIndex < m_slotCount);
+	uint64 slotTableSize = static_cast<uint64>(m_slotCount) * sizeof(SLOT_ENTRY);
+	slotTableSize = (slotTableSize + HEADER_AREA_SIZE - 1) & ~static_cast<uint64>(HEADER_AREA_SIZE - 1);
+	return m_mappedData + HEADER_AREA_SIZE + slotTableSize + (static_cast<uint64>(slotIndex) * m_chunkSize);
+}
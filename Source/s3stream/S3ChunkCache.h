@@ -0,0 +1,114 @@
+#pragma once
+
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Types.h"
+#include "filesystem_def.h"
+
+//Persistent cache of object chunks, stored in a single memory mapped file made of a fixed
+//number of chunk sized slots. Chunks are keyed by the object's ETag and their index in the
+//object. Least recently used chunks are evicted when the cache is full. Chunks are checked
+//against a CRC when read back, a damaged or incomplete chunk is treated as a miss.
+//All operations are thread safe. If the file can't be mapped, the cache stays empty.
+class CS3ChunkCache
+{
+public:
+	CS3ChunkCache(const fs::path&, uint32, uint64);
+	CS3ChunkCache(const CS3ChunkCache&) = delete;
+	virtual ~CS3ChunkCache();
+
+	CS3ChunkCache& operator=(const CS3ChunkCache&) = delete;
+
+	bool IsOpen() const;
+
+	bool Read(const std::string&, uint64, void*, uint32);
+	void Write(const std::string&, uint64, const void*, uint32);
+
+private:
+	enum
+	{
+		CACHE_MAGIC = 0x43333350, //'P33C'
+		CACHE_VERSION = 1,
+		HEADER_AREA_SIZE = 0x1000,
+	};
+
+#pragma pack(push, 1)
+	struct HEADER
+	{
+		uint32 magic;
+		uint32 version;
+		uint32 chunkSize;
+		uint32 slotCount;
+		uint64 useCounter;
+	};
+
+	//A slot with a size of 0 is free
+	struct SLOT_ENTRY
+	{
+		uint64 objectHash;
+		uint64 chunkIndex;
+		uint64 lastUse;
+		uint32 size;
+		uint32 crc;
+	};
+	static_assert(sizeof(SLOT_ENTRY) == 0x20, "SLOT_ENTRY must be 32 bytes long.");
+#pragma pack(pop)
+
+	struct CHUNK_KEY
+	{
+		uint64 objectHash;
+		uint64 chunkIndex;
+
+		bool operator==(const CHUNK_KEY& rhs) const
+		{
+			return (objectHash == rhs.objectHash) && (chunkIndex == rhs.chunkIndex);
+		}
+	};
+
+	struct ChunkKeyHasher
+	{
+		size_t operator()(const CHUNK_KEY& key) const
+		{
+			return static_cast<size_t>(key.objectHash ^ (key.chunkIndex * 0x9E3779B97F4A7C15ULL));
+		}
+	};
+
+	struct SLOT
+	{
+		std::list<uint32>::iterator lruIterator;
+	};
+
+	typedef std::unordered_map<CHUNK_KEY, uint32, ChunkKeyHasher> ChunkMap;
+
+	static uint64 HashObjectKey(const std::string&);
+
+	bool MapFile(uint64);
+	void UnmapFile();
+	void LoadSlots();
+	void FreeSlot(uint32);
+	void TouchSlot(uint32);
+
+	SLOT_ENTRY* GetSlotEntry(uint32) const;
+	uint8* GetSlotData(uint32) const;
+
+	std::mutex m_mutex;
+	fs::path m_path;
+	uint32 m_chunkSize = 0;
+	uint32 m_slotCount = 0;
+
+	uint8* m_mappedData = nullptr;
+	size_t m_mappedSize = 0;
+
+	ChunkMap m_chunks;
+	std::vector<SLOT> m_slots;
+	std::list<uint32> m_lruSlots;
+	std::vector<uint32> m_freeSlots;
+
+#ifdef _WIN32
+	void* m_fileHandle = nullptr;
+	void* m_mappingHandle = nullptr;
+#endif
+};
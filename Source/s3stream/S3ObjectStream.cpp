@@ -1,26 +1,29 @@
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 #include "S3ObjectStream.h"
+#include "S3ChunkCache.h"
 #include "AmazonS3Client.h"
 #include "Singleton.h"
 #include "AppConfig.h"
 #include "PathUtils.h"
 #include "string_format.h"
-#include "StdStreamUtils.h"
 #include "Log.h"
 
-#define PREF_S3_OBJECTSTREAM_ACCESSKEYID "s3.objectstream.accesskeyid"
-#define PREF_S3_OBJECTSTREAM_SECRETACCESSKEY "s3.objectstream.secretaccesskey"
 #define CACHE_PATH "Play Data Files/s3objectstream_cache"
+#define CACHE_FILENAME "chunks.dat"
 
 #define LOG_NAME "s3objectstream"
 
-#define BUFFERSIZE 0x40000
+//In megabytes, 0 disables the cache
+#define DEFAULT_CACHESIZE 512
 
 CS3ObjectStream::CConfig::CConfig()
 {
 	CAppConfig::GetInstance().RegisterPreferenceString(PREF_S3_OBJECTSTREAM_ACCESSKEYID, "");
 	CAppConfig::GetInstance().RegisterPreferenceString(PREF_S3_OBJECTSTREAM_SECRETACCESSKEY, "");
+	CAppConfig::GetInstance().RegisterPreferenceString(PREF_S3_OBJECTSTREAM_ENDPOINT, "");
+	CAppConfig::GetInstance().RegisterPreferenceInteger(PREF_S3_OBJECTSTREAM_CACHESIZE, DEFAULT_CACHESIZE);
 }
 
 std::string CS3ObjectStream::CConfig::GetAccessKeyId()
@@ -33,13 +36,44 @@ std::string CS3ObjectStream::CConfig::GetSecretAccessKey()
 	return CAppConfig::GetInstance().GetPreferenceString(PREF_S3_OBJECTSTREAM_SECRETACCESSKEY);
 }
 
+std::string CS3ObjectStream::CConfig::GetEndpoint()
+{
+	return CAppConfig::GetInstance().GetPreferenceString(PREF_S3_OBJECTSTREAM_ENDPOINT);
+}
+
+uint64 CS3ObjectStream::CConfig::GetCacheSize()
+{
+	int cacheSize = CAppConfig::GetInstance().GetPreferenceInteger(PREF_S3_OBJECTSTREAM_CACHESIZE);
+	return static_cast<uint64>(std::max(cacheSize, 0)) * 0x100000;
+}
+
 CS3ObjectStream::CS3ObjectStream(const char* bucketName, const char* objectName)
     : m_bucketName(bucketName)
     , m_objectName(objectName)
+    , m_endpoint(CConfig::GetInstance().GetEndpoint())
+    , m_accessKeyId(CConfig::GetInstance().GetAccessKeyId())
+    , m_secretAccessKey(CConfig::GetInstance().GetSecretAccessKey())
 {
-	m_buffer.resize(BUFFERSIZE);
-	Framework::PathUtils::EnsurePathExists(GetCachePath());
 	GetObjectInfo();
+	m_chunkCache = GetChunkCache();
+	m_chunkCacheKey = string_format("%s/%s/%s", m_bucketName.c_str(), m_objectName.c_str(), m_objectEtag.c_str());
+	for(uint32 i = 0; i < WORKER_COUNT; i++)
+	{
+		m_workerThreads.emplace_back([this]() { WorkerThreadProc(); });
+	}
+}
+
+CS3ObjectStream::~CS3ObjectStream()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_workersEnd = true;
+	}
+	m_workerCondition.notify_all();
+	for(auto& workerThread : m_workerThreads)
+	{
+		workerThread.join();
+	}
 }
 
 uint64 CS3ObjectStream::Read(void* buffer, uint64 size)
@@ -47,31 +81,55 @@ uint64 CS3ObjectStream::Read(void* buffer, uint64 size)
 	assert(m_objectPosition <= m_objectSize);
 
 	uint64 adjSize = std::min(size, m_objectSize - m_objectPosition);
+	if(adjSize == 0) return 0;
+
 	auto outBuffer = reinterpret_cast<uint8*>(buffer);
+	uint64 firstChunk = m_objectPosition / CHUNK_SIZE;
+	uint64 lastChunk = (m_objectPosition + adjSize - 1) / CHUNK_SIZE;
+
+	std::unique_lock<std::mutex> lock(m_mutex);
 
-	while(adjSize != 0)
+	//Keep chunks following sequential reads coming, forget about those we
+	//won't need anymore when jumping elsewhere
+	bool sequential = (m_objectPosition == m_sequentialEnd);
+	if(!sequential)
 	{
-		//Read if we're inside buffer size
-		if((m_bufferPosition / BUFFERSIZE) == (m_objectPosition / BUFFERSIZE))
-		{
-			uint64 bufferOffset = m_objectPosition % BUFFERSIZE;
-			uint64 remainSize = BUFFERSIZE - bufferOffset;
-			assert(remainSize <= BUFFERSIZE);
-			auto copySize = std::min(remainSize, adjSize);
-			assert(copySize <= adjSize);
-			memcpy(outBuffer, m_buffer.data() + bufferOffset, copySize);
-			m_objectPosition += copySize;
-			outBuffer += copySize;
-			adjSize -= copySize;
-		}
-		else
+		m_queue.clear();
+		for(auto chunkIterator = m_chunks.begin(); chunkIterator != m_chunks.end();)
 		{
-			SyncBuffer();
+			if(chunkIterator->second.state == CHUNK_STATE_QUEUED)
+			{
+				chunkIterator = m_chunks.erase(chunkIterator);
+			}
+			else
+			{
+				chunkIterator++;
+			}
 		}
 	}
+	RequestChunks(firstChunk, lastChunk, true);
+	if(sequential)
+	{
+		RequestChunks(lastChunk + 1, lastChunk + PREFETCH_CHUNKS, false);
+	}
+	m_sequentialEnd = m_objectPosition + adjSize;
+
+	uint64 readSize = 0;
+	while(readSize != adjSize)
+	{
+		uint64 chunkIndex = m_objectPosition / CHUNK_SIZE;
+		m_readChunk = chunkIndex;
+		const auto& chunk = WaitForChunk(chunkIndex, lock);
+		uint64 chunkOffset = m_objectPosition % CHUNK_SIZE;
+		assert(chunkOffset < chunk.data.size());
+		auto copySize = std::min<uint64>(chunk.data.size() - chunkOffset, adjSize - readSize);
+		memcpy(outBuffer + readSize, chunk.data.data() + chunkOffset, copySize);
+		m_objectPosition += copySize;
+		readSize += copySize;
+	}
 
 	assert(m_objectPosition <= m_objectSize);
-	return size;
+	return readSize;
 }
 
 uint64 CS3ObjectStream::Write(const void*, uint64)
@@ -111,9 +169,43 @@ fs::path CS3ObjectStream::GetCachePath()
 	return Framework::PathUtils::GetCachePath() / CACHE_PATH;
 }
 
-std::string CS3ObjectStream::GenerateReadCacheKey(const std::pair<uint64, uint64>& range) const
+CS3ObjectStream::ChunkCachePtr CS3ObjectStream::GetChunkCache()
 {
-	return string_format("%s-%llu-%llu", m_objectEtag.c_str(), range.first, range.second);
+	static std::mutex chunkCacheMutex;
+	static std::weak_ptr<CS3ChunkCache> sharedChunkCache;
+
+	uint64 cacheSize = CConfig::GetInstance().GetCacheSize();
+	if(cacheSize == 0) return ChunkCachePtr();
+
+	std::lock_guard<std::mutex> lock(chunkCacheMutex);
+	if(auto chunkCache = sharedChunkCache.lock())
+	{
+		return chunkCache;
+	}
+
+	try
+	{
+		auto cachePath = GetCachePath();
+		Framework::PathUtils::EnsurePathExists(cachePath);
+
+		//Remove files left by older versions which kept one file per range
+		std::error_code errorCode;
+		for(const auto& entry : fs::directory_iterator(cachePath, errorCode))
+		{
+			if(entry.path().filename() == CACHE_FILENAME) continue;
+			fs::remove(entry.path(), errorCode);
+		}
+
+		auto chunkCache = std::make_shared<CS3ChunkCache>(cachePath / CACHE_FILENAME, CHUNK_SIZE, cacheSize);
+		sharedChunkCache = chunkCache;
+		return chunkCache;
+	}
+	catch(const std::exception& exception)
+	{
+		//Not a problem if we can't use the cache
+		CLog::GetInstance().Print(LOG_NAME, "Failed to open cache: '%s'.\r\n", exception.what());
+		return ChunkCachePtr();
+	}
 }
 
 static std::string TrimQuotes(std::string input)
@@ -133,9 +225,10 @@ static std::string TrimQuotes(std::string input)
 
 void CS3ObjectStream::GetObjectInfo()
 {
-	//Obtain bucket region
+	//Obtain bucket region, S3 compatible servers don't need it
+	if(m_endpoint.empty())
 	{
-		CAmazonS3Client client(CConfig::GetInstance().GetAccessKeyId(), CConfig::GetInstance().GetSecretAccessKey());
+		CAmazonS3Client client(m_accessKeyId, m_secretAccessKey);
 
 		GetBucketLocationRequest request;
 		request.bucket = m_bucketName;
@@ -143,10 +236,14 @@ void CS3ObjectStream::GetObjectInfo()
 		auto result = client.GetBucketLocation(request);
 		m_bucketRegion = result.locationConstraint;
 	}
+	else
+	{
+		m_bucketRegion = "us-east-1";
+	}
 
 	//Obtain object info
 	{
-		CAmazonS3Client client(CConfig::GetInstance().GetAccessKeyId(), CConfig::GetInstance().GetSecretAccessKey(), m_bucketRegion);
+		CAmazonS3Client client(m_accessKeyId, m_secretAccessKey, m_bucketRegion, m_endpoint);
 
 		HeadObjectRequest request;
 		request.bucket = m_bucketName;
@@ -158,13 +255,121 @@ void CS3ObjectStream::GetObjectInfo()
 	}
 }
 
-void CS3ObjectStream::SyncBuffer()
+uint32 CS3ObjectStream::GetChunkSize(uint64 chunkIndex) const
+{
+	uint64 chunkPosition = chunkIndex * CHUNK_SIZE;
+	assert(chunkPosition < m_objectSize);
+	return static_cast<uint32>(std::min<uint64>(CHUNK_SIZE, m_objectSize - chunkPosition));
+}
+
+//Chunks that are needed right away are put at the front of the queue, in order, other
+//ones are put at the back. Must be called with the mutex locked.
+void CS3ObjectStream::RequestChunks(uint64 firstChunk, uint64 lastChunk, bool needed)
+{
+	uint64 chunkCount = (m_objectSize + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	lastChunk = std::min(lastChunk, chunkCount - 1);
+	if(firstChunk > lastChunk) return;
+
+	if(needed)
+	{
+		for(uint64 chunkIndex = lastChunk + 1; chunkIndex != firstChunk; chunkIndex--)
+		{
+			uint64 requestedChunk = chunkIndex - 1;
+			auto chunkIterator = m_chunks.find(requestedChunk);
+			if(chunkIterator == std::end(m_chunks))
+			{
+				m_chunks.emplace(requestedChunk, CHUNK());
+			}
+			else if(chunkIterator->second.state == CHUNK_STATE_QUEUED)
+			{
+				auto queueIterator = std::find(m_queue.begin(), m_queue.end(), requestedChunk);
+				assert(queueIterator != std::end(m_queue));
+				m_queue.erase(queueIterator);
+			}
+			else
+			{
+				continue;
+			}
+			m_queue.push_front(requestedChunk);
+		}
+	}
+	else
+	{
+		for(uint64 chunkIndex = firstChunk; chunkIndex <= lastChunk; chunkIndex++)
+		{
+			if(m_chunks.find(chunkIndex) != std::end(m_chunks)) continue;
+			m_chunks.emplace(chunkIndex, CHUNK());
+			m_queue.push_back(chunkIndex);
+		}
+	}
+	m_workerCondition.notify_all();
+}
+
+const CS3ObjectStream::CHUNK& CS3ObjectStream::WaitForChunk(uint64 chunkIndex, std::unique_lock<std::mutex>& lock)
+{
+	while(1)
+	{
+		auto chunkIterator = m_chunks.find(chunkIndex);
+		if(chunkIterator == std::end(m_chunks))
+		{
+			//Chunk was evicted before we got to it (read is bigger than what we keep around)
+			RequestChunks(chunkIndex, chunkIndex, true);
+			continue;
+		}
+		auto& chunk = chunkIterator->second;
+		if(chunk.state == CHUNK_STATE_READY)
+		{
+			return chunk;
+		}
+		if(chunk.state == CHUNK_STATE_FAILED)
+		{
+			//Forget about the chunk, next read will try again
+			auto error = chunk.error;
+			m_chunks.erase(chunkIterator);
+			std::rethrow_exception(error);
+		}
+		m_chunkCondition.wait(lock);
+	}
+}
+
+//Drops loaded chunks that are the farthest from the read position, chunks behind it
+//going first. Must be called with the mutex locked.
+void CS3ObjectStream::EvictChunks()
 {
-	m_bufferPosition = (m_objectPosition / BUFFERSIZE) * BUFFERSIZE;
+	while(m_chunks.size() > MAX_CHUNKS)
+	{
+		auto evictedChunkIterator = std::end(m_chunks);
+		uint64 evictedChunkScore = 0;
+		for(auto chunkIterator = m_chunks.begin(); chunkIterator != m_chunks.end(); chunkIterator++)
+		{
+			uint64 chunkIndex = chunkIterator->first;
+			auto state = chunkIterator->second.state;
+			if((state != CHUNK_STATE_READY) && (state != CHUNK_STATE_FAILED)) continue;
+			if(chunkIndex == m_readChunk) continue;
+			uint64 score = (chunkIndex < m_readChunk) ? (m_objectSize + m_readChunk - chunkIndex) : (chunkIndex - m_readChunk);
+			if(score > evictedChunkScore)
+			{
+				evictedChunkIterator = chunkIterator;
+				evictedChunkScore = score;
+			}
+		}
+		if(evictedChunkIterator == std::end(m_chunks)) break;
+		m_chunks.erase(evictedChunkIterator);
+	}
+}
 
-	uint64 size = std::min<uint64>(BUFFERSIZE, m_objectSize - m_bufferPosition);
-	auto range = std::make_pair(m_bufferPosition, m_bufferPosition + size - 1);
-	auto readCacheFilePath = GetCachePath() / GenerateReadCacheKey(range);
+void CS3ObjectStream::FetchChunk(uint64 chunkIndex, std::vector<uint8>& data)
+{
+	uint32 size = GetChunkSize(chunkIndex);
+	data.resize(size);
+
+	if(m_chunkCache && m_chunkCache->Read(m_chunkCacheKey, chunkIndex, data.data(), size))
+	{
+		return;
+	}
+
+	uint64 position = chunkIndex * CHUNK_SIZE;
+	auto range = std::make_pair(position, position + size - 1);
 
 #ifdef _TRACEGET
 	static FILE* output = fopen("getobject.log", "wb");
@@ -172,47 +377,73 @@ void CS3ObjectStream::SyncBuffer()
 	fflush(output);
 #endif
 
-	bool cachedReadSucceeded =
-	    [&]() {
-		    try
-		    {
-			    if(fs::exists(readCacheFilePath))
-			    {
-				    auto readCacheFileStream = Framework::CreateInputStdStream(readCacheFilePath.native());
-				    auto cacheRead = readCacheFileStream.Read(m_buffer.data(), size);
-				    assert(cacheRead == size);
-				    return true;
-			    }
-		    }
-		    catch(const std::exception& exception)
-		    {
-			    //Not a problem if we failed to read cache
-			    CLog::GetInstance().Print(LOG_NAME, "Failed to read cache: '%s'.\r\n", exception.what());
-		    }
-		    return false;
-	    }();
-
-	if(!cachedReadSucceeded)
-	{
-		assert(size > 0);
-		CAmazonS3Client client(CConfig::GetInstance().GetAccessKeyId(), CConfig::GetInstance().GetSecretAccessKey(), m_bucketRegion);
-		GetObjectRequest request;
-		request.object = m_objectName;
-		request.bucket = m_bucketName;
-		request.range = range;
-		auto objectContent = client.GetObject(request);
-		assert(objectContent.data.size() == size);
-		memcpy(m_buffer.data(), objectContent.data.data(), size);
+	CAmazonS3Client client(m_accessKeyId, m_secretAccessKey, m_bucketRegion, m_endpoint);
+	GetObjectRequest request;
+	request.object = m_objectName;
+	request.bucket = m_bucketName;
+	request.range = range;
+	auto objectContent = client.GetObject(request);
+	if(objectContent.data.size() != size)
+	{
+		throw std::runtime_error("Object range has an unexpected size.");
+	}
+	memcpy(data.data(), objectContent.data.data(), size);
+
+	if(m_chunkCache)
+	{
+		m_chunkCache->Write(m_chunkCacheKey, chunkIndex, data.data(), size);
+	}
+}
 
+void CS3ObjectStream::WorkerThreadProc()
+{
+	while(1)
+	{
+		uint64 chunkIndex = 0;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_workerCondition.wait(lock, [this]() { return m_workersEnd || !m_queue.empty(); });
+			if(m_workersEnd) break;
+
+			chunkIndex = m_queue.front();
+			m_queue.pop_front();
+			m_chunks[chunkIndex].state = CHUNK_STATE_LOADING;
+		}
+
+		std::vector<uint8> data;
+		std::exception_ptr error;
 		try
 		{
-			auto readCacheFileStream = Framework::CreateOutputStdStream(readCacheFilePath.native());
-			readCacheFileStream.Write(objectContent.data.data(), size);
+			FetchChunk(chunkIndex, data);
 		}
 		catch(const std::exception& exception)
 		{
-			//Not a problem if we failed to write cache
-			CLog::GetInstance().Print(LOG_NAME, "Failed to write cache: '%s'.\r\n", exception.what());
+			CLog::GetInstance().Warn(LOG_NAME, "Failed to fetch chunk %llu: '%s'.\r\n", chunkIndex, exception.what());
+			error = std::current_exception();
+		}
+		catch(...)
+		{
+			error = std::current_exception();
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			auto chunkIterator = m_chunks.find(chunkIndex);
+			assert(chunkIterator != std::end(m_chunks));
+			auto& chunk = chunkIterator->second;
+			assert(chunk.state == CHUNK_STATE_LOADING);
+			if(error)
+			{
+				chunk.state = CHUNK_STATE_FAILED;
+				chunk.error = error;
+			}
+			else
+			{
+				chunk.state = CHUNK_STATE_READY;
+				chunk.data = std::move(data);
+			}
+			EvictChunks();
 		}
+		m_chunkCondition.notify_all();
 	}
 }
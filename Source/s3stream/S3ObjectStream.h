@@ -1,10 +1,27 @@
 #pragma once
 
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 #include "Singleton.h"
 #include "Stream.h"
 #include "filesystem_def.h"
 
+#define PREF_S3_OBJECTSTREAM_ACCESSKEYID "s3.objectstream.accesskeyid"
+#define PREF_S3_OBJECTSTREAM_SECRETACCESSKEY "s3.objectstream.secretaccesskey"
+#define PREF_S3_OBJECTSTREAM_ENDPOINT "s3.objectstream.endpoint"
+#define PREF_S3_OBJECTSTREAM_CACHESIZE "s3.objectstream.cachesize"
+
+class CS3ChunkCache;
+
+//Object is read in chunks fetched by a pool of workers, each issuing its own range requests.
+//Chunks following sequential reads are prefetched. Fetched chunks are kept in a persistent
+//chunk cache shared by all streams.
 class CS3ObjectStream : public Framework::CStream
 {
 public:
@@ -14,9 +31,20 @@ public:
 		CConfig();
 		std::string GetAccessKeyId();
 		std::string GetSecretAccessKey();
+		std::string GetEndpoint();
+		uint64 GetCacheSize();
+	};
+
+	enum
+	{
+		CHUNK_SIZE = 0x40000,
+		PREFETCH_CHUNKS = 8,
+		MAX_CHUNKS = 32,
+		WORKER_COUNT = 4,
 	};
 
 	CS3ObjectStream(const char*, const char*);
+	virtual ~CS3ObjectStream();
 
 	uint64 Read(void*, uint64) override;
 	uint64 Write(const void*, uint64) override;
@@ -25,21 +53,58 @@ public:
 	bool IsEOF() override;
 
 private:
+	enum CHUNK_STATE
+	{
+		CHUNK_STATE_QUEUED,
+		CHUNK_STATE_LOADING,
+		CHUNK_STATE_READY,
+		CHUNK_STATE_FAILED,
+	};
+
+	struct CHUNK
+	{
+		CHUNK_STATE state = CHUNK_STATE_QUEUED;
+		std::vector<uint8> data;
+		std::exception_ptr error;
+	};
+
+	typedef std::shared_ptr<CS3ChunkCache> ChunkCachePtr;
+	typedef std::unordered_map<uint64, CHUNK> ChunkMap;
+
 	static fs::path GetCachePath();
-	std::string GenerateReadCacheKey(const std::pair<uint64, uint64>&) const;
+	static ChunkCachePtr GetChunkCache();
 	void GetObjectInfo();
-	void SyncBuffer();
+
+	uint32 GetChunkSize(uint64) const;
+	void RequestChunks(uint64, uint64, bool);
+	const CHUNK& WaitForChunk(uint64, std::unique_lock<std::mutex>&);
+	void EvictChunks();
+	void FetchChunk(uint64, std::vector<uint8>&);
+	void WorkerThreadProc();
 
 	std::string m_bucketName;
 	std::string m_bucketRegion;
 	std::string m_objectName;
+	std::string m_endpoint;
+	std::string m_accessKeyId;
+	std::string m_secretAccessKey;
 
 	//Object Metadata
 	uint64 m_objectSize = 0;
 	std::string m_objectEtag;
 
 	uint64 m_objectPosition = 0;
+	uint64 m_sequentialEnd = 0;
+	uint64 m_readChunk = 0;
+
+	ChunkCachePtr m_chunkCache;
+	std::string m_chunkCacheKey;
 
-	std::vector<uint8> m_buffer;
-	uint64 m_bufferPosition = ~0ULL;
+	std::mutex m_mutex;
+	std::condition_variable m_workerCondition;
+	std::condition_variable m_chunkCondition;
+	std::vector<std::thread> m_workerThreads;
+	bool m_workersEnd = false;
+	std::deque<uint64> m_queue;
+	ChunkMap m_chunks;
 };
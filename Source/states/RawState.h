@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <type_traits>
+#include "Stream.h"
+
+//Helpers to dump machine state as it lies in memory, without any kind of conversion.
+//Only meant for transient snapshots (ie.: rewind) that are read back by the same process.
+namespace RawState
+{
+	template <typename ValueType>
+	void Write(Framework::CStream& stream, const ValueType& value)
+	{
+		static_assert(std::is_trivially_copyable<ValueType>::value, "Value must be trivially copyable.");
+		stream.Write(&value, sizeof(ValueType));
+	}
+
+	template <typename ValueType>
+	void Read(Framework::CStream& stream, ValueType& value)
+	{
+		static_assert(std::is_trivially_copyable<ValueType>::value, "Value must be trivially copyable.");
+		if(stream.Read(&value, sizeof(ValueType)) != sizeof(ValueType))
+		{
+			throw std::runtime_error("Raw state is truncated.");
+		}
+	}
+
+	inline void WriteBytes(Framework::CStream& stream, const std::vector<uint8>& bytes)
+	{
+		Write(stream, static_cast<uint32>(bytes.size()));
+		stream.Write(bytes.data(), bytes.size());
+	}
+
+	inline void ReadBytes(Framework::CStream& stream, std::vector<uint8>& bytes)
+	{
+		uint32 size = 0;
+		Read(stream, size);
+		bytes.resize(size);
+		if(stream.Read(bytes.data(), size) != size)
+		{
+			throw std::runtime_error("Raw state is truncated.");
+		}
+	}
+
+	inline void WriteString(Framework::CStream& stream, const std::string& value)
+	{
+		Write(stream, static_cast<uint32>(value.size()));
+		stream.Write(value.data(), value.size());
+	}
+
+	inline std::string ReadString(Framework::CStream& stream)
+	{
+		uint32 size = 0;
+		Read(stream, size);
+		std::string value(size, 0);
+		if(stream.Read(&value[0], size) != size)
+		{
+			throw std::runtime_error("Raw state is truncated.");
+		}
+		return value;
+	}
+}
@@ -1,16 +1,20 @@
 #include "PS2VM.h"
+#include "FrameDump.h"
 #include "filesystem_def.h"
 #include "StdStream.h"
 #include "StdStreamUtils.h"
+#include "string_format.h"
 #include "iop/IopBios.h"
 #include "JUnitTestReportWriter.h"
 #include "gs/GSH_Null.h"
+#include "gs/GSH_Software/GSH_Software.h"
 #ifdef _WIN32
 #include "gs/GSH_OpenGLWin32/GSH_OpenGLWin32.h"
 #include "gs/GSH_Direct3D9/GSH_Direct3D9.h"
 #endif
 
 #define GS_HANDLER_NAME_NULL "null"
+#define GS_HANDLER_NAME_SOFTWARE "software"
 #define GS_HANDLER_NAME_OGL "ogl"
 #define GS_HANDLER_NAME_D3D9 "d3d9"
 
@@ -19,6 +23,7 @@
 static std::set<std::string> g_validGsHandlersNames =
     {
         GS_HANDLER_NAME_NULL,
+        GS_HANDLER_NAME_SOFTWARE,
 #ifdef _WIN32
         GS_HANDLER_NAME_OGL,
         GS_HANDLER_NAME_D3D9,
@@ -45,6 +50,10 @@ CGSHandler::FactoryFunction GetGsHandlerFactoryFunction(const std::string& gsHan
 	{
 		return CGSH_Null::GetFactoryFunction();
 	}
+	else if(gsHandlerName == GS_HANDLER_NAME_SOFTWARE)
+	{
+		return CGSH_Software::GetFactoryFunction();
+	}
 #ifdef _WIN32
 	else if(gsHandlerName == GS_HANDLER_NAME_OGL)
 	{
@@ -189,6 +198,71 @@ void ExecuteIopTest(const fs::path& testFilePath)
 	virtualMachine.Destroy();
 }
 
+bool IsFrameDumpPath(const fs::path& testFilePath)
+{
+	static const std::string frameDumpExtension = ".dmp.zip";
+	auto fileName = testFilePath.filename().string();
+	if(fileName.size() < frameDumpExtension.size()) return false;
+	return fileName.compare(fileName.size() - frameDumpExtension.size(), frameDumpExtension.size(), frameDumpExtension) == 0;
+}
+
+void ExecuteFrameDumpTest(const fs::path& testFilePath, const std::string& gsHandlerName)
+{
+	CFrameDump frameDump;
+	{
+		auto inputStream = Framework::CreateInputStdStream(testFilePath.native());
+		frameDump.Read(inputStream);
+	}
+
+	//Replay the frame the same way the frame debugger does
+	auto gsHandler = GetGsHandlerFactoryFunction(gsHandlerName)();
+	gsHandler->Initialize();
+	gsHandler->Reset();
+
+	memcpy(gsHandler->GetRam(), frameDump.GetInitialGsRam(), CGSHandler::RAMSIZE);
+	memcpy(gsHandler->GetRegisters(), frameDump.GetInitialGsRegisters(), CGSHandler::REGISTER_MAX * sizeof(uint64));
+	gsHandler->SetSMODE2(frameDump.GetInitialSMODE2());
+
+	CGsPacket::RegisterWriteArray registerWrites;
+	for(const auto& packet : frameDump.GetPackets())
+	{
+		if(packet.registerWrites.empty())
+		{
+			gsHandler->WriteRegisterMassively(std::move(registerWrites), nullptr);
+			registerWrites.clear();
+			gsHandler->FeedImageData(packet.imageData.data(), packet.imageData.size());
+		}
+		else
+		{
+			registerWrites.insert(std::end(registerWrites), std::begin(packet.registerWrites), std::end(packet.registerWrites));
+		}
+	}
+	gsHandler->WriteRegisterMassively(std::move(registerWrites), nullptr);
+	gsHandler->Flip();
+
+	//Result is the size of the framebuffer and a FNV-1a hash of its contents
+	uint32 width = gsHandler->GetCrtWidth();
+	uint32 height = gsHandler->GetCrtHeight();
+	uint32 pitch = ((width * 3) + 3) & ~3;
+	std::vector<uint8> pixels(pitch * height);
+	gsHandler->ReadFramebuffer(width, height, pixels.data());
+
+	uint32 hash = 0x811C9DC5;
+	for(auto pixel : pixels)
+	{
+		hash = (hash ^ pixel) * 0x01000193;
+	}
+
+	gsHandler->Release();
+	delete gsHandler;
+
+	auto resultFilePath = testFilePath;
+	resultFilePath.replace_extension(".result");
+	auto resultStream = Framework::CreateOutputStdStream(resultFilePath.native());
+	auto result = string_format("%dx%d %08x", width, height, hash);
+	resultStream.Write(result.c_str(), result.size());
+}
+
 void ScanAndExecuteTests(const fs::path& testDirPath, const TestReportWriterPtr& testReportWriter, const std::string& gsHandlerName)
 {
 	fs::directory_iterator endIterator;
@@ -223,6 +297,17 @@ void ScanAndExecuteTests(const fs::path& testDirPath, const TestReportWriterPtr&
 				testReportWriter->ReportTestEntry(testPath.string(), result);
 			}
 		}
+		else if(IsFrameDumpPath(testPath))
+		{
+			printf("Testing '%s': ", testPath.string().c_str());
+			ExecuteFrameDumpTest(testPath, gsHandlerName);
+			auto result = GetTestResult(testPath);
+			printf("%s.\r\n", result.succeeded ? "SUCCEEDED" : "FAILED");
+			if(testReportWriter)
+			{
+				testReportWriter->ReportTestEntry(testPath.string(), result);
+			}
+		}
 	}
 }
 
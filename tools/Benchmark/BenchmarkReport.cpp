@@ -0,0 +1,224 @@
+#include <algorithm>
+#include <cassert>
+#include "BenchmarkReport.h"
+#include "string_format.h"
+
+void CBenchmarkReport::SetSource(const std::string& source)
+{
+	m_source = source;
+}
+
+void CBenchmarkReport::SetGsHandlerName(const std::string& gsHandlerName)
+{
+	m_gsHandlerName = gsHandlerName;
+}
+
+void CBenchmarkReport::SetWarmupFrameCount(uint32 warmupFrameCount)
+{
+	m_warmupFrameCount = warmupFrameCount;
+}
+
+void CBenchmarkReport::AddFrame(uint64 time)
+{
+	FRAME frame;
+	frame.time = time;
+	m_frames.push_back(frame);
+}
+
+void CBenchmarkReport::SetFrameZones(const CProfiler::ZoneArray& zones)
+{
+	assert(!m_frames.empty());
+	auto& frame = m_frames.back();
+	frame.zoneTimes.clear();
+	for(const auto& zone : zones)
+	{
+		ZONE_TIME zoneTime;
+		zoneTime.name = zone.name;
+		zoneTime.time = zone.totalTime;
+		frame.zoneTimes.push_back(zoneTime);
+	}
+}
+
+void CBenchmarkReport::SetGsFrameCount(uint32 gsFrameCount)
+{
+	m_gsFrameCount = gsFrameCount;
+}
+
+void CBenchmarkReport::SetTimeToFirstFrame(uint64 timeToFirstFrame)
+{
+	m_timeToFirstFrame = timeToFirstFrame;
+}
+
+void CBenchmarkReport::AddExecutorStats(const std::string& name, const CMipsExecutor::STATS& stats)
+{
+	EXECUTOR executor;
+	executor.name = name;
+	executor.stats = stats;
+	m_executors.push_back(executor);
+}
+
+void CBenchmarkReport::SetPeakMemoryUsage(uint64 peakMemoryUsage)
+{
+	m_peakMemoryUsage = peakMemoryUsage;
+}
+
+uint32 CBenchmarkReport::GetFrameCount() const
+{
+	return static_cast<uint32>(m_frames.size());
+}
+
+std::string CBenchmarkReport::ToJson() const
+{
+	uint64 totalTime = 0;
+	std::vector<uint64> sortedFrameTimes;
+	sortedFrameTimes.reserve(m_frames.size());
+	for(const auto& frame : m_frames)
+	{
+		totalTime += frame.time;
+		sortedFrameTimes.push_back(frame.time);
+	}
+	std::sort(sortedFrameTimes.begin(), sortedFrameTimes.end());
+
+	//Nearest rank percentile
+	auto getPercentile =
+	    [&](uint32 percentile) -> uint64 {
+		    if(sortedFrameTimes.empty()) return 0;
+		    size_t rank = ((sortedFrameTimes.size() * percentile) + 99) / 100;
+		    return sortedFrameTimes[std::max<size_t>(rank, 1) - 1];
+	    };
+
+	double totalSeconds = static_cast<double>(totalTime) / 1000000000.0;
+	double fps = (totalTime != 0) ? static_cast<double>(m_frames.size()) / totalSeconds : 0;
+	double gsFps = (totalTime != 0) ? static_cast<double>(m_gsFrameCount) / totalSeconds : 0;
+
+	std::string result;
+	result += "{\n";
+	result += string_format("\t\"source\": \"%s\",\n", EscapeString(m_source).c_str());
+	result += string_format("\t\"gsHandler\": \"%s\",\n", EscapeString(m_gsHandlerName).c_str());
+#ifdef PROFILE
+	result += "\t\"profilerEnabled\": true,\n";
+#else
+	result += "\t\"profilerEnabled\": false,\n";
+#endif
+	result += string_format("\t\"warmupFrames\": %u,\n", m_warmupFrameCount);
+	result += string_format("\t\"frames\": %u,\n", static_cast<uint32>(m_frames.size()));
+	result += string_format("\t\"totalTimeMs\": %.3f,\n", ToMilliseconds(totalTime));
+	result += string_format("\t\"fps\": %.3f,\n", fps);
+	result += string_format("\t\"gsFrames\": %u,\n", m_gsFrameCount);
+	result += string_format("\t\"gsFps\": %.3f,\n", gsFps);
+	result += string_format("\t\"timeToFirstFrameMs\": %.3f,\n", ToMilliseconds(m_timeToFirstFrame));
+
+	result += "\t\"frameTimeMs\": {\n";
+	result += string_format("\t\t\"avg\": %.3f,\n", m_frames.empty() ? 0 : ToMilliseconds(totalTime) / static_cast<double>(m_frames.size()));
+	result += string_format("\t\t\"min\": %.3f,\n", sortedFrameTimes.empty() ? 0 : ToMilliseconds(sortedFrameTimes.front()));
+	result += string_format("\t\t\"max\": %.3f,\n", sortedFrameTimes.empty() ? 0 : ToMilliseconds(sortedFrameTimes.back()));
+	result += string_format("\t\t\"p50\": %.3f,\n", ToMilliseconds(getPercentile(50)));
+	result += string_format("\t\t\"p95\": %.3f,\n", ToMilliseconds(getPercentile(95)));
+	result += string_format("\t\t\"p99\": %.3f\n", ToMilliseconds(getPercentile(99)));
+	result += "\t},\n";
+
+	//Zones are registered once and never removed, all frames with zones have them in the same order
+	std::vector<std::string> zoneNames;
+	for(const auto& frame : m_frames)
+	{
+		if(frame.zoneTimes.size() <= zoneNames.size()) continue;
+		zoneNames.clear();
+		for(const auto& zoneTime : frame.zoneTimes)
+		{
+			zoneNames.push_back(zoneTime.name);
+		}
+	}
+
+	result += "\t\"zoneTimeMs\": {";
+	for(uint32 zoneIndex = 0; zoneIndex < zoneNames.size(); zoneIndex++)
+	{
+		uint64 zoneTotal = 0;
+		uint64 zoneMin = ~0ULL;
+		uint64 zoneMax = 0;
+		for(const auto& frame : m_frames)
+		{
+			uint64 zoneTime = (zoneIndex < frame.zoneTimes.size()) ? frame.zoneTimes[zoneIndex].time : 0;
+			zoneTotal += zoneTime;
+			zoneMin = std::min(zoneMin, zoneTime);
+			zoneMax = std::max(zoneMax, zoneTime);
+		}
+		result += (zoneIndex == 0) ? "\n" : ",\n";
+		result += string_format("\t\t\"%s\": { \"avg\": %.3f, \"min\": %.3f, \"max\": %.3f }",
+		                        EscapeString(zoneNames[zoneIndex]).c_str(),
+		                        ToMilliseconds(zoneTotal) / static_cast<double>(m_frames.size()),
+		                        ToMilliseconds(zoneMin), ToMilliseconds(zoneMax));
+	}
+	result += zoneNames.empty() ? "},\n" : "\n\t},\n";
+
+	result += "\t\"executors\": {";
+	for(uint32 executorIndex = 0; executorIndex < m_executors.size(); executorIndex++)
+	{
+		const auto& executor = m_executors[executorIndex];
+		result += (executorIndex == 0) ? "\n" : ",\n";
+		result += string_format("\t\t\"%s\": { \"compiledBlocks\": %u, \"cachedBlocks\": %u, \"activeBlocks\": %u, \"activeCodeSize\": %llu }",
+		                        EscapeString(executor.name).c_str(),
+		                        executor.stats.compiledBlockCount, executor.stats.cachedBlockCount,
+		                        executor.stats.activeBlockCount, static_cast<unsigned long long>(executor.stats.activeCodeSize));
+	}
+	result += m_executors.empty() ? "},\n" : "\n\t},\n";
+
+	result += string_format("\t\"peakMemoryUsage\": %llu,\n", static_cast<unsigned long long>(m_peakMemoryUsage));
+
+	result += "\t\"frameList\": [";
+	for(uint32 frameIndex = 0; frameIndex < m_frames.size(); frameIndex++)
+	{
+		const auto& frame = m_frames[frameIndex];
+		result += (frameIndex == 0) ? "\n" : ",\n";
+		result += string_format("\t\t{ \"timeMs\": %.3f", ToMilliseconds(frame.time));
+		if(!frame.zoneTimes.empty())
+		{
+			result += ", \"zoneTimeMs\": {";
+			for(uint32 zoneIndex = 0; zoneIndex < frame.zoneTimes.size(); zoneIndex++)
+			{
+				const auto& zoneTime = frame.zoneTimes[zoneIndex];
+				result += string_format("%s \"%s\": %.3f", (zoneIndex == 0) ? "" : ",",
+				                        EscapeString(zoneTime.name).c_str(), ToMilliseconds(zoneTime.time));
+			}
+			result += " }";
+		}
+		result += " }";
+	}
+	result += m_frames.empty() ? "]\n" : "\n\t]\n";
+
+	result += "}\n";
+	return result;
+}
+
+std::string CBenchmarkReport::EscapeString(const std::string& input)
+{
+	std::string result;
+	result.reserve(input.size());
+	for(auto character : input)
+	{
+		switch(character)
+		{
+		case '"':
+			result += "\\\"";
+			break;
+		case '\\':
+			result += "\\\\";
+			break;
+		default:
+			if(static_cast<uint8>(character) < 0x20)
+			{
+				result += string_format("\\u%04x", static_cast<uint8>(character));
+			}
+			else
+			{
+				result += character;
+			}
+			break;
+		}
+	}
+	return result;
+}
+
+double CBenchmarkReport::ToMilliseconds(uint64 time)
+{
+	return static_cast<double>(time) / 1000000.0;
+}
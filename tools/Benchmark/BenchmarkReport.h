@@ -0,0 +1,63 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "Types.h"
+#include "Profiler.h"
+#include "MipsExecutor.h"
+
+//Results of a benchmark run, written as a JSON document. Frame times are wall clock time
+//between two vblank starts. Profiler zone times are only available if the core was built
+//with PROFILE defined. Time to first frame is measured from the start of execution to
+//the first frame displayed by the GS, which includes loading time when booting from a disc.
+class CBenchmarkReport
+{
+public:
+	void SetSource(const std::string&);
+	void SetGsHandlerName(const std::string&);
+	void SetWarmupFrameCount(uint32);
+
+	void AddFrame(uint64);
+	void SetFrameZones(const CProfiler::ZoneArray&);
+	void SetGsFrameCount(uint32);
+	void SetTimeToFirstFrame(uint64);
+
+	void AddExecutorStats(const std::string&, const CMipsExecutor::STATS&);
+	void SetPeakMemoryUsage(uint64);
+
+	uint32 GetFrameCount() const;
+
+	std::string ToJson() const;
+
+private:
+	struct ZONE_TIME
+	{
+		std::string name;
+		uint64 time = 0;
+	};
+	typedef std::vector<ZONE_TIME> ZoneTimeArray;
+
+	struct FRAME
+	{
+		uint64 time = 0;
+		ZoneTimeArray zoneTimes;
+	};
+
+	struct EXECUTOR
+	{
+		std::string name;
+		CMipsExecutor::STATS stats;
+	};
+
+	static std::string EscapeString(const std::string&);
+	static double ToMilliseconds(uint64);
+
+	std::string m_source;
+	std::string m_gsHandlerName;
+	uint32 m_warmupFrameCount = 0;
+	uint32 m_gsFrameCount = 0;
+	uint64 m_timeToFirstFrame = 0;
+	uint64 m_peakMemoryUsage = 0;
+	std::vector<FRAME> m_frames;
+	std::vector<EXECUTOR> m_executors;
+};
@@ -0,0 +1,329 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include "PS2VM.h"
+#include "PS2VM_Preferences.h"
+#include "AppConfig.h"
+#include "StdStreamUtils.h"
+#include "gs/GSH_Null.h"
+#include "gs/GSH_Software/GSH_Software.h"
+#include "BenchmarkReport.h"
+#ifdef HAS_AMAZON_S3
+#include "s3stream/S3ObjectStream.h"
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#define GS_HANDLER_NAME_NULL "null"
+#define GS_HANDLER_NAME_SOFTWARE "software"
+
+#define DEFAULT_GS_HANDLER_NAME GS_HANDLER_NAME_NULL
+#define DEFAULT_FRAME_COUNT 1000
+
+CGSHandler::FactoryFunction GetGsHandlerFactoryFunction(const std::string& gsHandlerName)
+{
+	if(gsHandlerName == GS_HANDLER_NAME_NULL)
+	{
+		return CGSH_Null::GetFactoryFunction();
+	}
+	else if(gsHandlerName == GS_HANDLER_NAME_SOFTWARE)
+	{
+		return CGSH_Software::GetFactoryFunction();
+	}
+	else
+	{
+		throw std::runtime_error("Unknown GS handler name.");
+	}
+}
+
+bool IsExecutablePath(const fs::path& path)
+{
+	auto extension = path.extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+	return (extension == ".elf");
+}
+
+uint64 GetPeakMemoryUsage()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS memoryCounters = {};
+	if(!GetProcessMemoryInfo(GetCurrentProcess(), &memoryCounters, sizeof(memoryCounters))) return 0;
+	return memoryCounters.PeakWorkingSetSize;
+#else
+	struct rusage usage = {};
+	if(getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+	//Reported in bytes on macOS, kilobytes everywhere else
+	return usage.ru_maxrss;
+#else
+	return static_cast<uint64>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+void ExecuteBenchmark(const fs::path& sourcePath, const std::string& gsHandlerName, uint32 frameCount, uint32 warmupFrameCount, CBenchmarkReport& report)
+{
+	typedef std::chrono::high_resolution_clock ClockType;
+
+	std::mutex frameMutex;
+	std::condition_variable frameCondition;
+	ClockType::time_point lastFrameTime;
+	uint32 frameIndex = 0;
+	bool frameZonesPending = false;
+	bool executionOver = false;
+	std::atomic<bool> measuring(false);
+	std::atomic<uint32> gsFrameCount(0);
+	std::atomic<bool> firstGsFrameDone(false);
+	ClockType::time_point startTime;
+
+	bool isExecutable = IsExecutablePath(sourcePath);
+	if(!isExecutable)
+	{
+		CAppConfig::GetInstance().SetPreferencePath(PREF_PS2_CDROM0_PATH, sourcePath);
+	}
+
+	CPS2VM virtualMachine;
+	virtualMachine.Initialize();
+	virtualMachine.Reset();
+	virtualMachine.CreateGSHandler(GetGsHandlerFactoryFunction(gsHandlerName));
+	virtualMachine.SetDeterministicExecution(true);
+
+	//Called from the emulation thread, frames are measured from one vblank start to the next
+	auto frameDoneConnection = virtualMachine.FrameDone.Connect(
+	    [&]() {
+		    auto frameTime = ClockType::now();
+		    std::lock_guard<std::mutex> frameLock(frameMutex);
+		    if(executionOver) return;
+		    if(frameIndex > warmupFrameCount)
+		    {
+			    auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(frameTime - lastFrameTime);
+			    report.AddFrame(duration.count());
+			    frameZonesPending = true;
+		    }
+		    lastFrameTime = frameTime;
+		    frameIndex++;
+		    measuring = (frameIndex > warmupFrameCount);
+		    if(report.GetFrameCount() == frameCount)
+		    {
+			    executionOver = true;
+			    measuring = false;
+			    frameCondition.notify_all();
+		    }
+	    });
+	//Only emitted when profiling, right after FrameDone
+	auto profileFrameDoneConnection = virtualMachine.ProfileFrameDone.Connect(
+	    [&](const CProfiler::ZoneArray& zones) {
+		    std::lock_guard<std::mutex> frameLock(frameMutex);
+		    if(!frameZonesPending) return;
+		    report.SetFrameZones(zones);
+		    frameZonesPending = false;
+	    });
+	auto gsNewFrameConnection = virtualMachine.GetGSHandler()->OnNewFrame.Connect(
+	    [&](uint32) {
+		    if(!firstGsFrameDone.exchange(true))
+		    {
+			    auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(ClockType::now() - startTime);
+			    report.SetTimeToFirstFrame(duration.count());
+		    }
+		    if(measuring)
+		    {
+			    gsFrameCount++;
+		    }
+	    });
+	auto requestExitConnection = virtualMachine.m_ee->m_os->OnRequestExit.Connect(
+	    [&]() {
+		    std::lock_guard<std::mutex> frameLock(frameMutex);
+		    executionOver = true;
+		    measuring = false;
+		    frameCondition.notify_all();
+	    });
+
+	//Booting from a disc reads from it, count this as part of the time to first frame
+	startTime = ClockType::now();
+	if(isExecutable)
+	{
+		virtualMachine.m_ee->m_os->BootFromFile(sourcePath);
+	}
+	else
+	{
+		virtualMachine.m_ee->m_os->BootFromCDROM();
+	}
+	virtualMachine.Resume();
+
+	{
+		std::unique_lock<std::mutex> frameLock(frameMutex);
+		frameCondition.wait(frameLock, [&]() { return executionOver; });
+	}
+
+	virtualMachine.Pause();
+
+	report.SetGsFrameCount(gsFrameCount);
+	report.AddExecutorStats("ee", virtualMachine.m_ee->m_EE.m_executor->GetStats());
+	report.AddExecutorStats("vu0", virtualMachine.m_ee->m_VU0.m_executor->GetStats());
+	report.AddExecutorStats("vu1", virtualMachine.m_ee->m_VU1.m_executor->GetStats());
+	report.AddExecutorStats("iop", virtualMachine.m_iop->m_cpu.m_executor->GetStats());
+	report.SetPeakMemoryUsage(GetPeakMemoryUsage());
+
+	gsNewFrameConnection.reset();
+	virtualMachine.DestroyGSHandler();
+	virtualMachine.Destroy();
+}
+
+int main(int argc, const char** argv)
+{
+	if(argc < 2)
+	{
+		printf("Usage: Benchmark [options] <elf or disc image path>\r\n");
+		printf("Options: \r\n");
+		printf("\t --frames <count>\t Number of frames (vblanks) to measure (default is %d).\r\n", DEFAULT_FRAME_COUNT);
+		printf("\t --warmup <count>\t Number of frames to run before measuring (default is 0).\r\n");
+		printf("\t --gshandler <%s|%s>\t Selects which GS handler to instantiate (default is '%s').\r\n",
+		       GS_HANDLER_NAME_NULL, GS_HANDLER_NAME_SOFTWARE, DEFAULT_GS_HANDLER_NAME);
+		printf("\t --output <path>\t Writes JSON report at <path> instead of standard output.\r\n");
+#ifdef HAS_AMAZON_S3
+		printf("\t --s3endpoint <url>\t Uses a S3 compatible server for '//s3/<bucket>/<object>' disc images.\r\n");
+#endif
+		return -1;
+	}
+
+	fs::path sourcePath;
+	fs::path outputPath;
+	std::string gsHandlerName = DEFAULT_GS_HANDLER_NAME;
+	uint32 frameCount = DEFAULT_FRAME_COUNT;
+	uint32 warmupFrameCount = 0;
+#ifdef HAS_AMAZON_S3
+	std::string s3Endpoint;
+#endif
+
+	for(int i = 1; i < argc; i++)
+	{
+		bool hasValue = (i + 1) < argc;
+		if(!strcmp(argv[i], "--frames") || !strcmp(argv[i], "--warmup"))
+		{
+			if(!hasValue)
+			{
+				printf("Error: Count must be specified for %s option.\r\n", argv[i]);
+				return -1;
+			}
+			int count = atoi(argv[i + 1]);
+			if(count < 0)
+			{
+				printf("Error: Invalid count '%s'.\r\n", argv[i + 1]);
+				return -1;
+			}
+			if(!strcmp(argv[i], "--frames"))
+			{
+				frameCount = count;
+			}
+			else
+			{
+				warmupFrameCount = count;
+			}
+			i++;
+		}
+		else if(!strcmp(argv[i], "--gshandler"))
+		{
+			if(!hasValue)
+			{
+				printf("Error: GS handler name must be specified for --gshandler option.\r\n");
+				return -1;
+			}
+			gsHandlerName = argv[i + 1];
+			if((gsHandlerName != GS_HANDLER_NAME_NULL) && (gsHandlerName != GS_HANDLER_NAME_SOFTWARE))
+			{
+				printf("Error: Invalid GS handler name '%s'.\r\n", gsHandlerName.c_str());
+				return -1;
+			}
+			i++;
+		}
+		else if(!strcmp(argv[i], "--output"))
+		{
+			if(!hasValue)
+			{
+				printf("Error: Path must be specified for --output option.\r\n");
+				return -1;
+			}
+			outputPath = fs::path(argv[i + 1]);
+			i++;
+		}
+#ifdef HAS_AMAZON_S3
+		else if(!strcmp(argv[i], "--s3endpoint"))
+		{
+			if(!hasValue)
+			{
+				printf("Error: URL must be specified for --s3endpoint option.\r\n");
+				return -1;
+			}
+			s3Endpoint = argv[i + 1];
+			i++;
+		}
+#endif
+		else
+		{
+			sourcePath = argv[i];
+			break;
+		}
+	}
+
+	if(sourcePath.empty())
+	{
+		printf("Error: No executable or disc image specified.\r\n");
+		return -1;
+	}
+
+	if(frameCount == 0)
+	{
+		printf("Error: Frame count must be greater than 0.\r\n");
+		return -1;
+	}
+
+#ifdef HAS_AMAZON_S3
+	//Benchmark has its own config (see AppConfig.cpp), don't keep an endpoint from a previous run
+	CS3ObjectStream::CConfig::GetInstance();
+	CAppConfig::GetInstance().SetPreferenceString(PREF_S3_OBJECTSTREAM_ENDPOINT, s3Endpoint.c_str());
+#endif
+
+	CBenchmarkReport report;
+	report.SetSource(sourcePath.string());
+	report.SetGsHandlerName(gsHandlerName);
+	report.SetWarmupFrameCount(warmupFrameCount);
+
+	try
+	{
+		ExecuteBenchmark(sourcePath, gsHandlerName, frameCount, warmupFrameCount, report);
+	}
+	catch(const std::exception& exception)
+	{
+		printf("Error: Failed to execute benchmark: %s\r\n", exception.what());
+		return -1;
+	}
+
+	auto reportJson = report.ToJson();
+	if(outputPath.empty())
+	{
+		fwrite(reportJson.c_str(), 1, reportJson.size(), stdout);
+	}
+	else
+	{
+		try
+		{
+			auto outputStream = Framework::CreateOutputStdStream(outputPath.native());
+			outputStream.Write(reportJson.c_str(), reportJson.size());
+		}
+		catch(const std::exception& exception)
+		{
+			printf("Error: Failed to write report: %s\r\n", exception.what());
+			return -1;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,109 @@
+#include <vector>
+#include "GsSwizzleTest.h"
+#include "gs/GSHandler.h"
+#include "gs/GsPixelFormats.h"
+#include "gs/GsSwizzle.h"
+
+static uint8 NextRandom(uint32& seed)
+{
+	seed = (seed * 1103515245) + 12345;
+	return static_cast<uint8>(seed >> 16);
+}
+
+//Block row transfers must give the same results as going through the pixel indexor
+template <typename Storage, uint32 pixelBits>
+static void BlockRowTransferTest(uint32 bufPtr, uint32 bufWidth, uint32 x, uint32 y, uint32 blockCount)
+{
+	uint32 seed = bufPtr ^ (x << 8) ^ y;
+	uint32 width = blockCount * Storage::BLOCKWIDTH;
+	uint32 pitch = (width * pixelBits) / 8;
+	uint32 blockStride = (Storage::BLOCKWIDTH * pixelBits) / 8;
+
+	std::vector<uint8> image(pitch * Storage::BLOCKHEIGHT);
+	for(auto& value : image)
+	{
+		value = NextRandom(seed);
+	}
+
+	std::vector<uint8> blockRam(CGSHandler::RAMSIZE);
+	for(auto& value : blockRam)
+	{
+		value = NextRandom(seed);
+	}
+	std::vector<uint8> pixelRam(blockRam);
+
+	CGsPixelFormats::CPixelIndexor<Storage> blockIndexor(blockRam.data(), bufPtr, bufWidth / 64);
+	CGsPixelFormats::CPixelIndexor<Storage> pixelIndexor(pixelRam.data(), bufPtr, bufWidth / 64);
+
+	bool dirty = GsSwizzle::WriteBlockRow(blockIndexor, x, y, width, image.data(), pitch, blockStride);
+	for(uint32 pixelY = 0; pixelY < Storage::BLOCKHEIGHT; pixelY++)
+	{
+		for(uint32 pixelX = 0; pixelX < width; pixelX++)
+		{
+			const uint8* row = image.data() + (pixelY * pitch);
+			typename Storage::Unit pixel = 0;
+			if(pixelBits == 4)
+			{
+				pixel = (row[pixelX / 2] >> ((pixelX & 1) * 4)) & 0x0F;
+			}
+			else
+			{
+				pixel = reinterpret_cast<const typename Storage::Unit*>(row)[pixelX];
+			}
+			pixelIndexor.SetPixel(x + pixelX, y + pixelY, pixel);
+		}
+	}
+
+	TEST_VERIFY(dirty);
+	TEST_VERIFY(blockRam == pixelRam);
+
+	//Writing the same data again doesn't modify anything
+	dirty = GsSwizzle::WriteBlockRow(blockIndexor, x, y, width, image.data(), pitch, blockStride);
+	TEST_VERIFY(!dirty);
+}
+
+template <typename Storage>
+static void BlockRowReadTest(uint32 bufPtr, uint32 bufWidth, uint32 x, uint32 y, uint32 blockCount)
+{
+	uint32 seed = bufPtr ^ (x << 8) ^ y;
+	uint32 width = blockCount * Storage::BLOCKWIDTH;
+	uint32 pitch = width * sizeof(typename Storage::Unit);
+
+	std::vector<uint8> ram(CGSHandler::RAMSIZE);
+	for(auto& value : ram)
+	{
+		value = NextRandom(seed);
+	}
+
+	CGsPixelFormats::CPixelIndexor<Storage> indexor(ram.data(), bufPtr, bufWidth / 64);
+
+	std::vector<uint8> image(pitch * Storage::BLOCKHEIGHT);
+	GsSwizzle::ReadBlockRow(indexor, x, y, width, image.data(), pitch, Storage::BLOCKWIDTH * sizeof(typename Storage::Unit));
+
+	bool matches = true;
+	for(uint32 pixelY = 0; pixelY < Storage::BLOCKHEIGHT; pixelY++)
+	{
+		auto row = reinterpret_cast<const typename Storage::Unit*>(image.data() + (pixelY * pitch));
+		for(uint32 pixelX = 0; pixelX < width; pixelX++)
+		{
+			matches &= (row[pixelX] == indexor.GetPixel(x + pixelX, y + pixelY));
+		}
+	}
+	TEST_VERIFY(matches);
+}
+
+void CGsSwizzleTest::Execute()
+{
+	BlockRowTransferTest<CGsPixelFormats::STORAGEPSMCT32, 32>(0x100000, 640, 0, 0, 80);
+	BlockRowTransferTest<CGsPixelFormats::STORAGEPSMCT32, 32>(0x3FF000, 128, 56, 72, 3);
+	BlockRowTransferTest<CGsPixelFormats::STORAGEPSMCT16, 16>(0x200000, 512, 16, 8, 7);
+	BlockRowTransferTest<CGsPixelFormats::STORAGEPSMCT16S, 16>(0x200000, 512, 48, 40, 5);
+	BlockRowTransferTest<CGsPixelFormats::STORAGEPSMT8, 8>(0x280000, 256, 0, 16, 8);
+	BlockRowTransferTest<CGsPixelFormats::STORAGEPSMT8, 8>(0x280000, 64, 112, 48, 3);
+	BlockRowTransferTest<CGsPixelFormats::STORAGEPSMT4, 4>(0x300000, 256, 0, 0, 8);
+	BlockRowTransferTest<CGsPixelFormats::STORAGEPSMT4, 4>(0x300000, 128, 96, 112, 3);
+
+	BlockRowReadTest<CGsPixelFormats::STORAGEPSMCT32>(0x100000, 640, 8, 24, 10);
+	BlockRowReadTest<CGsPixelFormats::STORAGEPSMCT16>(0x200000, 512, 32, 56, 6);
+	BlockRowReadTest<CGsPixelFormats::STORAGEPSMT8>(0x280000, 256, 16, 32, 5);
+}
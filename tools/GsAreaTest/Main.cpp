@@ -1,5 +1,6 @@
 #include <functional>
 #include "GsCachedAreaTest.h"
+#include "GsSwizzleTest.h"
 #include "GsTransferInvalidationTest.h"
 
 typedef std::function<CTest*()> TestFactoryFunction;
@@ -8,6 +9,7 @@ typedef std::function<CTest*()> TestFactoryFunction;
 static const TestFactoryFunction s_factories[] =
 {
 	[]() { return new CGsCachedAreaTest(); },
+	[]() { return new CGsSwizzleTest(); },
 	[]() { return new CGsTransferInvalidationTest(); }
 };
 // clang-format on
@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include "IdctAccuracyTest.h"
+#include "ee/IPU_Kernels.h"
+
+#define BLOCK_COUNT (10000)
+
+//Random number generator given by the standard
+static int32 NextRandom(int32 low, int32 high, uint32& seed)
+{
+	seed = (seed * 1103515245) + 12345;
+	uint32 value = seed & 0x7FFFFFFE;
+	double scaled = static_cast<double>(value) / 2147483647.0;
+	scaled *= (low + high + 1);
+	return static_cast<int32>(scaled) - low;
+}
+
+static double GetCosine(unsigned int frequency, unsigned int position)
+{
+	double scale = (frequency == 0) ? sqrt(0.125) : 0.5;
+	return scale * cos(static_cast<double>((2 * position) + 1) * frequency * M_PI / 16.0);
+}
+
+static int16 RoundAndClamp(double value, int16 minValue, int16 maxValue)
+{
+	double rounded = floor(value + 0.5);
+	if(rounded < minValue) return minValue;
+	if(rounded > maxValue) return maxValue;
+	return static_cast<int16>(rounded);
+}
+
+static void ForwardDct(const int16* input, int16* output)
+{
+	for(unsigned int v = 0; v < 8; v++)
+	{
+		for(unsigned int u = 0; u < 8; u++)
+		{
+			double sum = 0;
+			for(unsigned int y = 0; y < 8; y++)
+			{
+				for(unsigned int x = 0; x < 8; x++)
+				{
+					sum += GetCosine(u, x) * GetCosine(v, y) * input[(y * 8) + x];
+				}
+			}
+			output[(v * 8) + u] = RoundAndClamp(sum, -2048, 2047);
+		}
+	}
+}
+
+//Double precision IDCT used as the reference by the standard
+static void ReferenceIdct(const int16* input, int16* output)
+{
+	for(unsigned int y = 0; y < 8; y++)
+	{
+		for(unsigned int x = 0; x < 8; x++)
+		{
+			double sum = 0;
+			for(unsigned int v = 0; v < 8; v++)
+			{
+				for(unsigned int u = 0; u < 8; u++)
+				{
+					sum += GetCosine(u, x) * GetCosine(v, y) * input[(v * 8) + u];
+				}
+			}
+			output[(y * 8) + x] = RoundAndClamp(sum, -256, 255);
+		}
+	}
+}
+
+static void AccuracyTest(int32 low, int32 high, int32 sign)
+{
+	uint32 seed = 1;
+	int32 peakErrors[IpuKernels::BLOCK_SIZE] = {};
+	int64 errorSums[IpuKernels::BLOCK_SIZE] = {};
+	int64 squaredErrorSums[IpuKernels::BLOCK_SIZE] = {};
+	for(unsigned int blockIndex = 0; blockIndex < BLOCK_COUNT; blockIndex++)
+	{
+		int16 block[IpuKernels::BLOCK_SIZE];
+		for(unsigned int i = 0; i < IpuKernels::BLOCK_SIZE; i++)
+		{
+			block[i] = static_cast<int16>(NextRandom(low, high, seed) * sign);
+		}
+
+		int16 coefficients[IpuKernels::BLOCK_SIZE];
+		ForwardDct(block, coefficients);
+
+		int16 referenceOutput[IpuKernels::BLOCK_SIZE];
+		int16 kernelOutput[IpuKernels::BLOCK_SIZE];
+		ReferenceIdct(coefficients, referenceOutput);
+		IpuKernels::Idct(coefficients, kernelOutput);
+
+		for(unsigned int i = 0; i < IpuKernels::BLOCK_SIZE; i++)
+		{
+			int32 error = kernelOutput[i] - referenceOutput[i];
+			peakErrors[i] = std::max(peakErrors[i], std::abs(error));
+			errorSums[i] += error;
+			squaredErrorSums[i] += error * error;
+		}
+	}
+
+	int64 totalErrorSum = 0;
+	int64 totalSquaredErrorSum = 0;
+	for(unsigned int i = 0; i < IpuKernels::BLOCK_SIZE; i++)
+	{
+		TEST_VERIFY(peakErrors[i] <= 1);
+		TEST_VERIFY((static_cast<double>(squaredErrorSums[i]) / BLOCK_COUNT) <= 0.06);
+		TEST_VERIFY((std::abs(static_cast<double>(errorSums[i])) / BLOCK_COUNT) <= 0.015);
+		totalErrorSum += errorSums[i];
+		totalSquaredErrorSum += squaredErrorSums[i];
+	}
+	TEST_VERIFY((static_cast<double>(totalSquaredErrorSum) / (BLOCK_COUNT * IpuKernels::BLOCK_SIZE)) <= 0.02);
+	TEST_VERIFY((std::abs(static_cast<double>(totalErrorSum)) / (BLOCK_COUNT * IpuKernels::BLOCK_SIZE)) <= 0.0015);
+}
+
+void CIdctAccuracyTest::Execute()
+{
+	AccuracyTest(256, 255, 1);
+	AccuracyTest(5, 5, 1);
+	AccuracyTest(300, 300, 1);
+	AccuracyTest(256, 255, -1);
+	AccuracyTest(5, 5, -1);
+	AccuracyTest(300, 300, -1);
+
+	//All zero input must give all zero output
+	{
+		int16 coefficients[IpuKernels::BLOCK_SIZE] = {};
+		int16 output[IpuKernels::BLOCK_SIZE];
+		IpuKernels::Idct(coefficients, output);
+		for(unsigned int i = 0; i < IpuKernels::BLOCK_SIZE; i++)
+		{
+			TEST_VERIFY(output[i] == 0);
+		}
+	}
+}
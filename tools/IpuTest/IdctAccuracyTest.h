@@ -0,0 +1,10 @@
+#pragma once
+
+#include "Test.h"
+
+//Checks the IDCT kernel against the accuracy requirements of IEEE Std 1180-1990
+class CIdctAccuracyTest : public CTest
+{
+public:
+	void Execute() override;
+};
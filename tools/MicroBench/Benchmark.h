@@ -0,0 +1,26 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+
+class CBenchmark
+{
+public:
+	typedef std::chrono::high_resolution_clock ClockType;
+
+	virtual ~CBenchmark() = default;
+	virtual void Execute() = 0;
+
+protected:
+	static double GetElapsedMilliseconds(ClockType::time_point startTime)
+	{
+		auto elapsed = ClockType::now() - startTime;
+		return std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(elapsed).count();
+	}
+
+	static void PrintResult(const char* name, const char* unit, double amount, double elapsedMs)
+	{
+		double rate = (elapsedMs != 0) ? (amount / (elapsedMs / 1000.0)) : 0;
+		printf("%-40s %12.3f ms %16.1f %s/s\n", name, elapsedMs, rate, unit);
+	}
+};
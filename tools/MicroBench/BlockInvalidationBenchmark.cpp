@@ -0,0 +1,93 @@
+#include <cstring>
+#include <memory>
+#include <vector>
+#include "BlockInvalidationBenchmark.h"
+#include "MIPS.h"
+#include "MA_MIPSIV.h"
+#include "GenericMipsExecutor.h"
+
+#define RAM_SIZE (0x200000)
+#define BLOCK_SIZE (0x0C)
+#define BLOCK_COUNT (0x4000)
+#define CODE_END (BLOCK_SIZE * BLOCK_COUNT)
+#define ROUND_COUNT (8)
+
+static uint32 MakeJump(uint32 target)
+{
+	return 0x08000000 | ((target >> 2) & 0x03FFFFFF);
+}
+
+static uint32 MakeAddiu(uint32 rt, uint32 rs, uint16 immediate)
+{
+	return 0x24000000 | (rs << 21) | (rt << 16) | immediate;
+}
+
+void CBlockInvalidationBenchmark::Execute()
+{
+	std::vector<uint32> ram(RAM_SIZE / 4);
+
+	CMIPS cpu(MEMORYMAP_ENDIAN_LSBF);
+	CMA_MIPSIV cpuArch(MIPS_REGSIZE_32);
+	auto ramPtr = reinterpret_cast<uint8*>(ram.data());
+	cpu.m_pMemoryMap->InsertReadMap(0, RAM_SIZE - 1, ramPtr, 0x01);
+	cpu.m_pMemoryMap->InsertWriteMap(0, RAM_SIZE - 1, ramPtr, 0x01);
+	cpu.m_pMemoryMap->InsertInstructionMap(0, RAM_SIZE - 1, ramPtr, 0x01);
+	cpu.m_pArch = &cpuArch;
+	cpu.m_pAddrTranslator = &CMIPS::TranslateAddress64;
+	cpu.m_executor = std::make_unique<CGenericMipsExecutor<BlockLookupOneWay>>(cpu, RAM_SIZE);
+	cpu.m_executor->Reset();
+	cpu.Reset();
+
+	//Blocks fall through to their neighbour and jump in a zigzag pattern (first half, second half)
+	//so that links span many pages
+	for(uint32 i = 0; i < BLOCK_COUNT; i++)
+	{
+		uint32 address = i * BLOCK_SIZE;
+		uint32 order = (i < (BLOCK_COUNT / 2)) ? (i * 2) : (((i - (BLOCK_COUNT / 2)) * 2) + 1);
+		uint32 nextOrder = order + 1;
+		uint32 nextAddress = CODE_END;
+		if(nextOrder < BLOCK_COUNT)
+		{
+			uint32 nextIndex = (nextOrder & 1) ? ((nextOrder / 2) + (BLOCK_COUNT / 2)) : (nextOrder / 2);
+			nextAddress = nextIndex * BLOCK_SIZE;
+		}
+		ram[(address / 4) + 0] = MakeAddiu(CMIPS::T0, CMIPS::T0, 1);
+		ram[(address / 4) + 1] = MakeJump(nextAddress);
+		ram[(address / 4) + 2] = 0;
+	}
+	ram[(CODE_END / 4) + 0] = MakeJump(CODE_END);
+	ram[(CODE_END / 4) + 1] = 0;
+
+	double totalPageClearTime = 0;
+	double totalRangeClearTime = 0;
+	for(uint32 round = 0; round < ROUND_COUNT; round++)
+	{
+		//Compile and link all blocks
+		cpu.m_State.nPC = 0;
+		cpu.m_State.nHasException = 0;
+		cpu.m_executor->Execute(BLOCK_COUNT * 4);
+
+		//Invalidate page by page, like the EE does on write faults
+		{
+			auto startTime = ClockType::now();
+			for(uint32 address = 0; address < CODE_END; address += 0x1000)
+			{
+				cpu.m_executor->ClearActiveBlocksInRange(address, address + 0x1000, false);
+			}
+			totalPageClearTime += GetElapsedMilliseconds(startTime);
+		}
+
+		cpu.m_State.nPC = 0;
+		cpu.m_executor->Execute(BLOCK_COUNT * 4);
+
+		//Invalidate a large range in one go, like a DMA transfer overwriting code
+		{
+			auto startTime = ClockType::now();
+			cpu.m_executor->ClearActiveBlocksInRange(0, CODE_END, false);
+			totalRangeClearTime += GetElapsedMilliseconds(startTime);
+		}
+	}
+
+	PrintResult("BlockInvalidation (4KB pages)", "blocks", BLOCK_COUNT * ROUND_COUNT, totalPageClearTime);
+	PrintResult("BlockInvalidation (whole range)", "blocks", BLOCK_COUNT * ROUND_COUNT, totalRangeClearTime);
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "Benchmark.h"
+
+//Measures how fast the executor can clear blocks when code memory is overwritten.
+//Code is made of small blocks jumping to each other so that every block has links.
+class CBlockInvalidationBenchmark : public CBenchmark
+{
+public:
+	void Execute() override;
+};
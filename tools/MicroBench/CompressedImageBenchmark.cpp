@@ -0,0 +1,226 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include "CompressedImageBenchmark.h"
+#include "CsoImageStream.h"
+#include "IszImageStream.h"
+#include "PtrStream.h"
+#include "zlib.h"
+
+#define SECTOR_SIZE (0x800)
+#define IMAGE_SECTOR_COUNT (0x8000)
+#define CSO_FRAME_SIZE (0x800)
+#define ISZ_BLOCK_SIZE (0x10000)
+#define LARGE_READ_SIZE (0x80000)
+#define RANDOM_READ_COUNT (0x2000)
+
+#pragma pack(push, 1)
+struct ISZ_HEADER
+{
+	char signature[4];
+	uint8 headerSize;
+	int8 version;
+	uint32 volumeSerialNumber;
+	uint16 sectorSize;
+	uint32 totalSectors;
+	int8 hasPassword;
+	int64 segmentSize;
+	uint32 blockNumber;
+	uint32 blockSize;
+	uint8 blockPtrLength;
+	int8 segmentNumber;
+	uint32 blockPtrOffset;
+	uint32 segmentPtrOffset;
+	uint32 dataOffset;
+	int8 reserved;
+};
+#pragma pack(pop)
+
+static uint32 s_checksum = 0;
+
+void CCompressedImageBenchmark::Execute()
+{
+	auto image = GenerateImage();
+	auto csoImage = CreateCsoImage(image);
+	auto iszImage = CreateIszImage(image);
+
+	std::unique_ptr<Framework::CStream> csoBaseStream;
+	RunPatterns("CSO",
+	            [&]() {
+		            //CCsoImageStream doesn't own its base stream
+		            csoBaseStream = std::make_unique<Framework::CPtrStream>(csoImage.data(), csoImage.size());
+		            return new CCsoImageStream(csoBaseStream.get());
+	            });
+	RunPatterns("ISZ",
+	            [&]() {
+		            return new CIszImageStream(new Framework::CPtrStream(iszImage.data(), iszImage.size()));
+	            });
+}
+
+CCompressedImageBenchmark::ByteArray CCompressedImageBenchmark::GenerateImage()
+{
+	//Somewhat compressible data, runs of a few repeated values
+	ByteArray image(static_cast<size_t>(IMAGE_SECTOR_COUNT) * SECTOR_SIZE);
+	srand(0);
+	for(size_t i = 0; i < image.size();)
+	{
+		uint8 value = static_cast<uint8>(rand() & 0x0F);
+		size_t runLength = std::min<size_t>(1 + (rand() & 0x07), image.size() - i);
+		memset(image.data() + i, value, runLength);
+		i += runLength;
+	}
+	return image;
+}
+
+CCompressedImageBenchmark::ByteArray CCompressedImageBenchmark::CreateCsoImage(const ByteArray& image)
+{
+	static const uint32 headerSize = 0x18;
+	uint32 frameCount = static_cast<uint32>(image.size() / CSO_FRAME_SIZE);
+
+	ByteArray result(headerSize + ((frameCount + 1) * sizeof(uint32)));
+	memcpy(result.data(), "CISO", 4);
+	uint32 headerSizeValue = headerSize;
+	uint64 totalBytes = image.size();
+	uint32 frameSize = CSO_FRAME_SIZE;
+	memcpy(result.data() + 0x04, &headerSizeValue, 4);
+	memcpy(result.data() + 0x08, &totalBytes, 8);
+	memcpy(result.data() + 0x10, &frameSize, 4);
+
+	std::vector<uint32> index(frameCount + 1);
+	ByteArray compressedFrame(CSO_FRAME_SIZE * 2);
+	for(uint32 frame = 0; frame < frameCount; frame++)
+	{
+		index[frame] = static_cast<uint32>(result.size());
+
+		z_stream z = {};
+		if(deflateInit2(&z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+		{
+			throw std::runtime_error("Failed to initialize zlib.");
+		}
+		z.next_in = const_cast<Bytef*>(image.data() + (frame * CSO_FRAME_SIZE));
+		z.avail_in = CSO_FRAME_SIZE;
+		z.next_out = compressedFrame.data();
+		z.avail_out = static_cast<uInt>(compressedFrame.size());
+		deflate(&z, Z_FINISH);
+		uint32 compressedSize = static_cast<uint32>(z.total_out);
+		deflateEnd(&z);
+
+		if(compressedSize < CSO_FRAME_SIZE)
+		{
+			result.insert(result.end(), compressedFrame.begin(), compressedFrame.begin() + compressedSize);
+		}
+		else
+		{
+			index[frame] |= 0x80000000;
+			result.insert(result.end(), image.begin() + (frame * CSO_FRAME_SIZE), image.begin() + ((frame + 1) * CSO_FRAME_SIZE));
+		}
+	}
+	index[frameCount] = static_cast<uint32>(result.size());
+	memcpy(result.data() + headerSize, index.data(), index.size() * sizeof(uint32));
+	return result;
+}
+
+CCompressedImageBenchmark::ByteArray CCompressedImageBenchmark::CreateIszImage(const ByteArray& image)
+{
+	static const uint32 blockPtrLength = 3;
+	static const uint8 storageTypeZlib = 2;
+	uint32 blockCount = static_cast<uint32>(image.size() / ISZ_BLOCK_SIZE);
+	uint32 blockPtrOffset = sizeof(ISZ_HEADER);
+	uint32 dataOffset = blockPtrOffset + (blockCount * blockPtrLength);
+
+	ByteArray result(dataOffset);
+	ByteArray compressedBlock(compressBound(ISZ_BLOCK_SIZE));
+	for(uint32 block = 0; block < blockCount; block++)
+	{
+		uLongf compressedSize = static_cast<uLongf>(compressedBlock.size());
+		if(compress(compressedBlock.data(), &compressedSize, image.data() + (block * ISZ_BLOCK_SIZE), ISZ_BLOCK_SIZE) != Z_OK)
+		{
+			throw std::runtime_error("Failed to compress ISZ block.");
+		}
+		result.insert(result.end(), compressedBlock.begin(), compressedBlock.begin() + compressedSize);
+
+		//Block descriptors are 22 bits of size and 2 bits of storage type, obfuscated with the key
+		static const char* key = "IsZ!";
+		uint32 descriptor = static_cast<uint32>(compressedSize) | (storageTypeZlib << 22);
+		for(uint32 i = 0; i < blockPtrLength; i++)
+		{
+			uint32 offset = (block * blockPtrLength) + i;
+			result[blockPtrOffset + offset] = static_cast<uint8>(descriptor >> (i * 8)) ^ static_cast<uint8>(~key[offset & 3]);
+		}
+	}
+
+	ISZ_HEADER header = {};
+	memcpy(header.signature, "IsZ!", 4);
+	header.headerSize = sizeof(ISZ_HEADER);
+	header.version = 1;
+	header.sectorSize = SECTOR_SIZE;
+	header.totalSectors = IMAGE_SECTOR_COUNT;
+	header.blockNumber = blockCount;
+	header.blockSize = ISZ_BLOCK_SIZE;
+	header.blockPtrLength = blockPtrLength;
+	header.blockPtrOffset = blockPtrOffset;
+	header.dataOffset = dataOffset;
+	memcpy(result.data(), &header, sizeof(ISZ_HEADER));
+	return result;
+}
+
+void CCompressedImageBenchmark::RunPatterns(const char* name, const StreamFactory& streamFactory)
+{
+	double imageSizeMb = static_cast<double>(IMAGE_SECTOR_COUNT) * SECTOR_SIZE / (1024.0 * 1024.0);
+	double randomSizeMb = static_cast<double>(RANDOM_READ_COUNT) * SECTOR_SIZE / (1024.0 * 1024.0);
+
+	//Each pattern starts with a cold cache
+	double sequentialTime = 0;
+	double largeTime = 0;
+	double randomTime = 0;
+	{
+		std::unique_ptr<Framework::CStream> stream(streamFactory());
+		sequentialTime = ReadSequential(stream.get(), SECTOR_SIZE);
+	}
+	{
+		std::unique_ptr<Framework::CStream> stream(streamFactory());
+		largeTime = ReadSequential(stream.get(), LARGE_READ_SIZE);
+	}
+	{
+		std::unique_ptr<Framework::CStream> stream(streamFactory());
+		randomTime = ReadRandom(stream.get());
+	}
+
+	PrintResult((std::string(name) + " (sequential sectors)").c_str(), "MB", imageSizeMb, sequentialTime);
+	PrintResult((std::string(name) + " (sequential 512KB reads)").c_str(), "MB", imageSizeMb, largeTime);
+	PrintResult((std::string(name) + " (random sectors)").c_str(), "MB", randomSizeMb, randomTime);
+}
+
+double CCompressedImageBenchmark::ReadSequential(Framework::CStream* stream, uint32 readSize)
+{
+	ByteArray buffer(readSize);
+	uint64 imageSize = static_cast<uint64>(IMAGE_SECTOR_COUNT) * SECTOR_SIZE;
+
+	auto startTime = ClockType::now();
+	stream->Seek(0, Framework::STREAM_SEEK_SET);
+	for(uint64 position = 0; position < imageSize; position += readSize)
+	{
+		stream->Read(buffer.data(), readSize);
+		s_checksum += buffer[0];
+	}
+	return GetElapsedMilliseconds(startTime);
+}
+
+double CCompressedImageBenchmark::ReadRandom(Framework::CStream* stream)
+{
+	ByteArray buffer(SECTOR_SIZE);
+	srand(1);
+
+	auto startTime = ClockType::now();
+	for(uint32 i = 0; i < RANDOM_READ_COUNT; i++)
+	{
+		uint32 sector = rand() % IMAGE_SECTOR_COUNT;
+		stream->Seek(static_cast<uint64>(sector) * SECTOR_SIZE, Framework::STREAM_SEEK_SET);
+		stream->Read(buffer.data(), SECTOR_SIZE);
+		s_checksum += buffer[0];
+	}
+	return GetElapsedMilliseconds(startTime);
+}
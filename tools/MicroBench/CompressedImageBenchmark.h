@@ -0,0 +1,28 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+#include "Benchmark.h"
+#include "Types.h"
+#include "Stream.h"
+
+//Measures sector read throughput of CSO and ISZ images generated in memory, with
+//sequential sector reads, large sequential reads (as issued by the disc block cache)
+//and random sector reads.
+class CCompressedImageBenchmark : public CBenchmark
+{
+public:
+	void Execute() override;
+
+private:
+	typedef std::vector<uint8> ByteArray;
+	typedef std::function<Framework::CStream*()> StreamFactory;
+
+	static ByteArray GenerateImage();
+	static ByteArray CreateCsoImage(const ByteArray&);
+	static ByteArray CreateIszImage(const ByteArray&);
+
+	static void RunPatterns(const char*, const StreamFactory&);
+	static double ReadSequential(Framework::CStream*, uint32);
+	static double ReadRandom(Framework::CStream*);
+};
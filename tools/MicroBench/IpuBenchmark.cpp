@@ -0,0 +1,92 @@
+#include <cstring>
+#include <vector>
+#include "IpuBenchmark.h"
+#include "Types.h"
+#include "ee/IPU_Kernels.h"
+#include "idct/IEEE1180.h"
+
+#define MACROBLOCK_COUNT (0x800)
+#define ROUND_COUNT (16)
+#define BLOCKS_PER_MACROBLOCK (6)
+
+static std::vector<int16> GenerateCoefficients()
+{
+	std::vector<int16> coefficients(MACROBLOCK_COUNT * BLOCKS_PER_MACROBLOCK * IpuKernels::BLOCK_SIZE);
+	uint32 seed = 0x12345678;
+	for(uint32 i = 0; i < coefficients.size(); i++)
+	{
+		seed = (seed * 1103515245) + 12345;
+		//Keep most AC coefficients at 0 like real streams do
+		uint32 index = i % IpuKernels::BLOCK_SIZE;
+		if((index == 0) || ((seed >> 28) < 4))
+		{
+			coefficients[i] = static_cast<int16>(static_cast<int32>((seed >> 16) & 0x7F) - 0x40);
+		}
+	}
+	return coefficients;
+}
+
+void CIpuBenchmark::Execute()
+{
+	auto coefficients = GenerateCoefficients();
+	uint8 iq[IpuKernels::BLOCK_SIZE];
+	for(uint32 i = 0; i < IpuKernels::BLOCK_SIZE; i++)
+	{
+		iq[i] = static_cast<uint8>(8 + i);
+	}
+
+	{
+		auto idct = IDCT::CIEEE1180::GetInstance();
+		int16 input[IpuKernels::BLOCK_SIZE];
+		int16 output[IpuKernels::BLOCK_SIZE];
+		auto startTime = ClockType::now();
+		for(uint32 round = 0; round < ROUND_COUNT; round++)
+		{
+			for(uint32 i = 0; i < MACROBLOCK_COUNT * BLOCKS_PER_MACROBLOCK; i++)
+			{
+				memcpy(input, coefficients.data() + (i * IpuKernels::BLOCK_SIZE), sizeof(input));
+				idct->Transform(input, output);
+			}
+		}
+		PrintResult("IPU IDCT (IEEE1180 reference)", "macroblocks", MACROBLOCK_COUNT * ROUND_COUNT, GetElapsedMilliseconds(startTime));
+	}
+
+	{
+		int16 output[IpuKernels::BLOCK_SIZE];
+		auto startTime = ClockType::now();
+		for(uint32 round = 0; round < ROUND_COUNT; round++)
+		{
+			for(uint32 i = 0; i < MACROBLOCK_COUNT * BLOCKS_PER_MACROBLOCK; i++)
+			{
+				IpuKernels::Idct(coefficients.data() + (i * IpuKernels::BLOCK_SIZE), output);
+			}
+		}
+		PrintResult("IPU IDCT (kernel)", "macroblocks", MACROBLOCK_COUNT * ROUND_COUNT, GetElapsedMilliseconds(startTime));
+	}
+
+	{
+		int16 block[IpuKernels::BLOCK_SIZE];
+		int16 macroblock[IpuKernels::MACROBLOCK_SIZE];
+		uint8 raw8[IpuKernels::MACROBLOCK_SIZE];
+		uint32 pixels[IpuKernels::MACROBLOCK_PIXELS];
+		uint32 checksum = 0;
+		auto startTime = ClockType::now();
+		for(uint32 round = 0; round < ROUND_COUNT; round++)
+		{
+			for(uint32 i = 0; i < MACROBLOCK_COUNT; i++)
+			{
+				for(uint32 j = 0; j < BLOCKS_PER_MACROBLOCK; j++)
+				{
+					memcpy(block, coefficients.data() + (((i * BLOCKS_PER_MACROBLOCK) + j) * IpuKernels::BLOCK_SIZE), sizeof(block));
+					IpuKernels::DequantiseBlock(block, true, 8, 8, iq);
+					IpuKernels::Idct(block, macroblock + (j * IpuKernels::BLOCK_SIZE));
+				}
+				IpuKernels::ConvertRaw16ToRaw8(macroblock, raw8, IpuKernels::MACROBLOCK_SIZE);
+				IpuKernels::ConvertMacroblockToRgb32(raw8, pixels, 0, 0);
+				checksum += pixels[i & 0xFF];
+			}
+		}
+		PrintResult("IPU macroblock decode (RGB32)", "macroblocks", MACROBLOCK_COUNT * ROUND_COUNT, GetElapsedMilliseconds(startTime));
+		printf("%-40s %08X\n", "IPU macroblock decode checksum", checksum);
+	}
+}
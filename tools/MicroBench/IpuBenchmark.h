@@ -0,0 +1,12 @@
+#pragma once
+
+#include "Benchmark.h"
+
+//Measures IPU macroblock throughput: the reference IEEE-1180 IDCT against the IDCT kernel,
+//and the complete dequantisation, IDCT, RAW8 and colour space conversion path.
+//Coefficient blocks are synthetic, generated from a fixed seed.
+class CIpuBenchmark : public CBenchmark
+{
+public:
+	void Execute() override;
+};
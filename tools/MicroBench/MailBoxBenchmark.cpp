@@ -0,0 +1,94 @@
+#include <atomic>
+#include <thread>
+#include "MailBoxBenchmark.h"
+#include "MailBox.h"
+
+#define THROUGHPUT_CALL_COUNT (1000000)
+#define LATENCY_CALL_COUNT (20000)
+
+void CMailBoxBenchmark::Execute()
+{
+	ExecuteThroughput("MailBox throughput (locked queue)", false);
+	ExecuteThroughput("MailBox throughput (producer ring)", true);
+	ExecuteLatency("MailBox sync latency (locked queue)", false);
+	ExecuteLatency("MailBox sync latency (producer ring)", true);
+}
+
+void CMailBoxBenchmark::ExecuteThroughput(const char* name, bool useProducerRing)
+{
+	CMailBox mailBox;
+	bool consumerDone = false;
+	uint64 registerSum = 0;
+
+	std::thread consumerThread(
+	    [&]() {
+		    while(!consumerDone)
+		    {
+			    mailBox.WaitForCall();
+			    while(mailBox.IsPending())
+			    {
+				    mailBox.ReceiveCall();
+			    }
+		    }
+	    });
+
+	auto startTime = ClockType::now();
+	std::thread producerThread(
+	    [&]() {
+		    if(useProducerRing)
+		    {
+			    mailBox.SetProducerThread(std::this_thread::get_id());
+		    }
+		    //Same payload as a GS register write (handler, register id and value)
+		    for(uint32 i = 0; i < THROUGHPUT_CALL_COUNT; i++)
+		    {
+			    uint8 registerId = static_cast<uint8>(i);
+			    uint64 value = i;
+			    mailBox.PostCall([&registerSum, registerId, value]() { registerSum += registerId + value; });
+		    }
+		    mailBox.SendCall([&]() { consumerDone = true; }, true);
+	    });
+	producerThread.join();
+	double elapsed = GetElapsedMilliseconds(startTime);
+	consumerThread.join();
+
+	PrintResult(name, "calls", THROUGHPUT_CALL_COUNT, elapsed);
+}
+
+void CMailBoxBenchmark::ExecuteLatency(const char* name, bool useProducerRing)
+{
+	CMailBox mailBox;
+	bool consumerDone = false;
+
+	std::thread consumerThread(
+	    [&]() {
+		    while(!consumerDone)
+		    {
+			    mailBox.WaitForCall();
+			    while(mailBox.IsPending())
+			    {
+				    mailBox.ReceiveCall();
+			    }
+		    }
+	    });
+
+	double elapsed = 0;
+	std::thread producerThread(
+	    [&]() {
+		    if(useProducerRing)
+		    {
+			    mailBox.SetProducerThread(std::this_thread::get_id());
+		    }
+		    auto startTime = ClockType::now();
+		    for(uint32 i = 0; i < LATENCY_CALL_COUNT; i++)
+		    {
+			    mailBox.SendCall([]() {}, true);
+		    }
+		    elapsed = GetElapsedMilliseconds(startTime);
+		    mailBox.SendCall([&]() { consumerDone = true; }, true);
+	    });
+	producerThread.join();
+	consumerThread.join();
+
+	printf("%-40s %12.3f ms %16.3f us/call\n", name, elapsed, (elapsed * 1000.0) / LATENCY_CALL_COUNT);
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "Benchmark.h"
+
+//Compares the locked mailbox queue with the lock-free producer ring, using a
+//consumer thread that loops like the GS thread does.
+class CMailBoxBenchmark : public CBenchmark
+{
+public:
+	void Execute() override;
+
+private:
+	void ExecuteThroughput(const char*, bool);
+	void ExecuteLatency(const char*, bool);
+};
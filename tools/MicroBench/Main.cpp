@@ -0,0 +1,38 @@
+#include <functional>
+#include "BlockInvalidationBenchmark.h"
+#include "CompressedImageBenchmark.h"
+#include "IpuBenchmark.h"
+#include "MailBoxBenchmark.h"
+#include "MemoryAccessBenchmark.h"
+#include "RewindBufferBenchmark.h"
+#include "SifPacketQueueBenchmark.h"
+#include "SpuBenchmark.h"
+#include "VifUnpackBenchmark.h"
+
+typedef std::function<CBenchmark*()> BenchmarkFactoryFunction;
+
+// clang-format off
+static const BenchmarkFactoryFunction s_factories[] =
+{
+	[]() { return new CBlockInvalidationBenchmark(); },
+	[]() { return new CCompressedImageBenchmark(); },
+	[]() { return new CIpuBenchmark(); },
+	[]() { return new CMailBoxBenchmark(); },
+	[]() { return new CMemoryAccessBenchmark(); },
+	[]() { return new CRewindBufferBenchmark(); },
+	[]() { return new CSifPacketQueueBenchmark(); },
+	[]() { return new CSpuBenchmark(); },
+	[]() { return new CVifUnpackBenchmark(); },
+};
+// clang-format on
+
+int main(int argc, const char** argv)
+{
+	for(const auto& factory : s_factories)
+	{
+		auto benchmark = factory();
+		benchmark->Execute();
+		delete benchmark;
+	}
+	return 0;
+}
@@ -0,0 +1,60 @@
+#include <cstring>
+#include <vector>
+#include "MemoryAccessBenchmark.h"
+#include "MIPS.h"
+#include "MemoryUtils.h"
+
+#define RAM_SIZE (0x200000)
+#define RAM_MIRROR_COUNT (4)
+#define ROUND_COUNT (16)
+#define ACCESS_STRIDE (0x1C)
+
+static uint32 s_checksum = 0;
+
+void CMemoryAccessBenchmark::Execute()
+{
+	double mapTime = RunAccesses(false);
+	double pageTableTime = RunAccesses(true);
+
+	double accessCount = static_cast<double>(RAM_SIZE / ACCESS_STRIDE) * RAM_MIRROR_COUNT * 2 * ROUND_COUNT;
+	PrintResult("MemoryAccess (memory map)", "accesses", accessCount, mapTime);
+	PrintResult("MemoryAccess (page table)", "accesses", accessCount, pageTableTime);
+}
+
+double CMemoryAccessBenchmark::RunAccesses(bool usePageTable)
+{
+	std::vector<uint8> ram(RAM_SIZE);
+
+	CMIPS cpu(MEMORYMAP_ENDIAN_LSBF, usePageTable);
+	for(uint32 i = 0; i < RAM_MIRROR_COUNT; i++)
+	{
+		cpu.m_pMemoryMap->InsertReadMap(i * RAM_SIZE, (i * RAM_SIZE) + RAM_SIZE - 1, ram.data(), i + 1);
+		cpu.m_pMemoryMap->InsertWriteMap(i * RAM_SIZE, (i * RAM_SIZE) + RAM_SIZE - 1, ram.data(), i + 1);
+		if(usePageTable)
+		{
+			cpu.MapPages(i * RAM_SIZE, RAM_SIZE, ram.data());
+		}
+	}
+	cpu.m_pAddrTranslator = &CMIPS::TranslateAddress64;
+
+	auto startTime = ClockType::now();
+	uint32 checksum = 0;
+	for(uint32 round = 0; round < ROUND_COUNT; round++)
+	{
+		for(uint32 mirror = 0; mirror < RAM_MIRROR_COUNT; mirror++)
+		{
+			for(uint32 offset = 0; offset < (RAM_SIZE - 4); offset += ACCESS_STRIDE)
+			{
+				uint32 address = (mirror * RAM_SIZE) + (offset & ~0x03);
+				uint32 value = MemoryUtils_GetWordProxy(&cpu, address);
+				MemoryUtils_SetWordProxy(&cpu, value + offset, address);
+				checksum += value;
+			}
+		}
+	}
+	double elapsed = GetElapsedMilliseconds(startTime);
+
+	//Keep the compiler from discarding the loads
+	s_checksum += checksum;
+	return elapsed;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "Benchmark.h"
+
+//Measures memory accesses done through the C++ proxies (LWL/SWL, BIOS and misc.
+//helpers) with and without a page table, using the IOP memory layout.
+class CMemoryAccessBenchmark : public CBenchmark
+{
+public:
+	void Execute() override;
+
+private:
+	static double RunAccesses(bool);
+};
@@ -0,0 +1,102 @@
+#include <cstdlib>
+#include <vector>
+#include "RewindBufferBenchmark.h"
+#include "RewindBuffer.h"
+#include "Ps2Const.h"
+#include "gs/GSHandler.h"
+#include "gs/GsPixelFormats.h"
+
+#define CAPTURE_COUNT (100)
+
+struct REGION_INFO
+{
+	uint32 size;
+	uint32 pageSize;
+	bool tracked;
+	uint32 dirtyPageCount;
+};
+
+//Same layout as the one used by the VM, pages written to per frame are rough estimates
+// clang-format off
+static const REGION_INFO g_regions[] =
+{
+	//EE RAM
+	{PS2::EE_RAM_SIZE, CRewindBuffer::DEFAULT_PAGE_SIZE, true, 256},
+	{PS2::EE_SPR_SIZE, CRewindBuffer::DEFAULT_PAGE_SIZE, false, 4},
+	{PS2::VUMEM0SIZE, CRewindBuffer::DEFAULT_PAGE_SIZE, false, 1},
+	{PS2::MICROMEM0SIZE, CRewindBuffer::DEFAULT_PAGE_SIZE, false, 0},
+	{PS2::VUMEM1SIZE, CRewindBuffer::DEFAULT_PAGE_SIZE, false, 4},
+	{PS2::MICROMEM1SIZE, CRewindBuffer::DEFAULT_PAGE_SIZE, false, 1},
+	//IOP RAM
+	{PS2::IOP_RAM_SIZE, CRewindBuffer::DEFAULT_PAGE_SIZE, false, 32},
+	{PS2::IOP_SCRATCH_SIZE, CRewindBuffer::DEFAULT_PAGE_SIZE, false, 1},
+	//SPU RAM
+	{PS2::SPU_RAM_SIZE, CRewindBuffer::DEFAULT_PAGE_SIZE, true, 16},
+	//GS RAM
+	{CGSHandler::RAMSIZE, CGsPixelFormats::PAGESIZE, true, 64},
+};
+// clang-format on
+
+void CRewindBufferBenchmark::Execute()
+{
+	double comparedTime = RunCaptures(false);
+	double trackedTime = RunCaptures(true);
+
+	PrintResult("RewindBuffer (compare all regions)", "captures", CAPTURE_COUNT, comparedTime);
+	PrintResult("RewindBuffer (EE, SPU and GS RAM tracked)", "captures", CAPTURE_COUNT, trackedTime);
+}
+
+double CRewindBufferBenchmark::RunCaptures(bool trackDirtyPages)
+{
+	static const uint32 regionCount = sizeof(g_regions) / sizeof(g_regions[0]);
+
+	std::vector<std::vector<uint8>> memories(regionCount);
+	std::vector<std::vector<uint32>> dirtyPages(regionCount);
+
+	CRewindBuffer rewindBuffer;
+	for(uint32 regionIndex = 0; regionIndex < regionCount; regionIndex++)
+	{
+		const auto& regionInfo = g_regions[regionIndex];
+		auto& memory = memories[regionIndex];
+		memory.resize(regionInfo.size);
+		if(trackDirtyPages && regionInfo.tracked)
+		{
+			auto regionDirtyPages = &dirtyPages[regionIndex];
+			rewindBuffer.AddRegion(memory.data(), regionInfo.size, regionInfo.pageSize,
+			                       [regionDirtyPages](std::vector<uint32>& pages) {
+				                       pages.insert(pages.end(), regionDirtyPages->begin(), regionDirtyPages->end());
+				                       regionDirtyPages->clear();
+			                       });
+		}
+		else
+		{
+			rewindBuffer.AddRegion(memory.data(), regionInfo.size, regionInfo.pageSize);
+		}
+	}
+	rewindBuffer.Capture(CRewindBuffer::DeviceState());
+
+	srand(0);
+	double elapsed = 0;
+	for(uint32 captureIndex = 0; captureIndex < CAPTURE_COUNT; captureIndex++)
+	{
+		for(uint32 regionIndex = 0; regionIndex < regionCount; regionIndex++)
+		{
+			const auto& regionInfo = g_regions[regionIndex];
+			auto& memory = memories[regionIndex];
+			uint32 pageCount = regionInfo.size / regionInfo.pageSize;
+			for(uint32 i = 0; i < regionInfo.dirtyPageCount; i++)
+			{
+				uint32 pageIndex = rand() % pageCount;
+				uint32 offset = (pageIndex * regionInfo.pageSize) + (rand() % regionInfo.pageSize);
+				memory[offset]++;
+				dirtyPages[regionIndex].push_back(pageIndex);
+			}
+		}
+
+		auto startTime = ClockType::now();
+		rewindBuffer.Capture(CRewindBuffer::DeviceState());
+		elapsed += GetElapsedMilliseconds(startTime);
+	}
+
+	return elapsed;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "Benchmark.h"
+
+//Measures snapshot captures of all the memory regions of the machine, with pages written
+//to between snapshots reported by dirty page trackers or found by comparing everything.
+class CRewindBufferBenchmark : public CBenchmark
+{
+public:
+	void Execute() override;
+
+private:
+	static double RunCaptures(bool);
+};
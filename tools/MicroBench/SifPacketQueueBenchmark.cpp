@@ -0,0 +1,75 @@
+#include <cstring>
+#include <vector>
+#include "SifPacketQueueBenchmark.h"
+#include "ee/SifPacketQueue.h"
+#include "SifDefs.h"
+
+#define BURST_SIZE (256)
+#define ROUND_COUNT (2000)
+
+static uint32 s_checksum = 0;
+
+void CSifPacketQueueBenchmark::Execute()
+{
+	double vectorTime = RunVectorQueue();
+	double ringTime = RunRingQueue();
+
+	double packetCount = static_cast<double>(BURST_SIZE) * ROUND_COUNT;
+	PrintResult("SifPacketQueue (vector)", "packets", packetCount, vectorTime);
+	PrintResult("SifPacketQueue (ring)", "packets", packetCount, ringTime);
+}
+
+double CSifPacketQueueBenchmark::RunVectorQueue()
+{
+	SIFRPCREQUESTEND packet = {};
+	std::vector<uint8> queue;
+
+	auto startTime = ClockType::now();
+	uint32 checksum = 0;
+	for(uint32 round = 0; round < ROUND_COUNT; round++)
+	{
+		for(uint32 i = 0; i < BURST_SIZE; i++)
+		{
+			uint32 size = sizeof(SIFRPCREQUESTEND);
+			packet.rpcId = i;
+			queue.insert(queue.begin(), reinterpret_cast<uint8*>(&packet), reinterpret_cast<uint8*>(&packet) + size);
+			queue.insert(queue.begin(), reinterpret_cast<uint8*>(&size), reinterpret_cast<uint8*>(&size) + 4);
+		}
+		while(!queue.empty())
+		{
+			uint32 size = *reinterpret_cast<uint32*>(&queue[0]);
+			checksum += reinterpret_cast<const SIFRPCREQUESTEND*>(&queue[4])->rpcId;
+			queue.erase(queue.begin(), queue.begin() + 4 + size);
+		}
+	}
+	double elapsed = GetElapsedMilliseconds(startTime);
+
+	s_checksum += checksum;
+	return elapsed;
+}
+
+double CSifPacketQueueBenchmark::RunRingQueue()
+{
+	SIFRPCREQUESTEND packet = {};
+	CSifPacketQueue queue;
+
+	auto startTime = ClockType::now();
+	uint32 checksum = 0;
+	for(uint32 round = 0; round < ROUND_COUNT; round++)
+	{
+		for(uint32 i = 0; i < BURST_SIZE; i++)
+		{
+			packet.rpcId = i;
+			queue.Push(&packet, sizeof(SIFRPCREQUESTEND));
+		}
+		while(!queue.IsEmpty())
+		{
+			checksum += reinterpret_cast<const SIFRPCREQUESTEND*>(queue.GetFrontData())->rpcId;
+			queue.Pop();
+		}
+	}
+	double elapsed = GetElapsedMilliseconds(startTime);
+
+	s_checksum += checksum;
+	return elapsed;
+}
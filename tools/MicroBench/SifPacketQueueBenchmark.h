@@ -0,0 +1,15 @@
+#pragma once
+
+#include "Benchmark.h"
+
+//Measures queuing and dequeuing bursts of SIF command packets, comparing the packet
+//ring with the byte vector queue it replaced.
+class CSifPacketQueueBenchmark : public CBenchmark
+{
+public:
+	void Execute() override;
+
+private:
+	static double RunVectorQueue();
+	static double RunRingQueue();
+};
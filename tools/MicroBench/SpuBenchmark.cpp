@@ -0,0 +1,83 @@
+#include <vector>
+#include "SpuBenchmark.h"
+#include "Types.h"
+#include "iop/Iop_SpuBase.h"
+
+#define SPU_RAM_SIZE (2 * 1024 * 1024)
+#define SOUND_BASE (0x10000)
+#define SOUND_BLOCK_COUNT (0x100)
+#define REVERB_WORK_START (0x100000)
+#define REVERB_WORK_END (0x140000)
+#define SAMPLE_RATE (44100)
+#define FRAME_SAMPLES ((SAMPLE_RATE / 60) * 2)
+#define FRAME_COUNT (600)
+
+static void GenerateSound(uint8* ram)
+{
+	uint32 seed = 0x12345678;
+	for(uint32 i = 0; i < SOUND_BLOCK_COUNT; i++)
+	{
+		uint8* block = ram + SOUND_BASE + (i * 0x10);
+		seed = (seed * 1103515245) + 12345;
+		block[0] = static_cast<uint8>((((seed >> 16) % 5) << 4) | ((seed >> 24) % 12));
+		//Loop start on the first block, loop end on the last one
+		block[1] = (i == 0) ? 0x04 : ((i == (SOUND_BLOCK_COUNT - 1)) ? 0x03 : 0x00);
+		for(uint32 j = 2; j < 0x10; j++)
+		{
+			seed = (seed * 1103515245) + 12345;
+			block[j] = static_cast<uint8>(seed >> 16);
+		}
+	}
+}
+
+static void SetupVoices(Iop::CSpuBase& spu, bool reverb)
+{
+	spu.SetBaseSamplingRate(48000);
+	spu.SetControl(0x8000 | (reverb ? Iop::CSpuBase::CONTROL_REVERB : 0));
+	spu.SetReverbWorkAddressStart(REVERB_WORK_START);
+	spu.SetReverbWorkAddressEnd(REVERB_WORK_END);
+	for(uint32 i = 0; i < Iop::CSpuBase::REVERB_PARAM_COUNT; i++)
+	{
+		spu.SetReverbParam(i, Iop::CSpuBase::g_reverbParamIsAddress[i] ? ((i + 1) * 0x400) : 0x3000);
+	}
+	spu.SetChannelReverbLo(0xFFFF);
+	spu.SetChannelReverbHi(0xFF);
+	for(uint32 i = 0; i < Iop::CSpuBase::MAX_CHANNEL; i++)
+	{
+		auto& channel = spu.GetChannel(i);
+		channel.address = SOUND_BASE;
+		channel.repeat = SOUND_BASE;
+		channel.pitch = static_cast<uint16>(0x800 + (i * 0x100));
+		channel.adsrLevel <<= 0x10FF;
+		channel.adsrRate <<= 0x1FC0;
+		channel.volumeLeft <<= 0x1000 + (i * 0x80);
+		channel.volumeRight <<= 0x2000 - (i * 0x80);
+	}
+	spu.SendKeyOn((1 << Iop::CSpuBase::MAX_CHANNEL) - 1);
+}
+
+void CSpuBenchmark::RunBenchmark(const char* name, bool reverb)
+{
+	std::vector<uint8> ram(SPU_RAM_SIZE);
+	GenerateSound(ram.data());
+
+	Iop::CSpuBase spu(ram.data(), SPU_RAM_SIZE, 0);
+	SetupVoices(spu, reverb);
+
+	int16 samples[FRAME_SAMPLES];
+	uint32 checksum = 0;
+	auto startTime = ClockType::now();
+	for(uint32 i = 0; i < FRAME_COUNT; i++)
+	{
+		spu.Render(samples, FRAME_SAMPLES, SAMPLE_RATE);
+		checksum += static_cast<uint16>(samples[i % FRAME_SAMPLES]);
+	}
+	PrintResult(name, "frames", FRAME_COUNT, GetElapsedMilliseconds(startTime));
+	printf("%-40s %08X\n", "SPU mixing checksum", checksum);
+}
+
+void CSpuBenchmark::Execute()
+{
+	RunBenchmark("SPU mixing (24 voices)", false);
+	RunBenchmark("SPU mixing (24 voices, reverb)", true);
+}
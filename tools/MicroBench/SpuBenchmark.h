@@ -0,0 +1,15 @@
+#pragma once
+
+#include "Benchmark.h"
+
+//Measures SPU mixing throughput with all 24 voices of a core playing looped ADPCM
+//sounds at various pitches, with and without reverb. Sound data is synthetic, generated
+//from a fixed seed.
+class CSpuBenchmark : public CBenchmark
+{
+public:
+	void Execute() override;
+
+private:
+	static void RunBenchmark(const char*, bool);
+};
@@ -0,0 +1,123 @@
+#include <cassert>
+#include <cstring>
+#include "VifUnpackBenchmark.h"
+#include "Ps2Const.h"
+#include "MIPS.h"
+#include "AlignedAlloc.h"
+#include "ee/DMAC.h"
+#include "ee/GIF.h"
+#include "ee/INTC.h"
+#include "ee/Vif.h"
+#include "ee/Vpu.h"
+#include "ee/VifUnpack.h"
+
+#define STREAM_SIZE (0x100000)
+#define UNPACK_NUM (0x100)
+#define ROUND_COUNT (32)
+
+static void WriteCode(std::vector<uint8>& stream, uint32& position, uint32 cmd, uint32 num, uint32 imm)
+{
+	uint32 code = (cmd << 24) | (num << 16) | imm;
+	memcpy(stream.data() + position, &code, 4);
+	position += 4;
+}
+
+uint32 CVifUnpackBenchmark::BuildStream(std::vector<uint8>& stream, const UNPACKTEST& test, uint32& elementCount)
+{
+	uint32 elementSize = VifUnpack::GetElementSize(test.format);
+	uint32 readCount = (test.cl >= test.wl) ? UNPACK_NUM : (UNPACK_NUM / test.wl) * test.cl;
+	uint32 dataSize = (readCount * elementSize + 3) & ~3;
+	uint32 packetSize = 4 + (test.useMask ? 8 : 0) + 4 + dataSize;
+
+	uint32 position = 0;
+	elementCount = 0;
+	uint32 seed = 0x12345678;
+	while((position + packetSize) <= (STREAM_SIZE - 0x10))
+	{
+		WriteCode(stream, position, 0x01, 0, test.cl | (test.wl << 8));
+		if(test.useMask)
+		{
+			//Row, column, data and write protect fields
+			uint32 mask = 0x1B1B1B1B;
+			WriteCode(stream, position, 0x20, 0, 0);
+			memcpy(stream.data() + position, &mask, 4);
+			position += 4;
+		}
+		WriteCode(stream, position, 0x60 | (test.useMask ? 0x10 : 0) | test.format, UNPACK_NUM & 0xFF, 0);
+		for(uint32 i = 0; i < dataSize; i++)
+		{
+			seed = (seed * 1103515245) + 12345;
+			stream[position + i] = static_cast<uint8>(seed >> 16);
+		}
+		position += dataSize;
+		elementCount += UNPACK_NUM;
+	}
+
+	//Pad with NOPs up to a qword boundary
+	while(position & 0x0F)
+	{
+		WriteCode(stream, position, 0x00, 0, 0);
+	}
+
+	return position / 0x10;
+}
+
+void CVifUnpackBenchmark::Execute()
+{
+	// clang-format off
+	static const UNPACKTEST tests[] =
+	{
+		{ "VIF UNPACK V4-32",                  VifUnpack::FORMAT_V4_32, false, 4, 4 },
+		{ "VIF UNPACK V3-32",                  VifUnpack::FORMAT_V3_32, false, 4, 4 },
+		{ "VIF UNPACK V2-16",                  VifUnpack::FORMAT_V2_16, false, 4, 4 },
+		{ "VIF UNPACK V4-8",                   VifUnpack::FORMAT_V4_8,  false, 4, 4 },
+		{ "VIF UNPACK S-32",                   VifUnpack::FORMAT_S32,   false, 4, 4 },
+		{ "VIF UNPACK V4-16 (masked)",         VifUnpack::FORMAT_V4_16, true,  4, 4 },
+		{ "VIF UNPACK V3-32 (skipping)",       VifUnpack::FORMAT_V3_32, false, 4, 2 },
+		{ "VIF UNPACK V4-8 (filling)",         VifUnpack::FORMAT_V4_8,  false, 2, 4 },
+	};
+	// clang-format on
+
+	auto ram = static_cast<uint8*>(framework_aligned_alloc(PS2::EE_RAM_SIZE, 0x10));
+	auto spr = static_cast<uint8*>(framework_aligned_alloc(PS2::EE_SPR_SIZE, 0x10));
+	auto vuMem0 = static_cast<uint8*>(framework_aligned_alloc(PS2::VUMEM0SIZE, 0x10));
+	auto microMem0 = static_cast<uint8*>(framework_aligned_alloc(PS2::MICROMEM0SIZE, 0x10));
+	memset(ram, 0, PS2::EE_RAM_SIZE);
+	memset(vuMem0, 0, PS2::VUMEM0SIZE);
+
+	{
+		CMIPS ee(MEMORYMAP_ENDIAN_LSBF);
+		CMIPS vu0(MEMORYMAP_ENDIAN_LSBF);
+		CGSHandler* gs = nullptr;
+		CDMAC dmac(ram, spr, vuMem0, ee);
+		CGIF gif(gs, ram, spr);
+		CINTC intc(dmac);
+		CVpu vpu(0, CVpu::VPUINIT(microMem0, vuMem0, &vu0), gif, intc, ram, spr);
+		auto& vif = vpu.GetVif();
+
+		std::vector<uint8> stream(STREAM_SIZE);
+		for(const auto& test : tests)
+		{
+			uint32 elementCount = 0;
+			uint32 qwc = BuildStream(stream, test, elementCount);
+			memcpy(ram, stream.data(), qwc * 0x10);
+
+			vif.Reset();
+			auto startTime = ClockType::now();
+			for(uint32 round = 0; round < ROUND_COUNT; round++)
+			{
+				uint32 processed = vif.ReceiveDMA(0, qwc, 0, false);
+				assert(processed == qwc);
+				(void)processed;
+			}
+			double elapsed = GetElapsedMilliseconds(startTime);
+
+			PrintResult(test.name, "qwords", static_cast<double>(elementCount) * ROUND_COUNT, elapsed);
+		}
+	}
+
+	framework_aligned_free(microMem0);
+	framework_aligned_free(vuMem0);
+	framework_aligned_free(spr);
+	framework_aligned_free(ram);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <vector>
+#include "Benchmark.h"
+#include "Types.h"
+
+//Measures VIF UNPACK throughput for common formats, with and without the write mask.
+//Streams are made of STCYCL/STMASK/UNPACK packets sent to VIF0 through ReceiveDMA.
+class CVifUnpackBenchmark : public CBenchmark
+{
+public:
+	void Execute() override;
+
+private:
+	struct UNPACKTEST
+	{
+		const char* name;
+		uint32 format;
+		bool useMask;
+		uint32 cl;
+		uint32 wl;
+	};
+
+	uint32 BuildStream(std::vector<uint8>&, const UNPACKTEST&, uint32&);
+};
@@ -0,0 +1,282 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <signal.h>
+#include "AppConfig.h"
+#include "PathUtils.h"
+#include "StdStreamUtils.h"
+#include "s3stream/S3ChunkCache.h"
+#include "s3stream/S3ObjectStream.h"
+#include "S3StubServer.h"
+
+#define CHECK(condition)                                               \
+	if(!(condition))                                                   \
+	{                                                                  \
+		throw std::runtime_error("Check failed: '" #condition "'."); \
+	}
+
+#define BUCKET_NAME "play"
+#define OBJECT_NAME "image.iso"
+
+//Not a multiple of the chunk size to have a partial chunk at the end
+#define OBJECT_SIZE (0x2000000 + 0x1800)
+#define SECTOR_SIZE 0x800
+#define RANDOM_READ_COUNT 500
+#define DEFAULT_LATENCY_MS 20
+
+typedef std::chrono::steady_clock ClockType;
+
+static double GetElapsedMilliseconds(ClockType::time_point startTime)
+{
+	return std::chrono::duration<double, std::milli>(ClockType::now() - startTime).count();
+}
+
+static std::vector<uint8> GenerateObjectData(uint64 size)
+{
+	std::vector<uint8> result(size);
+	uint32 state = 0x12345678;
+	for(auto& value : result)
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		value = static_cast<uint8>(state);
+	}
+	return result;
+}
+
+static std::vector<uint8> MakeChunk(uint32 size, uint8 seed)
+{
+	std::vector<uint8> result(size);
+	for(uint32 i = 0; i < size; i++)
+	{
+		result[i] = static_cast<uint8>(seed + i);
+	}
+	return result;
+}
+
+static bool IsChunkCached(CS3ChunkCache& cache, const std::string& key, uint64 chunkIndex, uint32 size, uint8 seed)
+{
+	std::vector<uint8> data(size);
+	if(!cache.Read(key, chunkIndex, data.data(), size)) return false;
+	CHECK(data == MakeChunk(size, seed));
+	return true;
+}
+
+static void TestChunkCache(const fs::path& cachePath)
+{
+	static const uint32 chunkSize = 0x1000;
+	static const uint32 chunkCount = 4;
+
+	fs::remove(cachePath);
+
+	//Least recently used chunk goes first
+	{
+		CS3ChunkCache cache(cachePath, chunkSize, chunkSize * chunkCount);
+		CHECK(cache.IsOpen());
+		for(uint32 i = 0; i < chunkCount; i++)
+		{
+			auto chunk = MakeChunk(chunkSize, i);
+			cache.Write("a", i, chunk.data(), chunkSize);
+		}
+		CHECK(IsChunkCached(cache, "a", 0, chunkSize, 0));
+		auto chunk = MakeChunk(chunkSize - 0x10, 4);
+		cache.Write("a", 4, chunk.data(), chunkSize - 0x10);
+		CHECK(!IsChunkCached(cache, "a", 1, chunkSize, 1));
+		CHECK(IsChunkCached(cache, "a", 0, chunkSize, 0));
+		CHECK(IsChunkCached(cache, "a", 2, chunkSize, 2));
+		CHECK(IsChunkCached(cache, "a", 3, chunkSize, 3));
+		CHECK(IsChunkCached(cache, "a", 4, chunkSize - 0x10, 4));
+		CHECK(!IsChunkCached(cache, "a", 4, chunkSize, 4));
+		CHECK(!IsChunkCached(cache, "b", 0, chunkSize, 0));
+	}
+
+	//Chunks and their use order survive reopening the cache
+	{
+		CS3ChunkCache cache(cachePath, chunkSize, chunkSize * chunkCount);
+		CHECK(cache.IsOpen());
+		auto chunk = MakeChunk(chunkSize, 5);
+		cache.Write("b", 0, chunk.data(), chunkSize);
+		CHECK(!IsChunkCached(cache, "a", 0, chunkSize, 0));
+		CHECK(IsChunkCached(cache, "a", 2, chunkSize, 2));
+		CHECK(IsChunkCached(cache, "a", 3, chunkSize, 3));
+		CHECK(IsChunkCached(cache, "a", 4, chunkSize - 0x10, 4));
+		CHECK(IsChunkCached(cache, "b", 0, chunkSize, 5));
+	}
+
+	//Damaged chunks are not returned
+	{
+		auto fileSize = fs::file_size(cachePath);
+		auto garbage = MakeChunk(chunkSize * chunkCount, 0xAA);
+		auto stream = Framework::CreateUpdateExistingStdStream(cachePath.native());
+		stream.Seek(fileSize - garbage.size(), Framework::STREAM_SEEK_SET);
+		stream.Write(garbage.data(), garbage.size());
+	}
+	{
+		CS3ChunkCache cache(cachePath, chunkSize, chunkSize * chunkCount);
+		CHECK(cache.IsOpen());
+		CHECK(!IsChunkCached(cache, "a", 2, chunkSize, 2));
+		CHECK(!IsChunkCached(cache, "b", 0, chunkSize, 5));
+		auto chunk = MakeChunk(chunkSize, 6);
+		cache.Write("a", 2, chunk.data(), chunkSize);
+		CHECK(IsChunkCached(cache, "a", 2, chunkSize, 6));
+	}
+
+	//Changing the layout starts over
+	{
+		CS3ChunkCache cache(cachePath, chunkSize * 2, chunkSize * chunkCount);
+		CHECK(cache.IsOpen());
+		CHECK(!IsChunkCached(cache, "a", 2, chunkSize, 6));
+	}
+
+	fs::remove(cachePath);
+}
+
+static void TestObjectStream(CS3StubServer& server, const std::vector<uint8>& objectData)
+{
+	server.ResetStats();
+
+	uint64 chunkCount = (objectData.size() + CS3ObjectStream::CHUNK_SIZE - 1) / CS3ObjectStream::CHUNK_SIZE;
+	std::vector<uint8> buffer(0x10000);
+
+	//Sequential reads, like loading a game
+	{
+		auto startTime = ClockType::now();
+		CS3ObjectStream stream(BUCKET_NAME, OBJECT_NAME);
+		CHECK(stream.GetLength() == objectData.size());
+
+		double firstReadTime = 0;
+		uint64 position = 0;
+		while(!stream.IsEOF())
+		{
+			uint64 expectedSize = std::min<uint64>(SECTOR_SIZE, objectData.size() - position);
+			CHECK(stream.Read(buffer.data(), SECTOR_SIZE) == expectedSize);
+			CHECK(!memcmp(buffer.data(), objectData.data() + position, expectedSize));
+			if(position == 0)
+			{
+				firstReadTime = GetElapsedMilliseconds(startTime);
+			}
+			position += expectedSize;
+		}
+		CHECK(position == objectData.size());
+		CHECK(stream.Read(buffer.data(), SECTOR_SIZE) == 0);
+
+		double totalTime = GetElapsedMilliseconds(startTime);
+		printf("Sequential reads: first sector after %.1fms, %.2fMB/s, %u requests (%u concurrent).\r\n",
+		       firstReadTime, static_cast<double>(objectData.size()) / (totalTime * 1000.0),
+		       server.GetGetRequestCount(), server.GetMaxConcurrentRequestCount());
+
+		//Every chunk is fetched once, some at the same time
+		CHECK(server.GetGetRequestCount() == chunkCount);
+		CHECK(server.GetMaxConcurrentRequestCount() > 1);
+	}
+
+	server.ResetStats();
+
+	//Random reads, prefetching shouldn't get in the way
+	{
+		std::mt19937 randomGenerator(1234);
+		auto startTime = ClockType::now();
+		CS3ObjectStream stream(BUCKET_NAME, OBJECT_NAME);
+		for(uint32 i = 0; i < RANDOM_READ_COUNT; i++)
+		{
+			uint64 position = randomGenerator() % objectData.size();
+			uint64 size = randomGenerator() % buffer.size();
+			uint64 expectedSize = std::min<uint64>(size, objectData.size() - position);
+			stream.Seek(position, Framework::STREAM_SEEK_SET);
+			CHECK(stream.Read(buffer.data(), size) == expectedSize);
+			CHECK(!memcmp(buffer.data(), objectData.data() + position, expectedSize));
+		}
+
+		double totalTime = GetElapsedMilliseconds(startTime);
+		printf("Random reads: %.2fms per read, %u requests (%u concurrent).\r\n",
+		       totalTime / RANDOM_READ_COUNT, server.GetGetRequestCount(), server.GetMaxConcurrentRequestCount());
+	}
+}
+
+static void ConfigureObjectStream(const std::string& endpoint, int cacheSize)
+{
+	//Makes sure preferences are registered before changing them
+	CS3ObjectStream::CConfig::GetInstance();
+	CAppConfig::GetInstance().SetPreferenceString(PREF_S3_OBJECTSTREAM_ENDPOINT, endpoint.c_str());
+	CAppConfig::GetInstance().SetPreferenceInteger(PREF_S3_OBJECTSTREAM_CACHESIZE, cacheSize);
+	if(CS3ObjectStream::CConfig::GetInstance().GetAccessKeyId().empty())
+	{
+		//Stub server doesn't check signatures, but the client needs something to sign with
+		CAppConfig::GetInstance().SetPreferenceString(PREF_S3_OBJECTSTREAM_ACCESSKEYID, "stub");
+		CAppConfig::GetInstance().SetPreferenceString(PREF_S3_OBJECTSTREAM_SECRETACCESSKEY, "stub");
+	}
+}
+
+static int ServeFile(const fs::path& path, uint16 port, uint32 latencyMs)
+{
+	auto inputStream = Framework::CreateInputStdStream(path.native());
+	std::vector<uint8> data(inputStream.GetLength());
+	inputStream.Read(data.data(), data.size());
+
+	auto objectName = path.filename().string();
+	CS3StubServer server(BUCKET_NAME, objectName, std::move(data), latencyMs, port);
+	printf("Serving '%s' at '%s' (%ums latency).\r\n", path.string().c_str(), server.GetEndpoint().c_str(), latencyMs);
+	printf("Disc image path: '//s3/%s/%s'.\r\n", BUCKET_NAME, objectName.c_str());
+	printf("Example: Benchmark --s3endpoint %s //s3/%s/%s\r\n", server.GetEndpoint().c_str(), BUCKET_NAME, objectName.c_str());
+	printf("Press enter to stop.\r\n");
+	getchar();
+	return 0;
+}
+
+int main(int argc, const char** argv)
+{
+	signal(SIGPIPE, SIG_IGN);
+
+	uint32 latencyMs = DEFAULT_LATENCY_MS;
+	uint16 port = 0;
+	fs::path servePath;
+	for(int i = 1; i < argc; i++)
+	{
+		bool hasValue = (i + 1) < argc;
+		if(!strcmp(argv[i], "--serve") && hasValue)
+		{
+			servePath = argv[++i];
+		}
+		else if(!strcmp(argv[i], "--port") && hasValue)
+		{
+			port = static_cast<uint16>(atoi(argv[++i]));
+		}
+		else if(!strcmp(argv[i], "--latency") && hasValue)
+		{
+			latencyMs = atoi(argv[++i]);
+		}
+		else
+		{
+			printf("Usage: S3StreamTest [--serve <path>] [--port <port>] [--latency <ms>]\r\n");
+			return -1;
+		}
+	}
+
+	try
+	{
+		if(!servePath.empty())
+		{
+			return ServeFile(servePath, port, latencyMs);
+		}
+
+		auto basePath = CAppConfig::GetBasePath();
+		Framework::PathUtils::EnsurePathExists(basePath);
+		TestChunkCache(basePath / "chunks.dat");
+
+		auto objectData = GenerateObjectData(OBJECT_SIZE);
+		CS3StubServer server(BUCKET_NAME, OBJECT_NAME, objectData, latencyMs, port);
+
+		//Disk cache is shared with the emulator, leave it alone
+		ConfigureObjectStream(server.GetEndpoint(), 0);
+		TestObjectStream(server, objectData);
+	}
+	catch(const std::exception& exception)
+	{
+		printf("Failed: %s\r\n", exception.what());
+		return -1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,266 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <zlib.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include "S3StubServer.h"
+#include "string_format.h"
+
+#ifndef MSG_NOSIGNAL
+//Callers are expected to ignore SIGPIPE on platforms without this flag
+#define MSG_NOSIGNAL 0
+#endif
+
+CS3StubServer::CS3StubServer(std::string bucketName, std::string objectName, std::vector<uint8> objectData, uint32 latencyMs, uint16 port)
+    : m_bucketName(std::move(bucketName))
+    , m_objectName(std::move(objectName))
+    , m_objectData(std::move(objectData))
+    , m_latencyMs(latencyMs)
+    , m_getRequestCount(0)
+    , m_concurrentRequestCount(0)
+    , m_maxConcurrentRequestCount(0)
+{
+	m_objectEtag = string_format("\"%08x\"", static_cast<uint32>(crc32(0, m_objectData.data(), static_cast<uInt>(m_objectData.size()))));
+
+	m_serverSocket = socket(AF_INET, SOCK_STREAM, 0);
+	if(m_serverSocket < 0)
+	{
+		throw std::runtime_error("Failed to create server socket.");
+	}
+
+	int reuseAddress = 1;
+	setsockopt(m_serverSocket, SOL_SOCKET, SO_REUSEADDR, &reuseAddress, sizeof(reuseAddress));
+
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = htons(port);
+	if(
+	    (bind(m_serverSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) ||
+	    (listen(m_serverSocket, SOMAXCONN) < 0))
+	{
+		close(m_serverSocket);
+		throw std::runtime_error("Failed to bind server socket.");
+	}
+
+	socklen_t addressSize = sizeof(address);
+	getsockname(m_serverSocket, reinterpret_cast<sockaddr*>(&address), &addressSize);
+	m_port = ntohs(address.sin_port);
+
+	m_serverThread = std::thread([this]() { ServerThreadProc(); });
+}
+
+CS3StubServer::~CS3StubServer()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_connectionsMutex);
+		m_stopping = true;
+		for(auto connectionSocket : m_connectionSockets)
+		{
+			shutdown(connectionSocket, SHUT_RDWR);
+		}
+	}
+	shutdown(m_serverSocket, SHUT_RDWR);
+	close(m_serverSocket);
+	m_serverThread.join();
+	for(auto& connectionThread : m_connectionThreads)
+	{
+		connectionThread.join();
+	}
+}
+
+std::string CS3StubServer::GetEndpoint() const
+{
+	return string_format("http://127.0.0.1:%d", m_port);
+}
+
+std::string CS3StubServer::GetEtag() const
+{
+	return m_objectEtag;
+}
+
+uint32 CS3StubServer::GetGetRequestCount() const
+{
+	return m_getRequestCount;
+}
+
+uint32 CS3StubServer::GetMaxConcurrentRequestCount() const
+{
+	return m_maxConcurrentRequestCount;
+}
+
+void CS3StubServer::ResetStats()
+{
+	m_getRequestCount = 0;
+	m_maxConcurrentRequestCount = 0;
+}
+
+void CS3StubServer::ServerThreadProc()
+{
+	while(1)
+	{
+		int connectionSocket = accept(m_serverSocket, nullptr, nullptr);
+		if(connectionSocket < 0) break;
+
+		std::lock_guard<std::mutex> lock(m_connectionsMutex);
+		if(m_stopping)
+		{
+			close(connectionSocket);
+			break;
+		}
+		m_connectionSockets.push_back(connectionSocket);
+		m_connectionThreads.emplace_back([this, connectionSocket]() { ConnectionThreadProc(connectionSocket); });
+	}
+}
+
+void CS3StubServer::ConnectionThreadProc(int connectionSocket)
+{
+	std::string pendingData;
+	REQUEST request;
+	while(ReceiveRequest(connectionSocket, pendingData, request))
+	{
+		uint32 concurrentRequestCount = ++m_concurrentRequestCount;
+		uint32 maxConcurrentRequestCount = m_maxConcurrentRequestCount;
+		while(
+		    (concurrentRequestCount > maxConcurrentRequestCount) &&
+		    !m_maxConcurrentRequestCount.compare_exchange_weak(maxConcurrentRequestCount, concurrentRequestCount))
+		{
+		}
+		if(request.method == "GET")
+		{
+			m_getRequestCount++;
+		}
+		if(m_latencyMs != 0)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(m_latencyMs));
+		}
+		SendResponse(connectionSocket, request);
+		m_concurrentRequestCount--;
+		if(!request.keepAlive) break;
+	}
+
+	std::lock_guard<std::mutex> lock(m_connectionsMutex);
+	m_connectionSockets.remove(connectionSocket);
+	close(connectionSocket);
+}
+
+bool CS3StubServer::ReceiveRequest(int connectionSocket, std::string& pendingData, REQUEST& request)
+{
+	//Requests from the client have no body, everything ends with the headers
+	size_t headerEnd = std::string::npos;
+	while((headerEnd = pendingData.find("\r\n\r\n")) == std::string::npos)
+	{
+		char buffer[0x1000];
+		auto received = recv(connectionSocket, buffer, sizeof(buffer), 0);
+		if(received <= 0) return false;
+		pendingData.append(buffer, received);
+	}
+
+	auto header = pendingData.substr(0, headerEnd);
+	pendingData.erase(0, headerEnd + 4);
+
+	request = REQUEST();
+	size_t lineBegin = 0;
+	bool firstLine = true;
+	while(lineBegin <= header.size())
+	{
+		size_t lineEnd = header.find("\r\n", lineBegin);
+		if(lineEnd == std::string::npos) lineEnd = header.size();
+		auto line = header.substr(lineBegin, lineEnd - lineBegin);
+		lineBegin = lineEnd + 2;
+		if(firstLine)
+		{
+			auto methodEnd = line.find(' ');
+			auto uriEnd = line.find(' ', methodEnd + 1);
+			if((methodEnd == std::string::npos) || (uriEnd == std::string::npos)) return false;
+			request.method = line.substr(0, methodEnd);
+			request.uri = line.substr(methodEnd + 1, uriEnd - methodEnd - 1);
+			firstLine = false;
+			continue;
+		}
+		auto separator = line.find(':');
+		if(separator == std::string::npos) continue;
+		auto name = line.substr(0, separator);
+		std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+		auto valueBegin = line.find_first_not_of(' ', separator + 1);
+		auto value = (valueBegin == std::string::npos) ? std::string() : line.substr(valueBegin);
+		if(name == "range")
+		{
+			request.range = value;
+		}
+		else if(name == "connection")
+		{
+			std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+			request.keepAlive = (value != "close");
+		}
+	}
+	return true;
+}
+
+void CS3StubServer::SendResponse(int connectionSocket, const REQUEST& request)
+{
+	std::string header;
+	const uint8* body = nullptr;
+	uint64 bodySize = 0;
+
+	auto objectUri = "/" + m_bucketName + "/" + m_objectName;
+	if((request.uri != objectUri) || ((request.method != "GET") && (request.method != "HEAD")))
+	{
+		header = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n";
+	}
+	else if((request.method == "GET") && !request.range.empty())
+	{
+		unsigned long long first = 0;
+		unsigned long long last = 0;
+		bool validRange = (sscanf(request.range.c_str(), "bytes=%llu-%llu", &first, &last) == 2) &&
+		                  (first <= last) && (first < m_objectData.size());
+		if(!validRange)
+		{
+			header = "HTTP/1.1 416 Range Not Satisfiable\r\nContent-Length: 0\r\n";
+		}
+		else
+		{
+			last = std::min<unsigned long long>(last, m_objectData.size() - 1);
+			body = m_objectData.data() + first;
+			bodySize = last - first + 1;
+			header = string_format("HTTP/1.1 206 Partial Content\r\nContent-Length: %llu\r\nContent-Range: bytes %llu-%llu/%llu\r\nETag: %s\r\n",
+			                       bodySize, first, last, static_cast<uint64>(m_objectData.size()), m_objectEtag.c_str());
+		}
+	}
+	else
+	{
+		//HEAD reports the length of the body GET would return
+		if(request.method == "GET")
+		{
+			body = m_objectData.data();
+			bodySize = m_objectData.size();
+		}
+		header = string_format("HTTP/1.1 200 OK\r\nContent-Length: %llu\r\nETag: %s\r\n",
+		                       static_cast<uint64>(m_objectData.size()), m_objectEtag.c_str());
+	}
+	header += request.keepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+
+	auto sendAll =
+	    [connectionSocket](const void* data, uint64 size) {
+		    auto bytes = reinterpret_cast<const char*>(data);
+		    while(size != 0)
+		    {
+			    auto sent = send(connectionSocket, bytes, static_cast<size_t>(size), MSG_NOSIGNAL);
+			    if(sent <= 0) return false;
+			    bytes += sent;
+			    size -= sent;
+		    }
+		    return true;
+	    };
+
+	if(sendAll(header.data(), header.size()) && (bodySize != 0))
+	{
+		sendAll(body, bodySize);
+	}
+}
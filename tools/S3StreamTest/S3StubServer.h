@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Types.h"
+
+//Minimal S3 compatible server serving a single object from memory, reachable with
+//path-style requests (http://127.0.0.1:<port>/<bucket>/<object>). Only supports HEAD and
+//GET (with a single byte range). Requests are answered after a fixed delay to simulate
+//network latency. Signatures aren't checked.
+class CS3StubServer
+{
+public:
+	CS3StubServer(std::string, std::string, std::vector<uint8>, uint32 = 0, uint16 = 0);
+	CS3StubServer(const CS3StubServer&) = delete;
+	virtual ~CS3StubServer();
+
+	CS3StubServer& operator=(const CS3StubServer&) = delete;
+
+	std::string GetEndpoint() const;
+	std::string GetEtag() const;
+
+	uint32 GetGetRequestCount() const;
+	uint32 GetMaxConcurrentRequestCount() const;
+	void ResetStats();
+
+private:
+	struct REQUEST
+	{
+		std::string method;
+		std::string uri;
+		std::string range;
+		bool keepAlive = true;
+	};
+
+	void ServerThreadProc();
+	void ConnectionThreadProc(int);
+	bool ReceiveRequest(int, std::string&, REQUEST&);
+	void SendResponse(int, const REQUEST&);
+
+	std::string m_bucketName;
+	std::string m_objectName;
+	std::vector<uint8> m_objectData;
+	std::string m_objectEtag;
+	uint32 m_latencyMs = 0;
+	uint16 m_port = 0;
+
+	int m_serverSocket = -1;
+	std::thread m_serverThread;
+
+	std::mutex m_connectionsMutex;
+	bool m_stopping = false;
+	std::list<int> m_connectionSockets;
+	std::list<std::thread> m_connectionThreads;
+
+	std::atomic<uint32> m_getRequestCount;
+	std::atomic<uint32> m_concurrentRequestCount;
+	std::atomic<uint32> m_maxConcurrentRequestCount;
+};
@@ -0,0 +1,377 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "StdStreamUtils.h"
+#include "Trace.h"
+
+struct ARGUMENT
+{
+	CTrace::ARG_TYPE type = CTrace::ARG_TYPE_END;
+	uint64 integer = 0;
+	double real = 0;
+	std::string string;
+};
+
+struct FORMAT
+{
+	std::string format;
+	uint32 categoryIndex = 0;
+	uint32 flags = 0;
+};
+
+struct ENTRY
+{
+	CTrace::RECORD record;
+	uint32 threadIndex = 0;
+};
+
+struct TRACE
+{
+	std::map<uint32, std::string> categories;
+	std::map<uint32, FORMAT> formats;
+	std::map<uint32, std::string> threads;
+	std::map<uint32, uint64> droppedRecordCounts;
+	std::vector<ENTRY> entries;
+};
+
+static TRACE ReadTrace(const char* path)
+{
+	auto stream = Framework::CreateInputStdStream(std::string(path));
+	std::vector<uint8> data(stream.GetLength());
+	stream.Read(data.data(), data.size());
+
+	CTrace::FILE_HEADER header = {};
+	if(data.size() < sizeof(CTrace::FILE_HEADER))
+	{
+		throw std::runtime_error("File is too small.");
+	}
+	memcpy(&header, data.data(), sizeof(CTrace::FILE_HEADER));
+	if(header.magic != CTrace::TRACE_MAGIC)
+	{
+		throw std::runtime_error("Not a trace file.");
+	}
+	if((header.version != CTrace::TRACE_VERSION) || (header.recordSize != sizeof(CTrace::RECORD)))
+	{
+		throw std::runtime_error("Unsupported trace file version.");
+	}
+
+	TRACE result;
+	size_t position = sizeof(CTrace::FILE_HEADER);
+	while((position + sizeof(CTrace::BLOCK_HEADER)) <= data.size())
+	{
+		CTrace::BLOCK_HEADER blockHeader = {};
+		memcpy(&blockHeader, data.data() + position, sizeof(CTrace::BLOCK_HEADER));
+		position += sizeof(CTrace::BLOCK_HEADER);
+		if(((position + blockHeader.size) > data.size()) || (blockHeader.size < sizeof(uint32)))
+		{
+			//Last block might be incomplete if the emulator didn't exit cleanly
+			fprintf(stderr, "Warning: Trace file is truncated.\r\n");
+			break;
+		}
+
+		auto block = data.data() + position;
+		position += blockHeader.size;
+
+		uint32 index = 0;
+		memcpy(&index, block, sizeof(uint32));
+		auto payload = block + sizeof(uint32);
+		auto payloadSize = blockHeader.size - sizeof(uint32);
+
+		switch(blockHeader.type)
+		{
+		case CTrace::BLOCK_TYPE_CATEGORY:
+			result.categories[index] = std::string(reinterpret_cast<const char*>(payload), payloadSize);
+			break;
+		case CTrace::BLOCK_TYPE_FORMAT:
+		{
+			if(payloadSize < (sizeof(uint32) * 2)) break;
+			FORMAT format;
+			memcpy(&format.categoryIndex, payload, sizeof(uint32));
+			memcpy(&format.flags, payload + sizeof(uint32), sizeof(uint32));
+			format.format = std::string(reinterpret_cast<const char*>(payload) + sizeof(uint32) * 2, payloadSize - sizeof(uint32) * 2);
+			result.formats[index] = std::move(format);
+		}
+		break;
+		case CTrace::BLOCK_TYPE_THREAD:
+			result.threads[index] = std::string(reinterpret_cast<const char*>(payload), payloadSize);
+			break;
+		case CTrace::BLOCK_TYPE_RECORDS:
+		{
+			size_t recordCount = payloadSize / sizeof(CTrace::RECORD);
+			for(size_t i = 0; i < recordCount; i++)
+			{
+				ENTRY entry;
+				memcpy(&entry.record, payload + i * sizeof(CTrace::RECORD), sizeof(CTrace::RECORD));
+				entry.threadIndex = index;
+				result.entries.push_back(entry);
+			}
+		}
+		break;
+		case CTrace::BLOCK_TYPE_DROPPED:
+		{
+			uint32 droppedCount = 0;
+			if(payloadSize < sizeof(uint32)) break;
+			memcpy(&droppedCount, payload, sizeof(uint32));
+			result.droppedRecordCounts[index] += droppedCount;
+		}
+		break;
+		default:
+			//Unknown block, skip it
+			break;
+		}
+	}
+
+	//Records from all threads are interleaved by time, records from one thread are already in order
+	std::stable_sort(result.entries.begin(), result.entries.end(),
+	                 [](const ENTRY& lhs, const ENTRY& rhs) { return lhs.record.timestamp < rhs.record.timestamp; });
+	return result;
+}
+
+static std::vector<ARGUMENT> DecodeArguments(const CTrace::RECORD& record)
+{
+	std::vector<ARGUMENT> result;
+	uint32 position = 0;
+	while(position < CTrace::RECORD_ARGS_SIZE)
+	{
+		uint8 tag = record.args[position++];
+		ARGUMENT argument;
+		argument.type = static_cast<CTrace::ARG_TYPE>(tag >> 4);
+		uint32 size = tag & 0x0F;
+		switch(argument.type)
+		{
+		case CTrace::ARG_TYPE_UNSIGNED:
+		case CTrace::ARG_TYPE_SIGNED:
+		case CTrace::ARG_TYPE_DOUBLE:
+		{
+			if((position + size) > CTrace::RECORD_ARGS_SIZE) return result;
+			uint64 value = 0;
+			for(uint32 i = 0; i < size; i++)
+			{
+				value |= static_cast<uint64>(record.args[position++]) << (i * 8);
+			}
+			if(argument.type == CTrace::ARG_TYPE_SIGNED)
+			{
+				value = (value >> 1) ^ (~(value & 1) + 1);
+			}
+			if(argument.type == CTrace::ARG_TYPE_DOUBLE)
+			{
+				memcpy(&argument.real, &value, sizeof(double));
+			}
+			argument.integer = value;
+		}
+		break;
+		case CTrace::ARG_TYPE_STRING:
+		{
+			if(position >= CTrace::RECORD_ARGS_SIZE) return result;
+			uint32 length = record.args[position++];
+			if((position + length) > CTrace::RECORD_ARGS_SIZE) return result;
+			argument.string = std::string(reinterpret_cast<const char*>(record.args + position), length);
+			position += length;
+		}
+		break;
+		default:
+			//End of arguments or truncated record
+			return result;
+		}
+		result.push_back(std::move(argument));
+	}
+	return result;
+}
+
+static std::string FormatMessage(const std::string& format, const std::vector<ARGUMENT>& arguments)
+{
+	std::string result;
+	size_t argumentIndex = 0;
+	auto nextArgument =
+	    [&]() -> const ARGUMENT* {
+		    return (argumentIndex < arguments.size()) ? &arguments[argumentIndex++] : nullptr;
+	    };
+
+	for(size_t i = 0; i < format.size(); i++)
+	{
+		if(format[i] != '%')
+		{
+			result += format[i];
+			continue;
+		}
+		if(((i + 1) < format.size()) && (format[i + 1] == '%'))
+		{
+			result += '%';
+			i++;
+			continue;
+		}
+
+		//Rebuild the conversion without its length modifier, we pick one that fits the decoded value
+		std::string spec = "%";
+		size_t specEnd = i + 1;
+		for(; (specEnd < format.size()) && strchr("-+ #0123456789.*", format[specEnd]); specEnd++)
+		{
+			if(format[specEnd] == '*')
+			{
+				auto argument = nextArgument();
+				spec += std::to_string(argument ? static_cast<int32>(argument->integer) : 0);
+			}
+			else
+			{
+				spec += format[specEnd];
+			}
+		}
+		uint32 integerBits = 32;
+		for(; (specEnd < format.size()) && strchr("hljztL", format[specEnd]); specEnd++)
+		{
+			switch(format[specEnd])
+			{
+			case 'h':
+				integerBits = (integerBits == 16) ? 8 : 16;
+				break;
+			case 'l':
+			case 'j':
+			case 'z':
+			case 't':
+				integerBits = 64;
+				break;
+			}
+		}
+		if(specEnd == format.size()) break;
+		char conversion = format[specEnd];
+		i = specEnd;
+
+		auto argument = nextArgument();
+		if(!argument)
+		{
+			result += "<?>";
+			continue;
+		}
+
+		char buffer[0x200];
+		switch(conversion)
+		{
+		case 'd':
+		case 'i':
+		{
+			auto value = static_cast<int64>(argument->integer << (64 - integerBits)) >> (64 - integerBits);
+			snprintf(buffer, sizeof(buffer), (spec + "lld").c_str(), static_cast<long long>(value));
+		}
+		break;
+		case 'u':
+		case 'x':
+		case 'X':
+		case 'o':
+		{
+			auto value = (integerBits == 64) ? argument->integer : (argument->integer & ((1ULL << integerBits) - 1));
+			snprintf(buffer, sizeof(buffer), (spec + "ll" + conversion).c_str(), static_cast<unsigned long long>(value));
+		}
+		break;
+		case 'c':
+			snprintf(buffer, sizeof(buffer), (spec + "c").c_str(), static_cast<int>(argument->integer));
+			break;
+		case 'p':
+			snprintf(buffer, sizeof(buffer), "0x%llx", static_cast<unsigned long long>(argument->integer));
+			break;
+		case 'f':
+		case 'F':
+		case 'e':
+		case 'E':
+		case 'g':
+		case 'G':
+		case 'a':
+		case 'A':
+		{
+			double value = (argument->type == CTrace::ARG_TYPE_DOUBLE) ? argument->real : static_cast<double>(argument->integer);
+			snprintf(buffer, sizeof(buffer), (spec + conversion).c_str(), value);
+		}
+		break;
+		case 's':
+			snprintf(buffer, sizeof(buffer), (spec + "s").c_str(), (argument->type == CTrace::ARG_TYPE_STRING) ? argument->string.c_str() : "?");
+			break;
+		default:
+			snprintf(buffer, sizeof(buffer), "<%c?>", conversion);
+			break;
+		}
+		result += buffer;
+	}
+
+	while(!result.empty() && ((result.back() == '\r') || (result.back() == '\n')))
+	{
+		result.pop_back();
+	}
+	return result;
+}
+
+int main(int argc, const char** argv)
+{
+	if(argc < 2)
+	{
+		printf("Usage: TraceDecoder [options] <trace path>\r\n");
+		printf("Options: \r\n");
+		printf("\t --category <name>\tOnly output records from this category (can be used more than once).\r\n");
+		return -1;
+	}
+
+	std::set<std::string> categoryFilter;
+	for(int i = 1; i < (argc - 1); i++)
+	{
+		if(!strcmp(argv[i], "--category"))
+		{
+			if((i + 1) >= (argc - 1))
+			{
+				printf("Error: Category name must be specified for --category option.\r\n");
+				return -1;
+			}
+			categoryFilter.insert(argv[i + 1]);
+			i++;
+		}
+		else
+		{
+			printf("Error: Unknown option '%s'.\r\n", argv[i]);
+			return -1;
+		}
+	}
+
+	TRACE trace;
+	try
+	{
+		trace = ReadTrace(argv[argc - 1]);
+	}
+	catch(const std::exception& exception)
+	{
+		printf("Error: Failed to read trace: %s\r\n", exception.what());
+		return -1;
+	}
+
+	for(const auto& entry : trace.entries)
+	{
+		auto formatIterator = trace.formats.find(entry.record.formatId);
+		if(formatIterator == std::end(trace.formats)) continue;
+		const auto& format = formatIterator->second;
+
+		auto categoryIterator = trace.categories.find(format.categoryIndex);
+		auto categoryName = (categoryIterator != std::end(trace.categories)) ? categoryIterator->second : std::string("?");
+		if(!categoryFilter.empty() && (categoryFilter.find(categoryName) == std::end(categoryFilter))) continue;
+
+		auto threadIterator = trace.threads.find(entry.threadIndex);
+		auto threadName = ((threadIterator != std::end(trace.threads)) && !threadIterator->second.empty()) ? threadIterator->second : std::to_string(entry.threadIndex);
+
+		auto message = FormatMessage(format.format, DecodeArguments(entry.record));
+		printf("[%12.3f] [%s] cycle %llu %s%s: %s\n",
+		       static_cast<double>(entry.record.timestamp) / 1000000.0, threadName.c_str(),
+		       static_cast<unsigned long long>(entry.record.cycle),
+		       (format.flags & CTrace::FORMAT_FLAG_WARNING) ? "warning: " : "",
+		       categoryName.c_str(), message.c_str());
+	}
+
+	for(const auto& droppedRecordCount : trace.droppedRecordCounts)
+	{
+		auto threadIterator = trace.threads.find(droppedRecordCount.first);
+		auto threadName = (threadIterator != std::end(trace.threads)) ? threadIterator->second : std::to_string(droppedRecordCount.first);
+		fprintf(stderr, "Warning: %llu records were dropped from thread '%s'.\r\n",
+		        static_cast<unsigned long long>(droppedRecordCount.second), threadName.c_str());
+	}
+
+	return 0;
+}
@@ -12,6 +12,7 @@
 #include "StallTest.h"
 #include "StallTest2.h"
 #include "TriAceTest.h"
+#include "XgKickWrapTest.h"
 
 typedef std::function<CTest*()> TestFactoryFunction;
 
@@ -28,6 +29,7 @@ static const TestFactoryFunction s_factories[] =
 	[]() { return new CStallTest(); },
 	[]() { return new CStallTest2(); },
 	[]() { return new CTriAceTest(); },
+	[]() { return new CXgKickWrapTest(); },
 };
 // clang-format on
 
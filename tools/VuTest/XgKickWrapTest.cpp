@@ -0,0 +1,44 @@
+#include <cstring>
+#include <vector>
+#include "XgKickWrapTest.h"
+#include "Ps2Const.h"
+#include "ee/GIF.h"
+#include "ee/Vpu.h"
+
+void CXgKickWrapTest::Execute(CTestVm& virtualMachine)
+{
+	std::vector<uint8> vuMem(PS2::VUMEM1SIZE);
+	for(uint32 i = 0; i < PS2::VUMEM1SIZE; i++)
+	{
+		vuMem[i] = static_cast<uint8>(i * 7);
+	}
+
+	//Packet starts 2 qwords before the end of VU1 memory and continues at its start
+	uint32 packetAddress = PS2::VUMEM1SIZE - 0x20;
+
+	CGIF::TAG packedTag = {};
+	packedTag.loops = 1;
+	packedTag.nreg = 1;
+	packedTag.cmd = 0;
+	memcpy(vuMem.data() + packetAddress, &packedTag, sizeof(CGIF::TAG));
+
+	CGIF::TAG imageTag = {};
+	imageTag.loops = 2;
+	imageTag.eop = 1;
+	imageTag.cmd = 2;
+	memcpy(vuMem.data(), &imageTag, sizeof(CGIF::TAG));
+
+	uint32 packetSize = CVpu::GetXgKickPacketSize(vuMem.data(), packetAddress);
+	TEST_VERIFY(packetSize == 0x50);
+
+	std::vector<uint8> packet;
+	CVpu::CopyXgKickPacket(vuMem.data(), packetAddress, packetSize, packet);
+	TEST_VERIFY(packet.size() == packetSize);
+	TEST_VERIFY(memcmp(packet.data(), vuMem.data() + packetAddress, 0x20) == 0);
+	TEST_VERIFY(memcmp(packet.data() + 0x20, vuMem.data(), 0x30) == 0);
+
+	//Same packet without wrapping
+	memcpy(vuMem.data() + 0x100, &packedTag, sizeof(CGIF::TAG));
+	memcpy(vuMem.data() + 0x120, &imageTag, sizeof(CGIF::TAG));
+	TEST_VERIFY(CVpu::GetXgKickPacketSize(vuMem.data(), 0x100) == 0x50);
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include "Test.h"
+
+class CXgKickWrapTest : public CTest
+{
+public:
+	void Execute(CTestVm&) override;
+};